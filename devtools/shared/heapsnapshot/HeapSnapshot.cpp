@@ -466,6 +466,11 @@ void HeapSnapshot::TakeCensus(JSContext* cx, JS::Handle<JSObject*> options,
       rv.Throw(NS_ERROR_UNEXPECTED);
       return;
     }
+
+    if (NS_WARN_IF(!handler.finish())) {
+      rv.Throw(NS_ERROR_OUT_OF_MEMORY);
+      return;
+    }
   }
 
   if (NS_WARN_IF(!handler.report(cx, rval))) {
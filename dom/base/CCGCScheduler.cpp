@@ -138,6 +138,9 @@ struct CCIntervalMarker {
       aWriter.IntProperty("mFreedRefCounted", aResults.mFreedRefCounted);
       aWriter.IntProperty("mFreedGCed", aResults.mFreedGCed);
       aWriter.IntProperty("mFreedJSZones", aResults.mFreedJSZones);
+      aWriter.TimeDoubleMsProperty("mScanRootsTime",
+                                   aResults.mScanRootsTime.ToMilliseconds());
+      aWriter.IntProperty("mScanThreads", aResults.mScanThreads);
     }
   }
   static mozilla::MarkerSchema MarkerTypeDisplay() {
@@ -158,6 +161,10 @@ struct CCIntervalMarker {
                              MS::Format::Integer);
     schema.AddKeyLabelFormat("mSlices", "Number of Slices",
                              MS::Format::Integer);
+    schema.AddKeyLabelFormat("mScanRootsTime", "Scan Roots Time",
+                             MS::Format::Duration);
+    schema.AddKeyLabelFormat("mScanThreads", "Scan Roots Threads",
+                             MS::Format::Integer);
     schema.AddKeyLabelFormat("mAnyManual", "Manually Triggered",
                              MS::Format::Integer);
     schema.AddKeyLabelFormat("mForcedGC", "GC Forced", MS::Format::Integer);
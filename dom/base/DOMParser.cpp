@@ -71,9 +71,6 @@ already_AddRefed<Document> DOMParser::ParseFromString(const nsAString& aStr,
 
   MarkTaintOperation(strCopy, "DOMParser.ParseFromString", args);
 
-#if (DEBUG_E2E_TAINTING)
-    puts("++++ ParseFromString ++++");
-#endif
   if (aType == SupportedType::Text_html) {
     nsCOMPtr<Document> document = SetUpDocument(DocumentFlavorHTML, aRv);
     if (NS_WARN_IF(aRv.Failed())) {
@@ -109,7 +109,8 @@ nsresult JSExecutionContext::JoinOffThread(
 }
 
 template <typename Unit>
-nsresult JSExecutionContext::InternalCompile(JS::SourceText<Unit>& aSrcBuf) {
+nsresult JSExecutionContext::InternalCompile(JS::SourceText<Unit>& aSrcBuf,
+                                             RefPtr<JS::Stencil>* aStencilOut) {
   if (mSkip) {
     return mRv;
   }
@@ -128,6 +129,10 @@ nsresult JSExecutionContext::InternalCompile(JS::SourceText<Unit>& aSrcBuf) {
     return mRv;
   }
 
+  if (aStencilOut) {
+    *aStencilOut = stencil;
+  }
+
   return InstantiateStencil(std::move(stencil));
 }
 
@@ -139,7 +144,8 @@ nsresult JSExecutionContext::Compile(JS::SourceText<Utf8Unit>& aSrcBuf) {
   return InternalCompile(aSrcBuf);
 }
 
-nsresult JSExecutionContext::Compile(const nsAString& aScript) {
+nsresult JSExecutionContext::Compile(const nsAString& aScript,
+                                     RefPtr<JS::Stencil>* aStencilOut) {
   if (mSkip) {
     return mRv;
   }
@@ -153,7 +159,21 @@ nsresult JSExecutionContext::Compile(const nsAString& aScript) {
     return mRv;
   }
 
-  return Compile(srcBuf);
+  return InternalCompile(srcBuf, aStencilOut);
+}
+
+nsresult JSExecutionContext::Instantiate(JS::Stencil* aStencil) {
+  if (mSkip) {
+    return mRv;
+  }
+
+  MOZ_ASSERT(aStencil);
+  MOZ_ASSERT(mRetValue.isUndefined());
+#ifdef DEBUG
+  mWantsReturnValue = !mCompileOptions.noScriptRval;
+#endif
+
+  return InstantiateStencil(RefPtr<JS::Stencil>(aStencil));
 }
 
 nsresult JSExecutionContext::Decode(mozilla::Vector<uint8_t>& aBytecodeBuf,
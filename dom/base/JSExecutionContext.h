@@ -80,7 +80,8 @@ class MOZ_STACK_CLASS JSExecutionContext final {
  private:
   // Compile a script contained in a SourceText.
   template <typename Unit>
-  nsresult InternalCompile(JS::SourceText<Unit>& aSrcBuf);
+  nsresult InternalCompile(JS::SourceText<Unit>& aSrcBuf,
+                           RefPtr<JS::Stencil>* aStencilOut = nullptr);
 
   // Instantiate (on main-thread) a JS::Stencil generated by off-thread or
   // main-thread parsing or decoding.
@@ -136,8 +137,14 @@ class MOZ_STACK_CLASS JSExecutionContext final {
   nsresult Compile(JS::SourceText<char16_t>& aSrcBuf);
   nsresult Compile(JS::SourceText<mozilla::Utf8Unit>& aSrcBuf);
 
-  // Compile a script contained in a string.
-  nsresult Compile(const nsAString& aScript);
+  // Compile a script contained in a string. If |aStencilOut| is non-null it
+  // receives the compiled stencil, which can be passed to |Instantiate| later
+  // to execute the same script again without compiling it.
+  nsresult Compile(const nsAString& aScript,
+                   RefPtr<JS::Stencil>* aStencilOut = nullptr);
+
+  // Instantiate a stencil previously returned by |Compile|.
+  nsresult Instantiate(JS::Stencil* aStencil);
 
   // Decode a script contained in a buffer.
   nsresult Decode(mozilla::Vector<uint8_t>& aBytecodeBuf,
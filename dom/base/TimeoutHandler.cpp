@@ -7,7 +7,12 @@
 #include "TimeoutHandler.h"
 
 #include "mozilla/Assertions.h"
+#include "mozilla/CycleCollectedJSContext.h"
 #include "mozilla/HoldDropJSObjects.h"
+#include "mozilla/dom/JSExecutionContext.h"
+#include "mozilla/dom/ScriptSettings.h"
+#include "js/experimental/JSStencil.h"
+#include "js/loader/LoadedScript.h"
 #include "nsJSUtils.h"
 
 namespace mozilla::dom {
@@ -78,6 +83,55 @@ NS_INTERFACE_MAP_END
 NS_IMPL_CYCLE_COLLECTING_ADDREF(ScriptTimeoutHandler)
 NS_IMPL_CYCLE_COLLECTING_RELEASE(ScriptTimeoutHandler)
 
+bool ScriptTimeoutHandler::Evaluate(
+    const char* aExecutionReason, ScriptTimeoutHandlerCache* aCache,
+    JS::loader::LoadedScript* aInitiatingScript) {
+  // New script entry point required, due to the "Create a script" sub-step
+  // of
+  // http://www.whatwg.org/specs/web-apps/current-work/#timer-initialisation-steps
+  nsAutoMicroTask mt;
+  AutoEntryScript aes(mGlobal, aExecutionReason, true);
+  JS::CompileOptions options(aes.cx());
+  options.setFileAndLine(mFileName.get(), mLineNo);
+  options.setNoScriptRval(true);
+  options.setIntroductionType("domTimer");
+  JS::Rooted<JSObject*> global(aes.cx(), mGlobal->GetGlobalJSObject());
+
+  // Intervals fire the same string over and over, so reuse the stencil of an
+  // earlier run instead of compiling it again.
+  RefPtr<JS::Stencil> stencil;
+  if (aCache) {
+    stencil = aCache->Lookup(mExpr, mFileName, mLineNo);
+  }
+  {
+    JSExecutionContext exec(aes.cx(), global, options);
+    nsresult rv;
+    if (stencil) {
+      rv = exec.Instantiate(stencil);
+    } else {
+      rv = exec.Compile(mExpr, aCache ? &stencil : nullptr);
+      if (stencil) {
+        aCache->Put(mExpr, mFileName, mLineNo, stencil);
+      }
+    }
+
+    JS::Rooted<JSScript*> script(aes.cx(), exec.MaybeGetScript());
+    if (script) {
+      if (aInitiatingScript) {
+        aInitiatingScript->AssociateWithScript(script);
+      }
+
+      rv = exec.ExecScript();
+    }
+
+    if (rv == NS_SUCCESS_DOM_SCRIPT_EVALUATION_THREW_UNCATCHABLE) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 void ScriptTimeoutHandler::GetDescription(nsACString& aOutString) {
   if (mExpr.Length() > 15) {
     aOutString.AppendPrintf(
@@ -175,4 +229,63 @@ void CallbackTimeoutHandler::GetDescription(nsACString& aOutString) {
   mFunction->GetDescription(aOutString);
 }
 
+//-----------------------------------------------------------------------------
+// ScriptTimeoutHandlerCache
+//-----------------------------------------------------------------------------
+
+already_AddRefed<JS::Stencil> ScriptTimeoutHandlerCache::Lookup(
+    const nsAString& aExpr, const nsACString& aFileName, uint32_t aLineNo) {
+  bool tainted = aExpr.isTainted();
+  for (size_t i = mEntries.Length(); i > 0; i--) {
+    Entry& entry = mEntries[i - 1];
+    if (entry.mLineNo != aLineNo || entry.mTainted != tainted ||
+        !entry.mExpr.Equals(aExpr) || !entry.mFileName.Equals(aFileName)) {
+      continue;
+    }
+
+    mHits++;
+    RefPtr<JS::Stencil> stencil = entry.mStencil;
+    if (i != mEntries.Length()) {
+      Entry moved = std::move(entry);
+      mEntries.RemoveElementAt(i - 1);
+      mEntries.AppendElement(std::move(moved));
+    }
+    return stencil.forget();
+  }
+
+  mMisses++;
+  return nullptr;
+}
+
+void ScriptTimeoutHandlerCache::Put(const nsAString& aExpr,
+                                    const nsACString& aFileName,
+                                    uint32_t aLineNo, JS::Stencil* aStencil) {
+  MOZ_ASSERT(aStencil);
+  if (aExpr.Length() > kMaxExpressionLength) {
+    return;
+  }
+
+  if (mEntries.Length() >= kMaxEntries) {
+    mEntries.RemoveElementAt(0);
+  }
+
+  Entry* entry = mEntries.AppendElement();
+  entry->mExpr = aExpr;
+  entry->mFileName = aFileName;
+  entry->mLineNo = aLineNo;
+  entry->mTainted = aExpr.isTainted();
+  entry->mStencil = aStencil;
+}
+
+size_t ScriptTimeoutHandlerCache::SizeOfExcludingThis(
+    MallocSizeOf aMallocSizeOf) const {
+  size_t n = mEntries.ShallowSizeOfExcludingThis(aMallocSizeOf);
+  for (const Entry& entry : mEntries) {
+    n += entry.mExpr.SizeOfExcludingThisIfUnshared(aMallocSizeOf);
+    n += entry.mFileName.SizeOfExcludingThisIfUnshared(aMallocSizeOf);
+    n += JS::SizeOfStencil(entry.mStencil, aMallocSizeOf);
+  }
+  return n;
+}
+
 }  // namespace mozilla::dom
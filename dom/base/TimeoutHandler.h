@@ -12,11 +12,22 @@
 #include "nsISupports.h"
 #include "nsCycleCollectionParticipant.h"
 #include "nsString.h"
+#include "nsTArray.h"
 #include "mozilla/Attributes.h"
+#include "mozilla/RefPtr.h"
 #include "mozilla/dom/FunctionBinding.h"
 
+namespace JS {
+struct Stencil;
+namespace loader {
+class LoadedScript;
+}
+}  // namespace JS
+
 namespace mozilla::dom {
 
+class ScriptTimeoutHandlerCache;
+
 /**
  * Utility class for implementing nsITimeoutHandlers, designed to be subclassed.
  */
@@ -70,6 +81,12 @@ class ScriptTimeoutHandler : public TimeoutHandler {
  protected:
   virtual ~ScriptTimeoutHandler() = default;
 
+  // Compiles and runs mExpr in mGlobal. If aCache is non-null, the stencil of
+  // an earlier run is reused, or this run's stencil is added to it.
+  MOZ_CAN_RUN_SCRIPT bool Evaluate(const char* aExecutionReason,
+                                   ScriptTimeoutHandlerCache* aCache,
+                                   JS::loader::LoadedScript* aInitiatingScript);
+
   nsCOMPtr<nsIGlobalObject> mGlobal;
   // The expression to evaluate or function to call. If mFunction is non-null
   // it should be used, else use mExpr.
@@ -99,6 +116,62 @@ class CallbackTimeoutHandler final : public TimeoutHandler {
   nsTArray<JS::Heap<JS::Value>> mArgs;
 };
 
+/**
+ * Cache of compiled string handlers of setTimeout and setInterval, owned by a
+ * global. Patterns like setInterval("poll()", 50) would otherwise compile the
+ * same source every time the timer fires.
+ *
+ * Entries are keyed by the source text, its taint status and the location of
+ * the setTimeout call, because the stencil depends on the compile options. The
+ * taint sink is reported when the handler is registered, so a cached stencil
+ * never hides a tainted handler from the sink.
+ */
+class ScriptTimeoutHandlerCache final {
+ public:
+  ScriptTimeoutHandlerCache() = default;
+  ScriptTimeoutHandlerCache(const ScriptTimeoutHandlerCache&) = delete;
+  ScriptTimeoutHandlerCache& operator=(const ScriptTimeoutHandlerCache&) =
+      delete;
+
+  // Returns the stencil compiled for the given handler, or nullptr.
+  already_AddRefed<JS::Stencil> Lookup(const nsAString& aExpr,
+                                       const nsACString& aFileName,
+                                       uint32_t aLineNo);
+
+  // Adds a stencil compiled for the given handler, evicting the least
+  // recently used entry if the cache is full.
+  void Put(const nsAString& aExpr, const nsACString& aFileName,
+           uint32_t aLineNo, JS::Stencil* aStencil);
+
+  void Clear() { mEntries.Clear(); }
+
+  uint32_t Length() const { return mEntries.Length(); }
+  uint64_t Hits() const { return mHits; }
+  uint64_t Misses() const { return mMisses; }
+
+  size_t SizeOfExcludingThis(MallocSizeOf aMallocSizeOf) const;
+
+  static const uint32_t kMaxEntries = 16;
+
+  // Handlers longer than this are not cached, they are unlikely to be
+  // repeated and would pin a lot of memory.
+  static const uint32_t kMaxExpressionLength = 4096;
+
+ private:
+  struct Entry {
+    nsString mExpr;
+    nsCString mFileName;
+    uint32_t mLineNo;
+    bool mTainted;
+    RefPtr<JS::Stencil> mStencil;
+  };
+
+  // Ordered from least to most recently used.
+  nsTArray<Entry> mEntries;
+  uint64_t mHits = 0;
+  uint64_t mMisses = 0;
+};
+
 }  // namespace mozilla::dom
 
 #endif  // mozilla_dom_timeout_handler_h
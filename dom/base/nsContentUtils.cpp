@@ -8963,22 +8963,27 @@ class StringBuilder {
   void EncodeAttrString(Span<const char16_t> aStr, BulkAppender& aAppender, const StringTaint& aTaint) {
     size_t flushedUntil = 0;
     size_t currentPosition = 0;
+    StringTaint::Cursor taintCursor = aTaint.cursor();
     for (char16_t c : aStr) {
-      TaintFlow flow(aTaint.atRef(currentPosition));
-      SafeStringTaint taint = aTaint.safeSubTaint(flushedUntil, currentPosition);
+      // Taintfox: only compute the taint of the flushed part when a
+      // character is actually replaced.
+      const TaintFlow& flow = taintCursor.atRef(currentPosition);
       switch (c) {
         case '"':
-          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition), taint);
+          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition),
+                           aTaint.safeSubTaint(flushedUntil, currentPosition));
           aAppender.AppendLiteralTainted(u"&quot;", StringTaint(flow, 6));
           flushedUntil = currentPosition + 1;
           break;
         case '&':
-          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition), taint);
+          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition),
+                           aTaint.safeSubTaint(flushedUntil, currentPosition));
           aAppender.AppendLiteralTainted(u"&amp;", StringTaint(flow, 5));
           flushedUntil = currentPosition + 1;
           break;
         case 0x00A0:
-          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition), taint);
+          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition),
+                           aTaint.safeSubTaint(flushedUntil, currentPosition));
           aAppender.AppendLiteralTainted(u"&nbsp;", StringTaint(flow, 6));
           flushedUntil = currentPosition + 1;
           break;
@@ -8999,27 +9004,33 @@ class StringBuilder {
   void EncodeTextFragment(Span<const T> aStr, BulkAppender& aAppender, const StringTaint& aTaint) {
     size_t flushedUntil = 0;
     size_t currentPosition = 0;
+    StringTaint::Cursor taintCursor = aTaint.cursor();
     for (T c : aStr) {
-      TaintFlow flow(aTaint.atRef(currentPosition));
-      SafeStringTaint taint = aTaint.safeSubTaint(flushedUntil, currentPosition);
+      // Taintfox: only compute the taint of the flushed part when a
+      // character is actually replaced.
+      const TaintFlow& flow = taintCursor.atRef(currentPosition);
       switch (c) {
         case '<':
-          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition), taint);
+          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition),
+                           aTaint.safeSubTaint(flushedUntil, currentPosition));
           aAppender.AppendLiteralTainted(u"&lt;", StringTaint(flow, 4));
           flushedUntil = currentPosition + 1;
           break;
         case '>':
-          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition), taint);
+          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition),
+                           aTaint.safeSubTaint(flushedUntil, currentPosition));
           aAppender.AppendLiteralTainted(u"&gt;", StringTaint(flow, 4));
           flushedUntil = currentPosition + 1;
           break;
         case '&':
-          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition), taint);
+          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition),
+                           aTaint.safeSubTaint(flushedUntil, currentPosition));
           aAppender.AppendLiteralTainted(u"&amp;", StringTaint(flow, 5));
           flushedUntil = currentPosition + 1;
           break;
         case T(0xA0):
-          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition), taint);
+          aAppender.Append(aStr.FromTo(flushedUntil, currentPosition),
+                           aTaint.safeSubTaint(flushedUntil, currentPosition));
           aAppender.AppendLiteralTainted(u"&nbsp;", StringTaint(flow, 6));
           flushedUntil = currentPosition + 1;
           break;
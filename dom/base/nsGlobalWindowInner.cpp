@@ -1147,6 +1147,7 @@ void nsGlobalWindowInner::FreeInnerObjects() {
   if (mTimeoutManager) {
     mTimeoutManager->ClearAllTimeouts();
   }
+  mTimeoutHandlerCache.Clear();
 
   DisableIdleCallbackRequests();
 
@@ -6287,36 +6288,16 @@ NS_IMPL_ADDREF_INHERITED(WindowScriptTimeoutHandler, ScriptTimeoutHandler)
 NS_IMPL_RELEASE_INHERITED(WindowScriptTimeoutHandler, ScriptTimeoutHandler)
 
 bool WindowScriptTimeoutHandler::Call(const char* aExecutionReason) {
-  // New script entry point required, due to the "Create a script" sub-step
-  // of
-  // http://www.whatwg.org/specs/web-apps/current-work/#timer-initialisation-steps
-  nsAutoMicroTask mt;
-  AutoEntryScript aes(mGlobal, aExecutionReason, true);
-  JS::CompileOptions options(aes.cx());
-  options.setFileAndLine(mFileName.get(), mLineNo);
-  options.setNoScriptRval(true);
-  options.setIntroductionType("domTimer");
-  JS::Rooted<JSObject*> global(aes.cx(), mGlobal->GetGlobalJSObject());
-  {
-    JSExecutionContext exec(aes.cx(), global, options);
-    nsresult rv = exec.Compile(mExpr);
-
-    JS::Rooted<JSScript*> script(aes.cx(), exec.MaybeGetScript());
-    if (script) {
-      if (mInitiatingScript) {
-        mInitiatingScript->AssociateWithScript(script);
-      }
-
-      rv = exec.ExecScript();
-    }
-
-    if (rv == NS_SUCCESS_DOM_SCRIPT_EVALUATION_THREW_UNCATCHABLE) {
-      return false;
+  ScriptTimeoutHandlerCache* cache = nullptr;
+  if (nsGlobalWindowInner* win =
+          nsGlobalWindowInner::Cast(mGlobal->AsInnerWindow())) {
+    if (!win->IsDying()) {
+      cache = &win->TimeoutHandlerCache();
     }
   }
-
-  return true;
-};
+  return Evaluate(aExecutionReason, cache,
+                  MOZ_KnownLive(mInitiatingScript));
+}
 
 nsGlobalWindowInner* nsGlobalWindowInner::InnerForSetTimeoutOrInterval(
     ErrorResult& aError) {
@@ -6883,6 +6864,10 @@ void nsGlobalWindowInner::AddSizeOfIncludingThis(
         mNavigator->SizeOfIncludingThis(aWindowSizes.mState.mMallocSizeOf);
   }
 
+  aWindowSizes.mDOMSizes.mDOMOtherSize +=
+      mTimeoutHandlerCache.SizeOfExcludingThis(
+          aWindowSizes.mState.mMallocSizeOf);
+
   ForEachEventTargetObject([&](DOMEventTargetHelper* et, bool* aDoneOut) {
     if (nsCOMPtr<nsISizeOfEventTarget> iSizeOf = do_QueryObject(et)) {
       aWindowSizes.mDOMSizes.mDOMEventTargetsSize +=
@@ -35,6 +35,7 @@
 #include "mozilla/dom/GamepadHandle.h"
 #include "mozilla/dom/Location.h"
 #include "mozilla/dom/StorageEvent.h"
+#include "mozilla/dom/TimeoutHandler.h"
 #include "mozilla/CallState.h"
 #include "mozilla/Attributes.h"
 #include "mozilla/LinkedList.h"
@@ -1310,6 +1311,11 @@ class nsGlobalWindowInner final : public mozilla::dom::EventTarget,
   using IdleRequests = mozilla::LinkedList<RefPtr<mozilla::dom::IdleRequest>>;
   void RemoveIdleCallback(mozilla::dom::IdleRequest* aRequest);
 
+  // Compiled string handlers of setTimeout and setInterval.
+  mozilla::dom::ScriptTimeoutHandlerCache& TimeoutHandlerCache() {
+    return mTimeoutHandlerCache;
+  }
+
   void SetActiveLoadingState(bool aIsLoading) override;
 
   // Hint to the JS engine whether we are currently loading.
@@ -1503,6 +1509,8 @@ class nsGlobalWindowInner final : public mozilla::dom::EventTarget,
   IdleRequests mIdleRequestCallbacks;
   RefPtr<IdleRequestExecutor> mIdleRequestExecutor;
 
+  mozilla::dom::ScriptTimeoutHandlerCache mTimeoutHandlerCache;
+
 #ifdef DEBUG
   nsCOMPtr<nsIURI> mLastOpenedURI;
 #endif
@@ -16,6 +16,7 @@
 #include "mozilla/dom/ReportingObserver.h"
 #include "mozilla/dom/ServiceWorker.h"
 #include "mozilla/dom/ServiceWorkerRegistration.h"
+#include "mozilla/dom/URLParseCache.h"
 #include "mozilla/ipc/PBackgroundSharedTypes.h"
 #include "nsContentUtils.h"
 #include "nsThreadUtils.h"
@@ -138,6 +139,7 @@ void nsIGlobalObject::UnlinkObjectsInGlobal() {
   mReportingObservers.Clear();
   mCountQueuingStrategySizeFunction = nullptr;
   mByteLengthQueuingStrategySizeFunction = nullptr;
+  mURLParseCache = nullptr;
 }
 
 void nsIGlobalObject::TraverseObjectsInGlobal(
@@ -264,9 +266,20 @@ nsPIDOMWindowInner* nsIGlobalObject::AsInnerWindow() {
 
 size_t nsIGlobalObject::ShallowSizeOfExcludingThis(MallocSizeOf aSizeOf) const {
   size_t rtn = mHostObjectURIs.ShallowSizeOfExcludingThis(aSizeOf);
+  if (mURLParseCache) {
+    rtn += aSizeOf(mURLParseCache.get()) +
+           mURLParseCache->SizeOfExcludingThis(aSizeOf);
+  }
   return rtn;
 }
 
+mozilla::dom::URLParseCache& nsIGlobalObject::GetURLParseCache() {
+  if (!mURLParseCache) {
+    mURLParseCache = mozilla::MakeUnique<mozilla::dom::URLParseCache>();
+  }
+  return *mURLParseCache;
+}
+
 class QueuedMicrotask : public MicroTaskRunnable {
  public:
   QueuedMicrotask(nsIGlobalObject* aGlobal, VoidFunction& aCallback)
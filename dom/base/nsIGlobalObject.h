@@ -13,6 +13,7 @@
 #include "mozilla/dom/DispatcherTrait.h"
 #include "mozilla/dom/ServiceWorkerDescriptor.h"
 #include "mozilla/OriginTrials.h"
+#include "mozilla/UniquePtr.h"
 #include "nsContentUtils.h"
 #include "nsHashKeys.h"
 #include "nsISupports.h"
@@ -50,6 +51,7 @@ class ServiceWorker;
 class ServiceWorkerRegistration;
 class ServiceWorkerRegistrationDescriptor;
 class StorageManager;
+class URLParseCache;
 enum class CallerType : uint32_t;
 }  // namespace dom
 namespace ipc {
@@ -158,6 +160,9 @@ class nsIGlobalObject : public nsISupports,
   void UnlinkObjectsInGlobal();
   void TraverseObjectsInGlobal(nsCycleCollectionTraversalCallback& aCb);
 
+  // URIs parsed by the URL constructor in this global.
+  mozilla::dom::URLParseCache& GetURLParseCache();
+
   // DETH objects must register themselves on the global when they
   // bind to it in order to get the DisconnectFromOwner() method
   // called correctly.  RemoveEventTargetObject() must be called
@@ -301,6 +306,8 @@ class nsIGlobalObject : public nsISupports,
 
   // https://streams.spec.whatwg.org/#byte-length-queuing-strategy-size-function
   RefPtr<mozilla::dom::Function> mByteLengthQueuingStrategySizeFunction;
+
+  mozilla::UniquePtr<mozilla::dom::URLParseCache> mURLParseCache;
 };
 
 NS_DEFINE_STATIC_IID_ACCESSOR(nsIGlobalObject, NS_IGLOBALOBJECT_IID)
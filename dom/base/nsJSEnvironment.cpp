@@ -1322,6 +1322,7 @@ void CycleCollectorStats::MaybeLogStats(const CycleCollectorResults& aResults,
 
   const char16_t* kFmt =
       u"CC(T+%.1f)[%s-%i] max pause: %.fms, total time: %.fms, slices: %lu, "
+      u"scan roots: %.fms on %lu threads, "
       u"suspected: %lu, visited: %lu RCed and %lu%s GCed, collected: %lu "
       u"RCed and %lu GCed (%lu|%lu|%lu waiting for GC)%s\n"
       u"ForgetSkippable %lu times before CC, min: %.f ms, max: %.f ms, avg: "
@@ -1330,8 +1331,10 @@ void CycleCollectorStats::MaybeLogStats(const CycleCollectorResults& aResults,
   nsTextFormatter::ssprintf(
       msg, kFmt, delta.ToMicroseconds() / PR_USEC_PER_SEC,
       ProcessNameForCollectorLog(), getpid(), mMaxSliceTime.ToMilliseconds(),
-      mTotalSliceTime.ToMilliseconds(), aResults.mNumSlices, mSuspected,
-      aResults.mVisitedRefCounted, aResults.mVisitedGCed, mergeMsg.get(),
+      mTotalSliceTime.ToMilliseconds(), aResults.mNumSlices,
+      aResults.mScanRootsTime.ToMilliseconds(), aResults.mScanThreads,
+      mSuspected, aResults.mVisitedRefCounted, aResults.mVisitedGCed,
+      mergeMsg.get(),
       aResults.mFreedRefCounted, aResults.mFreedGCed,
       sScheduler.mCCollectedWaitingForGC,
       sScheduler.mCCollectedZonesWaitingForGC,
@@ -1367,6 +1370,9 @@ void CycleCollectorStats::MaybeNotifyStats(
       u"\"total_slice_pause\": %.f, "
       u"\"max_finish_gc_duration\": %.f, "
       u"\"max_sync_skippable_duration\": %.f, "
+      u"\"scan_roots\": { "
+      u"\"duration\": %.f, "
+      u"\"threads\": %lu }, "
       u"\"suspected\": %lu, "
       u"\"visited\": { "
       u"\"RCed\": %lu, "
@@ -1392,6 +1398,7 @@ void CycleCollectorStats::MaybeNotifyStats(
       json, kJSONFmt, PR_Now(), aCCNowDuration.ToMilliseconds(),
       mMaxSliceTime.ToMilliseconds(), mTotalSliceTime.ToMilliseconds(),
       mMaxGCDuration.ToMilliseconds(), mMaxSkippableDuration.ToMilliseconds(),
+      aResults.mScanRootsTime.ToMilliseconds(), aResults.mScanThreads,
       mSuspected, aResults.mVisitedRefCounted, aResults.mVisitedGCed,
       aResults.mFreedRefCounted, aResults.mFreedGCed,
       sScheduler.mCCollectedWaitingForGC,
@@ -44,6 +44,7 @@
 #include "nsTPromiseFlatString.h"
 #include "nscore.h"
 #include "prenv.h"
+#include "TaintTrace.h"
 
 #if !defined(DEBUG) && !defined(MOZ_ENABLE_JS_DUMP)
 #  include "mozilla/StaticPrefs_browser.h"
@@ -348,6 +349,7 @@ nsresult MarkTaintOperation(nsAString &str, const char* name, const nsTArray<nsS
 }
 
 static nsresult MarkTaintSource(nsAString &str, TaintOperation operation) {
+  TaintTrace(TaintTraceEvent::Source, &str.Taint(), operation.name(), str.Length());
   operation.setSource();
   operation.set_native();
   str.Taint().overlay(0, str.Length(), operation);
@@ -355,6 +357,7 @@ static nsresult MarkTaintSource(nsAString &str, TaintOperation operation) {
 }
 
 static nsresult MarkTaintSource(mozilla::dom::DOMString &str, TaintOperation operation) {
+  TaintTrace(TaintTraceEvent::Source, &str.Taint(), operation.name(), str.Length());
   operation.setSource();
   operation.set_native();
   str.Taint().overlay(0, str.Length(), operation);
@@ -174,6 +174,15 @@ inline bool AssignJSString(JSContext* cx, T& dest, JSString* s) {
 
   MOZ_ASSERT(read == JS::GetStringLength(s));
   handle.Finish(written, kAllowShrinking);
+
+  // TaintFox: copy taint when converting between JavaScript and Gecko strings.
+  // UTF-8 strings are tainted per byte.
+  const StringTaint& taint = JS_GetStringTaint(s);
+  if (MOZ_UNLIKELY(taint.hasTaint())) {
+    dest.AssignTaint(TaintToUtf8(taint, dest.BeginReading(), written));
+  } else {
+    dest.ClearTaint();
+  }
   return true;
 }
 
@@ -0,0 +1,228 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include "Taint.h"
+#include "jsapi.h"
+#include "js/CompilationAndEvaluation.h"
+#include "js/RootingAPI.h"
+#include "mozilla/dom/ScriptSettings.h"
+#include "mozilla/dom/SimpleGlobalObject.h"
+#include "mozilla/dom/TimeoutHandler.h"
+#include "nsString.h"
+#include "xpcpublic.h"
+
+using namespace mozilla;
+using namespace mozilla::dom;
+
+// An interval heavy page: a handful of string handlers which fire many times
+// each, e.g. setInterval("poll()", 50).
+static const char16_t* const kHandlers[] = {
+    u"poll()",
+    u"tick++; if (tick % 10 == 0) { refresh(tick); }",
+    u"updateClock(new Date())",
+    u"counter = (counter + 1) % 1000",
+};
+static const uint32_t kFiresPerHandler = 250;
+
+static const char kFileName[] = "https://example.com/page.js";
+static const uint32_t kLineNo = 17;
+
+static const char kPrelude[] =
+    "var tick = 0, counter = 0;"
+    "function poll() { return tick; }"
+    "function refresh(n) { return n; }"
+    "function updateClock(d) { return d.getTime(); }";
+
+// A string handler registered at a fixed location. Windows run their handlers
+// through the same ScriptTimeoutHandler::Evaluate, with the cache of the
+// window; gtests have no window, so the cache is passed in.
+class TestScriptTimeoutHandler final : public ScriptTimeoutHandler {
+ public:
+  TestScriptTimeoutHandler(JSContext* aCx, nsIGlobalObject* aGlobal,
+                           const nsAString& aExpr, const char* aFileName,
+                           uint32_t aLineNo, ScriptTimeoutHandlerCache* aCache)
+      : ScriptTimeoutHandler(aCx, aGlobal, aExpr), mCache(aCache) {
+    mFileName = aFileName;
+    mLineNo = aLineNo;
+  }
+
+  MOZ_CAN_RUN_SCRIPT virtual bool Call(const char* aExecutionReason) override {
+    return Evaluate(aExecutionReason, mCache, nullptr);
+  }
+
+ private:
+  virtual ~TestScriptTimeoutHandler() = default;
+
+  ScriptTimeoutHandlerCache* mCache;
+};
+
+class DOM_Base_ScriptTimeoutHandlerCache : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mGlobalObject.init(RootingCx(),
+                       SimpleGlobalObject::Create(
+                           SimpleGlobalObject::GlobalType::BindingDetail));
+    ASSERT_TRUE(mGlobalObject);
+    mGlobal = xpc::NativeGlobal(mGlobalObject);
+    ASSERT_TRUE(mGlobal);
+
+    AutoJSAPI jsapi;
+    ASSERT_TRUE(jsapi.Init(mGlobal));
+    JS::CompileOptions options(jsapi.cx());
+    JS::Rooted<JS::Value> rval(jsapi.cx());
+    ASSERT_TRUE(JS::EvaluateUtf8(jsapi.cx(), options, kPrelude,
+                                 strlen(kPrelude), &rval));
+  }
+
+  void TearDown() override {
+    mCache.Clear();
+    mGlobal = nullptr;
+    mGlobalObject.reset();
+  }
+
+  already_AddRefed<ScriptTimeoutHandler> NewHandler(
+      const nsAString& aExpr, ScriptTimeoutHandlerCache* aCache,
+      const char* aFileName = kFileName, uint32_t aLineNo = kLineNo) {
+    AutoJSAPI jsapi;
+    if (!jsapi.Init(mGlobal)) {
+      return nullptr;
+    }
+    RefPtr<ScriptTimeoutHandler> handler = new TestScriptTimeoutHandler(
+        jsapi.cx(), mGlobal, aExpr, aFileName, aLineNo, aCache);
+    return handler.forget();
+  }
+
+  // Registers |aExpr| and fires it once, returning whether it ran to the end.
+  MOZ_CAN_RUN_SCRIPT_BOUNDARY bool FireOnce(const nsAString& aExpr,
+                                            const char* aFileName = kFileName,
+                                            uint32_t aLineNo = kLineNo) {
+    RefPtr<ScriptTimeoutHandler> handler =
+        NewHandler(aExpr, &mCache, aFileName, aLineNo);
+    return handler && handler->Call("setTimeout handler");
+  }
+
+  int32_t GetGlobal(const char* aName) {
+    AutoJSAPI jsapi;
+    if (!jsapi.Init(mGlobal)) {
+      return -1;
+    }
+    JS::Rooted<JS::Value> value(jsapi.cx());
+    if (!JS_GetProperty(jsapi.cx(), mGlobalObject, aName, &value) ||
+        !value.isInt32()) {
+      return -1;
+    }
+    return value.toInt32();
+  }
+
+  MOZ_CAN_RUN_SCRIPT_BOUNDARY void FireIntervals(bool aUseCache) {
+    ScriptTimeoutHandlerCache* cache = aUseCache ? &mCache : nullptr;
+    nsTArray<RefPtr<ScriptTimeoutHandler>> handlers;
+    for (const char16_t* expr : kHandlers) {
+      RefPtr<ScriptTimeoutHandler> handler =
+          NewHandler(nsDependentString(expr), cache);
+      ASSERT_TRUE(handler);
+      handlers.AppendElement(handler);
+    }
+
+    uint64_t hits = mCache.Hits();
+    uint64_t misses = mCache.Misses();
+    for (uint32_t fire = 0; fire < kFiresPerHandler; fire++) {
+      for (const RefPtr<ScriptTimeoutHandler>& handler : handlers) {
+        ASSERT_TRUE(MOZ_KnownLive(handler)->Call("setInterval handler"));
+      }
+    }
+
+    if (aUseCache) {
+      // Only the first run of each handler compiles, unless an earlier
+      // iteration of the benchmark already cached it.
+      ASSERT_LE(mCache.Misses() - misses, std::size(kHandlers));
+      ASSERT_EQ((mCache.Hits() - hits) + (mCache.Misses() - misses),
+                kFiresPerHandler * std::size(kHandlers));
+    } else {
+      ASSERT_EQ(mCache.Hits(), hits);
+      ASSERT_EQ(mCache.Misses(), misses);
+    }
+  }
+
+  JS::PersistentRooted<JSObject*> mGlobalObject;
+  nsCOMPtr<nsIGlobalObject> mGlobal;
+  ScriptTimeoutHandlerCache mCache;
+};
+
+TEST_F(DOM_Base_ScriptTimeoutHandlerCache, ReusesStencilAcrossFires)
+{
+  FireIntervals(true);
+
+  ASSERT_EQ(mCache.Misses(), std::size(kHandlers));
+  ASSERT_EQ(mCache.Hits(), (kFiresPerHandler - 1) * std::size(kHandlers));
+  // The cached stencils ran, not just the first compile.
+  ASSERT_EQ(GetGlobal("tick"), int32_t(kFiresPerHandler));
+  ASSERT_EQ(GetGlobal("counter"), int32_t(kFiresPerHandler));
+}
+
+TEST_F(DOM_Base_ScriptTimeoutHandlerCache, KeyedByTaint)
+{
+  nsString plain(u"tick++"_ns);
+  nsString tainted(u"tick++"_ns);
+  SafeStringTaint taint;
+  taint.append(TaintRange(0, 4, TaintFlow(TaintOperation("location.hash"))));
+  tainted.AssignTaint(taint);
+  ASSERT_TRUE(tainted.isTainted());
+
+  ASSERT_TRUE(FireOnce(plain));
+  ASSERT_TRUE(FireOnce(plain));
+  ASSERT_EQ(mCache.Hits(), 1u);
+  ASSERT_EQ(mCache.Misses(), 1u);
+
+  // The same source with taint, or from another location, is compiled anew.
+  ASSERT_TRUE(FireOnce(tainted));
+  ASSERT_TRUE(FireOnce(plain, "other.js"));
+  ASSERT_TRUE(FireOnce(plain, kFileName, kLineNo + 1));
+  ASSERT_EQ(mCache.Hits(), 1u);
+  ASSERT_EQ(mCache.Misses(), 4u);
+  ASSERT_EQ(GetGlobal("tick"), 5);
+}
+
+TEST_F(DOM_Base_ScriptTimeoutHandlerCache, EvictsLeastRecentlyUsed)
+{
+  for (uint32_t i = 0; i < ScriptTimeoutHandlerCache::kMaxEntries; i++) {
+    nsString expr;
+    expr.AppendInt(i);
+    ASSERT_TRUE(FireOnce(expr));
+  }
+
+  // Fire the oldest handler again so that "1" is evicted instead.
+  ASSERT_TRUE(FireOnce(u"0"_ns));
+  ASSERT_TRUE(FireOnce(u"tick++"_ns));
+  ASSERT_EQ(mCache.Length(), ScriptTimeoutHandlerCache::kMaxEntries);
+
+  uint64_t misses = mCache.Misses();
+  ASSERT_TRUE(FireOnce(u"0"_ns));
+  ASSERT_EQ(mCache.Misses(), misses);
+  ASSERT_TRUE(FireOnce(u"1"_ns));
+  ASSERT_EQ(mCache.Misses(), misses + 1);
+}
+
+TEST_F(DOM_Base_ScriptTimeoutHandlerCache, SkipsLongHandlers)
+{
+  nsString expr;
+  while (expr.Length() <= ScriptTimeoutHandlerCache::kMaxExpressionLength) {
+    expr.AppendLiteral("tick++;");
+  }
+
+  ASSERT_TRUE(FireOnce(expr));
+  ASSERT_TRUE(FireOnce(expr));
+  ASSERT_EQ(mCache.Length(), 0u);
+  ASSERT_EQ(mCache.Hits(), 0u);
+}
+
+MOZ_GTEST_BENCH_F(DOM_Base_ScriptTimeoutHandlerCache, IntervalsUncached,
+                  [this] { FireIntervals(false); });
+MOZ_GTEST_BENCH_F(DOM_Base_ScriptTimeoutHandlerCache, IntervalsCached,
+                  [this] { FireIntervals(true); });
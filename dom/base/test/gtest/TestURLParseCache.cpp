@@ -0,0 +1,159 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include "Taint.h"
+#include "mozilla/ErrorResult.h"
+#include "mozilla/dom/BindingDeclarations.h"
+#include "mozilla/dom/ScriptSettings.h"
+#include "mozilla/dom/SimpleGlobalObject.h"
+#include "mozilla/dom/URL.h"
+#include "mozilla/dom/URLParseCache.h"
+#include "nsIGlobalObject.h"
+#include "nsString.h"
+
+using namespace mozilla;
+using namespace mozilla::dom;
+
+static const char16_t kBase[] = u"https://example.com/app/";
+
+static already_AddRefed<URL> NewURL(const GlobalObject& aGlobal,
+                                    const nsAString& aInput,
+                                    const char16_t* aBase) {
+  Optional<nsAString> base;
+  nsDependentString baseStr;
+  if (aBase) {
+    baseStr.Rebind(aBase);
+    base = &baseStr;
+  }
+  ErrorResult rv;
+  RefPtr<URL> url = URL::Constructor(aGlobal, aInput, base, rv);
+  rv.SuppressException();
+  return url.forget();
+}
+
+static void ConstructURLs(bool aUseCache) {
+  JS::Rooted<JSObject*> global(
+      RootingCx(), SimpleGlobalObject::Create(
+                       SimpleGlobalObject::GlobalType::BindingDetail));
+  AutoJSAPI jsapi;
+  ASSERT_TRUE(jsapi.Init(global));
+  GlobalObject globalObject(jsapi.cx(), global);
+  nsCOMPtr<nsIGlobalObject> native =
+      do_QueryInterface(globalObject.GetAsSupports());
+  URLParseCache& cache = native->GetURLParseCache();
+
+  // A router resolving a handful of routes against the page URL.
+  static const char16_t* const kRoutes[] = {
+      u"/", u"/search?q=shoes&page=2", u"../settings#privacy",
+      u"items/1234?ref=home", u"https://cdn.example.com/img/logo.png"};
+  for (int i = 0; i < 2000; i++) {
+    for (const char16_t* route : kRoutes) {
+      if (!aUseCache) {
+        cache.Clear();
+      }
+      RefPtr<URL> url = NewURL(globalObject, nsDependentString(route), kBase);
+      ASSERT_TRUE(url);
+    }
+  }
+}
+
+TEST(DOM_Base_URLParseCache, SharesParsedURIs)
+{
+  JS::Rooted<JSObject*> global(
+      RootingCx(), SimpleGlobalObject::Create(
+                       SimpleGlobalObject::GlobalType::BindingDetail));
+  AutoJSAPI jsapi;
+  ASSERT_TRUE(jsapi.Init(global));
+  GlobalObject globalObject(jsapi.cx(), global);
+  nsCOMPtr<nsIGlobalObject> native =
+      do_QueryInterface(globalObject.GetAsSupports());
+  ASSERT_TRUE(native);
+  URLParseCache& cache = native->GetURLParseCache();
+  cache.Clear();
+
+  RefPtr<URL> first = NewURL(globalObject, u"page?q=1"_ns, kBase);
+  RefPtr<URL> second = NewURL(globalObject, u"page?q=1"_ns, kBase);
+  ASSERT_TRUE(first && second);
+  EXPECT_EQ(cache.Misses(), 1u);
+  EXPECT_EQ(cache.Hits(), 1u);
+  EXPECT_EQ(first->URI(), second->URI());
+
+  nsAutoString href;
+  second->GetHref(href);
+  EXPECT_TRUE(href.EqualsLiteral("https://example.com/app/page?q=1"));
+
+  // Setters replace the URI of their URL only.
+  second->SetSearch(u"?q=2"_ns);
+  first->GetHref(href);
+  EXPECT_TRUE(href.EqualsLiteral("https://example.com/app/page?q=1"));
+  RefPtr<URL> third = NewURL(globalObject, u"page?q=1"_ns, kBase);
+  third->GetHref(href);
+  EXPECT_TRUE(href.EqualsLiteral("https://example.com/app/page?q=1"));
+  EXPECT_EQ(cache.Hits(), 2u);
+
+  // Other bases, and no base, are cached separately.
+  RefPtr<URL> other =
+      NewURL(globalObject, u"page?q=1"_ns, u"https://example.org/");
+  other->GetHref(href);
+  EXPECT_TRUE(href.EqualsLiteral("https://example.org/page?q=1"));
+  RefPtr<URL> absolute =
+      NewURL(globalObject, u"https://example.com/app/page?q=1"_ns, nullptr);
+  ASSERT_TRUE(absolute);
+  EXPECT_EQ(cache.Hits(), 2u);
+  EXPECT_EQ(cache.Misses(), 3u);
+
+  // Invalid URLs still throw, every time.
+  EXPECT_FALSE(NewURL(globalObject, u"no scheme"_ns, nullptr));
+  EXPECT_FALSE(NewURL(globalObject, u"no scheme"_ns, nullptr));
+  EXPECT_EQ(cache.Length(), 3u);
+}
+
+TEST(DOM_Base_URLParseCache, TaintedInputs)
+{
+  JS::Rooted<JSObject*> global(
+      RootingCx(), SimpleGlobalObject::Create(
+                       SimpleGlobalObject::GlobalType::BindingDetail));
+  AutoJSAPI jsapi;
+  ASSERT_TRUE(jsapi.Init(global));
+  GlobalObject globalObject(jsapi.cx(), global);
+  nsCOMPtr<nsIGlobalObject> native =
+      do_QueryInterface(globalObject.GetAsSupports());
+  URLParseCache& cache = native->GetURLParseCache();
+  cache.Clear();
+
+  nsString plain(u"page?q=1"_ns);
+  nsString tainted(u"page?q=1"_ns);
+  SafeStringTaint taint;
+  taint.append(TaintRange(5, 8, TaintFlow(TaintOperation("location.hash"))));
+  tainted.AssignTaint(taint);
+
+  RefPtr<URL> url = NewURL(globalObject, plain, kBase);
+  ASSERT_TRUE(url);
+  for (int i = 0; i < 2; i++) {
+    url = NewURL(globalObject, tainted, kBase);
+    ASSERT_TRUE(url);
+    nsAutoString href;
+    url->GetHref(href);
+    EXPECT_TRUE(href.EqualsLiteral("https://example.com/app/page?q=1"));
+    EXPECT_TRUE(href.IsTainted());
+  }
+  EXPECT_EQ(cache.Hits(), 0u);
+  EXPECT_EQ(cache.Length(), 1u);
+
+  url = NewURL(globalObject, plain, kBase);
+  nsAutoString href;
+  url->GetHref(href);
+  EXPECT_FALSE(href.IsTainted());
+  EXPECT_EQ(cache.Hits(), 1u);
+}
+
+MOZ_GTEST_BENCH(DOM_Base_URLParseCache, RoutesUncached,
+                [] { ConstructURLs(false); });
+MOZ_GTEST_BENCH(DOM_Base_URLParseCache, RoutesCached,
+                [] { ConstructURLs(true); });
@@ -6,10 +6,12 @@
 
 #include "mozilla/dom/TextDecoder.h"
 #include "mozilla/dom/UnionTypes.h"
+#include "jsapi.h"
 #include "mozilla/Encoding.h"
 #include "mozilla/UniquePtrExtensions.h"
 #include "nsContentUtils.h"
 
+#include <algorithm>
 #include <stdint.h>
 
 namespace mozilla::dom {
@@ -44,10 +46,40 @@ void TextDecoder::InitWithEncoding(NotNull<const Encoding*> aEncoding,
   }
 }
 
+bool TextDecoderCommon::DecodeChunk(Span<const uint8_t> aInput,
+                                    Span<char16_t> aOutput, bool aLast,
+                                    size_t& aWritten, ErrorResult& aRv) {
+  uint32_t result;
+  size_t read;
+  if (mFatal) {
+    std::tie(result, read, aWritten) =
+        mDecoder->DecodeToUTF16WithoutReplacement(aInput, aOutput, aLast);
+    if (result != kInputEmpty) {
+      aRv.ThrowTypeError<MSG_DOM_DECODING_FAILED>();
+      return false;
+    }
+  } else {
+    std::tie(result, read, aWritten, std::ignore) =
+        mDecoder->DecodeToUTF16(aInput, aOutput, aLast);
+  }
+  MOZ_ASSERT(result == kInputEmpty);
+  MOZ_ASSERT(read == aInput.Length());
+  MOZ_ASSERT(aWritten <= aOutput.Length());
+  return true;
+}
+
 void TextDecoderCommon::DecodeNative(Span<const uint8_t> aInput,
                                      const bool aStream,
                                      nsAString& aOutDecodedString,
                                      ErrorResult& aRv) {
+  DecodeNative(aInput, EmptyTaint, aStream, aOutDecodedString, aRv);
+}
+
+void TextDecoderCommon::DecodeNative(Span<const uint8_t> aInput,
+                                     const StringTaint& aInputTaint,
+                                     const bool aStream,
+                                     nsAString& aOutDecodedString,
+                                     ErrorResult& aRv) {
   aOutDecodedString.Truncate();
 
   CheckedInt<nsAString::size_type> needed =
@@ -63,29 +95,60 @@ void TextDecoderCommon::DecodeNative(Span<const uint8_t> aInput,
     return;
   }
 
-  uint32_t result;
-  size_t read;
-  size_t written;
-  if (mFatal) {
-    std::tie(result, read, written) =
-        mDecoder->DecodeToUTF16WithoutReplacement(aInput, *output, !aStream);
-    if (result != kInputEmpty) {
-      aRv.ThrowTypeError<MSG_DOM_DECODING_FAILED>();
+  size_t written = 0;
+  SafeStringTaint outputTaint;
+  if (!aInputTaint.hasTaint() || aInput.IsEmpty()) {
+    if (!DecodeChunk(aInput, *output, !aStream, written, aRv)) {
       return;
     }
   } else {
-    std::tie(result, read, written, std::ignore) =
-        mDecoder->DecodeToUTF16(aInput, *output, !aStream);
+    // TaintFox: decode the input in chunks of uniform taint, so that the
+    // output offsets of every tainted chunk are known. Streaming decoders
+    // keep incomplete sequences across chunks, so this yields the same
+    // characters as a single call.
+    size_t position = 0;
+    auto range = aInputTaint.begin();
+    while (position < aInput.Length()) {
+      while (range != aInputTaint.end() && range->end() <= position) {
+        ++range;
+      }
+
+      size_t chunkEnd = aInput.Length();
+      const TaintFlow* flow = nullptr;
+      if (range != aInputTaint.end()) {
+        if (range->begin() > position) {
+          chunkEnd = std::min<size_t>(range->begin(), chunkEnd);
+        } else {
+          chunkEnd = std::min<size_t>(range->end(), chunkEnd);
+          flow = &range->flow();
+        }
+      }
+
+      bool last = !aStream && chunkEnd == aInput.Length();
+      size_t chunkWritten;
+      if (!DecodeChunk(aInput.FromTo(position, chunkEnd),
+                       output->From(written), last, chunkWritten, aRv)) {
+        return;
+      }
+      if (flow && chunkWritten) {
+        outputTaint.append(
+            TaintRange(written, written + chunkWritten, *flow));
+      }
+      written += chunkWritten;
+      position = chunkEnd;
+    }
   }
-  MOZ_ASSERT(result == kInputEmpty);
-  MOZ_ASSERT(read == aInput.Length());
-  MOZ_ASSERT(written <= aOutDecodedString.Length());
 
   if (!aOutDecodedString.SetLength(written, fallible)) {
     aRv.Throw(NS_ERROR_OUT_OF_MEMORY);
     return;
   }
 
+  if (outputTaint.hasTaint()) {
+    aOutDecodedString.AssignTaint(outputTaint);
+    aOutDecodedString.Taint().extend(TaintOperation("TextDecoder.decode", true));
+  }
+
   // If the internal streaming flag of the decoder object is not set,
   // then reset the encoding algorithm state to the default values
   if (!aStream) {
@@ -107,17 +170,24 @@ void TextDecoder::Decode(const Optional<ArrayBufferViewOrArrayBuffer>& aBuffer,
   const ArrayBufferViewOrArrayBuffer& buf = aBuffer.Value();
   uint8_t* data;
   uint32_t length;
+  JSObject* obj;
   if (buf.IsArrayBufferView()) {
     buf.GetAsArrayBufferView().ComputeState();
     data = buf.GetAsArrayBufferView().Data();
     length = buf.GetAsArrayBufferView().Length();
+    obj = buf.GetAsArrayBufferView().Obj();
   } else {
     MOZ_ASSERT(buf.IsArrayBuffer());
     buf.GetAsArrayBuffer().ComputeState();
     data = buf.GetAsArrayBuffer().Data();
     length = buf.GetAsArrayBuffer().Length();
+    obj = buf.GetAsArrayBuffer().Obj();
   }
-  DecodeNative(Span(data, length), aOptions.mStream, aOutDecodedString, aRv);
+
+  // TaintFox: propagate byte taint of the input buffer.
+  SafeStringTaint taint = JS_GetArrayBufferOrViewTaint(obj);
+  DecodeNative(Span(data, length), taint, aOptions.mStream, aOutDecodedString,
+               aRv);
 }
 
 void TextDecoderCommon::GetEncoding(nsAString& aEncoding) {
@@ -39,6 +39,20 @@ class TextDecoderCommon {
   void DecodeNative(mozilla::Span<const uint8_t> aInput, const bool aStream,
                     nsAString& aOutDecodedString, ErrorResult& aRv);
 
+  /**
+   * TaintFox: as above, but also propagates the byte granular taint
+   * information of the input to the decoded string.
+   *
+   * Tainted input is decoded in chunks split at taint range boundaries, so
+   * every decoded character is tainted with the flow of the byte which
+   * completed it. Untainted input takes the same path as above.
+   *
+   * @param      aInputTaint, taint information of aInput, indexed by byte.
+   */
+  void DecodeNative(mozilla::Span<const uint8_t> aInput,
+                    const StringTaint& aInputTaint, const bool aStream,
+                    nsAString& aOutDecodedString, ErrorResult& aRv);
+
   /**
    * Return the encoding name.
    *
@@ -51,6 +65,12 @@ class TextDecoderCommon {
   bool IgnoreBOM() const { return mIgnoreBOM; }
 
  protected:
+  // Decodes aInput into aOutput, which must be large enough to hold the
+  // result. Returns false and throws on decoding errors in fatal mode.
+  bool DecodeChunk(mozilla::Span<const uint8_t> aInput,
+                   mozilla::Span<char16_t> aOutput, bool aLast,
+                   size_t& aWritten, ErrorResult& aRv);
+
   mozilla::UniquePtr<mozilla::Decoder> mDecoder;
   nsCString mEncoding;
   bool mFatal = false;
@@ -8,6 +8,7 @@
 #include "mozilla/CheckedInt.h"
 #include "mozilla/ErrorResult.h"
 #include "mozilla/UniquePtrExtensions.h"
+#include "jsapi.h"
 #include "nsReadableUtils.h"
 
 namespace mozilla::dom {
@@ -17,12 +18,24 @@ void TextEncoder::Encode(JSContext* aCx, JS::Handle<JSObject*> aObj,
                          JS::MutableHandle<JSObject*> aRetval,
                          OOMReporter& aRv) {
   JSAutoRealm ar(aCx, aObj);
-  JSObject* outView = Uint8Array::Create(aCx, aUtf8String);
+  JS::Rooted<JSObject*> outView(aCx, Uint8Array::Create(aCx, aUtf8String));
   if (!outView) {
     aRv.ReportOOM();
     return;
   }
 
+  // TaintFox: the encoded string carries byte granular taint, see
+  // AssignJSString. Move it into the array buffer.
+  if (aUtf8String.isTainted()) {
+    SafeStringTaint taint(aUtf8String.Taint());
+    taint.extend(TaintOperation("TextEncoder.encode", true));
+    if (!JS_SetArrayBufferOrViewTaint(aCx, outView, taint)) {
+      JS_ClearPendingException(aCx);
+      aRv.ReportOOM();
+      return;
+    }
+  }
+
   aRetval.set(outView);
 }
 
@@ -41,6 +54,24 @@ void TextEncoder::EncodeInto(JSContext* aCx, JS::Handle<JSString*> aSrc,
   }
   Tie(read, written) = *maybe;
   MOZ_ASSERT(written <= aDst.Length());
+
+  // TaintFox: replace the taint of the written bytes.
+  const StringTaint& srcTaint = JS_GetStringTaint(aSrc);
+  SafeStringTaint taint = JS_GetArrayBufferOrViewTaint(aDst.Obj());
+  if (MOZ_UNLIKELY(srcTaint.hasTaint() || taint.hasTaint())) {
+    SafeStringTaint writtenTaint = TaintToUtf8(
+        srcTaint, reinterpret_cast<const char*>(aDst.Data()), written);
+    writtenTaint.extend(TaintOperation("TextEncoder.encodeInto", true));
+    taint.clearBetween(0, written);
+    taint.insert(0, writtenTaint);
+
+    JS::Rooted<JSObject*> dst(aCx, aDst.Obj());
+    if (!JS_SetArrayBufferOrViewTaint(aCx, dst, taint)) {
+      JS_ClearPendingException(aCx);
+      aError.ReportOOM();
+      return;
+    }
+  }
   aResult.mRead.Construct() = read;
   aResult.mWritten.Construct() = written;
 }
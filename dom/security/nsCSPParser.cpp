@@ -5,19 +5,28 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "mozilla/ArrayUtils.h"
+#include "mozilla/ClearOnShutdown.h"
+#include "mozilla/LinkedList.h"
+#include "mozilla/Maybe.h"
 #include "mozilla/TextUtils.h"
 #include "mozilla/dom/Document.h"
 #include "mozilla/Preferences.h"
 #include "mozilla/StaticPrefs_security.h"
+#include "mozilla/StaticPtr.h"
+#include "mozilla/UniquePtr.h"
+#include "nsClassHashtable.h"
 #include "nsCOMPtr.h"
 #include "nsContentUtils.h"
 #include "nsCSPParser.h"
 #include "nsCSPUtils.h"
+#include "nsIMemoryReporter.h"
 #include "nsIScriptError.h"
 #include "nsNetUtil.h"
 #include "nsReadableUtils.h"
 #include "nsServiceManagerUtils.h"
 #include "nsUnicharUtils.h"
+#include "nsURLHelper.h"
+#include "prenv.h"
 
 using namespace mozilla;
 using namespace mozilla::dom;
@@ -37,8 +46,6 @@ static const uint32_t kSubHostPathCharacterCutoff = 512;
 static const char* const kHashSourceValidFns[] = {"sha256", "sha384", "sha512"};
 static const uint32_t kHashSourceValidFnsLen = 3;
 
-/* ===== nsCSPParser ==================== */
-
 nsCSPParser::nsCSPParser(policyTokens& aTokens, nsIURI* aSelfURI,
                          nsCSPContext* aCSPContext, bool aDeliveredViaMetaTag,
                          bool aSuppressLogMessages)
@@ -59,7 +66,10 @@ nsCSPParser::nsCSPParser(policyTokens& aTokens, nsIURI* aSelfURI,
       mPolicy(nullptr),
       mCSPContext(aCSPContext),
       mDeliveredViaMetaTag(aDeliveredViaMetaTag),
-      mSuppressLogMessages(aSuppressLogMessages) {
+      mSuppressLogMessages(aSuppressLogMessages),
+      mCacheable(true),
+      mSawUnsafeInline(false),
+      mSawUnsafeEval(false) {
   CSPPARSERLOG(("nsCSPParser::nsCSPParser"));
 }
 
@@ -164,6 +174,9 @@ void nsCSPParser::logWarningErrorToConsole(uint32_t aSeverityFlag,
                                            const nsTArray<nsString>& aParams) {
   CSPPARSERLOG(("nsCSPParser::logWarningErrorToConsole: %s", aProperty));
 
+  // Later users of a cached copy of this policy would not see the message.
+  mCacheable = false;
+
   if (mSuppressLogMessages) {
     return;
   }
@@ -426,6 +439,7 @@ nsCSPBaseSrc* nsCSPParser::keywordSource() {
   }
 
   if (CSP_IsKeyword(mCurToken, CSP_UNSAFE_INLINE)) {
+    mSawUnsafeInline = true;
     nsWeakPtr ctx = mCSPContext->GetLoadingContext();
     nsCOMPtr<Document> doc = do_QueryReferent(ctx);
     if (doc) {
@@ -447,6 +461,7 @@ nsCSPBaseSrc* nsCSPParser::keywordSource() {
   }
 
   if (CSP_IsKeyword(mCurToken, CSP_UNSAFE_EVAL)) {
+    mSawUnsafeEval = true;
     nsWeakPtr ctx = mCSPContext->GetLoadingContext();
     nsCOMPtr<Document> doc = do_QueryReferent(ctx);
     if (doc) {
@@ -773,6 +788,13 @@ void nsCSPParser::reportURIList(nsCSPDirective* aDir) {
                   NS_ConvertUTF16toUTF8(mCurToken).get(),
                   NS_ConvertUTF16toUTF8(mCurValue).get()));
 
+    // Path relative report URIs depend on more than the origin of mSelfURI,
+    // which is all that the policy cache is keyed by.
+    if (!StringBeginsWith(mCurToken, u"/"_ns) &&
+        !net_IsAbsoluteURL(NS_ConvertUTF16toUTF8(mCurToken))) {
+      mCacheable = false;
+    }
+
     rv = NS_NewURI(getter_AddRefs(uri), mCurToken, "", mSelfURI);
 
     // If creating the URI casued an error, skip this URI
@@ -1224,6 +1246,197 @@ nsCSPPolicy* nsCSPParser::policy() {
   return mPolicy;
 }
 
+/* ===== Parsed policy cache ==================== */
+
+namespace {
+
+// Reports the memory held by CSPPolicyCache. Memory reports are collected on
+// the main thread, like every other use of the cache.
+class CSPPolicyCacheReporter final : public nsIMemoryReporter {
+  ~CSPPolicyCacheReporter() = default;
+
+ public:
+  NS_DECL_ISUPPORTS
+  NS_DECL_NSIMEMORYREPORTER
+};
+
+// Parsed policies by policy string, self origin and parser flags, in least
+// recently used order. Only used on the main thread, where documents parse
+// their policies.
+class CSPPolicyCache final {
+ public:
+  struct Entry final : public LinkedListElement<Entry> {
+    // Shares its buffer with the hashtable key.
+    nsString mKey;
+    RefPtr<nsCSPPolicy::SharedDirectives> mDirectives;
+    bool mSawUnsafeInline = false;
+    bool mSawUnsafeEval = false;
+  };
+
+  static const uint32_t kMaxEntries = 64;
+  // Longer policies are rare, and not worth the memory they would pin.
+  static const uint32_t kMaxPolicyLength = 16 * 1024;
+
+  static bool Enabled() {
+    if (sEnabled.isNothing()) {
+      const char* env = PR_GetEnv("MOZ_CSP_POLICY_CACHE");
+      sEnabled = Some(!env || strcmp(env, "0") != 0);
+    }
+    return *sEnabled;
+  }
+
+  // Builds the cache key for a policy, or returns false if the policy should
+  // not be cached.
+  static bool ComputeKey(const nsAString& aPolicyString, nsIURI* aSelfURI,
+                         bool aDeliveredViaMetaTag, nsAString& aKey) {
+    if (!NS_IsMainThread() || !Enabled() ||
+        aPolicyString.Length() > kMaxPolicyLength) {
+      return false;
+    }
+    nsAutoCString origin;
+    if (NS_FAILED(aSelfURI->GetPrePath(origin))) {
+      return false;
+    }
+    // Everything besides the policy string and the self URI which the parser
+    // depends on.
+    uint32_t flags =
+        (aDeliveredViaMetaTag ? 1 << 0 : 0) |
+        (StaticPrefs::security_csp_wasm_unsafe_eval_enabled() ? 1 << 1 : 0) |
+        (StaticPrefs::security_csp_unsafe_hashes_enabled() ? 1 << 2 : 0) |
+        (StaticPrefs::security_csp_script_src_attr_elem_enabled() ? 1 << 3
+                                                                   : 0) |
+        (StaticPrefs::security_csp_style_src_attr_elem_enabled() ? 1 << 4
+                                                                  : 0) |
+        (StaticPrefs::security_csp_enableNavigateTo() ? 1 << 5 : 0);
+    aKey.Truncate();
+    aKey.AppendInt(flags);
+    aKey.Append(' ');
+    AppendUTF8toUTF16(origin, aKey);
+    aKey.Append(' ');
+    aKey.Append(aPolicyString);
+    return true;
+  }
+
+  static const Entry* Get(const nsAString& aKey) {
+    if (!sCache) {
+      return nullptr;
+    }
+    Entry* entry = sCache->mEntries.Get(aKey);
+    if (!entry) {
+      sStats.mMisses++;
+      return nullptr;
+    }
+    sStats.mHits++;
+    entry->remove();
+    sCache->mLRU.insertFront(entry);
+    return entry;
+  }
+
+  static void Put(const nsAString& aKey, nsCSPPolicy* aPolicy,
+                  bool aSawUnsafeInline, bool aSawUnsafeEval) {
+    if (!sCache) {
+      sCache = new Cache();
+      ClearOnShutdown(&sCache);
+      if (!sReporterRegistered) {
+        sReporterRegistered = true;
+        RegisterStrongMemoryReporter(new CSPPolicyCacheReporter());
+      }
+    }
+    if (sCache->mEntries.Count() >= kMaxEntries) {
+      nsString oldest = sCache->mLRU.getLast()->mKey;
+      sCache->mEntries.Remove(oldest);
+    }
+    auto entry = MakeUnique<Entry>();
+    entry->mKey = aKey;
+    entry->mDirectives = aPolicy->shareDirectives();
+    entry->mSawUnsafeInline = aSawUnsafeInline;
+    entry->mSawUnsafeEval = aSawUnsafeEval;
+    sCache->mLRU.insertFront(entry.get());
+    sCache->mEntries.InsertOrUpdate(aKey, std::move(entry));
+  }
+
+  static void Clear() { sCache = nullptr; }
+
+  static nsCSPParser::PolicyCacheStats Stats() {
+    nsCSPParser::PolicyCacheStats stats = sStats;
+    stats.mEntries = sCache ? sCache->mEntries.Count() : 0;
+    return stats;
+  }
+
+  static size_t SizeOfIncludingThis(MallocSizeOf aMallocSizeOf) {
+    if (!sCache) {
+      return 0;
+    }
+    size_t n = aMallocSizeOf(sCache.get()) +
+               sCache->mEntries.ShallowSizeOfExcludingThis(aMallocSizeOf);
+    for (const Entry* entry : sCache->mLRU) {
+      // The key buffer is shared with the hashtable, so count it once here.
+      n += aMallocSizeOf(entry) +
+           entry->mKey.SizeOfExcludingThisEvenIfShared(aMallocSizeOf) +
+           entry->mDirectives->SizeOfIncludingThis(aMallocSizeOf);
+    }
+    return n;
+  }
+
+  static Maybe<bool> sEnabled;
+  static nsCSPParser::PolicyCacheStats sStats;
+
+ private:
+  struct Cache {
+    // Entries remove themselves from mLRU when they are destroyed.
+    LinkedList<Entry> mLRU;
+    nsClassHashtable<nsStringHashKey, Entry> mEntries;
+  };
+
+  static StaticAutoPtr<Cache> sCache;
+  static bool sReporterRegistered;
+};
+
+Maybe<bool> CSPPolicyCache::sEnabled;
+nsCSPParser::PolicyCacheStats CSPPolicyCache::sStats;
+StaticAutoPtr<CSPPolicyCache::Cache> CSPPolicyCache::sCache;
+bool CSPPolicyCache::sReporterRegistered = false;
+
+MOZ_DEFINE_MALLOC_SIZE_OF(CSPPolicyCacheMallocSizeOf)
+
+NS_IMETHODIMP
+CSPPolicyCacheReporter::CollectReports(nsIHandleReportCallback* aHandleReport,
+                                       nsISupports* aData, bool aAnonymize) {
+  MOZ_COLLECT_REPORT(
+      "explicit/csp/policy-cache", KIND_HEAP, UNITS_BYTES,
+      CSPPolicyCache::SizeOfIncludingThis(CSPPolicyCacheMallocSizeOf),
+      "Memory used for the parsed CSP policies cached by policy string.");
+  return NS_OK;
+}
+
+NS_IMPL_ISUPPORTS(CSPPolicyCacheReporter, nsIMemoryReporter)
+
+}  // namespace
+
+/* static */
+nsCSPParser::PolicyCacheStats nsCSPParser::GetPolicyCacheStats() {
+  MOZ_ASSERT(NS_IsMainThread());
+  return CSPPolicyCache::Stats();
+}
+
+/* static */
+void nsCSPParser::SetPolicyCacheEnabled(bool aEnabled) {
+  MOZ_ASSERT(NS_IsMainThread());
+  CSPPolicyCache::sEnabled = Some(aEnabled);
+  if (!aEnabled) {
+    CSPPolicyCache::Clear();
+  }
+}
+
+/* static */
+void nsCSPParser::ClearPolicyCache() {
+  MOZ_ASSERT(NS_IsMainThread());
+  CSPPolicyCache::Clear();
+  CSPPolicyCache::sStats = PolicyCacheStats();
+}
+
+/* ===== nsCSPParser ==================== */
+
 nsCSPPolicy* nsCSPParser::parseContentSecurityPolicy(
     const nsAString& aPolicyString, nsIURI* aSelfURI, bool aReportOnly,
     nsCSPContext* aCSPContext, bool aDeliveredViaMetaTag,
@@ -1242,19 +1455,51 @@ nsCSPPolicy* nsCSPParser::parseContentSecurityPolicy(
 
   NS_ASSERTION(aSelfURI, "Can not parseContentSecurityPolicy without aSelfURI");
 
-  // Separate all input into tokens and store them in the form of:
-  // [ [ name, src, src, ... ], [ name, src, src, ... ], ... ]
-  // The tokenizer itself can not fail; all eventual errors
-  // are detected in the parser itself.
+  nsCSPPolicy* policy = nullptr;
+  nsAutoString cacheKey;
+  bool useCache = CSPPolicyCache::ComputeKey(aPolicyString, aSelfURI,
+                                             aDeliveredViaMetaTag, cacheKey);
+  if (useCache) {
+    if (const auto* entry = CSPPolicyCache::Get(cacheKey)) {
+      CSPPARSERLOG(("nsCSPParser::parseContentSecurityPolicy, cache hit"));
+      policy = new nsCSPPolicy(entry->mDirectives);
+      // Replay what the parser would have recorded on the document.
+      nsCOMPtr<Document> doc =
+          do_QueryReferent(aCSPContext->GetLoadingContext());
+      if (doc && entry->mSawUnsafeInline) {
+        doc->SetHasUnsafeInlineCSP(true);
+      }
+      if (doc && entry->mSawUnsafeEval) {
+        doc->SetHasUnsafeEvalCSP(true);
+      }
+    }
+  }
 
-  nsTArray<CopyableTArray<nsString> > tokens;
-  PolicyTokenizer::tokenizePolicy(aPolicyString, tokens);
+  if (!policy) {
+    // Separate all input into tokens and store them in the form of:
+    // [ [ name, src, src, ... ], [ name, src, src, ... ], ... ]
+    // The tokenizer itself can not fail; all eventual errors
+    // are detected in the parser itself.
 
-  nsCSPParser parser(tokens, aSelfURI, aCSPContext, aDeliveredViaMetaTag,
-                     aSuppressLogMessages);
+    nsTArray<CopyableTArray<nsString> > tokens;
+    PolicyTokenizer::tokenizePolicy(aPolicyString, tokens);
 
-  // Start the parser to generate a new CSPPolicy using the generated tokens.
-  nsCSPPolicy* policy = parser.policy();
+    nsCSPParser parser(tokens, aSelfURI, aCSPContext, aDeliveredViaMetaTag,
+                       aSuppressLogMessages);
+
+    // Start the parser to generate a new CSPPolicy using the generated
+    // tokens.
+    policy = parser.policy();
+
+    if (useCache) {
+      if (parser.mCacheable) {
+        CSPPolicyCache::Put(cacheKey, policy, parser.mSawUnsafeInline,
+                            parser.mSawUnsafeEval);
+      } else {
+        CSPPolicyCache::sStats.mUncacheable++;
+      }
+    }
+  }
 
   // Check that report-only policies define a report-uri, otherwise log warning.
   if (aReportOnly) {
@@ -1265,8 +1510,14 @@ nsCSPPolicy* nsCSPParser::parseContentSecurityPolicy(
       NS_ENSURE_SUCCESS(rv, policy);
       AutoTArray<nsString, 1> params;
       CopyUTF8toUTF16(prePath, *params.AppendElement());
-      parser.logWarningErrorToConsole(nsIScriptError::warningFlag,
-                                      "reportURInotInReportOnlyHeader", params);
+      if (!aSuppressLogMessages) {
+        aCSPContext->logToConsole("reportURInotInReportOnlyHeader", params,
+                                  u""_ns,  // aSourceName
+                                  u""_ns,  // aSourceLine
+                                  0,       // aLineNumber
+                                  0,       // aColumnNumber
+                                  nsIScriptError::warningFlag);
+      }
     }
   }
 
@@ -56,6 +56,25 @@ class nsCSPParser {
                                                  bool aDeliveredViaMetaTag,
                                                  bool aSuppressLogMessages);
 
+  /**
+   * Policies which parse without any console messages are kept in a small
+   * cache keyed by the policy string, the origin of the self URI and the
+   * parser flags, so that documents and workers which receive the same
+   * header share one parsed copy of its directives instead of parsing it
+   * again. The cache can be disabled by setting MOZ_CSP_POLICY_CACHE=0 in
+   * the environment.
+   */
+  struct PolicyCacheStats {
+    uint32_t mHits = 0;
+    uint32_t mMisses = 0;
+    // Parses which could not be cached, e.g. because they logged warnings.
+    uint32_t mUncacheable = 0;
+    uint32_t mEntries = 0;
+  };
+  static PolicyCacheStats GetPolicyCacheStats();
+  static void SetPolicyCacheEnabled(bool aEnabled);
+  static void ClearPolicyCache();
+
  private:
   nsCSPParser(policyTokens& aTokens, nsIURI* aSelfURI,
               nsCSPContext* aCSPContext, bool aDeliveredViaMetaTag,
@@ -212,6 +231,15 @@ class nsCSPParser {
   nsCSPContext* mCSPContext;  // used for console logging
   bool mDeliveredViaMetaTag;
   bool mSuppressLogMessages;
+
+  // Cleared if the parsed policy depends on more than the policy string, the
+  // origin of mSelfURI and the parser flags, or if parsing logged messages,
+  // which would be lost for later users of a cached policy.
+  bool mCacheable;
+  // Whether 'unsafe-inline' or 'unsafe-eval' were seen, which is recorded on
+  // the document even when the policy comes from the cache.
+  bool mSawUnsafeInline;
+  bool mSawUnsafeEval;
 };
 
 #endif /* nsCSPParser_h___ */
@@ -1385,14 +1385,50 @@ nsCSPPolicy::nsCSPPolicy()
   CSPUTILSLOG(("nsCSPPolicy::nsCSPPolicy"));
 }
 
+nsCSPPolicy::nsCSPPolicy(SharedDirectives* aDirectives)
+    : mUpgradeInsecDir(aDirectives->mUpgradeInsecDir),
+      mDirectives(aDirectives->mDirectives.Clone()),
+      mSharedDirectives(aDirectives),
+      mReportOnly(false),
+      mDeliveredViaMetaTag(false) {
+  CSPUTILSLOG(("nsCSPPolicy::nsCSPPolicy (shared)"));
+}
+
 nsCSPPolicy::~nsCSPPolicy() {
   CSPUTILSLOG(("nsCSPPolicy::~nsCSPPolicy"));
 
+  if (mSharedDirectives) {
+    return;
+  }
+  for (uint32_t i = 0; i < mDirectives.Length(); i++) {
+    delete mDirectives[i];
+  }
+}
+
+already_AddRefed<nsCSPPolicy::SharedDirectives>
+nsCSPPolicy::shareDirectives() {
+  if (!mSharedDirectives) {
+    mSharedDirectives =
+        new SharedDirectives(mDirectives.Clone(), mUpgradeInsecDir);
+  }
+  return do_AddRef(mSharedDirectives);
+}
+
+nsCSPPolicy::SharedDirectives::~SharedDirectives() {
   for (uint32_t i = 0; i < mDirectives.Length(); i++) {
     delete mDirectives[i];
   }
 }
 
+size_t nsCSPPolicy::SharedDirectives::SizeOfIncludingThis(
+    mozilla::MallocSizeOf aMallocSizeOf) const {
+  // The directives and sources are not measured individually; they are
+  // roughly proportional to the policy string, which is measured by the
+  // cache itself.
+  return aMallocSizeOf(this) +
+         mDirectives.ShallowSizeOfExcludingThis(aMallocSizeOf);
+}
+
 bool nsCSPPolicy::permits(CSPDirective aDir, nsIURI* aUri,
                           const nsAString& aNonce, bool aWasRedirected,
                           bool aSpecific, bool aParserCreated,
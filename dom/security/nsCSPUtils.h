@@ -15,6 +15,7 @@
 #include "nsTArray.h"
 #include "nsUnicharUtils.h"
 #include "mozilla/Logging.h"
+#include "mozilla/RefPtr.h"
 
 class nsIChannel;
 
@@ -638,9 +639,40 @@ class nsUpgradeInsecureDirective : public nsCSPDirective {
 
 class nsCSPPolicy {
  public:
+  /**
+   * The parsed directives of a policy, shared by all policies which were
+   * parsed from the same policy string (see nsCSPParser's policy cache).
+   * Shared directives are never modified.
+   */
+  class SharedDirectives final {
+   public:
+    NS_INLINE_DECL_THREADSAFE_REFCOUNTING(SharedDirectives)
+
+    SharedDirectives(nsTArray<nsCSPDirective*>&& aDirectives,
+                     nsUpgradeInsecureDirective* aUpgradeInsecDir)
+        : mDirectives(std::move(aDirectives)),
+          mUpgradeInsecDir(aUpgradeInsecDir) {}
+
+    size_t SizeOfIncludingThis(mozilla::MallocSizeOf aMallocSizeOf) const;
+
+    const nsTArray<nsCSPDirective*> mDirectives;
+    nsUpgradeInsecureDirective* const mUpgradeInsecDir;
+
+   private:
+    ~SharedDirectives();
+  };
+
   nsCSPPolicy();
+  explicit nsCSPPolicy(SharedDirectives* aDirectives);
   virtual ~nsCSPPolicy();
 
+  /**
+   * Hands the directives of this policy over to a SharedDirectives, so that
+   * other policies can be created from them. No directives may be added to
+   * this policy afterwards.
+   */
+  already_AddRefed<SharedDirectives> shareDirectives();
+
   bool permits(CSPDirective aDirective, nsIURI* aUri, const nsAString& aNonce,
                bool aWasRedirected, bool aSpecific, bool aParserCreated,
                nsAString& outViolatedDirective) const;
@@ -650,6 +682,7 @@ class nsCSPPolicy {
   void toDomCSPStruct(mozilla::dom::CSP& outCSP) const;
 
   inline void addDirective(nsCSPDirective* aDir) {
+    MOZ_ASSERT(!mSharedDirectives, "Shared directives are immutable");
     mDirectives.AppendElement(aDir);
   }
 
@@ -692,6 +725,8 @@ class nsCSPPolicy {
  private:
   nsUpgradeInsecureDirective* mUpgradeInsecDir;
   nsTArray<nsCSPDirective*> mDirectives;
+  // Owns mDirectives if set; otherwise this policy owns them.
+  RefPtr<SharedDirectives> mSharedDirectives;
   bool mReportOnly;
   bool mDeliveredViaMetaTag;
 };
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -14,6 +15,7 @@
 #include "mozilla/BasePrincipal.h"
 #include "mozilla/dom/nsCSPContext.h"
 #include "mozilla/gtest/MozAssertions.h"
+#include "nsCSPParser.h"
 #include "nsComponentManagerUtils.h"
 #include "nsIPrefBranch.h"
 #include "nsIPrefService.h"
@@ -1011,6 +1013,180 @@ TEST(CSPParser, BadGeneratedPoliciesForPathHandling)
   ASSERT_NS_SUCCEEDED(runTestSuite(policies, policyCount, 1));
 }
 
+// ============================= TestPolicyCache =====================
+
+TEST(CSPParser, PolicyCache)
+{
+  nsCSPParser::SetPolicyCacheEnabled(true);
+  nsCSPParser::ClearPolicyCache();
+
+  static const PolicyTest policies[] = {
+      // clang-format off
+    { "script-src 'self' https://cdn.example.com; report-uri /csp",
+      "script-src 'self' https://cdn.example.com; report-uri http://www.selfuri.com/csp" },
+    // Logs a warning, so it is parsed every time.
+    { "script-src 'unsafe-inline' 'nonce-abc'",
+      "script-src 'unsafe-inline' 'nonce-abc'" },
+    // Path relative report URIs depend on the full self URI.
+    { "default-src 'none'; report-uri csp",
+      "default-src 'none'; report-uri http://www.selfuri.com/csp" },
+      // clang-format on
+  };
+  uint32_t policyCount = sizeof(policies) / sizeof(PolicyTest);
+
+  // Policies parsed from the cache must be identical to freshly parsed ones.
+  for (uint32_t i = 0; i < 3; i++) {
+    ASSERT_NS_SUCCEEDED(runTestSuite(policies, policyCount, 1));
+  }
+
+  nsCSPParser::PolicyCacheStats stats = nsCSPParser::GetPolicyCacheStats();
+  ASSERT_EQ(stats.mEntries, 1u);
+  ASSERT_EQ(stats.mHits, 2u);
+  ASSERT_EQ(stats.mUncacheable, 6u);
+
+  nsCSPParser::ClearPolicyCache();
+}
+
+// Policies modelled on the headers sent by large sites, which tend to list
+// many hosts per directive.
+static const char* const kRealWorldPolicies[] = {
+    "default-src 'none'; base-uri 'self'; child-src github.com/assets-cdn/"
+    "worker/ gist.github.com/assets-cdn/worker/; connect-src 'self' "
+    "uploads.github.com www.githubstatus.com collector.github.com "
+    "raw.githubusercontent.com api.github.com github-cloud.s3.amazonaws.com "
+    "github-production-repository-file-5c1aeb.s3.amazonaws.com "
+    "github-production-upload-manifest-file-7fdce7.s3.amazonaws.com "
+    "github-production-user-asset-6210df.s3.amazonaws.com "
+    "api.githubcopilot.com objects-origin.githubusercontent.com "
+    "wss://alive.github.com; font-src github.githubassets.com; "
+    "form-action 'self' github.com gist.github.com "
+    "copilot-workspace.githubnext.com objects-origin.githubusercontent.com; "
+    "frame-ancestors 'none'; frame-src viewscreen.githubusercontent.com "
+    "notebooks.githubusercontent.com; img-src 'self' data: "
+    "github.githubassets.com media.githubusercontent.com "
+    "camo.githubusercontent.com identicons.github.com "
+    "avatars.githubusercontent.com github-cloud.s3.amazonaws.com "
+    "objects.githubusercontent.com secured-user-images.githubusercontent.com"
+    "/ user-images.githubusercontent.com/ "
+    "private-user-images.githubusercontent.com "
+    "opengraph.githubassets.com github-production-user-asset-6210df.s3."
+    "amazonaws.com customer-stories-feed.github.com spotlights-feed.github"
+    ".com objects-origin.githubusercontent.com *.githubusercontent.com; "
+    "manifest-src 'self'; media-src github.com user-images.githubusercontent"
+    ".com/ secured-user-images.githubusercontent.com/ "
+    "private-user-images.githubusercontent.com github-production-user-asset"
+    "-6210df.s3.amazonaws.com gist.github.com; script-src "
+    "github.githubassets.com; style-src 'unsafe-inline' "
+    "github.githubassets.com; upgrade-insecure-requests; worker-src "
+    "github.com/assets-cdn/worker/ gist.github.com/assets-cdn/worker/",
+
+    "script-src 'report-sample' 'nonce-TmPNJQjEyHcBqKh4n1ylfQ' "
+    "'strict-dynamic' 'unsafe-eval' 'unsafe-inline' https: http:; "
+    "object-src 'none'; base-uri 'self'; report-uri "
+    "https://csp.withgoogle.com/csp/gws/other-hp",
+
+    "connect-src 'self' blob: https://*.pscp.tv https://*.video.pscp.tv "
+    "https://*.twimg.com https://api.twitter.com https://api-stream.twitter"
+    ".com https://ads-api.twitter.com https://aa.twitter.com "
+    "https://caps.twitter.com https://pay.twitter.com https://sentry.io "
+    "https://ton.twitter.com https://twitter.com https://upload.twitter.com "
+    "https://www.google-analytics.com https://accounts.google.com/gsi/status "
+    "https://accounts.google.com/gsi/log https://api.x.com https://x.com "
+    "wss://*.pscp.tv https://vmap.snappytv.com https://vmapstage.snappytv"
+    ".com https://vmaprel.snappytv.com https://vmap.grabyo.com "
+    "https://dhdsnappytv-vh.akamaihd.net https://pdhdsnappytv-vh.akamaihd"
+    ".net https://mdhdsnappytv-vh.akamaihd.net https://mdhdsnappytv-vh."
+    "akamaihd.net https://mpdhdsnappytv-vh.akamaihd.net https://mmdhdsnappy"
+    "tv-vh.akamaihd.net https://dwo3ckksxlb0v.cloudfront.net; default-src "
+    "'self'; form-action 'self' https://twitter.com https://*.twitter.com "
+    "https://x.com https://*.x.com; font-src 'self' https://*.twimg.com; "
+    "frame-src 'self' https://twitter.com https://x.com https://mobile."
+    "twitter.com https://pay.twitter.com https://cards-frame.twitter.com "
+    "https://accounts.google.com/ https://client-api.arkoselabs.com/ "
+    "https://iframe.arkoselabs.com/ https://recaptcha.net/recaptcha/ "
+    "https://www.google.com/recaptcha/ https://www.gstatic.com/recaptcha/; "
+    "img-src 'self' blob: data: https://*.cdn.twitter.com https://ton."
+    "twitter.com https://*.twimg.com https://analytics.twitter.com "
+    "https://cm.g.doubleclick.net https://www.google-analytics.com "
+    "https://maps.googleapis.com https://www.periscope.tv https://www.pscp"
+    ".tv https://ads-twitter.com https://ads-api.twitter.com "
+    "https://media.riffsy.com https://*.giphy.com https://*.pscp.tv "
+    "https://*.periscope.tv https://prod-periscope-profile.s3-us-west-2."
+    "amazonaws.com https://platform-lookaside.fbsbx.com https://scontent."
+    "xx.fbcdn.net https://scontent-sea1-1.xx.fbcdn.net https://*.googleuser"
+    "content.com; manifest-src 'self'; media-src 'self' blob: "
+    "https://twitter.com https://x.com https://*.twimg.com "
+    "https://*.vine.co https://*.pscp.tv https://*.video.pscp.tv "
+    "https://*.giphy.com https://media.riffsy.com https://dhdsnappytv-vh."
+    "akamaihd.net https://pdhdsnappytv-vh.akamaihd.net https://mdhdsnappytv"
+    "-vh.akamaihd.net https://mpdhdsnappytv-vh.akamaihd.net "
+    "https://mmdhdsnappytv-vh.akamaihd.net https://smdhdsnappytv-vh."
+    "akamaihd.net https://dwo3ckksxlb0v.cloudfront.net; object-src 'none'; "
+    "script-src 'self' 'unsafe-inline' https://*.twimg.com "
+    "https://recaptcha.net/recaptcha/ https://www.google.com/recaptcha/ "
+    "https://www.gstatic.com/recaptcha/ https://client-api.arkoselabs.com/ "
+    "https://www.google-analytics.com https://twitter.com https://x.com "
+    "https://accounts.google.com/gsi/client https://appleid.cdn-apple.com/"
+    "appleauth/static/jsapi/appleid/1/en_US/appleid.auth.js "
+    "'nonce-NjU1YjQ2ZjItZDM2Mi00ZTQ0LWE0ZGQtNjU2ZWQ2MGI1MDQ5'; style-src "
+    "'self' 'unsafe-inline' https://accounts.google.com/gsi/style "
+    "https://*.twimg.com; worker-src 'self' blob:; report-uri "
+    "https://twitter.com/i/csp_report?a=O5RXE%3D%3D%3D&ro=false",
+
+    "upgrade-insecure-requests; frame-ancestors 'self' "
+    "https://stackexchange.com",
+
+    "default-src 'self' https://*.wikipedia.org https://*.wikimedia.org "
+    "https://*.mediawiki.org https://wikimediafoundation.org; img-src 'self' "
+    "data: blob: https://upload.wikimedia.org https://*.wikipedia.org "
+    "https://*.wikimedia.org; script-src 'self' "
+    "https://*.wikipedia.org 'unsafe-eval'; style-src 'self' "
+    "https://*.wikipedia.org 'unsafe-inline'; report-uri "
+    "/w/api.php?action=cspreport&format=json",
+};
+
+// Parses the corpus aRounds times, each time for a new document.
+static void ParseCorpus(uint32_t aRounds) {
+  nsCOMPtr<nsIURI> selfURI;
+  NS_NewURI(getter_AddRefs(selfURI), "https://www.selfuri.com/page");
+  nsCOMPtr<nsIPrincipal> principal =
+      mozilla::BasePrincipal::CreateContentPrincipal(
+          selfURI, mozilla::OriginAttributes());
+
+  for (uint32_t round = 0; round < aRounds; round++) {
+    nsCOMPtr<nsIContentSecurityPolicy> csp =
+        do_CreateInstance(NS_CSPCONTEXT_CONTRACTID);
+    csp->SetRequestContextWithPrincipal(principal, selfURI, u""_ns, 0);
+    for (const char* policy : kRealWorldPolicies) {
+      csp->AppendPolicy(NS_ConvertASCIItoUTF16(policy), false, false);
+    }
+  }
+}
+
+static void BenchPolicyCache(bool aEnabled) {
+  const uint32_t kRounds = 2000;
+
+  nsCSPParser::SetPolicyCacheEnabled(aEnabled);
+  nsCSPParser::ClearPolicyCache();
+  ParseCorpus(kRounds);
+  nsCSPParser::PolicyCacheStats stats = nsCSPParser::GetPolicyCacheStats();
+  nsCSPParser::SetPolicyCacheEnabled(true);
+  nsCSPParser::ClearPolicyCache();
+
+  // Each cacheable policy is only parsed in the first round. Policies which
+  // log warnings are parsed every time.
+  if (aEnabled) {
+    ASSERT_LE(stats.mMisses, std::size(kRealWorldPolicies));
+  } else {
+    ASSERT_EQ(stats.mHits, 0u);
+  }
+}
+
+MOZ_GTEST_BENCH(CSPParser, PolicyCacheCorpusUncached,
+                [] { BenchPolicyCache(false); });
+MOZ_GTEST_BENCH(CSPParser, PolicyCacheCorpusCached,
+                [] { BenchPolicyCache(true); });
+
 // ======================== TestFuzzyPolicies ========================
 
 // Use a policy, eliminate one character at a time,
@@ -15,7 +15,9 @@
 #include "mozilla/RefPtr.h"
 #include "mozilla/dom/URLBinding.h"
 #include "mozilla/dom/BindingUtils.h"
+#include "mozilla/dom/URLParseCache.h"
 #include "nsContentUtils.h"
+#include "nsIGlobalObject.h"
 #include "mozilla/dom/Document.h"
 #include "nsIURIMutator.h"
 #include "nsJSUtils.h"
@@ -42,11 +44,28 @@ already_AddRefed<URL> URL::Constructor(const GlobalObject& aGlobal,
                                        const nsAString& aURL,
                                        const Optional<nsAString>& aBase,
                                        ErrorResult& aRv) {
-  if (aBase.WasPassed()) {
-    return Constructor(aGlobal.GetAsSupports(), aURL, aBase.Value(), aRv);
+  const nsAString* base = aBase.WasPassed() ? &aBase.Value() : nullptr;
+
+  // Scripts often construct URLs from the same strings over and over, so
+  // reuse the URI parsed by an earlier call.
+  URLParseCache* cache = nullptr;
+  if (nsCOMPtr<nsIGlobalObject> global =
+          do_QueryInterface(aGlobal.GetAsSupports())) {
+    if (!global->IsDying()) {
+      cache = &global->GetURLParseCache();
+      if (nsCOMPtr<nsIURI> uri = cache->Lookup(aURL, base)) {
+        return MakeAndAddRef<URL>(aGlobal.GetAsSupports(), std::move(uri));
+      }
+    }
   }
 
-  return Constructor(aGlobal.GetAsSupports(), aURL, nullptr, aRv);
+  RefPtr<URL> url =
+      base ? Constructor(aGlobal.GetAsSupports(), aURL, *base, aRv)
+           : Constructor(aGlobal.GetAsSupports(), aURL, nullptr, aRv);
+  if (url && cache) {
+    cache->Put(aURL, base, url->URI());
+  }
+  return url.forget();
 }
 
 /* static */
@@ -0,0 +1,119 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "URLParseCache.h"
+
+#include "MainThreadUtils.h"
+#include "mozilla/Atomics.h"
+#include "nsIMemoryReporter.h"
+
+namespace mozilla::dom {
+
+namespace {
+
+// Totals over the caches of all globals, for about:memory.
+Atomic<uint64_t, Relaxed> sURLParseCacheHits;
+Atomic<uint64_t, Relaxed> sURLParseCacheMisses;
+
+class URLParseCacheReporter final : public nsIMemoryReporter {
+  ~URLParseCacheReporter() = default;
+
+ public:
+  NS_DECL_ISUPPORTS
+
+  NS_IMETHOD CollectReports(nsIHandleReportCallback* aHandleReport,
+                            nsISupports* aData, bool aAnonymize) override {
+    MOZ_COLLECT_REPORT("dom-url-parse-cache-hits", KIND_OTHER,
+                       UNITS_COUNT_CUMULATIVE, sURLParseCacheHits,
+                       "URL constructor calls which reused a URI parsed by an "
+                       "earlier call in the same global.");
+    MOZ_COLLECT_REPORT("dom-url-parse-cache-misses", KIND_OTHER,
+                       UNITS_COUNT_CUMULATIVE, sURLParseCacheMisses,
+                       "URL constructor calls which had to parse their input.");
+    return NS_OK;
+  }
+};
+
+NS_IMPL_ISUPPORTS(URLParseCacheReporter, nsIMemoryReporter)
+
+void EnsureReporter() {
+  static bool sRegistered = false;
+  if (!sRegistered && NS_IsMainThread()) {
+    sRegistered = true;
+    RegisterStrongMemoryReporter(new URLParseCacheReporter());
+  }
+}
+
+bool IsCacheable(const nsAString& aURL, const nsAString* aBase) {
+  if (aURL.Length() > URLParseCache::kMaxInputLength || aURL.IsTainted()) {
+    return false;
+  }
+  return !aBase || (aBase->Length() <= URLParseCache::kMaxInputLength &&
+                    !aBase->IsTainted());
+}
+
+}  // namespace
+
+already_AddRefed<nsIURI> URLParseCache::Lookup(const nsAString& aURL,
+                                               const nsAString* aBase) {
+  if (!IsCacheable(aURL, aBase)) {
+    return nullptr;
+  }
+
+  for (size_t i = mEntries.Length(); i > 0; i--) {
+    Entry& entry = mEntries[i - 1];
+    if (entry.mHasBase != !!aBase || !entry.mURL.Equals(aURL) ||
+        (aBase && !entry.mBase.Equals(*aBase))) {
+      continue;
+    }
+
+    mHits++;
+    sURLParseCacheHits++;
+    nsCOMPtr<nsIURI> uri = entry.mURI;
+    if (i != mEntries.Length()) {
+      Entry moved = std::move(entry);
+      mEntries.RemoveElementAt(i - 1);
+      mEntries.AppendElement(std::move(moved));
+    }
+    return uri.forget();
+  }
+
+  mMisses++;
+  sURLParseCacheMisses++;
+  EnsureReporter();
+  return nullptr;
+}
+
+void URLParseCache::Put(const nsAString& aURL, const nsAString* aBase,
+                        nsIURI* aURI) {
+  MOZ_ASSERT(aURI);
+  if (!IsCacheable(aURL, aBase)) {
+    return;
+  }
+
+  if (mEntries.Length() >= kMaxEntries) {
+    mEntries.RemoveElementAt(0);
+  }
+
+  Entry* entry = mEntries.AppendElement();
+  entry->mURL = aURL;
+  entry->mHasBase = !!aBase;
+  if (aBase) {
+    entry->mBase = *aBase;
+  }
+  entry->mURI = aURI;
+}
+
+size_t URLParseCache::SizeOfExcludingThis(MallocSizeOf aMallocSizeOf) const {
+  size_t n = mEntries.ShallowSizeOfExcludingThis(aMallocSizeOf);
+  for (const Entry& entry : mEntries) {
+    n += entry.mURL.SizeOfExcludingThisIfUnshared(aMallocSizeOf);
+    n += entry.mBase.SizeOfExcludingThisIfUnshared(aMallocSizeOf);
+  }
+  return n;
+}
+
+}  // namespace mozilla::dom
@@ -0,0 +1,76 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef mozilla_dom_URLParseCache_h
+#define mozilla_dom_URLParseCache_h
+
+#include "mozilla/MemoryReporting.h"
+#include "nsCOMPtr.h"
+#include "nsIURI.h"
+#include "nsString.h"
+#include "nsTArray.h"
+
+namespace mozilla::dom {
+
+/**
+ * Cache of the URIs parsed by the URL constructor, owned by a global. Router
+ * and analytics code calls new URL(sameInput, sameBase) over and over, and
+ * each call would otherwise parse the base and the input from scratch.
+ *
+ * nsIURIs are immutable, and the URL setters replace their URI rather than
+ * modify it, so a cached URI is shared by every URL created from it.
+ *
+ * TaintFox: the taint of a parsed URI comes from its input, and a cached URI
+ * would carry the taint flows of the first input to every later one. Tainted
+ * inputs and bases are therefore always parsed, and never cached.
+ */
+class URLParseCache final {
+ public:
+  URLParseCache() = default;
+  URLParseCache(const URLParseCache&) = delete;
+  URLParseCache& operator=(const URLParseCache&) = delete;
+
+  // Returns the URI parsed from aURL relative to aBase, which is null if no
+  // base was passed, or nullptr if it isn't cached.
+  already_AddRefed<nsIURI> Lookup(const nsAString& aURL,
+                                  const nsAString* aBase);
+
+  // Adds the URI parsed from aURL relative to aBase, evicting the least
+  // recently used entry if the cache is full.
+  void Put(const nsAString& aURL, const nsAString* aBase, nsIURI* aURI);
+
+  void Clear() { mEntries.Clear(); }
+
+  uint32_t Length() const { return mEntries.Length(); }
+  uint64_t Hits() const { return mHits; }
+  uint64_t Misses() const { return mMisses; }
+
+  // The URIs are not included, they are shared with URL objects.
+  size_t SizeOfExcludingThis(MallocSizeOf aMallocSizeOf) const;
+
+  static const uint32_t kMaxEntries = 32;
+
+  // Longer inputs, like data: URLs, are unlikely to be repeated and would pin
+  // a lot of memory.
+  static const uint32_t kMaxInputLength = 2048;
+
+ private:
+  struct Entry {
+    nsString mURL;
+    nsString mBase;
+    bool mHasBase;
+    nsCOMPtr<nsIURI> mURI;
+  };
+
+  // Ordered from least to most recently used.
+  nsTArray<Entry> mEntries;
+  uint64_t mHits = 0;
+  uint64_t mMisses = 0;
+};
+
+}  // namespace mozilla::dom
+
+#endif  // mozilla_dom_URLParseCache_h
@@ -30,6 +30,7 @@
 #include "nsDOMString.h"
 #include "nsError.h"
 #include "nsIGlobalObject.h"
+#include "nsJSUtils.h"
 #include "nsLiteralString.h"
 #include "nsPrintfCString.h"
 #include "nsString.h"
@@ -70,6 +71,8 @@ already_AddRefed<URLSearchParams> URLSearchParams::Constructor(
 
   if (aInit.IsUSVString()) {
     NS_ConvertUTF16toUTF8 input(aInit.GetAsUSVString());
+    // Taintfox: the conversion keeps the UTF-16 indices of the taint.
+    input.AssignTaint(URLParams::UTF8Taint(aInit.GetAsUSVString()));
     if (StringBeginsWith(input, "?"_ns)) {
       sp->ParseInput(Substring(input, 1, input.Length() - 1));
     } else {
@@ -106,12 +109,16 @@ void URLSearchParams::ParseInput(const nsACString& aInput) {
 }
 
 void URLSearchParams::Get(const nsAString& aName, nsString& aRetval) {
-  return mParams->Get(aName, aRetval);
+  mParams->Get(aName, aRetval);
+  MarkTaintOperation(aRetval, "URLSearchParams.get");
 }
 
 void URLSearchParams::GetAll(const nsAString& aName,
                              nsTArray<nsString>& aRetval) {
-  return mParams->GetAll(aName, aRetval);
+  mParams->GetAll(aName, aRetval);
+  for (nsString& value : aRetval) {
+    MarkTaintOperation(value, "URLSearchParams.getAll");
+  }
 }
 
 void URLSearchParams::Set(const nsAString& aName, const nsAString& aValue) {
@@ -9,6 +9,7 @@
 #include "mozilla/dom/WorkerLoadContext.h"
 #include "mozilla/dom/workerinternals/ScriptLoader.h"
 #include "WorkerModuleLoader.h"
+#include "WorkerStencilCache.h"
 
 #include "nsISupportsImpl.h"
 
@@ -83,8 +84,11 @@ nsresult WorkerModuleLoader::CompileFetchedModule(
   nsresult rv = aRequest->GetScriptSource(aCx, &maybeSource);
   NS_ENSURE_SUCCESS(rv, rv);
 
+  // Workers loading the same module share its compiled stencil.
   auto compile = [&](auto& source) {
-    return JS::CompileModuleScriptToStencil(aCx, aOptions, source);
+    return WorkerStencilCache::GetOrCompile(
+        aCx, WorkerStencilCache::Kind::Module, aRequest->mURL, aOptions,
+        source);
   };
   stencil = maybeSource.mapNonEmpty(compile);
 
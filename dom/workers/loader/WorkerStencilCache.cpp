@@ -0,0 +1,417 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WorkerStencilCache.h"
+
+#include <type_traits>
+
+#include "js/Exception.h"
+#include "js/Transcoding.h"
+#include "js/experimental/JSStencil.h"
+#include "mozilla/Atomics.h"
+#include "mozilla/ClearOnShutdown.h"
+#include "mozilla/HashFunctions.h"
+#include "mozilla/HashTable.h"
+#include "mozilla/LinkedList.h"
+#include "mozilla/SHA1.h"
+#include "mozilla/StaticMonitor.h"
+#include "mozilla/StaticPtr.h"
+#include "mozilla/UniquePtr.h"
+#include "mozilla/Utf8.h"
+#include "nsIMemoryReporter.h"
+#include "nsISupportsImpl.h"
+#include "nsThreadUtils.h"
+
+namespace mozilla::dom::workerinternals::loader {
+
+namespace {
+
+using Kind = WorkerStencilCache::Kind;
+
+struct StencilKey {
+  nsCString mURL;
+  nsCString mFilename;
+  // The SHA-1 digest and byte length of the source. Scripts of the same URL
+  // may differ between loads, e.g. after a site update, and the cached
+  // stencil is executed instead of the source the worker fetched.
+  SHA1Sum::Hash mDigest;
+  uint32_t mLength;
+  // HashBytes of the source. It doubles as the part of the table hash that
+  // covers the source, and makes a worker run another script's stencil only
+  // if both it and the digest collide.
+  uint32_t mHash;
+  uint32_t mLineno;
+  uint32_t mColumn;
+  // The kind, the source unit type and the compile options which change the
+  // stencil.
+  uint32_t mFlags;
+
+  bool operator==(const StencilKey& aOther) const {
+    return mLength == aOther.mLength && mHash == aOther.mHash &&
+           mLineno == aOther.mLineno && mColumn == aOther.mColumn &&
+           mFlags == aOther.mFlags &&
+           !memcmp(mDigest, aOther.mDigest, sizeof(mDigest)) &&
+           mURL == aOther.mURL && mFilename == aOther.mFilename;
+  }
+};
+
+struct StencilKeyHasher {
+  using Lookup = StencilKey;
+  static HashNumber hash(const Lookup& aKey) {
+    return AddToHash(HashString(aKey.mURL.get(), aKey.mURL.Length()),
+                     aKey.mHash, aKey.mLineno, aKey.mColumn, aKey.mFlags);
+  }
+  static bool match(const StencilKey& aKey, const Lookup& aLookup) {
+    return aKey == aLookup;
+  }
+};
+
+// An XDR encoded stencil, shared by the cache and the workers decoding it.
+class EncodedStencil final {
+ public:
+  NS_INLINE_DECL_THREADSAFE_REFCOUNTING(EncodedStencil)
+
+  JS::TranscodeBuffer mBuffer;
+
+ private:
+  ~EncodedStencil() = default;
+};
+
+class StencilCacheEntry : public LinkedListElement<StencilCacheEntry> {
+ public:
+  explicit StencilCacheEntry(const StencilKey& aKey) : mKey(aKey) {}
+
+  // What this entry counts against the size limit of the cache.
+  size_t Size() const {
+    return sizeof(*this) + mKey.mURL.Length() + mKey.mFilename.Length() +
+           (mEncoded ? mEncoded->mBuffer.length() : 0);
+  }
+
+  size_t SizeOfIncludingThis(MallocSizeOf aMallocSizeOf) const {
+    size_t n = aMallocSizeOf(this) +
+               mKey.mURL.SizeOfExcludingThisIfUnshared(aMallocSizeOf) +
+               mKey.mFilename.SizeOfExcludingThisIfUnshared(aMallocSizeOf);
+    // Workers only hold on to the encoded stencil while they decode it, so it
+    // is counted here.
+    if (mEncoded) {
+      n += aMallocSizeOf(mEncoded.get()) +
+           mEncoded->mBuffer.sizeOfExcludingThis(aMallocSizeOf);
+    }
+    return n;
+  }
+
+  const StencilKey mKey;
+  // Set while a worker compiles the script; other workers wanting it wait
+  // for the compile to finish instead of starting their own.
+  bool mCompiling = true;
+  // Null once compiled if the stencil can't be encoded, such as for asm.js,
+  // in which case every worker compiles the script itself.
+  RefPtr<EncodedStencil> mEncoded;
+};
+
+struct StencilCacheState {
+  ~StencilCacheState() {
+    // The entries are owned by mEntries.
+    mLRU.clear();
+  }
+
+  size_t SizeOfIncludingThis(MallocSizeOf aMallocSizeOf) const {
+    size_t n = aMallocSizeOf(this) +
+               mEntries.shallowSizeOfExcludingThis(aMallocSizeOf);
+    for (auto iter = mEntries.iter(); !iter.done(); iter.next()) {
+      n += iter.get().value()->SizeOfIncludingThis(aMallocSizeOf);
+    }
+    return n;
+  }
+
+  HashMap<StencilKey, UniquePtr<StencilCacheEntry>, StencilKeyHasher> mEntries;
+  // The compiled entries, least recently used first.
+  LinkedList<StencilCacheEntry> mLRU;
+  size_t mBytes = 0;
+};
+
+StaticMonitor sStencilCacheMonitor MOZ_UNANNOTATED;
+StaticAutoPtr<StencilCacheState> sStencilCache;
+// Set once shutdown starts, after which scripts are compiled without the
+// cache.
+bool sStencilCacheShutdown = false;
+
+Atomic<uint64_t, Relaxed> sStencilCompiles;
+Atomic<uint64_t, Relaxed> sStencilHits;
+
+template <typename Unit>
+StencilKey ComputeKey(Kind aKind, const nsACString& aURL,
+                      const JS::ReadOnlyCompileOptions& aOptions,
+                      const JS::SourceText<Unit>& aSource) {
+  StencilKey key;
+  key.mURL = aURL;
+  if (aOptions.filename()) {
+    key.mFilename = aOptions.filename();
+  }
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(aSource.units());
+  uint32_t length = aSource.length() * sizeof(Unit);
+  SHA1Sum sum;
+  sum.update(data, length);
+  sum.finish(key.mDigest);
+  key.mLength = length;
+  key.mHash = HashBytes(data, length);
+
+  key.mLineno = aOptions.lineno;
+  key.mColumn = aOptions.column;
+
+  uint32_t flags = 0;
+  uint32_t bit = 0;
+  auto addFlag = [&](bool aValue) { flags |= uint32_t(aValue) << bit++; };
+  addFlag(aKind == Kind::Module);
+  addFlag(std::is_same_v<Unit, char16_t>);
+  addFlag(aOptions.mutedErrors());
+  addFlag(aOptions.forceStrictMode());
+  addFlag(aOptions.sourcePragmas());
+  addFlag(aOptions.forceFullParse());
+  addFlag(aOptions.discardSource);
+  addFlag(aOptions.sourceIsLazy);
+  addFlag(aOptions.allowHTMLComments);
+  addFlag(aOptions.nonSyntacticScope);
+  addFlag(aOptions.topLevelAwait);
+  addFlag(aOptions.importAssertions);
+  addFlag(aOptions.isRunOnce);
+  addFlag(aOptions.noScriptRval);
+  key.mFlags = flags;
+  return key;
+}
+
+template <typename Unit>
+already_AddRefed<JS::Stencil> Compile(
+    JSContext* aCx, Kind aKind, const JS::ReadOnlyCompileOptions& aOptions,
+    JS::SourceText<Unit>& aSource) {
+  sStencilCompiles++;
+  if (aKind == Kind::Module) {
+    return JS::CompileModuleScriptToStencil(aCx, aOptions, aSource);
+  }
+  return JS::CompileGlobalScriptToStencil(aCx, aOptions, aSource);
+}
+
+MOZ_DEFINE_MALLOC_SIZE_OF(StencilCacheMallocSizeOf)
+
+class StencilCacheReporter final : public nsIMemoryReporter {
+  ~StencilCacheReporter() = default;
+
+ public:
+  NS_DECL_ISUPPORTS
+
+  NS_IMETHOD CollectReports(nsIHandleReportCallback* aHandleReport,
+                            nsISupports* aData, bool aAnonymize) override {
+    size_t bytes = 0;
+    {
+      StaticMonitorAutoLock lock(sStencilCacheMonitor);
+      if (sStencilCache) {
+        bytes = sStencilCache->SizeOfIncludingThis(StencilCacheMallocSizeOf);
+      }
+    }
+    MOZ_COLLECT_REPORT("explicit/workers/stencil-cache", KIND_HEAP,
+                       UNITS_BYTES, bytes,
+                       "Memory used by the compiled worker scripts shared "
+                       "between workers.");
+    return NS_OK;
+  }
+};
+
+NS_IMPL_ISUPPORTS(StencilCacheReporter, nsIMemoryReporter)
+
+// Registers the memory reporter, and frees the cache at shutdown. The cache is
+// created by whichever worker thread compiles a script first, but both need
+// to happen on the main thread.
+void RegisterStencilCache() {
+  NS_DispatchToMainThread(
+      NS_NewRunnableFunction("WorkerStencilCache::Register", [] {
+        RegisterStrongMemoryReporter(new StencilCacheReporter());
+        if (PastShutdownPhase(ShutdownPhase::AppShutdownConfirmed)) {
+          WorkerStencilCache::Shutdown();
+          return;
+        }
+        RunOnShutdown([] { WorkerStencilCache::Shutdown(); },
+                      ShutdownPhase::AppShutdownConfirmed);
+      }));
+}
+
+void Evict(StencilCacheState& aState) {
+  while (aState.mBytes > WorkerStencilCache::kMaxBytes ||
+         aState.mEntries.count() > WorkerStencilCache::kMaxEntries) {
+    StencilCacheEntry* oldest = aState.mLRU.popFirst();
+    if (!oldest) {
+      // Only entries being compiled are left.
+      break;
+    }
+    aState.mBytes -= oldest->Size();
+    aState.mEntries.remove(oldest->mKey);
+  }
+}
+
+// Records the outcome of the compile of aKey and wakes up the workers waiting
+// for it.  aCompiled is false if the script failed to compile, and aEncoded is
+// null if its stencil couldn't be encoded.
+void FinishCompile(const StencilKey& aKey, bool aCompiled,
+                   already_AddRefed<EncodedStencil> aEncoded) {
+  RefPtr<EncodedStencil> encoded = aEncoded;
+  StaticMonitorAutoLock lock(sStencilCacheMonitor);
+  if (!sStencilCache) {
+    // The cache was freed at shutdown, and its waiters were woken up then.
+    return;
+  }
+  if (auto p = sStencilCache->mEntries.lookup(aKey)) {
+    if (!aCompiled) {
+      // Let the next worker try, and report the error itself.
+      sStencilCache->mEntries.remove(p);
+    } else {
+      StencilCacheEntry* entry = p->value().get();
+      entry->mCompiling = false;
+      entry->mEncoded = std::move(encoded);
+      sStencilCache->mLRU.insertBack(entry);
+      sStencilCache->mBytes += entry->Size();
+      Evict(*sStencilCache);
+    }
+  }
+  lock.NotifyAll();
+}
+
+}  // namespace
+
+/* static */
+template <typename Unit>
+already_AddRefed<JS::Stencil> WorkerStencilCache::GetOrCompile(
+    JSContext* aCx, Kind aKind, const nsACString& aURL,
+    const JS::ReadOnlyCompileOptions& aOptions,
+    JS::SourceText<Unit>& aSource) {
+  // TaintFox: don't share the taint of one worker's script with others.
+  if (aSource.isTainted()) {
+    return Compile(aCx, aKind, aOptions, aSource);
+  }
+
+  StencilKey key = ComputeKey(aKind, aURL, aOptions, aSource);
+  RefPtr<EncodedStencil> encoded;
+  {
+    StaticMonitorAutoLock lock(sStencilCacheMonitor);
+    if (sStencilCacheShutdown) {
+      return Compile(aCx, aKind, aOptions, aSource);
+    }
+    if (!sStencilCache) {
+      sStencilCache = new StencilCacheState();
+      RegisterStencilCache();
+    }
+
+    while (true) {
+      auto p = sStencilCache->mEntries.lookup(key);
+      if (!p) {
+        if (!sStencilCache->mEntries.putNew(
+                key, MakeUnique<StencilCacheEntry>(key))) {
+          return Compile(aCx, aKind, aOptions, aSource);
+        }
+        break;
+      }
+
+      StencilCacheEntry* entry = p->value().get();
+      if (entry->mCompiling) {
+        lock.Wait();
+        if (sStencilCacheShutdown) {
+          // Don't wait for the worker compiling the script, which may
+          // never finish if its thread is being shut down.
+          return Compile(aCx, aKind, aOptions, aSource);
+        }
+        continue;
+      }
+      if (!entry->mEncoded) {
+        return Compile(aCx, aKind, aOptions, aSource);
+      }
+
+      entry->remove();
+      sStencilCache->mLRU.insertBack(entry);
+      encoded = entry->mEncoded;
+      break;
+    }
+  }
+
+  if (encoded) {
+    RefPtr<JS::Stencil> stencil;
+    JS::DecodeOptions decodeOptions(aOptions);
+    JS::TranscodeRange range(encoded->mBuffer.begin(),
+                             encoded->mBuffer.length());
+    JS::TranscodeResult result = JS::DecodeStencil(
+        aCx, decodeOptions, range, getter_AddRefs(stencil));
+    if (result == JS::TranscodeResult::Ok) {
+      sStencilHits++;
+      return stencil.forget();
+    }
+    if (result == JS::TranscodeResult::Throw) {
+      return nullptr;
+    }
+    // The buffer is encoded by this build, so this shouldn't happen, but the
+    // source is still there to compile.
+    return Compile(aCx, aKind, aOptions, aSource);
+  }
+
+  // This worker is the first to want the script, and compiles it for the
+  // others.
+  RefPtr<JS::Stencil> stencil = Compile(aCx, aKind, aOptions, aSource);
+  if (!stencil) {
+    FinishCompile(key, false, nullptr);
+    return nullptr;
+  }
+
+  RefPtr<EncodedStencil> newEncoded = new EncodedStencil();
+  JS::TranscodeResult result =
+      JS::EncodeStencil(aCx, stencil, newEncoded->mBuffer);
+  if (result != JS::TranscodeResult::Ok) {
+    if (result == JS::TranscodeResult::Throw) {
+      // The stencil itself is fine.
+      JS_ClearPendingException(aCx);
+    }
+    newEncoded = nullptr;
+  }
+  FinishCompile(key, true, newEncoded.forget());
+  return stencil.forget();
+}
+
+template already_AddRefed<JS::Stencil>
+WorkerStencilCache::GetOrCompile<Utf8Unit>(
+    JSContext* aCx, Kind aKind, const nsACString& aURL,
+    const JS::ReadOnlyCompileOptions& aOptions,
+    JS::SourceText<Utf8Unit>& aSource);
+template already_AddRefed<JS::Stencil>
+WorkerStencilCache::GetOrCompile<char16_t>(
+    JSContext* aCx, Kind aKind, const nsACString& aURL,
+    const JS::ReadOnlyCompileOptions& aOptions,
+    JS::SourceText<char16_t>& aSource);
+
+/* static */
+void WorkerStencilCache::Clear() {
+  StaticMonitorAutoLock lock(sStencilCacheMonitor);
+  if (!sStencilCache) {
+    return;
+  }
+  // Entries being compiled stay, for the workers waiting on them.
+  while (StencilCacheEntry* entry = sStencilCache->mLRU.popFirst()) {
+    sStencilCache->mBytes -= entry->Size();
+    sStencilCache->mEntries.remove(entry->mKey);
+  }
+}
+
+/* static */
+void WorkerStencilCache::Shutdown() {
+  MOZ_ASSERT(NS_IsMainThread());
+  StaticMonitorAutoLock lock(sStencilCacheMonitor);
+  sStencilCacheShutdown = true;
+  sStencilCache = nullptr;
+  lock.NotifyAll();
+}
+
+/* static */
+uint64_t WorkerStencilCache::Compiles() { return sStencilCompiles; }
+
+/* static */
+uint64_t WorkerStencilCache::Hits() { return sStencilHits; }
+
+}  // namespace mozilla::dom::workerinternals::loader
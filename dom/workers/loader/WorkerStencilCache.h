@@ -0,0 +1,78 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef mozilla_dom_workers_WorkerStencilCache_h__
+#define mozilla_dom_workers_WorkerStencilCache_h__
+
+#include "js/CompileOptions.h"
+#include "js/SourceText.h"
+#include "js/TypeDecls.h"
+#include "nsString.h"
+
+namespace JS {
+struct Stencil;
+}  // namespace JS
+
+namespace mozilla::dom::workerinternals::loader {
+
+/*
+ * WorkerStencilCache
+ *
+ * A process wide cache of the scripts compiled by workers, so that a page
+ * which starts a pool of identical workers parses their script once instead
+ * of once per worker.
+ *
+ * Stencils hold on to their ScriptSource, which the runtime that instantiates
+ * them compresses and reads without synchronization, so a stencil can't be
+ * used by several worker runtimes at once.  The cache therefore keeps each
+ * compiled script XDR encoded, and every worker decodes its own stencil from
+ * it, which is much cheaper than parsing.
+ *
+ * Entries are keyed by the script URL, a SHA-1 of the source and the compile
+ * options that the stencil depends on.  Workers that start together and miss
+ * the cache wait for the first of them to compile the script, rather than all
+ * parsing it at the same time.
+ *
+ * The cache is freed when shutdown starts.  Workers still waiting for another
+ * worker's compile then compile the script themselves, as does every worker
+ * after that.  The memory used is reported as explicit/workers/stencil-cache.
+ *
+ * TaintFox: the stencil of a tainted source carries its taint, so tainted
+ * sources are always compiled and never cached.
+ */
+class WorkerStencilCache final {
+ public:
+  enum class Kind : uint8_t { Classic, Module };
+
+  // Returns the stencil for aSource, decoded from the cache or compiled with
+  // aOptions.  Returns nullptr with an exception pending on aCx if the script
+  // fails to compile.
+  template <typename Unit>
+  static already_AddRefed<JS::Stencil> GetOrCompile(
+      JSContext* aCx, Kind aKind, const nsACString& aURL,
+      const JS::ReadOnlyCompileOptions& aOptions,
+      JS::SourceText<Unit>& aSource);
+
+  static void Clear();
+
+  // Frees the cache and stops using it.  Called on the main thread when
+  // shutdown starts.
+  static void Shutdown();
+
+  // The number of scripts compiled by GetOrCompile, and of stencils decoded
+  // from the cache instead.
+  static uint64_t Compiles();
+  static uint64_t Hits();
+
+  // The total size of the encoded stencils kept, beyond which the least
+  // recently used ones are dropped.
+  static const size_t kMaxBytes = 32 * 1024 * 1024;
+  static const uint32_t kMaxEntries = 1024;
+};
+
+}  // namespace mozilla::dom::workerinternals::loader
+
+#endif /* mozilla_dom_workers_WorkerStencilCache_h__ */
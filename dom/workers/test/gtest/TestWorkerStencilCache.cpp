@@ -0,0 +1,180 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+#include "Taint.h"
+#include "WorkerStencilCache.h"
+#include "jsapi.h"
+#include "js/CompilationAndEvaluation.h"
+#include "js/experimental/JSStencil.h"
+#include "js/GlobalObject.h"
+#include "js/Initialization.h"
+#include "js/SourceText.h"
+#include "mozilla/Atomics.h"
+#include "mozilla/dom/ScriptSettings.h"
+#include "mozilla/dom/SimpleGlobalObject.h"
+#include "nsString.h"
+
+using namespace mozilla;
+using namespace mozilla::dom;
+using mozilla::dom::workerinternals::loader::WorkerStencilCache;
+
+// Starts many runtimes which load the same worker script at the same time,
+// like a page creating a pool of identical workers, and counts how often the
+// script is parsed.
+
+namespace {
+
+const char kURL[] = "https://example.com/worker.js";
+
+const char kScript[] =
+    "function fib(n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }\n"
+    "var handlers = { add: (a, b) => a + b, mul: (a, b) => a * b };\n"
+    "handlers.add(fib(15), handlers.mul(2, 3));\n";
+const int32_t kResult = 610 + 6;
+
+const JSClass kGlobalClass = {"global", JSCLASS_GLOBAL_FLAGS,
+                              &JS::DefaultGlobalClassOps};
+
+// Compiles aScript through the cache, as the worker script loader does, runs
+// it and returns its completion value in aResult.
+bool CompileAndRun(JSContext* aCx, const char* aScript, bool aTainted,
+                   bool aNoScriptRval, JS::MutableHandle<JS::Value> aResult) {
+  JS::CompileOptions options(aCx);
+  options.setFileAndLine(kURL, 1);
+  options.setNoScriptRval(aNoScriptRval);
+
+  SafeStringTaint taint;
+  if (aTainted) {
+    taint.append(TaintRange(0, 8, TaintFlow(TaintOperation("location.hash"))));
+  }
+  JS::SourceText<Utf8Unit> srcBuf;
+  if (!srcBuf.init(aCx, aScript, strlen(aScript), taint,
+                   JS::SourceOwnership::Borrowed)) {
+    return false;
+  }
+
+  RefPtr<JS::Stencil> stencil = WorkerStencilCache::GetOrCompile(
+      aCx, WorkerStencilCache::Kind::Classic, nsLiteralCString(kURL), options,
+      srcBuf);
+  if (!stencil) {
+    return false;
+  }
+
+  JS::InstantiateOptions instantiateOptions(options);
+  JS::Rooted<JSScript*> script(
+      aCx, JS::InstantiateGlobalStencil(aCx, instantiateOptions, stencil));
+  return script && JS_ExecuteScript(aCx, script, aResult);
+}
+
+// The body of one worker thread: a runtime of its own, sharing the parent's
+// self-hosted code as worker runtimes do.
+void RunWorker(JSRuntime* aParent, const Atomic<bool>* aStart,
+               int32_t* aResult) {
+  JSContext* cx = JS_NewContext(JS::DefaultHeapMaxBytes, aParent);
+  if (!cx) {
+    return;
+  }
+  if (JS::InitSelfHostedCode(cx)) {
+    JS::RealmOptions options;
+    JS::Rooted<JSObject*> global(
+        cx, JS_NewGlobalObject(cx, &kGlobalClass, nullptr,
+                               JS::DontFireOnNewGlobalHook, options));
+    if (global) {
+      JSAutoRealm ar(cx, global);
+      while (!*aStart) {
+        std::this_thread::yield();
+      }
+      JS::Rooted<JS::Value> rval(cx);
+      if (CompileAndRun(cx, kScript, false, false, &rval) && rval.isInt32()) {
+        *aResult = rval.toInt32();
+      }
+    }
+  }
+  JS_DestroyContext(cx);
+}
+
+}  // namespace
+
+TEST(TestWorkerStencilCache, IdenticalWorkers)
+{
+  AutoJSAPI jsapi;
+  jsapi.Init();
+  JSRuntime* parent = JS_GetParentRuntime(jsapi.cx());
+
+  WorkerStencilCache::Clear();
+  uint64_t compiles = WorkerStencilCache::Compiles();
+  uint64_t hits = WorkerStencilCache::Hits();
+
+  const size_t kWorkers = 16;
+  Atomic<bool> start(false);
+  std::vector<int32_t> results(kWorkers, 0);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kWorkers; i++) {
+    threads.emplace_back(RunWorker, parent, &start, &results[i]);
+  }
+  start = true;
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < kWorkers; i++) {
+    EXPECT_EQ(results[i], kResult) << "worker " << i;
+  }
+  EXPECT_EQ(WorkerStencilCache::Compiles() - compiles, 1u);
+  EXPECT_EQ(WorkerStencilCache::Hits() - hits, kWorkers - 1);
+}
+
+TEST(TestWorkerStencilCache, Keys)
+{
+  JS::Rooted<JSObject*> global(
+      RootingCx(), SimpleGlobalObject::Create(
+                       SimpleGlobalObject::GlobalType::BindingDetail));
+  AutoJSAPI jsapi;
+  ASSERT_TRUE(jsapi.Init(global));
+  JSContext* cx = jsapi.cx();
+
+  WorkerStencilCache::Clear();
+  uint64_t compiles = WorkerStencilCache::Compiles();
+  uint64_t hits = WorkerStencilCache::Hits();
+  JS::Rooted<JS::Value> rval(cx);
+
+  ASSERT_TRUE(CompileAndRun(cx, kScript, false, false, &rval));
+  EXPECT_TRUE(rval.isInt32(kResult));
+  ASSERT_TRUE(CompileAndRun(cx, kScript, false, false, &rval));
+  EXPECT_TRUE(rval.isInt32(kResult));
+  EXPECT_EQ(WorkerStencilCache::Compiles() - compiles, 1u);
+  EXPECT_EQ(WorkerStencilCache::Hits() - hits, 1u);
+
+  // A new version of the script at the same URL, and the same script compiled
+  // with other options, are cached separately.
+  ASSERT_TRUE(CompileAndRun(cx, "fib(10) + 1;", false, false, &rval));
+  EXPECT_TRUE(rval.isInt32(56));
+  ASSERT_TRUE(CompileAndRun(cx, kScript, false, true, &rval));
+  EXPECT_TRUE(rval.isUndefined());
+  EXPECT_EQ(WorkerStencilCache::Compiles() - compiles, 3u);
+  EXPECT_EQ(WorkerStencilCache::Hits() - hits, 1u);
+
+  // Scripts which fail to compile aren't cached.
+  EXPECT_FALSE(CompileAndRun(cx, "var = ;", false, false, &rval));
+  jsapi.ClearException();
+  EXPECT_FALSE(CompileAndRun(cx, "var = ;", false, false, &rval));
+  jsapi.ClearException();
+  EXPECT_EQ(WorkerStencilCache::Compiles() - compiles, 5u);
+
+  // TaintFox: tainted scripts are compiled every time.
+  ASSERT_TRUE(CompileAndRun(cx, kScript, true, false, &rval));
+  ASSERT_TRUE(CompileAndRun(cx, kScript, true, false, &rval));
+  EXPECT_TRUE(rval.isInt32(kResult));
+  EXPECT_EQ(WorkerStencilCache::Compiles() - compiles, 7u);
+  EXPECT_EQ(WorkerStencilCache::Hits() - hits, 1u);
+
+  WorkerStencilCache::Clear();
+}
@@ -0,0 +1,265 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include <string.h>
+#include <vector>
+
+#include "GLConsts.h"
+
+using namespace mozilla;
+
+// The SWGL entry points used by the software compositor. LockedTexture and
+// Context are opaque here.
+extern "C" {
+void* CreateContext();
+void DestroyContext(void* aContext);
+void MakeCurrent(void* aContext);
+void GenTextures(int aCount, uint32_t* aResult);
+void DeleteTexture(uint32_t aTexture);
+void SetTextureBuffer(uint32_t aTexture, uint32_t aInternalFormat,
+                      int32_t aWidth, int32_t aHeight, int32_t aStride,
+                      void* aBuf, int32_t aMinWidth, int32_t aMinHeight);
+void* LockTexture(uint32_t aTexture);
+void UnlockResource(void* aResource);
+void SetCompositeBandThreads(int32_t aThreads);
+int32_t GetCompositeBandThreads();
+void Composite(void* aDst, void* aSrc, int32_t aSrcX, int32_t aSrcY,
+               int32_t aSrcWidth, int32_t aSrcHeight, int32_t aDstX,
+               int32_t aDstY, int32_t aDstWidth, int32_t aDstHeight,
+               uint8_t aOpaque, uint8_t aFlipX, uint8_t aFlipY,
+               uint32_t aFilter, int32_t aClipX, int32_t aClipY,
+               int32_t aClipWidth, int32_t aClipHeight);
+void CompositeYUV(void* aDst, void* aY, void* aU, void* aV,
+                  uint8_t aColorSpace, uint32_t aColorDepth, int32_t aSrcX,
+                  int32_t aSrcY, int32_t aSrcWidth, int32_t aSrcHeight,
+                  int32_t aDstX, int32_t aDstY, int32_t aDstWidth,
+                  int32_t aDstHeight, uint8_t aFlipX, uint8_t aFlipY,
+                  int32_t aClipX, int32_t aClipY, int32_t aClipWidth,
+                  int32_t aClipHeight);
+}
+
+namespace {
+
+// YUVRangedColorSpace::BT709_Narrow
+const uint8_t kBT709Narrow = 2;
+
+class SWGLSurface {
+ public:
+  SWGLSurface(uint32_t aFormat, int32_t aWidth, int32_t aHeight)
+      : mWidth(aWidth),
+        mHeight(aHeight),
+        mBpp(aFormat == LOCAL_GL_R8 ? 1 : 4),
+        mPixels(size_t(aWidth) * aHeight * mBpp) {
+    GenTextures(1, &mTexture);
+    SetTextureBuffer(mTexture, aFormat, aWidth, aHeight, aWidth * mBpp,
+                     mPixels.data(), aWidth, aHeight);
+    mLocked = LockTexture(mTexture);
+  }
+
+  ~SWGLSurface() {
+    UnlockResource(mLocked);
+    DeleteTexture(mTexture);
+  }
+
+  // Fills the surface with premultiplied noise, opaque if aOpaque.
+  void Fill(uint32_t aSeed, bool aOpaque) {
+    uint32_t state = aSeed * 2654435761u + 1;
+    for (size_t i = 0; i < mPixels.size(); i += mBpp) {
+      state = state * 1664525u + 1013904223u;
+      if (mBpp == 1) {
+        mPixels[i] = uint8_t(state >> 24);
+        continue;
+      }
+      uint8_t a = aOpaque ? 255 : uint8_t(state >> 24);
+      mPixels[i] = uint8_t((state >> 16) % (a + 1));
+      mPixels[i + 1] = uint8_t((state >> 8) % (a + 1));
+      mPixels[i + 2] = uint8_t(state % (a + 1));
+      mPixels[i + 3] = a;
+    }
+  }
+
+  bool operator==(const SWGLSurface& aOther) const {
+    return mPixels == aOther.mPixels;
+  }
+
+  const int32_t mWidth;
+  const int32_t mHeight;
+  const int32_t mBpp;
+  std::vector<uint8_t> mPixels;
+  uint32_t mTexture = 0;
+  void* mLocked = nullptr;
+};
+
+struct CompositeCase {
+  const char* mName;
+  int32_t mSrcWidth;
+  int32_t mSrcHeight;
+  bool mOpaque;
+  bool mFlipX;
+  bool mFlipY;
+  uint32_t mFilter;
+};
+
+const CompositeCase kCases[] = {
+    {"copy", 1920, 1080, true, false, false, LOCAL_GL_NEAREST},
+    {"blend", 1920, 1080, false, false, false, LOCAL_GL_NEAREST},
+    {"nearest-upscale", 1280, 720, true, false, true, LOCAL_GL_NEAREST},
+    {"linear-upscale", 1280, 720, true, false, false, LOCAL_GL_LINEAR},
+    {"linear-downscale-blend", 2560, 1440, false, false, true,
+     LOCAL_GL_LINEAR},
+    {"flip-x", 1920, 1080, false, true, false, LOCAL_GL_NEAREST},
+};
+
+}  // namespace
+
+class SWGLComposite : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mContext = CreateContext();
+    MakeCurrent(mContext);
+    mSavedBandThreads = GetCompositeBandThreads();
+  }
+
+  void TearDown() override {
+    SetCompositeBandThreads(mSavedBandThreads);
+    MakeCurrent(nullptr);
+    DestroyContext(mContext);
+  }
+
+  void RunCase(const CompositeCase& aCase, SWGLSurface& aDst, int32_t aClipY,
+               int32_t aClipHeight) {
+    SWGLSurface src(LOCAL_GL_RGBA8, aCase.mSrcWidth, aCase.mSrcHeight);
+    src.Fill(7, aCase.mOpaque);
+    Composite(aDst.mLocked, src.mLocked, 0, 0, aCase.mSrcWidth,
+              aCase.mSrcHeight, 0, 0, aDst.mWidth, aDst.mHeight,
+              aCase.mOpaque, aCase.mFlipX, aCase.mFlipY, aCase.mFilter, 0,
+              aClipY, aDst.mWidth, aClipHeight);
+  }
+
+  // Composites an opaque background and a translucent, scaled layer over the
+  // whole of aDst, as for one frame of a page.
+  void CompositeFrame(SWGLSurface& aDst, SWGLSurface& aBackground,
+                      SWGLSurface& aLayer) {
+    Composite(aDst.mLocked, aBackground.mLocked, 0, 0, aBackground.mWidth,
+              aBackground.mHeight, 0, 0, aDst.mWidth, aDst.mHeight, true,
+              false, false, LOCAL_GL_NEAREST, 0, 0, aDst.mWidth, aDst.mHeight);
+    Composite(aDst.mLocked, aLayer.mLocked, 0, 0, aLayer.mWidth,
+              aLayer.mHeight, 0, 0, aDst.mWidth, aDst.mHeight, false, false,
+              false, LOCAL_GL_LINEAR, 0, 0, aDst.mWidth, aDst.mHeight);
+  }
+
+  void BenchFrames(int32_t aWidth, int32_t aHeight, int32_t aThreads) {
+    SWGLSurface background(LOCAL_GL_RGBA8, aWidth, aHeight);
+    background.Fill(1, true);
+    SWGLSurface layer(LOCAL_GL_RGBA8, aWidth / 2, aHeight / 2);
+    layer.Fill(2, false);
+    SWGLSurface dst(LOCAL_GL_RGBA8, aWidth, aHeight);
+
+    SetCompositeBandThreads(aThreads);
+    for (int i = 0; i < 10; i++) {
+      CompositeFrame(dst, background, layer);
+    }
+  }
+
+  // A 1080p frame built from many small tiles, as when WebRender draws most
+  // of the frame into picture cache tiles. None of the composites is large
+  // enough to be split, so banding should cost nothing here.
+  void BenchTiledFrames(int32_t aThreads) {
+    const int32_t kTileSize = 256;
+    SWGLSurface tile(LOCAL_GL_RGBA8, kTileSize, kTileSize);
+    tile.Fill(3, false);
+    SWGLSurface dst(LOCAL_GL_RGBA8, 1920, 1080);
+
+    SetCompositeBandThreads(aThreads);
+    for (int i = 0; i < 10; i++) {
+      for (int32_t y = 0; y < dst.mHeight; y += kTileSize) {
+        for (int32_t x = 0; x < dst.mWidth; x += kTileSize) {
+          Composite(dst.mLocked, tile.mLocked, 0, 0, kTileSize, kTileSize, x,
+                    y, kTileSize, kTileSize, false, false, false,
+                    LOCAL_GL_NEAREST, 0, 0, dst.mWidth, dst.mHeight);
+        }
+      }
+    }
+  }
+
+  void* mContext = nullptr;
+  int32_t mSavedBandThreads = 1;
+};
+
+TEST_F(SWGLComposite, BandedMatchesSerial)
+{
+  for (const auto& testCase : kCases) {
+    SetCompositeBandThreads(1);
+    SWGLSurface serial(LOCAL_GL_RGBA8, 1920, 1080);
+    serial.Fill(3, true);
+    RunCase(testCase, serial, 0, 1080);
+
+    SetCompositeBandThreads(8);
+    SWGLSurface banded(LOCAL_GL_RGBA8, 1920, 1080);
+    banded.Fill(3, true);
+    RunCase(testCase, banded, 0, 1080);
+
+    EXPECT_TRUE(serial == banded) << testCase.mName;
+  }
+}
+
+TEST_F(SWGLComposite, BandedMatchesCallerBands)
+{
+  // The compositor may itself split a composite into bands with the clip
+  // rect. Internal banding must give the same result for a clipped band.
+  for (const auto& testCase : kCases) {
+    SetCompositeBandThreads(1);
+    SWGLSurface serial(LOCAL_GL_RGBA8, 1920, 1080);
+    serial.Fill(4, true);
+    RunCase(testCase, serial, 333, 600);
+
+    SetCompositeBandThreads(8);
+    SWGLSurface banded(LOCAL_GL_RGBA8, 1920, 1080);
+    banded.Fill(4, true);
+    RunCase(testCase, banded, 333, 600);
+
+    EXPECT_TRUE(serial == banded) << testCase.mName;
+  }
+}
+
+TEST_F(SWGLComposite, BandedYUVMatchesSerial)
+{
+  SWGLSurface y(LOCAL_GL_R8, 1280, 720);
+  y.Fill(5, true);
+  SWGLSurface u(LOCAL_GL_R8, 640, 360);
+  u.Fill(6, true);
+  SWGLSurface v(LOCAL_GL_R8, 640, 360);
+  v.Fill(7, true);
+
+  SWGLSurface* results[2];
+  SWGLSurface serial(LOCAL_GL_RGBA8, 1920, 1080);
+  SWGLSurface banded(LOCAL_GL_RGBA8, 1920, 1080);
+  results[0] = &serial;
+  results[1] = &banded;
+  for (int i = 0; i < 2; i++) {
+    SetCompositeBandThreads(i ? 8 : 1);
+    CompositeYUV(results[i]->mLocked, y.mLocked, u.mLocked, v.mLocked,
+                 kBT709Narrow, 8, 0, 0, 1280, 720, 0, 0, 1920, 1080, false,
+                 false, 0, 0, 1920, 1080);
+  }
+  EXPECT_TRUE(serial == banded);
+}
+
+MOZ_GTEST_BENCH_F(SWGLComposite, Frame1080pSerial,
+                  [this] { BenchFrames(1920, 1080, 1); });
+MOZ_GTEST_BENCH_F(SWGLComposite, Frame1080pBanded,
+                  [this] { BenchFrames(1920, 1080, 8); });
+MOZ_GTEST_BENCH_F(SWGLComposite, FrameFullPageSerial,
+                  [this] { BenchFrames(1920, 8192, 1); });
+MOZ_GTEST_BENCH_F(SWGLComposite, FrameFullPageBanded,
+                  [this] { BenchFrames(1920, 8192, 8); });
+MOZ_GTEST_BENCH_F(SWGLComposite, FrameTilesSerial,
+                  [this] { BenchTiledFrames(1); });
+MOZ_GTEST_BENCH_F(SWGLComposite, FrameTilesBanded,
+                  [this] { BenchTiledFrames(8); });
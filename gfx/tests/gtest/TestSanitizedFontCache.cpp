@@ -0,0 +1,242 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include <stdlib.h>
+
+#include "gfxOTSUtils.h"
+#include "gfxUserFontSet.h"
+#include "mozilla/Preferences.h"
+#include "mozilla/SyncRunnable.h"
+#include "nsAppDirectoryServiceDefs.h"
+#include "nsDirectoryServiceUtils.h"
+#include "nsIDirectoryEnumerator.h"
+#include "nsIFile.h"
+#include "nsThreadUtils.h"
+
+using namespace mozilla;
+
+using SanitizedFontCache = gfxUserFontEntry::SanitizedFontCache;
+using OTSMessage = gfxUserFontEntry::OTSMessage;
+
+namespace {
+
+nsTArray<uint8_t> MakeFontData(uint32_t aLength, uint8_t aSeed) {
+  nsTArray<uint8_t> data;
+  data.SetLength(aLength);
+  for (uint32_t i = 0; i < aLength; i++) {
+    data[i] = uint8_t(aSeed + i * 7);
+  }
+  return data;
+}
+
+SanitizedFontCache::Key KeyFor(const nsTArray<uint8_t>& aData) {
+  // Keyed by the options the sanitizer would use now.
+  return SanitizedFontCache::ComputeKey(aData.Elements(), aData.Length(),
+                                        gfxOTSContext().Options());
+}
+
+void Put(const nsTArray<uint8_t>& aData, const nsACString& aFullName) {
+  // Stands in for the sanitizer's output, which is a different font.
+  nsTArray<uint8_t> sane = aData.Clone();
+  sane.AppendElement(0);
+  SanitizedFontCache::Put(KeyFor(aData), sane.Elements(), sane.Length(),
+                          aFullName, nsTArray<OTSMessage>());
+}
+
+// Returns whether the font is cached, and checks the cached data if it is.
+bool Get(const nsTArray<uint8_t>& aData, const char* aFullName) {
+  const uint8_t* sane = nullptr;
+  uint32_t saneLength = 0;
+  nsAutoCString fullName;
+  nsTArray<OTSMessage> messages;
+  if (!SanitizedFontCache::Get(KeyFor(aData), sane, saneLength, fullName,
+                               messages)) {
+    return false;
+  }
+  EXPECT_TRUE(sane);
+  EXPECT_EQ(saneLength, aData.Length() + 1);
+  if (sane && saneLength == aData.Length() + 1) {
+    EXPECT_EQ(memcmp(sane, aData.Elements(), aData.Length()), 0);
+  }
+  EXPECT_TRUE(fullName.Equals(aFullName));
+  EXPECT_TRUE(messages.IsEmpty());
+  free(const_cast<uint8_t*>(sane));
+  return true;
+}
+
+SanitizedFontCache::Stats GetStats() {
+  return SanitizedFontCache::GetStats([](const void*) -> size_t { return 0; });
+}
+
+}  // namespace
+
+class SanitizedFontCacheTest : public ::testing::Test {
+ protected:
+  void TearDown() override { SanitizedFontCache::Shutdown(); }
+};
+
+TEST_F(SanitizedFontCacheTest, HitsAndMisses)
+{
+  SanitizedFontCache::InitForTesting(1024 * 1024, ""_ns);
+  SanitizedFontCache::Stats before = GetStats();
+
+  nsTArray<uint8_t> font = MakeFontData(1000, 1);
+  EXPECT_FALSE(Get(font, "Font"));
+  Put(font, "Font"_ns);
+  EXPECT_TRUE(Get(font, "Font"));
+  EXPECT_TRUE(Get(font, "Font"));
+
+  // A font of the same length with different contents has its own entry.
+  EXPECT_FALSE(Get(MakeFontData(1000, 2), "Font"));
+
+  SanitizedFontCache::Stats after = GetStats();
+  EXPECT_EQ(after.mHits - before.mHits, 2u);
+  EXPECT_EQ(after.mMisses - before.mMisses, 2u);
+  EXPECT_EQ(after.mDiskHits, before.mDiskHits);
+  EXPECT_EQ(after.mEntries, 1u);
+
+  SanitizedFontCache::Clear();
+  EXPECT_FALSE(Get(font, "Font"));
+  EXPECT_EQ(GetStats().mEntries, 0u);
+}
+
+TEST_F(SanitizedFontCacheTest, EvictsLeastRecentlyUsed)
+{
+  // Room for three of the fonts below, but not for four.
+  SanitizedFontCache::InitForTesting(10000, ""_ns);
+  SanitizedFontCache::Stats before = GetStats();
+
+  nsTArray<uint8_t> fonts[4];
+  for (uint8_t i = 0; i < 4; i++) {
+    fonts[i] = MakeFontData(3000, i);
+  }
+  Put(fonts[0], "A"_ns);
+  Put(fonts[1], "B"_ns);
+  Put(fonts[2], "C"_ns);
+  EXPECT_EQ(GetStats().mEntries, 3u);
+
+  // Using A makes B the least recently used entry.
+  EXPECT_TRUE(Get(fonts[0], "A"));
+  Put(fonts[3], "D"_ns);
+
+  SanitizedFontCache::Stats after = GetStats();
+  EXPECT_EQ(after.mEvictions - before.mEvictions, 1u);
+  EXPECT_EQ(after.mEntries, 3u);
+  EXPECT_FALSE(Get(fonts[1], "B"));
+  EXPECT_TRUE(Get(fonts[0], "A"));
+  EXPECT_TRUE(Get(fonts[2], "C"));
+  EXPECT_TRUE(Get(fonts[3], "D"));
+
+  // A font larger than the whole cache is not stored, and evicts nothing.
+  nsTArray<uint8_t> huge = MakeFontData(20000, 5);
+  Put(huge, "Huge"_ns);
+  EXPECT_FALSE(Get(huge, "Huge"));
+  EXPECT_EQ(GetStats().mEntries, 3u);
+}
+
+TEST_F(SanitizedFontCacheTest, ReplaysRejection)
+{
+  SanitizedFontCache::InitForTesting(1024 * 1024, ""_ns);
+
+  nsTArray<uint8_t> font = MakeFontData(500, 3);
+  nsTArray<OTSMessage> messages;
+  messages.AppendElement(OTSMessage{"hmtx: Failed to read table"_ns, 0});
+  messages.AppendElement(OTSMessage{"name: Dropped duplicate record"_ns, 1});
+  SanitizedFontCache::Put(KeyFor(font), nullptr, 0, ""_ns, messages);
+
+  const uint8_t* sane = reinterpret_cast<const uint8_t*>(1);
+  uint32_t saneLength = 1;
+  nsAutoCString fullName;
+  nsTArray<OTSMessage> replayed;
+  ASSERT_TRUE(SanitizedFontCache::Get(KeyFor(font), sane, saneLength, fullName,
+                                      replayed));
+  EXPECT_EQ(sane, nullptr);
+  EXPECT_EQ(saneLength, 0u);
+  ASSERT_EQ(replayed.Length(), messages.Length());
+  for (size_t i = 0; i < messages.Length(); i++) {
+    EXPECT_TRUE(replayed[i].mMessage.Equals(messages[i].mMessage));
+    EXPECT_EQ(replayed[i].mLevel, messages[i].mLevel);
+  }
+}
+
+TEST_F(SanitizedFontCacheTest, KeyedBySanitizerOptions)
+{
+  SanitizedFontCache::InitForTesting(1024 * 1024, ""_ns);
+
+  nsTArray<uint8_t> font = MakeFontData(1000, 6);
+  Put(font, "Font"_ns);
+  EXPECT_TRUE(Get(font, "Font"));
+
+  // With the pref flipped, the sanitizer keeps different tables, so the
+  // entry from before must not be used.
+  const char* pref = "gfx.downloadable_fonts.keep_color_bitmaps";
+  bool keepColorBitmaps = Preferences::GetBool(pref);
+  Preferences::SetBool(pref, !keepColorBitmaps);
+  EXPECT_FALSE(Get(font, "Font"));
+  Put(font, "Flipped"_ns);
+  EXPECT_TRUE(Get(font, "Flipped"));
+
+  Preferences::ClearUser(pref);
+  EXPECT_TRUE(Get(font, "Font"));
+  EXPECT_EQ(GetStats().mEntries, 2u);
+}
+
+TEST_F(SanitizedFontCacheTest, DiskRoundTrip)
+{
+  nsCOMPtr<nsIFile> dir;
+  ASSERT_EQ(NS_GetSpecialDirectory(NS_OS_TEMP_DIR, getter_AddRefs(dir)),
+            NS_OK);
+  ASSERT_EQ(dir->AppendNative("sanitized-font-cache"_ns), NS_OK);
+  ASSERT_EQ(dir->CreateUnique(nsIFile::DIRECTORY_TYPE, 0700), NS_OK);
+  nsAutoCString path;
+  ASSERT_EQ(dir->GetNativePath(path), NS_OK);
+
+  SanitizedFontCache::InitForTesting(1024 * 1024, path);
+  SanitizedFontCache::Stats before = GetStats();
+  nsTArray<uint8_t> font = MakeFontData(4000, 4);
+
+  // The disk cache is only written and read off the main thread.
+  nsCOMPtr<nsIThread> thread;
+  ASSERT_EQ(NS_NewNamedThread("FontCacheTest", getter_AddRefs(thread)), NS_OK);
+  auto runOnThread = [&](auto aFunc) {
+    nsCOMPtr<nsIRunnable> runnable =
+        NS_NewRunnableFunction("TestSanitizedFontCache", aFunc);
+    SyncRunnable::DispatchToThread(thread, runnable);
+  };
+
+  runOnThread([&] { Put(font, "Disk Font"_ns); });
+  SanitizedFontCache::Clear();
+
+  // The main thread does not look on disk.
+  EXPECT_FALSE(Get(font, "Disk Font"));
+  bool found = false;
+  runOnThread([&] { found = Get(font, "Disk Font"); });
+  EXPECT_TRUE(found);
+
+  SanitizedFontCache::Stats after = GetStats();
+  EXPECT_EQ(after.mDiskHits - before.mDiskHits, 1u);
+  EXPECT_EQ(after.mHits - before.mHits, 1u);
+  // The font read from disk is kept in memory again.
+  EXPECT_TRUE(Get(font, "Disk Font"));
+
+  // A damaged file is ignored.
+  SanitizedFontCache::Clear();
+  nsCOMPtr<nsIDirectoryEnumerator> entries;
+  ASSERT_EQ(dir->GetDirectoryEntries(getter_AddRefs(entries)), NS_OK);
+  nsCOMPtr<nsIFile> file;
+  ASSERT_EQ(entries->GetNextFile(getter_AddRefs(file)), NS_OK);
+  ASSERT_TRUE(file);
+  int64_t size = 0;
+  ASSERT_EQ(file->GetFileSize(&size), NS_OK);
+  ASSERT_EQ(file->SetFileSize(size - 1), NS_OK);
+  runOnThread([&] { found = Get(font, "Disk Font"); });
+  EXPECT_FALSE(found);
+
+  thread->Shutdown();
+  dir->Remove(true);
+}
@@ -206,6 +206,7 @@ gfxFontCache::~gfxFontCache() {
   // so they aren't kept alive after the font instances and font-list
   // have been shut down.
   gfxUserFontSet::UserFontCache::Shutdown();
+  gfxUserFontEntry::SanitizedFontCache::Shutdown();
 
   if (mWordCacheExpirationTimer) {
     mWordCacheExpirationTimer->Cancel();
@@ -141,6 +141,15 @@ class MOZ_STACK_CLASS gfxOTSContext : public ots::OTSContext {
     return ots::TABLE_ACTION_DEFAULT;
   }
 
+  // The settings above as bits. Caches of the sanitizer's output must key
+  // their entries by these, as they change which tables are kept.
+  uint32_t Options() const {
+    return (mCheckOTLTables ? 1 << 0 : 0) |
+           (mCheckVariationTables ? 1 << 1 : 0) |
+           (mKeepColorBitmaps ? 1 << 2 : 0) | (mKeepSVG ? 1 << 3 : 0) |
+           (gfxPlatform::HasVariationFontSupport() ? 1 << 4 : 0);
+  }
+
   static size_t GuessSanitizedFontSize(size_t aLength,
                                        gfxUserFontType aFontType,
                                        bool aStrict = true) {
@@ -10,9 +10,15 @@
 #include "gfxFontConstants.h"
 #include "mozilla/Atomics.h"
 #include "mozilla/FontPropertyTypes.h"
+#include "mozilla/HashTable.h"
+#include "mozilla/LinkedList.h"
+#include "mozilla/Maybe.h"
 #include "mozilla/Preferences.h"
 #include "mozilla/ProfilerLabels.h"
+#include "mozilla/RandomNum.h"
 #include "mozilla/Services.h"
+#include "mozilla/StaticMutex.h"
+#include "mozilla/StaticPtr.h"
 #include "mozilla/StaticPrefs_gfx.h"
 #include "mozilla/Telemetry.h"
 #include "mozilla/gfx/2D.h"
@@ -22,6 +28,8 @@
 #include "nsIFontLoadCompleteCallback.h"
 #include "nsProxyRelease.h"
 #include "nsTHashSet.h"
+#include "prenv.h"
+#include "prio.h"
 
 using namespace mozilla;
 
@@ -163,31 +171,65 @@ class MOZ_STACK_CLASS gfxOTSMessageContext : public gfxOTSContext {
   nsTArray<gfxUserFontEntry::OTSMessage> mMessages;
 };
 
+bool gfxUserFontEntry::UseSanitizedFontCache() const {
+  MOZ_ASSERT(NS_IsMainThread());
+  RefPtr<gfxUserFontSet> fontSet = GetUserFontSet();
+  if (!fontSet || fontSet->GetPrivateBrowsing() || fontSet->BypassCache() ||
+      Preferences::GetBool("gfx.downloadable_fonts.disable_cache")) {
+    return false;
+  }
+  return SanitizedFontCache::Init();
+}
+
 // Call the OTS library to sanitize an sfnt before attempting to use it.
 // Returns a newly-allocated block, or nullptr in case of fatal errors.
 const uint8_t* gfxUserFontEntry::SanitizeOpenTypeData(
-    const uint8_t* aData, uint32_t aLength, uint32_t& aSaneLength,
-    gfxUserFontType& aFontType, nsTArray<OTSMessage>& aMessages) {
+    const uint8_t* aData, uint32_t aLength, bool aUseCache,
+    uint32_t& aSaneLength, gfxUserFontType& aFontType, nsACString& aFullName,
+    nsTArray<OTSMessage>& aMessages) {
   aFontType = gfxFontUtils::DetermineFontDataType(aData, aLength);
   Telemetry::Accumulate(Telemetry::WEBFONT_FONTTYPE, uint32_t(aFontType));
 
+  aSaneLength = 0;
   size_t lengthHint = gfxOTSContext::GuessSanitizedFontSize(aLength, aFontType);
   if (!lengthHint) {
-    aSaneLength = 0;
     return nullptr;
   }
 
+  gfxOTSMessageContext otsContext;
+  Maybe<SanitizedFontCache::Key> key;
+  if (aUseCache) {
+    key.emplace(
+        SanitizedFontCache::ComputeKey(aData, aLength, otsContext.Options()));
+    const uint8_t* saneData;
+    if (SanitizedFontCache::Get(*key, saneData, aSaneLength, aFullName,
+                                aMessages)) {
+      return saneData;
+    }
+  }
+
   gfxOTSExpandingMemoryStream<gfxOTSMozAlloc> output(lengthHint);
 
-  gfxOTSMessageContext otsContext;
-  if (!otsContext.Process(&output, aData, aLength, aMessages)) {
-    // Failed to decode/sanitize the font, so discard it.
-    aSaneLength = 0;
-    return nullptr;
+  const uint8_t* saneData = nullptr;
+  if (otsContext.Process(&output, aData, aLength, aMessages)) {
+    aSaneLength = output.Tell();
+    saneData = static_cast<const uint8_t*>(output.forget());
+
+    // Because platform font activation code may replace the name table
+    // in the font with a synthetic one, we save the original name so that
+    // it can be reported via the InspectorUtils API.
+    // The sanitizer ensures that we have a valid sfnt and a usable
+    // name table, so this should never fail unless we're out of
+    // memory, and GetFullNameFromSFNT is not directly exposed to
+    // arbitrary/malicious data from the web.
+    gfxFontUtils::GetFullNameFromSFNT(saneData, aSaneLength, aFullName);
   }
+  // Otherwise we failed to decode/sanitize the font, so discard it.
 
-  aSaneLength = output.Tell();
-  return static_cast<const uint8_t*>(output.forget());
+  if (key) {
+    SanitizedFontCache::Put(*key, saneData, aSaneLength, aFullName, aMessages);
+  }
+  return saneData;
 }
 
 void gfxUserFontEntry::StoreUserFontData(gfxFontEntry* aFontEntry,
@@ -614,33 +656,38 @@ bool gfxUserFontEntry::LoadPlatformFontSync(uint32_t aSrcIndex,
   // if necessary. The original data in aFontData is left unchanged.
   uint32_t saneLen;
   gfxUserFontType fontType;
+  nsAutoCString fullName;
   nsTArray<OTSMessage> messages;
   const uint8_t* saneData =
-      SanitizeOpenTypeData(aFontData, aLength, saneLen, fontType, messages);
+      SanitizeOpenTypeData(aFontData, aLength, UseSanitizedFontCache(),
+                           saneLen, fontType, fullName, messages);
 
   return LoadPlatformFont(aSrcIndex, aFontData, aLength, fontType, saneData,
-                          saneLen, std::move(messages));
+                          saneLen, fullName, std::move(messages));
 }
 
 void gfxUserFontEntry::StartPlatformFontLoadOnBackgroundThread(
     uint32_t aSrcIndex, const uint8_t* aFontData, uint32_t aLength,
+    bool aUseCache,
     nsMainThreadPtrHandle<nsIFontLoadCompleteCallback> aCallback) {
   MOZ_ASSERT(!NS_IsMainThread());
 
   uint32_t saneLen;
   gfxUserFontType fontType;
+  nsCString fullName;
   nsTArray<OTSMessage> messages;
-  const uint8_t* saneData =
-      SanitizeOpenTypeData(aFontData, aLength, saneLen, fontType, messages);
+  const uint8_t* saneData = SanitizeOpenTypeData(
+      aFontData, aLength, aUseCache, saneLen, fontType, fullName, messages);
 
   nsCOMPtr<nsIRunnable> event =
       NewRunnableMethod<uint32_t, const uint8_t*, uint32_t, gfxUserFontType,
-                        const uint8_t*, uint32_t, nsTArray<OTSMessage>&&,
+                        const uint8_t*, uint32_t, nsCString&&,
+                        nsTArray<OTSMessage>&&,
                         nsMainThreadPtrHandle<nsIFontLoadCompleteCallback>>(
           "gfxUserFontEntry::ContinuePlatformFontLoadOnMainThread", this,
           &gfxUserFontEntry::ContinuePlatformFontLoadOnMainThread, aSrcIndex,
-          aFontData, aLength, fontType, saneData, saneLen, std::move(messages),
-          aCallback);
+          aFontData, aLength, fontType, saneData, saneLen, std::move(fullName),
+          std::move(messages), aCallback);
   NS_DispatchToMainThread(event.forget());
 }
 
@@ -650,6 +697,7 @@ bool gfxUserFontEntry::LoadPlatformFont(uint32_t aSrcIndex,
                                         gfxUserFontType aFontType,
                                         const uint8_t* aSanitizedFontData,
                                         uint32_t aSanitizedLength,
+                                        const nsACString& aOriginalFullName,
                                         nsTArray<OTSMessage>&& aMessages) {
   MOZ_ASSERT(NS_IsMainThread());
   RefPtr<gfxUserFontSet> fontSet = GetUserFontSet();
@@ -678,11 +726,6 @@ bool gfxUserFontEntry::LoadPlatformFont(uint32_t aSrcIndex,
     }
   }
 
-  // Because platform font activation code may replace the name table
-  // in the font with a synthetic one, we save the original name so that
-  // it can be reported via the InspectorUtils API.
-  nsAutoCString originalFullName;
-
   gfxFontEntry* fe = nullptr;
   uint32_t fontCompressionRatio = 0;
   size_t computedSize = 0;
@@ -699,13 +742,6 @@ bool gfxUserFontEntry::LoadPlatformFont(uint32_t aSrcIndex,
       }
     }
 
-    // The sanitizer ensures that we have a valid sfnt and a usable
-    // name table, so this should never fail unless we're out of
-    // memory, and GetFullNameFromSFNT is not directly exposed to
-    // arbitrary/malicious data from the web.
-    gfxFontUtils::GetFullNameFromSFNT(aSanitizedFontData, aSanitizedLength,
-                                      originalFullName);
-
     // Record size for memory reporting purposes. We measure this now
     // because by the time we potentially want to collect reports, this
     // data block may have been handed off to opaque OS font APIs that
@@ -755,7 +791,7 @@ bool gfxUserFontEntry::LoadPlatformFont(uint32_t aSrcIndex,
     fe->mLineGapOverride = mLineGapOverride;
     fe->mSizeAdjust = mSizeAdjust;
     StoreUserFontData(fe, aSrcIndex, fontSet->GetPrivateBrowsing(),
-                      originalFullName, &metadata, metaOrigLen, compression);
+                      aOriginalFullName, &metadata, metaOrigLen, compression);
     if (LOG_ENABLED()) {
       LOG((
           "userfonts (%p) [src %d] loaded uri: (%s) for (%s) "
@@ -870,11 +906,11 @@ void gfxUserFontEntry::LoadPlatformFontAsync(
   mLoadingFontSet = GetUserFontSet();
 
   nsCOMPtr<nsIRunnable> event =
-      NewRunnableMethod<uint32_t, const uint8_t*, uint32_t,
+      NewRunnableMethod<uint32_t, const uint8_t*, uint32_t, bool,
                         nsMainThreadPtrHandle<nsIFontLoadCompleteCallback>>(
           "gfxUserFontEntry::StartPlatformFontLoadOnBackgroundThread", this,
           &gfxUserFontEntry::StartPlatformFontLoadOnBackgroundThread, aSrcIndex,
-          aFontData, aLength, cb);
+          aFontData, aLength, UseSanitizedFontCache(), cb);
   MOZ_ALWAYS_SUCCEEDS(NS_DispatchBackgroundTask(event.forget()));
 }
 
@@ -882,13 +918,14 @@ void gfxUserFontEntry::ContinuePlatformFontLoadOnMainThread(
     uint32_t aSrcIndex, const uint8_t* aOriginalFontData,
     uint32_t aOriginalLength, gfxUserFontType aFontType,
     const uint8_t* aSanitizedFontData, uint32_t aSanitizedLength,
-    nsTArray<OTSMessage>&& aMessages,
+    nsCString&& aOriginalFullName, nsTArray<OTSMessage>&& aMessages,
     nsMainThreadPtrHandle<nsIFontLoadCompleteCallback> aCallback) {
   MOZ_ASSERT(NS_IsMainThread());
 
-  bool loaded = LoadPlatformFont(aSrcIndex, aOriginalFontData, aOriginalLength,
-                                 aFontType, aSanitizedFontData,
-                                 aSanitizedLength, std::move(aMessages));
+  bool loaded = LoadPlatformFont(
+      aSrcIndex, aOriginalFontData, aOriginalLength, aFontType,
+      aSanitizedFontData, aSanitizedLength, aOriginalFullName,
+      std::move(aMessages));
   aOriginalFontData = nullptr;
   aSanitizedFontData = nullptr;
 
@@ -1404,5 +1441,503 @@ void gfxUserFontSet::UserFontCache::Dump() {
 
 #endif
 
+///////////////////////////////////////////////////////////////////////////////
+// gfxUserFontEntry::SanitizedFontCache - share the output of the OTS
+// sanitizer between all loads of the same font data.
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+using SanitizedFontCache = gfxUserFontEntry::SanitizedFontCache;
+
+struct SanitizedFontMessage {
+  nsCString mMessage;
+  int mLevel;
+};
+
+class SanitizedFontCacheEntry
+    : public LinkedListElement<SanitizedFontCacheEntry> {
+ public:
+  explicit SanitizedFontCacheEntry(const SanitizedFontCache::Key& aKey)
+      : mKey(aKey) {}
+
+  // What this entry counts against the size limit of the cache.
+  size_t Size() const {
+    return sizeof(*this) + mSaneData.Length() + mFullName.Length();
+  }
+
+  size_t SizeOfIncludingThis(MallocSizeOf aMallocSizeOf) const {
+    size_t n = aMallocSizeOf(this) +
+               mSaneData.ShallowSizeOfExcludingThis(aMallocSizeOf) +
+               mFullName.SizeOfExcludingThisIfUnshared(aMallocSizeOf) +
+               mMessages.ShallowSizeOfExcludingThis(aMallocSizeOf);
+    for (const auto& msg : mMessages) {
+      n += msg.mMessage.SizeOfExcludingThisIfUnshared(aMallocSizeOf);
+    }
+    return n;
+  }
+
+  const SanitizedFontCache::Key mKey;
+  // Empty if the sanitizer rejected the font.
+  nsTArray<uint8_t> mSaneData;
+  nsCString mFullName;
+  nsTArray<SanitizedFontMessage> mMessages;
+};
+
+struct SanitizedFontKeyHasher {
+  using Lookup = SanitizedFontCache::Key;
+  static HashNumber hash(const Lookup& aKey) {
+    return AddToHash(aKey.mHash, aKey.mOptions);
+  }
+  static bool match(const Lookup& aKey, const Lookup& aLookup) {
+    return aKey == aLookup;
+  }
+};
+
+struct SanitizedFontCacheState {
+  ~SanitizedFontCacheState() {
+    // The entries are owned by mEntries.
+    mLRU.clear();
+  }
+
+  HashMap<SanitizedFontCache::Key, UniquePtr<SanitizedFontCacheEntry>,
+          SanitizedFontKeyHasher>
+      mEntries;
+  // Least recently used first.
+  LinkedList<SanitizedFontCacheEntry> mLRU;
+  size_t mBytes = 0;
+  size_t mCapacity = 0;
+  // Empty unless entries are written to disk.
+  nsCString mDiskCacheDir;
+};
+
+StaticMutex sSanitizedFontCacheMutex MOZ_UNANNOTATED;
+StaticAutoPtr<SanitizedFontCacheState> sSanitizedFontCache;
+
+Atomic<uint64_t, Relaxed> sSanitizedFontHits;
+Atomic<uint64_t, Relaxed> sSanitizedFontDiskHits;
+Atomic<uint64_t, Relaxed> sSanitizedFontMisses;
+Atomic<uint64_t, Relaxed> sSanitizedFontEvictions;
+
+const size_t kDefaultSanitizedFontCacheKB = 32 * 1024;
+
+// Files in the disk cache are a DiskCacheHeader followed by the full name
+// and the sanitized font. The sanitizer's messages are not stored, as only
+// fonts without errors are written out.
+const uint32_t kDiskCacheMagic = 0x4f545343;  // "OTSC"
+// Version 2 added mOptions.
+const uint32_t kDiskCacheVersion = 2;
+// Larger than any font the sanitizer produces.
+const uint32_t kDiskCacheMaxFontLength = 256 * 1024 * 1024;
+const uint32_t kDiskCacheMaxNameLength = 64 * 1024;
+
+struct DiskCacheHeader {
+  uint32_t mMagic;
+  uint32_t mVersion;
+  // The Key::mOptions of the entry, which is also part of the file name.
+  uint32_t mOptions;
+  uint32_t mNameLength;
+  uint32_t mSaneLength;
+  // HashBytes of the sanitized font, to catch truncated or damaged files.
+  uint32_t mSaneHash;
+};
+
+void InsertSanitizedFont(SanitizedFontCacheState& aState,
+                         UniquePtr<SanitizedFontCacheEntry> aEntry) {
+  size_t size = aEntry->Size();
+  if (size > aState.mCapacity) {
+    return;
+  }
+
+  if (auto p = aState.mEntries.lookup(aEntry->mKey)) {
+    // Another thread sanitized the same font at the same time.
+    aState.mBytes -= p->value()->Size();
+    aState.mEntries.remove(p);
+  }
+
+  SanitizedFontCacheEntry* entry = aEntry.get();
+  if (!aState.mEntries.put(entry->mKey, std::move(aEntry))) {
+    return;
+  }
+  aState.mLRU.insertBack(entry);
+  aState.mBytes += size;
+
+  while (aState.mBytes > aState.mCapacity) {
+    SanitizedFontCacheEntry* oldest = aState.mLRU.popFirst();
+    aState.mBytes -= oldest->Size();
+    aState.mEntries.remove(oldest->mKey);
+    sSanitizedFontEvictions++;
+  }
+}
+
+const uint8_t* CopySanitizedFont(const uint8_t* aData, uint32_t aLength) {
+  void* copy = malloc(aLength);
+  if (copy) {
+    memcpy(copy, aData, aLength);
+  }
+  return static_cast<const uint8_t*>(copy);
+}
+
+nsCString DiskCachePath(const nsACString& aDir,
+                        const SanitizedFontCache::Key& aKey) {
+  nsCString path(aDir);
+  path.Append('/');
+  for (uint8_t byte : aKey.mDigest) {
+    path.AppendPrintf("%02x", byte);
+  }
+  path.AppendPrintf("-%u-%x.font", aKey.mLength, aKey.mOptions);
+  return path;
+}
+
+bool ReadExactly(PRFileDesc* aFd, void* aBuffer, uint32_t aLength) {
+  return PR_Read(aFd, aBuffer, int32_t(aLength)) == int32_t(aLength);
+}
+
+bool WriteExactly(PRFileDesc* aFd, const void* aBuffer, uint32_t aLength) {
+  return PR_Write(aFd, aBuffer, int32_t(aLength)) == int32_t(aLength);
+}
+
+UniquePtr<SanitizedFontCacheEntry> ReadSanitizedFontFromDisk(
+    const nsACString& aDir, const SanitizedFontCache::Key& aKey) {
+  MOZ_ASSERT(!NS_IsMainThread());
+  nsCString path = DiskCachePath(aDir, aKey);
+  PRFileDesc* fd = PR_Open(path.get(), PR_RDONLY, 0);
+  if (!fd) {
+    return nullptr;
+  }
+
+  auto entry = MakeUnique<SanitizedFontCacheEntry>(aKey);
+  DiskCacheHeader header;
+  bool ok = ReadExactly(fd, &header, sizeof(header)) &&
+            header.mMagic == kDiskCacheMagic &&
+            header.mVersion == kDiskCacheVersion &&
+            header.mOptions == aKey.mOptions &&
+            header.mNameLength <= kDiskCacheMaxNameLength &&
+            header.mSaneLength && header.mSaneLength <= kDiskCacheMaxFontLength;
+  if (ok) {
+    char* name;
+    ok = entry->mFullName.GetMutableData(&name, header.mNameLength,
+                                         fallible) &&
+         ReadExactly(fd, name, header.mNameLength);
+  }
+  if (ok) {
+    uint8_t* data =
+        entry->mSaneData.AppendElements(header.mSaneLength, fallible);
+    ok = data && ReadExactly(fd, data, header.mSaneLength) &&
+         HashBytes(data, header.mSaneLength) == header.mSaneHash;
+  }
+  PR_Close(fd);
+
+  if (!ok) {
+    LOG(("userfonts (sanitized) ignoring damaged cache file %s", path.get()));
+    return nullptr;
+  }
+  return entry;
+}
+
+void WriteSanitizedFontToDisk(const nsACString& aDir,
+                              const SanitizedFontCacheEntry& aEntry) {
+  MOZ_ASSERT(!NS_IsMainThread());
+  MOZ_ASSERT(!aEntry.mSaneData.IsEmpty());
+  nsCString path = DiskCachePath(aDir, aEntry.mKey);
+
+  // Write to a temporary file first, so that other processes never see a
+  // partially written entry.
+  nsCString tempPath(path);
+  tempPath.AppendPrintf(".%" PRIx64 ".tmp", RandomUint64().valueOr(0));
+  PRFileDesc* fd =
+      PR_Open(tempPath.get(), PR_WRONLY | PR_CREATE_FILE | PR_TRUNCATE, 0600);
+  if (!fd) {
+    return;
+  }
+
+  DiskCacheHeader header = {
+      kDiskCacheMagic, kDiskCacheVersion, aEntry.mKey.mOptions,
+      uint32_t(aEntry.mFullName.Length()),
+      uint32_t(aEntry.mSaneData.Length()),
+      HashBytes(aEntry.mSaneData.Elements(), aEntry.mSaneData.Length())};
+  bool ok = WriteExactly(fd, &header, sizeof(header)) &&
+            WriteExactly(fd, aEntry.mFullName.get(), header.mNameLength) &&
+            WriteExactly(fd, aEntry.mSaneData.Elements(), header.mSaneLength);
+  PR_Close(fd);
+
+  if (!ok || PR_Rename(tempPath.get(), path.get()) != PR_SUCCESS) {
+    // PR_Rename fails if another process wrote the entry in the meantime.
+    PR_Delete(tempPath.get());
+  }
+}
+
+class SanitizedFontCacheFlusher final : public nsIObserver {
+  ~SanitizedFontCacheFlusher() = default;
+
+ public:
+  NS_DECL_ISUPPORTS
+
+  NS_IMETHOD Observe(nsISupports* aSubject, const char* aTopic,
+                     const char16_t* aData) override {
+    MOZ_ASSERT(!strcmp(aTopic, "cacheservice:empty-cache"));
+    SanitizedFontCache::Clear();
+    return NS_OK;
+  }
+};
+
+NS_IMPL_ISUPPORTS(SanitizedFontCacheFlusher, nsIObserver)
+
+MOZ_DEFINE_MALLOC_SIZE_OF(SanitizedFontCacheMallocSizeOf)
+
+class SanitizedFontCacheReporter final : public nsIMemoryReporter {
+  ~SanitizedFontCacheReporter() = default;
+
+ public:
+  NS_DECL_ISUPPORTS
+
+  NS_IMETHOD CollectReports(nsIHandleReportCallback* aHandleReport,
+                            nsISupports* aData, bool aAnonymize) override {
+    SanitizedFontCache::Stats stats =
+        SanitizedFontCache::GetStats(SanitizedFontCacheMallocSizeOf);
+
+    MOZ_COLLECT_REPORT(
+        "explicit/gfx/sanitized-font-cache", KIND_HEAP, UNITS_BYTES,
+        stats.mBytes,
+        "Memory used by the cache of sanitized downloadable fonts.");
+    MOZ_COLLECT_REPORT("gfx-sanitized-font-cache-entries", KIND_OTHER,
+                       UNITS_COUNT, stats.mEntries,
+                       "Number of fonts in the sanitized font cache.");
+    MOZ_COLLECT_REPORT(
+        "gfx-sanitized-font-cache-hits", KIND_OTHER, UNITS_COUNT_CUMULATIVE,
+        stats.mHits,
+        "Downloaded fonts which were found in the sanitized font cache, "
+        "including those read from disk.");
+    MOZ_COLLECT_REPORT(
+        "gfx-sanitized-font-cache-disk-hits", KIND_OTHER,
+        UNITS_COUNT_CUMULATIVE, stats.mDiskHits,
+        "Downloaded fonts which were read from the on-disk sanitized font "
+        "cache.");
+    MOZ_COLLECT_REPORT(
+        "gfx-sanitized-font-cache-misses", KIND_OTHER, UNITS_COUNT_CUMULATIVE,
+        stats.mMisses,
+        "Downloaded fonts which had to be run through the sanitizer.");
+    MOZ_COLLECT_REPORT(
+        "gfx-sanitized-font-cache-evictions", KIND_OTHER,
+        UNITS_COUNT_CUMULATIVE, stats.mEvictions,
+        "Fonts evicted from the sanitized font cache to stay within its "
+        "size limit.");
+    return NS_OK;
+  }
+};
+
+NS_IMPL_ISUPPORTS(SanitizedFontCacheReporter, nsIMemoryReporter)
+
+}  // namespace
+
+/* static */
+SanitizedFontCache::Key SanitizedFontCache::ComputeKey(const uint8_t* aData,
+                                                       uint32_t aLength,
+                                                       uint32_t aOptions) {
+  Key key;
+  SHA1Sum sum;
+  sum.update(aData, aLength);
+  sum.finish(key.mDigest);
+  key.mLength = aLength;
+  key.mHash = HashBytes(aData, aLength);
+  key.mOptions = aOptions;
+  return key;
+}
+
+/* static */
+bool SanitizedFontCache::Init() {
+  MOZ_ASSERT(NS_IsMainThread());
+  static bool sInitialized = false;
+  static bool sEnabled = false;
+  if (sInitialized) {
+    return sEnabled;
+  }
+  sInitialized = true;
+
+  size_t capacityKB = kDefaultSanitizedFontCacheKB;
+  if (const char* env = PR_GetEnv("MOZ_SANITIZED_FONT_CACHE_SIZE")) {
+    capacityKB = strtoul(env, nullptr, 10);
+  }
+  if (!capacityKB) {
+    return false;
+  }
+
+  {
+    StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+    sSanitizedFontCache = new SanitizedFontCacheState();
+    sSanitizedFontCache->mCapacity = capacityKB * 1024;
+    if (const char* dir = PR_GetEnv("MOZ_SANITIZED_FONT_CACHE_DIR")) {
+      sSanitizedFontCache->mDiskCacheDir = dir;
+    }
+  }
+  sEnabled = true;
+
+  nsCOMPtr<nsIObserverService> obs = mozilla::services::GetObserverService();
+  if (obs) {
+    obs->AddObserver(new SanitizedFontCacheFlusher(),
+                     "cacheservice:empty-cache", false);
+  }
+  RegisterStrongMemoryReporter(new SanitizedFontCacheReporter());
+  return true;
+}
+
+/* static */
+void SanitizedFontCache::InitForTesting(size_t aCapacity,
+                                        const nsACString& aDiskCacheDir) {
+  StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+  sSanitizedFontCache = new SanitizedFontCacheState();
+  sSanitizedFontCache->mCapacity = aCapacity;
+  sSanitizedFontCache->mDiskCacheDir = aDiskCacheDir;
+}
+
+/* static */
+bool SanitizedFontCache::Get(const Key& aKey, const uint8_t*& aSaneData,
+                             uint32_t& aSaneLength, nsACString& aFullName,
+                             nsTArray<OTSMessage>& aMessages) {
+  nsCString diskCacheDir;
+  {
+    StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+    if (!sSanitizedFontCache) {
+      return false;
+    }
+
+    if (auto p = sSanitizedFontCache->mEntries.lookup(aKey)) {
+      SanitizedFontCacheEntry* entry = p->value().get();
+      aSaneData = nullptr;
+      aSaneLength = entry->mSaneData.Length();
+      if (aSaneLength) {
+        aSaneData = CopySanitizedFont(entry->mSaneData.Elements(), aSaneLength);
+        if (!aSaneData) {
+          return false;
+        }
+      }
+      aFullName = entry->mFullName;
+      for (const auto& msg : entry->mMessages) {
+        aMessages.AppendElement(OTSMessage{msg.mMessage, msg.mLevel});
+      }
+
+      entry->remove();
+      sSanitizedFontCache->mLRU.insertBack(entry);
+      sSanitizedFontHits++;
+      LOG(("userfonts (sanitized) cache hit, %u bytes", aKey.mLength));
+      return true;
+    }
+    diskCacheDir = sSanitizedFontCache->mDiskCacheDir;
+  }
+
+  // Only hit the disk off the main thread.
+  if (!diskCacheDir.IsEmpty() && !NS_IsMainThread()) {
+    UniquePtr<SanitizedFontCacheEntry> entry =
+        ReadSanitizedFontFromDisk(diskCacheDir, aKey);
+    if (entry) {
+      aSaneLength = entry->mSaneData.Length();
+      aSaneData = CopySanitizedFont(entry->mSaneData.Elements(), aSaneLength);
+      if (aSaneData) {
+        aFullName = entry->mFullName;
+
+        StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+        if (sSanitizedFontCache) {
+          InsertSanitizedFont(*sSanitizedFontCache, std::move(entry));
+        }
+        sSanitizedFontHits++;
+        sSanitizedFontDiskHits++;
+        LOG(("userfonts (sanitized) disk cache hit, %u bytes", aKey.mLength));
+        return true;
+      }
+    }
+  }
+
+  sSanitizedFontMisses++;
+  return false;
+}
+
+/* static */
+void SanitizedFontCache::Put(const Key& aKey, const uint8_t* aSaneData,
+                             uint32_t aSaneLength, const nsACString& aFullName,
+                             const nsTArray<OTSMessage>& aMessages) {
+  auto entry = MakeUnique<SanitizedFontCacheEntry>(aKey);
+  if (aSaneData &&
+      !entry->mSaneData.AppendElements(aSaneData, aSaneLength, fallible)) {
+    return;
+  }
+  entry->mFullName = aFullName;
+  bool hasErrors = false;
+  for (const auto& msg : aMessages) {
+    entry->mMessages.AppendElement(
+        SanitizedFontMessage{msg.mMessage, msg.mLevel});
+    hasErrors |= msg.mLevel == 0;
+  }
+
+  // Write accepted fonts through to disk, if there is a disk cache.
+  UniquePtr<SanitizedFontCacheEntry> diskEntry;
+  nsCString diskCacheDir;
+  {
+    StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+    if (!sSanitizedFontCache) {
+      return;
+    }
+    diskCacheDir = sSanitizedFontCache->mDiskCacheDir;
+    if (aSaneData && !hasErrors && !diskCacheDir.IsEmpty()) {
+      diskEntry = MakeUnique<SanitizedFontCacheEntry>(aKey);
+      diskEntry->mFullName = aFullName;
+      if (!diskEntry->mSaneData.AppendElements(entry->mSaneData, fallible)) {
+        diskEntry = nullptr;
+      }
+    }
+    InsertSanitizedFont(*sSanitizedFontCache, std::move(entry));
+  }
+
+  if (!diskEntry) {
+    return;
+  }
+  if (NS_IsMainThread()) {
+    NS_DispatchBackgroundTask(NS_NewRunnableFunction(
+        "SanitizedFontCache::Put",
+        [diskCacheDir, diskEntry = std::move(diskEntry)] {
+          WriteSanitizedFontToDisk(diskCacheDir, *diskEntry);
+        }));
+  } else {
+    WriteSanitizedFontToDisk(diskCacheDir, *diskEntry);
+  }
+}
+
+/* static */
+void SanitizedFontCache::Clear() {
+  StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+  if (sSanitizedFontCache) {
+    sSanitizedFontCache->mLRU.clear();
+    sSanitizedFontCache->mEntries.clear();
+    sSanitizedFontCache->mBytes = 0;
+  }
+}
+
+/* static */
+void SanitizedFontCache::Shutdown() {
+  StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+  sSanitizedFontCache = nullptr;
+}
+
+/* static */
+SanitizedFontCache::Stats SanitizedFontCache::GetStats(
+    MallocSizeOf aMallocSizeOf) {
+  Stats stats;
+  stats.mHits = sSanitizedFontHits;
+  stats.mDiskHits = sSanitizedFontDiskHits;
+  stats.mMisses = sSanitizedFontMisses;
+  stats.mEvictions = sSanitizedFontEvictions;
+
+  StaticMutexAutoLock lock(sSanitizedFontCacheMutex);
+  if (sSanitizedFontCache) {
+    stats.mEntries = sSanitizedFontCache->mEntries.count();
+    stats.mBytes =
+        aMallocSizeOf(sSanitizedFontCache.get()) +
+        sSanitizedFontCache->mEntries.shallowSizeOfExcludingThis(aMallocSizeOf);
+    for (const auto* entry : sSanitizedFontCache->mLRU) {
+      stats.mBytes += entry->SizeOfIncludingThis(aMallocSizeOf);
+    }
+  }
+  return stats;
+}
+
 #undef LOG
 #undef LOG_ENABLED
@@ -7,6 +7,7 @@
 #define GFX_USER_FONT_SET_H
 
 #include <new>
+#include <string.h>
 #include "PLDHashTable.h"
 #include "gfxFontEntry.h"
 #include "gfxFontUtils.h"
@@ -34,6 +35,7 @@
 #include "gfxFontSrcURI.h"        // for gfxFontSrcURI
 #include "mozilla/Assertions.h"  // for AssertionConditionType, MOZ_ASSERT_HELPER2, MOZ_ASSERT, MOZ_ASSERT_UNREACHABLE, MOZ_ASSER...
 #include "mozilla/HashFunctions.h"      // for HashBytes, HashGeneric
+#include "mozilla/SHA1.h"               // for SHA1Sum
 #include "mozilla/TimeStamp.h"          // for TimeStamp
 #include "mozilla/gfx/FontVariation.h"  // for FontVariation
 #include "nsDebug.h"                    // for NS_WARNING
@@ -678,15 +680,26 @@ class gfxUserFontEntry : public gfxFontEntry {
     MOZ_ASSERT_UNREACHABLE("not meaningful for a userfont placeholder");
   }
 
- protected:
+  // Sanitized font data shared between documents; defined below.
+  class SanitizedFontCache;
+
   struct OTSMessage {
     nsCString mMessage;
     int mLevel;  // see OTSContext in gfx/ots/include/opentype-sanitizer.h
   };
 
+ protected:
+
+  // Whether SanitizeOpenTypeData may use the SanitizedFontCache for this
+  // entry's font set. Must be called on the main thread.
+  bool UseSanitizedFontCache() const;
+
+  // Returns the sanitized font, allocated with malloc, and its full name in
+  // aFullName. May be called on any thread.
   const uint8_t* SanitizeOpenTypeData(const uint8_t* aData, uint32_t aLength,
-                                      uint32_t& aSaneLength,
+                                      bool aUseCache, uint32_t& aSaneLength,
                                       gfxUserFontType& aFontType,
+                                      nsACString& aFullName,
                                       nsTArray<OTSMessage>& aMessages);
 
   // attempt to load the next resource in the src list.
@@ -719,6 +732,7 @@ class gfxUserFontEntry : public gfxFontEntry {
   // helper method for LoadPlatformFontAsync; runs on a background thread
   void StartPlatformFontLoadOnBackgroundThread(
       uint32_t aSrcIndex, const uint8_t* aFontData, uint32_t aLength,
+      bool aUseCache,
       nsMainThreadPtrHandle<nsIFontLoadCompleteCallback> aCallback);
 
   // helper method for LoadPlatformFontAsync; runs on the main thread
@@ -726,7 +740,7 @@ class gfxUserFontEntry : public gfxFontEntry {
       uint32_t aSrcIndex, const uint8_t* aOriginalFontData,
       uint32_t aOriginalLength, gfxUserFontType aFontType,
       const uint8_t* aSanitizedFontData, uint32_t aSanitizedLength,
-      nsTArray<OTSMessage>&& aMessages,
+      nsCString&& aOriginalFullName, nsTArray<OTSMessage>&& aMessages,
       nsMainThreadPtrHandle<nsIFontLoadCompleteCallback> aCallback);
 
   // helper method for LoadPlatformFontSync and
@@ -735,6 +749,7 @@ class gfxUserFontEntry : public gfxFontEntry {
                         uint32_t aOriginalLength, gfxUserFontType aFontType,
                         const uint8_t* aSanitizedFontData,
                         uint32_t aSanitizedLength,
+                        const nsACString& aOriginalFullName,
                         nsTArray<OTSMessage>&& aMessages);
 
   // helper method for FontDataDownloadComplete and
@@ -789,4 +804,78 @@ class gfxUserFontEntry : public gfxFontEntry {
   RefPtr<gfxFontSrcPrincipal> mPrincipal;
 };
 
+// Cache of the output of the OTS sanitizer, keyed by a hash of the downloaded
+// font data and the sanitizer's options (see gfxOTSContext::Options).
+// Documents which load the same web font, e.g. from a shared font CDN or the
+// same site open in several tabs, then only sanitize it once.
+// (UserFontCache shares whole font entries, but only between loads with the
+// same URI and principal.) Fonts rejected by the sanitizer are cached too.
+//
+// May be used on any thread. Once the cached data exceeds
+// MOZ_SANITIZED_FONT_CACHE_SIZE kilobytes (32MB by default; 0 disables the
+// cache), the least recently used entries are evicted. If
+// MOZ_SANITIZED_FONT_CACHE_DIR names a directory, accepted fonts are also
+// written there and found again by later sessions. Fonts read back from the
+// directory are not sanitized again, so it must not be writable by others.
+class gfxUserFontEntry::SanitizedFontCache final {
+ public:
+  struct Key {
+    mozilla::SHA1Sum::Hash mDigest;
+    uint32_t mLength;
+    // An unrelated second hash, so that a SHA-1 collision alone does not
+    // make two fonts share an entry.
+    uint32_t mHash;
+    // The gfxOTSContext::Options the font is sanitized with. The prefs they
+    // come from may change between sessions, or while the cache is in use.
+    uint32_t mOptions;
+
+    bool operator==(const Key& aOther) const {
+      return mLength == aOther.mLength && mHash == aOther.mHash &&
+             mOptions == aOther.mOptions &&
+             !memcmp(mDigest, aOther.mDigest, sizeof(mDigest));
+    }
+  };
+
+  static Key ComputeKey(const uint8_t* aData, uint32_t aLength,
+                        uint32_t aOptions);
+
+  // Sets up the cache on first use. Returns false if it is disabled. Must be
+  // called on the main thread.
+  static bool Init();
+
+  // Replaces the cache with an empty one of aCapacity bytes, which writes
+  // accepted fonts to aDiskCacheDir unless it is empty. Only for tests.
+  static void InitForTesting(size_t aCapacity,
+                             const nsACString& aDiskCacheDir);
+
+  // On a hit, sets aSaneData to a copy of the sanitized font allocated with
+  // malloc (or nullptr if the sanitizer rejected the font), and replays the
+  // sanitizer's messages into aMessages. Only looks on disk when called off
+  // the main thread.
+  static bool Get(const Key& aKey, const uint8_t*& aSaneData,
+                  uint32_t& aSaneLength, nsACString& aFullName,
+                  nsTArray<OTSMessage>& aMessages);
+
+  // Records the result of sanitizing the font with the given key. aSaneData
+  // is copied; it is nullptr if the sanitizer rejected the font.
+  static void Put(const Key& aKey, const uint8_t* aSaneData,
+                  uint32_t aSaneLength, const nsACString& aFullName,
+                  const nsTArray<OTSMessage>& aMessages);
+
+  // Drops all entries held in memory.
+  static void Clear();
+
+  static void Shutdown();
+
+  struct Stats {
+    uint64_t mHits = 0;
+    uint64_t mDiskHits = 0;
+    uint64_t mMisses = 0;
+    uint64_t mEvictions = 0;
+    uint32_t mEntries = 0;
+    size_t mBytes = 0;
+  };
+  static Stats GetStats(mozilla::MallocSizeOf aMallocSizeOf);
+};
+
 #endif /* GFX_USER_FONT_SET_H */
@@ -0,0 +1,167 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Splits large blits and composites into horizontal bands of rows that are
+// processed on a small pool of threads. The caller always processes bands
+// itself and waits for the rest, so the result is visible as soon as the
+// call returns, just as if it had run on one thread.
+//
+// Band boundaries only depend on the number of rows, and every row is written
+// by exactly one band using the same arithmetic as an unbanded pass, so the
+// output does not depend on how many threads took part.
+//
+// The number of threads defaults to the number of cores, up to 8, and may be
+// overridden with the SWGL_BAND_THREADS environment variable or
+// SetCompositeBandThreads. A value of 1 disables banding.
+//
+// Draw calls are not banded: the fragment shader state they run is global to
+// the context, so rasterizing a draw on several threads would need a shader
+// instance per thread. Frames that are dominated by draws rather than by
+// compositing do not get any faster.
+class BandPool {
+ public:
+  // Work smaller than this many pixels is not split at all.
+  static const int MIN_PIXELS = 256 * 1024;
+  // Bands have at least this many rows, so that per-band setup stays small
+  // relative to the rows drawn.
+  static const int MIN_BAND_ROWS = 32;
+  static const int MAX_THREADS = 8;
+
+  static BandPool& get() {
+    // Intentionally leaked, so that worker threads are never joined during
+    // static destruction.
+    static BandPool* pool = new BandPool;
+    return *pool;
+  }
+
+  void set_threads(int threads) {
+    max_threads.store(clamp(threads, 1, MAX_THREADS),
+                      std::memory_order_relaxed);
+  }
+
+  int threads() const { return max_threads.load(std::memory_order_relaxed); }
+
+  // Calls band(y0, y1) for consecutive ranges of rows covering [y0, y1) of a
+  // region that is width pixels wide.
+  template <typename F>
+  void run(int width, int y0, int y1, const F& band) {
+    int rows = y1 - y0;
+    int bands = num_bands(width, rows);
+    if (bands <= 1) {
+      band(y0, y1);
+      return;
+    }
+    // Only one banded pass runs at a time. Concurrent callers, such as
+    // several compositor threads, just run unbanded.
+    std::unique_lock<std::mutex> busy(run_lock, std::try_to_lock);
+    if (!busy.owns_lock() || !ensure_workers(threads() - 1)) {
+      band(y0, y1);
+      return;
+    }
+
+    std::function<void(int, int)> fn = [&](int b0, int b1) {
+      band(y0 + b0, y0 + b1);
+    };
+    auto job = std::make_shared<Job>(fn, rows, bands);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current = job;
+      generation++;
+    }
+    wake.notify_all();
+
+    job->work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return job->pending.load() == 0; });
+    current = nullptr;
+  }
+
+ private:
+  struct Job {
+    Job(const std::function<void(int, int)>& fn, int rows, int bands)
+        : fn(fn), rows(rows), bands(bands), pending(bands) {}
+
+    // Returns true if this call finished the last band.
+    bool work() {
+      bool last = false;
+      for (int b = next.fetch_add(1); b < bands; b = next.fetch_add(1)) {
+        // Only dereferenced while bands are pending, during which the caller
+        // is still waiting in run and fn is alive.
+        fn(int(int64_t(rows) * b / bands),
+           int(int64_t(rows) * (b + 1) / bands));
+        last = pending.fetch_sub(1) == 1;
+      }
+      return last;
+    }
+
+    const std::function<void(int, int)>& fn;
+    const int rows;
+    const int bands;
+    std::atomic<int> next{0};
+    std::atomic<int> pending;
+  };
+
+  BandPool() {
+    int threads = int(std::thread::hardware_concurrency());
+    if (const char* env = getenv("SWGL_BAND_THREADS")) {
+      threads = atoi(env);
+    }
+    set_threads(threads);
+  }
+
+  int num_bands(int width, int rows) const {
+    int threads = this->threads();
+    if (threads <= 1 || width <= 0 || int64_t(width) * rows < MIN_PIXELS) {
+      return 1;
+    }
+    // A couple of bands per thread even out bands which are cheaper than
+    // others, e.g. because they are partly clipped.
+    return clamp(rows / MIN_BAND_ROWS, 1, threads * 2);
+  }
+
+  bool ensure_workers(int count) {
+    for (; num_workers < count; num_workers++) {
+      std::thread([this] { worker_main(); }).detach();
+    }
+    return num_workers > 0;
+  }
+
+  void worker_main() {
+    uint64_t seen = 0;
+    for (;;) {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return generation != seen; });
+        seen = generation;
+        job = current;
+      }
+      if (job && job->work()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.notify_all();
+      }
+    }
+  }
+
+  std::atomic<int> max_threads{1};
+  // Held for the duration of a banded pass.
+  std::mutex run_lock;
+  // Only touched while holding run_lock. Workers are never stopped, so
+  // lowering the thread count only reduces the number of bands.
+  int num_workers = 0;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::shared_ptr<Job> current;
+  uint64_t generation = 0;
+};
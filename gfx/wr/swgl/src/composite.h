@@ -350,11 +350,16 @@ static void linear_row_blit(uint16_t* dest, int span, const vec2_scalar& srcUV,
   }
 }
 
+// Only rows within [bandY0, bandY1), relative to dstReq, are drawn. The
+// source UVs are still stepped row by row from the top of the clipped bounds,
+// so that drawing an area in several bands gives exactly the same result as
+// drawing it at once.
 template <bool COMPOSITE = false>
 static NO_INLINE void linear_blit(Texture& srctex, const IntRect& srcReq,
                                   Texture& dsttex, const IntRect& dstReq,
                                   bool invertX, bool invertY,
-                                  const IntRect& clipRect) {
+                                  const IntRect& clipRect,
+                                  int bandY0 = INT_MIN, int bandY1 = INT_MAX) {
   assert(srctex.internal_format == GL_RGBA8 ||
          srctex.internal_format == GL_R8 || srctex.internal_format == GL_RG8);
   assert(!COMPOSITE || (srctex.internal_format == GL_RGBA8 &&
@@ -389,6 +394,14 @@ static NO_INLINE void linear_blit(Texture& srctex, const IntRect& srcReq,
   // Scale UVs by lerp precision
   srcUV = linearQuantize(srcUV, 128);
   srcDUV *= 128.0f;
+  // Step over the rows above the band
+  int y0 = max(dstBounds.y0, bandY0);
+  int y1 = min(dstBounds.y1, bandY1);
+  for (int y = dstBounds.y0; y < y0; y++) {
+    srcUV.y += srcDUV.y;
+  }
+  dstBounds.y0 = y0;
+  dstBounds.y1 = y1;
   // Calculate dest pointer from clamped offsets
   int bpp = dsttex.bpp();
   int destStride = dsttex.stride();
@@ -470,13 +483,20 @@ void BlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1,
   IntRect clipRect = {0, 0, dstReq.width(), dstReq.height()};
   prepare_texture(srctex);
   prepare_texture(dsttex, &dstReq);
-  if (!srcReq.same_size(dstReq) && srctex.width >= 2 && filter == GL_LINEAR &&
-      srctex.internal_format == dsttex.internal_format &&
-      is_renderable_format(srctex.internal_format)) {
-    linear_blit(srctex, srcReq, dsttex, dstReq, false, invertY, dstReq);
-  } else {
-    scale_blit(srctex, srcReq, dsttex, dstReq, invertY, clipRect);
-  }
+  bool useLinear = !srcReq.same_size(dstReq) && srctex.width >= 2 &&
+                   filter == GL_LINEAR &&
+                   srctex.internal_format == dsttex.internal_format &&
+                   is_renderable_format(srctex.internal_format);
+  BandPool::get().run(
+      clipRect.width(), clipRect.y0, clipRect.y1, [&](int bandY0, int bandY1) {
+        if (useLinear) {
+          linear_blit(srctex, srcReq, dsttex, dstReq, false, invertY, dstReq,
+                      bandY0, bandY1);
+        } else {
+          IntRect bandClip = {clipRect.x0, bandY0, clipRect.x1, bandY1};
+          scale_blit(srctex, srcReq, dsttex, dstReq, invertY, bandClip);
+        }
+      });
 }
 
 typedef Texture LockedTexture;
@@ -534,11 +554,20 @@ void* GetResourceBuffer(LockedTexture* resource, int32_t* width,
   return resource->buf;
 }
 
+// Sets the number of threads that large composites and blits are split
+// across. See BandPool.
+void SetCompositeBandThreads(GLint threads) {
+  BandPool::get().set_threads(threads);
+}
+
+GLint GetCompositeBandThreads() { return BandPool::get().threads(); }
+
 // Extension for optimized compositing of textures or framebuffers that may be
 // safely used across threads. The source and destination must be locked to
 // ensure that they can be safely accessed while the SWGL context might be used
 // by another thread. Band extents along the Y axis may be used to clip the
 // destination rectangle without effecting the integer scaling ratios.
+// Large composites are further split into bands internally.
 void Composite(LockedTexture* lockedDst, LockedTexture* lockedSrc, GLint srcX,
                GLint srcY, GLsizei srcWidth, GLsizei srcHeight, GLint dstX,
                GLint dstY, GLsizei dstWidth, GLsizei dstHeight,
@@ -572,20 +601,33 @@ void Composite(LockedTexture* lockedDst, LockedTexture* lockedSrc, GLint srcX,
       srctex.width >= 2 &&
       (flipX || (!srcReq.same_size(dstReq) && filter == GL_LINEAR));
 
-  if (opaque) {
-    if (useLinear) {
-      linear_blit<false>(srctex, srcReq, dsttex, dstReq, flipX, flipY,
-                         clipRect);
-    } else {
-      scale_blit<false>(srctex, srcReq, dsttex, dstReq, flipY, clipRect);
-    }
-  } else {
-    if (useLinear) {
-      linear_blit<true>(srctex, srcReq, dsttex, dstReq, flipX, flipY, clipRect);
-    } else {
-      scale_blit<true>(srctex, srcReq, dsttex, dstReq, flipY, clipRect);
-    }
+  // Only the rows of the clip rect inside the destination are drawn, so only
+  // those are split into bands.
+  IntRect bandRect =
+      clipRect.intersection(IntRect{0, 0, dstReq.width(), dstReq.height()});
+  if (bandRect.is_empty()) {
+    return;
   }
+
+  BandPool::get().run(
+      bandRect.width(), bandRect.y0, bandRect.y1, [&](int bandY0, int bandY1) {
+        IntRect bandClip = {clipRect.x0, bandY0, clipRect.x1, bandY1};
+        if (opaque) {
+          if (useLinear) {
+            linear_blit<false>(srctex, srcReq, dsttex, dstReq, flipX, flipY,
+                               clipRect, bandY0, bandY1);
+          } else {
+            scale_blit<false>(srctex, srcReq, dsttex, dstReq, flipY, bandClip);
+          }
+        } else {
+          if (useLinear) {
+            linear_blit<true>(srctex, srcReq, dsttex, dstReq, flipX, flipY,
+                              clipRect, bandY0, bandY1);
+          } else {
+            scale_blit<true>(srctex, srcReq, dsttex, dstReq, flipY, bandClip);
+          }
+        }
+      });
 }
 
 }  // extern "C"
@@ -1143,11 +1185,13 @@ static void linear_row_yuv(uint32_t* dest, int span, sampler2DRect samplerY,
   }
 }
 
+// As for linear_blit, only rows within [bandY0, bandY1) are drawn.
 static void linear_convert_yuv(Texture& ytex, Texture& utex, Texture& vtex,
                                const YUVMatrix& rgbFromYcbcr, int colorDepth,
                                const IntRect& srcReq, Texture& dsttex,
                                const IntRect& dstReq, bool invertX,
-                               bool invertY, const IntRect& clipRect) {
+                               bool invertY, const IntRect& clipRect,
+                               int bandY0 = INT_MIN, int bandY1 = INT_MAX) {
   // Compute valid dest bounds
   IntRect dstBounds = dsttex.sample_bounds(dstReq);
   dstBounds.intersect(clipRect);
@@ -1190,6 +1234,15 @@ static void linear_convert_yuv(Texture& ytex, Texture& utex, Texture& vtex,
     chromaUV = linearQuantize(chromaUV, 128);
     chromaDUV *= 128.0f;
   }
+  // Step over the rows above the band
+  int y0 = max(dstBounds.y0, bandY0);
+  int y1 = min(dstBounds.y1, bandY1);
+  for (int y = dstBounds.y0; y < y0; y++) {
+    srcUV.y += srcDUV.y;
+    chromaUV.y += chromaDUV.y;
+  }
+  dstBounds.y0 = y0;
+  dstBounds.y1 = y1;
   // Calculate dest pointer from clamped offsets
   int destStride = dsttex.stride();
   char* dest = dsttex.sample_ptr(dstReq, dstBounds);
@@ -1376,11 +1429,20 @@ void CompositeYUV(LockedTexture* lockedDst, LockedTexture* lockedY,
   // as used for the sampling bounds.
   IntRect clipRect = {clipX - dstX, clipY - dstY, clipX - dstX + clipWidth,
                       clipY - dstY + clipHeight};
+  IntRect bandRect =
+      clipRect.intersection(IntRect{0, 0, dstReq.width(), dstReq.height()});
+  if (bandRect.is_empty()) {
+    return;
+  }
   // For now, always use a linear filter path that would be required for
   // scaling. Further fast-paths for non-scaled video might be desirable in the
   // future.
-  linear_convert_yuv(ytex, utex, vtex, rgbFromYcbcr, colorDepth, srcReq, dsttex,
-                     dstReq, flipX, flipY, clipRect);
+  BandPool::get().run(
+      bandRect.width(), bandRect.y0, bandRect.y1, [&](int bandY0, int bandY1) {
+        linear_convert_yuv(ytex, utex, vtex, rgbFromYcbcr, colorDepth, srcReq,
+                           dsttex, dstReq, flipX, flipY, clipRect, bandY0,
+                           bandY1);
+      });
 }
 
 }  // extern "C"
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <math.h>
+#include <limits.h>
 
 #ifdef __MACH__
 #  include <mach/mach.h>
@@ -2661,6 +2662,7 @@ void CopyTexSubImage2D(GLenum target, UNUSED GLint level, GLint xoffset,
 }  // extern "C"
 
 #include "blend.h"
+#include "bands.h"
 #include "composite.h"
 #include "swgl_ext.h"
 
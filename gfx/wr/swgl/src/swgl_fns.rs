@@ -314,6 +314,8 @@ extern "C" {
         clip_width: GLsizei,
         clip_height: GLsizei,
     );
+    fn SetCompositeBandThreads(threads: GLint);
+    fn GetCompositeBandThreads() -> GLint;
     fn CreateContext() -> *mut c_void;
     fn ReferenceContext(ctx: *mut c_void);
     fn DestroyContext(ctx: *mut c_void);
@@ -321,6 +323,21 @@ extern "C" {
     fn ReportMemory(ctx: *mut c_void, size_of_op: unsafe extern "C" fn(ptr: *const c_void) -> usize) -> usize;
 }
 
+/// Sets the number of threads that large composites and blits are split
+/// across, in horizontal bands. A value of 1 disables banding. Draw calls
+/// always run on the calling thread.
+pub fn set_composite_band_threads(threads: i32) {
+    unsafe {
+        SetCompositeBandThreads(threads);
+    }
+}
+
+/// Returns the number of threads that large composites and blits are split
+/// across.
+pub fn get_composite_band_threads() -> i32 {
+    unsafe { GetCompositeBandThreads() }
+}
+
 #[derive(Clone, Copy)]
 pub struct Context(*mut c_void);
 
@@ -0,0 +1,105 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef mozilla_image_encoders_ParallelStrips_h
+#define mozilla_image_encoders_ParallelStrips_h
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mozilla/ParallelFor.h"
+#include "nsError.h"
+#include "prsystem.h"
+
+namespace mozilla {
+namespace image {
+
+// Helpers for encoders which split an image into strips of rows, encode the
+// strips on several threads and stitch the results into a single stream.
+//
+// Strip encoding is enabled with the "parallel=yes" output option, or for
+// all encodes when MOZ_PARALLEL_IMAGE_ENCODE=1 is set in the environment.
+// Small images are always encoded serially.
+class ParallelStrips {
+ public:
+  // Images with fewer rows than this are not worth splitting.
+  static const uint32_t kMinRows = 512;
+  // Strips are at least this many bytes of input, so that the per strip
+  // overhead (a flush in the compressed stream) stays negligible.
+  static const uint32_t kMinStripBytes = 512 * 1024;
+
+  static bool EnabledByDefault() {
+    static const bool sEnabled = [] {
+      const char* env = getenv("MOZ_PARALLEL_IMAGE_ENCODE");
+      return env && strcmp(env, "1") == 0;
+    }();
+    return sEnabled;
+  }
+
+  // Parses the value of the "parallel" option.
+  static bool ParseOption(const char* aValue, bool* aParallel) {
+    if (strcmp(aValue, "yes") == 0) {
+      *aParallel = true;
+    } else if (strcmp(aValue, "no") == 0) {
+      *aParallel = false;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  static uint32_t Threads() {
+    int32_t processors = PR_GetNumberOfProcessors();
+    return uint32_t(std::clamp(processors, 1, 8));
+  }
+
+  // Returns the number of rows per strip for an image of aHeight rows of
+  // aRowBytes bytes. The result is a multiple of aRowAlign, and 0 if the
+  // image should not be split.
+  static uint32_t StripRows(uint32_t aHeight, uint32_t aRowBytes,
+                            uint32_t aRowAlign = 1) {
+    uint32_t threads = Threads();
+    if (aHeight < kMinRows || threads < 2) {
+      return 0;
+    }
+    // A few strips per thread even out differences in how well strips
+    // compress.
+    uint32_t rows = (aHeight + threads * 4 - 1) / (threads * 4);
+    uint32_t minRows = (kMinStripBytes + aRowBytes - 1) / aRowBytes;
+    rows = std::max(rows, minRows);
+    rows = (rows + aRowAlign - 1) / aRowAlign * aRowAlign;
+    if (rows >= aHeight) {
+      return 0;
+    }
+    return rows;
+  }
+
+  // Calls aEncodeStrip(i) for each i in [0, aStripCount), on the calling
+  // thread and on background threads. Once a call fails, no further strips
+  // are started, and the error of the first failed call is returned.
+  static nsresult Run(uint32_t aStripCount,
+                      const std::function<nsresult(uint32_t)>& aEncodeStrip) {
+    std::atomic<nsresult> result{NS_OK};
+    uint32_t helpers = std::min(Threads(), aStripCount) - 1;
+    ParallelFor(aStripCount, helpers, [&](uint32_t aStrip, uint32_t) {
+      nsresult rv = aEncodeStrip(aStrip);
+      if (NS_FAILED(rv)) {
+        nsresult expected = NS_OK;
+        result.compare_exchange_strong(expected, rv);
+        return false;
+      }
+      return true;
+    });
+    return result;
+  }
+};
+
+}  // namespace image
+}  // namespace mozilla
+
+#endif  // mozilla_image_encoders_ParallelStrips_h
@@ -4,20 +4,25 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "nsJPEGEncoder.h"
+#include "ParallelStrips.h"
 #include "prprf.h"
 #include "nsString.h"
 #include "nsStreamUtils.h"
 #include "gfxColor.h"
 #include "mozilla/CheckedInt.h"
+#include "mozilla/Maybe.h"
+#include "mozilla/Span.h"
 
 extern "C" {
 #include "jpeglib.h"
 }
 
+#include <iterator>
 #include <setjmp.h>
 #include "jerror.h"
 
 using namespace mozilla;
+using mozilla::image::ParallelStrips;
 
 NS_IMPL_ISUPPORTS(nsJPEGEncoder, imgIEncoder, nsIInputStream,
                   nsIAsyncInputStream)
@@ -66,6 +71,26 @@ struct encoder_error_mgr {
   jmp_buf setjmp_buffer;
 };
 
+static void SetCompressParameters(jpeg_compress_struct* cinfo,
+                                  uint32_t aWidth, uint32_t aHeight,
+                                  int aQuality) {
+  cinfo->image_width = aWidth;
+  cinfo->image_height = aHeight;
+  cinfo->input_components = 3;
+  cinfo->in_color_space = JCS_RGB;
+  cinfo->data_precision = 8;
+
+  jpeg_set_defaults(cinfo);
+  jpeg_set_quality(cinfo, aQuality, 1);  // quality here is 0-100
+  if (aQuality >= 90) {
+    int i;
+    for (i = 0; i < MAX_COMPONENTS; i++) {
+      cinfo->comp_info[i].h_samp_factor = 1;
+      cinfo->comp_info[i].v_samp_factor = 1;
+    }
+  }
+}
+
 nsJPEGEncoder::nsJPEGEncoder()
     : mFinished(false),
       mImageBuffer(nullptr),
@@ -119,32 +144,40 @@ nsJPEGEncoder::InitFromData(const uint8_t* aData,
     return NS_ERROR_ALREADY_INITIALIZED;
   }
 
-  // options: we only have one option so this is easy
+  // options: "quality=X" and "parallel=[yes|no]", separated by ';'
   int quality = 92;
-  if (aOutputOptions.Length() > 0) {
-    // have options string
-    const nsString qualityPrefix(u"quality="_ns);
-    if (aOutputOptions.Length() > qualityPrefix.Length() &&
-        StringBeginsWith(aOutputOptions, qualityPrefix)) {
-      // have quality string
-      nsCString value = NS_ConvertUTF16toUTF8(
-          Substring(aOutputOptions, qualityPrefix.Length()));
-      int newquality = -1;
-      if (PR_sscanf(value.get(), "%d", &newquality) == 1) {
-        if (newquality >= 0 && newquality <= 100) {
-          quality = newquality;
+  bool parallel = ParallelStrips::EnabledByDefault();
+  {
+    NS_ConvertUTF16toUTF8 options(aOutputOptions);
+    for (const nsACString& option : options.Split(';')) {
+      const auto qualityPrefix = "quality="_ns;
+      const auto parallelPrefix = "parallel="_ns;
+      if (option.Length() > qualityPrefix.Length() &&
+          StringBeginsWith(option, qualityPrefix)) {
+        // have quality string
+        nsCString value(Substring(option, qualityPrefix.Length()));
+        int newquality = -1;
+        if (PR_sscanf(value.get(), "%d", &newquality) == 1) {
+          if (newquality >= 0 && newquality <= 100) {
+            quality = newquality;
+          } else {
+            NS_WARNING(
+                "Quality value out of range, should be 0-100,"
+                " using default");
+          }
         } else {
           NS_WARNING(
-              "Quality value out of range, should be 0-100,"
+              "Quality value invalid, should be integer 0-100,"
               " using default");
         }
-      } else {
-        NS_WARNING(
-            "Quality value invalid, should be integer 0-100,"
-            " using default");
+      } else if (StringBeginsWith(option, parallelPrefix)) {
+        nsCString value(Substring(option, parallelPrefix.Length()));
+        if (!ParallelStrips::ParseOption(value.get(), &parallel)) {
+          return NS_ERROR_INVALID_ARG;
+        }
+      } else if (!option.IsEmpty()) {
+        return NS_ERROR_INVALID_ARG;
       }
-    } else {
-      return NS_ERROR_INVALID_ARG;
     }
   }
 
@@ -163,19 +196,31 @@ nsJPEGEncoder::InitFromData(const uint8_t* aData,
   }
 
   jpeg_create_compress(&cinfo);
-  cinfo.image_width = aWidth;
-  cinfo.image_height = aHeight;
-  cinfo.input_components = 3;
-  cinfo.in_color_space = JCS_RGB;
-  cinfo.data_precision = 8;
-
-  jpeg_set_defaults(&cinfo);
-  jpeg_set_quality(&cinfo, quality, 1);  // quality here is 0-100
-  if (quality >= 90) {
-    int i;
-    for (i = 0; i < MAX_COMPONENTS; i++) {
-      cinfo.comp_info[i].h_samp_factor = 1;
-      cinfo.comp_info[i].v_samp_factor = 1;
+  SetCompressParameters(&cinfo, aWidth, aHeight, quality);
+
+  if (parallel) {
+    int maxHSampFactor = 1, maxVSampFactor = 1;
+    for (int i = 0; i < cinfo.num_components; i++) {
+      maxHSampFactor =
+          std::max(maxHSampFactor, cinfo.comp_info[i].h_samp_factor);
+      maxVSampFactor =
+          std::max(maxVSampFactor, cinfo.comp_info[i].v_samp_factor);
+    }
+    uint32_t mcuWidth = maxHSampFactor * DCTSIZE;
+    uint32_t mcuHeight = maxVSampFactor * DCTSIZE;
+    uint32_t mcusPerRow = (aWidth + mcuWidth - 1) / mcuWidth;
+
+    // Each strip is one restart interval, which is a 16 bit count of MCUs.
+    uint32_t stripRows =
+        ParallelStrips::StripRows(aHeight, aWidth * 3, mcuHeight);
+    if (stripRows && mcusPerRow * (stripRows / mcuHeight) > 0xffff) {
+      stripRows = 0xffff / mcusPerRow * mcuHeight;
+    }
+    if (stripRows) {
+      jpeg_destroy_compress(&cinfo);
+      return EncodeInStrips(aData, aWidth, aHeight, aStride, aInputFormat,
+                            quality, stripRows,
+                            mcusPerRow * (stripRows / mcuHeight));
     }
   }
 
@@ -225,6 +270,222 @@ nsJPEGEncoder::InitFromData(const uint8_t* aData,
   return NS_OK;
 }
 
+// Strip encoding
+//
+//    Each strip of rows is compressed as a JPEG of its own, with the same
+//    parameters and the standard Huffman tables. Since every strip starts
+//    with fresh DC predictions, the entropy coded data of the strips can be
+//    joined with restart markers in between, under the headers of the first
+//    strip with the image height patched in and a DRI marker which makes
+//    each strip one restart interval.
+
+namespace {
+
+struct StripDestination {
+  jpeg_destination_mgr mPub;
+  nsTArray<uint8_t>* mOut;
+};
+
+}  // namespace
+
+static const uint32_t kStripOutputChunk = 64 * 1024;
+
+static const uint8_t kJPEGMarkerSOF0 = 0xC0;
+static const uint8_t kJPEGMarkerRST0 = 0xD0;
+static const uint8_t kJPEGMarkerSOS = 0xDA;
+static const uint8_t kJPEGMarkerDRI = 0xDD;
+
+static void InitStripDestination(jpeg_compress_struct* cinfo) {
+  auto* dest = reinterpret_cast<StripDestination*>(cinfo->dest);
+  if (!dest->mOut->SetLength(kStripOutputChunk, fallible)) {
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+  }
+  dest->mPub.next_output_byte = dest->mOut->Elements();
+  dest->mPub.free_in_buffer = dest->mOut->Length();
+}
+
+static boolean EmptyStripDestination(jpeg_compress_struct* cinfo) {
+  auto* dest = reinterpret_cast<StripDestination*>(cinfo->dest);
+  size_t used = dest->mOut->Length();
+  if (!dest->mOut->SetLength(used * 2, fallible)) {
+    ERREXIT1(cinfo, JERR_OUT_OF_MEMORY, 0);
+  }
+  dest->mPub.next_output_byte = dest->mOut->Elements() + used;
+  dest->mPub.free_in_buffer = dest->mOut->Length() - used;
+  return 1;
+}
+
+static void TermStripDestination(jpeg_compress_struct* cinfo) {
+  auto* dest = reinterpret_cast<StripDestination*>(cinfo->dest);
+  dest->mOut->TruncateLength(dest->mOut->Length() -
+                             dest->mPub.free_in_buffer);
+}
+
+// Returns the offset of the first marker segment of type aMarker in the
+// headers of aJPEG.
+static Maybe<size_t> FindMarker(const nsTArray<uint8_t>& aJPEG,
+                                uint8_t aMarker) {
+  // Skip SOI.
+  size_t offset = 2;
+  while (offset + 4 <= aJPEG.Length() && aJPEG[offset] == 0xFF) {
+    uint8_t marker = aJPEG[offset + 1];
+    if (marker == aMarker) {
+      return Some(offset);
+    }
+    if (marker == kJPEGMarkerSOS) {
+      break;
+    }
+    offset += 2 + ((aJPEG[offset + 2] << 8) | aJPEG[offset + 3]);
+  }
+  return Nothing();
+}
+
+nsresult nsJPEGEncoder::EncodeStrip(const uint8_t* aData, uint32_t aWidth,
+                                    uint32_t aBegin, uint32_t aEnd,
+                                    uint32_t aStride, uint32_t aInputFormat,
+                                    int aQuality, nsTArray<uint8_t>& aOut) {
+  // Nothing in this frame may need a destructor, since the JPEG library
+  // reports errors with longjmp.
+  jpeg_compress_struct cinfo;
+  encoder_error_mgr errmgr;
+  cinfo.err = jpeg_std_error(&errmgr.pub);
+  errmgr.pub.error_exit = nsJPEGEncoderInternal::errorExit;
+  // errorExit passes the nsresult of the error to longjmp.
+  nsresult error_code;
+  if ((error_code = static_cast<nsresult>(setjmp(errmgr.setjmp_buffer))) !=
+      NS_OK) {
+    jpeg_destroy_compress(&cinfo);
+    return error_code;
+  }
+
+  jpeg_create_compress(&cinfo);
+  SetCompressParameters(&cinfo, aWidth, aEnd - aBegin, aQuality);
+
+  StripDestination dest;
+  dest.mPub.init_destination = InitStripDestination;
+  dest.mPub.empty_output_buffer = EmptyStripDestination;
+  dest.mPub.term_destination = TermStripDestination;
+  dest.mOut = &aOut;
+  cinfo.dest = &dest.mPub;
+
+  jpeg_start_compress(&cinfo, 1);
+
+  JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)(
+      reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE, aWidth * 3, 1);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const uint8_t* src = &aData[size_t(aBegin + cinfo.next_scanline) * aStride];
+    JSAMPROW row = buffer[0];
+    if (aInputFormat == INPUT_FORMAT_RGB) {
+      row = const_cast<uint8_t*>(src);
+    } else if (aInputFormat == INPUT_FORMAT_RGBA) {
+      ConvertRGBARow(src, row, aWidth);
+    } else {
+      ConvertHostARGBRow(src, row, aWidth);
+    }
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  return NS_OK;
+}
+
+nsresult nsJPEGEncoder::EncodeInStrips(const uint8_t* aData, uint32_t aWidth,
+                                       uint32_t aHeight, uint32_t aStride,
+                                       uint32_t aInputFormat, int aQuality,
+                                       uint32_t aStripRows,
+                                       uint32_t aRestartInterval) {
+  MOZ_ASSERT(aRestartInterval > 0 && aRestartInterval <= 0xffff);
+
+  const uint32_t stripCount = (aHeight + aStripRows - 1) / aStripRows;
+  nsTArray<nsTArray<uint8_t>> strips;
+  if (!strips.SetLength(stripCount, fallible)) {
+    return NS_ERROR_OUT_OF_MEMORY;
+  }
+
+  nsresult rv = ParallelStrips::Run(stripCount, [&](uint32_t aIndex) {
+    uint32_t begin = aIndex * aStripRows;
+    uint32_t end = std::min(aHeight, begin + aStripRows);
+    return EncodeStrip(aData, aWidth, begin, end, aStride, aInputFormat,
+                       aQuality, strips[aIndex]);
+  });
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+
+  // Find the entropy coded data of each strip, which runs from the end of
+  // the SOS segment to the EOI marker.
+  nsTArray<Span<const uint8_t>> scans;
+  CheckedInt<uint32_t> size = 0;
+  for (const nsTArray<uint8_t>& strip : strips) {
+    Maybe<size_t> sos = FindMarker(strip, kJPEGMarkerSOS);
+    if (!sos || strip.Length() < 2 ||
+        strip[strip.Length() - 2] != 0xFF ||
+        strip[strip.Length() - 1] != JPEG_EOI) {
+      return NS_ERROR_FAILURE;
+    }
+    size_t begin = *sos + 2 + ((strip[*sos + 2] << 8) | strip[*sos + 3]);
+    size_t end = strip.Length() - 2;
+    if (begin > end) {
+      return NS_ERROR_FAILURE;
+    }
+    scans.AppendElement(Span(strip.Elements() + begin, end - begin));
+    // Room for a restart marker, or EOI after the last strip.
+    size += end - begin + 2;
+  }
+
+  const nsTArray<uint8_t>& first = strips[0];
+  Maybe<size_t> sof = FindMarker(first, kJPEGMarkerSOF0);
+  Maybe<size_t> sos = FindMarker(first, kJPEGMarkerSOS);
+  if (!sof || !sos) {
+    return NS_ERROR_FAILURE;
+  }
+  const size_t headerLength = scans[0].data() - first.Elements();
+  const uint8_t dri[] = {0xFF, kJPEGMarkerDRI, 0x00, 0x04,
+                         uint8_t(aRestartInterval >> 8),
+                         uint8_t(aRestartInterval)};
+  size += headerLength + std::size(dri);
+  if (!size.isValid()) {
+    return NS_ERROR_OUT_OF_MEMORY;
+  }
+
+  uint8_t* buffer = static_cast<uint8_t*>(malloc(size.value()));
+  if (!buffer) {
+    return NS_ERROR_OUT_OF_MEMORY;
+  }
+
+  // The headers up to SOS, a DRI segment and the SOS segment.
+  uint8_t* out = buffer;
+  memcpy(out, first.Elements(), *sos);
+  // SOF0 holds the sample precision followed by the height.
+  out[*sof + 5] = uint8_t(aHeight >> 8);
+  out[*sof + 6] = uint8_t(aHeight);
+  out += *sos;
+  memcpy(out, dri, std::size(dri));
+  out += std::size(dri);
+  memcpy(out, first.Elements() + *sos, headerLength - *sos);
+  out += headerLength - *sos;
+
+  for (uint32_t i = 0; i < stripCount; i++) {
+    memcpy(out, scans[i].data(), scans[i].size());
+    out += scans[i].size();
+    *out++ = 0xFF;
+    *out++ = i + 1 < stripCount ? kJPEGMarkerRST0 + i % 8 : JPEG_EOI;
+  }
+  MOZ_ASSERT(out == buffer + size.value());
+
+  {
+    ReentrantMonitorAutoEnter autoEnter(mReentrantMonitor);
+    mImageBuffer = buffer;
+    mImageBufferSize = size.value();
+    mImageBufferUsed = size.value();
+  }
+
+  mFinished = true;
+  NotifyListener();
+  return NS_OK;
+}
+
 NS_IMETHODIMP
 nsJPEGEncoder::StartImageEncode(uint32_t aWidth, uint32_t aHeight,
                                 uint32_t aInputFormat,
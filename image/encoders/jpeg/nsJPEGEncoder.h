@@ -12,6 +12,7 @@
 #include "mozilla/Attributes.h"
 
 #include "nsCOMPtr.h"
+#include "nsTArray.h"
 
 struct jpeg_compress_struct;
 struct jpeg_common_struct;
@@ -49,6 +50,14 @@ class nsJPEGEncoder final : public imgIEncoder {
   void ConvertRGBARow(const uint8_t* aSrc, uint8_t* aDest,
                       uint32_t aPixelWidth);
 
+  nsresult EncodeInStrips(const uint8_t* aData, uint32_t aWidth,
+                          uint32_t aHeight, uint32_t aStride,
+                          uint32_t aInputFormat, int aQuality,
+                          uint32_t aStripRows, uint32_t aRestartInterval);
+  nsresult EncodeStrip(const uint8_t* aData, uint32_t aWidth, uint32_t aBegin,
+                       uint32_t aEnd, uint32_t aStride, uint32_t aInputFormat,
+                       int aQuality, nsTArray<uint8_t>& aOut);
+
   void NotifyListener();
 
   bool mFinished;
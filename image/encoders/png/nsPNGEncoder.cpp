@@ -4,14 +4,22 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "ImageLogging.h"
+#include "ParallelStrips.h"
 #include "nsCRT.h"
 #include "nsPNGEncoder.h"
 #include "nsStreamUtils.h"
 #include "nsString.h"
+#include "nsTArray.h"
 #include "prprf.h"
 #include "mozilla/CheckedInt.h"
+#include "mozilla/ScopeExit.h"
+#include "mozilla/UniquePtr.h"
+#include "zlib.h"
+
+#include <iterator>
 
 using namespace mozilla;
+using mozilla::image::ParallelStrips;
 
 static LazyLogModule sPNGEncoderLog("PNGEncoder");
 
@@ -26,6 +34,9 @@ nsPNGEncoder::nsPNGEncoder()
       mPNGinfo(nullptr),
       mIsAnimation(false),
       mFinished(false),
+      mParallel(ParallelStrips::EnabledByDefault()),
+      mWroteStrips(false),
+      mZlibLevel(DEFAULT_ZLIB_LEVEL),
       mImageBuffer(nullptr),
       mImageBufferSize(0),
       mImageBufferUsed(0),
@@ -106,10 +117,12 @@ nsPNGEncoder::StartImageEncode(uint32_t aWidth, uint32_t aHeight,
   // parse and check any provided output options
   nsresult rv = ParseOptions(aOutputOptions, &useTransparency, &skipFirstFrame,
                              &numFrames, &numPlays, &zlibLevel, &filters,
-                             nullptr, nullptr, nullptr, nullptr, nullptr);
+                             nullptr, nullptr, nullptr, nullptr, nullptr,
+                             &mParallel);
   if (rv != NS_OK) {
     return rv;
   }
+  mZlibLevel = zlibLevel;
 
 #ifdef PNG_APNG_SUPPORTED
   if (numFrames > 1) {
@@ -245,7 +258,7 @@ nsPNGEncoder::AddImageFrame(const uint8_t* aData,
   // parse and check any provided output options
   nsresult rv = ParseOptions(aFrameOptions, &useTransparency, nullptr, nullptr,
                              nullptr, nullptr, &filters, &dispose_op, &blend_op,
-                             &delay_ms, &x_offset, &y_offset);
+                             &delay_ms, &x_offset, &y_offset, nullptr);
   if (rv != NS_OK) {
     return rv;
   }
@@ -269,6 +282,17 @@ nsPNGEncoder::AddImageFrame(const uint8_t* aData,
     return NS_ERROR_INVALID_ARG;
   }
 
+  if (mParallel && !mIsAnimation && !mWroteStrips &&
+      aWidth == png_get_image_width(mPNG, mPNGinfo) &&
+      aHeight == png_get_image_height(mPNG, mPNGinfo)) {
+    uint32_t stripRows = ParallelStrips::StripRows(
+        aHeight, png_get_rowbytes(mPNG, mPNGinfo));
+    if (stripRows) {
+      return AddImageFrameInStrips(aData, aWidth, aHeight, aStride,
+                                   aInputFormat, stripRows);
+    }
+  }
+
 #ifdef PNG_WRITE_FILTER_SUPPORTED
   png_set_filter(mPNG, PNG_FILTER_TYPE_BASE, filters);
 #endif
@@ -312,6 +336,296 @@ nsPNGEncoder::AddImageFrame(const uint8_t* aData,
   return NS_OK;
 }
 
+// Strip encoding
+//
+//    Each strip of rows is filtered and deflated into a raw deflate stream
+//    of its own. All but the last strip end with a sync flush, so the
+//    streams can simply be concatenated, and the dictionary of each strip is
+//    primed with the filtered data preceding it, so that the compression
+//    ratio is close to that of a serial encode. The Adler-32 checksums of the
+//    strips are combined for the zlib trailer.
+//
+//    Instead of libpng's adaptive filter heuristic, which filters every row
+//    five times, the filter is chosen by estimating the usual sum of
+//    absolute differences on a sample of each row, for all filters but
+//    Average, which rarely wins on rendered content.
+
+namespace {
+
+struct PNGStrip {
+  nsTArray<uint8_t> mData;
+  uLong mAdler = 1;
+  size_t mFilteredLength = 0;
+};
+
+}  // namespace
+
+static const uint32_t kDeflateWindowSize = 32 * 1024;
+static const uint32_t kFilterSampleBytes = 512;
+static const uint32_t kMaxIDATSize = 1024 * 1024;
+
+static inline uint8_t PaethPredictor(uint8_t aLeft, uint8_t aUp,
+                                     uint8_t aUpLeft) {
+  int p = int(aLeft) + int(aUp) - int(aUpLeft);
+  int pa = abs(p - int(aLeft));
+  int pb = abs(p - int(aUp));
+  int pc = abs(p - int(aUpLeft));
+  if (pa <= pb && pa <= pc) {
+    return aLeft;
+  }
+  return pb <= pc ? aUp : aUpLeft;
+}
+
+static inline uint32_t FilterCost(uint8_t aByte) {
+  return aByte < 128 ? aByte : 256 - aByte;
+}
+
+static uint8_t ChooseFilter(const uint8_t* aRow, const uint8_t* aPrev,
+                            uint32_t aRowBytes, uint32_t aBpp) {
+  static const uint8_t kFilters[] = {PNG_FILTER_VALUE_NONE,
+                                     PNG_FILTER_VALUE_SUB, PNG_FILTER_VALUE_UP,
+                                     PNG_FILTER_VALUE_PAETH};
+  uint32_t costs[std::size(kFilters)] = {};
+
+  uint32_t step = std::max(1u, aRowBytes / kFilterSampleBytes);
+  for (uint32_t i = 0; i < aRowBytes; i += step) {
+    uint8_t x = aRow[i];
+    uint8_t a = i >= aBpp ? aRow[i - aBpp] : 0;
+    uint8_t b = aPrev[i];
+    uint8_t c = i >= aBpp ? aPrev[i - aBpp] : 0;
+    costs[0] += FilterCost(x);
+    costs[1] += FilterCost(uint8_t(x - a));
+    costs[2] += FilterCost(uint8_t(x - b));
+    costs[3] += FilterCost(uint8_t(x - PaethPredictor(a, b, c)));
+  }
+
+  size_t best = 0;
+  for (size_t i = 1; i < std::size(kFilters); i++) {
+    if (costs[i] < costs[best]) {
+      best = i;
+    }
+  }
+  return kFilters[best];
+}
+
+// Writes the filter type followed by the filtered row to aOut.
+static void FilterRow(uint8_t aFilter, const uint8_t* aRow,
+                      const uint8_t* aPrev, uint32_t aRowBytes, uint32_t aBpp,
+                      uint8_t* aOut) {
+  aOut[0] = aFilter;
+  uint8_t* out = aOut + 1;
+  switch (aFilter) {
+    case PNG_FILTER_VALUE_SUB:
+      memcpy(out, aRow, aBpp);
+      for (uint32_t i = aBpp; i < aRowBytes; i++) {
+        out[i] = aRow[i] - aRow[i - aBpp];
+      }
+      break;
+    case PNG_FILTER_VALUE_UP:
+      for (uint32_t i = 0; i < aRowBytes; i++) {
+        out[i] = aRow[i] - aPrev[i];
+      }
+      break;
+    case PNG_FILTER_VALUE_PAETH:
+      for (uint32_t i = 0; i < aBpp; i++) {
+        out[i] = aRow[i] - aPrev[i];
+      }
+      for (uint32_t i = aBpp; i < aRowBytes; i++) {
+        out[i] = aRow[i] - PaethPredictor(aRow[i - aBpp], aPrev[i],
+                                          aPrev[i - aBpp]);
+      }
+      break;
+    default:
+      MOZ_ASSERT(aFilter == PNG_FILTER_VALUE_NONE);
+      memcpy(out, aRow, aRowBytes);
+      break;
+  }
+}
+
+// Deflates aLength bytes at aData, appending the output to aOut.
+static nsresult DeflateInto(z_stream& aStream, const uint8_t* aData,
+                            uint32_t aLength, int aFlush,
+                            nsTArray<uint8_t>& aOut) {
+  static const uint32_t kOutputChunk = 64 * 1024;
+  aStream.next_in = const_cast<Bytef*>(aData);
+  aStream.avail_in = aLength;
+  do {
+    size_t used = aOut.Length();
+    if (!aOut.SetLength(used + kOutputChunk, fallible)) {
+      return NS_ERROR_OUT_OF_MEMORY;
+    }
+    aStream.next_out = aOut.Elements() + used;
+    aStream.avail_out = kOutputChunk;
+    int rv = deflate(&aStream, aFlush);
+    aOut.TruncateLength(used + kOutputChunk - aStream.avail_out);
+    if (rv == Z_STREAM_ERROR) {
+      return NS_ERROR_FAILURE;
+    }
+  } while (aStream.avail_out == 0);
+  return NS_OK;
+}
+
+// Kept free of locals with destructors since libpng may longjmp out of it.
+static bool WriteIDATChunks(png_structp aPNG,
+                            const nsTArray<PNGStrip>& aStrips) {
+  if (setjmp(png_jmpbuf(aPNG))) {
+    return false;
+  }
+  for (const PNGStrip& strip : aStrips) {
+    for (size_t offset = 0; offset < strip.mData.Length();
+         offset += kMaxIDATSize) {
+      png_write_chunk(aPNG, reinterpret_cast<png_const_bytep>("IDAT"),
+                      strip.mData.Elements() + offset,
+                      std::min<size_t>(kMaxIDATSize,
+                                       strip.mData.Length() - offset));
+    }
+  }
+  return true;
+}
+
+nsresult nsPNGEncoder::AddImageFrameInStrips(const uint8_t* aData,
+                                             uint32_t aWidth, uint32_t aHeight,
+                                             uint32_t aStride,
+                                             uint32_t aInputFormat,
+                                             uint32_t aStripRows) {
+  const uint32_t rowBytes = png_get_rowbytes(mPNG, mPNGinfo);
+  const uint32_t filteredRowBytes = rowBytes + 1;
+  // All our color types have 8 bit samples.
+  const uint32_t bpp = png_get_channels(mPNG, mPNGinfo);
+  const bool hasAlpha = bpp == 4;
+  const uint32_t stripCount = (aHeight + aStripRows - 1) / aStripRows;
+  const int zlibLevel = mZlibLevel;
+
+  // The zlib header, see RFC 1950.
+  const uint8_t cmf = 0x78;
+  uint8_t compressionLevel = zlibLevel < 2    ? 0
+                             : zlibLevel < 6  ? 1
+                             : zlibLevel == 6 ? 2
+                                              : 3;
+  uint8_t flg = compressionLevel << 6;
+  flg += (31 - (cmf * 256 + flg) % 31) % 31;
+  const uint8_t zlibHeader[] = {cmf, flg};
+
+  nsTArray<PNGStrip> strips;
+  if (!strips.SetLength(stripCount, fallible)) {
+    return NS_ERROR_OUT_OF_MEMORY;
+  }
+
+  auto convertRow = [&](uint32_t aY, uint8_t* aDest) {
+    const uint8_t* src = &aData[size_t(aY) * aStride];
+    if (aInputFormat == INPUT_FORMAT_HOSTARGB) {
+      ConvertHostARGBRow(src, aDest, aWidth, hasAlpha);
+    } else if (aInputFormat == INPUT_FORMAT_RGBA && !hasAlpha) {
+      StripAlpha(src, aDest, aWidth);
+    } else {
+      memcpy(aDest, src, rowBytes);
+    }
+  };
+
+  auto encodeStrip = [&](uint32_t aIndex) -> nsresult {
+    PNGStrip& strip = strips[aIndex];
+    uint32_t begin = aIndex * aStripRows;
+    uint32_t end = std::min(aHeight, begin + aStripRows);
+
+    UniquePtr<uint8_t[]> buffer =
+        MakeUniqueFallible<uint8_t[]>(2 * rowBytes + filteredRowBytes);
+    if (!buffer) {
+      return NS_ERROR_OUT_OF_MEMORY;
+    }
+    uint8_t* prev = buffer.get();
+    uint8_t* cur = prev + rowBytes;
+    uint8_t* filtered = cur + rowBytes;
+
+    z_stream stream = {};
+    int zrv = deflateInit2(&stream, zlibLevel, Z_DEFLATED, -MAX_WBITS, 8,
+                           Z_FILTERED);
+    if (zrv != Z_OK) {
+      return zrv == Z_MEM_ERROR ? NS_ERROR_OUT_OF_MEMORY : NS_ERROR_FAILURE;
+    }
+    auto endStream = MakeScopeExit([&] { deflateEnd(&stream); });
+
+    if (aIndex == 0) {
+      strip.mData.AppendElements(zlibHeader, std::size(zlibHeader));
+    }
+
+    // Filter the rows at the end of the previous strip again, as the
+    // dictionary for this one.
+    uint32_t dictionaryRows =
+        std::min(begin, (kDeflateWindowSize + filteredRowBytes - 1) /
+                            filteredRowBytes);
+    uint32_t first = begin - dictionaryRows;
+    nsTArray<uint8_t> dictionary;
+    if (!dictionary.SetCapacity(dictionaryRows * filteredRowBytes,
+                                fallible)) {
+      return NS_ERROR_OUT_OF_MEMORY;
+    }
+
+    if (first > 0) {
+      convertRow(first - 1, prev);
+    } else {
+      memset(prev, 0, rowBytes);
+    }
+    for (uint32_t y = first; y < end; y++) {
+      convertRow(y, cur);
+      FilterRow(ChooseFilter(cur, prev, rowBytes, bpp), cur, prev, rowBytes,
+                bpp, filtered);
+      std::swap(prev, cur);
+
+      if (y < begin) {
+        dictionary.AppendElements(filtered, filteredRowBytes);
+        continue;
+      }
+      if (y == begin && !dictionary.IsEmpty()) {
+        uint32_t length =
+            std::min<uint32_t>(dictionary.Length(), kDeflateWindowSize);
+        if (deflateSetDictionary(
+                &stream, dictionary.Elements() + dictionary.Length() - length,
+                length) != Z_OK) {
+          return NS_ERROR_FAILURE;
+        }
+      }
+      strip.mAdler = adler32(strip.mAdler, filtered, filteredRowBytes);
+      nsresult rv = DeflateInto(stream, filtered, filteredRowBytes,
+                                Z_NO_FLUSH, strip.mData);
+      if (NS_FAILED(rv)) {
+        return rv;
+      }
+    }
+
+    strip.mFilteredLength = size_t(end - begin) * filteredRowBytes;
+    return DeflateInto(stream, nullptr, 0,
+                       aIndex + 1 == stripCount ? Z_FINISH : Z_SYNC_FLUSH,
+                       strip.mData);
+  };
+
+  nsresult rv = ParallelStrips::Run(stripCount, encodeStrip);
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+
+  uLong adler = adler32(0, nullptr, 0);
+  for (const PNGStrip& strip : strips) {
+    adler =
+        adler32_combine(adler, strip.mAdler, z_off_t(strip.mFilteredLength));
+  }
+  const uint8_t trailer[] = {uint8_t(adler >> 24), uint8_t(adler >> 16),
+                             uint8_t(adler >> 8), uint8_t(adler)};
+  if (!strips.LastElement().mData.AppendElements(trailer, std::size(trailer),
+                                                 fallible)) {
+    return NS_ERROR_OUT_OF_MEMORY;
+  }
+
+  if (!WriteIDATChunks(mPNG, strips)) {
+    png_destroy_write_struct(&mPNG, &mPNGinfo);
+    return NS_ERROR_FAILURE;
+  }
+  mWroteStrips = true;
+
+  MOZ_LOG(sPNGEncoderLog, LogLevel::Debug,
+          ("Encoded %ux%u image in %u strips", aWidth, aHeight, stripCount));
+  return NS_OK;
+}
+
 NS_IMETHODIMP
 nsPNGEncoder::EndImageEncode() {
   // must be initialized
@@ -331,7 +645,14 @@ nsPNGEncoder::EndImageEncode() {
     return NS_ERROR_FAILURE;
   }
 
-  png_write_end(mPNG, mPNGinfo);
+  if (mWroteStrips) {
+    // libpng doesn't know about the IDAT chunks we wrote, so png_write_end
+    // would complain. We write no chunks after the image data anyway.
+    png_write_chunk(mPNG, reinterpret_cast<png_const_bytep>("IEND"), nullptr,
+                    0);
+  } else {
+    png_write_end(mPNG, mPNGinfo);
+  }
   png_destroy_write_struct(&mPNG, &mPNGinfo);
 
   mFinished = true;
@@ -351,7 +672,8 @@ nsresult nsPNGEncoder::ParseOptions(const nsAString& aOptions,
                                     int* zlibLevel, int* filters,
                                     uint32_t* frameDispose,
                                     uint32_t* frameBlend, uint32_t* frameDelay,
-                                    uint32_t* offsetX, uint32_t* offsetY) {
+                                    uint32_t* offsetX, uint32_t* offsetY,
+                                    bool* parallel) {
 #ifdef PNG_APNG_SUPPORTED
   // Make a copy of aOptions, because strtok() will modify it.
   nsAutoCString optionsCopy;
@@ -551,6 +873,17 @@ nsresult nsPNGEncoder::ParseOptions(const nsAString& aOptions,
         return NS_ERROR_INVALID_ARG;
       }
 
+      // parallel=[yes|no]
+    } else if (nsCRT::strcmp(token, "parallel") == 0) {
+      bool localParallel;
+      if (!value || !ParallelStrips::ParseOption(value, &localParallel)) {
+        return NS_ERROR_INVALID_ARG;
+      }
+
+      if (parallel) {
+        *parallel = localParallel;
+      }
+
       // unknown token name
     } else
       return NS_ERROR_INVALID_ARG;
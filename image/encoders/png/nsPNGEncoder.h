@@ -42,10 +42,13 @@ class nsPNGEncoder final : public imgIEncoder {
                         uint32_t* numIterations, int* zlibLevel, int* filters,
                         uint32_t* frameDispose, uint32_t* frameBlend,
                         uint32_t* frameDelay, uint32_t* offsetX,
-                        uint32_t* offsetY);
+                        uint32_t* offsetY, bool* parallel);
   void ConvertHostARGBRow(const uint8_t* aSrc, uint8_t* aDest,
                           uint32_t aPixelWidth, bool aUseTransparency);
   void StripAlpha(const uint8_t* aSrc, uint8_t* aDest, uint32_t aPixelWidth);
+  nsresult AddImageFrameInStrips(const uint8_t* aData, uint32_t aWidth,
+                                 uint32_t aHeight, uint32_t aStride,
+                                 uint32_t aInputFormat, uint32_t aStripRows);
   static void WarningCallback(png_structp png_ptr, png_const_charp warning_msg);
   static void ErrorCallback(png_structp png_ptr, png_const_charp error_msg);
   static void WriteCallback(png_structp png, png_bytep data, png_size_t size);
@@ -58,6 +61,14 @@ class nsPNGEncoder final : public imgIEncoder {
   bool mIsAnimation;
   bool mFinished;
 
+  // Whether to filter and deflate strips of rows on several threads. See
+  // ParallelStrips.h.
+  bool mParallel;
+  // Whether the image data was written by AddImageFrameInStrips, which
+  // bypasses libpng's IDAT writer.
+  bool mWroteStrips;
+  int mZlibLevel;
+
   // image buffer
   uint8_t* mImageBuffer;
   uint32_t mImageBufferSize;
@@ -0,0 +1,228 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include "ImageOps.h"
+#include "gfxPlatform.h"
+#include "imgIContainer.h"
+#include "imgIEncoder.h"
+#include "imgITools.h"
+#include "mozilla/gfx/2D.h"
+#include "nsComponentManagerUtils.h"
+#include "nsIInputStream.h"
+#include "nsStreamUtils.h"
+#include "nsString.h"
+#include "nsStringStream.h"
+#include "nsTArray.h"
+
+using namespace mozilla;
+using namespace mozilla::gfx;
+using namespace mozilla::image;
+
+// Encodes page screenshots, a tall surface of mostly white background with
+// lines of text-like glyphs and a few photo-like blocks, with and without
+// strip encoding. The tests use pages which are just tall enough to be split
+// into several strips, the benches a full page screenshot.
+
+namespace {
+
+struct PageSurface {
+  uint32_t mWidth;
+  uint32_t mHeight;
+  nsTArray<uint8_t> mRGBA;
+};
+
+}  // namespace
+
+static PageSurface MakePageSurface(uint32_t aWidth, uint32_t aHeight) {
+  PageSurface page{aWidth, aHeight, {}};
+  page.mRGBA.SetLength(size_t(aWidth) * aHeight * 4);
+
+  uint32_t seed = 12345;
+  auto random = [&seed] {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+  };
+
+  for (uint32_t y = 0; y < aHeight; y++) {
+    uint8_t* row = &page.mRGBA[size_t(y) * aWidth * 4];
+    bool photo = (y / 300) % 3 == 2 && y % 300 < 200;
+    bool textLine = y % 24 < 14;
+    for (uint32_t x = 0; x < aWidth; x++) {
+      uint8_t* pixel = &row[x * 4];
+      if (photo && x > aWidth / 8 && x < aWidth * 7 / 8) {
+        pixel[0] = uint8_t(x + y + (random() & 7));
+        pixel[1] = uint8_t(x * 2 - y + (random() & 7));
+        pixel[2] = uint8_t(128 + (x ^ y) % 64);
+      } else if (textLine && x > 40 && x < aWidth - 40 &&
+                 ((x / 7 + y / 24) * 2654435761u >> 28) % 5 != 0 &&
+                 ((x * 31 + y * 17) % 11) < 4) {
+        pixel[0] = pixel[1] = pixel[2] = 0x20;
+      } else {
+        pixel[0] = pixel[1] = pixel[2] = 0xFF;
+      }
+      pixel[3] = 0xFF;
+    }
+  }
+  return page;
+}
+
+static bool Encode(const char* aType, const PageSurface& aPage,
+                   const nsAString& aOptions, nsTArray<uint8_t>& aOut) {
+  nsAutoCString contractId("@mozilla.org/image/encoder;2?type=");
+  contractId.Append(aType);
+  nsCOMPtr<imgIEncoder> encoder = do_CreateInstance(contractId.get());
+  if (!encoder) {
+    return false;
+  }
+
+  nsresult rv = encoder->InitFromData(
+      aPage.mRGBA.Elements(), aPage.mRGBA.Length(), aPage.mWidth,
+      aPage.mHeight, aPage.mWidth * 4, imgIEncoder::INPUT_FORMAT_RGBA,
+      aOptions);
+  if (NS_FAILED(rv)) {
+    return false;
+  }
+
+  uint32_t size = 0;
+  encoder->GetImageBufferUsed(&size);
+  char* buffer = nullptr;
+  encoder->GetImageBuffer(&buffer);
+  aOut.Clear();
+  aOut.AppendElements(reinterpret_cast<uint8_t*>(buffer), size);
+  return true;
+}
+
+static already_AddRefed<DataSourceSurface> Decode(
+    const char* aType, const nsTArray<uint8_t>& aEncoded) {
+  nsCOMPtr<nsIInputStream> stream;
+  nsresult rv = NS_NewByteInputStream(
+      getter_AddRefs(stream),
+      Span(reinterpret_cast<const char*>(aEncoded.Elements()),
+           aEncoded.Length()),
+      NS_ASSIGNMENT_DEPEND);
+  if (NS_FAILED(rv)) {
+    return nullptr;
+  }
+  RefPtr<SourceSurface> surface =
+      ImageOps::DecodeToSurface(stream.forget(), nsDependentCString(aType),
+                                imgIContainer::DECODE_FLAGS_DEFAULT);
+  return surface ? surface->GetDataSurface() : nullptr;
+}
+
+static bool SurfacesEqual(DataSourceSurface* aA, DataSourceSurface* aB) {
+  if (aA->GetSize() != aB->GetSize()) {
+    return false;
+  }
+  DataSourceSurface::ScopedMap mapA(aA, DataSourceSurface::READ);
+  DataSourceSurface::ScopedMap mapB(aB, DataSourceSurface::READ);
+  for (int32_t y = 0; y < aA->GetSize().height; y++) {
+    if (memcmp(mapA.GetData() + y * mapA.GetStride(),
+               mapB.GetData() + y * mapB.GetStride(),
+               aA->GetSize().width * 4) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool MatchesPage(DataSourceSurface* aSurface, const PageSurface& aPage) {
+  if (aSurface->GetSize() != IntSize(aPage.mWidth, aPage.mHeight)) {
+    return false;
+  }
+  DataSourceSurface::ScopedMap map(aSurface, DataSourceSurface::READ);
+  for (uint32_t y = 0; y < aPage.mHeight; y++) {
+    const uint8_t* decoded = map.GetData() + y * map.GetStride();
+    const uint8_t* source = &aPage.mRGBA[size_t(y) * aPage.mWidth * 4];
+    for (uint32_t x = 0; x < aPage.mWidth; x++) {
+      // Decoded surfaces are BGRA.
+      if (decoded[x * 4] != source[x * 4 + 2] ||
+          decoded[x * 4 + 1] != source[x * 4 + 1] ||
+          decoded[x * 4 + 2] != source[x * 4]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+class ImageEncoderStrips : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    // Ensure that ImageLib services are initialized.
+    nsCOMPtr<imgITools> imgTools =
+        do_CreateInstance("@mozilla.org/image/tools;1");
+    EXPECT_TRUE(imgTools != nullptr);
+    gfxPlatform::GetPlatform();
+  }
+};
+
+TEST_F(ImageEncoderStrips, PNGRoundTrips)
+{
+  PageSurface page = MakePageSurface(1280, 1024);
+  nsTArray<uint8_t> serial, parallel;
+  ASSERT_TRUE(Encode("image/png", page, u"parallel=no"_ns, serial));
+  ASSERT_TRUE(Encode("image/png", page, u"parallel=yes"_ns, parallel));
+
+  RefPtr<DataSourceSurface> decoded = Decode("image/png", parallel);
+  ASSERT_TRUE(decoded);
+  ASSERT_TRUE(MatchesPage(decoded, page));
+
+  // Priming each strip with the previous one's data keeps the size close.
+  EXPECT_LT(parallel.Length(), serial.Length() * 11 / 10);
+}
+
+TEST_F(ImageEncoderStrips, JPEGMatchesSerial)
+{
+  PageSurface page = MakePageSurface(1000, 1001);
+  // Below quality 90 chroma is subsampled, so MCUs are 16 rows tall.
+  for (const char16_t* quality : {u"quality=80", u"quality=95"}) {
+    nsAutoString serialOptions(quality);
+    serialOptions.AppendLiteral(";parallel=no");
+    nsAutoString parallelOptions(quality);
+    parallelOptions.AppendLiteral(";parallel=yes");
+
+    nsTArray<uint8_t> serial, parallel;
+    ASSERT_TRUE(Encode("image/jpeg", page, serialOptions, serial));
+    ASSERT_TRUE(Encode("image/jpeg", page, parallelOptions, parallel));
+
+    RefPtr<DataSourceSurface> serialDecoded = Decode("image/jpeg", serial);
+    RefPtr<DataSourceSurface> parallelDecoded = Decode("image/jpeg", parallel);
+    ASSERT_TRUE(serialDecoded && parallelDecoded);
+    // Restart markers don't change the coefficients.
+    ASSERT_TRUE(SurfacesEqual(serialDecoded, parallelDecoded));
+  }
+}
+
+TEST_F(ImageEncoderStrips, RejectsBadOption)
+{
+  PageSurface page = MakePageSurface(64, 64);
+  nsTArray<uint8_t> out;
+  ASSERT_FALSE(Encode("image/png", page, u"parallel=maybe"_ns, out));
+  ASSERT_FALSE(Encode("image/jpeg", page, u"parallel=maybe"_ns, out));
+}
+
+// A full page screenshot of a long article.
+static const PageSurface& BenchPage() {
+  static const PageSurface sPage = MakePageSurface(1920, 16000);
+  return sPage;
+}
+
+static void BenchEncode(const char* aType, bool aParallel) {
+  nsTArray<uint8_t> out;
+  ASSERT_TRUE(Encode(aType, BenchPage(),
+                     aParallel ? u"parallel=yes"_ns : u"parallel=no"_ns, out));
+}
+
+MOZ_GTEST_BENCH_F(ImageEncoderStrips, PNGSerial,
+                  [] { BenchEncode("image/png", false); });
+MOZ_GTEST_BENCH_F(ImageEncoderStrips, PNGParallel,
+                  [] { BenchEncode("image/png", true); });
+MOZ_GTEST_BENCH_F(ImageEncoderStrips, JPEGSerial,
+                  [] { BenchEncode("image/jpeg", false); });
+MOZ_GTEST_BENCH_F(ImageEncoderStrips, JPEGParallel,
+                  [] { BenchEncode("image/jpeg", true); });
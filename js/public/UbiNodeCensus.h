@@ -69,8 +69,22 @@
 // To keep actual count nodes small, they have no vtable. Instead, each count
 // points to its CountType, which knows how to carry out all the operations we
 // need on a Count. A CountType can produce new count nodes; process nodes as we
-// visit them; build a JS object reporting the results; and destruct count
-// nodes.
+// visit them; merge count nodes; build a JS object reporting the results; and
+// destruct count nodes.
+//
+// Large heaps may be counted in parallel, if the census options ask for it
+// with { parallel: true }. The traversal then only collects the nodes to
+// count, which are split into contiguous ranges. Each range is counted into a
+// count tree of its own on a helper thread, and the trees are merged in order
+// of their ranges. Since merging a count tree behaves as if its nodes had
+// been counted after those already counted, the report is exactly the same as
+// that of a serial census.
+//
+// Only the counting is split up. The traversal itself still runs on the main
+// thread: BreadthFirst's visited set and the edge ranges of ubi::Nodes are not
+// thread safe, and DOM nodes may not be used off the main thread at all. A
+// parallel census therefore speeds up the counting, most of all for
+// breakdowns which look up tables for every node, but not the walk.
 
 namespace JS {
 namespace ubi {
@@ -106,6 +120,12 @@ struct CountType {
                                    mozilla::MallocSizeOf mallocSizeOf,
                                    const Node& node) = 0;
 
+  // Merge the counts recorded in |other| into |count|, both of which this type
+  // instance constructed, as if the nodes |other| counted had been counted by
+  // |count|. Any children of |other| may be moved into |count|. Return false
+  // on OOM.
+  [[nodiscard]] virtual bool merge(CountBase& count, CountBase& other) = 0;
+
   // Implement the 'report' method for counts returned by this CountType
   // instance's 'newCount' method.
   [[nodiscard]] virtual bool report(JSContext* cx, CountBase& count,
@@ -152,6 +172,20 @@ class CountBase {
     return ret;
   }
 
+  // Merge the counts recorded in |other|, which must have the same type as
+  // this count, into this count. |other| is left in an unspecified state.
+  // Return false on OOM.
+  [[nodiscard]] bool merge(CountBase& other) {
+    MOZ_ASSERT(&type == &other.type);
+
+    total_ += other.total_;
+    if (other.smallestNodeIdCounted_ < smallestNodeIdCounted_) {
+      smallestNodeIdCounted_ = other.smallestNodeIdCounted_;
+    }
+
+    return type.merge(*this, other);
+  }
+
   // Construct a JavaScript object reporting the counts recorded in this
   // count, and store it in |report|. Return true on success, or false on
   // failure.
@@ -159,6 +193,10 @@ class CountBase {
     return type.report(cx, *this, report);
   }
 
+  // Return a fresh count of the same type as this count. Return a nullptr on
+  // OOM.
+  CountBasePtr makeEmptyCount() { return type.makeCount(); }
+
   // Down-cast this CountBase to its true type, based on its 'type' member,
   // and run its destructor.
   void destruct() { return type.destructCount(*this); }
@@ -182,6 +220,14 @@ struct Census {
   // is an element of the set. If the targetZones set is empty, then nodes in
   // all zones are considered.
   JS::ZoneSet targetZones;
+  // If true, the census handler only collects the nodes to count during the
+  // traversal, and counts them when CensusHandler::finish is called, on
+  // helper threads if there are enough of them. The report is the same
+  // either way.
+  bool parallel = false;
+  // A parallel census only uses helper threads if each of them gets at least
+  // this many nodes to count. Tests lower this to split up small heaps.
+  size_t minParallelNodes = 64 * 1024;
 
   explicit Census(JSContext* cx) : cx(cx) {}
 };
@@ -193,12 +239,28 @@ class CensusHandler {
   JS::Handle<CountBasePtr> rootCount;
   mozilla::MallocSizeOf mallocSizeOf;
 
+  // The nodes collected by a parallel census, in the order the traversal
+  // reached them.
+  JS::ubi::Vector<Node> pending;
+  // Whether |pending| contains DOM nodes, whose ubi::Node implementations may
+  // only be used on the main thread.
+  bool pendingHasDOMNodes = false;
+
+  [[nodiscard]] bool count(const Node& node);
+  [[nodiscard]] bool countPendingInParallel(size_t workers);
+
  public:
   CensusHandler(Census& census, JS::Handle<CountBasePtr> rootCount,
                 mozilla::MallocSizeOf mallocSizeOf)
       : census(census), rootCount(rootCount), mallocSizeOf(mallocSizeOf) {}
 
+  // Count the nodes collected by a parallel census. This must be called once
+  // the traversal is complete, while the traversal's AutoCheckCannotGC is
+  // still live. Return false on OOM.
+  [[nodiscard]] JS_PUBLIC_API bool finish();
+
   [[nodiscard]] bool report(JSContext* cx, MutableHandleValue report) {
+    MOZ_ASSERT(pending.empty());
     return rootCount->report(cx, report);
   }
 
@@ -1828,8 +1828,10 @@ static ComparatorMatchResult MatchNumericComparator(JSContext* cx,
 
   jsbytecode* pc = script->code();
 
+  // The two GetArgs are usually fused into a GetArgPair, which leaves the
+  // second one in place.
   uint16_t arg0, arg1;
-  if (JSOp(*pc) != JSOp::GetArg) {
+  if (JSOp(*pc) != JSOp::GetArg && JSOp(*pc) != JSOp::GetArgPair) {
     return Match_None;
   }
   arg0 = GET_ARGNO(pc);
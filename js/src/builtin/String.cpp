@@ -3974,6 +3974,122 @@ static ArrayObject* SplitSingleCharHelper(JSContext* cx,
                                ch);
 }
 
+/* static */
+bool js::StringSplitCache::isCacheable(JSLinearString* str,
+                                       JSLinearString* sep) {
+  // TaintFox: splitting a tainted string records a taint flow on each of its
+  // substrings, so these must not be shared.
+  if (str->isTainted() || sep->isTainted()) {
+    return false;
+  }
+  return (str->isAtom() || str->length() <= MaxInputLength) &&
+         sep->length() <= MaxInputLength;
+}
+
+static bool SplitCacheKeyMatches(JSLinearString* key, JSLinearString* str) {
+  if (key == str) {
+    return true;
+  }
+  if (key->isAtom() && str->isAtom()) {
+    return false;
+  }
+  return EqualStrings(key, str);
+}
+
+const Value* js::StringSplitCache::lookup(JSLinearString* str,
+                                          JSLinearString* sep,
+                                          uint32_t* length) {
+  for (Entry& entry : entries_) {
+    if (!entry.str || !SplitCacheKeyMatches(entry.str, str) ||
+        !SplitCacheKeyMatches(entry.sep, sep)) {
+      continue;
+    }
+
+    // TaintFox: the substrings may have been tainted since they were cached,
+    // in which case they are no longer the result of splitting |str|.
+    for (const Value& sub : entry.substrings) {
+      if (sub.toString()->isTainted()) {
+        entry.clear();
+        misses_++;
+        return nullptr;
+      }
+    }
+
+    hits_++;
+    *length = entry.substrings.length();
+    return entry.substrings.begin();
+  }
+
+  misses_++;
+  return nullptr;
+}
+
+void js::StringSplitCache::add(JSLinearString* str, JSLinearString* sep,
+                               ArrayObject* result) {
+  uint32_t length = result->getDenseInitializedLength();
+  if (length > MaxSubstrings) {
+    return;
+  }
+
+  Entry& entry = entries_[nextEntry_];
+  nextEntry_ = (nextEntry_ + 1) % NumEntries;
+
+  entry.clear();
+  const Value* substrings = result->getDenseElements();
+  if (!entry.substrings.append(substrings, length)) {
+    return;
+  }
+  entry.str = str;
+  entry.sep = sep;
+}
+
+// Returns a new array holding the cached substrings of |str| split by |sep|,
+// or nullptr with |*found| set to false if there are none.
+static ArrayObject* SplitFromCache(JSContext* cx, Handle<JSLinearString*> str,
+                                   Handle<JSLinearString*> sep, bool* found) {
+  StringSplitCache& cache = cx->realm()->stringSplitCache;
+
+  uint32_t length;
+  const Value* substrings = cache.lookup(str, sep, &length);
+  if (!substrings) {
+    *found = false;
+    return nullptr;
+  }
+  uint64_t purgeCount = cache.purgeCount();
+
+  *found = true;
+  Rooted<ArrayObject*> result(cx, NewDenseFullyAllocatedArray(cx, length));
+  if (!result) {
+    return nullptr;
+  }
+
+  // Allocating the array may have GC'd, which frees the cached substrings.
+  // This is rare enough to just split the string again.
+  if (cache.purgeCount() != purgeCount) {
+    *found = false;
+    return nullptr;
+  }
+
+  result->initDenseElements(substrings, length);
+  return result;
+}
+
+static ArrayObject* SplitStringUncached(JSContext* cx,
+                                        Handle<JSLinearString*> linearStr,
+                                        Handle<JSLinearString*> linearSep,
+                                        uint32_t limit) {
+  if (linearSep->length() == 0) {
+    return CharSplitHelper(cx, linearStr, limit);
+  }
+
+  if (linearSep->length() == 1 && limit >= static_cast<uint32_t>(INT32_MAX)) {
+    char16_t ch = linearSep->latin1OrTwoByteChar(0);
+    return SplitSingleCharHelper(cx, linearStr, ch);
+  }
+
+  return SplitHelper(cx, linearStr, limit, linearSep);
+}
+
 // ES 2016 draft Mar 25, 2016 21.1.3.17 steps 4, 8, 12-18.
 ArrayObject* js::StringSplitString(JSContext* cx, HandleString str,
                                    HandleString sep, uint32_t limit) {
@@ -3989,16 +4105,22 @@ ArrayObject* js::StringSplitString(JSContext* cx, HandleString str,
     return nullptr;
   }
 
-  if (linearSep->length() == 0) {
-    return CharSplitHelper(cx, linearStr, limit);
+  // Only splits without a limit are cached, which covers nearly all of them.
+  bool cacheable = limit >= static_cast<uint32_t>(INT32_MAX) &&
+                   StringSplitCache::isCacheable(linearStr, linearSep);
+  if (cacheable) {
+    bool found;
+    ArrayObject* result = SplitFromCache(cx, linearStr, linearSep, &found);
+    if (found) {
+      return result;
+    }
   }
 
-  if (linearSep->length() == 1 && limit >= static_cast<uint32_t>(INT32_MAX)) {
-    char16_t ch = linearSep->latin1OrTwoByteChar(0);
-    return SplitSingleCharHelper(cx, linearStr, ch);
+  ArrayObject* result = SplitStringUncached(cx, linearStr, linearSep, limit);
+  if (result && cacheable) {
+    cx->realm()->stringSplitCache.add(linearStr, linearSep, result);
   }
-
-  return SplitHelper(cx, linearStr, limit, linearSep);
+  return result;
 }
 
 static const JSFunctionSpec string_methods[] = {
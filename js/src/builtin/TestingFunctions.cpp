@@ -46,6 +46,7 @@
 #include "fdlibm.h"
 #include "jsapi.h"
 #include "jsfriendapi.h"
+#include "TaintTrace.h"
 
 #ifdef JS_HAS_INTL_API
 #  include "builtin/intl/CommonFunctions.h"
@@ -63,6 +64,7 @@
 #include "gc/Allocator.h"
 #include "gc/GC.h"
 #include "gc/GCLock.h"
+#include "gc/Memory.h"
 #include "gc/Zone.h"
 #include "jit/BaselineJIT.h"
 #include "jit/Disassemble.h"
@@ -1995,6 +1997,44 @@ static bool WasmLoadedFromCache(JSContext* cx, unsigned argc, Value* vp) {
   return WasmReturnFlag(cx, argc, vp, Flag::Deserialized);
 }
 
+static bool WasmLazyFunctionStats(JSContext* cx, unsigned argc, Value* vp) {
+  CallArgs args = CallArgsFromVp(argc, vp);
+
+  if (!args.get(0).isObject()) {
+    JS_ReportErrorASCII(cx, "argument is not an object");
+    return false;
+  }
+
+  Rooted<WasmModuleObject*> module(
+      cx, args[0].toObject().maybeUnwrapIf<WasmModuleObject>());
+  if (!module) {
+    JS_ReportErrorASCII(cx, "argument is not a WebAssembly.Module");
+    return false;
+  }
+
+  const wasm::LazyFuncs* lazyFuncs = module->module().code().lazyFuncs();
+  if (!lazyFuncs) {
+    args.rval().setNull();
+    return true;
+  }
+
+  RootedObject result(cx, JS_NewPlainObject(cx));
+  if (!result) {
+    return false;
+  }
+  RootedValue val(cx, NumberValue(lazyFuncs->numFuncDefs()));
+  if (!JS_DefineProperty(cx, result, "functions", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  val = NumberValue(lazyFuncs->numCompiled());
+  if (!JS_DefineProperty(cx, result, "compiled", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+
+  args.rval().setObject(*result);
+  return true;
+}
+
 static bool WasmIntrinsicI8VecMul(JSContext* cx, unsigned argc, Value* vp) {
   if (!wasm::HasSupport(cx)) {
     JS_ReportErrorASCII(cx, "wasm support unavailable");
@@ -2513,6 +2553,50 @@ static bool GCState(JSContext* cx, unsigned argc, Value* vp) {
   return ReturnStringCopy(cx, args, state);
 }
 
+static bool GCHugePageStats(JSContext* cx, unsigned argc, Value* vp) {
+  CallArgs args = CallArgsFromVp(argc, vp);
+
+  if (args.length() != 0) {
+    RootedObject callee(cx, &args.callee());
+    ReportUsageErrorASCII(cx, callee, "Too many arguments");
+    return false;
+  }
+
+  gc::HugePageStats stats;
+  gc::GetHugePageStats(&stats);
+
+  RootedObject result(cx, JS_NewPlainObject(cx));
+  if (!result) {
+    return false;
+  }
+
+  RootedValue val(cx, BooleanValue(stats.enabled));
+  if (!JS_DefineProperty(cx, result, "enabled", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+
+  struct {
+    const char* name;
+    size_t value;
+  } counters[] = {
+      {"regionsMapped", stats.regionsMapped},
+      {"regionsUnmapped", stats.regionsUnmapped},
+      {"chunksMapped", stats.chunksMapped},
+      {"chunksSpare", stats.chunksSpare},
+      {"adviseFailures", stats.adviseFailures},
+      {"anonHugePageBytes", gc::GetAnonHugePageBytes()},
+  };
+  for (const auto& counter : counters) {
+    val = NumberValue(double(counter.value));
+    if (!JS_DefineProperty(cx, result, counter.name, val, JSPROP_ENUMERATE)) {
+      return false;
+    }
+  }
+
+  args.rval().setObject(*result);
+  return true;
+}
+
 static bool ScheduleZoneForGC(JSContext* cx, unsigned argc, Value* vp) {
   CallArgs args = CallArgsFromVp(argc, vp);
 
@@ -4030,6 +4114,36 @@ static bool DumpHeap(JSContext* cx, unsigned argc, Value* vp) {
   return true;
 }
 
+static bool DumpTaintTrace(JSContext* cx, unsigned argc, Value* vp) {
+  CallArgs args = CallArgsFromVp(argc, vp);
+
+  if (args.length() != 1) {
+    RootedObject callee(cx, &args.callee());
+    ReportUsageErrorASCII(cx, callee, "Wrong number of arguments");
+    return false;
+  }
+
+  RootedString str(cx, ToString(cx, args[0]));
+  if (!str) {
+    return false;
+  }
+
+  if (!fuzzingSafe) {
+    UniqueChars fileNameBytes = JS_EncodeStringToLatin1(cx, str);
+    if (!fileNameBytes) {
+      return false;
+    }
+    if (!TaintTraceDump(fileNameBytes.get())) {
+      JS_ReportErrorLatin1(cx, "can't write taint trace to %s",
+                           fileNameBytes.get());
+      return false;
+    }
+  }
+
+  args.rval().setUndefined();
+  return true;
+}
+
 static bool Terminate(JSContext* cx, unsigned arg, Value* vp) {
   // Print a message to stderr in differential testing to help jsfunfuzz
   // find uncatchable-exception bugs.
@@ -7780,6 +7894,43 @@ static bool BaselineCompile(JSContext* cx, unsigned argc, Value* vp) {
   return true;
 }
 
+static bool BaselineOffThreadStats(JSContext* cx, unsigned argc, Value* vp) {
+  CallArgs args = CallArgsFromVp(argc, vp);
+
+  jit::BaselineOffThreadStats stats;
+  if (jit::JitRuntime* jrt = cx->runtime()->jitRuntime()) {
+    stats = jrt->baselineOffThreadStats();
+  }
+
+  RootedObject result(cx, JS_NewPlainObject(cx));
+  if (!result) {
+    return false;
+  }
+  RootedValue val(cx, NumberValue(double(stats.scripts)));
+  if (!JS_DefineProperty(cx, result, "scripts", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  val = NumberValue(double(stats.batches));
+  if (!JS_DefineProperty(cx, result, "batches", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  val = NumberValue(double(stats.discarded));
+  if (!JS_DefineProperty(cx, result, "discarded", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  val = NumberValue(stats.compileTime.ToMilliseconds());
+  if (!JS_DefineProperty(cx, result, "compileTimeMs", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+  val = NumberValue(stats.linkTime.ToMilliseconds());
+  if (!JS_DefineProperty(cx, result, "linkTimeMs", val, JSPROP_ENUMERATE)) {
+    return false;
+  }
+
+  args.rval().setObject(*result);
+  return true;
+}
+
 static bool ClearKeptObjects(JSContext* cx, unsigned argc, Value* vp) {
   CallArgs args = CallArgsFromVp(argc, vp);
   JS::ClearKeptObjects(cx);
@@ -8403,6 +8554,14 @@ gc::ZealModeHelpText),
 "gcstate([obj])",
 "  Report the global GC state, or the GC state for the zone containing |obj|."),
 
+    JS_FN_HELP("gcHugePageStats", GCHugePageStats, 0, 0,
+"gcHugePageStats()",
+"  Return an object describing the transparent huge page backing of GC chunks\n"
+"  (enabled with JS_GC_HUGE_PAGES=1): whether it is enabled, the number of\n"
+"  regions mapped and unmapped, the number of chunks mapped and kept spare,\n"
+"  the number of failed madvise calls and the number of bytes the kernel\n"
+"  backs with huge pages in this process."),
+
     JS_FN_HELP("schedulezone", ScheduleZoneForGC, 1, 0,
 "schedulezone([obj | string])",
 "  If obj is given, schedule a GC of obj's zone.\n"
@@ -8454,6 +8613,10 @@ gc::ZealModeHelpText),
 "  in the nursery are ignored, so if you wish to include them, consider calling\n"
 "  minorgc() first."),
 
+    JS_FN_HELP("dumpTaintTrace", DumpTaintTrace, 1, 0,
+"dumpTaintTrace(filename)",
+"  Write the taint event ring buffers of all threads to the named file."),
+
     JS_FN_HELP("terminate", Terminate, 0, 0,
 "terminate()",
 "  Terminate JavaScript execution, as if we had run out of\n"
@@ -8650,6 +8813,12 @@ JS_FOR_WASM_FEATURES(WASM_FEATURE, WASM_FEATURE, WASM_FEATURE)
 "  Returns a boolean indicating whether a given module was deserialized directly from a\n"
 "  cache (as opposed to compiled from bytecode)."),
 
+    JS_FN_HELP("wasmLazyFunctionStats", WasmLazyFunctionStats, 1, 0,
+"wasmLazyFunctionStats(module)",
+"  Returns {functions, compiled}, the number of function definitions in a module\n"
+"  compiled with the wasm.lazy-compile JIT option and how many of them have been\n"
+"  compiled so far, or null if the module's functions were compiled eagerly."),
+
     JS_FN_HELP("wasmIntrinsicI8VecMul", WasmIntrinsicI8VecMul, 0, 0,
 "wasmIntrinsicI8VecMul()",
 "  Returns a module that implements an i8 vector pairwise multiplication intrinsic."),
@@ -9018,6 +9187,14 @@ JS_FOR_WASM_FEATURES(WASM_FEATURE, WASM_FEATURE, WASM_FEATURE)
 "  The interpreter will enter the new jitcode at the loop header unless\n"
 "  baselineCompile returned a string or threw an error.\n"),
 
+    JS_FN_HELP("baselineOffThreadStats", BaselineOffThreadStats, 0, 0,
+"baselineOffThreadStats()",
+"  Returns {scripts, batches, discarded, compileTimeMs, linkTimeMs} for the\n"
+"  scripts compiled by the baseline compiler on helper threads: how many were\n"
+"  linked, in how many batches, how many were thrown away because the script\n"
+"  changed in the meantime, the compile time taken off the main thread and the\n"
+"  time spent linking on the main thread."),
+
     JS_FN_HELP("encodeAsUtf8InBuffer", EncodeAsUtf8InBuffer, 2, 0,
 "encodeAsUtf8InBuffer(str, uint8Array)",
 "  Encode as many whole code points from the string str into the provided\n"
@@ -185,15 +185,15 @@ void js::DateTimeFormatObject::finalize(JS::GCContext* gcx, JSObject* obj) {
   MOZ_ASSERT(gcx->onMainThread());
 
   auto* dateTimeFormat = &obj->as<DateTimeFormatObject>();
-  mozilla::intl::DateTimeFormat* df = dateTimeFormat->getDateFormat();
+  intl::SharedDateTimeFormat* df = dateTimeFormat->getDateFormat();
   mozilla::intl::DateIntervalFormat* dif =
       dateTimeFormat->getDateIntervalFormat();
 
   if (df) {
     intl::RemoveICUCellMemory(
         gcx, obj, DateTimeFormatObject::UDateFormatEstimatedMemoryUse);
-
-    delete df;
+    df->removeUser();
+    df->Release();
   }
 
   if (dif) {
@@ -799,10 +799,12 @@ static bool AssignDateTimeLength(
 }
 
 /**
- * Returns a new mozilla::intl::DateTimeFormat with the locale and date-time
- * formatting options of the given DateTimeFormat.
+ * Returns a mozilla::intl::DateTimeFormat with the locale and date-time
+ * formatting options of the given DateTimeFormat. The formatter is shared with
+ * all other DateTimeFormat objects of the runtime with the same locale and
+ * options.
  */
-static mozilla::intl::DateTimeFormat* NewDateTimeFormat(
+static already_AddRefed<intl::SharedDateTimeFormat> GetSharedDateTimeFormat(
     JSContext* cx, Handle<DateTimeFormatObject*> dateTimeFormat) {
   RootedValue value(cx);
 
@@ -843,7 +845,17 @@ static mozilla::intl::DateTimeFormat* NewDateTimeFormat(
     hasStyle = value.isString();
   }
 
-  mozilla::UniquePtr<mozilla::intl::DateTimeFormat> df = nullptr;
+  // Collect the options first, so the cache can be queried before creating a
+  // new formatter.
+  intl::FormatterCacheKey key;
+  key.add(locale.get());
+  key.add(mozilla::Span(timeZone.twoByteChars(), timeZone.length()));
+  key.add(hasPattern);
+  key.add(hasStyle);
+
+  AutoStableStringChars pattern(cx);
+  mozilla::intl::DateTimeFormat::StyleBag style;
+  mozilla::intl::DateTimeFormat::ComponentsBag bag;
   if (hasPattern) {
     // This is a DateTimeFormat defined by a pattern option. This is internal
     // to Mozilla, and not part of the ECMA-402 API.
@@ -851,23 +863,13 @@ static mozilla::intl::DateTimeFormat* NewDateTimeFormat(
       return nullptr;
     }
 
-    AutoStableStringChars pattern(cx);
     if (!pattern.initTwoByte(cx, value.toString())) {
       return nullptr;
     }
 
-    auto dfResult = mozilla::intl::DateTimeFormat::TryCreateFromPattern(
-        mozilla::MakeStringSpan(locale.get()), pattern.twoByteRange(),
-        mozilla::Some(timeZoneChars));
-    if (dfResult.isErr()) {
-      intl::ReportInternalError(cx, dfResult.unwrapErr());
-      return nullptr;
-    }
-
-    df = dfResult.unwrap();
+    key.add(mozilla::Span(pattern.twoByteChars(), pattern.length()));
   } else if (hasStyle) {
     // This is a DateTimeFormat defined by a time style or date style.
-    mozilla::intl::DateTimeFormat::StyleBag style;
     if (!AssignDateTimeLength(cx, internals, cx->names().timeStyle,
                               &style.time)) {
       return nullptr;
@@ -885,25 +887,12 @@ static mozilla::intl::DateTimeFormat* NewDateTimeFormat(
       return nullptr;
     }
 
-    SharedIntlData& sharedIntlData = cx->runtime()->sharedIntlData.ref();
-
-    mozilla::intl::DateTimePatternGenerator* gen =
-        sharedIntlData.getDateTimePatternGenerator(cx, locale.get());
-    if (!gen) {
-      return nullptr;
-    }
-    auto dfResult = mozilla::intl::DateTimeFormat::TryCreateFromStyle(
-        mozilla::MakeStringSpan(locale.get()), style, gen,
-        mozilla::Some(timeZoneChars));
-    if (dfResult.isErr()) {
-      intl::ReportInternalError(cx, dfResult.unwrapErr());
-      return nullptr;
-    }
-    df = dfResult.unwrap();
+    key.add(style.date);
+    key.add(style.time);
+    key.add(style.hourCycle);
+    key.add(style.hour12);
   } else {
     // This is a DateTimeFormat defined by a components bag.
-    mozilla::intl::DateTimeFormat::ComponentsBag bag;
-
     if (!AssignTextComponent(cx, internals, cx->names().era, &bag.era)) {
       return nullptr;
     }
@@ -957,7 +946,58 @@ static mozilla::intl::DateTimeFormat* NewDateTimeFormat(
       MOZ_ASSERT(value.isUndefined());
     }
 
-    SharedIntlData& sharedIntlData = cx->runtime()->sharedIntlData.ref();
+    key.add(bag.era);
+    key.add(bag.year);
+    key.add(bag.month);
+    key.add(bag.day);
+    key.add(bag.weekday);
+    key.add(bag.hour);
+    key.add(bag.minute);
+    key.add(bag.second);
+    key.add(bag.timeZoneName);
+    key.add(bag.hour12);
+    key.add(bag.hourCycle);
+    key.add(bag.dayPeriod);
+    key.add(bag.fractionalSecondDigits);
+  }
+
+  if (!key.ok()) {
+    ReportOutOfMemory(cx);
+    return nullptr;
+  }
+
+  SharedIntlData& sharedIntlData = cx->runtime()->sharedIntlData.ref();
+  auto& cache = sharedIntlData.dateTimeFormatCache();
+  if (intl::SharedDateTimeFormat* shared = cache.lookup(key)) {
+    return do_AddRef(shared);
+  }
+
+  mozilla::UniquePtr<mozilla::intl::DateTimeFormat> df = nullptr;
+  if (hasPattern) {
+    auto dfResult = mozilla::intl::DateTimeFormat::TryCreateFromPattern(
+        mozilla::MakeStringSpan(locale.get()), pattern.twoByteRange(),
+        mozilla::Some(timeZoneChars));
+    if (dfResult.isErr()) {
+      intl::ReportInternalError(cx, dfResult.unwrapErr());
+      return nullptr;
+    }
+
+    df = dfResult.unwrap();
+  } else if (hasStyle) {
+    mozilla::intl::DateTimePatternGenerator* gen =
+        sharedIntlData.getDateTimePatternGenerator(cx, locale.get());
+    if (!gen) {
+      return nullptr;
+    }
+    auto dfResult = mozilla::intl::DateTimeFormat::TryCreateFromStyle(
+        mozilla::MakeStringSpan(locale.get()), style, gen,
+        mozilla::Some(timeZoneChars));
+    if (dfResult.isErr()) {
+      intl::ReportInternalError(cx, dfResult.unwrapErr());
+      return nullptr;
+    }
+    df = dfResult.unwrap();
+  } else {
     auto* dtpg = sharedIntlData.getDateTimePatternGenerator(cx, locale.get());
     if (!dtpg) {
       return nullptr;
@@ -977,22 +1017,34 @@ static mozilla::intl::DateTimeFormat* NewDateTimeFormat(
   // of ECMAScript time.
   df->SetStartTimeIfGregorian(StartOfTime);
 
-  return df.release();
+  mozilla::intl::DateTimeFormat* raw = df.release();
+  RefPtr<intl::SharedDateTimeFormat> shared =
+      cx->new_<intl::SharedDateTimeFormat>(raw);
+  if (!shared) {
+    delete raw;
+    return nullptr;
+  }
+
+  cache.add(std::move(key), shared);
+  return shared.forget();
 }
 
 static mozilla::intl::DateTimeFormat* GetOrCreateDateTimeFormat(
     JSContext* cx, Handle<DateTimeFormatObject*> dateTimeFormat) {
   // Obtain a cached mozilla::intl::DateTimeFormat object.
-  mozilla::intl::DateTimeFormat* df = dateTimeFormat->getDateFormat();
-  if (df) {
-    return df;
+  if (intl::SharedDateTimeFormat* shared = dateTimeFormat->getDateFormat()) {
+    return shared->get();
   }
 
-  df = NewDateTimeFormat(cx, dateTimeFormat);
-  if (!df) {
+  RefPtr<intl::SharedDateTimeFormat> shared =
+      GetSharedDateTimeFormat(cx, dateTimeFormat);
+  if (!shared) {
     return nullptr;
   }
-  dateTimeFormat->setDateFormat(df);
+
+  mozilla::intl::DateTimeFormat* df = shared->get();
+  shared->addUser();
+  dateTimeFormat->setDateFormat(shared.forget().take());
 
   intl::AddICUCellMemory(dateTimeFormat,
                          DateTimeFormatObject::UDateFormatEstimatedMemoryUse);
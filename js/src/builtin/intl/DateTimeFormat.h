@@ -18,6 +18,11 @@ class DateIntervalFormat;
 
 namespace js {
 
+namespace intl {
+template <class Formatter>
+class SharedFormatter;
+}  // namespace intl
+
 class DateTimeFormatObject : public NativeObject {
  public:
   static const JSClass class_;
@@ -38,15 +43,20 @@ class DateTimeFormatObject : public NativeObject {
   // Estimated memory use for UDateIntervalFormat (see IcuMemoryUsage).
   static constexpr size_t UDateIntervalFormatEstimatedMemoryUse = 133064;
 
-  mozilla::intl::DateTimeFormat* getDateFormat() const {
+  // The date format is shared with all DateTimeFormat objects which use the
+  // same locale and options, see SharedIntlData::dateTimeFormatCache. This
+  // object owns a reference to it.
+  intl::SharedFormatter<mozilla::intl::DateTimeFormat>* getDateFormat() const {
     const auto& slot = getFixedSlot(DATE_FORMAT_SLOT);
     if (slot.isUndefined()) {
       return nullptr;
     }
-    return static_cast<mozilla::intl::DateTimeFormat*>(slot.toPrivate());
+    return static_cast<intl::SharedFormatter<mozilla::intl::DateTimeFormat>*>(
+        slot.toPrivate());
   }
 
-  void setDateFormat(mozilla::intl::DateTimeFormat* dateFormat) {
+  void setDateFormat(
+      intl::SharedFormatter<mozilla::intl::DateTimeFormat>* dateFormat) {
     setFixedSlot(DATE_FORMAT_SLOT, PrivateValue(dateFormat));
   }
 
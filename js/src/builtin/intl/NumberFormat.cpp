@@ -34,6 +34,7 @@
 #include "builtin/intl/FormatBuffer.h"
 #include "builtin/intl/LanguageTag.h"
 #include "builtin/intl/RelativeTimeFormat.h"
+#include "builtin/intl/SharedIntlData.h"
 #include "gc/GCContext.h"
 #include "js/CharacterEncoding.h"
 #include "js/PropertySpec.h"
@@ -176,15 +177,14 @@ void js::NumberFormatObject::finalize(JS::GCContext* gcx, JSObject* obj) {
   MOZ_ASSERT(gcx->onMainThread());
 
   auto* numberFormat = &obj->as<NumberFormatObject>();
-  mozilla::intl::NumberFormat* nf = numberFormat->getNumberFormatter();
+  intl::SharedNumberFormat* nf = numberFormat->getNumberFormatter();
   mozilla::intl::NumberRangeFormat* nrf =
       numberFormat->getNumberRangeFormatter();
 
   if (nf) {
     intl::RemoveICUCellMemory(gcx, obj, NumberFormatObject::EstimatedMemoryUse);
-    // This was allocated using `new` in mozilla::intl::NumberFormat, so we
-    // delete here.
-    delete nf;
+    nf->removeUser();
+    nf->Release();
   }
 
   if (nrf) {
@@ -735,13 +735,12 @@ static bool FillNumberFormatOptions(JSContext* cx, HandleObject internals,
 }
 
 /**
- * Returns a new mozilla::intl::Number[Range]Format with the locale and number
- * formatting options of the given NumberFormat, or a nullptr if
- * initialization failed.
+ * Returns the locale and fills in the number formatting options of the given
+ * NumberFormat, or returns a nullptr on failure.
  */
-template <class Formatter>
-static Formatter* NewNumberFormat(JSContext* cx,
-                                  Handle<NumberFormatObject*> numberFormat) {
+static UniqueChars ResolveNumberFormat(JSContext* cx,
+                                       Handle<NumberFormatObject*> numberFormat,
+                                       NumberFormatOptions& options) {
   RootedObject internals(cx, intl::GetInternalsObject(cx, numberFormat));
   if (!internals) {
     return nullptr;
@@ -752,7 +751,6 @@ static Formatter* NewNumberFormat(JSContext* cx,
     return nullptr;
   }
 
-  NumberFormatOptions options;
   if (!FillNumberFormatOptions(cx, internals, options)) {
     return nullptr;
   }
@@ -761,8 +759,18 @@ static Formatter* NewNumberFormat(JSContext* cx,
   options.mRangeIdentityFallback =
       NumberFormatOptions::RangeIdentityFallback::Approximately;
 
+  return locale;
+}
+
+/**
+ * Returns a new mozilla::intl::Number[Range]Format with the given locale and
+ * number formatting options, or a nullptr if initialization failed.
+ */
+template <class Formatter>
+static Formatter* NewNumberFormat(JSContext* cx, const char* locale,
+                                  const NumberFormatOptions& options) {
   mozilla::Result<mozilla::UniquePtr<Formatter>, mozilla::intl::ICUError>
-      result = Formatter::TryCreate(locale.get(), options);
+      result = Formatter::TryCreate(locale, options);
 
   if (result.isOk()) {
     return result.unwrap().release();
@@ -772,19 +780,71 @@ static Formatter* NewNumberFormat(JSContext* cx,
   return nullptr;
 }
 
+/**
+ * Appends the locale and all options which affect a mozilla::intl::NumberFormat
+ * to the given formatter cache key.
+ */
+static void AppendNumberFormatCacheKey(
+    intl::FormatterCacheKey& key, const char* locale,
+    const mozilla::intl::NumberFormatOptions& options) {
+  key.add(locale);
+  key.add(options.mCurrency);
+  key.add(options.mFractionDigits);
+  key.add(options.mMinIntegerDigits);
+  key.add(options.mSignificantDigits);
+  key.add(options.mUnit);
+  key.add(options.mPercent);
+  key.add(options.mStripTrailingZero);
+  key.add(options.mGrouping);
+  key.add(options.mNotation);
+  key.add(options.mSignDisplay);
+  key.add(options.mRoundingIncrement);
+  key.add(options.mRoundingMode);
+  key.add(options.mRoundingPriority);
+}
+
 static mozilla::intl::NumberFormat* GetOrCreateNumberFormat(
     JSContext* cx, Handle<NumberFormatObject*> numberFormat) {
   // Obtain a cached mozilla::intl::NumberFormat object.
-  mozilla::intl::NumberFormat* nf = numberFormat->getNumberFormatter();
-  if (nf) {
-    return nf;
+  if (intl::SharedNumberFormat* shared = numberFormat->getNumberFormatter()) {
+    return shared->get();
   }
 
-  nf = NewNumberFormat<mozilla::intl::NumberFormat>(cx, numberFormat);
-  if (!nf) {
+  NumberFormatOptions options;
+  UniqueChars locale = ResolveNumberFormat(cx, numberFormat, options);
+  if (!locale) {
     return nullptr;
   }
-  numberFormat->setNumberFormatter(nf);
+
+  // Reuse the formatter of any other NumberFormat in this runtime with the
+  // same locale and options.
+  intl::FormatterCacheKey key;
+  AppendNumberFormatCacheKey(key, locale.get(), options);
+  if (!key.ok()) {
+    ReportOutOfMemory(cx);
+    return nullptr;
+  }
+
+  auto& cache = cx->runtime()->sharedIntlData.ref().numberFormatCache();
+  RefPtr<intl::SharedNumberFormat> shared = cache.lookup(key);
+  if (!shared) {
+    auto* nf = NewNumberFormat<mozilla::intl::NumberFormat>(cx, locale.get(),
+                                                            options);
+    if (!nf) {
+      return nullptr;
+    }
+
+    shared = cx->new_<intl::SharedNumberFormat>(nf);
+    if (!shared) {
+      delete nf;
+      return nullptr;
+    }
+    cache.add(std::move(key), shared);
+  }
+
+  mozilla::intl::NumberFormat* nf = shared->get();
+  shared->addUser();
+  numberFormat->setNumberFormatter(shared.forget().take());
 
   intl::AddICUCellMemory(numberFormat, NumberFormatObject::EstimatedMemoryUse);
   return nf;
@@ -799,7 +859,14 @@ static mozilla::intl::NumberRangeFormat* GetOrCreateNumberRangeFormat(
     return nrf;
   }
 
-  nrf = NewNumberFormat<mozilla::intl::NumberRangeFormat>(cx, numberFormat);
+  NumberFormatOptions options;
+  UniqueChars locale = ResolveNumberFormat(cx, numberFormat, options);
+  if (!locale) {
+    return nullptr;
+  }
+
+  nrf = NewNumberFormat<mozilla::intl::NumberRangeFormat>(cx, locale.get(),
+                                                          options);
   if (!nrf) {
     return nullptr;
   }
@@ -20,6 +20,11 @@ class NumberRangeFormat;
 
 namespace js {
 
+namespace intl {
+template <class Formatter>
+class SharedFormatter;
+}  // namespace intl
+
 class NumberFormatObject : public NativeObject {
  public:
   static const JSClass class_;
@@ -42,15 +47,21 @@ class NumberFormatObject : public NativeObject {
   // (see IcuMemoryUsage).
   static constexpr size_t EstimatedRangeFormatterMemoryUse = 14143;
 
-  mozilla::intl::NumberFormat* getNumberFormatter() const {
+  // The number formatter is shared with all NumberFormat objects which use
+  // the same locale and options, see SharedIntlData::numberFormatCache. This
+  // object owns a reference to it.
+  intl::SharedFormatter<mozilla::intl::NumberFormat>* getNumberFormatter()
+      const {
     const auto& slot = getFixedSlot(UNUMBER_FORMATTER_SLOT);
     if (slot.isUndefined()) {
       return nullptr;
     }
-    return static_cast<mozilla::intl::NumberFormat*>(slot.toPrivate());
+    return static_cast<intl::SharedFormatter<mozilla::intl::NumberFormat>*>(
+        slot.toPrivate());
   }
 
-  void setNumberFormatter(mozilla::intl::NumberFormat* formatter) {
+  void setNumberFormatter(
+      intl::SharedFormatter<mozilla::intl::NumberFormat>* formatter) {
     setFixedSlot(UNUMBER_FORMATTER_SLOT, PrivateValue(formatter));
   }
 
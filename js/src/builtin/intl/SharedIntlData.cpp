@@ -28,6 +28,8 @@
 
 #include "builtin/Array.h"
 #include "builtin/intl/CommonFunctions.h"
+#include "builtin/intl/DateTimeFormat.h"
+#include "builtin/intl/NumberFormat.h"
 #include "builtin/intl/TimeZoneDataGenerated.h"
 #include "js/Utility.h"
 #include "js/Vector.h"
@@ -714,7 +716,19 @@ js::intl::SharedIntlData::getDateTimePatternGenerator(JSContext* cx,
   return dateTimePatternGenerator.get();
 }
 
+void js::intl::SharedFormatterDeleter::operator()(
+    mozilla::intl::DateTimeFormat* ptr) {
+  delete ptr;
+}
+
+void js::intl::SharedFormatterDeleter::operator()(
+    mozilla::intl::NumberFormat* ptr) {
+  delete ptr;
+}
+
 void js::intl::SharedIntlData::destroyInstance() {
+  numberFormats.clear();
+  dateTimeFormats.clear();
   availableTimeZones.clearAndCompact();
   ianaZonesTreatedAsLinksByICU.clearAndCompact();
   ianaLinksCanonicalizedDifferentlyByICU.clearAndCompact();
@@ -750,5 +764,13 @@ size_t js::intl::SharedIntlData::sizeOfExcludingThis(
 #if DEBUG || MOZ_SYSTEM_ICU
          upperCaseFirstLocales.shallowSizeOfExcludingThis(mallocSizeOf) +
 #endif
-         mallocSizeOf(dateTimePatternGeneratorLocale.get());
+         mallocSizeOf(dateTimePatternGeneratorLocale.get()) +
+         numberFormats.sizeOfExcludingThis(mallocSizeOf) +
+         dateTimeFormats.sizeOfExcludingThis(mallocSizeOf) +
+         // ICU memory isn't visible to |mallocSizeOf|, so use the same
+         // estimates as the per-object ICU memory accounting. Formatters used
+         // by Intl objects are already charged to their cells.
+         numberFormats.unusedCount() * NumberFormatObject::EstimatedMemoryUse +
+         dateTimeFormats.unusedCount() *
+             DateTimeFormatObject::UDateFormatEstimatedMemoryUse;
 }
@@ -7,21 +7,34 @@
 #ifndef builtin_intl_SharedIntlData_h
 #define builtin_intl_SharedIntlData_h
 
+#include "mozilla/Maybe.h"
 #include "mozilla/MemoryReporting.h"
+#include "mozilla/RefPtr.h"
+#include "mozilla/Span.h"
 #include "mozilla/UniquePtr.h"
 
+#include <algorithm>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 #include "js/AllocPolicy.h"
 #include "js/GCAPI.h"
 #include "js/GCHashTable.h"
+#include "js/RefCounted.h"
 #include "js/Result.h"
 #include "js/RootingAPI.h"
 #include "js/Utility.h"
+#include "js/Vector.h"
 #include "vm/StringType.h"
 
 namespace mozilla::intl {
+class DateTimeFormat;
 class DateTimePatternGenerator;
+class NumberFormat;
 }  // namespace mozilla::intl
 
 namespace js {
@@ -39,6 +52,194 @@ class DateTimePatternGeneratorDeleter {
   void operator()(mozilla::intl::DateTimePatternGenerator* ptr);
 };
 
+/**
+ * This deleter class exists so that the formatters stored in a FormatterCache
+ * can be forward declarations, but still be used inside of a UniquePtr.
+ */
+class SharedFormatterDeleter {
+ public:
+  void operator()(mozilla::intl::DateTimeFormat* ptr);
+  void operator()(mozilla::intl::NumberFormat* ptr);
+};
+
+/**
+ * An ICU formatter which is shared by all Intl objects of a runtime which
+ * were created with the same locale and options.
+ *
+ * Formatters are only used through their const API, which is safe as long as
+ * all users run on the same thread.
+ *
+ * Each Intl object using the formatter charges its estimated ICU memory to
+ * its cell, as for unshared formatters. Formatters which are only kept alive
+ * by a FormatterCache are reported by SharedIntlData::sizeOfExcludingThis.
+ */
+template <class Formatter>
+class SharedFormatter : public js::RefCounted<SharedFormatter<Formatter>> {
+  mozilla::UniquePtr<Formatter, SharedFormatterDeleter> formatter_;
+
+  // Number of Intl objects using this formatter.
+  uint32_t users_ = 0;
+
+ public:
+  explicit SharedFormatter(Formatter* formatter) : formatter_(formatter) {}
+
+  Formatter* get() const { return formatter_.get(); }
+
+  void addUser() { users_++; }
+  void removeUser() {
+    MOZ_ASSERT(users_ > 0);
+    users_--;
+  }
+  bool hasUsers() const { return users_ > 0; }
+};
+
+using SharedNumberFormat = SharedFormatter<mozilla::intl::NumberFormat>;
+using SharedDateTimeFormat = SharedFormatter<mozilla::intl::DateTimeFormat>;
+
+/**
+ * Key of a FormatterCache entry: the resolved locale and all options which
+ * affect the created formatter, serialized in a fixed order.
+ */
+class FormatterCacheKey {
+  js::Vector<char, 128, SystemAllocPolicy> chars_;
+  bool ok_ = true;
+
+  void addBytes(const void* bytes, size_t length) {
+    ok_ = ok_ && chars_.append(static_cast<const char*>(bytes), length);
+  }
+
+ public:
+  FormatterCacheKey() = default;
+  FormatterCacheKey(FormatterCacheKey&&) = default;
+  FormatterCacheKey& operator=(FormatterCacheKey&&) = default;
+
+  void add(mozilla::Span<const char> chars) {
+    uint32_t length = chars.Length();
+    addBytes(&length, sizeof(length));
+    addBytes(chars.data(), chars.size_bytes());
+  }
+
+  void add(mozilla::Span<const char16_t> chars) {
+    uint32_t length = chars.Length();
+    addBytes(&length, sizeof(length));
+    addBytes(chars.data(), chars.size_bytes());
+  }
+
+  void add(const char* chars) { add(mozilla::MakeStringSpan(chars)); }
+
+  void add(std::string_view chars) {
+    add(mozilla::Span<const char>(chars.data(), chars.length()));
+  }
+
+  template <typename T>
+  void add(const T& value) {
+    static_assert(std::is_integral_v<T> || std::is_enum_v<T>);
+    addBytes(&value, sizeof(value));
+  }
+
+  template <typename T>
+  void add(const mozilla::Maybe<T>& value) {
+    add(value.isSome());
+    if (value) {
+      add(*value);
+    }
+  }
+
+  template <typename T, typename U>
+  void add(const std::pair<T, U>& value) {
+    add(value.first);
+    add(value.second);
+  }
+
+  /**
+   * Returns false if building the key ran out of memory.
+   */
+  bool ok() const { return ok_; }
+
+  bool operator==(const FormatterCacheKey& other) const {
+    return chars_.length() == other.chars_.length() &&
+           memcmp(chars_.begin(), other.chars_.begin(), chars_.length()) == 0;
+  }
+
+  size_t sizeOfExcludingThis(mozilla::MallocSizeOf mallocSizeOf) const {
+    return chars_.sizeOfExcludingThis(mallocSizeOf);
+  }
+};
+
+/**
+ * A small, size-bounded cache of ready-to-use ICU formatters. Creating an ICU
+ * formatter is expensive compared to formatting a single value, so Intl
+ * objects with equal locale and options share a single formatter.
+ *
+ * The cache holds a reference to the |MaxEntries| most recently used
+ * formatters; Intl objects hold their own reference, so evicting a formatter
+ * never invalidates it for objects still using it.
+ */
+template <class Formatter, size_t MaxEntries>
+class FormatterCache {
+  struct Entry {
+    FormatterCacheKey key;
+    RefPtr<SharedFormatter<Formatter>> formatter;
+  };
+
+  // Least recently used entries first.
+  js::Vector<Entry, 0, SystemAllocPolicy> entries_;
+
+ public:
+  /**
+   * Returns the cached formatter for |key| or nullptr if there is none.
+   */
+  SharedFormatter<Formatter>* lookup(const FormatterCacheKey& key) {
+    MOZ_ASSERT(key.ok());
+    for (size_t i = entries_.length(); i > 0; i--) {
+      if (entries_[i - 1].key == key) {
+        std::rotate(entries_.begin() + (i - 1), entries_.begin() + i,
+                    entries_.end());
+        return entries_.back().formatter;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Adds |formatter| to the cache, evicting the least recently used entry if
+   * the cache is full. The cache is only an optimization, so this silently
+   * does nothing on OOM.
+   */
+  void add(FormatterCacheKey&& key, SharedFormatter<Formatter>* formatter) {
+    MOZ_ASSERT(key.ok());
+    if (entries_.length() == MaxEntries) {
+      entries_.erase(entries_.begin());
+    }
+    (void)entries_.append(Entry{std::move(key), formatter});
+  }
+
+  size_t count() const { return entries_.length(); }
+
+  /**
+   * Returns the number of cached formatters which no Intl object uses.
+   */
+  size_t unusedCount() const {
+    size_t count = 0;
+    for (const Entry& entry : entries_) {
+      if (!entry.formatter->hasUsers()) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  void clear() { entries_.clearAndFree(); }
+
+  size_t sizeOfExcludingThis(mozilla::MallocSizeOf mallocSizeOf) const {
+    size_t size = entries_.sizeOfExcludingThis(mallocSizeOf);
+    for (const Entry& entry : entries_) {
+      size += entry.key.sizeOfExcludingThis(mallocSizeOf);
+    }
+    return size;
+  }
+};
+
 /**
  * Stores Intl data which can be shared across compartments (but not contexts).
  *
@@ -320,6 +521,19 @@ class SharedIntlData {
   mozilla::intl::DateTimePatternGenerator* getDateTimePatternGenerator(
       JSContext* cx, const char* locale);
 
+ private:
+  FormatterCache<mozilla::intl::NumberFormat, 16> numberFormats;
+  FormatterCache<mozilla::intl::DateTimeFormat, 4> dateTimeFormats;
+
+ public:
+  /**
+   * Runtime-wide caches of ICU formatters, keyed by resolved locale and
+   * options. Used by Intl.NumberFormat and Intl.DateTimeFormat, and thus also
+   * by Number.prototype.toLocaleString and Date.prototype.toLocale*String.
+   */
+  auto& numberFormatCache() { return numberFormats; }
+  auto& dateTimeFormatCache() { return dateTimeFormats; }
+
  public:
   void destroyInstance();
 
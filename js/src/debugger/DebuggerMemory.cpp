@@ -362,7 +362,8 @@ using JS::ubi::CountTypePtr;
 //
 // 2) We create a count node for the root of our CountType tree, and then walk
 //    the heap, counting each node we find, expanding our tree of counts as we
-//    go.
+//    go. For a parallel census, the walk only collects the nodes, which are
+//    then counted on helper threads.
 //
 // 3) We walk the tree of counts and produce JavaScript objects reporting the
 //    accumulated results.
@@ -411,7 +412,7 @@ bool DebuggerMemory::CallData::takeCensus() {
     traversal.wantNames = false;
 
     if (!traversal.addStart(JS::ubi::Node(&rootList)) ||
-        !traversal.traverse()) {
+        !traversal.traverse() || !handler.finish()) {
       ReportOutOfMemory(cx);
       return false;
     }
@@ -1479,9 +1479,12 @@ static bool BytecodeIsEffectful(JSScript* script, size_t offset) {
     case JSOp::Arguments:
     case JSOp::Rest:
     case JSOp::GetArg:
+    case JSOp::GetArgPair:
     case JSOp::SetArg:
     case JSOp::GetLocal:
+    case JSOp::GetLocalPair:
     case JSOp::SetLocal:
+    case JSOp::SetLocalPop:
     case JSOp::ThrowSetConst:
     case JSOp::CheckLexical:
     case JSOp::CheckAliasedLexical:
@@ -0,0 +1,41 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Times the warm-up of 2000 scripts which get warm at the same time, as on
+// page load. Run it with the Baseline compiler on the main thread and on
+// helper threads to compare the two:
+//
+//   js --baseline-offthread-compile=off baseline-offthread.js
+//   js --baseline-offthread-compile=on baseline-offthread.js
+//
+// With helper threads, it also reports the compile time which was taken off
+// the main thread, and the time spent linking the code on it.
+
+var scripts = [];
+for (var i = 0; i < 2000; i++) {
+  scripts.push(new Function("a", "b",
+                            "var s = '';" +
+                            "for (var j = 0; j < a; j++) s += String(b * j);" +
+                            "return s.length + " + i + ";"));
+}
+
+var before = baselineOffThreadStats();
+var sum = 0;
+var start = performance.now();
+for (var n = 0; n < 30; n++) {
+  for (var i = 0; i < scripts.length; i++) {
+    sum += scripts[i](4, n);
+  }
+}
+var elapsed = performance.now() - start;
+var after = baselineOffThreadStats();
+
+print("warm up: " + elapsed.toFixed(1) + " ms (checksum " + sum + ")");
+print("scripts compiled off thread: " + (after.scripts - before.scripts) +
+      " in " + (after.batches - before.batches) + " batches, " +
+      (after.discarded - before.discarded) + " discarded");
+print("main-thread compile time avoided: " +
+      (after.compileTimeMs - before.compileTimeMs).toFixed(1) + " ms");
+print("main-thread link time: " +
+      (after.linkTimeMs - before.linkTimeMs).toFixed(1) + " ms");
@@ -0,0 +1,69 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Times Debugger.Memory.takeCensus over a debuggee heap of around 400,000
+// objects, counted on the main thread and, with { parallel: true }, on helper
+// threads. Both censuses must report the same counts.
+
+var g = newGlobal({ newCompartment: true });
+g.eval(`
+  var retained = [];
+  for (var i = 0; i < 400; i++) {
+    var list = null;
+    for (var j = 0; j < 1000; j++) {
+      list = { next: list, value: 'v' + (i * 1000 + j),
+               fn: j % 10 ? null : function () { return j; },
+               array: j % 4 ? null : [i, j] };
+    }
+    retained.push(list);
+  }
+`);
+var dbg = new Debugger(g);
+
+// Tenure everything, so that both censuses see the same heap.
+gc();
+gc();
+
+var breakdowns = {
+  "default": undefined,
+  "coarseType": {
+    by: "coarseType",
+    objects: { by: "objectClass", then: { by: "count" },
+               other: { by: "count" } },
+    scripts: { by: "filename", then: { by: "count" },
+               noFilename: { by: "count" } },
+    strings: { by: "count", count: true, bytes: true },
+    other: { by: "internalType", then: { by: "count" } },
+    domNode: { by: "count" },
+  },
+  "objectClass/bucket": {
+    by: "objectClass",
+    then: { by: "bucket" },
+    other: { by: "bucket" },
+  },
+};
+
+var iterations = 5;
+
+function time(breakdown, parallel) {
+  var report;
+  var start = performance.now();
+  for (var i = 0; i < iterations; i++) {
+    report = dbg.memory.takeCensus({ breakdown, parallel });
+  }
+  return { ms: (performance.now() - start) / iterations,
+           json: JSON.stringify(report) };
+}
+
+for (var name in breakdowns) {
+  var serial = time(breakdowns[name], false);
+  var parallel = time(breakdowns[name], true);
+  if (serial.json !== parallel.json) {
+    throw new Error(name + ": parallel census differs from serial census");
+  }
+  print(name + " serial: " + serial.ms.toFixed(1) + " ms per census");
+  print(name + " parallel: " + parallel.ms.toFixed(1) + " ms per census");
+}
+
+dbg.removeAllDebuggees();
@@ -0,0 +1,42 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Times Date.parse of the common fixed date formats. "repeated" parses one
+// string over and over, which the realm's DateParseCache answers if it is at
+// most 48 characters long. "distinct" cycles through more strings than the
+// cache holds, so each one is parsed.
+// A format left to the general parser is timed for reference. Run it with a
+// shell built before and after a change to Date.parse to compare the two.
+
+var formats = {
+  "ISO 8601": s => `2024-03-05T12:34:${s}.789Z`,
+  "RFC 2822": s => `Tue, 05 Mar 2024 12:34:${s} GMT`,
+  "toString": s => `Tue Mar 05 2024 13:34:${s} GMT+0100 ` +
+                   `(Central European Standard Time)`,
+  "general": s => `March 5, 2024 12:34:${s} UTC`,
+};
+
+var iterations = 1000000;
+
+function time(strings) {
+  var sum = 0;
+  var start = performance.now();
+  for (var i = 0; i < iterations; i++) {
+    sum += Date.parse(strings[i % strings.length]);
+  }
+  var elapsed = performance.now() - start;
+  if (Number.isNaN(sum)) {
+    throw new Error("unparsable date in " + strings[0]);
+  }
+  return elapsed;
+}
+
+for (var name in formats) {
+  var distinct = [];
+  for (var s = 0; s < 60; s++) {
+    distinct.push(formats[name](String(s).padStart(2, "0")));
+  }
+  print(name + " repeated: " + time([distinct[0]]).toFixed(1) + " ms");
+  print(name + " distinct: " + time(distinct).toFixed(1) + " ms");
+}
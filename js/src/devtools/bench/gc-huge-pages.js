@@ -0,0 +1,38 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Times full GCs of a heap of around 50MB of small objects and strings. Run
+// it with and without JS_GC_HUGE_PAGES=1 in the environment to compare GC
+// chunks in transparent huge pages with regular ones:
+//
+//   js gc-huge-pages.js
+//   JS_GC_HUGE_PAGES=1 js gc-huge-pages.js
+
+var retained = [];
+for (var i = 0; i < 500; i++) {
+  var list = null;
+  for (var j = 0; j < 1000; j++) {
+    list = { next: list, value: "v" + j, index: i * 1000 + j };
+  }
+  retained.push(list);
+}
+
+// Warm up, and let the heap settle into tenured chunks.
+gc();
+gc();
+
+var iterations = 20;
+var start = performance.now();
+for (var i = 0; i < iterations; i++) {
+  gc();
+}
+var elapsed = performance.now() - start;
+
+var stats = gcHugePageStats();
+print("huge pages: " + (stats.enabled ? "on" : "off"));
+print("full GC: " + (elapsed / iterations).toFixed(2) + "ms");
+print("regions mapped: " + stats.regionsMapped +
+      ", chunks mapped: " + stats.chunksMapped +
+      ", advise failures: " + stats.adviseFailures);
+print("AnonHugePages: " + (stats.anonHugePageBytes / 1024) + "KB");
@@ -0,0 +1,46 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Times full parses of an 8MB script of minified modules, with license and
+// documentation comments, long string literals, templates and short
+// identifiers, as bundlers emit. Pass the path of a real bundle to parse it
+// instead:
+//
+//   js parse.js [bundle.js]
+//
+// Run it with a shell built before and after a change to the tokenizer to
+// compare the two.
+
+var source;
+if (scriptArgs.length) {
+  source = os.file.readFile(scriptArgs[0]);
+} else {
+  var modules = [];
+  var length = 0;
+  for (var i = 0; length < 8 * 1024 * 1024; i++) {
+    var module =
+      `/*! module ${i} | (c) Example Authors | MIT License */\n` +
+      `var m${i}=function(e,t){"use strict";` +
+      `/**\n * Formats a message for the console.\n * @param {string} e\n` +
+      ` */\n` +
+      `    var n="The quick brown fox jumps over the lazy dog, ${i} times",` +
+      `r='https://example.com/static/js/chunk.${i}.min.js';` +
+      `// end of declarations\n` +
+      `        return e?n+\`\${t}: failed to load \${r}\`:r.length+t}\n`;
+    modules.push(module);
+    length += module.length;
+  }
+  source = modules.join("");
+}
+
+var iterations = 5;
+var best = Infinity;
+for (var i = 0; i < iterations; i++) {
+  var start = performance.now();
+  parse(source);
+  best = Math.min(best, performance.now() - start);
+}
+
+print("parse: " + best.toFixed(1) + " ms, " +
+      (source.length / best / 1000).toFixed(1) + "M code units/s");
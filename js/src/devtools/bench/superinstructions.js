@@ -0,0 +1,45 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Times code which reads arguments and locals in the interpreters, where
+// superinstructions save a dispatch. Run it in the C++ interpreter and in the
+// Baseline Interpreter, with a shell built before and after a change to the
+// superinstructions:
+//
+//   js --no-blinterp --no-baseline --no-ion superinstructions.js
+//   js --blinterp-eager --no-baseline --no-ion superinstructions.js
+//
+// To see which op pairs it executes most, in the C++ interpreter:
+//
+//   js --op-pair-profile=20 superinstructions.js
+
+function dot(a, b, n) {
+  var s = 0, x = 0, y = 0;
+  for (var i = 0; i < n; i++) {
+    x = a[i];
+    y = b[i];
+    s = s + x * y;
+  }
+  return s;
+}
+
+function hypot(a, b) { return Math.sqrt(a * a + b * b); }
+
+function run(n) {
+  var a = [], b = [];
+  for (var i = 0; i < 100; i++) { a.push(i); b.push(100 - i); }
+  var t = 0;
+  for (var j = 0; j < n; j++) { t = t + dot(a, b, 100) + hypot(j, 3); }
+  return t;
+}
+
+var iterations = 5;
+var best = Infinity;
+var result;
+for (var i = 0; i < iterations; i++) {
+  var start = performance.now();
+  result = run(20000);
+  best = Math.min(best, performance.now() - start);
+}
+print("run(20000): " + best.toFixed(1) + " ms (result " + result + ")");
@@ -2448,8 +2448,105 @@ bool BytecodeEmitter::emitScript(ParseNode* body) {
   return intoScriptStencil(CompilationStencil::TopLevelIndex);
 }
 
+// Return the superinstruction fusing |first| and |second|, if there is one.
+static bool FuseOps(JSOp first, JSOp second, JSOp* fused) {
+  if (first == JSOp::GetArg && second == JSOp::GetArg) {
+    *fused = JSOp::GetArgPair;
+    return true;
+  }
+  if (first == JSOp::GetLocal && second == JSOp::GetLocal) {
+    *fused = JSOp::GetLocalPair;
+    return true;
+  }
+  if (first == JSOp::SetLocal && second == JSOp::Pop) {
+    *fused = JSOp::SetLocalPop;
+    return true;
+  }
+  return false;
+}
+
+// Fuse the pairs of instructions which have a superinstruction, see
+// "Superinstructions" in Opcodes.h. The superinstruction replaces the opcode
+// of the first instruction, so this only has to check that no note or resume
+// offset points at the second one.
+bool BytecodeEmitter::fuseSuperinstructions() {
+  BytecodeVector& code = bytecodeSection().code();
+
+  // Offsets of the first instruction of the pairs which can be fused. Most
+  // scripts have none, so look for them before collecting the offsets which
+  // prevent fusing.
+  Vector<uint32_t, 0> candidates(fc);
+  for (size_t offset = 0; offset < code.length();) {
+    size_t next = offset + GetBytecodeLength(&code[offset]);
+    JSOp fused;
+    if (next < code.length() &&
+        FuseOps(JSOp(code[offset]), JSOp(code[next]), &fused)) {
+      if (!candidates.append(offset)) {
+        return false;
+      }
+      next += GetBytecodeLength(&code[next]);
+    }
+    offset = next;
+  }
+  if (candidates.empty()) {
+    return true;
+  }
+
+  Vector<uint32_t, 0> targets(fc);
+  if (!targets.append(mainOffset())) {
+    return false;
+  }
+  const SrcNotesVector& notes = bytecodeSection().notes();
+  uint32_t noteOffset = 0;
+  for (SrcNoteIterator iter(notes.begin());
+       *iter != notes.end() && !iter.atEnd(); ++iter) {
+    noteOffset += (*iter)->delta();
+    if (!targets.append(noteOffset)) {
+      return false;
+    }
+  }
+  for (uint32_t offset : bytecodeSection().resumeOffsetList().span()) {
+    if (!targets.append(offset)) {
+      return false;
+    }
+  }
+  for (const ScopeNote& note : bytecodeSection().scopeNoteList().span()) {
+    if (!targets.append(note.start) ||
+        !targets.append(note.start + note.length)) {
+      return false;
+    }
+  }
+  for (const TryNote& note : bytecodeSection().tryNoteList().span()) {
+    if (!targets.append(note.start) ||
+        !targets.append(note.start + note.length)) {
+      return false;
+    }
+  }
+  std::sort(targets.begin(), targets.end());
+
+  for (uint32_t offset : candidates) {
+    JSOp first = JSOp(code[offset]);
+    uint32_t second = offset + GetOpLength(first);
+    if (std::binary_search(targets.begin(), targets.end(), second)) {
+      continue;
+    }
+
+    JSOp fused;
+    MOZ_ALWAYS_TRUE(FuseOps(first, JSOp(code[second]), &fused));
+    MOZ_ASSERT(GetOpLength(fused) ==
+               GetOpLength(first) + GetBytecodeLength(&code[second]));
+    code[offset] = jsbytecode(fused);
+  }
+
+  return true;
+}
+
 js::UniquePtr<ImmutableScriptData>
 BytecodeEmitter::createImmutableScriptData() {
+  if (!fuseSuperinstructions()) {
+    return nullptr;
+  }
+
   uint32_t nslots;
   if (!getNslots(&nslots)) {
     return nullptr;
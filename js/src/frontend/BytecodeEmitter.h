@@ -1050,6 +1050,8 @@ struct MOZ_STACK_CLASS BytecodeEmitter {
   [[nodiscard]] js::UniquePtr<ImmutableScriptData> createImmutableScriptData();
 
  private:
+  [[nodiscard]] bool fuseSuperinstructions();
+
   [[nodiscard]] SelfHostedIter getSelfHostedIterFor(ParseNode* parseNode);
 
   [[nodiscard]] bool emitSelfHostedGetBuiltinConstructorOrPrototype(
@@ -2123,6 +2123,22 @@ MOZ_COLD bool GeneralTokenStreamChars<Unit, AnyCharsAccess>::badToken() {
   return false;
 };
 
+template <typename Unit>
+static bool AppendAsciiUnitsToCharBuffer(CharBuffer& charBuffer,
+                                         const Unit* units, size_t length) {
+  size_t start = charBuffer.length();
+  if (!charBuffer.growByUninitialized(length)) {
+    return false;
+  }
+
+  char16_t* dest = charBuffer.begin() + start;
+  for (size_t i = 0; i < length; i++) {
+    MOZ_ASSERT(CodeUnitValue(units[i]) < 0x80);
+    dest[i] = CodeUnitValue(units[i]);
+  }
+  return true;
+}
+
 bool AppendCodePointToCharBuffer(CharBuffer& charBuffer, char32_t codePoint) {
   MOZ_ASSERT(codePoint <= unicode::NonBMPMax,
              "should only be processing code points validly decoded from UTF-8 "
@@ -2211,6 +2227,8 @@ template <typename Unit, class AnyCharsAccess>
   // code points in the loop below.
   int32_t unit;
   while (true) {
+    this->sourceUnits.skipAsciiIdentifierParts();
+
     unit = peekCodeUnit();
     if (unit == EOF) {
       break;
@@ -2370,9 +2388,16 @@ static const uint8_t firstCharKinds[] = {
 static_assert(LastCharKind < (1 << (sizeof(firstCharKinds[0]) * 8)),
               "Elements of firstCharKinds[] are too small");
 
+static constexpr char AsciiLineTerminators[] = {'\n', '\r'};
+
 template <>
 void SourceUnits<char16_t>::consumeRestOfSingleLineComment() {
   while (MOZ_LIKELY(!atEnd())) {
+    ptr = findNonAsciiOrAnyOf(AsciiLineTerminators);
+    if (atEnd()) {
+      return;
+    }
+
     char16_t unit = peekCodeUnit();
     if (IsLineTerminator(unit)) {
       return;
@@ -2385,6 +2410,11 @@ void SourceUnits<char16_t>::consumeRestOfSingleLineComment() {
 template <>
 void SourceUnits<Utf8Unit>::consumeRestOfSingleLineComment() {
   while (MOZ_LIKELY(!atEnd())) {
+    ptr = findNonAsciiOrAnyOf(AsciiLineTerminators);
+    if (atEnd()) {
+      return;
+    }
+
     const Utf8Unit unit = peekCodeUnit();
     if (IsSingleUnitLineTerminator(unit)) {
       return;
@@ -2847,6 +2877,7 @@ template <typename Unit, class AnyCharsAccess>
     // Skip over non-EOL whitespace chars.
     //
     if (c1kind == Space) {
+      this->sourceUnits.skipAsciiBlanks();
       continue;
     }
 
@@ -3259,7 +3290,15 @@ template <typename Unit, class AnyCharsAccess>
           TokenStreamAnyChars& anyChars = anyCharsAccess();
           unsigned linenoBefore = anyChars.lineno;
 
+          // Only these ASCII code units need a closer look, the rest of the
+          // comment can be skipped in bulk.
+          static constexpr char stops[] = {'*', '@', '#', '\n', '\r'};
+
           do {
+            const Unit* next = this->sourceUnits.findNonAsciiOrAnyOf(stops);
+            this->sourceUnits.skipCodeUnits(mozilla::PointerRangeSize(
+                this->sourceUnits.addressOfNextCodeUnit(), next));
+
             int32_t unit = getCodeUnit();
             if (unit == EOF) {
               error(JSMSG_UNTERMINATED_COMMENT);
@@ -3380,9 +3419,26 @@ bool TokenStreamSpecific<Unit, AnyCharsAccess>::getStringOrTemplateToken(
 
   // We need to detect any of these chars:  " or ', \n (or its
   // equivalents), \\, EOF.  Because we detect EOL sequences here and
-  // put them back immediately, we can use getCodeUnit().
+  // put them back immediately, we can use getCodeUnit().  Runs of other
+  // ASCII code units are copied to charBuffer in bulk.
+  const char stops[] = {untilChar, '\\', '\n', '\r', '$'};
   int32_t unit;
-  while ((unit = getCodeUnit()) != untilChar) {
+  while (true) {
+    const Unit* run = this->sourceUnits.addressOfNextCodeUnit();
+    size_t runLength = mozilla::PointerRangeSize(
+        run, this->sourceUnits.findNonAsciiOrAnyOf(stops));
+    if (runLength > 0) {
+      if (!AppendAsciiUnitsToCharBuffer(this->charBuffer, run, runLength)) {
+        return false;
+      }
+      this->sourceUnits.skipCodeUnits(runLength);
+    }
+
+    unit = getCodeUnit();
+    if (unit == untilChar) {
+      break;
+    }
+
     if (unit == EOF) {
       ReportPrematureEndOfLiteral(JSMSG_EOF_BEFORE_END_OF_LITERAL);
       return false;
@@ -199,6 +199,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <type_traits>
 
 #include "jspubtd.h"
@@ -1034,6 +1035,62 @@ constexpr uint8_t CodeUnitValue(mozilla::Utf8Unit unit) {
   return unit.toUint8();
 }
 
+/**
+ * Word-at-a-time scanning of source text.  A uint64_t holds eight UTF-8 or
+ * four UTF-16 code units, and each of the tests below checks all of them at
+ * once, without branching per code unit.
+ */
+template <typename Unit>
+struct CodeUnitWord {
+  static constexpr size_t UnitsPerWord = sizeof(uint64_t) / sizeof(Unit);
+
+  // The lowest and the highest bit of every code unit.
+  static constexpr uint64_t LowBits =
+      sizeof(Unit) == 1 ? 0x0101'0101'0101'0101 : 0x0001'0001'0001'0001;
+  static constexpr uint64_t HighBits = LowBits << (8 * sizeof(Unit) - 1);
+
+  // The bits which are only set in code units which aren't ASCII.
+  static constexpr uint64_t NonAsciiBits =
+      LowBits * (sizeof(Unit) == 1 ? 0x80 : 0xFF80);
+
+  static uint64_t read(const Unit* units) {
+    uint64_t word;
+    memcpy(&word, units, sizeof(word));
+    return word;
+  }
+
+  static bool hasNonAscii(uint64_t word) { return word & NonAsciiBits; }
+
+  // Whether any code unit of |word| is |unit|.
+  static bool hasUnit(uint64_t word, char unit) {
+    uint64_t zeroed = word ^ (LowBits * uint8_t(unit));
+    return (zeroed - LowBits) & ~zeroed & HighBits;
+  }
+
+  // The highest bit of every code unit of |word| from |lo| to |hi|. Only
+  // exact if every code unit is ASCII: then neither sum carries nor
+  // difference borrows into the next code unit.
+  static uint64_t unitsInRange(uint64_t word, char lo, char hi) {
+    constexpr uint64_t Top = HighBits / LowBits;
+    uint64_t atLeastLo = word + LowBits * (Top - uint8_t(lo));
+    uint64_t atMostHi = LowBits * (Top + uint8_t(hi)) - word;
+    return atLeastLo & atMostHi & HighBits;
+  }
+
+  // Whether every code unit of |word| is an ASCII IdentifierPart, that is
+  // a letter, a digit, '$' or '_'.
+  static bool isAsciiIdentifierParts(uint64_t word) {
+    if (hasNonAscii(word)) {
+      return false;
+    }
+    uint64_t parts =
+        unitsInRange(word, 'a', 'z') | unitsInRange(word, 'A', 'Z') |
+        unitsInRange(word, '0', '9') | unitsInRange(word, '$', '$') |
+        unitsInRange(word, '_', '_');
+    return parts == HighBits;
+  }
+};
+
 template <typename Unit>
 class TokenStreamCharsBase;
 
@@ -1367,6 +1424,80 @@ class SourceUnits {
     ptr -= n;
   }
 
+  /**
+   * Return the address of the first code unit, starting at the next one,
+   * which isn't ASCII or is one of |stops|, or |limit()| if there is none.
+   * This is used to skip the uninteresting parts of comments and string
+   * literals, which make up much of large scripts, a word at a time.
+   */
+  template <size_t N>
+  const Unit* findNonAsciiOrAnyOf(const char (&stops)[N]) const {
+    MOZ_ASSERT(!isPoisoned(), "shouldn't scan poisoned SourceUnits");
+    using Word = CodeUnitWord<Unit>;
+
+    const Unit* p = ptr;
+    while (mozilla::PointerRangeSize(p, limit_) >= Word::UnitsPerWord) {
+      uint64_t word = Word::read(p);
+      bool found = Word::hasNonAscii(word);
+      for (char stop : stops) {
+        found |= Word::hasUnit(word, stop);
+      }
+      if (found) {
+        break;
+      }
+      p += Word::UnitsPerWord;
+    }
+
+    for (; p < limit_; p++) {
+      auto unit = CodeUnitValue(*p);
+      if (unit >= 0x80) {
+        return p;
+      }
+      for (char stop : stops) {
+        if (unit == stop) {
+          return p;
+        }
+      }
+    }
+    return p;
+  }
+
+  /** Skip spaces and tabs, e.g. indentation. */
+  void skipAsciiBlanks() {
+    MOZ_ASSERT(!isPoisoned(), "shouldn't use poisoned SourceUnits");
+    using Word = CodeUnitWord<Unit>;
+
+    while (remaining() >= Word::UnitsPerWord &&
+           Word::read(ptr) == Word::LowBits * ' ') {
+      ptr += Word::UnitsPerWord;
+    }
+    while (ptr < limit_ &&
+           (CodeUnitValue(*ptr) == ' ' || CodeUnitValue(*ptr) == '\t')) {
+      ptr++;
+    }
+  }
+
+  /**
+   * Skip ASCII code units which are IdentifierPart, a word at a time while
+   * every code unit of the word is one.
+   */
+  void skipAsciiIdentifierParts() {
+    MOZ_ASSERT(!isPoisoned(), "shouldn't use poisoned SourceUnits");
+    using Word = CodeUnitWord<Unit>;
+
+    while (remaining() >= Word::UnitsPerWord &&
+           Word::isAsciiIdentifierParts(Word::read(ptr))) {
+      ptr += Word::UnitsPerWord;
+    }
+    while (ptr < limit_) {
+      auto unit = CodeUnitValue(*ptr);
+      if (unit >= 0x80 || !unicode::IsIdentifierPart(char16_t(unit))) {
+        return;
+      }
+      ptr++;
+    }
+  }
+
  private:
   friend class TokenStreamCharsBase<Unit>;
 
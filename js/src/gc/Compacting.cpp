@@ -414,6 +414,7 @@ bool GCRuntime::relocateArenas(Zone* zone, JS::GCReason reason,
   MOZ_ASSERT(canRelocateZone(zone));
 
   js::CancelOffThreadIonCompile(rt, JS::Zone::Compact);
+  js::CancelOffThreadBaselineCompile(rt, JS::Zone::Compact);
 
   if (!zone->arenas.relocateArenas(relocatedListOut, reason, sliceBudget,
                                    stats())) {
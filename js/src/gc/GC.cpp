@@ -2519,6 +2519,7 @@ void GCRuntime::discardJITCodeForGC() {
   size_t pretenuredSiteResetCount = 0;
 
   js::CancelOffThreadIonCompile(rt, JS::Zone::Prepare);
+  js::CancelOffThreadBaselineCompile(rt, JS::Zone::Prepare);
   for (GCZonesIter zone(this); !zone.done(); zone.next()) {
     gcstats::AutoPhase ap(stats(), gcstats::PhaseKind::MARK_DISCARD_CODE);
 
@@ -93,6 +93,7 @@ void PreventGCDuringInteractiveDebug() { TlsContext.get()->suppressGC++; }
 
 void js::ReleaseAllJITCode(JS::GCContext* gcx) {
   js::CancelOffThreadIonCompile(gcx->runtime());
+  js::CancelOffThreadBaselineCompile(gcx->runtime());
 
   for (ZonesIter zone(gcx->runtime(), SkipAtoms); !zone.done(); zone.next()) {
     zone->setPreservingCode(false);
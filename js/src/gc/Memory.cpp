@@ -24,6 +24,9 @@
 
 #  include <algorithm>
 #  include <errno.h>
+#  include <stdio.h>
+#  include <stdlib.h>
+#  include <string.h>
 #  include <unistd.h>
 
 #  if !defined(__wasi__)
@@ -53,6 +56,46 @@ static size_t numAddressBits = 0;
 /* An estimate of the number of bytes available for virtual memory. */
 static size_t virtualMemoryLimit = size_t(-1);
 
+/*
+ * When JS_GC_HUGE_PAGES=1 is set on Linux, chunks are carved out of regions
+ * which are aligned to, and advised for, transparent huge pages. This saves
+ * TLB misses when marking and sweeping large heaps.
+ *
+ * Unmapping part of a region would split its huge page, so regions are only
+ * ever unmapped as a whole. Chunks which are not in use, either because they
+ * were not handed out yet or because they were unmapped while another chunk
+ * of their region is still in use, stay mapped on |spareHugePageChunks|. The
+ * list is linked through the first word of each chunk and is protected by
+ * |hugePageLock|. Spare chunks are handed out before new regions are mapped.
+ */
+#if defined(XP_LINUX) && defined(MADV_HUGEPAGE)
+#  define JS_GC_HUGE_PAGES
+static const size_t HugePageSize = 2 * 1024 * 1024;
+static_assert(HugePageSize % ChunkSize == 0,
+              "A huge page must hold a whole number of chunks");
+static const size_t ChunksPerHugePage = HugePageSize / ChunkSize;
+
+static bool useHugePages = false;
+static mozilla::Atomic<bool, mozilla::ReleaseAcquire> hugePageLock(false);
+static void* spareHugePageChunks = nullptr;
+static size_t spareHugePageChunkCount = 0;
+static mozilla::Atomic<size_t, mozilla::Relaxed> hugePageRegionsMapped(0);
+static mozilla::Atomic<size_t, mozilla::Relaxed> hugePageRegionsUnmapped(0);
+static mozilla::Atomic<size_t, mozilla::Relaxed> hugePageChunksMapped(0);
+static mozilla::Atomic<size_t, mozilla::Relaxed> hugePageAdviseFailures(0);
+
+// Chunks are only mapped and unmapped a few at a time, so a spin lock is
+// good enough. It is never held across a system call.
+class MOZ_RAII AutoLockHugePages {
+ public:
+  AutoLockHugePages() {
+    while (!hugePageLock.compareExchange(false, true)) {
+    }
+  }
+  ~AutoLockHugePages() { hugePageLock = false; }
+};
+#endif
+
 /*
  * System allocation functions may hand out regions of memory in increasing or
  * decreasing order. This ordering is used as a hint during chunk alignment to
@@ -180,7 +223,66 @@ void* TestMapAlignedPagesLastDitch(size_t length, size_t alignment) {
   return MapAlignedPagesLastDitch(length, alignment);
 }
 
-bool DecommitEnabled() { return SystemPageSize() == PageSize; }
+bool DecommitEnabled() {
+#ifdef JS_GC_HUGE_PAGES
+  // Decommitting single arenas would split the huge pages backing a chunk
+  // back into small pages. Empty chunks are unmapped a region at a time.
+  if (useHugePages) {
+    return false;
+  }
+#endif
+  return SystemPageSize() == PageSize;
+}
+
+bool HugePagesEnabled() {
+#ifdef JS_GC_HUGE_PAGES
+  return useHugePages;
+#else
+  return false;
+#endif
+}
+
+void GetHugePageStats(HugePageStats* stats) {
+  *stats = HugePageStats();
+#ifdef JS_GC_HUGE_PAGES
+  stats->enabled = useHugePages;
+  stats->regionsMapped = hugePageRegionsMapped;
+  stats->regionsUnmapped = hugePageRegionsUnmapped;
+  stats->chunksMapped = hugePageChunksMapped;
+  {
+    AutoLockHugePages lock;
+    stats->chunksSpare = spareHugePageChunkCount;
+  }
+  stats->adviseFailures = hugePageAdviseFailures;
+#endif
+}
+
+size_t GetAnonHugePageBytes() {
+#ifdef XP_LINUX
+  // smaps_rollup is much cheaper to read, but is only available since
+  // Linux 4.14.
+  FILE* file = fopen("/proc/self/smaps_rollup", "r");
+  if (!file) {
+    file = fopen("/proc/self/smaps", "r");
+    if (!file) {
+      return 0;
+    }
+  }
+
+  size_t total = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    unsigned long kb;
+    if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+      total += size_t(kb) * 1024;
+    }
+  }
+  fclose(file);
+  return total;
+#else
+  return 0;
+#endif
+}
 
 /* Returns the offset from the nearest aligned address at or below |region|. */
 static inline size_t OffsetFromAligned(void* region, size_t alignment) {
@@ -407,6 +509,10 @@ void InitMemorySubsystem() {
         as_limit.rlim_max != RLIM_INFINITY) {
       virtualMemoryLimit = as_limit.rlim_max;
     }
+#endif
+#ifdef JS_GC_HUGE_PAGES
+    const char* env = getenv("JS_GC_HUGE_PAGES");
+    useHugePages = env && strcmp(env, "1") == 0 && pageSize < HugePageSize;
 #endif
   }
 }
@@ -419,6 +525,92 @@ static inline bool IsInvalidRegion(void* region, size_t length) {
 }
 #endif
 
+#ifdef JS_GC_HUGE_PAGES
+static inline void*& NextSpareChunk(void* chunk) {
+  return *static_cast<void**>(chunk);
+}
+
+static void PushSpareChunk(void* chunk, const AutoLockHugePages& lock) {
+  NextSpareChunk(chunk) = spareHugePageChunks;
+  spareHugePageChunks = chunk;
+  spareHugePageChunkCount++;
+}
+
+static void* MapHugePageChunk() {
+  {
+    AutoLockHugePages lock;
+    if (void* chunk = spareHugePageChunks) {
+      spareHugePageChunks = NextSpareChunk(chunk);
+      spareHugePageChunkCount--;
+      hugePageChunksMapped++;
+      return chunk;
+    }
+  }
+
+  void* region = MapAlignedPages(HugePageSize, HugePageSize);
+  if (!region) {
+    return nullptr;
+  }
+  hugePageRegionsMapped++;
+
+  // This must happen before the region is first touched. If the kernel was
+  // built without THP support we still hand out the chunks, just backed by
+  // small pages.
+  if (madvise(region, HugePageSize, MADV_HUGEPAGE) != 0) {
+    hugePageAdviseFailures++;
+  }
+
+  {
+    AutoLockHugePages lock;
+    for (size_t i = 1; i < ChunksPerHugePage; i++) {
+      PushSpareChunk(static_cast<char*>(region) + i * ChunkSize, lock);
+    }
+  }
+
+  hugePageChunksMapped++;
+  return region;
+}
+
+// Keeps |chunk| on the spare list, unless the other chunks of its region are
+// all spare, in which case the whole region is unmapped.
+static void UnmapHugePageChunk(void* chunk) {
+  void* region = static_cast<char*>(chunk) -
+                 OffsetFromAligned(chunk, HugePageSize);
+  auto inRegion = [region](void* spare) {
+    return uintptr_t(spare) - uintptr_t(region) < HugePageSize;
+  };
+
+  {
+    AutoLockHugePages lock;
+    size_t others = 0;
+    for (void* spare = spareHugePageChunks; spare;
+         spare = NextSpareChunk(spare)) {
+      if (inRegion(spare)) {
+        others++;
+      }
+    }
+
+    if (others < ChunksPerHugePage - 1) {
+      PushSpareChunk(chunk, lock);
+      return;
+    }
+
+    void** link = &spareHugePageChunks;
+    while (void* spare = *link) {
+      if (inRegion(spare)) {
+        *link = NextSpareChunk(spare);
+        spareHugePageChunkCount--;
+      } else {
+        link = &NextSpareChunk(spare);
+      }
+    }
+  }
+
+  hugePageRegionsUnmapped++;
+  UnmapInternal(region, HugePageSize);
+}
+#endif
+
 void* MapAlignedPages(size_t length, size_t alignment) {
   MOZ_RELEASE_ASSERT(length > 0 && alignment > 0);
   MOZ_RELEASE_ASSERT(length % pageSize == 0);
@@ -431,6 +623,12 @@ void* MapAlignedPages(size_t length, size_t alignment) {
     alignment = allocGranularity;
   }
 
+#ifdef JS_GC_HUGE_PAGES
+  if (useHugePages && length == ChunkSize && alignment == ChunkSize) {
+    return MapHugePageChunk();
+  }
+#endif
+
 #ifdef __wasi__
   void* region = nullptr;
   if (int err = posix_memalign(&region, alignment, length)) {
@@ -779,6 +977,14 @@ void UnmapPages(void* region, size_t length) {
   // ASan does not automatically unpoison memory, so we have to do this here.
   MOZ_MAKE_MEM_UNDEFINED(region, length);
 
+#ifdef JS_GC_HUGE_PAGES
+  if (useHugePages && length == ChunkSize &&
+      OffsetFromAligned(region, ChunkSize) == 0) {
+    UnmapHugePageChunk(region);
+    return;
+  }
+#endif
+
   UnmapInternal(region, length);
 }
 
@@ -41,6 +41,32 @@ void UnmapPages(void* region, size_t length);
 // the hardcoded Arena size for the running process.
 bool DecommitEnabled();
 
+// Whether chunks are backed by transparent huge pages. This is enabled by
+// setting JS_GC_HUGE_PAGES=1 in the environment and is only supported on
+// Linux. Arena decommit is disabled in this mode.
+bool HugePagesEnabled();
+
+struct HugePageStats {
+  bool enabled = false;
+  // The number of huge page sized regions mapped for chunks, and the number
+  // of them unmapped again. Regions are only unmapped as a whole.
+  size_t regionsMapped = 0;
+  size_t regionsUnmapped = 0;
+  // The number of chunks handed out from those regions.
+  size_t chunksMapped = 0;
+  // The number of chunks which are not in use but stay mapped because other
+  // chunks of their region are.
+  size_t chunksSpare = 0;
+  // The number of regions the kernel refused to back with huge pages.
+  size_t adviseFailures = 0;
+};
+
+void GetHugePageStats(HugePageStats* stats);
+
+// The number of bytes of anonymous memory in this process which the kernel
+// currently backs with huge pages, or 0 if this is not known.
+size_t GetAnonHugePageBytes();
+
 // Tell the OS that the given pages are not in use, so they should not be
 // written to a paging file. This may be a no-op on some platforms.
 bool MarkPagesUnusedSoft(void* region, size_t length);
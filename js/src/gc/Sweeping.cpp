@@ -1354,6 +1354,7 @@ void GCRuntime::sweepJitDataOnMainThread(JS::GCContext* gcx) {
       // this before marking (in DiscardJITCodeForGC) so this is a no-op
       // for non-incremental GCs.
       js::CancelOffThreadIonCompile(rt, JS::Zone::Sweep);
+      js::CancelOffThreadBaselineCompile(rt, JS::Zone::Sweep);
     }
 
     // Bug 1071218: the following method has not yet been refactored to
@@ -30,6 +30,8 @@
 #include "vm/AsyncFunction.h"
 #include "vm/AsyncIteration.h"
 #include "vm/BuiltinObjectKind.h"
+#include "vm/BytecodeIterator.h"
+#include "vm/BytecodeLocation.h"
 #include "vm/EnvironmentObject.h"
 #include "vm/FunctionFlags.h"  // js::FunctionFlags
 #include "vm/Interpreter.h"
@@ -45,6 +47,8 @@
 #include "jit/MacroAssembler-inl.h"
 #include "jit/SharedICHelpers-inl.h"
 #include "jit/VMFunctionList-inl.h"
+#include "vm/BytecodeIterator-inl.h"
+#include "vm/BytecodeLocation-inl.h"
 #include "vm/Interpreter-inl.h"
 #include "vm/JSScript-inl.h"
 
@@ -62,39 +66,164 @@ class PlainObject;
 
 namespace jit {
 
-BaselineCompilerHandler::BaselineCompilerHandler(JSContext* cx,
-                                                 MacroAssembler& masm,
-                                                 TempAllocator& alloc,
-                                                 JSScript* script)
-    : frame_(script, masm),
+static void CreateAllocSitesForICChain(JSScript* script, uint32_t entryIndex);
+
+bool BaselineSnapshot::init(JSContext* cx, bool forceDebugInstrumentation) {
+  MOZ_ASSERT(cx->realm() == script_->realm());
+
+  AutoKeepJitScripts keepJitScript(cx);
+  if (!script_->ensureHasJitScript(cx, keepJitScript)) {
+    return false;
+  }
+
+  // When code coverage is enabled, we have to create the ScriptCounts if they
+  // do not exist.
+  if (!script_->hasScriptCounts() && cx->realm()->collectCoverageForDebug()) {
+    if (!script_->initScriptCounts(cx)) {
+      return false;
+    }
+  }
+
+  compileDebugInstrumentation_ =
+      script_->isDebuggee() || forceDebugInstrumentation;
+  ionCompileable_ = IsIonEnabled(cx) && CanIonCompileScript(cx, script_);
+
+  // The objects are not rooted: GC must not move them until the code is
+  // generated. Off-thread compilations are cancelled by GC.
+  gc::AutoSuppressGC suppressGC(cx);
+
+  if (!script_->hasNonSyntacticScope()) {
+    GlobalLexicalEnvironmentObject* lexical =
+        &script_->global().lexicalEnvironment();
+    globalLexical_ = lexical;
+    globalThis_ = lexical->thisObject();
+  }
+
+  Rooted<GlobalObject*> global(cx, &script_->global());
+  Rooted<PropertyName*> name(cx);
+  for (const BytecodeLocation& loc : AllBytecodesIterable(script_)) {
+    JSObject* obj = nullptr;
+    switch (loc.getOp()) {
+      case JSOp::BindGName:
+        if (script_->hasNonSyntacticScope()) {
+          continue;
+        }
+        name = loc.getPropertyName(script_);
+        obj = MaybeOptimizeBindGlobalName(cx, global, name);
+        if (!obj) {
+          continue;
+        }
+        break;
+      case JSOp::BuiltinObject:
+        // Built-in objects are constants for a given global.
+        obj = BuiltinObjectOperation(cx, loc.getBuiltinObjectKind());
+        if (!obj) {
+          return false;
+        }
+        break;
+      case JSOp::ImportMeta:
+        obj = GetModuleObjectForScript(script_);
+        MOZ_ASSERT(obj);
+        break;
+      default:
+        continue;
+    }
+    if (!bakedObjects_.append(BakedObject{loc.bytecodeToOffset(script_), obj})) {
+      ReportOutOfMemory(cx);
+      return false;
+    }
+  }
+
+  // Optimized IC stubs are attached on the main thread, so allocation sites
+  // are created for them here rather than in emitNextIC.
+  JitScript* jitScript = script_->jitScript();
+  for (uint32_t i = 0; i < jitScript->numICEntries(); i++) {
+    uint32_t pcOffset = jitScript->fallbackStub(i)->pcOffset();
+    if (BytecodeOpCanHaveAllocSite(JSOp(*script_->offsetToPC(pcOffset)))) {
+      CreateAllocSitesForICChain(script_, i);
+    }
+  }
+
+  return true;
+}
+
+JSObject* BaselineSnapshot::maybeBakedObject(jsbytecode* pc) const {
+  uint32_t pcOffset = script_->pcToOffset(pc);
+  size_t lo = 0;
+  size_t hi = bakedObjects_.length();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (bakedObjects_[mid].pcOffset < pcOffset) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < bakedObjects_.length() && bakedObjects_[lo].pcOffset == pcOffset) {
+    return bakedObjects_[lo].object;
+  }
+  return nullptr;
+}
+
+bool BaselineSnapshot::canCompileOffThread(JSContext* cx) const {
+  if (compileDebugInstrumentation_ || script_->hasScriptCounts() ||
+      cx->realm()->collectCoverageForDebug()) {
+    return false;
+  }
+
+  auto isTenured = [](JSObject* obj) { return !obj || obj->isTenured(); };
+  if (!isTenured(globalLexical_) || !isTenured(globalThis_)) {
+    return false;
+  }
+  for (const BakedObject& baked : bakedObjects_) {
+    if (!isTenured(baked.object)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BaselineSnapshot::isStillValid(JSContext* cx) const {
+  // The debugger or code coverage may have been enabled while the code was
+  // generated without instrumentation.
+  return script_->hasJitScript() && !script_->hasBaselineScript() &&
+         script_->canBaselineCompile() && !script_->isDebuggee() &&
+         !script_->hasScriptCounts() &&
+         !script_->realm()->collectCoverageForDebug();
+}
+
+BaselineCompilerHandler::BaselineCompilerHandler(
+    MacroAssembler& masm, TempAllocator& alloc,
+    const BaselineSnapshot& snapshot)
+    : frame_(snapshot.script(), masm),
       alloc_(alloc),
-      analysis_(alloc, script),
+      analysis_(alloc, snapshot.script()),
 #ifdef DEBUG
       masm_(masm),
 #endif
-      script_(script),
-      pc_(script->code()),
-      icEntryIndex_(0),
-      compileDebugInstrumentation_(script->isDebuggee()),
-      ionCompileable_(IsIonEnabled(cx) && CanIonCompileScript(cx, script)) {
+      snapshot_(snapshot),
+      script_(snapshot.script()),
+      pc_(snapshot.script()->code()),
+      icEntryIndex_(0) {
 }
 
-BaselineInterpreterHandler::BaselineInterpreterHandler(JSContext* cx,
-                                                       MacroAssembler& masm)
+BaselineInterpreterHandler::BaselineInterpreterHandler(MacroAssembler& masm)
     : frame_(masm) {}
 
 template <typename Handler>
 template <typename... HandlerArgs>
-BaselineCodeGen<Handler>::BaselineCodeGen(JSContext* cx, TempAllocator& alloc,
+BaselineCodeGen<Handler>::BaselineCodeGen(JSContext* cx, MacroAssembler& masm,
                                           HandlerArgs&&... args)
-    : handler(cx, masm, std::forward<HandlerArgs>(args)...),
+    : handler(masm, std::forward<HandlerArgs>(args)...),
       cx(cx),
-      masm(cx, alloc),
+      runtime(masm.runtime()),
+      masm(masm),
       frame(handler.frame()) {}
 
-BaselineCompiler::BaselineCompiler(JSContext* cx, TempAllocator& alloc,
-                                   JSScript* script)
-    : BaselineCodeGen(cx, alloc, /* HandlerArgs = */ alloc, script),
+BaselineCompiler::BaselineCompiler(JSContext* cx, MacroAssembler& masm,
+                                   TempAllocator& alloc,
+                                   const BaselineSnapshot& snapshot)
+    : BaselineCodeGen(cx, masm, /* HandlerArgs = */ alloc, snapshot),
       profilerPushToggleOffset_() {
 #ifdef JS_CODEGEN_NONE
   MOZ_CRASH();
@@ -102,10 +231,10 @@ BaselineCompiler::BaselineCompiler(JSContext* cx, TempAllocator& alloc,
 }
 
 BaselineInterpreterGenerator::BaselineInterpreterGenerator(JSContext* cx,
-                                                           TempAllocator& alloc)
-    : BaselineCodeGen(cx, alloc /* no handlerArgs */) {}
+                                                           MacroAssembler& masm)
+    : BaselineCodeGen(cx, masm /* no handlerArgs */) {}
 
-bool BaselineCompilerHandler::init(JSContext* cx) {
+bool BaselineCompilerHandler::init() {
   if (!analysis_.init(alloc_)) {
     return false;
   }
@@ -128,15 +257,14 @@ bool BaselineCompilerHandler::init(JSContext* cx) {
 }
 
 bool BaselineCompiler::init() {
-  if (!handler.init(cx)) {
+  if (!handler.init()) {
     return false;
   }
 
   return true;
 }
 
-bool BaselineCompilerHandler::recordCallRetAddr(JSContext* cx,
-                                                RetAddrEntry::Kind kind,
+bool BaselineCompilerHandler::recordCallRetAddr(RetAddrEntry::Kind kind,
                                                 uint32_t retOffset) {
   uint32_t pcOffset = script_->pcToOffset(pc_);
 
@@ -150,16 +278,10 @@ bool BaselineCompilerHandler::recordCallRetAddr(JSContext* cx,
   MOZ_ASSERT_IF(!retAddrEntries_.empty() && !masm_.oom(),
                 retAddrEntries_.back().returnOffset().offset() < retOffset);
 
-  if (!retAddrEntries_.emplaceBack(pcOffset, kind, CodeOffset(retOffset))) {
-    ReportOutOfMemory(cx);
-    return false;
-  }
-
-  return true;
+  return retAddrEntries_.emplaceBack(pcOffset, kind, CodeOffset(retOffset));
 }
 
-bool BaselineInterpreterHandler::recordCallRetAddr(JSContext* cx,
-                                                   RetAddrEntry::Kind kind,
+bool BaselineInterpreterHandler::recordCallRetAddr(RetAddrEntry::Kind kind,
                                                    uint32_t retOffset) {
   switch (kind) {
     case RetAddrEntry::Kind::DebugPrologue:
@@ -194,33 +316,36 @@ bool BaselineInterpreterHandler::addDebugInstrumentationOffset(
 }
 
 MethodStatus BaselineCompiler::compile() {
-  AutoCreatedBy acb(masm, "BaselineCompiler::compile");
+  MOZ_ASSERT(cx);
 
-  JSScript* script = handler.script();
-  JitSpew(JitSpew_BaselineScripts, "Baseline compiling script %s:%u:%u (%p)",
-          script->filename(), script->lineno(), script->column(), script);
+  // Suppress GC during compilation.
+  gc::AutoSuppressGC suppressGC(cx);
 
-  JitSpew(JitSpew_Codegen, "# Emitting baseline code for script %s:%u:%u",
-          script->filename(), script->lineno(), script->column());
+  MethodStatus status = emitCode();
+  if (status != Method_Compiled) {
+    return status;
+  }
 
-  AutoIncrementalTimer timer(cx->realm()->timers.baselineCompileTime);
+  return link(cx);
+}
 
-  AutoKeepJitScripts keepJitScript(cx);
-  if (!script->ensureHasJitScript(cx, keepJitScript)) {
-    return Method_Error;
-  }
+MethodStatus BaselineCompiler::compileOffThread() {
+  MOZ_ASSERT(!cx);
+  return emitCode();
+}
 
-  // When code coverage is enabled, we have to create the ScriptCounts if they
-  // do not exist.
-  if (!script->hasScriptCounts() && cx->realm()->collectCoverageForDebug()) {
-    if (!script->initScriptCounts(cx)) {
-      return Method_Error;
-    }
-  }
+MethodStatus BaselineCompiler::emitCode() {
+  AutoCreatedBy acb(masm, "BaselineCompiler::compile");
 
-  // Suppress GC during compilation.
-  gc::AutoSuppressGC suppressGC(cx);
+  JSScript* script = handler.script();
+  JitSpew(JitSpew_BaselineScripts, "Baseline compiling script %s:%u:%u (%p)%s",
+          script->filename(), script->lineno(), script->column(), script,
+          cx ? "" : " off thread");
 
+  JitSpew(JitSpew_Codegen, "# Emitting baseline code for script %s:%u:%u",
+          script->filename(), script->lineno(), script->column());
+
+  MOZ_ASSERT(script->hasJitScript());
   MOZ_ASSERT(!script->hasBaselineScript());
 
   if (!emitPrologue()) {
@@ -240,7 +365,17 @@ MethodStatus BaselineCompiler::compile() {
     return Method_Error;
   }
 
-  AutoCreatedBy acb2(masm, "exception_tail");
+  return Method_Compiled;
+}
+
+MethodStatus BaselineCompiler::link(JSContext* cx) {
+  MOZ_ASSERT(cx->realm() == handler.script()->realm());
+  gc::AutoSuppressGC suppressGC(cx);
+
+  JSScript* script = handler.script();
+  MOZ_ASSERT(!script->hasBaselineScript());
+
+  AutoCreatedBy acb(masm, "exception_tail");
   Linker linker(masm);
   if (masm.oom()) {
     ReportOutOfMemory(cx);
@@ -361,9 +496,10 @@ static void LoadUint8Operand(MacroAssembler& masm, Register dest) {
   masm.load8ZeroExtend(Address(pc, sizeof(jsbytecode)), dest);
 }
 
-static void LoadUint16Operand(MacroAssembler& masm, Register dest) {
+static void LoadUint16Operand(MacroAssembler& masm, Register dest,
+                              size_t opOffset = 0) {
   Register pc = LoadBytecodePC(masm, dest);
-  masm.load16ZeroExtend(Address(pc, sizeof(jsbytecode)), dest);
+  masm.load16ZeroExtend(Address(pc, opOffset + sizeof(jsbytecode)), dest);
 }
 
 static void LoadInt32Operand(MacroAssembler& masm, Register dest) {
@@ -523,7 +659,7 @@ bool BaselineCodeGen<Handler>::emitOutOfLinePostBarrierSlot() {
 
   using Fn = void (*)(JSRuntime * rt, js::gc::Cell * cell);
   masm.setupUnalignedABICall(scratch);
-  masm.movePtr(ImmPtr(cx->runtime()), scratch);
+  masm.movePtr(ImmPtr(runtime), scratch);
   masm.passABIArg(scratch);
   masm.passABIArg(objReg);
   masm.callWithABI<Fn, PostWriteBarrier>();
@@ -611,10 +747,6 @@ bool BaselineCompilerCodeGen::emitNextIC() {
   MOZ_ASSERT(stub->pcOffset() == pcOffset);
   MOZ_ASSERT(BytecodeOpHasIC(JSOp(*handler.pc())));
 
-  if (BytecodeOpCanHaveAllocSite(JSOp(*handler.pc()))) {
-    CreateAllocSitesForICChain(script, entryIndex);
-  }
-
   // Load stub pointer into ICStubReg.
   masm.loadPtr(frame.addressOfICScript(), ICStubReg);
   size_t firstStubOffset = ICScript::offsetOfFirstStub(entryIndex);
@@ -625,7 +757,7 @@ bool BaselineCompilerCodeGen::emitNextIC() {
 
   RetAddrEntry::Kind kind = RetAddrEntry::Kind::IC;
   if (!handler.retAddrEntries().emplaceBack(pcOffset, kind, returnOffset)) {
-    ReportOutOfMemory(cx);
+    reportOutOfMemory();
     return false;
   }
 
@@ -720,7 +852,7 @@ bool BaselineCodeGen<Handler>::callVMInternal(VMFunctionId id,
   inCall_ = false;
 #endif
 
-  TrampolinePtr code = cx->runtime()->jitRuntime()->getVMWrapper(id);
+  TrampolinePtr code = runtime->jitRuntime()->getVMWrapper(id);
   const VMFunctionData& fun = GetVMFunction(id);
 
   uint32_t argSize = GetVMFunctionArgSize(fun);
@@ -750,7 +882,11 @@ bool BaselineCodeGen<Handler>::callVMInternal(VMFunctionId id,
 
   restoreInterpreterPCReg();
 
-  return handler.recordCallRetAddr(cx, kind, callOffset);
+  if (!handler.recordCallRetAddr(kind, callOffset)) {
+    reportOutOfMemory();
+    return false;
+  }
+  return true;
 }
 
 template <typename Handler>
@@ -770,11 +906,11 @@ bool BaselineCodeGen<Handler>::emitStackCheck() {
     masm.moveStackPtrTo(scratch);
     subtractScriptSlotsSize(scratch, R2.scratchReg());
     masm.branchPtr(Assembler::BelowOrEqual,
-                   AbsoluteAddress(cx->addressOfJitStackLimit()), scratch,
+                   AbsoluteAddress(runtime->addressOfJitStackLimit()), scratch,
                    &skipCall);
   } else {
     masm.branchStackPtrRhs(Assembler::BelowOrEqual,
-                           AbsoluteAddress(cx->addressOfJitStackLimit()),
+                           AbsoluteAddress(runtime->addressOfJitStackLimit()),
                            &skipCall);
   }
 
@@ -887,7 +1023,7 @@ void BaselineInterpreterCodeGen::subtractScriptSlotsSize(Register reg,
 template <>
 void BaselineCompilerCodeGen::loadGlobalLexicalEnvironment(Register dest) {
   MOZ_ASSERT(!handler.script()->hasNonSyntacticScope());
-  masm.movePtr(ImmGCPtr(&cx->global()->lexicalEnvironment()), dest);
+  masm.movePtr(ImmGCPtr(handler.snapshot().globalLexical()), dest);
 }
 
 template <>
@@ -902,7 +1038,7 @@ void BaselineInterpreterCodeGen::loadGlobalLexicalEnvironment(Register dest) {
 template <>
 void BaselineCompilerCodeGen::pushGlobalLexicalEnvironmentValue(
     ValueOperand scratch) {
-  frame.push(ObjectValue(cx->global()->lexicalEnvironment()));
+  frame.push(ObjectValue(*handler.snapshot().globalLexical()));
 }
 
 template <>
@@ -915,7 +1051,7 @@ void BaselineInterpreterCodeGen::pushGlobalLexicalEnvironmentValue(
 
 template <>
 void BaselineCompilerCodeGen::loadGlobalThisValue(ValueOperand dest) {
-  JSObject* thisObj = cx->global()->lexicalEnvironment().thisObject();
+  JSObject* thisObj = handler.snapshot().globalThis();
   masm.moveValue(ObjectValue(*thisObj), dest);
 }
 
@@ -1141,7 +1277,7 @@ void BaselineCompilerCodeGen::emitInitFrameFields(Register nonFunctionEnv) {
   // the caller), take that ICScript and store it in the frame, then
   // overwrite cx->inlinedICScript with nullptr.
   Label notInlined, done;
-  masm.movePtr(ImmPtr(cx->addressOfInlinedICScript()), scratch);
+  masm.movePtr(ImmPtr(runtime->addressOfInlinedICScript()), scratch);
   Address inlinedAddr(scratch, 0);
   masm.branchPtr(Assembler::Equal, inlinedAddr, ImmWord(0), &notInlined);
   masm.loadPtr(inlinedAddr, scratch2);
@@ -1275,8 +1411,9 @@ bool BaselineCodeGen<Handler>::emitInterruptCheck() {
   frame.syncStack(0);
 
   Label done;
-  masm.branch32(Assembler::Equal, AbsoluteAddress(cx->addressOfInterruptBits()),
-                Imm32(0), &done);
+  masm.branch32(Assembler::Equal,
+                AbsoluteAddress(runtime->addressOfInterruptBits()), Imm32(0),
+                &done);
 
   prepareVMCall();
 
@@ -1307,7 +1444,7 @@ bool BaselineCompilerCodeGen::emitWarmUpCounterIncrement() {
     uint32_t pcOffset = script->pcToOffset(pc);
     uint32_t nativeOffset = masm.currentOffset();
     if (!handler.osrEntries().emplaceBack(pcOffset, nativeOffset)) {
-      ReportOutOfMemory(cx);
+      reportOutOfMemory();
       return false;
     }
   }
@@ -1435,9 +1572,10 @@ bool BaselineCompilerCodeGen::emitWarmUpCounterIncrement() {
     {
       Label checkOk;
       AbsoluteAddress addressOfEnabled(
-          cx->runtime()->geckoProfiler().addressOfEnabled());
+          runtime->geckoProfiler().addressOfEnabled());
       masm.branch32(Assembler::Equal, addressOfEnabled, Imm32(0), &checkOk);
-      masm.loadPtr(AbsoluteAddress((void*)&cx->jitActivation), scratchReg);
+      masm.loadPtr(AbsoluteAddress(runtime->addressOfJitActivation()),
+                   scratchReg);
       masm.loadPtr(
           Address(scratchReg, JitActivation::offsetOfLastProfilingFrame()),
           scratchReg);
@@ -1533,6 +1671,10 @@ bool BaselineCompiler::emitDebugTrap() {
   MOZ_ASSERT(compileDebugInstrumentation());
   MOZ_ASSERT(frame.numUnsyncedSlots() == 0);
 
+  // Scripts compiled with debug instrumentation are compiled on the main
+  // thread.
+  MOZ_ASSERT(cx);
+
   JSScript* script = handler.script();
   bool enabled = DebugAPI::stepModeEnabled(script) ||
                  DebugAPI::hasBreakpointsAt(script, handler.pc());
@@ -1553,8 +1695,12 @@ bool BaselineCompiler::emitDebugTrap() {
   }
 
   // Add a RetAddrEntry for the return offset -> pc mapping.
-  return handler.recordCallRetAddr(cx, RetAddrEntry::Kind::DebugTrap,
-                                   masm.currentOffset());
+  if (!handler.recordCallRetAddr(RetAddrEntry::Kind::DebugTrap,
+                                 masm.currentOffset())) {
+    ReportOutOfMemory(cx);
+    return false;
+  }
+  return true;
 }
 
 template <typename Handler>
@@ -2383,7 +2529,7 @@ bool BaselineInterpreterCodeGen::emit_String() {
 template <>
 bool BaselineCompilerCodeGen::emit_Symbol() {
   unsigned which = GET_UINT8(handler.pc());
-  JS::Symbol* sym = cx->runtime()->wellKnownSymbols->get(which);
+  JS::Symbol* sym = runtime->wellKnownSymbols().get(which);
   frame.push(SymbolValue(sym));
   return true;
 }
@@ -3120,15 +3266,15 @@ bool BaselineCompilerCodeGen::tryOptimizeGetGlobalName() {
   PropertyName* name = handler.script()->getName(handler.pc());
 
   // These names are non-configurable on the global and cannot be shadowed.
-  if (name == cx->names().undefined) {
+  if (name == runtime->names().undefined) {
     frame.push(UndefinedValue());
     return true;
   }
-  if (name == cx->names().NaN) {
+  if (name == runtime->names().NaN) {
     frame.push(JS::NaNValue());
     return true;
   }
-  if (name == cx->names().Infinity) {
+  if (name == runtime->names().Infinity) {
     frame.push(JS::InfinityValue());
     return true;
   }
@@ -3164,12 +3310,9 @@ bool BaselineCodeGen<Handler>::emit_GetGName() {
 
 template <>
 bool BaselineCompilerCodeGen::tryOptimizeBindGlobalName() {
-  JSScript* script = handler.script();
-  MOZ_ASSERT(!script->hasNonSyntacticScope());
+  MOZ_ASSERT(!handler.script()->hasNonSyntacticScope());
 
-  Rooted<GlobalObject*> global(cx, &script->global());
-  Rooted<PropertyName*> name(cx, script->getName(handler.pc()));
-  if (JSObject* binding = MaybeOptimizeBindGlobalName(cx, global, name)) {
+  if (JSObject* binding = handler.snapshot().maybeBakedObject(handler.pc())) {
     frame.push(ObjectValue(*binding));
     return true;
   }
@@ -3929,10 +4072,38 @@ bool BaselineInterpreterCodeGen::emit_SetLocal() {
 }
 
 template <>
-bool BaselineCompilerCodeGen::emitFormalArgAccess(JSOp op) {
+bool BaselineCompilerCodeGen::emit_GetLocalPair() {
+  frame.pushLocal(GET_LOCALNO(handler.pc()));
+  frame.pushLocal(GET_LOCALNO(handler.pc() + JSOpLength_GetLocal));
+  return true;
+}
+
+template <>
+bool BaselineInterpreterCodeGen::emit_GetLocalPair() {
+  for (size_t opOffset : {size_t(0), size_t(JSOpLength_GetLocal)}) {
+    Register scratch = R0.scratchReg();
+    LoadUint24Operand(masm, opOffset, scratch);
+    BaseValueIndex addr = ComputeAddressOfLocal(masm, scratch);
+    masm.loadValue(addr, R0);
+    frame.push(R0);
+  }
+  return true;
+}
+
+template <typename Handler>
+bool BaselineCodeGen<Handler>::emit_SetLocalPop() {
+  if (!emit_SetLocal()) {
+    return false;
+  }
+  frame.pop();
+  return true;
+}
+
+template <>
+bool BaselineCompilerCodeGen::emitFormalArgAccess(JSOp op, size_t opOffset) {
   MOZ_ASSERT(op == JSOp::GetArg || op == JSOp::SetArg);
 
-  uint32_t arg = GET_ARGNO(handler.pc());
+  uint32_t arg = GET_ARGNO(handler.pc() + opOffset);
 
   // Fast path: the script does not use |arguments| or formals don't
   // alias the arguments object.
@@ -3987,12 +4158,13 @@ bool BaselineCompilerCodeGen::emitFormalArgAccess(JSOp op) {
 }
 
 template <>
-bool BaselineInterpreterCodeGen::emitFormalArgAccess(JSOp op) {
+bool BaselineInterpreterCodeGen::emitFormalArgAccess(JSOp op,
+                                                     size_t opOffset) {
   MOZ_ASSERT(op == JSOp::GetArg || op == JSOp::SetArg);
 
   // Load the index.
   Register argReg = R1.scratchReg();
-  LoadUint16Operand(masm, argReg);
+  LoadUint16Operand(masm, argReg, opOffset);
 
   // If the frame has no arguments object, this must be an unaliased access.
   Label isUnaliased, done;
@@ -4056,6 +4228,12 @@ bool BaselineCodeGen<Handler>::emit_GetArg() {
   return emitFormalArgAccess(JSOp::GetArg);
 }
 
+template <typename Handler>
+bool BaselineCodeGen<Handler>::emit_GetArgPair() {
+  return emitFormalArgAccess(JSOp::GetArg) &&
+         emitFormalArgAccess(JSOp::GetArg, JSOpLength_GetArg);
+}
+
 template <typename Handler>
 bool BaselineCodeGen<Handler>::emit_SetArg() {
   return emitFormalArgAccess(JSOp::SetArg);
@@ -5079,7 +5257,7 @@ bool BaselineCodeGen<Handler>::emit_TableSwitch() {
 
   // Call a stub to convert R0 from double to int32 if needed.
   // Note: this stub may clobber scratch1.
-  masm.call(cx->runtime()->jitRuntime()->getDoubleToInt32ValueStub());
+  masm.call(runtime->jitRuntime()->getDoubleToInt32ValueStub());
 
   // Load the index in the jump table in |key|, or branch to default pc if not
   // int32 or out-of-range.
@@ -5590,7 +5768,7 @@ bool BaselineCodeGen<Handler>::emit_FinalYieldRval() {
 template <>
 void BaselineCompilerCodeGen::emitJumpToInterpretOpLabel() {
   TrampolinePtr code =
-      cx->runtime()->jitRuntime()->baselineInterpreter().interpretOpAddr();
+      runtime->jitRuntime()->baselineInterpreter().interpretOpAddr();
   masm.jump(code);
 }
 
@@ -5749,8 +5927,9 @@ bool BaselineCodeGen<Handler>::emit_Resume() {
 #endif
 
   // Record the return address so the return offset -> pc mapping works.
-  if (!handler.recordCallRetAddr(cx, RetAddrEntry::Kind::IC,
+  if (!handler.recordCallRetAddr(RetAddrEntry::Kind::IC,
                                  masm.currentOffset())) {
+    reportOutOfMemory();
     return false;
   }
 
@@ -5770,7 +5949,7 @@ bool BaselineCodeGen<Handler>::emit_Resume() {
     Register scratchReg = scratch2;
     Label skip;
     AbsoluteAddress addressOfEnabled(
-        cx->runtime()->geckoProfiler().addressOfEnabled());
+        runtime->geckoProfiler().addressOfEnabled());
     masm.branch32(Assembler::Equal, addressOfEnabled, Imm32(0), &skip);
     masm.loadJSContext(scratchReg);
     masm.loadPtr(Address(scratchReg, JSContext::offsetOfProfilingActivation()),
@@ -6043,11 +6222,8 @@ bool BaselineCodeGen<Handler>::emit_InitHomeObject() {
 template <>
 bool BaselineCompilerCodeGen::emit_BuiltinObject() {
   // Built-in objects are constants for a given global.
-  auto kind = BuiltinObjectKind(GET_UINT8(handler.pc()));
-  JSObject* builtin = BuiltinObjectOperation(cx, kind);
-  if (!builtin) {
-    return false;
-  }
+  JSObject* builtin = handler.snapshot().maybeBakedObject(handler.pc());
+  MOZ_ASSERT(builtin);
   frame.push(ObjectValue(*builtin));
   return true;
 }
@@ -6118,7 +6294,7 @@ bool BaselineCompilerCodeGen::emit_ImportMeta() {
   // Note: this is like the interpreter implementation, but optimized a bit by
   // calling GetModuleObjectForScript at compile-time.
 
-  Rooted<ModuleObject*> module(cx, GetModuleObjectForScript(handler.script()));
+  JSObject* module = handler.snapshot().maybeBakedObject(handler.pc());
   MOZ_ASSERT(module);
 
   frame.syncStack(0);
@@ -6325,7 +6501,7 @@ MethodStatus BaselineCompiler::emitBody() {
       uint32_t pcOffset = script->pcToOffset(handler.pc());
       uint32_t nativeOffset = masm.currentOffset();
       if (!resumeOffsetEntries_.emplaceBack(pcOffset, nativeOffset)) {
-        ReportOutOfMemory(cx);
+        reportOutOfMemory();
         return Method_Error;
       }
     }
@@ -17,6 +17,52 @@ namespace js {
 
 namespace jit {
 
+// The VM state the Baseline compiler bakes into the code for a script, looked
+// up on the main thread before compiling. Everything else the compiler reads is
+// either immutable or only used by JIT code at run time, so the code can be
+// generated on a helper thread. See BaselineCompileTask.
+class BaselineSnapshot {
+  JSScript* script_;
+  JSObject* globalLexical_ = nullptr;
+  JSObject* globalThis_ = nullptr;
+
+  // Objects for JSOp::BindGName, JSOp::BuiltinObject and JSOp::ImportMeta ops,
+  // sorted by pc offset. BindGName ops with no entry use an IC.
+  struct BakedObject {
+    uint32_t pcOffset;
+    JSObject* object;
+  };
+  Vector<BakedObject, 0, SystemAllocPolicy> bakedObjects_;
+
+  bool compileDebugInstrumentation_ = false;
+  bool ionCompileable_ = false;
+
+ public:
+  explicit BaselineSnapshot(JSScript* script) : script_(script) {}
+
+  // Also creates the JitScript and, when collecting code coverage, the
+  // ScriptCounts of the script.
+  [[nodiscard]] bool init(JSContext* cx, bool forceDebugInstrumentation);
+
+  JSScript* script() const { return script_; }
+  JSObject* globalLexical() const { return globalLexical_; }
+  JSObject* globalThis() const { return globalThis_; }
+  JSObject* maybeBakedObject(jsbytecode* pc) const;
+
+  bool compileDebugInstrumentation() const {
+    return compileDebugInstrumentation_;
+  }
+  bool isIonCompileable() const { return ionCompileable_; }
+
+  // Whether the code can be generated off thread. This excludes debug
+  // instrumentation and code coverage, and nursery objects which a minor GC
+  // could move before the code is linked.
+  bool canCompileOffThread(JSContext* cx) const;
+
+  // Whether code generated off thread for this snapshot can still be linked.
+  bool isStillValid(JSContext* cx) const;
+};
+
 enum class ScriptGCThingType {
   Atom,
   String,
@@ -36,8 +82,10 @@ class BaselineCodeGen {
  protected:
   Handler handler;
 
+  // nullptr when a BaselineCompiler runs off thread.
   JSContext* cx;
-  StackMacroAssembler masm;
+  CompileRuntime* runtime;
+  MacroAssembler& masm;
 
   typename Handler::FrameInfoT& frame;
 
@@ -66,9 +114,17 @@ class BaselineCodeGen {
 #endif
 
   template <typename... HandlerArgs>
-  explicit BaselineCodeGen(JSContext* cx, TempAllocator& alloc,
+  explicit BaselineCodeGen(JSContext* cx, MacroAssembler& masm,
                            HandlerArgs&&... args);
 
+  // Off-thread compilations can't report errors. They fail and the script is
+  // compiled again when it gets warm.
+  void reportOutOfMemory() {
+    if (cx) {
+      ReportOutOfMemory(cx);
+    }
+  }
+
   template <typename T>
   void pushArg(const T& t) {
     masm.Push(t);
@@ -239,7 +295,9 @@ class BaselineCodeGen {
   [[nodiscard]] bool emitInitPropGetterSetter();
   [[nodiscard]] bool emitInitElemGetterSetter();
 
-  [[nodiscard]] bool emitFormalArgAccess(JSOp op);
+  // |opOffset| is the offset of the GetArg or SetArg op from the current pc,
+  // which is not zero for the second op of a superinstruction.
+  [[nodiscard]] bool emitFormalArgAccess(JSOp op, size_t opOffset = 0);
 
   [[nodiscard]] bool emitUninitializedLexicalCheck(const ValueOperand& val);
 
@@ -289,22 +347,20 @@ class BaselineCompilerHandler {
       Vector<BaselineScript::OSREntry, 16, SystemAllocPolicy>;
   OSREntryVector osrEntries_;
 
+  const BaselineSnapshot& snapshot_;
   JSScript* script_;
   jsbytecode* pc_;
 
   // Index of the current ICEntry in the script's JitScript.
   uint32_t icEntryIndex_;
 
-  bool compileDebugInstrumentation_;
-  bool ionCompileable_;
-
  public:
   using FrameInfoT = CompilerFrameInfo;
 
-  BaselineCompilerHandler(JSContext* cx, MacroAssembler& masm,
-                          TempAllocator& alloc, JSScript* script);
+  BaselineCompilerHandler(MacroAssembler& masm, TempAllocator& alloc,
+                          const BaselineSnapshot& snapshot);
 
-  [[nodiscard]] bool init(JSContext* cx);
+  [[nodiscard]] bool init();
 
   CompilerFrameInfo& frame() { return frame_; }
 
@@ -331,12 +387,13 @@ class BaselineCompilerHandler {
 
   ModuleObject* module() const { return script_->module(); }
 
-  void setCompileDebugInstrumentation() { compileDebugInstrumentation_ = true; }
+  const BaselineSnapshot& snapshot() const { return snapshot_; }
+
   bool compileDebugInstrumentation() const {
-    return compileDebugInstrumentation_;
+    return snapshot_.compileDebugInstrumentation();
   }
 
-  bool maybeIonCompileable() const { return ionCompileable_; }
+  bool maybeIonCompileable() const { return snapshot_.isIonCompileable(); }
 
   uint32_t icEntryIndex() const { return icEntryIndex_; }
   void moveToNextICEntry() { icEntryIndex_++; }
@@ -346,7 +403,7 @@ class BaselineCompilerHandler {
   RetAddrEntryVector& retAddrEntries() { return retAddrEntries_; }
   OSREntryVector& osrEntries() { return osrEntries_; }
 
-  [[nodiscard]] bool recordCallRetAddr(JSContext* cx, RetAddrEntry::Kind kind,
+  [[nodiscard]] bool recordCallRetAddr(RetAddrEntry::Kind kind,
                                        uint32_t retOffset);
 
   // If a script has more |nslots| than this the stack check must account
@@ -376,19 +433,26 @@ class BaselineCompiler final : private BaselineCompilerCodeGen {
   BaselinePerfSpewer perfSpewer_;
 
  public:
-  BaselineCompiler(JSContext* cx, TempAllocator& alloc, JSScript* script);
+  // |cx| is nullptr when compiling off thread.
+  BaselineCompiler(JSContext* cx, MacroAssembler& masm, TempAllocator& alloc,
+                   const BaselineSnapshot& snapshot);
   [[nodiscard]] bool init();
 
+  // Generates and links the code on the main thread.
   MethodStatus compile();
 
+  // Generates the code on a helper thread. The code is linked later by
+  // link().
+  MethodStatus compileOffThread();
+
+  MethodStatus link(JSContext* cx);
+
   bool compileDebugInstrumentation() const {
     return handler.compileDebugInstrumentation();
   }
-  void setCompileDebugInstrumentation() {
-    handler.setCompileDebugInstrumentation();
-  }
 
  private:
+  MethodStatus emitCode();
   MethodStatus emitBody();
 
   [[nodiscard]] bool emitDebugTrap();
@@ -427,7 +491,7 @@ class BaselineInterpreterHandler {
  public:
   using FrameInfoT = InterpreterFrameInfo;
 
-  explicit BaselineInterpreterHandler(JSContext* cx, MacroAssembler& masm);
+  explicit BaselineInterpreterHandler(MacroAssembler& masm);
 
   InterpreterFrameInfo& frame() { return frame_; }
 
@@ -470,7 +534,7 @@ class BaselineInterpreterHandler {
     return callVMOffsets_;
   }
 
-  [[nodiscard]] bool recordCallRetAddr(JSContext* cx, RetAddrEntry::Kind kind,
+  [[nodiscard]] bool recordCallRetAddr(RetAddrEntry::Kind kind,
                                        uint32_t retOffset);
 
   bool maybeIonCompileable() const { return true; }
@@ -505,7 +569,7 @@ class BaselineInterpreterGenerator final : private BaselineInterpreterCodeGen {
   uint32_t debugTrapHandlerOffset_ = 0;
 
  public:
-  explicit BaselineInterpreterGenerator(JSContext* cx, TempAllocator& alloc);
+  BaselineInterpreterGenerator(JSContext* cx, MacroAssembler& masm);
 
   [[nodiscard]] bool generate(BaselineInterpreter& interpreter);
 
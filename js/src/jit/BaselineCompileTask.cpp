@@ -0,0 +1,269 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "jit/BaselineCompileTask.h"
+
+#include "gc/GC.h"
+#include "jit/BaselineJIT.h"
+#include "jit/CompileWrappers.h"
+#include "jit/Ion.h"
+#include "jit/JitRuntime.h"
+#include "jit/JitScript.h"
+#include "jit/JitSpewer.h"
+#include "vm/HelperThreadState.h"
+#include "vm/JSContext.h"
+#include "vm/JSScript.h"
+#include "vm/Realm.h"
+#include "vm/Time.h"
+
+#include "vm/GeckoProfiler-inl.h"
+#include "vm/JSScript-inl.h"
+#include "vm/Realm-inl.h"
+
+using mozilla::TimeDuration;
+using mozilla::TimeStamp;
+
+using namespace js;
+using namespace js::jit;
+
+BaselineCompileTask::BaselineCompileTask(JSRuntime* runtime)
+    : runtime_(runtime),
+      lifo_(TempAllocator::PreferredLifoChunkSize),
+      alloc_(&lifo_) {}
+
+bool BaselineCompileTask::addScript(BaselineSnapshot&& snapshot) {
+  MOZ_ASSERT(!submitted_);
+
+  auto entry = MakeUnique<Entry>(std::move(snapshot));
+  if (!entry || !entries_.append(std::move(entry))) {
+    return false;
+  }
+
+  JSScript* script = entries_.back()->snapshot.script();
+  script->jitScript()->setIsBaselineCompilingOffThread();
+  return true;
+}
+
+size_t BaselineCompileTask::sizeOfExcludingThis(
+    mozilla::MallocSizeOf mallocSizeOf) const {
+  size_t result = lifo_.sizeOfExcludingThis(mallocSizeOf) +
+                  entries_.sizeOfExcludingThis(mallocSizeOf);
+  for (const UniquePtr<Entry>& entry : entries_) {
+    result += mallocSizeOf(entry.get());
+    if (entry->masm) {
+      result += entry->masm->bytesNeeded();
+    }
+  }
+  return result;
+}
+
+void BaselineCompileTask::runHelperThreadTask(
+    AutoLockHelperThreadState& locked) {
+  {
+    AutoUnlockHelperThreadState unlock(locked);
+    runTask();
+  }
+
+  FinishOffThreadBaselineCompile(this, locked);
+
+  // Ping the main thread so that the code can be linked at the next interrupt
+  // callback. As for Ion compilations, this must happen before the current
+  // task is reset, see IonCompileTask::runHelperThreadTask.
+  runtime_->mainContextFromAnyThread()->requestInterrupt(
+      InterruptReason::AttachBaselineCompilations);
+}
+
+void BaselineCompileTask::runTask() {
+  JitContext jctx(CompileRuntime::get(runtime_));
+  AutoEnterIonBackend enter;
+
+  for (UniquePtr<Entry>& entry : entries_) {
+    if (cancelled_) {
+      break;
+    }
+
+    TimeStamp start = TimeStamp::Now();
+
+    JSScript* script = entry->snapshot.script();
+    entry->masm.emplace(alloc_, CompileRealm::get(script->realm()));
+    entry->compiler.emplace(/* cx = */ nullptr, *entry->masm, alloc_,
+                            entry->snapshot);
+    if (entry->compiler->init()) {
+      entry->status = entry->compiler->compileOffThread();
+    } else {
+      entry->status = Method_Error;
+    }
+
+    entry->compileTime = TimeStamp::Now() - start;
+  }
+}
+
+void BaselineCompileTask::link(JSContext* cx) {
+  MOZ_ASSERT(cx->runtime() == runtime_);
+
+  BaselineOffThreadStats& stats =
+      runtime_->jitRuntime()->baselineOffThreadStats();
+  stats.batches++;
+
+  for (UniquePtr<Entry>& entry : entries_) {
+    JSScript* script = entry->snapshot.script();
+    script->jitScript()->clearIsBaselineCompilingOffThread();
+
+    // Scripts which haven't been compiled, or ran out of memory, are compiled
+    // again when they get warm.
+    if (entry->status == Method_CantCompile) {
+      if (script->canBaselineCompile() && !script->hasBaselineScript()) {
+        script->disableBaselineCompile();
+      }
+      continue;
+    }
+    if (entry->status != Method_Compiled) {
+      continue;
+    }
+
+    if (!entry->snapshot.isStillValid(cx)) {
+      JitSpew(JitSpew_BaselineScripts,
+              "Discarding off thread Baseline code for %s:%u:%u",
+              script->filename(), script->lineno(), script->column());
+      stats.discarded++;
+      continue;
+    }
+
+    AutoRealm ar(cx, script);
+    AutoIncrementalTimer timer(cx->realm()->timers.baselineCompileTime);
+    JitContext jctx(cx);
+
+    TimeStamp start = TimeStamp::Now();
+    if (entry->compiler->link(cx) != Method_Compiled) {
+      // Silently ignore OOM when linking, as LinkIonScript does.
+      cx->clearPendingException();
+      continue;
+    }
+
+    stats.scripts++;
+    stats.compileTime += entry->compileTime;
+    stats.linkTime += TimeStamp::Now() - start;
+  }
+}
+
+void jit::DiscardBaselineCompileTask(BaselineCompileTask* task) {
+  task->removeScripts([](JSScript*) { return true; });
+  js_delete(task);
+}
+
+bool jit::OffThreadBaselineCompilationAvailable(JSContext* cx) {
+  // Compile eagerly on the main thread when the warm-up threshold is zero, as
+  // the script is run right away. Incremental GCs cancel off-thread
+  // compilations at the start of sweeping, so don't start new ones.
+  return JitOptions.baselineOffThreadCompile &&
+         JitOptions.baselineJitWarmUpThreshold > 0 &&
+         OffThreadCompilationAvailable(cx) &&
+         !cx->runtime()->gc.isIncrementalGCInProgress();
+}
+
+static bool SubmitPendingBaselineBatch(JSRuntime* rt,
+                                       const AutoLockHelperThreadState& lock) {
+  JitRuntime* jrt = rt->jitRuntime();
+  BaselineCompileTask*& batch = jrt->pendingBaselineBatch();
+  if (!batch || jrt->numBaselineBatchesInFlight()) {
+    return true;
+  }
+
+  if (!StartOffThreadBaselineCompile(batch, lock)) {
+    return false;
+  }
+
+  batch->setSubmitted();
+  batch = nullptr;
+  jrt->numBaselineBatchesInFlight()++;
+  return true;
+}
+
+MethodStatus jit::BaselineCompileOffThread(JSContext* cx, JSScript* script) {
+  cx->check(script);
+  MOZ_ASSERT(!script->hasBaselineScript());
+  MOZ_ASSERT(!script->isBaselineCompilingOffThread());
+  MOZ_ASSERT(OffThreadBaselineCompilationAvailable(cx));
+  AutoGeckoProfilerEntry pseudoFrame(
+      cx, "Baseline script compilation",
+      JS::ProfilingCategoryPair::JS_BaselineCompilation);
+
+  AutoIncrementalTimer timer(cx->realm()->timers.baselineCompileTime);
+
+  BaselineSnapshot snapshot(script);
+  if (!snapshot.init(cx, /* forceDebugInstrumentation = */ false)) {
+    return Method_Error;
+  }
+
+  JitRuntime* jrt = cx->runtime()->jitRuntime();
+  BaselineCompileTask*& batch = jrt->pendingBaselineBatch();
+  if (!snapshot.canCompileOffThread(cx) ||
+      (batch && batch->numScripts() >= JitOptions.baselineOffThreadBatchSize)) {
+    return BaselineCompile(cx, snapshot);
+  }
+
+  if (!batch) {
+    batch = cx->new_<BaselineCompileTask>(cx->runtime());
+    if (!batch) {
+      return Method_Error;
+    }
+  }
+  if (!batch->addScript(std::move(snapshot))) {
+    ReportOutOfMemory(cx);
+    return Method_Error;
+  }
+
+  AutoLockHelperThreadState lock;
+  if (!SubmitPendingBaselineBatch(cx->runtime(), lock)) {
+    DiscardBaselineCompileTask(batch);
+    batch = nullptr;
+    ReportOutOfMemory(cx);
+    return Method_Error;
+  }
+
+  return Method_Skipped;
+}
+
+static BaselineCompileTask* TakeFinishedBaselineTask(
+    JSRuntime* rt, AutoLockHelperThreadState& lock) {
+  GlobalHelperThreadState::BaselineCompileTaskVector& finished =
+      HelperThreadState().baselineFinishedList(lock);
+  for (size_t i = 0; i < finished.length(); i++) {
+    BaselineCompileTask* task = finished[i];
+    if (task->runtime() == rt) {
+      HelperThreadState().remove(finished, &i);
+      rt->jitRuntime()->numFinishedBaselineTasksRef(lock)--;
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void jit::AttachFinishedBaselineCompilations(JSContext* cx) {
+  JSRuntime* rt = cx->runtime();
+  MOZ_ASSERT(CurrentThreadCanAccessRuntime(rt));
+
+  if (!rt->jitRuntime() || !rt->jitRuntime()->numFinishedBaselineTasks()) {
+    return;
+  }
+
+  JitRuntime* jrt = rt->jitRuntime();
+  AutoLockHelperThreadState lock;
+
+  while (BaselineCompileTask* task = TakeFinishedBaselineTask(rt, lock)) {
+    AutoUnlockHelperThreadState unlock(lock);
+    task->link(cx);
+    js_delete(task);
+    jrt->numBaselineBatchesInFlight()--;
+  }
+
+  // The scripts which got warm in the meantime can now be compiled. If the
+  // batch can't be submitted they are compiled again later.
+  if (!SubmitPendingBaselineBatch(rt, lock)) {
+    DiscardBaselineCompileTask(jrt->pendingBaselineBatch());
+    jrt->pendingBaselineBatch() = nullptr;
+  }
+}
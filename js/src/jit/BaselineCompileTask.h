@@ -0,0 +1,129 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef jit_BaselineCompileTask_h
+#define jit_BaselineCompileTask_h
+
+#include "mozilla/Atomics.h"
+#include "mozilla/Maybe.h"
+#include "mozilla/TimeStamp.h"
+
+#include "ds/LifoAlloc.h"
+#include "jit/BaselineCodeGen.h"
+#include "jit/JitAllocPolicy.h"
+#include "jit/JitScript.h"
+#include "js/UniquePtr.h"
+#include "js/Utility.h"
+#include "js/Vector.h"
+#include "vm/HelperThreadTask.h"
+#include "vm/JSScript.h"
+
+struct JS_PUBLIC_API JSContext;
+
+namespace js {
+namespace jit {
+
+// BaselineCompileTask generates the Baseline code for a batch of scripts on a
+// helper thread.
+//
+// Scripts which get warm are added to the runtime's pending batch while
+// another batch is being compiled, and keep running in the interpreter. The
+// pending batch is submitted when the previous one has been linked, so the
+// batches grow with the number of scripts warming up at the same time.
+//
+// The VM state baked into the code is looked up on the main thread when a
+// script is added, see BaselineSnapshot. GC cancels the compilations of the
+// zones it collects, so the snapshots are not traced.
+class BaselineCompileTask final : public HelperThreadTask {
+  struct Entry {
+    explicit Entry(BaselineSnapshot&& snapshot)
+        : snapshot(std::move(snapshot)) {}
+
+    BaselineSnapshot snapshot;
+    mozilla::Maybe<IonHeapMacroAssembler> masm;
+    mozilla::Maybe<BaselineCompiler> compiler;
+
+    // Method_Skipped if the script hasn't been compiled.
+    MethodStatus status = Method_Skipped;
+    mozilla::TimeDuration compileTime;
+  };
+
+  JSRuntime* runtime_;
+  LifoAlloc lifo_;
+  TempAllocator alloc_;
+  Vector<UniquePtr<Entry>, 0, SystemAllocPolicy> entries_;
+
+  // Set by CancelOffThreadBaselineCompile. The scripts which haven't been
+  // compiled yet are skipped.
+  mozilla::Atomic<bool, mozilla::ReleaseAcquire> cancelled_{false};
+
+  // Whether the batch has been submitted to the helper threads.
+  bool submitted_ = false;
+
+ public:
+  explicit BaselineCompileTask(JSRuntime* runtime);
+
+  JSRuntime* runtime() const { return runtime_; }
+  size_t numScripts() const { return entries_.length(); }
+  JSScript* script(size_t i) const { return entries_[i]->snapshot.script(); }
+
+  void setSubmitted() { submitted_ = true; }
+
+  // Adds the script of |snapshot| to the batch, and marks it as being compiled
+  // off thread. Returns false on OOM, without reporting it.
+  [[nodiscard]] bool addScript(BaselineSnapshot&& snapshot);
+
+  // Drops the scripts matching |matches| and clears their flag.
+  template <typename Predicate>
+  void removeScripts(Predicate matches);
+
+  void cancel() { cancelled_ = true; }
+
+  size_t sizeOfExcludingThis(mozilla::MallocSizeOf mallocSizeOf) const;
+
+  ThreadType threadType() override { return THREAD_TYPE_BASELINE; }
+  void runTask();
+  void runHelperThreadTask(AutoLockHelperThreadState& locked) override;
+
+  // Links the generated code on the main thread, unless the script changed in
+  // a way the code didn't expect.
+  void link(JSContext* cx);
+};
+
+template <typename Predicate>
+void BaselineCompileTask::removeScripts(Predicate matches) {
+  for (size_t i = 0; i < entries_.length(); i++) {
+    JSScript* script = entries_[i]->snapshot.script();
+    if (!matches(script)) {
+      continue;
+    }
+    script->jitScript()->clearIsBaselineCompilingOffThread();
+    entries_.erase(&entries_[i]);
+    i--;
+  }
+}
+
+// Whether scripts which get warm can be compiled off thread.
+bool OffThreadBaselineCompilationAvailable(JSContext* cx);
+
+// Adds |script| to the pending batch of its runtime, and submits the batch if
+// no other batch is being compiled. Returns Method_Skipped if the script keeps
+// running in the interpreter until its code is linked. Scripts which can't be
+// compiled off thread, e.g. because the batch is full, are compiled on the
+// main thread.
+MethodStatus BaselineCompileOffThread(JSContext* cx, JSScript* script);
+
+// Links the batches which have been compiled off thread, and submits the
+// pending batch.
+void AttachFinishedBaselineCompilations(JSContext* cx);
+
+// Deletes |task|, clearing the flags of the scripts it still holds.
+void DiscardBaselineCompileTask(BaselineCompileTask* task);
+
+}  // namespace jit
+}  // namespace js
+
+#endif /* jit_BaselineCompileTask_h */
@@ -18,6 +18,7 @@
 #include "gc/PublicIterators.h"
 #include "jit/AutoWritableJitCode.h"
 #include "jit/BaselineCodeGen.h"
+#include "jit/BaselineCompileTask.h"
 #include "jit/BaselineIC.h"
 #include "jit/CalleeToken.h"
 #include "jit/JitCommon.h"
@@ -25,7 +26,9 @@
 #include "jit/JitSpewer.h"
 #include "jit/MacroAssembler.h"
 #include "js/friend/StackLimits.h"  // js::AutoCheckRecursionLimit
+#include "vm/HelperThreads.h"
 #include "vm/Interpreter.h"
+#include "vm/Time.h"
 
 #include "debugger/DebugAPI-inl.h"
 #include "gc/GC-inl.h"
@@ -214,19 +217,36 @@ MethodStatus jit::BaselineCompile(JSContext* cx, JSScript* script,
       cx, "Baseline script compilation",
       JS::ProfilingCategoryPair::JS_BaselineCompilation);
 
+  // The code compiled off thread would be thrown away.
+  if (script->isBaselineCompilingOffThread()) {
+    CancelOffThreadBaselineCompile(script);
+  }
+
+  AutoIncrementalTimer timer(cx->realm()->timers.baselineCompileTime);
+
+  BaselineSnapshot snapshot(script);
+  if (!snapshot.init(cx, forceDebugInstrumentation)) {
+    return Method_Error;
+  }
+
+  return BaselineCompile(cx, snapshot);
+}
+
+MethodStatus jit::BaselineCompile(JSContext* cx,
+                                  const BaselineSnapshot& snapshot) {
+  JSScript* script = snapshot.script();
+  MOZ_ASSERT(!script->isBaselineCompilingOffThread());
+
   TempAllocator temp(&cx->tempLifoAlloc());
   JitContext jctx(cx);
+  StackMacroAssembler masm(cx, temp);
 
-  BaselineCompiler compiler(cx, temp, script);
+  BaselineCompiler compiler(cx, masm, temp, snapshot);
   if (!compiler.init()) {
     ReportOutOfMemory(cx);
     return Method_Error;
   }
 
-  if (forceDebugInstrumentation) {
-    compiler.setCompileDebugInstrumentation();
-  }
-
   MethodStatus status = compiler.compile();
 
   MOZ_ASSERT_IF(status == Method_Compiled, script->hasBaselineScript());
@@ -290,6 +310,18 @@ static MethodStatus CanEnterBaselineJIT(JSContext* cx, HandleScript script,
     return Method_Compiled;
   }
 
+  // Frames can be marked as debuggee frames independently of its underlying
+  // script being a debuggee script, e.g., when performing
+  // Debugger.Frame.prototype.eval.
+  bool forceDebugInstrumentation =
+      osrSourceFrame && osrSourceFrame.isDebuggee();
+
+  // Keep running the script in the interpreter until the code compiled off
+  // thread has been linked.
+  if (script->isBaselineCompilingOffThread() && !forceDebugInstrumentation) {
+    return Method_Skipped;
+  }
+
   // Check script warm-up counter.
   if (script->getWarmUpCount() <= JitOptions.baselineJitWarmUpThreshold) {
     return Method_Skipped;
@@ -310,11 +342,10 @@ static MethodStatus CanEnterBaselineJIT(JSContext* cx, HandleScript script,
     return Method_CantCompile;
   }
 
-  // Frames can be marked as debuggee frames independently of its underlying
-  // script being a debuggee script, e.g., when performing
-  // Debugger.Frame.prototype.eval.
-  bool forceDebugInstrumentation =
-      osrSourceFrame && osrSourceFrame.isDebuggee();
+  if (!forceDebugInstrumentation &&
+      OffThreadBaselineCompilationAvailable(cx)) {
+    return BaselineCompileOffThread(cx, script);
+  }
   return BaselineCompile(cx, script, forceDebugInstrumentation);
 }
 
@@ -948,7 +979,8 @@ bool jit::GenerateBaselineInterpreter(JSContext* cx,
                                       BaselineInterpreter& interpreter) {
   if (IsBaselineInterpreterEnabled()) {
     TempAllocator temp(&cx->tempLifoAlloc());
-    BaselineInterpreterGenerator generator(cx, temp);
+    StackMacroAssembler masm(cx, temp);
+    BaselineInterpreterGenerator generator(cx, masm);
     return generator.generate(interpreter);
   }
 
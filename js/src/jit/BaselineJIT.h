@@ -12,6 +12,7 @@
 #include "mozilla/Maybe.h"
 #include "mozilla/MemoryReporting.h"
 #include "mozilla/Span.h"
+#include "mozilla/TimeStamp.h"
 
 #include <stddef.h>
 #include <stdint.h>
@@ -38,6 +39,7 @@ class RunState;
 namespace jit {
 
 class BaselineFrame;
+class BaselineSnapshot;
 class ExceptionBailoutInfo;
 class IonCompileTask;
 class JitActivation;
@@ -449,6 +451,25 @@ enum class BailoutReason {
 MethodStatus BaselineCompile(JSContext* cx, JSScript* script,
                              bool forceDebugInstrumentation = false);
 
+// Compiles the script of |snapshot| on the main thread.
+MethodStatus BaselineCompile(JSContext* cx, const BaselineSnapshot& snapshot);
+
+// Counters for the Baseline compilations of a runtime which ran off thread.
+struct BaselineOffThreadStats {
+  // Scripts and batches compiled off thread and linked.
+  uint64_t scripts = 0;
+  uint64_t batches = 0;
+
+  // Scripts compiled off thread whose code was thrown away because the
+  // script changed before it could be linked.
+  uint64_t discarded = 0;
+
+  // Time spent generating code on helper threads, which the main thread used
+  // to spend, and time spent linking it on the main thread.
+  mozilla::TimeDuration compileTime;
+  mozilla::TimeDuration linkTime;
+};
+
 // Class storing the generated Baseline Interpreter code for the runtime.
 class BaselineInterpreter {
  public:
@@ -72,6 +72,14 @@ const void* CompileRuntime::addressOfInterruptBits() {
   return runtime()->mainContextFromAnyThread()->addressOfInterruptBits();
 }
 
+const void* CompileRuntime::addressOfInlinedICScript() {
+  return runtime()->mainContextFromAnyThread()->addressOfInlinedICScript();
+}
+
+const void* CompileRuntime::addressOfJitActivation() {
+  return &runtime()->mainContextFromAnyThread()->jitActivation;
+}
+
 const void* CompileRuntime::addressOfZone() {
   return runtime()->mainContextFromAnyThread()->addressOfZone();
 }
@@ -78,6 +78,8 @@ class CompileRuntime {
   const void* mainContextPtr();
   const void* addressOfJitStackLimit();
   const void* addressOfInterruptBits();
+  const void* addressOfInlinedICScript();
+  const void* addressOfJitActivation();
   const void* addressOfZone();
   const void* addressOfMegamorphicCache();
   const void* addressOfMegamorphicSetPropCache();
@@ -83,6 +83,9 @@ using namespace js::jit;
 
 JitRuntime::~JitRuntime() {
   MOZ_ASSERT(numFinishedOffThreadTasks_ == 0);
+  MOZ_ASSERT(numFinishedBaselineTasks_ == 0);
+  MOZ_ASSERT(!pendingBaselineBatch_.ref());
+  MOZ_ASSERT(numBaselineBatchesInFlight_ == 0);
   MOZ_ASSERT(ionLazyLinkListSize_ == 0);
   MOZ_ASSERT(ionLazyLinkList_.ref().isEmpty());
 
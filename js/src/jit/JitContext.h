@@ -101,7 +101,7 @@ class MOZ_RAII JitContext {
   // Constructor for compilations happening on the main thread.
   explicit JitContext(JSContext* cx);
 
-  // Constructor for off-thread Ion compilations.
+  // Constructor for off-thread Ion and Baseline compilations.
   explicit JitContext(CompileRuntime* rt);
 
   // Constructor for Wasm compilation.
@@ -167,6 +167,16 @@ DefaultJitOptions::DefaultJitOptions() {
   // Duplicated in all.js - ensure both match.
   SET_DEFAULT(baselineJitWarmUpThreshold, 100);
 
+  // Whether scripts which get warm are compiled with the baseline compiler on
+  // helper threads, in batches, while they keep running in the interpreter.
+  // Off until devtools/bench/baseline-offthread.js shows it pays off.
+  SET_DEFAULT(baselineOffThreadCompile, false);
+
+  // How many scripts can wait for the previous batch of off-thread baseline
+  // compilations to be linked. Scripts getting warm when the batch is full
+  // are compiled on the main thread.
+  SET_DEFAULT(baselineOffThreadBatchSize, 100);
+
   // How many invocations or loop iterations are needed before functions
   // are considered for trial inlining.
   SET_DEFAULT(trialInliningWarmUpThreshold, 500);
@@ -297,6 +307,10 @@ DefaultJitOptions::DefaultJitOptions() {
   // as well as the transition from one tier to the other.
   SET_DEFAULT(wasmDelayTier2, false);
 
+  // Controls whether wasm modules are only validated up front, with the
+  // baseline code of each function compiled the first time it is called.
+  SET_DEFAULT(wasmLazyCompile, false);
+
   // Until which wasm bytecode size should we accumulate functions, in order
   // to compile efficiently on helper threads. Baseline code compiles much
   // faster than Ion code so use scaled thresholds (see also bug 1320374).
@@ -71,8 +71,10 @@ struct DefaultJitOptions {
   bool fullDebugChecks;
   bool limitScriptSize;
   bool osr;
+  bool baselineOffThreadCompile;
   bool wasmFoldOffsets;
   bool wasmDelayTier2;
+  bool wasmLazyCompile;
   bool lessDebugCode;
   bool enableWatchtowerMegamorphic;
   bool enableWasmJitExit;
@@ -84,6 +86,7 @@ struct DefaultJitOptions {
 #endif
   uint32_t baselineInterpreterWarmUpThreshold;
   uint32_t baselineJitWarmUpThreshold;
+  uint32_t baselineOffThreadBatchSize;
   uint32_t trialInliningWarmUpThreshold;
   uint32_t trialInliningInitialWarmUpCount;
   uint32_t normalIonWarmUpThreshold;
@@ -43,6 +43,7 @@ class GCMarker;
 
 namespace jit {
 
+class BaselineCompileTask;
 class FrameSizeClass;
 class JitRealm;
 class Label;
@@ -215,6 +216,19 @@ class JitRuntime {
   MainThreadData<IonCompileTaskList> ionLazyLinkList_;
   MainThreadData<size_t> ionLazyLinkListSize_{0};
 
+  // Batch of scripts waiting to be Baseline compiled off thread, and the
+  // number of batches which have been submitted and not linked yet. See
+  // BaselineCompileTask.
+  MainThreadData<BaselineCompileTask*> pendingBaselineBatch_{nullptr};
+  MainThreadData<size_t> numBaselineBatchesInFlight_{0};
+
+  // Number of Baseline batches which were finished off thread and are waiting
+  // to be linked. Like numFinishedOffThreadTasks_, this is only set while
+  // holding the helper thread state lock.
+  NumFinishedOffThreadTasksType numFinishedBaselineTasks_{0};
+
+  MainThreadData<BaselineOffThreadStats> baselineOffThreadStats_;
+
 #ifdef DEBUG
   // Flag that can be set from JIT code to indicate it's invalid to call
   // arbitrary JS code in a particular region. This is checked in RunScript.
@@ -299,6 +313,9 @@ class JitRuntime {
   JitCode* debugTrapHandler(JSContext* cx, DebugTrapHandlerKind kind);
 
   BaselineInterpreter& baselineInterpreter() { return baselineInterpreter_; }
+  const BaselineInterpreter& baselineInterpreter() const {
+    return baselineInterpreter_;
+  }
 
   TrampolinePtr getGenericBailoutHandler() const {
     return trampolineCode(bailoutHandlerOffset_);
@@ -403,6 +420,23 @@ class JitRuntime {
 
   IonCompileTaskList& ionLazyLinkList(JSRuntime* rt);
 
+  BaselineCompileTask*& pendingBaselineBatch() {
+    return pendingBaselineBatch_.ref();
+  }
+  size_t& numBaselineBatchesInFlight() {
+    return numBaselineBatchesInFlight_.ref();
+  }
+
+  size_t numFinishedBaselineTasks() const { return numFinishedBaselineTasks_; }
+  NumFinishedOffThreadTasksType& numFinishedBaselineTasksRef(
+      const AutoLockHelperThreadState& locked) {
+    return numFinishedBaselineTasks_;
+  }
+
+  BaselineOffThreadStats& baselineOffThreadStats() {
+    return baselineOffThreadStats_.ref();
+  }
+
   size_t ionLazyLinkListSize() const { return ionLazyLinkListSize_; }
 
   void ionLazyLinkListRemove(JSRuntime* rt, js::jit::IonCompileTask* task);
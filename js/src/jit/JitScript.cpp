@@ -145,6 +145,7 @@ void JSScript::releaseJitScript(JS::GCContext* gcx) {
   MOZ_ASSERT(hasJitScript());
   MOZ_ASSERT(!hasBaselineScript());
   MOZ_ASSERT(!hasIonScript());
+  MOZ_ASSERT(!jitScript()->isBaselineCompilingOffThread());
 
   gcx->removeCellMemory(this, jitScript()->allocBytes(), MemoryUse::JitScript);
 
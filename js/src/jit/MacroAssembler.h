@@ -5483,8 +5483,8 @@ class MOZ_RAII WasmMacroAssembler : public MacroAssembler {
   ~WasmMacroAssembler() { assertNoGCThings(); }
 };
 
-// Heap-allocated MacroAssembler used for Ion off-thread code generation.
-// GC cancels off-thread compilations.
+// Heap-allocated MacroAssembler used for off-thread Ion and Baseline code
+// generation. GC cancels off-thread compilations.
 class IonHeapMacroAssembler : public MacroAssembler {
  public:
   IonHeapMacroAssembler(TempAllocator& alloc, CompileRealm* realm);
@@ -608,6 +608,7 @@ class MOZ_RAII WarpPoppedValueUseChecker {
       case JSOp::Swap:
       case JSOp::SetArg:
       case JSOp::SetLocal:
+      case JSOp::SetLocalPop:
       case JSOp::InitLexical:
       case JSOp::SetRval:
       case JSOp::Void:
@@ -944,6 +945,16 @@ bool WarpBuilder::build_SetLocal(BytecodeLocation loc) {
   return true;
 }
 
+bool WarpBuilder::build_GetLocalPair(BytecodeLocation loc) {
+  return build_GetLocal(loc) && build_GetLocal(loc.superinstructionSecond());
+}
+
+bool WarpBuilder::build_SetLocalPop(BytecodeLocation loc) {
+  current->setLocal(loc.local());
+  current->pop();
+  return true;
+}
+
 bool WarpBuilder::build_InitLexical(BytecodeLocation loc) {
   current->setLocal(loc.local());
   return true;
@@ -962,6 +973,10 @@ bool WarpBuilder::build_GetArg(BytecodeLocation loc) {
   return true;
 }
 
+bool WarpBuilder::build_GetArgPair(BytecodeLocation loc) {
+  return build_GetArg(loc) && build_GetArg(loc.superinstructionSecond());
+}
+
 bool WarpBuilder::build_SetArg(BytecodeLocation loc) {
   MOZ_ASSERT(script_->jitScript()->modifiesArguments());
 
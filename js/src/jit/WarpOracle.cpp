@@ -612,9 +612,12 @@ AbortReasonOr<WarpScriptSnapshot*> WarpScriptOracle::createScriptSnapshot() {
       case JSOp::Pick:
       case JSOp::Unpick:
       case JSOp::GetLocal:
+      case JSOp::GetLocalPair:
       case JSOp::SetLocal:
+      case JSOp::SetLocalPop:
       case JSOp::InitLexical:
       case JSOp::GetArg:
+      case JSOp::GetArgPair:
       case JSOp::SetArg:
       case JSOp::JumpTarget:
       case JSOp::LoopHead:
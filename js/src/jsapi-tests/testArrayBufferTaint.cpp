@@ -0,0 +1,50 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "jsapi.h"
+
+#include "js/ArrayBuffer.h"  // JS::{DetachArrayBuffer,NewArrayBuffer}
+#include "js/experimental/TypedData.h"  // JS_NewUint8ArrayWithBuffer
+#include "js/PropertyAndElement.h"      // JS_SetProperty
+#include "jsapi-tests/tests.h"
+
+// TaintFox: byte granular taint of array buffers and views.
+BEGIN_TEST(testArrayBufferTaint) {
+  TaintFlow flow(TaintOperation("source"));
+
+  JS::RootedObject buffer(cx, JS::NewArrayBuffer(cx, 64));
+  CHECK(buffer);
+  CHECK(!JS_GetArrayBufferOrViewTaint(buffer).hasTaint());
+
+  // Taint bytes [8, 16) through a view starting at byte 4.
+  JS::RootedObject view(cx, JS_NewUint8ArrayWithBuffer(cx, buffer, 4, 32));
+  CHECK(view);
+  CHECK(JS_SetArrayBufferOrViewTaint(cx, view, SafeStringTaint(4, 12, flow)));
+
+  SafeStringTaint taint = JS_GetArrayBufferOrViewTaint(buffer);
+  CHECK(!taint.at(7));
+  CHECK(taint.at(8));
+  CHECK(taint.at(15));
+  CHECK(!taint.at(16));
+
+  // ArrayBuffer.prototype.slice copies the taint of the copied bytes.
+  JS::RootedValue v(cx, JS::ObjectValue(*buffer));
+  CHECK(JS_SetProperty(cx, global, "buf", v));
+  EVAL("buf.slice(12)", &v);
+  taint = JS_GetArrayBufferOrViewTaint(&v.toObject());
+  CHECK(taint.at(0));
+  CHECK(taint.at(3));
+  CHECK(!taint.at(4));
+
+  // Detaching removes all taint.
+  CHECK(JS::DetachArrayBuffer(cx, buffer));
+  CHECK(!JS_GetArrayBufferOrViewTaint(buffer).hasTaint());
+
+  return true;
+}
+END_TEST(testArrayBufferTaint)
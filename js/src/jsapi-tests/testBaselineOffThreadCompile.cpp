@@ -0,0 +1,123 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "jit/BaselineCompileTask.h"
+#include "jit/BaselineJIT.h"
+#include "jit/JitOptions.h"
+#include "jit/JitRuntime.h"
+#include "jsapi-tests/tests.h"
+#include "vm/HelperThreads.h"
+#include "vm/Runtime.h"
+
+// Sets the Baseline JIT options for the duration of a test.
+class AutoBaselineOffThreadOptions {
+  bool offThread_;
+  uint32_t warmUpThreshold_;
+
+ public:
+  explicit AutoBaselineOffThreadOptions(bool offThread)
+      : offThread_(js::jit::JitOptions.baselineOffThreadCompile),
+        warmUpThreshold_(js::jit::JitOptions.baselineJitWarmUpThreshold) {
+    js::jit::JitOptions.baselineOffThreadCompile = offThread;
+    js::jit::JitOptions.baselineJitWarmUpThreshold = 10;
+  }
+  ~AutoBaselineOffThreadOptions() {
+    js::jit::JitOptions.baselineOffThreadCompile = offThread_;
+    js::jit::JitOptions.baselineJitWarmUpThreshold = warmUpThreshold_;
+  }
+};
+
+// Wait for the batches compiled on helper threads and link them, until no
+// script is waiting for its code.
+static void AttachAllBaselineCompilations(JSContext* cx) {
+  js::jit::JitRuntime* jrt = cx->runtime()->jitRuntime();
+  while (jrt && jrt->numBaselineBatchesInFlight()) {
+    js::WaitForAllHelperThreads();
+    js::jit::AttachFinishedBaselineCompilations(cx);
+  }
+}
+
+BEGIN_TEST(testBaselineOffThreadCompile) {
+  AutoBaselineOffThreadOptions options(true);
+  if (!js::jit::IsBaselineJitEnabled(cx) ||
+      !js::jit::OffThreadBaselineCompilationAvailable(cx)) {
+    return true;
+  }
+
+  // Warm up many scripts at the same time, so that they are compiled in a
+  // few batches while they keep running in the interpreter.
+  JS::RootedValue v(cx);
+  EVAL(
+      "var fs = [];"
+      "for (var i = 0; i < 200; i++) {"
+      "  fs.push(new Function('x', 'var s = 0;'"
+      "                       + 'for (var j = 0; j < x; j++) s += j * ' + i + ';'"
+      "                       + 'return s;'));"
+      "}"
+      "function run() {"
+      "  var sum = 0;"
+      "  for (var n = 0; n < 20; n++) {"
+      "    for (var i = 0; i < fs.length; i++) sum += fs[i](3);"
+      "  }"
+      "  return sum;"
+      "}"
+      "run()",
+      &v);
+  // sum(3 * i for i < 200) * 20 runs.
+  CHECK(v.isNumber());
+  CHECK_EQUAL(v.toNumber(), 1194000.0);
+
+  js::jit::BaselineOffThreadStats before =
+      cx->runtime()->jitRuntime()->baselineOffThreadStats();
+  AttachAllBaselineCompilations(cx);
+  js::jit::BaselineOffThreadStats& after =
+      cx->runtime()->jitRuntime()->baselineOffThreadStats();
+  CHECK(after.batches > before.batches);
+  CHECK(after.scripts >= before.scripts + 100);
+  CHECK(after.batches - before.batches < after.scripts - before.scripts);
+
+  // The linked code computes the same results.
+  EVAL("run()", &v);
+  CHECK_EQUAL(v.toNumber(), 1194000.0);
+
+  // TaintFox: the taint checks of the IC stubs the code calls still run.
+  EVAL(
+      "function tail(s) { return s.substring(1) + s.charAt(0); }"
+      "var tainted = String.tainted('abc');"
+      "var ok = true;"
+      "for (var i = 0; i < 100; i++) {"
+      "  ok = ok && tail(tainted).taint.length > 0 && tail('abc').taint.length === 0;"
+      "}"
+      "ok",
+      &v);
+  CHECK(v.isTrue());
+  AttachAllBaselineCompilations(cx);
+  EVAL(
+      "tail(tainted) === 'bca' && tail(tainted).taint.length > 0 &&"
+      " tail('abc').taint.length === 0",
+      &v);
+  CHECK(v.isTrue());
+
+  // GCs cancel the compilations of the scripts they may move or collect, and
+  // the scripts are compiled again when they run.
+  EVAL(
+      "var gs = [];"
+      "for (var i = 0; i < 50; i++) gs.push(new Function('return ' + i + ';'));"
+      "for (var n = 0; n < 20; n++) gs.forEach(g => g());",
+      &v);
+  JS_GC(cx);
+  EVAL(
+      "var total = 0;"
+      "for (var n = 0; n < 20; n++) gs.forEach(g => { total += g(); });"
+      "total",
+      &v);
+  AttachAllBaselineCompilations(cx);
+  CHECK_EQUAL(v.toNumber(), 24500.0);
+
+  return true;
+}
+END_TEST(testBaselineOffThreadCompile)
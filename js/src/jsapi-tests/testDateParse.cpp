@@ -0,0 +1,178 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mozilla/FloatingPoint.h"
+#include "mozilla/XorShift128PlusRNG.h"
+
+#include <iterator>
+#include <stdio.h>
+#include <string.h>
+
+#include "jsdate.h"
+
+#include "js/Date.h"
+#include "jsapi-tests/tests.h"
+#include "vm/Realm.h"
+#include "vm/StringType.h"
+
+using mozilla::NumbersAreIdentical;
+
+static JSLinearString* NewLinearString(JSContext* cx, const char* chars) {
+  JSString* str = JS_NewStringCopyZ(cx, chars);
+  return str ? str->ensureLinear(cx) : nullptr;
+}
+
+// Compare Date.parse, which tries the parsers for common formats first, with
+// the general date parser on random variations of those formats.
+BEGIN_TEST(testDateParse_differential) {
+  static const char* const days[] = {"Mon", "Tue",      "Wed",  "Thu", "Fri",
+                                     "Sat", "Sun",      "tue",  "SUN", "Tues",
+                                     "Mo",  "Thursday", "Xyz"};
+  static const char* const months[] = {
+      "Jan", "Feb", "Mar",  "Apr", "May",  "Jun", "Jul", "Aug", "Sep",
+      "Oct", "Nov", "Dec",  "jan", "DEC",  "Sept", "June", "Ma", "Foo"};
+  static const char* const zones[] = {"GMT", "UT",  "UTC", "Z",  "EST",
+                                      "PDT", "gmt", "GM",  "UTCX", ""};
+  static const char mutations[] = " ,:+-()/.0123456789GMTUZadnovT";
+
+  mozilla::non_crypto::XorShift128PlusRNG rng(0x1234567, 0x89abcdef);
+  auto random = [&](uint64_t n) { return rng.next() % n; };
+  auto pick = [&](const auto& list) { return list[random(std::size(list))]; };
+  auto number = [&](char* out, size_t size, uint64_t max) {
+    // Sometimes zero-padded, sometimes too short or too long.
+    int width = random(4) == 0 ? int(random(6)) : 0;
+    snprintf(out, size, "%0*llu", width, (unsigned long long)random(max + 1));
+  };
+
+  const size_t Iterations = 200000;
+  size_t accepted = 0;
+  for (size_t n = 0; n < Iterations; n++) {
+    char day[16], year[16], hour[16], min[16], sec[16], offset[16];
+    number(day, sizeof(day), 40);
+    number(year, sizeof(year), random(2) ? 9999 : 99);
+    number(hour, sizeof(hour), 25);
+    number(min, sizeof(min), 61);
+    number(sec, sizeof(sec), 61);
+    number(offset, sizeof(offset), random(2) ? 2459 : 99);
+
+    char time[64];
+    snprintf(time, sizeof(time), "%s:%s%s%s", hour, min, random(4) ? ":" : "",
+             random(4) ? sec : "");
+
+    char zone[64];
+    snprintf(zone, sizeof(zone), "%s%s%s%s", pick(zones),
+             random(2) ? (random(2) ? "+" : "-") : "", random(2) ? offset : "",
+             random(4) ? "" : (random(2) ? " (Central European Time)" : " (a"));
+
+    char buf[256];
+    if (random(2)) {
+      snprintf(buf, sizeof(buf), "%s%s%s %s %s %s %s",
+               random(4) ? pick(days) : "", random(2) ? "," : "",
+               random(2) ? " " : "", day, pick(months), year, time);
+    } else {
+      snprintf(buf, sizeof(buf), "%s%s%s %s %s %s", random(4) ? pick(days) : "",
+               random(4) ? " " : "", pick(months), day, year, time);
+    }
+    if (random(8)) {
+      strncat(buf, " ", sizeof(buf) - strlen(buf) - 1);
+      strncat(buf, zone, sizeof(buf) - strlen(buf) - 1);
+    }
+
+    // Insert, delete or replace a few characters.
+    if (random(3) == 0) {
+      for (uint64_t m = random(3) + 1; m > 0; m--) {
+        size_t length = strlen(buf);
+        size_t pos = random(length + 1);
+        char ch = mutations[random(sizeof(mutations) - 1)];
+        switch (random(3)) {
+          case 0:
+            if (length + 1 < sizeof(buf)) {
+              memmove(buf + pos + 1, buf + pos, length - pos + 1);
+              buf[pos] = ch;
+            }
+            break;
+          case 1:
+            if (pos < length) {
+              memmove(buf + pos, buf + pos + 1, length - pos);
+            }
+            break;
+          default:
+            if (pos < length) {
+              buf[pos] = ch;
+            }
+            break;
+        }
+      }
+    }
+
+    JS::Rooted<JSLinearString*> str(cx, NewLinearString(cx, buf));
+    CHECK(str);
+
+    JS::ClippedTime expected;
+    bool expectedOk = js::ParseDateWithGeneralParser(str, &expected);
+
+    // Parse twice, the second time may come from the cache.
+    for (int i = 0; i < 2; i++) {
+      JS::ClippedTime actual;
+      bool ok = js::ParseDate(cx, str, &actual);
+      if (ok != expectedOk ||
+          (ok && !NumbersAreIdentical(actual.toDouble(), expected.toDouble()))) {
+        fprintf(stderr, "Date.parse(\"%s\"): got %f, expected %f\n", buf,
+                ok ? actual.toDouble() : JS::GenericNaN(),
+                expectedOk ? expected.toDouble() : JS::GenericNaN());
+        CHECK(false);
+      }
+    }
+    if (expectedOk) {
+      accepted++;
+    }
+  }
+
+  // Make sure the variations aren't mostly invalid.
+  CHECK(accepted > Iterations / 10);
+
+  return true;
+}
+END_TEST(testDateParse_differential)
+
+BEGIN_TEST(testDateParse_cache) {
+  js::DateParseCache& cache = cx->realm()->dateParseCache;
+  cache.purge();
+
+  // Dates with a time zone are cached.
+  JS::RootedValue v(cx);
+  uint64_t hits = cache.hits();
+  EVAL(
+      "var times = [];"
+      "for (var i = 0; i < 3; i++) {"
+      "  times.push(Date.parse('Tue, 15 Nov 1994 08:12:31 GMT'));"
+      "  times.push(new Date('2024-03-05T12:34:56.789+01:00').getTime());"
+      "}"
+      "times.join()",
+      &v);
+  CHECK(v.isString());
+  bool match;
+  CHECK(JS_StringEqualsLiteral(
+      cx, v.toString(),
+      "784887151000,1709638496789,784887151000,1709638496789,784887151000,"
+      "1709638496789",
+      &match));
+  CHECK(match);
+  CHECK_EQUAL(cache.hits(), hits + 4);
+
+  // Dates in local time are not, as the time zone may change.
+  hits = cache.hits();
+  EVAL(
+      "Date.parse('Nov 15 1994 08:12:31') === Date.parse('Nov 15 1994 08:12:31')"
+      " && Date.parse('2024-03-05T12:34') === Date.parse('2024-03-05T12:34')",
+      &v);
+  CHECK(v.isTrue());
+  CHECK_EQUAL(cache.hits(), hits);
+
+  return true;
+}
+END_TEST(testDateParse_cache)
@@ -0,0 +1,100 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gc/Memory.h"
+#include "js/HeapAPI.h"
+#include "jsapi-tests/tests.h"
+
+// Checks how chunks are carved out of huge page regions and given back. This
+// only does something when run with JS_GC_HUGE_PAGES=1 in the environment.
+
+BEGIN_TEST(testGCHugePages) {
+  using namespace js::gc;
+
+  HugePageStats before;
+  GetHugePageStats(&before);
+  CHECK(before.enabled == HugePagesEnabled());
+  if (!before.enabled) {
+    return true;
+  }
+  CHECK(!DecommitEnabled());
+
+  // Map two regions' worth of chunks. A spare chunk left over from an earlier
+  // region may be handed out first, so this maps one or two new regions, and
+  // at least one of them is handed out completely.
+  const size_t RegionSize = 2 * 1024 * 1024;
+  const size_t ChunksPerRegion = RegionSize / ChunkSize;
+  const size_t Count = 2 * ChunksPerRegion;
+  const size_t MaxChunks = 32;
+  void* chunks[MaxChunks];
+  MOZ_RELEASE_ASSERT(Count <= MaxChunks);
+  for (size_t i = 0; i < Count; i++) {
+    chunks[i] = MapAlignedPages(ChunkSize, ChunkSize);
+    CHECK(chunks[i]);
+  }
+
+  HugePageStats mapped;
+  GetHugePageStats(&mapped);
+  CHECK(mapped.chunksMapped == before.chunksMapped + Count);
+  size_t newRegions = mapped.regionsMapped - before.regionsMapped;
+  CHECK(newRegions >= 1 && newRegions <= 2);
+
+  // Count the regions whose chunks were all handed out to us.
+  size_t fullRegions = 0;
+  for (size_t i = 0; i < Count; i++) {
+    uintptr_t region = uintptr_t(chunks[i]) & ~(RegionSize - 1);
+    if (uintptr_t(chunks[i]) != region) {
+      continue;
+    }
+    size_t inRegion = 0;
+    for (size_t j = 0; j < Count; j++) {
+      if ((uintptr_t(chunks[j]) & ~(RegionSize - 1)) == region) {
+        inRegion++;
+      }
+    }
+    if (inRegion == ChunksPerRegion) {
+      fullRegions++;
+    }
+  }
+  CHECK(fullRegions >= 1);
+
+  // Unmapping a chunk keeps it spare until the rest of its region is unmapped
+  // too, and then the region is unmapped as a whole.
+  for (size_t i = 0; i < Count; i++) {
+    UnmapPages(chunks[i], ChunkSize);
+  }
+
+  HugePageStats unmapped;
+  GetHugePageStats(&unmapped);
+  CHECK(unmapped.regionsUnmapped - before.regionsUnmapped >= fullRegions);
+  CHECK(unmapped.chunksSpare < mapped.chunksSpare + Count);
+
+  // Full GCs of a heap of around 50MB, which needs new regions. The shell
+  // bench devtools/bench/gc-huge-pages.js times these with and without
+  // huge pages.
+  EXEC(
+      "var retained = [];"
+      "for (var i = 0; i < 500; i++) {"
+      "  var list = null;"
+      "  for (var j = 0; j < 1000; j++) {"
+      "    list = { next: list, value: 'v' + j, index: i * 1000 + j };"
+      "  }"
+      "  retained.push(list);"
+      "}");
+  JS_GC(cx);
+  JS_GC(cx);
+
+  HugePageStats collected;
+  GetHugePageStats(&collected);
+  CHECK(collected.regionsMapped > unmapped.regionsMapped);
+  CHECK(collected.adviseFailures == before.adviseFailures);
+
+  EXEC("retained = null;");
+  JS_GC(cx);
+  return true;
+}
+END_TEST(testGCHugePages)
@@ -0,0 +1,123 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "builtin/String.h"
+#include "jsapi-tests/tests.h"
+#include "vm/ArrayObject.h"
+#include "vm/JSContext.h"
+#include "vm/Realm.h"
+#include "vm/Runtime.h"
+
+#include "vm/JSObject-inl.h"
+
+BEGIN_TEST(testStringSplitCache) {
+  js::StringSplitCache& cache = cx->realm()->stringSplitCache;
+  cache.purge();
+
+  // Repeated splits of a constant string hit the cache, but return a new
+  // array each time.
+  uint64_t hits = cache.hits();
+  JS::RootedValue v(cx);
+  EVAL(
+      "function split() { return 'a b c d'.split(' '); }"
+      "var first = split();"
+      "first[0] = 'x';"
+      "var second = split();"
+      "first !== second && second.join() === 'a,b,c,d'",
+      &v);
+  CHECK(v.isTrue());
+  CHECK(cache.hits() > hits);
+
+  // Short strings which aren't atoms are matched by their contents.
+  hits = cache.hits();
+  EVAL(
+      "var cookie = 'a=1; b=2';"
+      "var parts = [];"
+      "for (var i = 0; i < 3; i++) {"
+      "  parts.push((cookie + '; c=' + 3).split('; ').join('|'));"
+      "}"
+      "parts.join()",
+      &v);
+  CHECK(v.isString());
+  bool match;
+  CHECK(JS_StringEqualsLiteral(cx, v.toString(),
+                               "a=1|b=2|c=3,a=1|b=2|c=3,a=1|b=2|c=3", &match));
+  CHECK(match);
+  CHECK(cache.hits() >= hits + 2);
+
+  // TaintFox: tainted strings bypass the cache, and their substrings keep
+  // their taint.
+  hits = cache.hits();
+  EVAL(
+      "var tainted = String.tainted('a b c d');"
+      "var ok = true;"
+      "for (var i = 0; i < 3; i++) {"
+      "  ok = ok && tainted.split(' ').every(s => s.taint.length === 1);"
+      "}"
+      "ok && 'a b c d'.split(' ').every(s => s.taint.length === 0)",
+      &v);
+  CHECK(v.isTrue());
+  CHECK(cache.hits() <= hits + 1);
+
+  return true;
+}
+END_TEST(testStringSplitCache)
+
+// Split the same string many times with and without the cache, counting the
+// substrings allocated and the minor GCs needed rather than timing them.
+BEGIN_TEST(testStringSplitCache_bench) {
+  JS::RootedString str(
+      cx, JS_AtomizeAndPinString(cx, "alpha beta gamma delta epsilon zeta"));
+  CHECK(str);
+  JS::RootedString sep(cx, JS_AtomizeAndPinString(cx, " "));
+  CHECK(sep);
+
+  const size_t Iterations = 100000;
+  const size_t Substrings = 6;
+  js::StringSplitCache& cache = cx->realm()->stringSplitCache;
+
+  uint64_t allocated[2];
+  uint64_t minorGCs[2];
+  for (bool cached : {false, true}) {
+    JS_GC(cx);
+    uint64_t minorGCsBefore = cx->runtime()->gc.minorGCCount();
+    uint64_t substrings = 0;
+    JS::Rooted<js::ArrayObject*> previous(cx);
+    for (size_t i = 0; i < Iterations; i++) {
+      if (!cached) {
+        cache.purge();
+      }
+      JS::Rooted<js::ArrayObject*> result(
+          cx, js::StringSplitString(cx, str, sep, INT32_MAX));
+      CHECK(result);
+      CHECK(result->getDenseInitializedLength() == Substrings);
+
+      // A cached split reuses the substrings of the previous one; anything
+      // else is a newly allocated string.
+      for (uint32_t j = 0; j < Substrings; j++) {
+        if (!previous || previous->getDenseElement(j).toString() !=
+                             result->getDenseElement(j).toString()) {
+          substrings++;
+        }
+      }
+      CHECK(result.get() != previous.get());
+      previous = result;
+    }
+    allocated[cached] = substrings;
+    minorGCs[cached] = cx->runtime()->gc.minorGCCount() - minorGCsBefore;
+  }
+
+  // Without the cache, every split allocates all of its substrings. With it,
+  // only the splits after a purge do, and the smaller allocation volume
+  // needs no more minor GCs.
+  CHECK(allocated[false] == Iterations * Substrings);
+  CHECK(allocated[true] <= (minorGCs[true] + 1) * Substrings);
+  CHECK(minorGCs[true] <= minorGCs[false]);
+
+  return true;
+}
+END_TEST(testStringSplitCache_bench)
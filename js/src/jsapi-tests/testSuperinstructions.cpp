@@ -0,0 +1,223 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "jit/JitOptions.h"
+#include "jsapi-tests/tests.h"
+#include "vm/BytecodeUtil.h"
+#include "vm/JSFunction.h"
+#include "vm/JSScript.h"
+#include "vm/Runtime.h"
+
+// Runs the scripts of a test in the C++ interpreter only.
+class AutoInterpreterOnly {
+  bool baselineInterpreter_;
+  bool baselineJit_;
+  bool ion_;
+
+ public:
+  AutoInterpreterOnly()
+      : baselineInterpreter_(js::jit::JitOptions.baselineInterpreter),
+        baselineJit_(js::jit::JitOptions.baselineJit),
+        ion_(js::jit::JitOptions.ion) {
+    js::jit::JitOptions.baselineInterpreter = false;
+    js::jit::JitOptions.baselineJit = false;
+    js::jit::JitOptions.ion = false;
+  }
+  ~AutoInterpreterOnly() {
+    js::jit::JitOptions.baselineInterpreter = baselineInterpreter_;
+    js::jit::JitOptions.baselineJit = baselineJit_;
+    js::jit::JitOptions.ion = ion_;
+  }
+};
+
+// Collects the op pair profile of the runtime for the duration of a test.
+class AutoOpPairProfile {
+  JSContext* cx_;
+
+ public:
+  explicit AutoOpPairProfile(JSContext* cx) : cx_(cx) {
+    cx_->runtime()->opPairProfile = js::MakeUnique<js::OpPairProfile>();
+  }
+  ~AutoOpPairProfile() { cx_->runtime()->opPairProfile = nullptr; }
+
+  js::OpPairProfile* get() {
+    return cx_->runtime()->opPairProfile.ref().get();
+  }
+};
+
+static const char Functions[] =
+    "function sub(a, b) { return a - b; }"
+    "function mapped(a, b) { arguments[0] = 10; return a - b; }"
+    "function pow(n, m) {"
+    "  var x = 1, y = n;"
+    "  for (var i = 0; i < m; i++) { x = x * y; }"
+    "  return x + y;"
+    "}"
+    "function concat(s, t) { return s + t; }"
+    "function check() {"
+    "  var tainted = String.tainted('abc');"
+    "  return sub(7, 3) === 4 && mapped(1, 3) === 7 && pow(3, 4) === 84 &&"
+    "         [3, 1, 2].sort(sub).join() === '1,2,3' &&"
+    "         concat(tainted, 'd') === 'abcd' &&"
+    "         concat(tainted, 'd').taint.length > 0 &&"
+    "         concat('abc', 'd').taint.length === 0;"
+    "}";
+
+// Pairs of gets and set;pop sequences are fused by the bytecode emitter, and
+// run the same way in the interpreters and JITs.
+BEGIN_TEST(testSuperinstructions) {
+  JS::RootedValue v(cx);
+  EVAL(Functions, &v);
+
+  CHECK(hasOp("sub", JSOp::GetArgPair));
+  CHECK(hasOp("mapped", JSOp::GetArgPair));
+  CHECK(hasOp("pow", JSOp::GetLocalPair));
+  CHECK(hasOp("pow", JSOp::SetLocalPop));
+
+  {
+    AutoInterpreterOnly interpreterOnly;
+    EVAL("check()", &v);
+    CHECK(v.isTrue());
+  }
+
+  // Run often enough for the Baseline Interpreter, Baseline JIT and Ion.
+  EVAL(
+      "var ok = true;"
+      "for (var i = 0; i < 3000; i++) { ok = ok && check(); }"
+      "ok",
+      &v);
+  CHECK(v.isTrue());
+
+  // The op pair profile counts the two ops fused by a superinstruction.
+  {
+    AutoInterpreterOnly interpreterOnly;
+    AutoOpPairProfile profile(cx);
+    CHECK(profile.get());
+    EVAL(
+        "function mul(a, b) { return a * b; }"
+        "var t = 0;"
+        "for (var i = 0; i < 100; i++) { t += mul(i, 2); }"
+        "t",
+        &v);
+    CHECK_EQUAL(v.toNumber(), 9900.0);
+    CHECK(hasOp("mul", JSOp::GetArgPair));
+    CHECK(profile.get()->count(JSOp::GetArg, JSOp::GetArg) >= 100);
+    CHECK(profile.get()->count(JSOp::GetArgPair, JSOp::Mul) == 0);
+  }
+
+  return true;
+}
+
+bool hasOp(const char* name, JSOp op) {
+  JS::RootedValue fval(cx);
+  CHECK(JS_GetProperty(cx, global, name, &fval));
+  CHECK(fval.isObject() && fval.toObject().is<JSFunction>());
+
+  JS::RootedFunction fun(cx, &fval.toObject().as<JSFunction>());
+  JSScript* script = JS_GetFunctionScript(cx, fun);
+  CHECK(script);
+  for (jsbytecode* pc = script->code(); pc < script->codeEnd();
+       pc = js::GetNextPc(pc)) {
+    if (JSOp(*pc) == op) {
+      return true;
+    }
+  }
+  return false;
+}
+END_TEST(testSuperinstructions)
+
+// Code which reads arguments and locals, as in the loops of numeric code. The
+// shell bench devtools/bench/superinstructions.js times the same functions.
+static const char BenchFunctions[] =
+    "function dot(a, b, n) {"
+    "  var s = 0, x = 0, y = 0;"
+    "  for (var i = 0; i < n; i++) {"
+    "    x = a[i];"
+    "    y = b[i];"
+    "    s = s + x * y;"
+    "  }"
+    "  return s;"
+    "}"
+    "function hypot(a, b) { return Math.sqrt(a * a + b * b); }"
+    "function run(n) {"
+    "  var a = [], b = [];"
+    "  for (var i = 0; i < 100; i++) { a.push(i); b.push(100 - i); }"
+    "  var t = 0;"
+    "  for (var j = 0; j < n; j++) { t = t + dot(a, b, 100) + hypot(j, 3); }"
+    "  return t;"
+    "}";
+
+// Check how many of the op pairs executed by the bench code are fused, and
+// that the C++ interpreter and the Baseline Interpreter agree on its result.
+// Timings are left to the shell bench.
+BEGIN_TEST(testSuperinstructions_bench) {
+  JS::RootedValue v(cx);
+  EVAL(BenchFunctions, &v);
+
+  CHECK(hasOp("dot", JSOp::SetLocalPop));
+  CHECK(hasOp("dot", JSOp::GetLocalPair));
+  CHECK(hasOp("hypot", JSOp::GetArgPair));
+
+  const uint32_t Calls = 1000;
+  double expected;
+  {
+    AutoInterpreterOnly interpreterOnly;
+    AutoOpPairProfile profile(cx);
+    CHECK(profile.get());
+    EVAL("run(1000)", &v);
+    CHECK(v.isNumber());
+    expected = v.toNumber();
+
+    // Each of the 100 iterations of dot's loop ends three assignments with
+    // SetLocal;Pop and reads two locals in a row, and hypot reads each of
+    // its arguments twice in a row.
+    const uint64_t Iterations = Calls * 100;
+    CHECK(profile.get()->count(JSOp::SetLocal, JSOp::Pop) >= 3 * Iterations);
+    CHECK(profile.get()->count(JSOp::GetLocal, JSOp::GetLocal) >= Iterations);
+    CHECK(profile.get()->count(JSOp::GetArg, JSOp::GetArg) >= 2 * Calls);
+  }
+
+  if (js::jit::JitOptions.baselineInterpreter) {
+    uint32_t warmUpThreshold =
+        js::jit::JitOptions.baselineInterpreterWarmUpThreshold;
+    bool baselineJit = js::jit::JitOptions.baselineJit;
+    bool ion = js::jit::JitOptions.ion;
+    js::jit::JitOptions.baselineInterpreterWarmUpThreshold = 0;
+    js::jit::JitOptions.baselineJit = false;
+    js::jit::JitOptions.ion = false;
+
+    bool ok = evaluate("run(1000)", __FILE__, __LINE__, &v);
+
+    js::jit::JitOptions.baselineInterpreterWarmUpThreshold = warmUpThreshold;
+    js::jit::JitOptions.baselineJit = baselineJit;
+    js::jit::JitOptions.ion = ion;
+
+    CHECK(ok);
+    CHECK(v.isNumber());
+    CHECK_EQUAL(v.toNumber(), expected);
+  }
+
+  return true;
+}
+
+bool hasOp(const char* name, JSOp op) {
+  JS::RootedValue fval(cx);
+  CHECK(JS_GetProperty(cx, global, name, &fval));
+  CHECK(fval.isObject() && fval.toObject().is<JSFunction>());
+
+  JS::RootedFunction fun(cx, &fval.toObject().as<JSFunction>());
+  JSScript* script = JS_GetFunctionScript(cx, fun);
+  CHECK(script);
+  for (jsbytecode* pc = script->code(); pc < script->codeEnd();
+       pc = js::GetNextPc(pc)) {
+    if (JSOp(*pc) == op) {
+      return true;
+    }
+  }
+  return false;
+}
+END_TEST(testSuperinstructions_bench)
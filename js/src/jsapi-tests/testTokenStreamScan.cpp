@@ -0,0 +1,134 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mozilla/Utf8.h"
+
+#include <string>
+
+#include "js/CompilationAndEvaluation.h"  // JS::Evaluate
+#include "js/SourceText.h"
+#include "jsapi-tests/tests.h"
+
+using mozilla::Utf8Unit;
+
+// Encodes BMP-only UTF-16 text as UTF-8.
+static std::string ToUtf8(const std::u16string& text) {
+  std::string utf8;
+  for (char16_t c : text) {
+    if (c < 0x80) {
+      utf8 += char(c);
+    } else if (c < 0x800) {
+      utf8 += char(0xC0 | (c >> 6));
+      utf8 += char(0x80 | (c & 0x3F));
+    } else {
+      utf8 += char(0xE0 | (c >> 12));
+      utf8 += char(0x80 | ((c >> 6) & 0x3F));
+      utf8 += char(0x80 | (c & 0x3F));
+    }
+  }
+  return utf8;
+}
+
+// Comments, string literals, identifiers and whitespace are scanned a word at a
+// time. Vary their lengths so that the interesting code units land on every
+// position of a word, and at the end of the source.
+BEGIN_TEST(testTokenStreamScan) {
+  for (size_t n = 0; n < 40; n++) {
+    std::u16string pad(n, u'a');
+    std::u16string blanks(n, u' ');
+
+    // Line terminators end single-line comments, and are counted inside
+    // multi-line comments.
+    CHECK(evalsTo(u"//" + pad + u"\n//" + pad + u"\r\n//" + pad + u"\u2028" +
+                      blanks + u"(new Error).lineNumber",
+                  4));
+    CHECK(evalsTo(u"/*" + pad + u"*" + pad + u"@#\u00e9\n" + pad + u"\r\n" +
+                      pad + u"\u2029" + pad + u"**/\t" + blanks +
+                      u"(new Error).lineNumber",
+                  4));
+    CHECK(evalsTo(u"1 +" + blanks + u"1//" + pad, 2));
+
+    // Escapes, line continuations, other quotes, '$' and non-ASCII in string
+    // and template literals.
+    CHECK(evalsTo(u"'" + pad + u"\\n" + pad + u"\"$`\\\n\u00e9" + pad + u"'",
+                  pad + u"\n" + pad + u"\"$`\u00e9" + pad));
+    CHECK(evalsTo(u"\"" + pad + u"\\\"" + pad + u"'\"", pad + u"\"" + pad +
+                  u"'"));
+    CHECK(evalsTo(u"`" + pad + u"${1 + 1}" + pad + u"$" + pad + u"\r\n" + pad +
+                      u"\\`\u2028`",
+                  pad + u"2" + pad + u"$" + pad + u"\n" + pad + u"`\u2028"));
+
+    // Unicode escapes and non-ASCII code points in identifiers.
+    std::u16string ident = u"_$" + pad + u"\\u0062\u00e9" + pad + u"9";
+    CHECK(evalsTo(u"var o = {" + ident + u": 1};\n" + blanks +
+                      u"Object.keys(o)[0]",
+                  u"_$" + pad + u"b\u00e9" + pad + u"9"));
+
+    // Identifiers made of every kind of ASCII IdentifierPart, ended by code
+    // units just outside the ranges of letters and digits.
+    std::u16string name = u"AZaz09$_" + pad + u"z";
+    CHECK(evalsTo(u"var " + name + u"=[6];var o={" + name + u":2};" + name +
+                      u"[0]/o." + name + u"%4",
+                  3));
+  }
+
+  // Unterminated literals and comments are still errors.
+  for (const char16_t* source :
+       {u"'abcdefghijklmnopqrstuvwxyz", u"'abcdefghijklmnop\nqrstuvwxyz'",
+        u"/* abcdefghijklmnopqrstuvwxyz *", u"`abcdefghijklmnopqrstuvwxyz"}) {
+    JS::RootedValue rval(cx);
+    CHECK(!evaluate(source, &rval));
+    JS_ClearPendingException(cx);
+    CHECK(!evaluate(ToUtf8(source), &rval));
+    JS_ClearPendingException(cx);
+  }
+
+  return true;
+}
+
+bool evaluate(const std::u16string& source, JS::MutableHandleValue rval) {
+  JS::CompileOptions options(cx);
+  JS::SourceText<char16_t> srcBuf;
+  return srcBuf.init(cx, source.data(), source.length(),
+                     JS::SourceOwnership::Borrowed) &&
+         JS::Evaluate(cx, options, srcBuf, rval);
+}
+
+bool evaluate(const std::string& source, JS::MutableHandleValue rval) {
+  JS::CompileOptions options(cx);
+  JS::SourceText<Utf8Unit> srcBuf;
+  return srcBuf.init(cx, source.data(), source.length(),
+                     JS::SourceOwnership::Borrowed) &&
+         JS::Evaluate(cx, options, srcBuf, rval);
+}
+
+// Check the result of |source| both as UTF-16 and as UTF-8 source text.
+bool evalsTo(const std::u16string& source, JS::HandleValue expected) {
+  JS::RootedValue rval(cx);
+  CHECK(evaluate(source, &rval));
+  bool same;
+  CHECK(JS::SameValue(cx, rval, expected, &same));
+  CHECK(same);
+
+  CHECK(evaluate(ToUtf8(source), &rval));
+  CHECK(JS::SameValue(cx, rval, expected, &same));
+  CHECK(same);
+  return true;
+}
+
+bool evalsTo(const std::u16string& source, int32_t expected) {
+  JS::RootedValue value(cx, JS::Int32Value(expected));
+  return evalsTo(source, value);
+}
+
+bool evalsTo(const std::u16string& source, const std::u16string& expected) {
+  JSString* str = JS_NewUCStringCopyN(cx, expected.data(), expected.length());
+  CHECK(str);
+  JS::RootedValue value(cx, JS::StringValue(str));
+  return evalsTo(source, value);
+}
+END_TEST(testTokenStreamScan)
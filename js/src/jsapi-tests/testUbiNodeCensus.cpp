@@ -0,0 +1,146 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mozilla/Sprintf.h"
+
+#include "js/Debug.h"               // JS::dbg::GetDebuggerMallocSizeOf
+#include "js/GlobalObject.h"        // JS_NewGlobalObject
+#include "js/PropertyAndElement.h"  // JS_SetProperty
+#include "js/String.h"              // JS_CompareStrings
+#include "js/UbiNode.h"
+#include "js/UbiNodeBreadthFirst.h"
+#include "js/UbiNodeCensus.h"
+#include "jsapi-tests/tests.h"
+
+// Check that a census counted on helper threads reports exactly what a serial
+// census does. The heap is small, so the census is told to split it up anyway.
+
+static const char* Breakdowns[] = {
+    "undefined",
+    "{ by: 'coarseType',"
+    "  objects: { by: 'objectClass', then: { by: 'count' },"
+    "             other: { by: 'count' } },"
+    "  scripts: { by: 'filename', then: { by: 'count' },"
+    "             noFilename: { by: 'count' } },"
+    "  strings: { by: 'count', count: true, bytes: true },"
+    "  other: { by: 'internalType', then: { by: 'count' } },"
+    "  domNode: { by: 'count' } }",
+    "{ by: 'objectClass', then: { by: 'bucket' }, other: { by: 'bucket' } }",
+};
+
+BEGIN_TEST(testUbiNodeCensus_parallel) {
+  CHECK(JS_DefineDebuggerObject(cx, global));
+  JS::RealmOptions options;
+  JS::RootedObject g(cx, JS_NewGlobalObject(cx, getGlobalClass(), nullptr,
+                                            JS::FireOnNewGlobalHook, options));
+  CHECK(g);
+
+  JS::RootedObject gWrapper(cx, g);
+  CHECK(JS_WrapObject(cx, &gWrapper));
+  JS::RootedValue v(cx, JS::ObjectValue(*gWrapper));
+  CHECK(JS_SetProperty(cx, global, "g", v));
+
+  // A few thousand objects, strings and functions in the debuggee.
+  EXEC(
+      "g.eval(`"
+      "  var retained = [];"
+      "  for (var i = 0; i < 20; i++) {"
+      "    var list = null;"
+      "    for (var j = 0; j < 100; j++) {"
+      "      list = { next: list, value: 'v' + (i * 100 + j),"
+      "               fn: j % 10 ? null : function () { return j; },"
+      "               array: j % 4 ? null : [i, j] };"
+      "    }"
+      "    retained.push(list);"
+      "  }"
+      "`);"
+      "var dbg = new Debugger(g);");
+
+  // Tenure everything, so that node identifiers don't change between the
+  // two censuses.
+  JS_GC(cx);
+
+  JS::RootedValue dbgVal(cx);
+  EVAL("dbg", &dbgVal);
+  JS::RootedObject dbgObj(cx, &dbgVal.toObject());
+
+  for (const char* breakdown : Breakdowns) {
+    char code[256];
+    SprintfLiteral(code, "({ breakdown: %s })", breakdown);
+    JS::RootedValue censusOptions(cx);
+    EVAL(code, &censusOptions);
+    JS::RootedObject optionsObj(cx, &censusOptions.toObject());
+
+    JS::RootedString serial(cx, takeCensus(dbgObj, g, optionsObj, false));
+    CHECK(serial);
+    JS::RootedString parallel(cx, takeCensus(dbgObj, g, optionsObj, true));
+    CHECK(parallel);
+
+    bool same;
+    CHECK(JS_StringEqualsAscii(cx, serial, "{}", &same));
+    CHECK(!same);
+    int32_t result;
+    CHECK(JS_CompareStrings(cx, serial, parallel, &result));
+    CHECK(result == 0);
+  }
+
+  EXEC("dbg.removeAllDebuggees();");
+  return true;
+}
+
+// Take a census of |debuggee|'s zone, as Debugger.Memory.takeCensus does, and
+// return its report as JSON.
+JSString* takeCensus(JS::HandleObject dbgObj, JS::HandleObject debuggee,
+                     JS::HandleObject censusOptions, bool parallel) {
+  JS::ubi::Census census(cx);
+  JS::ubi::CountTypePtr rootType;
+  if (!JS::ubi::ParseCensusOptions(cx, census, censusOptions, rootType)) {
+    return nullptr;
+  }
+  census.parallel = parallel;
+  census.minParallelNodes = 1;
+  if (!census.targetZones.put(JS::GetObjectZone(debuggee))) {
+    return nullptr;
+  }
+
+  JS::ubi::RootedCount rootCount(cx, rootType->makeCount());
+  if (!rootCount) {
+    return nullptr;
+  }
+  JS::ubi::CensusHandler handler(census, rootCount,
+                                 JS::dbg::GetDebuggerMallocSizeOf(cx));
+
+  {
+    JS::ubi::RootList rootList(cx);
+    auto [ok, nogc] = rootList.init(dbgObj);
+    if (!ok) {
+      return nullptr;
+    }
+
+    JS::ubi::CensusTraversal traversal(cx, handler, nogc);
+    traversal.wantNames = false;
+    if (!traversal.addStart(JS::ubi::Node(&rootList)) ||
+        !traversal.traverse() || !handler.finish()) {
+      return nullptr;
+    }
+  }
+
+  JS::RootedValue report(cx);
+  if (!handler.report(cx, &report)) {
+    return nullptr;
+  }
+  if (!JS_SetProperty(cx, global, "report", report)) {
+    return nullptr;
+  }
+  JS::RootedValue json(cx);
+  if (!evaluate("JSON.stringify(report)", __FILE__, __LINE__, &json) ||
+      !json.isString()) {
+    return nullptr;
+  }
+  return json.toString();
+}
+END_TEST(testUbiNodeCensus_parallel)
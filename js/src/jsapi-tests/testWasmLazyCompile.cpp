@@ -0,0 +1,113 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * vim: set ts=8 sts=2 et sw=2 tw=80:
+ */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "jsapi.h"
+
+#include "jsapi-tests/tests.h"
+#include "wasm/WasmCode.h"
+#include "wasm/WasmJS.h"
+#include "wasm/WasmModule.h"
+
+using namespace js;
+
+// A module with four functions, exporting f, h and t:
+//
+//   f(x) = g(x) + 1
+//   g(x) = x * 2
+//   h(x) = x
+//   t()  = unreachable
+static const char ModuleBytes[] =
+    "new Uint8Array(["
+    "0,0x61,0x73,0x6d,1,0,0,0,"
+    "1,6,1,0x60,1,0x7f,1,0x7f,"
+    "3,5,4,0,0,0,0,"
+    "7,13,3,1,0x66,0,0,1,0x68,0,2,1,0x74,0,3,"
+    "10,28,4,"
+    "9,0,0x20,0,0x10,1,0x41,1,0x6a,0x0b,"
+    "7,0,0x20,0,0x41,2,0x6c,0x0b,"
+    "4,0,0x20,0,0x0b,"
+    "3,0,0x00,0x0b])";
+
+BEGIN_TEST(testWasmLazyCompile) {
+  if (!wasm::HasSupport(cx)) {
+    return true;
+  }
+
+  uint32_t saved = 0;
+  CHECK(JS_GetGlobalJitCompilerOption(cx, JSJITCOMPILER_WASM_LAZY_COMPILE,
+                                      &saved));
+  JS_SetGlobalJitCompilerOption(cx, JSJITCOMPILER_WASM_LAZY_COMPILE, 1);
+  bool ok = runTest();
+  JS_SetGlobalJitCompilerOption(cx, JSJITCOMPILER_WASM_LAZY_COMPILE, saved);
+  return ok;
+}
+
+bool runTest() {
+  JS::RootedValue v(cx);
+  EVAL("var bytes = " ModuleBytes
+       ";"
+       "var module = new WebAssembly.Module(bytes);"
+       "module",
+       &v);
+  CHECK(v.isObject());
+  JS::RootedObject moduleObj(cx, &v.toObject());
+  CHECK(moduleObj->is<WasmModuleObject>());
+
+  const wasm::LazyFuncs* lazyFuncs =
+      moduleObj->as<WasmModuleObject>().module().code().lazyFuncs();
+  if (!lazyFuncs) {
+    // Lazy compilation isn't available on this platform or configuration.
+    return true;
+  }
+  CHECK_EQUAL(lazyFuncs->numFuncDefs(), 4u);
+  CHECK_EQUAL(lazyFuncs->numCompiled(), 0u);
+
+  // Calling f compiles f and, when f calls it, g.
+  EVAL("var e = new WebAssembly.Instance(module).exports; e.f(5)", &v);
+  CHECK(v.isInt32(5 * 2 + 1));
+  CHECK_EQUAL(lazyFuncs->numCompiled(), 2u);
+
+  // Further calls use the compiled code.
+  EVAL("e.f(20) + e.f(21)", &v);
+  CHECK(v.isInt32(41 + 43));
+  CHECK_EQUAL(lazyFuncs->numCompiled(), 2u);
+
+  // A second instance shares the compiled code.
+  EVAL("new WebAssembly.Instance(module).exports.f(1)", &v);
+  CHECK(v.isInt32(3));
+  CHECK_EQUAL(lazyFuncs->numCompiled(), 2u);
+
+  EVAL("e.h(7)", &v);
+  CHECK(v.isInt32(7));
+  CHECK_EQUAL(lazyFuncs->numCompiled(), 3u);
+
+  // Traps in lazily compiled code are reported as usual.
+  EVAL(
+      "var trapped = false;"
+      "try { e.t(); } catch (err) {"
+      "  trapped = err instanceof WebAssembly.RuntimeError;"
+      "}"
+      "trapped",
+      &v);
+  CHECK(v.isTrue());
+  CHECK_EQUAL(lazyFuncs->numCompiled(), 4u);
+
+  // Function bodies are still validated up front: h with local.get 5.
+  EVAL(
+      "var bad = bytes.slice();"
+      "bad[bad.length - 6] = 5;"
+      "var rejected = false;"
+      "try { new WebAssembly.Module(bad); } catch (err) {"
+      "  rejected = err instanceof WebAssembly.CompileError;"
+      "}"
+      "rejected",
+      &v);
+  CHECK(v.isTrue());
+
+  return true;
+}
+END_TEST(testWasmLazyCompile)
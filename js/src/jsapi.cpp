@@ -32,6 +32,7 @@
 #include "jsfriendapi.h"
 #include "jsmath.h"
 #include "jstypes.h"
+#include "TaintTrace.h"
 
 #include "builtin/AtomicsObject.h"
 #include "builtin/Eval.h"
@@ -4181,6 +4182,9 @@ JS_PUBLIC_API void JS_SetGlobalJitCompilerOption(JSContext* cx,
         JitSpew(js::jit::JitSpew_BaselineScripts, "Disable baseline");
       }
       break;
+    case JSJITCOMPILER_BASELINE_OFFTHREAD_COMPILE:
+      jit::JitOptions.baselineOffThreadCompile = !!value;
+      break;
     case JSJITCOMPILER_NATIVE_REGEXP_ENABLE:
       jit::JitOptions.nativeRegExp = !!value;
       break;
@@ -4231,6 +4235,9 @@ JS_PUBLIC_API void JS_SetGlobalJitCompilerOption(JSContext* cx,
     case JSJITCOMPILER_WASM_DELAY_TIER2:
       jit::JitOptions.wasmDelayTier2 = !!value;
       break;
+    case JSJITCOMPILER_WASM_LAZY_COMPILE:
+      jit::JitOptions.wasmLazyCompile = !!value;
+      break;
     case JSJITCOMPILER_WASM_JIT_BASELINE:
       JS::ContextOptionsRef(cx).setWasmBaseline(!!value);
       break;
@@ -4290,6 +4297,9 @@ JS_PUBLIC_API bool JS_GetGlobalJitCompilerOption(JSContext* cx,
     case JSJITCOMPILER_BASELINE_ENABLE:
       *valueOut = jit::JitOptions.baselineJit;
       break;
+    case JSJITCOMPILER_BASELINE_OFFTHREAD_COMPILE:
+      *valueOut = jit::JitOptions.baselineOffThreadCompile ? 1 : 0;
+      break;
     case JSJITCOMPILER_NATIVE_REGEXP_ENABLE:
       *valueOut = jit::JitOptions.nativeRegExp;
       break;
@@ -4317,6 +4327,9 @@ JS_PUBLIC_API bool JS_GetGlobalJitCompilerOption(JSContext* cx,
     case JSJITCOMPILER_WASM_FOLD_OFFSETS:
       *valueOut = jit::JitOptions.wasmFoldOffsets ? 1 : 0;
       break;
+    case JSJITCOMPILER_WASM_LAZY_COMPILE:
+      *valueOut = jit::JitOptions.wasmLazyCompile ? 1 : 0;
+      break;
     case JSJITCOMPILER_WASM_JIT_BASELINE:
       *valueOut = JS::ContextOptionsRef(cx).wasmBaseline() ? 1 : 0;
       break;
@@ -4348,6 +4361,7 @@ JS_PUBLIC_API void JS::DisableSpectreMitigationsAfterInit() {
   MOZ_RELEASE_ASSERT(cx->runtime()->wasmInstances.lock()->empty());
 
   CancelOffThreadIonCompile(cx->runtime());
+  CancelOffThreadBaselineCompile(cx->runtime());
 
   jit::JitOptions.spectreIndexMasking = false;
   jit::JitOptions.spectreObjectMitigations = false;
@@ -4654,6 +4668,7 @@ JS_SetStringTaint(JSContext* cx, JSString* str, const StringTaint& taint)
 JS_PUBLIC_API void
 JS_MarkTaintSource(JSContext* cx, JSString* str, const TaintOperation& op)
 {
+  TaintTrace(TaintTraceEvent::Source, &str->taint(), op.name(), str->length());
   if (str->isTainted()) {
     JS_SetStringTaint(cx, str, StringTaint(0, str->length(), op));
   } else {
@@ -4732,6 +4747,8 @@ JS_ReportTaintSink(JSContext* cx, JS::HandleString str, const char* sink, JS::Ha
     return;
   }
 
+  TaintTrace(TaintTraceEvent::Sink, &str->taint(), sink, str->length());
+
   MOZ_ASSERT(!cx->isExceptionPending());
 
   // Print a message to stdout. Also include the current JS backtrace.
@@ -828,6 +828,7 @@ extern JS_PUBLIC_API void JS_SetOffthreadIonCompilationEnabled(JSContext* cx,
   Register(INLINING_BYTECODE_MAX_LENGTH, "inlining.bytecode-max-length") \
   Register(BASELINE_INTERPRETER_ENABLE, "blinterp.enable") \
   Register(BASELINE_ENABLE, "baseline.enable") \
+  Register(BASELINE_OFFTHREAD_COMPILE, "baseline.offthread-compile") \
   Register(OFFTHREAD_COMPILATION_ENABLE, "offthread-compilation.enable")  \
   Register(FULL_DEBUG_CHECKS, "jit.full-debug-checks") \
   Register(JUMP_THRESHOLD, "jump-threshold") \
@@ -841,6 +842,7 @@ extern JS_PUBLIC_API void JS_SetOffthreadIonCompilationEnabled(JSContext* cx,
   Register(WATCHTOWER_MEGAMORPHIC, "watchtower.megamorphic") \
   Register(WASM_FOLD_OFFSETS, "wasm.fold-offsets") \
   Register(WASM_DELAY_TIER2, "wasm.delay-tier2") \
+  Register(WASM_LAZY_COMPILE, "wasm.lazy-compile") \
   Register(WASM_JIT_BASELINE, "wasm.baseline") \
   Register(WASM_JIT_OPTIMIZING, "wasm.optimizing")
 // clang-format on
@@ -980,6 +982,19 @@ JS_GetStringTaint(const JSLinearString* str);
 extern JS_PUBLIC_API void
 JS_SetStringTaint(JSContext* cx, JSString* str, const StringTaint& taint);
 
+// TaintFox: Get and set byte granular taint information of ArrayBuffers and
+// ArrayBufferViews.
+//
+// Taint ranges are byte offsets relative to the start of the given buffer or
+// view. SharedArrayBuffers are never tainted. Setting the taint of a view
+// replaces the taint of the bytes covered by the view. Returns false and
+// reports an error on failure.
+extern JS_PUBLIC_API SafeStringTaint
+JS_GetArrayBufferOrViewTaint(JSObject* obj);
+
+extern JS_PUBLIC_API bool
+JS_SetArrayBufferOrViewTaint(JSContext* cx, JS::HandleObject obj, const StringTaint& taint);
+
 // Taintfox: Create new String Taint Location from the context
 extern JS_PUBLIC_API TaintOperation
 JS_GetTaintOperation(JSContext* cx, const char* name, JS::HandleValue args);
@@ -20,6 +20,7 @@
 #include "mozilla/Atomics.h"
 #include "mozilla/Casting.h"
 #include "mozilla/FloatingPoint.h"
+#include "mozilla/HashFunctions.h"
 #include "mozilla/Sprintf.h"
 #include "mozilla/TextUtils.h"
 
@@ -865,7 +866,7 @@ static int DaysInMonth(int year, int month) {
  */
 template <typename CharT>
 static bool ParseISOStyleDate(const CharT* s, size_t length,
-                              ClippedTime* result) {
+                              ClippedTime* result, bool* usesLocalTime) {
   size_t i = 0;
   size_t pre = 0;
   int tzMul = 1;
@@ -1020,6 +1021,7 @@ done:
   }
 
   *result = TimeClip(msec);
+  *usesLocalTime = isLocalTime;
   return NumbersAreIdentical(msec, result->toDouble());
 
 #undef PEEK
@@ -1084,12 +1086,189 @@ constexpr size_t MinKeywordLength(const CharsAndAction (&keywords)[N]) {
   return min;
 }
 
+static constexpr const char* const shortDayNames[] = {
+    "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+static constexpr const char* const shortMonthNames[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+/*
+ * If s[*i] starts one of the three letter names in |names|, advance *i past it
+ * and return its index. Otherwise return -1.
+ */
+template <typename CharT, size_t N>
+static int ParseShortName(const char* const (&names)[N], const CharT* s,
+                          size_t* i, size_t limit) {
+  if (limit - *i < 3) {
+    return -1;
+  }
+  for (size_t n = 0; n < N; n++) {
+    const char* name = names[n];
+    if (s[*i] == CharT(name[0]) && s[*i + 1] == CharT(name[1]) &&
+        s[*i + 2] == CharT(name[2])) {
+      *i += 3;
+      return int(n);
+    }
+  }
+  return -1;
+}
+
+/*
+ * Parse the date formats which are most common after ISO 8601: the RFC 2822
+ * format used by HTTP headers, feeds and Date.prototype.toUTCString, and the
+ * format of Date.prototype.toString.
+ *
+ *   [Www, ]DD Mmm YYYY hh:mm[:ss] TZ
+ *   [Www ]Mmm DD YYYY hh:mm[:ss] TZ[ (comment)]
+ *
+ * where
+ *
+ *   Www  = English day of week: Mon, Tue, Wed, Thu, Fri, Sat or Sun
+ *   Mmm  = English month: Jan, Feb, ..., Dec
+ *   DD   = one or two-digit day of month (1 through 31)
+ *   YYYY = four-digit year
+ *   hh   = one or two-digit hour (0 through 23)
+ *   mm   = two-digit minute (00 through 59)
+ *   ss   = two-digit second (00 through 59)
+ *   TZ   = GMT, UT or UTC, optionally followed by an offset, or just an
+ *          offset. An offset is a sign followed by four digits: +hhmm.
+ *
+ * The comment is any text without parentheses, e.g. the time zone name added
+ * by Date.prototype.toString.
+ *
+ * These strings used to be parsed by the general date parser below, so this
+ * must give the same result for all strings it accepts. It rejects everything
+ * else, including valid variations of the formats above, which then go to the
+ * general parser. Unlike the latter, this only parses dates with a time zone,
+ * so its results don't depend on the local time zone.
+ */
 template <typename CharT>
-static bool ParseDate(const CharT* s, size_t length, ClippedTime* result) {
-  if (ParseISOStyleDate(s, length, result)) {
-    return true;
+static bool ParseRFC2822StyleDate(const CharT* s, size_t length,
+                                  ClippedTime* result) {
+  size_t i = 0;
+  size_t day = 0;
+  size_t year = 0;
+  size_t hour = 0;
+  size_t min = 0;
+  size_t sec = 0;
+  size_t tzHour = 0;
+  size_t tzMin = 0;
+  int tzMul = 1;
+
+#define PEEK(ch) (i < length && s[i] == ch)
+
+#define NEED(ch)                   \
+  if (i >= length || s[i] != ch) { \
+    return false;                  \
+  } else {                         \
+    ++i;                           \
   }
 
+#define NEED_NDIGITS(n, field)                   \
+  if (!ParseDigitsN(n, &field, s, &i, length)) { \
+    return false;                                \
+  }
+
+  // The day of week is ignored, as by the general parser.
+  if (ParseShortName(shortDayNames, s, &i, length) >= 0) {
+    if (PEEK(',')) {
+      ++i;
+    }
+    NEED(' ');
+  }
+
+  int month = ParseShortName(shortMonthNames, s, &i, length);
+  if (month >= 0) {
+    NEED(' ');
+    if (!ParseDigitsNOrLess(2, &day, s, &i, length)) {
+      return false;
+    }
+  } else {
+    if (!ParseDigitsNOrLess(2, &day, s, &i, length)) {
+      return false;
+    }
+    NEED(' ');
+    month = ParseShortName(shortMonthNames, s, &i, length);
+    if (month < 0) {
+      return false;
+    }
+  }
+  NEED(' ');
+  NEED_NDIGITS(4, year);
+  NEED(' ');
+
+  if (!ParseDigitsNOrLess(2, &hour, s, &i, length)) {
+    return false;
+  }
+  NEED(':');
+  NEED_NDIGITS(2, min);
+  if (PEEK(':')) {
+    ++i;
+    NEED_NDIGITS(2, sec);
+  }
+  NEED(' ');
+
+  bool hasZoneName = false;
+  if (PEEK('G')) {
+    ++i;
+    NEED('M');
+    NEED('T');
+    hasZoneName = true;
+  } else if (PEEK('U')) {
+    ++i;
+    NEED('T');
+    if (PEEK('C')) {
+      ++i;
+    }
+    hasZoneName = true;
+  }
+  if (PEEK('+') || PEEK('-')) {
+    if (PEEK('+')) {
+      tzMul = -1;
+    }
+    ++i;
+    NEED_NDIGITS(2, tzHour);
+    NEED_NDIGITS(2, tzMin);
+  } else if (!hasZoneName) {
+    return false;
+  }
+
+  if (PEEK(' ')) {
+    ++i;
+    NEED('(');
+    while (i < length && s[i] != '(' && s[i] != ')') {
+      ++i;
+    }
+    NEED(')');
+  }
+
+#undef PEEK
+#undef NEED
+#undef NEED_NDIGITS
+
+  if (i != length || day == 0 || day > 31 || hour > 23 || min > 59 ||
+      sec > 59 || tzHour > 23 || tzMin > 59) {
+    return false;
+  }
+
+  // Offsets are minutes west of UTC, as in the general parser.
+  int tzOffset = tzMul * int(tzHour * 60 + tzMin);
+  double msec =
+      MakeDate(MakeDay(year, month, day), MakeTime(hour, min, sec, 0));
+  msec += tzOffset * msPerMinute;
+
+  *result = TimeClip(msec);
+  return true;
+}
+
+/*
+ * Parse a date in any of the formats accepted by Date.parse, other than the
+ * ISO 8601 style formats parsed above.
+ */
+template <typename CharT>
+static bool ParseGeneralDate(const CharT* s, size_t length,
+                             ClippedTime* result, bool* usesLocalTime) {
   if (length == 0) {
     return false;
   }
@@ -1491,14 +1670,107 @@ static bool ParseDate(const CharT* s, size_t length, ClippedTime* result) {
   }
 
   *result = TimeClip(msec);
+  *usesLocalTime = tzOffset == -1;
+  return true;
+}
+
+template <typename CharT>
+static bool ParseDate(const CharT* s, size_t length, ClippedTime* result,
+                      bool* usesLocalTime) {
+  if (ParseISOStyleDate(s, length, result, usesLocalTime)) {
+    return true;
+  }
+
+  if (ParseRFC2822StyleDate(s, length, result)) {
+    *usesLocalTime = false;
+    return true;
+  }
+
+  return ParseGeneralDate(s, length, result, usesLocalTime);
+}
+
+static bool ParseDate(JSLinearString* s, ClippedTime* result,
+                      bool* usesLocalTime) {
+  AutoCheckCannotGC nogc;
+  return s->hasLatin1Chars()
+             ? ParseDate(s->latin1Chars(nogc), s->length(), result,
+                         usesLocalTime)
+             : ParseDate(s->twoByteChars(nogc), s->length(), result,
+                         usesLocalTime);
+}
+
+bool js::ParseDate(JSContext* cx, JSLinearString* s, ClippedTime* result) {
+  DateParseCache& cache = cx->realm()->dateParseCache;
+  bool cacheable = DateParseCache::isCacheable(s);
+  double time;
+  if (cacheable && cache.lookup(s, &time)) {
+    *result = TimeClip(time);
+    return true;
+  }
+
+  bool usesLocalTime;
+  if (!::ParseDate(s, result, &usesLocalTime)) {
+    return false;
+  }
+
+  if (cacheable && !usesLocalTime) {
+    cache.add(s, result->toDouble());
+  }
   return true;
 }
 
-static bool ParseDate(JSLinearString* s, ClippedTime* result) {
+template <typename CharT>
+static bool ParseDateWithGeneralParser(const CharT* s, size_t length,
+                                       ClippedTime* result) {
+  bool usesLocalTime;
+  return ParseISOStyleDate(s, length, result, &usesLocalTime) ||
+         ParseGeneralDate(s, length, result, &usesLocalTime);
+}
+
+bool js::ParseDateWithGeneralParser(JSLinearString* s, ClippedTime* result) {
   AutoCheckCannotGC nogc;
   return s->hasLatin1Chars()
-             ? ParseDate(s->latin1Chars(nogc), s->length(), result)
-             : ParseDate(s->twoByteChars(nogc), s->length(), result);
+             ? ::ParseDateWithGeneralParser(s->latin1Chars(nogc), s->length(),
+                                            result)
+             : ::ParseDateWithGeneralParser(s->twoByteChars(nogc),
+                                            s->length(), result);
+}
+
+/* static */
+bool js::DateParseCache::isCacheable(JSLinearString* str) {
+  return str->hasLatin1Chars() && str->length() > 0 &&
+         str->length() <= MaxInputLength;
+}
+
+bool js::DateParseCache::lookup(JSLinearString* str, double* time) {
+  MOZ_ASSERT(isCacheable(str));
+
+  AutoCheckCannotGC nogc;
+  const Latin1Char* chars = str->latin1Chars(nogc);
+  size_t length = str->length();
+  Entry& entry =
+      entries_[mozilla::HashString(chars, length) & (NumEntries - 1)];
+  if (entry.length != length || memcmp(entry.chars, chars, length) != 0) {
+    misses_++;
+    return false;
+  }
+
+  hits_++;
+  *time = entry.time;
+  return true;
+}
+
+void js::DateParseCache::add(JSLinearString* str, double time) {
+  MOZ_ASSERT(isCacheable(str));
+
+  AutoCheckCannotGC nogc;
+  const Latin1Char* chars = str->latin1Chars(nogc);
+  size_t length = str->length();
+  Entry& entry =
+      entries_[mozilla::HashString(chars, length) & (NumEntries - 1)];
+  entry.length = length;
+  memcpy(entry.chars, chars, length);
+  entry.time = time;
 }
 
 static bool date_parse(JSContext* cx, unsigned argc, Value* vp) {
@@ -1520,7 +1792,7 @@ static bool date_parse(JSContext* cx, unsigned argc, Value* vp) {
   }
 
   ClippedTime result;
-  if (!ParseDate(linearStr, &result)) {
+  if (!ParseDate(cx, linearStr, &result)) {
     args.rval().setNaN();
     return true;
   }
@@ -3379,7 +3651,7 @@ static bool DateOneArgument(JSContext* cx, const CallArgs& args) {
         return false;
       }
 
-      if (!ParseDate(linearStr, &t)) {
+      if (!ParseDate(cx, linearStr, &t)) {
         t = ClippedTime::invalid();
       }
     } else {
@@ -17,6 +17,8 @@
 #include "js/RootingAPI.h"
 #include "js/TypeDecls.h"
 
+class JSLinearString;
+
 namespace js {
 
 /*
@@ -41,6 +43,20 @@ extern JS_PUBLIC_API JSObject* NewDateObject(JSContext* cx, int year, int mon,
                                              int mday, int hour, int min,
                                              int sec);
 
+/*
+ * Parse a string as Date.parse does. Results are cached in the realm's
+ * DateParseCache.
+ */
+extern bool ParseDate(JSContext* cx, JSLinearString* str,
+                      JS::ClippedTime* result);
+
+/*
+ * Parse a string with the ISO 8601 and general date parsers only, and not the
+ * faster parsers for other common formats. For testing the latter.
+ */
+extern bool ParseDateWithGeneralParser(JSLinearString* str,
+                                       JS::ClippedTime* result);
+
 /* Date methods exposed so they can be installed in the self-hosting global. */
 bool date_now(JSContext* cx, unsigned argc, JS::Value* vp);
 
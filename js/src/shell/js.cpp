@@ -183,6 +183,7 @@
 #include "util/Text.h"
 #include "util/WindowsWrapper.h"
 #include "vm/ArgumentsObject.h"
+#include "vm/BytecodeUtil.h"  // js::DumpRealmPCCounts, js::OpPairProfile
 #include "vm/Compression.h"
 #include "vm/ErrorObject.h"
 #include "vm/ErrorReporting.h"
@@ -590,6 +591,7 @@ const char* shell::selfHostedXDRPath = nullptr;
 bool shell::encodeSelfHostedCode = false;
 bool shell::enableCodeCoverage = false;
 bool shell::enableDisassemblyDumps = false;
+int32_t shell::opPairProfileCount = -1;
 bool shell::offthreadCompilation = false;
 JS::DelazificationOption shell::defaultDelazificationMode =
     JS::DelazificationOption::OnDemandOnly;
@@ -10955,6 +10957,16 @@ static bool SetContextOptions(JSContext* cx, const OptionParser& op) {
     jit::JitOptions.setEagerBaselineCompilation();
   }
 
+  if (const char* str = op.getStringOption("baseline-offthread-compile")) {
+    if (strcmp(str, "on") == 0) {
+      jit::JitOptions.baselineOffThreadCompile = true;
+    } else if (strcmp(str, "off") == 0) {
+      jit::JitOptions.baselineOffThreadCompile = false;
+    } else {
+      return OptionFailure("baseline-offthread-compile", str);
+    }
+  }
+
   if (op.getBoolOption("blinterp")) {
     jit::JitOptions.baselineInterpreter = true;
   }
@@ -11128,6 +11140,18 @@ static bool SetContextOptions(JSContext* cx, const OptionParser& op) {
   cx->runtime()->profilingScripts =
       enableCodeCoverage || enableDisassemblyDumps;
 
+  opPairProfileCount = op.getIntOption("op-pair-profile");
+  if (opPairProfileCount >= 0) {
+    // Only the C++ interpreter collects the profile.
+    jit::JitOptions.baselineInterpreter = false;
+    jit::JitOptions.baselineJit = false;
+    jit::JitOptions.ion = false;
+    cx->runtime()->opPairProfile = cx->make_unique<OpPairProfile>();
+    if (!cx->runtime()->opPairProfile.ref()) {
+      return false;
+    }
+  }
+
 #ifdef DEBUG
   dumpEntrainedVariables = op.getBoolOption("dump-entrained-variables");
 #endif
@@ -11417,6 +11441,12 @@ static int Shell(JSContext* cx, OptionParser* op) {
       }
     }
 
+    if (opPairProfileCount >= 0) {
+      if (!cx->runtime()->opPairProfile->dump(stdout, opPairProfileCount)) {
+        result = EXITCODE_OUT_OF_MEMORY;
+      }
+    }
+
     // End REPRL loop
   } while (reprl_mode);
 
@@ -11647,6 +11677,11 @@ int main(int argc, char** argv) {
       !op.addBoolOption('W', "nowarnings", "Don't emit warnings") ||
       !op.addBoolOption('D', "dump-bytecode",
                         "Dump bytecode with exec count for all scripts") ||
+      !op.addIntOption('\0', "op-pair-profile", "COUNT",
+                       "Run scripts in the C++ interpreter and print the COUNT "
+                       "pairs of consecutive ops executed most often at exit, "
+                       "to choose the superinstructions",
+                       -1) ||
       !op.addBoolOption('b', "print-timing",
                         "Print sub-ms runtime for each file that's run") ||
       !op.addBoolOption('\0', "code-coverage",
@@ -11869,6 +11904,9 @@ int main(int argc, char** argv) {
           "Wait for COUNT calls or iterations before baseline-compiling "
           "(default: 10)",
           -1) ||
+      !op.addStringOption('\0', "baseline-offthread-compile", "on/off",
+                          "Compile warm scripts with the baseline compiler in "
+                          "batches on helper threads (default: off)") ||
       !op.addBoolOption('\0', "blinterp",
                         "Enable Baseline Interpreter (default)") ||
       !op.addBoolOption('\0', "no-blinterp", "Disable Baseline Interpreter") ||
@@ -105,6 +105,7 @@ extern const char* selfHostedXDRPath;
 extern bool encodeSelfHostedCode;
 extern bool enableCodeCoverage;
 extern bool enableDisassemblyDumps;
+extern int32_t opPairProfileCount;
 extern bool offthreadCompilation;
 extern JS::DelazificationOption defaultDelazificationMode;
 extern bool enableAsmJS;
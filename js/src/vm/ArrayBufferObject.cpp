@@ -520,6 +520,9 @@ void ArrayBufferObject::detach(JSContext* cx,
     buffer->setDataPointer(BufferContents::createNoData());
   }
 
+  // TaintFox: the tainted bytes are gone.
+  buffer->clearTaint();
+
   buffer->setByteLength(0);
   buffer->setIsDetached();
 }
@@ -1637,6 +1640,72 @@ void ArrayBufferObject::copyData(Handle<ArrayBufferObject*> toBuffer,
 
   memcpy(toBuffer->dataPointer() + toIndex,
          fromBuffer->dataPointer() + fromIndex, count);
+
+  copyTaint(toBuffer, toIndex, fromBuffer, fromIndex, count);
+}
+
+/* static */
+void ArrayBufferObject::copyTaint(ArrayBufferObject* toBuffer, size_t toIndex,
+                                  const ArrayBufferObject* fromBuffer,
+                                  size_t fromIndex, size_t count) {
+  // Fast path: nothing to do unless one of the buffers is tainted.
+  bool fromTainted = fromBuffer && fromBuffer->isTainted();
+  if (!fromTainted && !toBuffer->isTainted()) {
+    return;
+  }
+
+  SafeStringTaint taint;
+  if (const StringTaint* toTaint = toBuffer->maybeTaint()) {
+    taint = *toTaint;
+    taint.clearBetween(toIndex, toIndex + count);
+  }
+  if (fromTainted) {
+    const StringTaint* fromTaint = fromBuffer->maybeTaint();
+    taint.insert(toIndex,
+                 fromTaint->safeSubTaint(fromIndex, fromIndex + count));
+  }
+
+  // On OOM setTaint leaves the buffer untainted.
+  (void)toBuffer->setTaint(taint);
+}
+
+const StringTaint* ArrayBufferObject::maybeTaint() const {
+  if (!isTainted()) {
+    return nullptr;
+  }
+
+  auto& map = ObjectRealm::get(this).arrayBufferTaint.get();
+  auto p = map.lookup(const_cast<ArrayBufferObject*>(this));
+  MOZ_ASSERT(p, "tainted buffers must have a taint map entry");
+  return p ? &p->value() : nullptr;
+}
+
+bool ArrayBufferObject::setTaint(const StringTaint& taint) {
+  if (!taint.hasTaint()) {
+    clearTaint();
+    return true;
+  }
+
+  auto& map = ObjectRealm::get(this).arrayBufferTaint.get();
+  auto p = map.lookupForAdd(this);
+  if (p) {
+    p->value() = taint;
+  } else if (!map.add(p, this, SafeStringTaint(taint))) {
+    clearTaint();
+    return false;
+  }
+
+  setFlags(flags() | TAINTED);
+  return true;
+}
+
+void ArrayBufferObject::clearTaint() {
+  if (!isTainted()) {
+    return;
+  }
+
+  ObjectRealm::get(this).arrayBufferTaint.get().remove(this);
+  setFlags(flags() & ~TAINTED);
 }
 
 /* static */
@@ -16,6 +16,7 @@
 #include "gc/ZoneAllocator.h"
 #include "js/ArrayBuffer.h"
 #include "js/GCHashTable.h"
+#include "Taint.h"
 #include "vm/JSFunction.h"
 #include "vm/JSObject.h"
 #include "vm/SharedMem.h"
@@ -243,6 +244,10 @@ class ArrayBufferObject : public ArrayBufferObjectMaybeShared {
     // INLINE_DATA buffer is used with asm.js, it's silently rewritten into a
     // MALLOCED buffer which *can* be prepared.)
     FOR_ASMJS = 0b10'0000,
+
+    // TaintFox: this buffer has an entry in the ArrayBufferTaintMap of its
+    // realm.
+    TAINTED = 0b100'0000,
   };
 
   static_assert(JS_ARRAYBUFFER_DETACHED_FLAG == DETACHED,
@@ -365,6 +370,15 @@ class ArrayBufferObject : public ArrayBufferObjectMaybeShared {
                        Handle<ArrayBufferObject*> fromBuffer, size_t fromIndex,
                        size_t count);
 
+  // TaintFox: copies the taint of |count| bytes starting at |fromIndex| in
+  // |fromBuffer| to |toIndex| in |toBuffer|, replacing any previous taint of
+  // the target bytes. |fromBuffer| may be null if the source bytes are not
+  // stored in a buffer (and thus untainted). Taint propagation is best effort,
+  // on OOM the target buffer is left untainted.
+  static void copyTaint(ArrayBufferObject* toBuffer, size_t toIndex,
+                        const ArrayBufferObject* fromBuffer, size_t fromIndex,
+                        size_t count);
+
   static size_t objectMoved(JSObject* obj, JSObject* old);
 
   static uint8_t* stealMallocedContents(JSContext* cx,
@@ -441,6 +455,18 @@ class ArrayBufferObject : public ArrayBufferObjectMaybeShared {
   bool isDetached() const { return flags() & DETACHED; }
   bool isPreparedForAsmJS() const { return flags() & FOR_ASMJS; }
 
+  // TaintFox: byte granular taint information, see ArrayBufferTaintMap.
+  // Taint ranges are indexed by byte offset into the buffer.
+  bool isTainted() const { return flags() & TAINTED; }
+
+  // Returns the taint of this buffer, or nullptr if it is untainted.
+  const StringTaint* maybeTaint() const;
+
+  // Replaces the taint of this buffer. Returns false on OOM, in which case the
+  // buffer is left untainted. Does not report an error.
+  [[nodiscard]] bool setTaint(const StringTaint& taint);
+  void clearTaint();
+
   // WebAssembly support:
 
   /**
@@ -577,6 +603,17 @@ class MutableWrappedPtrOperations<InnerViewTable, Wrapper>
   }
 };
 
+// TaintFox: per-realm table holding the byte granular taint information of
+// array buffers.
+//
+// Only tainted buffers have an entry (and the TAINTED flag set), so untainted
+// buffers never need to look at this table and don't pay for taint tracking
+// in any way. Entries are removed when their buffer dies or is detached.
+using ArrayBufferTaintMap =
+    GCHashMap<WeakHeapPtr<ArrayBufferObject*>, SafeStringTaint,
+              MovableCellHasher<WeakHeapPtr<ArrayBufferObject*>>,
+              ZoneAllocPolicy>;
+
 class WasmArrayRawBuffer {
   wasm::IndexType indexType_;
   wasm::Pages clampedMaxPages_;
@@ -645,4 +682,9 @@ class WasmArrayRawBuffer {
 template <>
 bool JSObject::is<js::ArrayBufferObjectMaybeShared>() const;
 
+namespace JS {
+template <>
+struct GCPolicy<SafeStringTaint> : public IgnoreGCPolicy<SafeStringTaint> {};
+}  // namespace JS
+
 #endif  // vm_ArrayBufferObject_h
@@ -6,6 +6,8 @@
 
 #include "vm/ArrayBufferViewObject.h"
 
+#include "jsapi.h"  // JS_{Get,Set}ArrayBufferOrViewTaint
+
 #include "builtin/DataViewObject.h"
 #include "gc/Nursery.h"
 #include "js/experimental/TypedData.h"  // JS_GetArrayBufferView{Data,Buffer,Length,ByteOffset}, JS_GetObjectAsArrayBufferView, JS_IsArrayBufferViewObject
@@ -317,3 +319,84 @@ JS_PUBLIC_API bool JS::IsLargeArrayBufferView(JSObject* obj) {
   return false;
 #endif
 }
+
+// TaintFox: byte granular taint information of array buffers and views.
+
+JS_PUBLIC_API SafeStringTaint JS_GetArrayBufferOrViewTaint(JSObject* obj) {
+  if (ArrayBufferObject* buffer = obj->maybeUnwrapIf<ArrayBufferObject>()) {
+    const StringTaint* taint = buffer->maybeTaint();
+    return taint ? SafeStringTaint(*taint) : SafeStringTaint();
+  }
+
+  obj = obj->maybeUnwrapIf<ArrayBufferViewObject>();
+  if (!obj) {
+    return SafeStringTaint();
+  }
+
+  // Views without a buffer (yet) and views on shared memory are never
+  // tainted.
+  auto& view = obj->as<ArrayBufferViewObject>();
+  if (!view.hasBuffer() || view.isSharedMemory()) {
+    return SafeStringTaint();
+  }
+  const StringTaint* taint = view.bufferUnshared()->maybeTaint();
+  if (!taint) {
+    return SafeStringTaint();
+  }
+
+  size_t offset = JS_GetArrayBufferViewByteOffset(obj);
+  size_t length = JS_GetArrayBufferViewByteLength(obj);
+  return taint->safeSubTaint(offset, offset + length);
+}
+
+JS_PUBLIC_API bool JS_SetArrayBufferOrViewTaint(JSContext* cx, HandleObject obj,
+                                                const StringTaint& taint) {
+  AssertHeapIsIdle();
+  CHECK_THREAD(cx);
+  cx->check(obj);
+
+  if (ArrayBufferObject* buffer = obj->maybeUnwrapIf<ArrayBufferObject>()) {
+    if (!buffer->setTaint(taint)) {
+      ReportOutOfMemory(cx);
+      return false;
+    }
+    return true;
+  }
+
+  Rooted<ArrayBufferViewObject*> unwrappedView(
+      cx, obj->maybeUnwrapIf<ArrayBufferViewObject>());
+  if (!unwrappedView || unwrappedView->isSharedMemory()) {
+    // Shared memory and other objects don't carry taint information.
+    return true;
+  }
+
+  // Taint is stored per buffer, so make sure the view has one.
+  ArrayBufferObjectMaybeShared* unwrappedBuffer;
+  {
+    AutoRealm ar(cx, unwrappedView);
+    unwrappedBuffer = ArrayBufferViewObject::bufferObject(cx, unwrappedView);
+    if (!unwrappedBuffer) {
+      return false;
+    }
+  }
+  if (!unwrappedBuffer->is<ArrayBufferObject>()) {
+    return true;
+  }
+
+  ArrayBufferObject* buffer = &unwrappedBuffer->as<ArrayBufferObject>();
+  size_t offset = JS_GetArrayBufferViewByteOffset(unwrappedView);
+  size_t length = JS_GetArrayBufferViewByteLength(unwrappedView);
+
+  SafeStringTaint bufferTaint;
+  if (const StringTaint* previous = buffer->maybeTaint()) {
+    bufferTaint = *previous;
+    bufferTaint.clearBetween(offset, offset + length);
+  }
+  bufferTaint.insert(offset, SafeStringTaint(taint, 0, length));
+
+  if (!buffer->setTaint(bufferTaint)) {
+    ReportOutOfMemory(cx);
+    return false;
+  }
+  return true;
+}
@@ -158,6 +158,13 @@ class BytecodeLocation {
                             rawBytecode_ + GetBytecodeLength(rawBytecode_));
   }
 
+  // Return the second of the two ops fused by a superinstruction.
+  BytecodeLocation superinstructionSecond() const {
+    MOZ_ASSERT(IsSuperinstruction(getOp()));
+    return BytecodeLocation(
+        *this, rawBytecode_ + GetOpLength(SuperinstructionFirstOp(getOp())));
+  }
+
   // Add an offset.
   BytecodeLocation operator+(const BytecodeLocationOffset& offset) {
     return BytecodeLocation(*this, rawBytecode_ + offset.rawOffset());
@@ -224,6 +224,51 @@ bool js::DumpRealmPCCounts(JSContext* cx) {
   return true;
 }
 
+void OpPairProfile::recordPC(const jsbytecode* pc) {
+  JSOp op = JSOp(*pc);
+  if (IsSuperinstruction(op)) {
+    JSOp first = SuperinstructionFirstOp(op);
+    record(first);
+    op = JSOp(pc[GetOpLength(first)]);
+  }
+  record(op);
+}
+
+bool OpPairProfile::dump(FILE* fp, size_t count) const {
+  struct Pair {
+    JSOp first;
+    JSOp second;
+    uint64_t count;
+  };
+  Vector<Pair, 0, SystemAllocPolicy> pairs;
+  uint64_t total = 0;
+  for (size_t i = 0; i < JSOP_LIMIT; i++) {
+    for (size_t j = 0; j < JSOP_LIMIT; j++) {
+      if (!counts_[i][j]) {
+        continue;
+      }
+      if (!pairs.append(Pair{JSOp(i), JSOp(j), counts_[i][j]})) {
+        return false;
+      }
+      total += counts_[i][j];
+    }
+  }
+
+  std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) {
+    return a.count > b.count;
+  });
+
+  fprintf(fp, "--- OP PAIRS (%" PRIu64 " executed) ---\n", total);
+  for (size_t i = 0; i < std::min(count, pairs.length()); i++) {
+    const Pair& pair = pairs[i];
+    fprintf(fp, "%12" PRIu64 " %5.2f%%  %s; %s\n", pair.count,
+            100.0 * double(pair.count) / double(total), CodeName(pair.first),
+            CodeName(pair.second));
+  }
+  fprintf(fp, "--- END OP PAIRS ---\n");
+  return true;
+}
+
 /////////////////////////////////////////////////////////////////////
 // Bytecode Parser
 /////////////////////////////////////////////////////////////////////
@@ -1617,12 +1662,20 @@ static unsigned Disassemble1(JSContext* cx, HandleScript script, jsbytecode* pc,
       if (!sp->jsprintf(" %u", GET_ARGNO(pc))) {
         return 0;
       }
+      if (op == JSOp::GetArgPair &&
+          !sp->jsprintf(" %u", GET_ARGNO(pc + JSOpLength_GetArg))) {
+        return 0;
+      }
       break;
 
     case JOF_LOCAL:
       if (!sp->jsprintf(" %u", GET_LOCALNO(pc))) {
         return 0;
       }
+      if (op == JSOp::GetLocalPair &&
+          !sp->jsprintf(" %u", GET_LOCALNO(pc + JSOpLength_GetLocal))) {
+        return 0;
+      }
       break;
 
     case JOF_GCTHING:
@@ -1823,6 +1876,16 @@ bool ExpressionDecompiler::decompilePC(jsbytecode* pc, uint8_t defIndex) {
     }
   }
 
+  // The values pushed by a superinstruction are decompiled as the ones pushed
+  // by the ops it fuses.
+  if (IsSuperinstruction(op)) {
+    if (defIndex == 1) {
+      pc += GetOpLength(SuperinstructionFirstOp(op));
+      defIndex = 0;
+    }
+    op = SuperinstructionFirstOp(op);
+  }
+
   switch (op) {
     case JSOp::DelName:
       return write("(delete ") && write(loadAtom(pc)) && write(")");
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #include "jstypes.h"
 #include "NamespaceImports.h"
@@ -427,6 +428,28 @@ inline bool IsArgOp(JSOp op) { return JOF_OPTYPE(op) == JOF_QARG; }
 
 inline bool IsLocalOp(JSOp op) { return JOF_OPTYPE(op) == JOF_LOCAL; }
 
+inline bool IsSuperinstruction(JSOp op) {
+  return op == JSOp::GetArgPair || op == JSOp::GetLocalPair ||
+         op == JSOp::SetLocalPop;
+}
+
+// Superinstructions keep the bytecode of the two instructions they fuse in
+// place, see "Superinstructions" in Opcodes.h. Return the first of them; the
+// second one starts |GetOpLength(SuperinstructionFirstOp(op))| bytes after
+// the superinstruction.
+inline JSOp SuperinstructionFirstOp(JSOp op) {
+  switch (op) {
+    case JSOp::GetArgPair:
+      return JSOp::GetArg;
+    case JSOp::GetLocalPair:
+      return JSOp::GetLocal;
+    case JSOp::SetLocalPop:
+      return JSOp::SetLocal;
+    default:
+      MOZ_CRASH("Not a superinstruction");
+  }
+}
+
 inline bool IsAliasedVarOp(JSOp op) { return JOF_OPTYPE(op) == JOF_ENVCOORD; }
 
 inline bool IsGlobalOp(JSOp op) { return CodeSpec(op).format & JOF_GNAME; }
@@ -622,6 +645,42 @@ class PCCounts {
   static const char numExecName[];
 };
 
+/*
+ * Counts how often each pair of opcodes is executed in a row by the C++
+ * interpreter, to choose the pairs worth fusing into superinstructions. The
+ * profile is only collected when the shell's --op-pair-profile option is used,
+ * see JSRuntime::opPairProfile. Superinstructions are counted as the two
+ * opcodes they fuse, so that the profile doesn't depend on the ones which
+ * already exist.
+ */
+class OpPairProfile {
+  uint64_t counts_[JSOP_LIMIT][JSOP_LIMIT] = {};
+  bool hasPrevious_ = false;
+  JSOp previous_ = JSOp::Nop;
+
+  void record(JSOp op) {
+    if (hasPrevious_) {
+      counts_[size_t(previous_)][size_t(op)]++;
+    }
+    previous_ = op;
+    hasPrevious_ = true;
+  }
+
+ public:
+  void recordPC(const jsbytecode* pc);
+
+  uint64_t count(JSOp first, JSOp second) const {
+    return counts_[size_t(first)][size_t(second)];
+  }
+
+  // Pairs don't span calls and returns: the interpreter resets the profile
+  // when it switches to another script.
+  void resetPrevious() { hasPrevious_ = false; }
+
+  // Print the |count| most frequent pairs. Returns false on OOM.
+  [[nodiscard]] bool dump(FILE* fp, size_t count) const;
+};
+
 static inline jsbytecode* GetNextPc(jsbytecode* pc) {
   return pc + GetBytecodeLength(pc);
 }
@@ -392,6 +392,7 @@
   MACRO_(outOfMemory, outOfMemory, "out of memory")                            \
   MACRO_(ownKeys, ownKeys, "ownKeys")                                          \
   MACRO_(package, package, "package")                                          \
+  MACRO_(parallel, parallel, "parallel")                                       \
   MACRO_(parameters, parameters, "parameters")                                 \
   MACRO_(parseFloat, parseFloat, "parseFloat")                                 \
   MACRO_(parseInt, parseInt, "parseInt")                                       \
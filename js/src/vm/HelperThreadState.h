@@ -42,6 +42,7 @@ struct PromiseHelperTask;
 class PromiseObject;
 
 namespace jit {
+class BaselineCompileTask;
 class IonCompileTask;
 class IonFreeTask;
 }  // namespace jit
@@ -98,6 +99,8 @@ class GlobalHelperThreadState {
 
   bool terminating_ = false;
 
+  using BaselineCompileTaskVector =
+      Vector<jit::BaselineCompileTask*, 0, SystemAllocPolicy>;
   typedef Vector<jit::IonCompileTask*, 0, SystemAllocPolicy>
       IonCompileTaskVector;
   using IonFreeTaskVector =
@@ -124,6 +127,9 @@ class GlobalHelperThreadState {
  private:
   // The lists below are all protected by |lock|.
 
+  // Baseline compilation worklist and finished batches.
+  BaselineCompileTaskVector baselineWorklist_, baselineFinishedList_;
+
   // Ion compilation worklist and finished jobs.
   IonCompileTaskVector ionWorklist_, ionFinishedList_;
   IonFreeTaskVector ionFreeList_;
@@ -198,6 +204,7 @@ class GlobalHelperThreadState {
   void addSizeOfIncludingThis(JS::GlobalStats* stats,
                               const AutoLockHelperThreadState& lock) const;
 
+  size_t maxBaselineCompilationThreads() const;
   size_t maxIonCompilationThreads() const;
   size_t maxWasmCompilationThreads() const;
   size_t maxWasmTier2GeneratorThreads() const;
@@ -259,6 +266,15 @@ class GlobalHelperThreadState {
     vector.popBack();
   }
 
+  BaselineCompileTaskVector& baselineWorklist(
+      const AutoLockHelperThreadState&) {
+    return baselineWorklist_;
+  }
+  BaselineCompileTaskVector& baselineFinishedList(
+      const AutoLockHelperThreadState&) {
+    return baselineFinishedList_;
+  }
+
   IonCompileTaskVector& ionWorklist(const AutoLockHelperThreadState&) {
     return ionWorklist_;
   }
@@ -352,6 +368,7 @@ class GlobalHelperThreadState {
   bool canStartWasmTier2CompileTask(const AutoLockHelperThreadState& lock);
   bool canStartWasmTier2GeneratorTask(const AutoLockHelperThreadState& lock);
   bool canStartPromiseHelperTask(const AutoLockHelperThreadState& lock);
+  bool canStartBaselineCompileTask(const AutoLockHelperThreadState& lock);
   bool canStartIonCompileTask(const AutoLockHelperThreadState& lock);
   bool canStartIonFreeTask(const AutoLockHelperThreadState& lock);
   bool canStartParseTask(const AutoLockHelperThreadState& lock);
@@ -371,6 +388,8 @@ class GlobalHelperThreadState {
       const AutoLockHelperThreadState& lock);
   HelperThreadTask* maybeGetPromiseHelperTask(
       const AutoLockHelperThreadState& lock);
+  HelperThreadTask* maybeGetBaselineCompileTask(
+      const AutoLockHelperThreadState& lock);
   HelperThreadTask* maybeGetIonCompileTask(
       const AutoLockHelperThreadState& lock);
   HelperThreadTask* maybeGetLowPrioIonCompileTask(
@@ -447,6 +466,8 @@ class GlobalHelperThreadState {
   bool submitTask(wasm::CompileTask* task, wasm::CompileMode mode);
   bool submitTask(UniquePtr<jit::IonFreeTask> task,
                   const AutoLockHelperThreadState& lock);
+  bool submitTask(jit::BaselineCompileTask* task,
+                  const AutoLockHelperThreadState& locked);
   bool submitTask(jit::IonCompileTask* task,
                   const AutoLockHelperThreadState& locked);
   bool submitTask(UniquePtr<SourceCompressionTask> task,
@@ -18,6 +18,7 @@ struct FreeDelazifyTask;
 class SourceCompressionTask;
 
 namespace jit {
+class BaselineCompileTask;
 class IonCompileTask;
 class IonFreeTask;
 }  // namespace jit
@@ -28,6 +29,11 @@ struct Tier2GeneratorTask;
 template <typename T>
 struct MapTypeToThreadType {};
 
+template <>
+struct MapTypeToThreadType<jit::BaselineCompileTask> {
+  static const ThreadType threadType = THREAD_TYPE_BASELINE;
+};
+
 template <>
 struct MapTypeToThreadType<jit::IonCompileTask> {
   static const ThreadType threadType = THREAD_TYPE_ION;
@@ -19,6 +19,7 @@
 #include "frontend/FrontendContext.h"
 #include "frontend/ScopeBindingCache.h"  // frontend::ScopeBindingCache
 #include "gc/GC.h"
+#include "jit/BaselineCompileTask.h"
 #include "jit/IonCompileTask.h"
 #include "jit/JitRuntime.h"
 #include "jit/JitScript.h"
@@ -252,6 +253,37 @@ void js::CancelOffThreadWasmTier2Generator() {
   CancelOffThreadWasmTier2GeneratorLocked(lock);
 }
 
+bool js::StartOffThreadBaselineCompile(jit::BaselineCompileTask* task,
+                                       const AutoLockHelperThreadState& lock) {
+  return HelperThreadState().submitTask(task, lock);
+}
+
+bool GlobalHelperThreadState::submitTask(
+    jit::BaselineCompileTask* task, const AutoLockHelperThreadState& locked) {
+  MOZ_ASSERT(isInitialized(locked));
+
+  if (!baselineWorklist(locked).append(task)) {
+    return false;
+  }
+
+  dispatch(DispatchReason::NewTask, locked);
+  return true;
+}
+
+/*
+ * Move a batch of Baseline compilations which has either finished or been
+ * cancelled into the global finished list, to be linked by the main thread of
+ * its runtime.
+ */
+void js::FinishOffThreadBaselineCompile(jit::BaselineCompileTask* task,
+                                        const AutoLockHelperThreadState& lock) {
+  AutoEnterOOMUnsafeRegion oomUnsafe;
+  if (!HelperThreadState().baselineFinishedList(lock).append(task)) {
+    oomUnsafe.crash("FinishOffThreadBaselineCompile");
+  }
+  task->runtime()->jitRuntime()->numFinishedBaselineTasksRef(lock)++;
+}
+
 bool js::StartOffThreadIonCompile(jit::IonCompileTask* task,
                                   const AutoLockHelperThreadState& lock) {
   return HelperThreadState().submitTask(task, lock);
@@ -440,6 +472,124 @@ void js::CancelOffThreadIonCompile(const CompilationSelector& selector) {
   CancelOffThreadIonCompileLocked(selector, lock);
 }
 
+static bool BaselineScriptMatches(const CompilationSelector& selector,
+                                  JSScript* script) {
+  struct ScriptMatches {
+    JSScript* script_;
+
+    bool operator()(JSScript* script) { return script == script_; }
+    bool operator()(Realm* realm) { return realm == script_->realm(); }
+    bool operator()(Zone* zone) { return zone == script_->zoneFromAnyThread(); }
+    bool operator()(JSRuntime* runtime) {
+      return runtime == script_->runtimeFromAnyThread();
+    }
+    bool operator()(ZonesInState zbs) {
+      return zbs.runtime == script_->runtimeFromAnyThread() &&
+             zbs.state == script_->zoneFromAnyThread()->gcState();
+    }
+  };
+
+  return selector.match(ScriptMatches{script});
+}
+
+static bool BaselineCompileTaskMatches(const CompilationSelector& selector,
+                                       jit::BaselineCompileTask* task) {
+  for (size_t i = 0; i < task->numScripts(); i++) {
+    if (BaselineScriptMatches(selector, task->script(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Drops the matching scripts of the batches in |list|, and deletes the batches
+// which end up empty.
+static void CancelBaselineCompileTasksInList(
+    const CompilationSelector& selector, JSRuntime* runtime,
+    GlobalHelperThreadState::BaselineCompileTaskVector& list, bool finished,
+    AutoLockHelperThreadState& lock) {
+  for (size_t i = 0; i < list.length(); i++) {
+    jit::BaselineCompileTask* task = list[i];
+    if (task->runtime() != runtime) {
+      continue;
+    }
+
+    task->removeScripts([&](JSScript* script) {
+      return BaselineScriptMatches(selector, script);
+    });
+    if (task->numScripts()) {
+      continue;
+    }
+
+    HelperThreadState().remove(list, &i);
+    if (finished) {
+      runtime->jitRuntime()->numFinishedBaselineTasksRef(lock)--;
+    }
+    runtime->jitRuntime()->numBaselineBatchesInFlight()--;
+    js_delete(task);
+  }
+}
+
+void js::CancelOffThreadBaselineCompile(const CompilationSelector& selector) {
+  if (!JitDataStructuresExist(selector)) {
+    return;
+  }
+
+  JSRuntime* runtime = GetSelectorRuntime(selector);
+  jit::JitRuntime* jitRuntime = runtime->jitRuntime();
+
+  /* Drop the scripts of the batch which hasn't been submitted yet. */
+  jit::BaselineCompileTask*& pending = jitRuntime->pendingBaselineBatch();
+  if (pending) {
+    pending->removeScripts([&](JSScript* script) {
+      return BaselineScriptMatches(selector, script);
+    });
+    if (!pending->numScripts()) {
+      js_delete(pending);
+      pending = nullptr;
+    }
+  }
+
+  AutoLockHelperThreadState lock;
+  if (!HelperThreadState().isInitialized(lock)) {
+    return;
+  }
+
+  /* Cancel any batches for which processing hasn't started. */
+  CancelBaselineCompileTasksInList(selector, runtime,
+                                   HelperThreadState().baselineWorklist(lock),
+                                   /* finished = */ false, lock);
+
+  /*
+   * Stop in progress batches. The scripts they haven't compiled yet are
+   * skipped, and the batches are moved to the finished list.
+   */
+  bool cancelled;
+  do {
+    cancelled = false;
+    for (auto* helper : HelperThreadState().helperTasks(lock)) {
+      if (!helper->is<jit::BaselineCompileTask>()) {
+        continue;
+      }
+
+      jit::BaselineCompileTask* task = helper->as<jit::BaselineCompileTask>();
+      if (task->runtime() == runtime &&
+          BaselineCompileTaskMatches(selector, task)) {
+        task->cancel();
+        cancelled = true;
+      }
+    }
+    if (cancelled) {
+      HelperThreadState().wait(lock);
+    }
+  } while (cancelled);
+
+  /* Drop the code generated for the matching scripts. */
+  CancelBaselineCompileTasksInList(
+      selector, runtime, HelperThreadState().baselineFinishedList(lock),
+      /* finished = */ true, lock);
+}
+
 #ifdef DEBUG
 bool js::HasOffThreadIonCompile(Realm* realm) {
   AutoLockHelperThreadState lock;
@@ -1759,6 +1909,7 @@ void GlobalHelperThreadState::waitForAllTasksLocked(
   }
 
   MOZ_ASSERT(gcParallelWorklist().isEmpty(lock));
+  MOZ_ASSERT(baselineWorklist(lock).empty());
   MOZ_ASSERT(ionWorklist(lock).empty());
   MOZ_ASSERT(wasmWorklist(lock, wasm::CompileMode::Tier1).empty());
   MOZ_ASSERT(promiseHelperTasks(lock).empty());
@@ -1865,6 +2016,8 @@ void GlobalHelperThreadState::addSizeOfIncludingThis(
 
   // Report memory used by various containers
   htStats.stateData +=
+      baselineWorklist_.sizeOfExcludingThis(mallocSizeOf) +
+      baselineFinishedList_.sizeOfExcludingThis(mallocSizeOf) +
       ionWorklist_.sizeOfExcludingThis(mallocSizeOf) +
       ionFinishedList_.sizeOfExcludingThis(mallocSizeOf) +
       ionFreeList_.sizeOfExcludingThis(mallocSizeOf) +
@@ -1889,6 +2042,14 @@ void GlobalHelperThreadState::addSizeOfIncludingThis(
     htStats.parseTask += task->sizeOfIncludingThis(mallocSizeOf);
   }
 
+  // Report BaselineCompileTasks on wait lists
+  for (auto task : baselineWorklist_) {
+    htStats.baselineCompileTask += task->sizeOfExcludingThis(mallocSizeOf);
+  }
+  for (auto task : baselineFinishedList_) {
+    htStats.baselineCompileTask += task->sizeOfExcludingThis(mallocSizeOf);
+  }
+
   // Report IonCompileTasks on wait lists
   for (auto task : ionWorklist_) {
     htStats.ionCompileTask += task->sizeOfExcludingThis(mallocSizeOf);
@@ -1927,6 +2088,13 @@ void GlobalHelperThreadState::addSizeOfIncludingThis(
   htStats.idleThreadCount = threadCount - totalCountRunningTasks;
 }
 
+size_t GlobalHelperThreadState::maxBaselineCompilationThreads() const {
+  if (IsHelperThreadSimulatingOOM(js::THREAD_TYPE_BASELINE)) {
+    return 1;
+  }
+  return threadCount;
+}
+
 size_t GlobalHelperThreadState::maxIonCompilationThreads() const {
   if (IsHelperThreadSimulatingOOM(js::THREAD_TYPE_ION)) {
     return 1;
@@ -2108,6 +2276,25 @@ static bool IonCompileTaskHasHigherPriority(jit::IonCompileTask* first,
          secondJitScript->warmUpCount() / second->script()->length();
 }
 
+HelperThreadTask* GlobalHelperThreadState::maybeGetBaselineCompileTask(
+    const AutoLockHelperThreadState& lock) {
+  if (!canStartBaselineCompileTask(lock)) {
+    return nullptr;
+  }
+
+  auto& worklist = baselineWorklist(lock);
+  jit::BaselineCompileTask* task = worklist[0];
+  worklist.erase(worklist.begin());
+  return task;
+}
+
+bool GlobalHelperThreadState::canStartBaselineCompileTask(
+    const AutoLockHelperThreadState& lock) {
+  return !baselineWorklist(lock).empty() &&
+         checkTaskThreadLimit(THREAD_TYPE_BASELINE,
+                              maxBaselineCompilationThreads(), lock);
+}
+
 HelperThreadTask* GlobalHelperThreadState::maybeGetIonCompileTask(
     const AutoLockHelperThreadState& lock) {
   if (!canStartIonCompileTask(lock)) {
@@ -2688,6 +2875,7 @@ void GlobalHelperThreadState::trace(JSTracer* trc) {
 // Priority is determined by the order they're listed here.
 const GlobalHelperThreadState::Selector GlobalHelperThreadState::selectors[] = {
     &GlobalHelperThreadState::maybeGetGCParallelTask,
+    &GlobalHelperThreadState::maybeGetBaselineCompileTask,
     &GlobalHelperThreadState::maybeGetIonCompileTask,
     &GlobalHelperThreadState::maybeGetWasmTier1CompileTask,
     &GlobalHelperThreadState::maybeGetPromiseHelperTask,
@@ -2702,8 +2890,8 @@ const GlobalHelperThreadState::Selector GlobalHelperThreadState::selectors[] = {
 
 bool GlobalHelperThreadState::canStartTasks(
     const AutoLockHelperThreadState& lock) {
-  return canStartGCParallelTask(lock) || canStartIonCompileTask(lock) ||
-         canStartWasmTier1CompileTask(lock) ||
+  return canStartGCParallelTask(lock) || canStartBaselineCompileTask(lock) ||
+         canStartIonCompileTask(lock) || canStartWasmTier1CompileTask(lock) ||
          canStartPromiseHelperTask(lock) || canStartParseTask(lock) ||
          canStartFreeDelazifyTask(lock) || canStartDelazifyTask(lock) ||
          canStartCompressionTask(lock) || canStartIonFreeTask(lock) ||
@@ -49,6 +49,7 @@ class GCRuntime;
 }
 
 namespace jit {
+class BaselineCompileTask;
 class IonCompileTask;
 class IonFreeTask;
 }  // namespace jit
@@ -136,6 +137,15 @@ bool StartOffThreadPromiseHelperTask(JSContext* cx,
  */
 bool StartOffThreadPromiseHelperTask(PromiseHelperTask* task);
 
+/*
+ * Schedule an off-thread Baseline compilation for a batch of scripts.
+ */
+bool StartOffThreadBaselineCompile(jit::BaselineCompileTask* task,
+                                   const AutoLockHelperThreadState& lock);
+
+void FinishOffThreadBaselineCompile(jit::BaselineCompileTask* task,
+                                    const AutoLockHelperThreadState& lock);
+
 /*
  * Schedule an off-thread Ion compilation for a script, given a task.
  */
@@ -189,6 +199,34 @@ inline void CancelOffThreadIonCompile(JSRuntime* runtime) {
 bool HasOffThreadIonCompile(JS::Realm* realm);
 #endif
 
+/*
+ * Cancel Baseline compilations which are queued, in progress or finished but
+ * not linked yet. The scripts keep running in the interpreter.
+ */
+void CancelOffThreadBaselineCompile(const CompilationSelector& selector);
+
+inline void CancelOffThreadBaselineCompile(JSScript* script) {
+  CancelOffThreadBaselineCompile(CompilationSelector(script));
+}
+
+inline void CancelOffThreadBaselineCompile(JS::Realm* realm) {
+  CancelOffThreadBaselineCompile(CompilationSelector(realm));
+}
+
+inline void CancelOffThreadBaselineCompile(JS::Zone* zone) {
+  CancelOffThreadBaselineCompile(CompilationSelector(zone));
+}
+
+inline void CancelOffThreadBaselineCompile(JSRuntime* runtime,
+                                           JS::shadow::Zone::GCState state) {
+  CancelOffThreadBaselineCompile(
+      CompilationSelector(ZonesInState{runtime, state}));
+}
+
+inline void CancelOffThreadBaselineCompile(JSRuntime* runtime) {
+  CancelOffThreadBaselineCompile(CompilationSelector(runtime));
+}
+
 // True iff the current thread is a ParseTask or a DelazifyTask.
 bool CurrentThreadIsParseThread();
 
@@ -2074,13 +2074,17 @@ static MOZ_NEVER_INLINE JS_HAZ_JSNATIVE_CALLER bool Interpret(JSContext* cx,
     COUNT_COVERAGE_PC(REGS.pc);                       \
   JS_END_MACRO
 
-#define SET_SCRIPT(s)                                    \
-  JS_BEGIN_MACRO                                         \
-    script = (s);                                        \
-    MOZ_ASSERT(cx->realm() == script->realm());          \
-    if (DebugAPI::hasAnyBreakpointsOrStepMode(script) || \
-        script->hasScriptCounts())                       \
-      activation.enableInterruptsUnconditionally();      \
+#define SET_SCRIPT(s)                                      \
+  JS_BEGIN_MACRO                                           \
+    script = (s);                                          \
+    MOZ_ASSERT(cx->realm() == script->realm());            \
+    if (DebugAPI::hasAnyBreakpointsOrStepMode(script) ||   \
+        script->hasScriptCounts())                         \
+      activation.enableInterruptsUnconditionally();        \
+    if (cx->runtime()->opPairProfile.ref()) {              \
+      cx->runtime()->opPairProfile.ref()->resetPrevious(); \
+      activation.enableInterruptsUnconditionally();        \
+    }                                                      \
   JS_END_MACRO
 
 #define SANITY_CHECKS()              \
@@ -2187,6 +2191,11 @@ static MOZ_NEVER_INLINE JS_HAZ_JSNATIVE_CALLER bool Interpret(JSContext* cx,
         }
       }
 
+      if (OpPairProfile* profile = cx->runtime()->opPairProfile.ref().get()) {
+        profile->recordPC(REGS.pc);
+        moreInterrupts = true;
+      }
+
       MOZ_ASSERT(activation.opMask() == EnableInterruptsPseudoOpcode);
       if (!moreInterrupts) {
         activation.clearInterruptsMask();
@@ -3758,6 +3767,19 @@ static MOZ_NEVER_INLINE JS_HAZ_JSNATIVE_CALLER bool Interpret(JSContext* cx,
     }
     END_CASE(GetArg)
 
+    CASE(GetArgPair) {
+      unsigned i = GET_ARGNO(REGS.pc);
+      unsigned j = GET_ARGNO(REGS.pc + JSOpLength_GetArg);
+      if (script->argsObjAliasesFormals()) {
+        PUSH_COPY(REGS.fp()->argsObj().arg(i));
+        PUSH_COPY(REGS.fp()->argsObj().arg(j));
+      } else {
+        PUSH_COPY(REGS.fp()->unaliasedFormal(i));
+        PUSH_COPY(REGS.fp()->unaliasedFormal(j));
+      }
+    }
+    END_CASE(GetArgPair)
+
     CASE(SetArg) {
       unsigned i = GET_ARGNO(REGS.pc);
       if (script->argsObjAliasesFormals()) {
@@ -3792,6 +3814,29 @@ static MOZ_NEVER_INLINE JS_HAZ_JSNATIVE_CALLER bool Interpret(JSContext* cx,
     }
     END_CASE(GetLocal)
 
+    CASE(GetLocalPair) {
+      uint32_t i = GET_LOCALNO(REGS.pc);
+      uint32_t j = GET_LOCALNO(REGS.pc + JSOpLength_GetLocal);
+      PUSH_COPY_SKIP_CHECK(REGS.fp()->unaliasedLocal(i));
+      PUSH_COPY_SKIP_CHECK(REGS.fp()->unaliasedLocal(j));
+
+#ifdef DEBUG
+      MOZ_ASSERT(!IsUninitializedLexical(REGS.sp[-2]));
+      if (IsUninitializedLexical(REGS.sp[-1])) {
+        JSOp next = JSOp(*GetNextPc(REGS.pc));
+        MOZ_ASSERT(next == JSOp::CheckThis || next == JSOp::CheckReturn ||
+                   next == JSOp::CheckThisReinit || next == JSOp::CheckLexical);
+      }
+
+      // See the comment in GetLocal.
+      cx->debugOnlyCheck(REGS.sp[-2]);
+      if (JSOp(REGS.pc[JSOpLength_GetLocalPair]) != JSOp::Pop) {
+        cx->debugOnlyCheck(REGS.sp[-1]);
+      }
+#endif
+    }
+    END_CASE(GetLocalPair)
+
     CASE(SetLocal) {
       uint32_t i = GET_LOCALNO(REGS.pc);
 
@@ -3801,6 +3846,16 @@ static MOZ_NEVER_INLINE JS_HAZ_JSNATIVE_CALLER bool Interpret(JSContext* cx,
     }
     END_CASE(SetLocal)
 
+    CASE(SetLocalPop) {
+      uint32_t i = GET_LOCALNO(REGS.pc);
+
+      MOZ_ASSERT(!IsUninitializedLexical(REGS.fp()->unaliasedLocal(i)));
+
+      REGS.fp()->unaliasedLocal(i) = REGS.sp[-1];
+      REGS.sp--;
+    }
+    END_CASE(SetLocalPop)
+
     CASE(GlobalOrEvalDeclInstantiation) {
       GCThingIndex lastFun = GET_GCTHING_INDEX(REGS.pc);
       HandleObject env = REGS.fp()->environmentChain();
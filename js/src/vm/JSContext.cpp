@@ -206,9 +206,10 @@ void js::DestroyContext(JSContext* cx) {
 
   cx->checkNoGCRooters();
 
-  // Cancel all off thread Ion compiles. Completed Ion compiles may try to
-  // interrupt this context. See HelperThread::handleIonWorkload.
+  // Cancel all off thread Ion and Baseline compiles. Completed compiles may
+  // try to interrupt this context. See HelperThread::handleIonWorkload.
   CancelOffThreadIonCompile(cx->runtime());
+  CancelOffThreadBaselineCompile(cx->runtime());
 
   cx->jobQueue = nullptr;
   cx->internalJobQueue = nullptr;
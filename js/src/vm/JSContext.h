@@ -149,6 +149,7 @@ enum class InterruptReason : uint32_t {
   AttachIonCompilations = 1 << 1,
   CallbackUrgent = 1 << 2,
   CallbackCanWait = 1 << 3,
+  AttachBaselineCompilations = 1 << 4,
 };
 
 enum class ShouldCaptureStack { Maybe, Always };
@@ -170,6 +170,10 @@ inline bool JSScript::isIonCompilingOffThread() const {
   return hasJitScript() && jitScript()->isIonCompilingOffThread();
 }
 
+inline bool JSScript::isBaselineCompilingOffThread() const {
+  return hasJitScript() && jitScript()->isBaselineCompilingOffThread();
+}
+
 inline bool JSScript::canBaselineCompile() const {
   bool disabled = baselineDisabled();
 #ifdef DEBUG
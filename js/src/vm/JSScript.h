@@ -1855,6 +1855,7 @@ class JSScript : public js::BaseScript {
   inline js::jit::IonScript* ionScript() const;
 
   inline bool isIonCompilingOffThread() const;
+  inline bool isBaselineCompilingOffThread() const;
   inline bool canIonCompile() const;
   inline void disableIon();
 
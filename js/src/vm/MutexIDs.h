@@ -22,6 +22,8 @@
   _(ShellObjectMailbox, 100)          \
   _(WellKnownParserAtomsInit, 100)    \
                                       \
+  _(WasmLazyFuncs, 200)               \
+                                      \
   _(WasmInitBuiltinThunks, 250)       \
   _(WasmLazyStubsTier1, 250)          \
   _(WasmLazyStubsTier2, 251)          \
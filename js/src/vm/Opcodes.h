@@ -202,6 +202,22 @@
  *
  * Many instructions have their own additional rules. These are documented on
  * the various opcodes below (look for the word "must").
+ *
+ * ## Superinstructions
+ *
+ * The bytecode emitter fuses some frequent pairs of instructions, like
+ * `GetArg; GetArg`, into a single superinstruction, like `JSOp::GetArgPair`,
+ * to save a dispatch in the interpreters. The bytecode of the second
+ * instruction is kept in place after the operands of the first one, so fusing
+ * moves no offsets, but the second instruction is no longer the start of an
+ * instruction: no jump, note or resume offset may point at it. See
+ * `BytecodeEmitter::fuseSuperinstructions`.
+ *
+ * Only instructions without side effects or ICs are fused, so that the JITs
+ * never need to resume or bail out in the middle of a superinstruction. This
+ * rules out longer sequences like `GetLocal; GetProp; Call`. The shell's
+ * --op-pair-profile option prints the most frequent pairs a workload
+ * executes, see `OpPairProfile`, to check which pairs are worth fusing.
  */
 // clang-format on
 
@@ -2839,6 +2855,18 @@
      *   Stack: => arguments[argno]
      */ \
     MACRO(GetArg, get_arg, NULL, 3, 0, 1, JOF_QARG|JOF_NAME) \
+    /*
+     * Push the values of two arguments, as `GetArg argno; GetArg argno2`.
+     *
+     * This is a superinstruction (see "Superinstructions" above): the second
+     * `GetArg` instruction follows `argno` in place.
+     *
+     *   Category: Variables and scopes
+     *   Type: Getting binding values
+     *   Operands: uint16_t argno, JSOp::GetArg, uint16_t argno2
+     *   Stack: => arguments[argno], arguments[argno2]
+     */ \
+    MACRO(GetArgPair, get_arg_pair, NULL, 6, 0, 2, JOF_QARG|JOF_NAME) \
     /*
      * Push the value of an optimized local variable.
      *
@@ -2851,6 +2879,21 @@
      *   Stack: => val
      */ \
     MACRO(GetLocal, get_local, NULL, 4, 0, 1, JOF_LOCAL|JOF_NAME) \
+    /*
+     * Push the values of two optimized local variables, as
+     * `GetLocal localno; GetLocal localno2`.
+     *
+     * This is a superinstruction (see "Superinstructions" above): the second
+     * `GetLocal` instruction follows `localno` in place. The first variable
+     * can't be an uninitialized lexical, as it would be checked by the next
+     * instruction.
+     *
+     *   Category: Variables and scopes
+     *   Type: Getting binding values
+     *   Operands: uint24_t localno, JSOp::GetLocal, uint24_t localno2
+     *   Stack: => val, val2
+     */ \
+    MACRO(GetLocalPair, get_local_pair, NULL, 8, 0, 2, JOF_LOCAL|JOF_NAME) \
     /*
      * Push the value of an aliased binding.
      *
@@ -3047,6 +3090,19 @@
      *   Stack: v => v
      */ \
     MACRO(SetLocal, set_local, NULL, 4, 1, 1, JOF_LOCAL|JOF_NAME) \
+    /*
+     * Assign to an optimized local binding and pop the value, as
+     * `SetLocal localno; Pop`.
+     *
+     * This is a superinstruction (see "Superinstructions" above): the `Pop`
+     * instruction follows `localno` in place.
+     *
+     *   Category: Variables and scopes
+     *   Type: Setting binding values
+     *   Operands: uint24_t localno, JSOp::Pop
+     *   Stack: v =>
+     */ \
+    MACRO(SetLocalPop, set_local_pop, NULL, 5, 1, 0, JOF_LOCAL|JOF_NAME) \
     /*
      * Assign to an aliased binding.
      *
@@ -3527,16 +3583,13 @@
  * a power of two.  Use this macro to do so.
  */
 #define FOR_EACH_TRAILING_UNUSED_OPCODE(MACRO) \
-  IF_RECORD_TUPLE(/* empty */, MACRO(227))     \
-  IF_RECORD_TUPLE(/* empty */, MACRO(228))     \
-  IF_RECORD_TUPLE(/* empty */, MACRO(229))     \
   IF_RECORD_TUPLE(/* empty */, MACRO(230))     \
   IF_RECORD_TUPLE(/* empty */, MACRO(231))     \
   IF_RECORD_TUPLE(/* empty */, MACRO(232))     \
   IF_RECORD_TUPLE(/* empty */, MACRO(233))     \
-  MACRO(234)                                   \
-  MACRO(235)                                   \
-  MACRO(236)                                   \
+  IF_RECORD_TUPLE(/* empty */, MACRO(234))     \
+  IF_RECORD_TUPLE(/* empty */, MACRO(235))     \
+  IF_RECORD_TUPLE(/* empty */, MACRO(236))     \
   MACRO(237)                                   \
   MACRO(238)                                   \
   MACRO(239)                                   \
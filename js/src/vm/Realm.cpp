@@ -41,7 +41,9 @@ Realm::DebuggerVectorEntry::DebuggerVectorEntry(js::Debugger* dbg_,
     : dbg(dbg_), debuggerLink(link) {}
 
 ObjectRealm::ObjectRealm(JS::Zone* zone)
-    : innerViews(zone, zone), iteratorCache(zone) {}
+    : innerViews(zone, zone),
+      arrayBufferTaint(zone, zone),
+      iteratorCache(zone) {}
 
 Realm::Realm(Compartment* comp, const JS::RealmOptions& options)
     : JS::shadow::Realm(comp),
@@ -307,6 +309,7 @@ void ObjectRealm::sweepAfterMinorGC(JSTracer* trc) {
 void Realm::sweepAfterMinorGC(JSTracer* trc) {
   globalWriteBarriered = 0;
   dtoaCache.purge();
+  stringSplitCache.purge();
   objects_.sweepAfterMinorGC(trc);
 }
 
@@ -350,6 +353,7 @@ void Realm::purge() {
   dtoaCache.purge();
   newProxyCache.purge();
   newPlainObjectWithPropsCache.purge();
+  stringSplitCache.purge();
   objects_.iteratorCache.clearAndCompact();
   arraySpeciesLookup.purge();
   promiseLookup.purge();
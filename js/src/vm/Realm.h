@@ -141,6 +141,107 @@ class NewPlainObjectWithPropsCache {
   }
 };
 
+// Cache for splitting strings by a string separator. Scripts often split the
+// same constant or short strings, such as tables of names or cookie strings,
+// over and over. This remembers the substrings of a few recent splits, so that
+// repeating one only allocates the result array.
+//
+// Tainted strings are never cached, so that each split of them records its
+// own taint flow. Like the caches above, this holds unbarriered pointers and
+// is purged on every GC.
+class StringSplitCache {
+ public:
+  // Strings longer than this are only cached if they are atoms.
+  static const size_t MaxInputLength = 256;
+  // Splits with more substrings than this are not cached.
+  static const size_t MaxSubstrings = 1024;
+
+  static bool isCacheable(JSLinearString* str, JSLinearString* sep);
+
+  // Return the cached substrings of |str| split by |sep| and store their
+  // number in |length|, or return nullptr. The result is only valid until the
+  // next purge, which can be detected with purgeCount().
+  const Value* lookup(JSLinearString* str, JSLinearString* sep,
+                      uint32_t* length);
+  void add(JSLinearString* str, JSLinearString* sep, ArrayObject* result);
+
+  void purge() {
+    for (Entry& entry : entries_) {
+      entry.clear();
+    }
+    purgeCount_++;
+  }
+
+  uint64_t purgeCount() const { return purgeCount_; }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    JSLinearString* str = nullptr;
+    JSLinearString* sep = nullptr;
+    Vector<Value, 0, SystemAllocPolicy> substrings;
+
+    void clear() {
+      str = nullptr;
+      sep = nullptr;
+      substrings.clearAndFree();
+    }
+  };
+
+  static const size_t NumEntries = 4;
+  mozilla::Array<Entry, NumEntries> entries_;
+  size_t nextEntry_ = 0;
+
+  uint64_t purgeCount_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+// Cache for Date.parse and the Date constructor. Pages often parse the same
+// server timestamps many times, e.g. every time a list of items is rendered.
+// This remembers the time values of a few recently parsed strings, keyed by
+// their contents.
+//
+// Only results which don't depend on the local time zone are cached, so the
+// entries stay valid when the time zone changes. The entries hold no GC
+// pointers and don't need to be purged on GC.
+class DateParseCache {
+ public:
+  // Longer strings, and strings with two-byte characters, are not cached.
+  static const size_t MaxInputLength = 48;
+
+  static bool isCacheable(JSLinearString* str);
+
+  // Return whether |str| is cached, storing its time value in |time|.
+  bool lookup(JSLinearString* str, double* time);
+  void add(JSLinearString* str, double time);
+
+  void purge() {
+    for (Entry& entry : entries_) {
+      entry.length = 0;
+    }
+  }
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    // Zero if the entry is unused, as the empty string is not a valid date.
+    size_t length = 0;
+    JS::Latin1Char chars[MaxInputLength];
+    double time = 0;
+  };
+
+  // Must be a power of two, entries are indexed by the hash of their string.
+  static const size_t NumEntries = 8;
+  mozilla::Array<Entry, NumEntries> entries_;
+
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
 // [SMDOC] Object MetadataBuilder API
 //
 // We must ensure that all newly allocated JSObjects get their metadata
@@ -252,6 +353,9 @@ class ObjectRealm {
   // Map from array buffers to views sharing that storage.
   JS::WeakCache<js::InnerViewTable> innerViews;
 
+  // TaintFox: map from tainted array buffers to their taint information.
+  JS::WeakCache<js::ArrayBufferTaintMap> arrayBufferTaint;
+
   // Keep track of the metadata objects which can be associated with each JS
   // object. Both keys and values are in this realm.
   js::UniquePtr<js::ObjectWeakMap> objectMetadataTable;
@@ -406,6 +510,8 @@ class JS::Realm : public JS::shadow::Realm {
   js::DtoaCache dtoaCache;
   js::NewProxyCache newProxyCache;
   js::NewPlainObjectWithPropsCache newPlainObjectWithPropsCache;
+  js::StringSplitCache stringSplitCache;
+  js::DateParseCache dateParseCache;
   js::ArraySpeciesLookup arraySpeciesLookup;
   js::PromiseLookup promiseLookup;
 
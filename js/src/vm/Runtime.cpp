@@ -27,6 +27,7 @@
 #include "frontend/ParserAtom.h"  // frontend::WellKnownParserAtoms
 #include "gc/GC.h"
 #include "gc/PublicIterators.h"
+#include "jit/BaselineCompileTask.h"
 #include "jit/IonCompileTask.h"
 #include "jit/JitRuntime.h"
 #include "jit/Simulator.h"
@@ -39,6 +40,7 @@
 #include "js/Stack.h"  // JS::NativeStackLimitMin
 #include "js/Wrapper.h"
 #include "js/WrapperCallbacks.h"
+#include "vm/BytecodeUtil.h"  // js::OpPairProfile
 #include "vm/DateTime.h"
 #include "vm/JSObject.h"
 #include "vm/JSScript.h"
@@ -126,6 +128,7 @@ JSRuntime::JSRuntime(JSRuntime* parentRuntime)
       profilingScripts(false),
       scriptAndCountsVector(nullptr),
       watchtowerTestingLog(nullptr),
+      opPairProfile(nullptr),
       lcovOutput_(),
       jitRuntime_(nullptr),
       gc(thisFromCtor()),
@@ -220,6 +223,7 @@ void JSRuntime::destroyRuntime() {
 #endif
 
   watchtowerTestingLog.ref().reset();
+  opPairProfile.ref().reset();
 
   // Caches might hold on ScriptData which are saved in the ScriptDataTable.
   // Clear all stencils from caches to remove ScriptDataTable entries.
@@ -238,12 +242,13 @@ void JSRuntime::destroyRuntime() {
     sourceHook = nullptr;
 
     /*
-     * Cancel any pending, in progress or completed Ion compilations and
-     * parse tasks. Waiting for wasm and compression tasks is done
-     * synchronously (on the main thread or during parse tasks), so no
-     * explicit canceling is needed for these.
+     * Cancel any pending, in progress or completed Ion and Baseline
+     * compilations and parse tasks. Waiting for wasm and compression tasks
+     * is done synchronously (on the main thread or during parse tasks), so
+     * no explicit canceling is needed for these.
      */
     CancelOffThreadIonCompile(this);
+    CancelOffThreadBaselineCompile(this);
     CancelOffThreadParses(this);
     CancelOffThreadDelazify(this);
     CancelOffThreadCompressions(this);
@@ -394,7 +399,11 @@ static bool HandleInterrupt(JSContext* cx, bool invokeCallback) {
   // compilation.
   jit::AttachFinishedCompilations(cx);
 
-  // Don't call the interrupt callback if we only interrupted for GC or Ion.
+  // Or after finishing a batch of Baseline compilations.
+  jit::AttachFinishedBaselineCompilations(cx);
+
+  // Don't call the interrupt callback if we only interrupted for GC or JIT
+  // compilations.
   if (!invokeCallback) {
     return true;
   }
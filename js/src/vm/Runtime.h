@@ -69,6 +69,7 @@ class AutoAssertNoContentJS;
 class Debugger;
 class EnterDebuggeeNoExecute;
 class FrontendContext;
+class OpPairProfile;
 class StaticStrings;
 
 }  // namespace js
@@ -648,6 +649,12 @@ struct JSRuntime {
       JS::GCVector<js::PlainObject*, 0, js::SystemAllocPolicy>>;
   js::MainThreadData<js::UniquePtr<RootedPlainObjVec>> watchtowerTestingLog;
 
+  /*
+   * Counts of the opcode pairs executed by the interpreter, collected when the
+   * shell's --op-pair-profile option is used.
+   */
+  js::MainThreadData<js::UniquePtr<js::OpPairProfile>> opPairProfile;
+
  private:
   /* Code coverage output. */
   js::UnprotectedData<js::coverage::LCovRuntime> lcovOutput_;
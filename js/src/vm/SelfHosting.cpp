@@ -1275,6 +1275,16 @@ static bool intrinsic_TypedArrayBitwiseSlice(JSContext* cx, unsigned argc,
     } else {
       memcpy(unsafeTargetDataCrossCompartment.unwrapUnshared(),
              sourceData.unwrapUnshared(), byteLength);
+
+      // TaintFox: propagate byte taint. Views without a buffer are never
+      // tainted.
+      if (unsafeTypedArrayCrossCompartment->hasBuffer()) {
+        ArrayBufferObject::copyTaint(
+            unsafeTypedArrayCrossCompartment->bufferUnshared(),
+            unsafeTypedArrayCrossCompartment->byteOffset(),
+            source->hasBuffer() ? source->bufferUnshared() : nullptr,
+            source->byteOffset() + sourceOffset * elementSize, byteLength);
+      }
     }
   } else {
     using namespace jit;
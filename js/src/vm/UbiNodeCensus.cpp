@@ -6,13 +6,22 @@
 
 #include "js/UbiNodeCensus.h"
 
+#include "mozilla/Maybe.h"
+
+#include <algorithm>
+
 #include "builtin/MapObject.h"
+#include "gc/GCParallelTask.h"
+#include "gc/ParallelWork.h"
+#include "gc/Statistics.h"
 #include "js/friend/ErrorMessages.h"  // js::GetErrorMessage, JSMSG_*
 #include "util/Text.h"
 #include "vm/Compartment.h"
+#include "vm/HelperThreads.h"
 #include "vm/JSContext.h"
 #include "vm/PlainObject.h"  // js::PlainObject
 #include "vm/Printer.h"
+#include "vm/Runtime.h"
 
 #include "vm/NativeObject-inl.h"
 
@@ -68,6 +77,7 @@ class SimpleCount : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) override {}
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -81,6 +91,13 @@ bool SimpleCount::count(CountBase& countBase,
   return true;
 }
 
+bool SimpleCount::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  count.totalBytes_ += other.totalBytes_;
+  return true;
+}
+
 bool SimpleCount::report(JSContext* cx, CountBase& countBase,
                          MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -139,6 +156,7 @@ class BucketCount : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) final {}
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -149,6 +167,12 @@ bool BucketCount::count(CountBase& countBase,
   return count.ids_.append(node.identifier());
 }
 
+bool BucketCount::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  return count.ids_.appendAll(other.ids_);
+}
+
 bool BucketCount::report(JSContext* cx, CountBase& countBase,
                          MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -218,6 +242,7 @@ class ByCoarseType : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) override;
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -268,6 +293,16 @@ bool ByCoarseType::count(CountBase& countBase,
   }
 }
 
+bool ByCoarseType::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  return count.objects->merge(*other.objects) &&
+         count.scripts->merge(*other.scripts) &&
+         count.strings->merge(*other.strings) &&
+         count.other->merge(*other.other) &&
+         count.domNode->merge(*other.domNode);
+}
+
 bool ByCoarseType::report(JSContext* cx, CountBase& countBase,
                           MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -329,6 +364,29 @@ static int compareEntries(const void* lhsVoid, const void* rhsVoid) {
   return 0;
 }
 
+// Merge the entries of |other| into |map|, merging the counts of keys present
+// in both. The entries of keys only present in |other| are moved into |map|,
+// leaving |other| unusable for anything but destruction.
+//
+// `Map` must be a `HashMap` from some key type to a `CountBasePtr`.
+template <class Map>
+static bool mergeCountMaps(Map& map, Map& other) {
+  for (auto r = other.all(); !r.empty(); r.popFront()) {
+    auto& entry = r.front();
+    typename Map::AddPtr p = map.lookupForAdd(entry.key());
+    if (p) {
+      if (!p->value()->merge(*entry.value())) {
+        return false;
+      }
+      continue;
+    }
+    if (!map.add(p, std::move(entry.mutableKey()), std::move(entry.value()))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // A hash map mapping from C strings to counts.
 using CStringCountMap = HashMap<const char*, CountBasePtr,
                                 mozilla::CStringHasher, SystemAllocPolicy>;
@@ -477,6 +535,7 @@ class ByObjectClass : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) override;
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -523,6 +582,13 @@ bool ByObjectClass::count(CountBase& countBase,
   return p->value()->count(mallocSizeOf, node);
 }
 
+bool ByObjectClass::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  return mergeCountMaps(count.table, other.table) &&
+         count.other->merge(*other.other);
+}
+
 bool ByObjectClass::report(JSContext* cx, CountBase& countBase,
                            MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -585,6 +651,7 @@ class ByDomObjectClass : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) override;
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -631,6 +698,12 @@ bool ByDomObjectClass::count(CountBase& countBase,
   return p->value()->count(mallocSizeOf, node);
 }
 
+bool ByDomObjectClass::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  return mergeCountMaps(count.table, other.table);
+}
+
 bool ByDomObjectClass::report(JSContext* cx, CountBase& countBase,
                               MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -677,6 +750,7 @@ class ByUbinodeType : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) override;
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -714,6 +788,12 @@ bool ByUbinodeType::count(CountBase& countBase,
   return p->value()->count(mallocSizeOf, node);
 }
 
+bool ByUbinodeType::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  return mergeCountMaps(count.table, other.table);
+}
+
 bool ByUbinodeType::report(JSContext* cx, CountBase& countBase,
                            MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -824,6 +904,7 @@ class ByAllocationStack : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) override;
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -881,6 +962,13 @@ bool ByAllocationStack::count(CountBase& countBase,
   return count.noStack->count(mallocSizeOf, node);
 }
 
+bool ByAllocationStack::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  return mergeCountMaps(count.table, other.table) &&
+         count.noStack->merge(*other.noStack);
+}
+
 bool ByAllocationStack::report(JSContext* cx, CountBase& countBase,
                                MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -1002,6 +1090,7 @@ class ByFilename : public CountType {
   void traceCount(CountBase& countBase, JSTracer* trc) override;
   bool count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
              const Node& node) override;
+  bool merge(CountBase& countBase, CountBase& otherBase) override;
   bool report(JSContext* cx, CountBase& countBase,
               MutableHandleValue report) override;
 };
@@ -1059,6 +1148,13 @@ bool ByFilename::count(CountBase& countBase, mozilla::MallocSizeOf mallocSizeOf,
   return p->value()->count(mallocSizeOf, node);
 }
 
+bool ByFilename::merge(CountBase& countBase, CountBase& otherBase) {
+  Count& count = static_cast<Count&>(countBase);
+  Count& other = static_cast<Count&>(otherBase);
+  return mergeCountMaps(count.table, other.table) &&
+         count.noFilename->merge(*other.noFilename);
+}
+
 bool ByFilename::report(JSContext* cx, CountBase& countBase,
                         MutableHandleValue report) {
   Count& count = static_cast<Count&>(countBase);
@@ -1082,6 +1178,17 @@ bool ByFilename::report(JSContext* cx, CountBase& countBase,
 
 /*** Census Handler *********************************************************/
 
+bool CensusHandler::count(const Node& node) {
+  if (!census.parallel) {
+    return rootCount->count(mallocSizeOf, node);
+  }
+
+  if (node.coarseType() == CoarseType::DOMNode) {
+    pendingHasDOMNodes = true;
+  }
+  return pending.append(node);
+}
+
 JS_PUBLIC_API bool CensusHandler::operator()(
     BreadthFirst<CensusHandler>& traversal, Node origin, const Edge& edge,
     NodeData* referentData, bool first) {
@@ -1101,18 +1208,131 @@ JS_PUBLIC_API bool CensusHandler::operator()(
   Zone* zone = referent.zone();
 
   if (census.targetZones.count() == 0 || census.targetZones.has(zone)) {
-    return rootCount->count(mallocSizeOf, referent);
+    return count(referent);
   }
 
   if (zone && zone->isAtomsZone()) {
     traversal.abandonReferent();
-    return rootCount->count(mallocSizeOf, referent);
+    return count(referent);
   }
 
   traversal.abandonReferent();
   return true;
 }
 
+static bool CountNodes(CountBase& count, mozilla::MallocSizeOf mallocSizeOf,
+                       const Node* begin, const Node* end) {
+  for (const Node* node = begin; node != end; node++) {
+    if (!count.count(mallocSizeOf, *node)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Counts a range of the nodes collected by a parallel census into a count
+// tree of its own.
+class CensusCountTask : public GCParallelTask {
+ public:
+  CensusCountTask(JSRuntime* rt, CountBasePtr count,
+                  mozilla::MallocSizeOf mallocSizeOf, const Node* begin,
+                  const Node* end)
+      : GCParallelTask(&rt->gc, gcstats::PhaseKind::NONE),
+        count(std::move(count)),
+        mallocSizeOf(mallocSizeOf),
+        begin(begin),
+        end(end) {}
+
+  ~CensusCountTask() { join(); }
+
+  void run(AutoLockHelperThreadState& lock) override {
+    AutoUnlockHelperThreadState unlock(lock);
+    ok = CountNodes(*count, mallocSizeOf, begin, end);
+  }
+
+  CountBasePtr count;
+  bool ok = false;
+
+ private:
+  mozilla::MallocSizeOf mallocSizeOf;
+  const Node* begin;
+  const Node* end;
+};
+
+bool CensusHandler::countPendingInParallel(size_t workers) {
+  JSRuntime* rt = census.cx->runtime();
+
+  // Split the nodes into contiguous ranges, one for this thread and one for
+  // each worker. The first range is counted directly into the root count, and
+  // the others are merged into it in order once they have been counted, so
+  // that the result is the same as that of counting them all in order.
+  size_t ranges = workers + 1;
+  size_t length = pending.length();
+  auto rangeStart = [&](size_t i) {
+    return pending.begin() + length * i / ranges;
+  };
+
+  mozilla::Maybe<CensusCountTask> tasks[gc::MaxParallelWorkers];
+  for (size_t i = 0; i < workers; i++) {
+    CountBasePtr count(rootCount->makeEmptyCount());
+    if (!count) {
+      return false;
+    }
+    tasks[i].emplace(rt, std::move(count), mallocSizeOf, rangeStart(i + 1),
+                     rangeStart(i + 2));
+  }
+
+  {
+    AutoLockHelperThreadState lock;
+    for (size_t i = 0; i < workers; i++) {
+      tasks[i]->startWithLockHeld(lock);
+    }
+  }
+
+  bool ok = CountNodes(*rootCount, mallocSizeOf, rangeStart(0), rangeStart(1));
+
+  {
+    AutoLockHelperThreadState lock;
+    for (size_t i = 0; i < workers; i++) {
+      tasks[i]->joinWithLockHeld(lock);
+    }
+  }
+
+  for (size_t i = 0; i < workers && ok; i++) {
+    ok = tasks[i]->ok && rootCount->merge(*tasks[i]->count);
+  }
+  return ok;
+}
+
+JS_PUBLIC_API bool CensusHandler::finish() {
+  if (pending.empty()) {
+    return true;
+  }
+  MOZ_ASSERT(census.parallel);
+  MOZ_ASSERT(census.minParallelNodes > 0);
+
+  // DOM nodes are always counted on the main thread, as are heaps which are
+  // too small to be worth splitting up.
+  size_t workers = 0;
+  if (!pendingHasDOMNodes && CanUseExtraThreads()) {
+    JSRuntime* rt = census.cx->runtime();
+    size_t ranges = std::min(rt->gc.parallelWorkerCount() + 1,
+                             pending.length() / census.minParallelNodes);
+    if (ranges > 1) {
+      workers = ranges - 1;
+    }
+  }
+
+  bool ok = workers
+                ? countPendingInParallel(workers)
+                : CountNodes(*rootCount, mallocSizeOf, pending.begin(),
+                             pending.end());
+
+  pending.clearAndFree();
+  pendingHasDOMNodes = false;
+  return ok;
+}
+
 /*** Parsing Breakdowns *****************************************************/
 
 static CountTypePtr ParseChildBreakdown(JSContext* cx, HandleObject breakdown,
@@ -1360,6 +1580,15 @@ JS_PUBLIC_API bool ParseCensusOptions(JSContext* cx, Census& census,
     return false;
   }
 
+  // Only count on helper threads if { parallel: true } is passed. See
+  // devtools/bench/census-parallel.js for a comparison of the two.
+  RootedValue parallel(cx, UndefinedValue());
+  if (options &&
+      !GetProperty(cx, options, options, cx->names().parallel, &parallel)) {
+    return false;
+  }
+  census.parallel = ToBoolean(parallel);
+
   outResult = breakdown.isUndefined() ? GetDefaultBreakdown(cx)
                                       : ParseBreakdown(cx, breakdown);
   return !!outResult;
@@ -290,6 +290,12 @@ const SymbolicAddressSignature SASigThrowException = {
     _FailOnNegI32,
     2,
     {_PTR, _RoN, _END}};
+const SymbolicAddressSignature SASigLazyCompileFunc = {
+    SymbolicAddress::LazyCompileFunc,
+    _I32,
+    _FailOnNegI32,
+    2,
+    {_PTR, _I32, _END}};
 const SymbolicAddressSignature SASigArrayNew = {SymbolicAddress::ArrayNew,
                                                 _RoN,
                                                 _FailOnNullPtr,
@@ -559,8 +565,8 @@ bool wasm::HandleThrow(JSContext* cx, WasmFrameIter& iter,
     if (hasCatchableException) {
       const wasm::Code& code = iter.instance()->code();
       const uint8_t* pc = iter.resumePCinCurrentFrame();
-      Tier tier;
-      const wasm::TryNote* tryNote = code.lookupTryNote((void*)pc, &tier);
+      const uint8_t* codeBase;
+      const wasm::TryNote* tryNote = code.lookupTryNote((void*)pc, &codeBase);
 
       if (tryNote) {
         cx->clearPendingException();
@@ -580,8 +586,7 @@ bool wasm::HandleThrow(JSContext* cx, WasmFrameIter& iter,
 
         rfe->stackPointer =
             (uint8_t*)(rfe->framePointer - tryNote->landingPadFramePushed());
-        rfe->target =
-            iter.instance()->codeBase(tier) + tryNote->landingPadEntryPoint();
+        rfe->target = codeBase + tryNote->landingPadEntryPoint();
 
         // Make sure to clear trapping state if we got here due to a trap.
         if (activation->isWasmTrapping()) {
@@ -1311,6 +1316,10 @@ void* wasm::AddressOf(SymbolicAddress imm, ABIFunctionType* abiType) {
       *abiType = Args_Int32_GeneralGeneral;
       MOZ_ASSERT(*abiType == ToABIType(SASigThrowException));
       return FuncCast(Instance::throwException, *abiType);
+    case SymbolicAddress::LazyCompileFunc:
+      *abiType = Args_Int32_GeneralInt32;
+      MOZ_ASSERT(*abiType == ToABIType(SASigLazyCompileFunc));
+      return FuncCast(Instance::lazyCompileFunc, *abiType);
 
 #ifdef WASM_CODEGEN_DEBUG
     case SymbolicAddress::PrintI32:
@@ -1475,6 +1484,7 @@ bool wasm::NeedsBuiltinThunk(SymbolicAddress sym) {
     case SymbolicAddress::StructNew:
     case SymbolicAddress::ExceptionNew:
     case SymbolicAddress::ThrowException:
+    case SymbolicAddress::LazyCompileFunc:
     case SymbolicAddress::ArrayNew:
     case SymbolicAddress::ArrayNewData:
     case SymbolicAddress::ArrayNewElem:
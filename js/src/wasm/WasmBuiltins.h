@@ -127,6 +127,7 @@ enum class SymbolicAddress {
   StructNew,
   ExceptionNew,
   ThrowException,
+  LazyCompileFunc,
   ArrayNew,
   ArrayNewData,
   ArrayNewElem,
@@ -251,6 +252,7 @@ extern const SymbolicAddressSignature SASigPostBarrierFiltering;
 extern const SymbolicAddressSignature SASigStructNew;
 extern const SymbolicAddressSignature SASigExceptionNew;
 extern const SymbolicAddressSignature SASigThrowException;
+extern const SymbolicAddressSignature SASigLazyCompileFunc;
 extern const SymbolicAddressSignature SASigArrayNew;
 extern const SymbolicAddressSignature SASigArrayNewData;
 extern const SymbolicAddressSignature SASigArrayNewElem;
@@ -35,11 +35,13 @@
 #ifdef MOZ_VTUNE
 #  include "vtune/VTuneWrapper.h"
 #endif
+#include "wasm/WasmBaselineCompile.h"
 #include "wasm/WasmModule.h"
 #include "wasm/WasmProcess.h"
 #include "wasm/WasmSerialize.h"
 #include "wasm/WasmStubs.h"
 #include "wasm/WasmUtility.h"
+#include "wasm/WasmValidate.h"
 
 using namespace js;
 using namespace js::jit;
@@ -130,6 +132,14 @@ const Code& CodeSegment::code() const {
   return codeTier_->code();
 }
 
+uint8_t* CodeSegment::trapCode() const {
+  MOZ_ASSERT(hasTraps());
+  if (isModule()) {
+    return asModule()->trapCode();
+  }
+  return codeTier().segment().trapCode();
+}
+
 void CodeSegment::addSizeOfMisc(MallocSizeOf mallocSizeOf, size_t* code) const {
   *code += RoundupCodeLength(length());
 }
@@ -144,7 +154,7 @@ void FreeCode::operator()(uint8_t* bytes) {
   DeallocateExecutableMemory(bytes, codeLength);
 }
 
-bool wasm::StaticallyLink(const ModuleSegment& ms, const LinkData& linkData) {
+bool wasm::StaticallyLink(uint8_t* base, const LinkData& linkData) {
   for (LinkData::InternalLink link : linkData.internalLinks) {
     CodeLabel label;
     label.patchAt()->bind(link.patchAtOffset);
@@ -152,7 +162,7 @@ bool wasm::StaticallyLink(const ModuleSegment& ms, const LinkData& linkData) {
 #ifdef JS_CODELABEL_LINKMODE
     label.setLinkMode(static_cast<CodeLabel::LinkMode>(link.mode));
 #endif
-    Assembler::Bind(ms.base(), label);
+    Assembler::Bind(base, label);
   }
 
   if (!EnsureBuiltinThunksInitialized()) {
@@ -167,7 +177,7 @@ bool wasm::StaticallyLink(const ModuleSegment& ms, const LinkData& linkData) {
 
     void* target = SymbolicAddressTarget(imm);
     for (uint32_t offset : offsets) {
-      uint8_t* patchAt = ms.base() + offset;
+      uint8_t* patchAt = base + offset;
       Assembler::PatchDataWithValueCheck(CodeLocationLabel(patchAt),
                                          PatchedImmPtr(target),
                                          PatchedImmPtr((void*)-1));
@@ -327,7 +337,7 @@ bool ModuleSegment::initialize(const CodeTier& codeTier,
                                const LinkData& linkData,
                                const Metadata& metadata,
                                const MetadataTier& metadataTier) {
-  if (!StaticallyLink(*this, linkData)) {
+  if (!StaticallyLink(base(), linkData)) {
     return false;
   }
 
@@ -453,6 +463,33 @@ void LazyStubSegment::addSizeOfMisc(MallocSizeOf mallocSizeOf, size_t* code,
   *data += mallocSizeOf(this);
 }
 
+bool LazyFuncSegment::initialize(const CodeTier& codeTier) {
+  if (!ExecutableAllocator::makeExecutableAndFlushICache(
+          base(), RoundupCodeLength(length()))) {
+    return false;
+  }
+
+  // See comments in CodeSegment::initialize() for why this must be last.
+  return CodeSegment::initialize(codeTier);
+}
+
+const CodeRange* LazyFuncSegment::lookupRange(const void* pc) const {
+  if (!containsCodePC(pc)) {
+    return nullptr;
+  }
+  return LookupInSorted(codeRanges,
+                        CodeRange::OffsetInCode((uint8_t*)pc - base()));
+}
+
+void LazyFuncSegment::addSizeOfMisc(MallocSizeOf mallocSizeOf, size_t* code,
+                                    size_t* data) const {
+  CodeSegment::addSizeOfMisc(mallocSizeOf, code);
+  *data += mallocSizeOf(this) + codeRanges.sizeOfExcludingThis(mallocSizeOf) +
+           callSites.sizeOfExcludingThis(mallocSizeOf) +
+           trapSites.sizeOfExcludingThis(mallocSizeOf) +
+           tryNotes.sizeOfExcludingThis(mallocSizeOf);
+}
+
 // When allocating a single stub to a page, we should not always place the stub
 // at the beginning of the page as the stubs will tend to thrash the icache by
 // creating conflicts (everything ends up in the same cache set).  Instead,
@@ -830,7 +867,8 @@ const wasm::TryNote* CodeTier::lookupTryNote(const void* pc) const {
   return nullptr;
 }
 
-bool JumpTables::init(CompileMode mode, const ModuleSegment& ms,
+bool JumpTables::init(CompileMode mode, bool lazyFuncs,
+                      const ModuleSegment& ms,
                       const CodeRangeVector& codeRanges) {
   static_assert(JSScript::offsetOfJitCodeRaw() == 0,
                 "wasm fast jit entry is at (void*) jit[funcIndex]");
@@ -846,7 +884,7 @@ bool JumpTables::init(CompileMode mode, const ModuleSegment& ms,
 
   numFuncs_ = numFuncs;
 
-  if (mode_ == CompileMode::Tier1) {
+  if (mode_ == CompileMode::Tier1 || lazyFuncs) {
     tiering_ = TablePointer(js_pod_calloc<void*>(numFuncs));
     if (!tiering_) {
       return false;
@@ -873,6 +911,165 @@ bool JumpTables::init(CompileMode mode, const ModuleSegment& ms,
   return true;
 }
 
+static const size_t LAZY_FUNC_LIFO_DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+LazyFuncs::LazyFuncs(const CompileArgs& compileArgs,
+                     const ShareableBytes& bytecode,
+                     LazyFuncBodyVector&& bodies, uint32_t numFuncDefs)
+    : compileArgs_(&compileArgs),
+      bytecode_(&bytecode),
+      bodies_(std::move(bodies)),
+      numFuncDefs_(numFuncDefs),
+      numCompiled_(0),
+      state_(mutexid::WasmLazyFuncs) {}
+
+LazyFuncs::~LazyFuncs() = default;
+
+bool LazyFuncs::compile(const Code& code, uint32_t funcIndex,
+                        UniqueChars* error) const {
+  auto state = state_.lock();
+
+  const CodeTier& codeTier = code.codeTier(Tier::Baseline);
+  const MetadataTier& metadataTier = codeTier.metadata();
+  uint8_t* tier1Base = codeTier.segment().base();
+  auto stubRange = [&](uint32_t index) -> const CodeRange& {
+    return metadataTier.codeRanges[metadataTier.funcToCodeRange[index]];
+  };
+
+  // Another thread sharing the code may have compiled the function while we
+  // were waiting for the lock.
+  if (code.getTieringEntry(funcIndex) !=
+      tier1Base + stubRange(funcIndex).funcTierEntry()) {
+    return true;
+  }
+
+  if (!state->moduleEnv) {
+    Decoder d(bytecode_->bytes, 0, error);
+    auto moduleEnv = MakeUnique<ModuleEnvironment>(compileArgs_->features);
+    if (!moduleEnv || !moduleEnv->init() ||
+        !DecodeModuleEnvironment(d, moduleEnv.get())) {
+      return false;
+    }
+    state->moduleEnv = std::move(moduleEnv);
+  }
+
+  const LazyFuncBody& body = bodies_[funcIndex];
+  const uint8_t* bodyBegin = bytecode_->begin() + body.offset;
+  FuncCompileInputVector inputs;
+  if (!inputs.emplaceBack(funcIndex, body.offset, bodyBegin,
+                          bodyBegin + body.length, Uint32Vector())) {
+    return false;
+  }
+
+  CompilerEnvironment compilerEnv(CompileMode::Once, Tier::Baseline,
+                                  DebugEnabled::False);
+  compilerEnv.computeParameters();
+
+  LifoAlloc lifo(LAZY_FUNC_LIFO_DEFAULT_CHUNK_SIZE);
+  CompiledCode compiled;
+  if (!BaselineCompileFunctions(*state->moduleEnv, compilerEnv, lifo, inputs,
+                                &compiled, error)) {
+    return false;
+  }
+  MOZ_ASSERT(compiled.codeRanges.length() == 1);
+
+  uint32_t codeLength = compiled.bytes.length();
+  UniqueCodeBytes codeBytes = AllocateCodeBytes(codeLength);
+  if (!codeBytes) {
+    return false;
+  }
+  memcpy(codeBytes.get(), compiled.bytes.begin(), codeLength);
+
+  auto segment =
+      js::MakeUnique<LazyFuncSegment>(std::move(codeBytes), codeLength);
+  if (!segment) {
+    return false;
+  }
+  uint8_t* base = segment->base();
+
+  LinkData linkData(Tier::Baseline);
+  for (const SymbolicAccess& access : compiled.symbolicAccesses) {
+    if (!linkData.symbolicLinks[access.target].append(
+            access.patchAt.offset())) {
+      return false;
+    }
+  }
+  for (const CodeLabel& codeLabel : compiled.codeLabels) {
+    LinkData::InternalLink link;
+    link.patchAtOffset = codeLabel.patchAt().offset();
+    link.targetOffset = codeLabel.target().offset();
+#ifdef JS_CODELABEL_LINKMODE
+    link.mode = codeLabel.linkMode();
+#endif
+    if (!linkData.internalLinks.append(link)) {
+      return false;
+    }
+  }
+  if (!StaticallyLink(base, linkData)) {
+    return false;
+  }
+
+  // Direct calls go to the stub of the callee, which forwards them through
+  // the jump table to the callee's current code. The stubs are always within
+  // near call range; see PlatformCanCompileLazily.
+  for (size_t i = 0; i < compiled.callSites.length(); i++) {
+    const CallSite& callSite = compiled.callSites[i];
+    if (callSite.kind() != CallSiteDesc::Func) {
+      continue;
+    }
+    uint32_t calleeIndex = compiled.callSiteTargets[i].funcIndex();
+    MacroAssembler::patchNopToCall(
+        base + callSite.returnAddressOffset(),
+        tier1Base + stubRange(calleeIndex).funcUncheckedCallEntry());
+  }
+
+  for (size_t i = 0; i < compiled.stackMaps.length(); i++) {
+    StackMaps::Maplet maplet = compiled.stackMaps.move(i);
+    maplet.offsetBy(uintptr_t(base));
+    if (!segment->stackMaps.add(maplet)) {
+      maplet.map->destroy();
+      return false;
+    }
+  }
+  segment->stackMaps.finishAndSort();
+
+  segment->codeRanges = std::move(compiled.codeRanges);
+  segment->callSites = std::move(compiled.callSites);
+  for (Trap trap : MakeEnumeratedRange(Trap::Limit)) {
+    segment->trapSites[trap] = std::move(compiled.trapSites[trap]);
+  }
+  for (const TryNote& tryNote : compiled.tryNotes) {
+    // See ModuleGenerator::linkCompiledCode.
+    if (tryNote.hasTryBody() && !segment->tryNotes.append(tryNote)) {
+      return false;
+    }
+  }
+
+  if (!state->segments.reserve(state->segments.length() + 1) ||
+      !segment->initialize(codeTier)) {
+    return false;
+  }
+
+  const CodeRange& range = segment->codeRanges[0];
+  code.setTieringEntry(funcIndex, base + range.funcTierEntry());
+  state->segments.infallibleAppend(std::move(segment));
+  numCompiled_++;
+  return true;
+}
+
+void LazyFuncs::addSizeOfMisc(MallocSizeOf mallocSizeOf, size_t* code,
+                              size_t* data) const {
+  *data += mallocSizeOf(this) + bodies_.sizeOfExcludingThis(mallocSizeOf);
+  auto state = state_.lock();
+  if (state->moduleEnv) {
+    *data += mallocSizeOf(state->moduleEnv.get());
+  }
+  *data += state->segments.sizeOfExcludingThis(mallocSizeOf);
+  for (const UniqueLazyFuncSegment& segment : state->segments) {
+    segment->addSizeOfMisc(mallocSizeOf, code, data);
+  }
+}
+
 Code::Code(UniqueCodeTier tier1, const Metadata& metadata,
            JumpTables&& maybeJumpTables)
     : tier1_(std::move(tier1)),
@@ -974,6 +1171,17 @@ const CodeTier& Code::codeTier(Tier tier) const {
   MOZ_CRASH();
 }
 
+const LazyFuncSegment* Code::lookupLazyFuncSegment(const void* pc) const {
+  if (!lazyFuncs_) {
+    return nullptr;
+  }
+  const CodeSegment* segment = LookupCodeSegment(pc);
+  if (!segment || !segment->isLazyFunc() || &segment->code() != this) {
+    return nullptr;
+  }
+  return segment->asLazyFunc();
+}
+
 bool Code::containsCodePC(const void* pc) const {
   for (Tier t : tiers()) {
     const ModuleSegment& ms = segment(t);
@@ -981,7 +1189,7 @@ bool Code::containsCodePC(const void* pc) const {
       return true;
     }
   }
-  return false;
+  return !!lookupLazyFuncSegment(pc);
 }
 
 struct CallSiteRetAddrOffset {
@@ -993,19 +1201,33 @@ struct CallSiteRetAddrOffset {
   }
 };
 
+static const CallSite* LookupCallSite(const CallSiteVector& callSites,
+                                      uint32_t target) {
+  size_t lowerBound = 0;
+  size_t upperBound = callSites.length();
+
+  size_t match;
+  if (BinarySearch(CallSiteRetAddrOffset(callSites), lowerBound, upperBound,
+                   target, &match)) {
+    return &callSites[match];
+  }
+  return nullptr;
+}
+
 const CallSite* Code::lookupCallSite(void* returnAddress) const {
   for (Tier t : tiers()) {
     uint32_t target = ((uint8_t*)returnAddress) - segment(t).base();
-    size_t lowerBound = 0;
-    size_t upperBound = metadata(t).callSites.length();
-
-    size_t match;
-    if (BinarySearch(CallSiteRetAddrOffset(metadata(t).callSites), lowerBound,
-                     upperBound, target, &match)) {
-      return &metadata(t).callSites[match];
+    if (const CallSite* callSite =
+            LookupCallSite(metadata(t).callSites, target)) {
+      return callSite;
     }
   }
 
+  if (const LazyFuncSegment* lazy = lookupLazyFuncSegment(returnAddress)) {
+    uint32_t target = ((uint8_t*)returnAddress) - lazy->base();
+    return LookupCallSite(lazy->callSites, target);
+  }
+
   return nullptr;
 }
 
@@ -1016,6 +1238,13 @@ const CodeRange* Code::lookupFuncRange(void* pc) const {
       return result;
     }
   }
+
+  if (const LazyFuncSegment* lazy = lookupLazyFuncSegment(pc)) {
+    const CodeRange* result = lazy->lookupRange(pc);
+    if (result && result->isFunction()) {
+      return result;
+    }
+  }
   return nullptr;
 }
 
@@ -1026,17 +1255,33 @@ const StackMap* Code::lookupStackMap(uint8_t* nextPC) const {
       return result;
     }
   }
+
+  if (const LazyFuncSegment* lazy = lookupLazyFuncSegment(nextPC)) {
+    return lazy->stackMaps.findMap(nextPC);
+  }
   return nullptr;
 }
 
-const wasm::TryNote* Code::lookupTryNote(void* pc, Tier* tier) const {
+const wasm::TryNote* Code::lookupTryNote(void* pc,
+                                         const uint8_t** codeBase) const {
   for (Tier t : tiers()) {
     const TryNote* result = codeTier(t).lookupTryNote(pc);
     if (result) {
-      *tier = t;
+      *codeBase = segment(t).base();
       return result;
     }
   }
+
+  if (const LazyFuncSegment* lazy = lookupLazyFuncSegment(pc)) {
+    // As in CodeTier::lookupTryNote, the first hit is the innermost handler.
+    size_t target = (uint8_t*)pc - lazy->base();
+    for (const TryNote& tryNote : lazy->tryNotes) {
+      if (tryNote.offsetWithinTryBody(target)) {
+        *codeBase = lazy->base();
+        return &tryNote;
+      }
+    }
+  }
   return nullptr;
 }
 
@@ -1047,27 +1292,40 @@ struct TrapSitePCOffset {
   uint32_t operator[](size_t index) const { return trapSites[index].pcOffset; }
 };
 
+static bool LookupTrap(const TrapSiteVectorArray& trapSitesArray,
+                       uint32_t target, Trap* trapOut,
+                       BytecodeOffset* bytecode) {
+  for (Trap trap : MakeEnumeratedRange(Trap::Limit)) {
+    const TrapSiteVector& trapSites = trapSitesArray[trap];
+
+    size_t lowerBound = 0;
+    size_t upperBound = trapSites.length();
+
+    size_t match;
+    if (BinarySearch(TrapSitePCOffset(trapSites), lowerBound, upperBound,
+                     target, &match)) {
+      *trapOut = trap;
+      *bytecode = trapSites[match].bytecode;
+      return true;
+    }
+  }
+  return false;
+}
+
 bool Code::lookupTrap(void* pc, Trap* trapOut, BytecodeOffset* bytecode) const {
   for (Tier t : tiers()) {
-    const TrapSiteVectorArray& trapSitesArray = metadata(t).trapSites;
-    for (Trap trap : MakeEnumeratedRange(Trap::Limit)) {
-      const TrapSiteVector& trapSites = trapSitesArray[trap];
-
-      uint32_t target = ((uint8_t*)pc) - segment(t).base();
-      size_t lowerBound = 0;
-      size_t upperBound = trapSites.length();
-
-      size_t match;
-      if (BinarySearch(TrapSitePCOffset(trapSites), lowerBound, upperBound,
-                       target, &match)) {
-        MOZ_ASSERT(segment(t).containsCodePC(pc));
-        *trapOut = trap;
-        *bytecode = trapSites[match].bytecode;
-        return true;
-      }
+    uint32_t target = ((uint8_t*)pc) - segment(t).base();
+    if (LookupTrap(metadata(t).trapSites, target, trapOut, bytecode)) {
+      MOZ_ASSERT(segment(t).containsCodePC(pc));
+      return true;
     }
   }
 
+  if (const LazyFuncSegment* lazy = lookupLazyFuncSegment(pc)) {
+    uint32_t target = ((uint8_t*)pc) - lazy->base();
+    return LookupTrap(lazy->trapSites, target, trapOut, bytecode);
+  }
+
   return false;
 }
 
@@ -1168,6 +1426,10 @@ void Code::addSizeOfMiscIfNotSeen(MallocSizeOf mallocSizeOf,
   for (auto t : tiers()) {
     codeTier(t).addSizeOfMisc(mallocSizeOf, code, data);
   }
+
+  if (lazyFuncs_) {
+    lazyFuncs_->addSizeOfMisc(mallocSizeOf, code, data);
+  }
 }
 
 void Code::disassemble(JSContext* cx, Tier tier, int kindSelection,
@@ -144,6 +144,7 @@ class Code;
 class CodeTier;
 class ModuleSegment;
 class LazyStubSegment;
+class LazyFuncSegment;
 
 // CodeSegment contains common helpers for determining the base and length of a
 // code segment and if a pc belongs to this segment. It is inherited by:
@@ -151,10 +152,12 @@ class LazyStubSegment;
 // eagerly when a Module is instanciated.
 // - LazyStubSegment, i.e. the code segment of entry stubs that are lazily
 // generated.
+// - LazyFuncSegment, i.e. the code segment of a function that is lazily
+// compiled on its first call.
 
 class CodeSegment {
  protected:
-  enum class Kind { LazyStubs, Module };
+  enum class Kind { LazyStubs, LazyFunc, Module };
 
   CodeSegment(UniqueCodeBytes bytes, uint32_t length, Kind kind)
       : bytes_(std::move(bytes)),
@@ -177,6 +180,7 @@ class CodeSegment {
   ~CodeSegment();
 
   bool isLazyStubs() const { return kind_ == Kind::LazyStubs; }
+  bool isLazyFunc() const { return kind_ == Kind::LazyFunc; }
   bool isModule() const { return kind_ == Kind::Module; }
   const ModuleSegment* asModule() const {
     MOZ_ASSERT(isModule());
@@ -186,6 +190,15 @@ class CodeSegment {
     MOZ_ASSERT(isLazyStubs());
     return (LazyStubSegment*)this;
   }
+  const LazyFuncSegment* asLazyFunc() const {
+    MOZ_ASSERT(isLazyFunc());
+    return (LazyFuncSegment*)this;
+  }
+
+  // Module and lazy function segments contain function bodies, which may
+  // trap. Traps are redirected to the trap exit stub of the module.
+  bool hasTraps() const { return !isLazyStubs(); }
+  uint8_t* trapCode() const;
 
   uint8_t* base() const { return bytes_.get(); }
   uint32_t length() const {
@@ -241,7 +254,7 @@ class ModuleSegment : public CodeSegment {
 };
 
 extern UniqueCodeBytes AllocateCodeBytes(uint32_t codeLength);
-extern bool StaticallyLink(const ModuleSegment& ms, const LinkData& linkData);
+extern bool StaticallyLink(uint8_t* base, const LinkData& linkData);
 extern void StaticallyUnlink(uint8_t* base, const LinkData& linkData);
 
 // A FuncExport represents a single function definition inside a wasm Module
@@ -549,6 +562,36 @@ struct LazyFuncExport {
 
 using LazyFuncExportVector = Vector<LazyFuncExport, 0, SystemAllocPolicy>;
 
+// LazyFuncSegment is the code segment of one function of a module compiled
+// with CompilerEnvironment::lazyFuncs(), generated the first time the function
+// is called. Unlike for a ModuleSegment, the offsets in its metadata are
+// relative to the base of the segment itself.
+
+using UniqueLazyFuncSegment = UniquePtr<LazyFuncSegment>;
+using LazyFuncSegmentVector =
+    Vector<UniqueLazyFuncSegment, 0, SystemAllocPolicy>;
+
+class LazyFuncSegment : public CodeSegment {
+ public:
+  LazyFuncSegment(UniqueCodeBytes bytes, size_t length)
+      : CodeSegment(std::move(bytes), length, CodeSegment::Kind::LazyFunc) {}
+
+  CodeRangeVector codeRanges;
+  CallSiteVector callSites;
+  TrapSiteVectorArray trapSites;
+  StackMaps stackMaps;
+  TryNoteVector tryNotes;
+
+  // Makes the code executable and visible to other threads, so the metadata
+  // must be final.
+  [[nodiscard]] bool initialize(const CodeTier& codeTier);
+
+  [[nodiscard]] const CodeRange* lookupRange(const void* pc) const;
+
+  void addSizeOfMisc(MallocSizeOf mallocSizeOf, size_t* code,
+                     size_t* data) const;
+};
+
 // LazyStubTier contains all the necessary information for lazy function entry
 // stubs that are generated at runtime. None of its data are ever serialized.
 //
@@ -695,7 +738,7 @@ class JumpTables {
       "SelfHostedLazyScript");
 
  public:
-  bool init(CompileMode mode, const ModuleSegment& ms,
+  bool init(CompileMode mode, bool lazyFuncs, const ModuleSegment& ms,
             const CodeRangeVector& codeRanges);
 
   void setJitEntry(size_t i, void* target) const {
@@ -727,10 +770,15 @@ class JumpTables {
   void setTieringEntry(size_t i, void* target) const {
     MOZ_ASSERT(i < numFuncs_);
     // See comment in wasm::Module::finishTier2.
-    if (mode_ == CompileMode::Tier1) {
+    if (tiering_) {
       tiering_.get()[i] = target;
     }
   }
+  void* getTieringEntry(size_t i) const {
+    MOZ_ASSERT(i < numFuncs_);
+    MOZ_ASSERT(tiering_);
+    return tiering_.get()[i];
+  }
   void** tiering() const { return tiering_.get(); }
 
   size_t sizeOfMiscExcludingThis() const {
@@ -740,6 +788,63 @@ class JumpTables {
   }
 };
 
+// The bytecode range of a function body, relative to the start of the module.
+
+struct LazyFuncBody {
+  uint32_t offset;
+  uint32_t length;
+};
+
+using LazyFuncBodyVector = Vector<LazyFuncBody, 0, SystemAllocPolicy>;
+
+// LazyFuncs holds everything needed to compile the functions of a module that
+// was compiled with CompilerEnvironment::lazyFuncs(), and the code compiled so
+// far.
+//
+// Such a module is fully validated up front, but its tier-1 code only holds a
+// small stub for each function definition. The stub has the prologue of a
+// tiering function, so calls go through the tiering jump table, which
+// initially points back into the stub. The stub then calls
+// Instance::lazyCompileFunc, which compiles the function with the baseline
+// compiler into its own LazyFuncSegment and points the jump table entry at it.
+// The stub finally jumps through the jump table, as will all later calls.
+//
+// Direct calls in lazily compiled code are patched to the callee's stub, so
+// that they too go through the jump table.
+
+class LazyFuncs;
+using UniqueLazyFuncs = UniquePtr<LazyFuncs>;
+
+class LazyFuncs {
+  struct State {
+    // Decoded on the first compilation, as in CompileTier2.
+    UniquePtr<ModuleEnvironment> moduleEnv;
+    LazyFuncSegmentVector segments;
+  };
+
+  const SharedCompileArgs compileArgs_;
+  const SharedBytes bytecode_;
+  const LazyFuncBodyVector bodies_;
+  const uint32_t numFuncDefs_;
+  mutable mozilla::Atomic<uint32_t> numCompiled_;
+  ExclusiveData<State> state_;
+
+ public:
+  LazyFuncs(const CompileArgs& compileArgs, const ShareableBytes& bytecode,
+            LazyFuncBodyVector&& bodies, uint32_t numFuncDefs);
+  ~LazyFuncs();
+
+  // Compiles function funcIndex of |code| unless it has been compiled already.
+  [[nodiscard]] bool compile(const Code& code, uint32_t funcIndex,
+                             UniqueChars* error) const;
+
+  uint32_t numFuncDefs() const { return numFuncDefs_; }
+  uint32_t numCompiled() const { return numCompiled_; }
+
+  void addSizeOfMisc(MallocSizeOf mallocSizeOf, size_t* code,
+                     size_t* data) const;
+};
+
 // Code objects own executable code and the metadata that describe it. A single
 // Code object is normally shared between a module and all its instances.
 //
@@ -774,6 +879,9 @@ class Code : public ShareableBase<Code> {
   SharedMetadata metadata_;
   ExclusiveData<CacheableCharsVector> profilingLabels_;
   JumpTables jumpTables_;
+  UniqueLazyFuncs lazyFuncs_;
+
+  const LazyFuncSegment* lookupLazyFuncSegment(const void* pc) const;
 
  public:
   Code(UniqueCodeTier tier1, const Metadata& metadata,
@@ -782,9 +890,20 @@ class Code : public ShareableBase<Code> {
 
   bool initialize(const LinkData& linkData);
 
+  // Must be called before initialize() for code compiled with
+  // CompilerEnvironment::lazyFuncs().
+  void setLazyFuncs(UniqueLazyFuncs lazyFuncs) {
+    MOZ_ASSERT(!initialized());
+    lazyFuncs_ = std::move(lazyFuncs);
+  }
+  const LazyFuncs* lazyFuncs() const { return lazyFuncs_.get(); }
+
   void setTieringEntry(size_t i, void* target) const {
     jumpTables_.setTieringEntry(i, target);
   }
+  void* getTieringEntry(size_t i) const {
+    return jumpTables_.getTieringEntry(i);
+  }
   void** tieringJumpTable() const { return jumpTables_.tiering(); }
 
   void setJitEntry(size_t i, void* target) const {
@@ -829,7 +948,7 @@ class Code : public ShareableBase<Code> {
   const CallSite* lookupCallSite(void* returnAddress) const;
   const CodeRange* lookupFuncRange(void* pc) const;
   const StackMap* lookupStackMap(uint8_t* nextPC) const;
-  const TryNote* lookupTryNote(void* pc, Tier* tier) const;
+  const TryNote* lookupTryNote(void* pc, const uint8_t** codeBase) const;
   bool containsCodePC(const void* pc) const;
   bool lookupTrap(void* pc, Trap* trap, BytecodeOffset* bytecode) const;
 
@@ -102,6 +102,16 @@ FeatureArgs FeatureArgs::build(JSContext* cx, const FeatureOptions& options) {
   return features;
 }
 
+// Lazily compiled functions reach other functions through patched near calls,
+// so all code must be within reach of one.
+static bool PlatformCanCompileLazily() {
+#ifdef __wasi__
+  return false;
+#else
+  return MaxCodeBytesPerProcess <= JumpImmediateRange;
+#endif
+}
+
 SharedCompileArgs CompileArgs::build(JSContext* cx,
                                      ScriptedCaller&& scriptedCaller,
                                      const FeatureOptions& options,
@@ -118,6 +128,11 @@ SharedCompileArgs CompileArgs::build(JSContext* cx,
   bool forceTiering =
       cx->options().testWasmAwaitTier2() || JitOptions.wasmDelayTier2;
 
+  FeatureArgs features = FeatureArgs::build(cx, options);
+
+  bool lazyFuncs = JitOptions.wasmLazyCompile && baseline && !debug &&
+                   !features.testSerialization && PlatformCanCompileLazily();
+
   // The <Compiler>Available() predicates should ensure no failure here, but
   // when we're fuzzing we allow inconsistent switches and the check may thus
   // fail.  Let it go to a run-time error instead of crashing.
@@ -148,7 +163,8 @@ SharedCompileArgs CompileArgs::build(JSContext* cx,
   target->ionEnabled = ion;
   target->debugEnabled = debug;
   target->forceTiering = forceTiering;
-  target->features = FeatureArgs::build(cx, options);
+  target->lazyFuncs = lazyFuncs;
+  target->features = features;
 
   return target;
 }
@@ -590,11 +606,12 @@ static bool PlatformCanTier() {
 }
 
 CompilerEnvironment::CompilerEnvironment(const CompileArgs& args)
-    : state_(InitialWithArgs), args_(&args) {}
+    : state_(InitialWithArgs), lazyFuncs_(false), args_(&args) {}
 
 CompilerEnvironment::CompilerEnvironment(CompileMode mode, Tier tier,
                                          DebugEnabled debugEnabled)
     : state_(InitialWithModeTierDebug),
+      lazyFuncs_(false),
       mode_(mode),
       tier_(tier),
       debug_(debugEnabled) {}
@@ -618,6 +635,16 @@ void CompilerEnvironment::computeParameters(Decoder& d) {
   bool debugEnabled = args_->debugEnabled;
   bool forceTiering = args_->forceTiering;
 
+  if (args_->lazyFuncs) {
+    MOZ_ASSERT(baselineEnabled && !debugEnabled);
+    lazyFuncs_ = true;
+    mode_ = CompileMode::Once;
+    tier_ = Tier::Baseline;
+    debug_ = DebugEnabled::False;
+    state_ = Computed;
+    return;
+  }
+
   bool hasSecondTier = ionEnabled;
   MOZ_ASSERT_IF(debugEnabled, baselineEnabled);
   MOZ_ASSERT_IF(forceTiering, baselineEnabled && hasSecondTier);
@@ -137,6 +137,7 @@ struct CompileArgs : ShareableBase<CompileArgs> {
   bool ionEnabled;
   bool debugEnabled;
   bool forceTiering;
+  bool lazyFuncs;
 
   FeatureArgs features;
 
@@ -167,7 +168,8 @@ struct CompileArgs : ShareableBase<CompileArgs> {
         baselineEnabled(false),
         ionEnabled(false),
         debugEnabled(false),
-        forceTiering(false) {}
+        forceTiering(false),
+        lazyFuncs(false) {}
 };
 
 // CompilerEnvironment holds any values that will be needed to compute
@@ -186,6 +188,7 @@ struct CompilerEnvironment {
   enum State { InitialWithArgs, InitialWithModeTierDebug, Computed };
 
   State state_;
+  bool lazyFuncs_;
   union {
     // Value if the state_ == InitialWithArgs.
     const CompileArgs* args_;
@@ -230,6 +233,14 @@ struct CompilerEnvironment {
     return debug_;
   }
   bool debugEnabled() const { return debug() == DebugEnabled::True; }
+
+  // When true, function bodies are only validated and each function is
+  // compiled with the baseline compiler when it is first called. Implies
+  // CompileMode::Once and Tier::Baseline.
+  bool lazyFuncs() const {
+    MOZ_ASSERT(isComputed());
+    return lazyFuncs_;
+  }
 };
 
 }  // namespace wasm
@@ -1662,6 +1662,8 @@ static const char* ThunkedNativeToDescription(SymbolicAddress func) {
       return "call to native exception new (in wasm)";
     case SymbolicAddress::ThrowException:
       return "call to native throw exception (in wasm)";
+    case SymbolicAddress::LazyCompileFunc:
+      return "call to native lazy function compilation (in wasm)";
     case SymbolicAddress::ArrayNew:
       return "call to native array.new (in wasm)";
     case SymbolicAddress::ArrayNewData:
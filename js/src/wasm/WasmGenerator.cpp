@@ -237,6 +237,14 @@ bool ModuleGenerator::init(Metadata* maybeAsmJSMetadata) {
     return false;
   }
 
+  // With lazy function compilation, the bodies are compiled at run time, from
+  // the bytecode.
+
+  if (compilerEnv_->lazyFuncs() &&
+      !lazyFuncBodies_.appendN(LazyFuncBody(), moduleEnv_->funcs.length())) {
+    return false;
+  }
+
   // Pre-reserve space for large Vectors to avoid the significant cost of the
   // final reallocs. In particular, the MacroAssembler can be enormous, so be
   // extra conservative. Since large over-reservations may fail when the
@@ -690,6 +698,15 @@ static bool ExecuteCompileTask(CompileTask* task, UniqueChars* error) {
   MOZ_ASSERT(task->lifo.isEmpty());
   MOZ_ASSERT(task->output.empty());
 
+  if (task->compilerEnv.lazyFuncs()) {
+    if (!GenerateLazyFuncStubs(task->moduleEnv, task->inputs, &task->output,
+                               error)) {
+      return false;
+    }
+    task->inputs.clear();
+    return true;
+  }
+
   switch (task->compilerEnv.tier()) {
     case Tier::Optimized:
       if (!IonCompileFunctions(task->moduleEnv, task->compilerEnv, task->lifo,
@@ -870,6 +887,10 @@ bool ModuleGenerator::compileFuncDef(uint32_t funcIndex,
     return false;
   }
 
+  if (compilerEnv_->lazyFuncs()) {
+    lazyFuncBodies_[funcIndex] = {lineOrBytecode, funcBytecodeLength};
+  }
+
   batchedBytecode_ += funcBytecodeLength;
   MOZ_ASSERT(batchedBytecode_ <= MaxCodeSectionBytes);
   return true;
@@ -1099,7 +1120,7 @@ SharedModule ModuleGenerator::finishModule(
   }
 
   JumpTables jumpTables;
-  if (!jumpTables.init(mode(), codeTier->segment(),
+  if (!jumpTables.init(mode(), compilerEnv_->lazyFuncs(), codeTier->segment(),
                        codeTier->metadata().codeRanges)) {
     return nullptr;
   }
@@ -1156,7 +1177,21 @@ SharedModule ModuleGenerator::finishModule(
 
   MutableCode code =
       js_new<Code>(std::move(codeTier), *metadata, std::move(jumpTables));
-  if (!code || !code->initialize(*linkData_)) {
+  if (!code) {
+    return nullptr;
+  }
+
+  if (compilerEnv_->lazyFuncs()) {
+    UniqueLazyFuncs lazyFuncs = js::MakeUnique<LazyFuncs>(
+        *compileArgs_, bytecode, std::move(lazyFuncBodies_),
+        moduleEnv_->numFuncDefs());
+    if (!lazyFuncs) {
+      return nullptr;
+    }
+    code->setLazyFuncs(std::move(lazyFuncs));
+  }
+
+  if (!code->initialize(*linkData_)) {
     return nullptr;
   }
 
@@ -190,6 +190,7 @@ class MOZ_STACK_CLASS ModuleGenerator {
   CallSiteTargetVector callSiteTargets_;
   uint32_t lastPatchedCallSite_;
   uint32_t startOfUnpatchedCallsites_;
+  LazyFuncBodyVector lazyFuncBodies_;
 
   // Parallel compilation
   bool parallel_;
@@ -1486,6 +1486,30 @@ bool Instance::initElems(uint32_t tableIndex, const ElemSegment& seg,
   return -1;
 }
 
+/* static */ int32_t Instance::lazyCompileFunc(Instance* instance,
+                                               uint32_t funcIndex) {
+  MOZ_ASSERT(SASigLazyCompileFunc.failureMode == FailureMode::FailOnNegI32);
+
+  // Called from the stub of a function of a module compiled with
+  // CompilerEnvironment::lazyFuncs(), see wasm::LazyFuncs. The stub frame
+  // has no stack map, so nothing here may GC unless compilation fails.
+  const LazyFuncs* lazyFuncs = instance->code().lazyFuncs();
+  MOZ_ASSERT(lazyFuncs);
+
+  UniqueChars error;
+  if (!lazyFuncs->compile(instance->code(), funcIndex, &error)) {
+    JSContext* cx = instance->cx();
+    if (error) {
+      JS_ReportErrorNumberUTF8(cx, GetErrorMessage, nullptr,
+                               JSMSG_WASM_COMPILE_ERROR, error.get());
+    } else {
+      ReportOutOfMemory(cx);
+    }
+    return -1;
+  }
+  return 0;
+}
+
 /* static */ int32_t Instance::refTest(Instance* instance, void* refPtr,
                                        const wasm::TypeDef* typeDef) {
   MOZ_ASSERT(SASigRefTest.failureMode == FailureMode::Infallible);
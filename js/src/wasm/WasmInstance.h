@@ -456,6 +456,7 @@ class alignas(16) Instance {
   static void* structNew(Instance* instance, TypeDefInstanceData* typeDefData);
   static void* exceptionNew(Instance* instance, JSObject* tag);
   static int32_t throwException(Instance* instance, JSObject* exn);
+  static int32_t lazyCompileFunc(Instance* instance, uint32_t funcIndex);
   static void* arrayNew(Instance* instance, uint32_t numElements,
                         TypeDefInstanceData* typeDefData);
   static void* arrayNewData(Instance* instance, uint32_t segByteOffset,
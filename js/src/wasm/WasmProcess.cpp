@@ -255,8 +255,13 @@ const CodeSegment* wasm::LookupCodeSegment(
 
   if (const CodeSegment* found = map->lookup(pc)) {
     if (codeRange) {
-      *codeRange = found->isModule() ? found->asModule()->lookupRange(pc)
-                                     : found->asLazyStub()->lookupRange(pc);
+      if (found->isModule()) {
+        *codeRange = found->asModule()->lookupRange(pc);
+      } else if (found->isLazyFunc()) {
+        *codeRange = found->asLazyFunc()->lookupRange(pc);
+      } else {
+        *codeRange = found->asLazyStub()->lookupRange(pc);
+      }
     }
     return found;
   }
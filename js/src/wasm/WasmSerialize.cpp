@@ -1029,7 +1029,8 @@ CoderResult CodeSharedCode(Coder<MODE_DECODE>& coder, wasm::SharedCode* item,
 
   // Initialize the jump tables
   JumpTables jumpTables;
-  if (!jumpTables.init(CompileMode::Once, codeTier->segment(),
+  if (!jumpTables.init(CompileMode::Once, /* lazyFuncs = */ false,
+                       codeTier->segment(),
                        codeTier->metadata().codeRanges)) {
     return Err(OutOfMemory());
   }
@@ -508,11 +508,11 @@ struct AutoHandlingTrap {
 
   uint8_t* pc = ContextToPC(context);
   const CodeSegment* codeSegment = LookupCodeSegment(pc);
-  if (!codeSegment || !codeSegment->isModule()) {
+  if (!codeSegment || !codeSegment->hasTraps()) {
     return false;
   }
 
-  const ModuleSegment& segment = *codeSegment->asModule();
+  const CodeSegment& segment = *codeSegment;
 
   Trap trap;
   BytecodeOffset bytecode;
@@ -984,11 +984,11 @@ bool wasm::MemoryAccessTraps(const RegisterState& regs, uint8_t* addr,
   return false;
 #else
   const wasm::CodeSegment* codeSegment = wasm::LookupCodeSegment(regs.pc);
-  if (!codeSegment || !codeSegment->isModule()) {
+  if (!codeSegment || !codeSegment->hasTraps()) {
     return false;
   }
 
-  const wasm::ModuleSegment& segment = *codeSegment->asModule();
+  const wasm::CodeSegment& segment = *codeSegment;
 
   Trap trap;
   BytecodeOffset bytecode;
@@ -1052,11 +1052,11 @@ bool wasm::HandleIllegalInstruction(const RegisterState& regs,
   return false;
 #else
   const wasm::CodeSegment* codeSegment = wasm::LookupCodeSegment(regs.pc);
-  if (!codeSegment || !codeSegment->isModule()) {
+  if (!codeSegment || !codeSegment->hasTraps()) {
     return false;
   }
 
-  const wasm::ModuleSegment& segment = *codeSegment->asModule();
+  const wasm::CodeSegment& segment = *codeSegment;
 
   Trap trap;
   BytecodeOffset bytecode;
@@ -30,6 +30,7 @@
 #include "wasm/WasmCode.h"
 #include "wasm/WasmGenerator.h"
 #include "wasm/WasmInstance.h"
+#include "wasm/WasmValidate.h"
 
 #include "jit/MacroAssembler-inl.h"
 #include "wasm/WasmInstance-inl.h"
@@ -2924,6 +2925,104 @@ static bool GenerateDebugTrapStub(MacroAssembler& masm, Label* throwLabel,
   return FinishOffsets(masm, offsets);
 }
 
+// Generate the stub standing in for a function of a module compiled with
+// CompilerEnvironment::lazyFuncs(), see wasm::LazyFuncs. The stub has the
+// prologue of a tiering function, whose jump table entry initially points
+// right past the prologue. From there, the stub compiles the function and
+// then enters it through the updated jump table, with the frame and the
+// arguments as set up for the function.
+static bool GenerateLazyFuncStub(MacroAssembler& masm,
+                                 const ModuleEnvironment& env,
+                                 const FuncCompileInput& func,
+                                 FuncOffsets* offsets) {
+  AutoCreatedBy acb(masm, "wasm::GenerateLazyFuncStub");
+
+  AssertExpectedSP(masm);
+
+  GenerateFunctionPrologue(masm, CallIndirectId::forFunc(env, func.index),
+                           Some(func.index), offsets);
+
+  // The arguments are live, so save all registers the function may use.
+  MOZ_ASSERT(masm.framePushed() == 0);
+  LiveRegisterSet savedRegs = AllAllocatableRegs;
+  savedRegs.addUnchecked(InstanceReg);
+  masm.PushRegsInMask(savedRegs);
+
+  WasmABIArgGenerator abi;
+  ABIArg instanceArg = abi.next(MIRType::Pointer);
+  ABIArg funcIndexArg = abi.next(MIRType::Int32);
+  uint32_t argBytes = StackDecrementForCall(
+      WasmStackAlignment, sizeof(Frame) + masm.framePushed(),
+      abi.stackBytesConsumedSoFar());
+  masm.reserveStack(argBytes);
+
+  if (funcIndexArg.kind() == ABIArg::GPR) {
+    masm.move32(Imm32(func.index), funcIndexArg.gpr());
+  } else {
+    masm.store32(Imm32(func.index),
+                 Address(masm.getStackPointer(),
+                         funcIndexArg.offsetFromArgBase()));
+  }
+
+  masm.assertStackAlignment(WasmStackAlignment);
+  CallSiteDesc desc(func.lineOrBytecode, CallSiteDesc::Symbolic);
+  masm.wasmCallBuiltinInstanceMethod(desc, instanceArg,
+                                     SymbolicAddress::LazyCompileFunc,
+                                     FailureMode::FailOnNegI32);
+
+  masm.freeStack(argBytes);
+  masm.PopRegsInMask(savedRegs);
+  MOZ_ASSERT(masm.framePushed() == 0);
+
+  Register scratch = ABINonArgReg0;
+  masm.loadPtr(Address(InstanceReg, Instance::offsetOfJumpTable()), scratch);
+  masm.jump(Address(scratch, func.index * sizeof(uintptr_t)));
+
+  // Not reached, but gives the stub the layout of a function.
+  GenerateFunctionEpilogue(masm, 0, offsets);
+  return FinishOffsets(masm, offsets);
+}
+
+bool wasm::GenerateLazyFuncStubs(const ModuleEnvironment& env,
+                                 const FuncCompileInputVector& inputs,
+                                 CompiledCode* code, UniqueChars* error) {
+  LifoAlloc lifo(STUBS_LIFO_DEFAULT_CHUNK_SIZE);
+  TempAllocator alloc(&lifo);
+  JitContext jitContext;
+  WasmMacroAssembler masm(alloc, env);
+
+  // Swap in already-allocated empty vectors to avoid malloc/free.
+  MOZ_ASSERT(code->empty());
+  if (!code->swap(masm)) {
+    return false;
+  }
+
+  for (const FuncCompileInput& func : inputs) {
+    // The body is only compiled when the function is first called, but it is
+    // validated now so that compilation errors are reported as usual.
+    Decoder d(func.begin, func.end, func.lineOrBytecode, error);
+    if (!ValidateFunctionBody(env, func.index, func.end - func.begin, d)) {
+      return false;
+    }
+
+    FuncOffsets offsets;
+    if (!GenerateLazyFuncStub(masm, env, func, &offsets)) {
+      return false;
+    }
+    if (!code->codeRanges.emplaceBack(func.index, func.lineOrBytecode,
+                                      offsets)) {
+      return false;
+    }
+  }
+
+  masm.finish();
+  if (masm.oom()) {
+    return false;
+  }
+
+  return code->swap(masm);
+}
+
 bool wasm::GenerateEntryStubs(MacroAssembler& masm, size_t funcExportIndex,
                               const FuncExport& fe, const FuncType& funcType,
                               const Maybe<ImmPtr>& callee, bool isAsmJS,
@@ -255,6 +255,10 @@ extern bool GenerateImportFunctions(const ModuleEnvironment& env,
                                     const FuncImportVector& imports,
                                     CompiledCode* code);
 
+extern bool GenerateLazyFuncStubs(const ModuleEnvironment& env,
+                                  const FuncCompileInputVector& inputs,
+                                  CompiledCode* code, UniqueChars* error);
+
 extern bool GenerateStubs(const ModuleEnvironment& env,
                           const FuncImportVector& imports,
                           const FuncExportVector& exports, CompiledCode* code);
@@ -2533,6 +2533,11 @@ void JSReporter::CollectReports(WindowPaths* windowPaths,
                gStats.helperThread.parseTask,
                "The memory used by ParseTasks waiting in HelperThreadState.");
 
+  REPORT_BYTES(
+      "explicit/js-non-window/helper-thread/baseline-compile-task"_ns,
+      KIND_HEAP, gStats.helperThread.baselineCompileTask,
+      "The memory used by BaselineCompileTasks waiting in HelperThreadState.");
+
   REPORT_BYTES(
       "explicit/js-non-window/helper-thread/ion-compile-task"_ns, KIND_HEAP,
       gStats.helperThread.ionCompileTask,
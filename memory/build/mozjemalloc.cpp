@@ -203,6 +203,15 @@ using namespace mozilla;
 #  define MALLOC_DECOMMIT
 #endif
 
+// On Linux, huge allocations can be backed by transparent huge pages when
+// MALLOC_OPTIONS contains 'H'. They are then aligned to the huge page size and
+// advised with MADV_HUGEPAGE, which fewer TLB entries cover than 4KiB pages.
+// Arena chunks are not, since their guard pages and partial purges would
+// split any huge page right away.
+#if defined(XP_LINUX) && defined(MADV_HUGEPAGE)
+#  define MALLOC_THP
+#endif
+
 // Define MALLOC_RUNTIME_CONFIG depending on MOZ_DEBUG. Overriding this as
 // a build option allows us to build mozjemalloc/firefox without runtime asserts
 // but with runtime configuration. Making some testing easier.
@@ -1351,6 +1360,8 @@ static RedBlackTree<extent_node_t, ExtentTreeTrait> huge
 // Huge allocation statistics.
 static size_t huge_allocated MOZ_GUARDED_BY(huge_mtx);
 static size_t huge_mapped MOZ_GUARDED_BY(huge_mtx);
+// Bytes of huge allocations in regions advised for transparent huge pages.
+static size_t huge_thp_advised MOZ_GUARDED_BY(huge_mtx);
 
 // **************************
 // base (internal allocation).
@@ -1402,6 +1413,12 @@ static const bool opt_poison = true;
 static const bool opt_zero = false;
 #endif
 static bool opt_randomize_small = true;
+#ifdef MALLOC_THP
+static bool opt_thp = false;
+
+static const size_t kHugePageSize = 2_MiB;
+static const size_t kHugePageSizeMask = kHugePageSize - 1;
+#endif
 
 // ***************************************************************************
 // Begin forward declarations.
@@ -3961,6 +3978,26 @@ arena_t* ArenaCollection::CreateArena(bool aIsPrivate,
 // ***************************************************************************
 // Begin general internal functions.
 
+// Returns how many bytes of the huge allocation of aSize bytes at aAddr are
+// advised for transparent huge pages: the whole huge pages it covers, if it
+// starts on one.
+static size_t huge_thp_size(const void* aAddr, size_t aSize) {
+#ifdef MALLOC_THP
+  if (opt_thp && (uintptr_t(aAddr) & kHugePageSizeMask) == 0) {
+    return aSize & ~kHugePageSizeMask;
+  }
+#endif
+  return 0;
+}
+
+static void huge_thp_advise(void* aAddr, size_t aSize) {
+#ifdef MALLOC_THP
+  if (aSize) {
+    madvise(aAddr, aSize, MADV_HUGEPAGE);
+  }
+#endif
+}
+
 void* arena_t::MallocHuge(size_t aSize, bool aZero) {
   return PallocHuge(aSize, kChunkSize, aZero);
 }
@@ -3987,6 +4024,14 @@ void* arena_t::PallocHuge(size_t aSize, size_t aAlignment, bool aZero) {
     return nullptr;
   }
 
+#ifdef MALLOC_THP
+  // Start allocations which span a huge page on one, so that the kernel can
+  // back them with huge pages.
+  if (opt_thp && csize >= kHugePageSize) {
+    aAlignment = std::max(aAlignment, kHugePageSize);
+  }
+#endif
+
   // Allocate one or more contiguous chunks for this request.
   ret = chunk_alloc(csize, aAlignment, false, &zeroed);
   if (!ret) {
@@ -3994,6 +4039,10 @@ void* arena_t::PallocHuge(size_t aSize, size_t aAlignment, bool aZero) {
     return nullptr;
   }
   psize = PAGE_CEILING(aSize);
+
+  // Advise before the pages are first touched below.
+  size_t thpSize = huge_thp_size(ret, psize);
+  huge_thp_advise(ret, thpSize);
   if (aZero) {
     // We will decommit anything past psize so there is no need to zero
     // further.
@@ -4030,6 +4079,7 @@ void* arena_t::PallocHuge(size_t aSize, size_t aAlignment, bool aZero) {
     // reasonably claim we never "allocated" them in the first place.
     huge_allocated += psize;
     huge_mapped += csize;
+    huge_thp_advised += thpSize;
   }
 
   pages_decommit((void*)((uintptr_t)ret + psize), csize - psize);
@@ -4065,6 +4115,8 @@ void* arena_t::RallocHuge(void* aPtr, size_t aSize, size_t aOldSize) {
       MOZ_ASSERT(node->mSize == aOldSize);
       MOZ_RELEASE_ASSERT(node->mArena == this);
       huge_allocated -= aOldSize - psize;
+      huge_thp_advised -=
+          huge_thp_size(aPtr, aOldSize) - huge_thp_size(aPtr, psize);
       // No need to change huge_mapped, because we didn't (un)map anything.
       node->mSize = psize;
     } else if (psize > aOldSize) {
@@ -4072,6 +4124,8 @@ void* arena_t::RallocHuge(void* aPtr, size_t aSize, size_t aOldSize) {
                         psize - aOldSize)) {
         return nullptr;
       }
+      // Committing maps the new pages afresh, without the advice.
+      huge_thp_advise(aPtr, huge_thp_size(aPtr, psize));
 
       // We need to update the recorded size if the size increased,
       // so malloc_usable_size doesn't return a value smaller than
@@ -4084,6 +4138,8 @@ void* arena_t::RallocHuge(void* aPtr, size_t aSize, size_t aOldSize) {
       MOZ_ASSERT(node->mSize == aOldSize);
       MOZ_RELEASE_ASSERT(node->mArena == this);
       huge_allocated += psize - aOldSize;
+      huge_thp_advised +=
+          huge_thp_size(aPtr, psize) - huge_thp_size(aPtr, aOldSize);
       // No need to change huge_mapped, because we didn't
       // (un)map anything.
       node->mSize = psize;
@@ -4136,6 +4192,7 @@ static void huge_dalloc(void* aPtr, arena_t* aArena) {
     mapped = CHUNK_CEILING(node->mSize + gPageSize);
     huge_allocated -= node->mSize;
     huge_mapped -= mapped;
+    huge_thp_advised -= huge_thp_size(node->mAddr, node->mSize);
   }
 
   // Unmap chunk.
@@ -4260,6 +4317,14 @@ static bool malloc_init_hard() {
             }
             break;
 #  endif
+#endif
+#ifdef MALLOC_THP
+          case 'h':
+            opt_thp = false;
+            break;
+          case 'H':
+            opt_thp = true;
+            break;
 #endif
           case 'r':
             opt_randomize_small = false;
@@ -4300,6 +4365,7 @@ static bool malloc_init_hard() {
   huge.Init();
   huge_allocated = 0;
   huge_mapped = 0;
+  huge_thp_advised = 0;
   MOZ_POP_THREAD_SAFETY
 
   // Initialize base allocation data structures.
@@ -4585,6 +4651,7 @@ inline void MozJemalloc::jemalloc_stats_internal(
   aStats->page_cache = 0;
   aStats->bookkeeping = 0;
   aStats->bin_unused = 0;
+  aStats->thp_advised = 0;
 
   non_arena_mapped = 0;
 
@@ -4593,6 +4660,7 @@ inline void MozJemalloc::jemalloc_stats_internal(
     MutexAutoLock lock(huge_mtx);
     non_arena_mapped += huge_mapped;
     aStats->allocated += huge_allocated;
+    aStats->thp_advised += huge_thp_advised;
     MOZ_ASSERT(huge_mapped >= huge_allocated);
   }
 
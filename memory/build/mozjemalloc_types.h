@@ -101,6 +101,8 @@ typedef struct {
   size_t bookkeeping;  // Committed bytes used internally by the
                        // allocator.
   size_t bin_unused;   // Bytes committed to a bin but currently unused.
+  size_t thp_advised;  // Bytes of huge allocations advised for transparent
+                       // huge pages (MALLOC_OPTIONS=H).
 } jemalloc_stats_t;
 
 typedef struct {
@@ -11,6 +11,7 @@
 #include "nsIChannel.h"
 #include "nsError.h"
 #include "mozilla/ProfilerLabels.h"
+#include "TaintTrace.h"
 
 #include <limits>
 
@@ -206,12 +207,9 @@ nsIncrementalStreamLoader::OnDataAvailable(nsIRequest* request,
   // TaintFox: see if there's taint information available.
   nsCOMPtr<nsITaintawareInputStream> taintInputStream(do_QueryInterface(inStr));
 
-#if (DEBUG_E2E_TAINTING)
-  if (!taintInputStream)
-    puts("!!!!! NO taint-aware input stream available in nsIncrementalStreamLoader::OnDataAvailable !!!!!");
-  else
-    puts("+++++ Taint-aware input stream available in nsIncrementalStreamLoader::OnDataAvailable +++++");
-#endif
+  if (!taintInputStream) {
+    TaintTrace(TaintTraceEvent::Drop, this, "nsIncrementalStreamLoader::OnDataAvailable", count);
+  }
 
   uint32_t countRead;
   nsresult rv;
@@ -7,6 +7,7 @@
 #include "mozilla/EndianUtils.h"
 #include "mozilla/dom/TypedArray.h"
 #include "mozilla/HoldDropJSObjects.h"
+#include "mozilla/StaticMutex.h"
 #include "mozilla/Telemetry.h"
 
 #include "nsQueryObject.h"
@@ -24,6 +25,7 @@
 #include "IOActivityMonitor.h"
 #include "nsServiceManagerUtils.h"
 #include "nsStreamUtils.h"
+#include "prenv.h"
 #include "prerror.h"
 #include "nsThreadUtils.h"
 #include "nsIDNSRecord.h"
@@ -39,11 +41,58 @@
 #  include "mozilla/StaticPrefs_fuzzing.h"
 #endif
 
+#if defined(XP_LINUX)
+#  include <errno.h>
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#  include <sys/uio.h>
+#  include "private/pprio.h"
+
+#  ifndef SOL_UDP
+#    define SOL_UDP 17
+#  endif
+#  ifndef UDP_SEGMENT
+#    define UDP_SEGMENT 103
+#  endif
+#  ifndef UDP_GRO
+#    define UDP_GRO 104
+#  endif
+#endif
+
 namespace mozilla {
 namespace net {
 
 static const uint32_t UDP_PACKET_CHUNK_SIZE = 1400;
 
+// Bug 1252755 - use 9216 bytes to allign with nICEr and transportlayer to
+// support the maximum size of jumbo frames
+static const uint32_t UDP_MAX_DATAGRAM_SIZE = 9216;
+
+#if defined(XP_LINUX)
+// Number of messages handed to a single recvmmsg or sendmmsg call.
+static const uint32_t UDP_BATCH_SIZE = 32;
+// With GRO the kernel coalesces datagrams of one flow into buffers of up to
+// 64KB, so fewer (but larger) receive buffers are used.
+static const uint32_t UDP_GRO_BATCH_SIZE = 8;
+static const uint32_t UDP_GRO_BUFFER_SIZE = 65535;
+static const uint32_t UDP_RECV_BATCH_BUFFER_SIZE =
+    std::max(UDP_BATCH_SIZE * UDP_MAX_DATAGRAM_SIZE,
+             UDP_GRO_BATCH_SIZE * UDP_GRO_BUFFER_SIZE);
+// Limits of a single GSO send, see UDP_MAX_SEGMENTS in the kernel.
+static const uint32_t UDP_GSO_MAX_SEGMENTS = 64;
+static const uint32_t UDP_GSO_MAX_BYTES = 65000;
+// Number of datagrams handed to a single sendmmsg call.
+static const uint32_t UDP_SEND_BATCH_DATAGRAMS = 128;
+
+// The receive buffers of recvmmsg. The datagrams are copied out of them
+// before RecvBatchWithAddr returns, and it is only called on the socket
+// thread, so all sockets share them. They are allocated by the first batched
+// receive and freed with the last socket which received a batch.
+static StaticMutex sRecvBatchBufferLock MOZ_UNANNOTATED;
+static uint8_t* sRecvBatchBuffer = nullptr;
+static uint32_t sRecvBatchBufferUsers = 0;
+#endif
+
 //-----------------------------------------------------------------------------
 
 using nsUDPSocketFunc = void (nsUDPSocket::*)();
@@ -407,9 +456,7 @@ void nsUDPSocket::OnSocketReady(PRFileDesc* fd, int16_t outFlags) {
 
   PRNetAddr prClientAddr;
   int32_t count;
-  // Bug 1252755 - use 9216 bytes to allign with nICEr and transportlayer to
-  // support the maximum size of jumbo frames
-  char buff[9216];
+  char buff[UDP_MAX_DATAGRAM_SIZE];
   count = PR_RecvFrom(mFD, buff, sizeof(buff), 0, &prClientAddr,
                       PR_INTERVAL_NO_WAIT);
   if (count < 0) {
@@ -627,6 +674,8 @@ nsUDPSocket::InitWithAddress(const NetAddr* aAddr, nsIPrincipal* aPrincipal,
 
   PRNetAddrToNetAddr(&addr, &mAddr);
 
+  InitBatchIO();
+
   // create proxy via IOActivityMonitor
   IOActivityMonitor::MonitorSocket(mFD);
 
@@ -767,6 +816,7 @@ void nsUDPSocket::CloseSocket() {
     }
     mFD = nullptr;
   }
+  ReleaseRecvBatchBuffer();
 }
 
 NS_IMETHODIMP
@@ -1164,6 +1214,8 @@ nsUDPSocket::SendWithAddress(const NetAddr* aAddr,
       PRErrorCode code = PR_GetError();
       return ErrorAccordingToNSPR(code);
     }
+    mSendSyscallCount++;
+    mSendDatagramCount++;
     this->AddOutputBytes(count);
     *_retval = count;
   } else {
@@ -1212,13 +1264,15 @@ nsUDPSocket::RecvWithAddr(NetAddr* addr, nsTArray<uint8_t>& aData) {
   MOZ_ASSERT(OnSocketThread(), "not on socket thread");
   PRNetAddr prAddr;
   int32_t count;
-  char buff[9216];
+  char buff[UDP_MAX_DATAGRAM_SIZE];
   count = PR_RecvFrom(mFD, buff, sizeof(buff), 0, &prAddr, PR_INTERVAL_NO_WAIT);
   if (count < 0) {
     UDPSOCKET_LOG(
         ("nsUDPSocket::RecvWithAddr: PR_RecvFrom failed [this=%p]\n", this));
     return NS_OK;
   }
+  mRecvSyscallCount++;
+  mRecvDatagramCount++;
   mByteReadCount += count;
   PRNetAddrToNetAddr(&prAddr, addr);
 
@@ -1230,6 +1284,461 @@ nsUDPSocket::RecvWithAddr(NetAddr* addr, nsTArray<uint8_t>& aData) {
   return NS_OK;
 }
 
+NS_IMETHODIMP
+nsUDPSocket::RecvBatchWithAddr(uint32_t aMaxDatagrams,
+                               nsTArray<UDPDatagram>& aDatagrams) {
+  MOZ_ASSERT(OnSocketThread(), "not on socket thread");
+  if (!mFD) {
+    return NS_OK;
+  }
+
+  if (mBatchIO) {
+    nsresult rv = RecvBatchNative(aMaxDatagrams, aDatagrams);
+    if (rv != NS_ERROR_NOT_AVAILABLE) {
+      return rv;
+    }
+  }
+
+  for (uint32_t i = 0; i < aMaxDatagrams && NS_SUCCEEDED(mCondition); i++) {
+    UDPDatagram* datagram = aDatagrams.AppendElement();
+    RecvWithAddr(&datagram->mAddr, datagram->mData);
+    if (datagram->mData.IsEmpty()) {
+      aDatagrams.RemoveLastElement();
+      break;
+    }
+  }
+  return NS_OK;
+}
+
+NS_IMETHODIMP
+nsUDPSocket::SendBatchWithAddress(const nsTArray<UDPDatagram>& aDatagrams,
+                                  uint32_t* _retval) {
+  MOZ_ASSERT(OnSocketThread(), "not on socket thread");
+  NS_ENSURE_ARG_POINTER(_retval);
+
+  *_retval = 0;
+
+  MutexAutoLock lock(mLock);
+  if (!mFD) {
+    // socket is not initialized or has been closed
+    return NS_ERROR_FAILURE;
+  }
+
+  if (mBatchIO) {
+    nsresult rv = SendBatchNative(aDatagrams, _retval);
+    if (rv != NS_ERROR_NOT_AVAILABLE) {
+      return rv;
+    }
+  }
+
+  for (; *_retval < aDatagrams.Length(); (*_retval)++) {
+    nsresult rv = SendOne(aDatagrams[*_retval]);
+    if (rv == NS_BASE_STREAM_WOULD_BLOCK) {
+      break;
+    }
+    if (NS_FAILED(rv)) {
+      return rv;
+    }
+  }
+  return NS_OK;
+}
+
+nsresult nsUDPSocket::SendOne(const UDPDatagram& aDatagram) {
+  PRNetAddr prAddr;
+  NetAddrToPRNetAddr(&aDatagram.mAddr, &prAddr);
+
+  int32_t count = PR_SendTo(mFD, aDatagram.mData.Elements(),
+                            aDatagram.mData.Length(), 0, &prAddr,
+                            PR_INTERVAL_NO_WAIT);
+  if (count < 0) {
+    return ErrorAccordingToNSPR(PR_GetError());
+  }
+  mSendSyscallCount++;
+  mSendDatagramCount++;
+  AddOutputBytes(count);
+  return NS_OK;
+}
+
+NS_IMETHODIMP
+nsUDPSocket::GetRecvSyscallCount(uint64_t* aCount) {
+  *aCount = mRecvSyscallCount;
+  return NS_OK;
+}
+
+NS_IMETHODIMP
+nsUDPSocket::GetRecvDatagramCount(uint64_t* aCount) {
+  *aCount = mRecvDatagramCount;
+  return NS_OK;
+}
+
+NS_IMETHODIMP
+nsUDPSocket::GetSendSyscallCount(uint64_t* aCount) {
+  *aCount = mSendSyscallCount;
+  return NS_OK;
+}
+
+NS_IMETHODIMP
+nsUDPSocket::GetSendDatagramCount(uint64_t* aCount) {
+  *aCount = mSendDatagramCount;
+  return NS_OK;
+}
+
+#if defined(XP_LINUX)
+
+static socklen_t NetAddrToSockaddr(const NetAddr& aAddr,
+                                   sockaddr_storage* aSockaddr) {
+  memset(aSockaddr, 0, sizeof(*aSockaddr));
+  if (aAddr.raw.family == AF_INET) {
+    auto* sin = reinterpret_cast<sockaddr_in*>(aSockaddr);
+    sin->sin_family = AF_INET;
+    sin->sin_port = aAddr.inet.port;
+    sin->sin_addr.s_addr = aAddr.inet.ip;
+    return sizeof(sockaddr_in);
+  }
+  if (aAddr.raw.family == AF_INET6) {
+    auto* sin6 = reinterpret_cast<sockaddr_in6*>(aSockaddr);
+    sin6->sin6_family = AF_INET6;
+    sin6->sin6_port = aAddr.inet6.port;
+    sin6->sin6_flowinfo = aAddr.inet6.flowinfo;
+    memcpy(&sin6->sin6_addr, &aAddr.inet6.ip, sizeof(sin6->sin6_addr));
+    sin6->sin6_scope_id = aAddr.inet6.scope_id;
+    return sizeof(sockaddr_in6);
+  }
+  return 0;
+}
+
+static void SockaddrToNetAddr(const sockaddr_storage& aSockaddr,
+                              NetAddr* aAddr) {
+  *aAddr = NetAddr();
+  if (aSockaddr.ss_family == AF_INET) {
+    const auto* sin = reinterpret_cast<const sockaddr_in*>(&aSockaddr);
+    aAddr->inet.family = AF_INET;
+    aAddr->inet.port = sin->sin_port;
+    aAddr->inet.ip = sin->sin_addr.s_addr;
+  } else if (aSockaddr.ss_family == AF_INET6) {
+    const auto* sin6 = reinterpret_cast<const sockaddr_in6*>(&aSockaddr);
+    aAddr->inet6.family = AF_INET6;
+    aAddr->inet6.port = sin6->sin6_port;
+    aAddr->inet6.flowinfo = sin6->sin6_flowinfo;
+    memcpy(&aAddr->inet6.ip, &sin6->sin6_addr, sizeof(aAddr->inet6.ip));
+    aAddr->inet6.scope_id = sin6->sin6_scope_id;
+  }
+}
+
+static nsresult ErrorAccordingToErrno(int aErrno) {
+  PRErrorCode code;
+  switch (aErrno) {
+    case ECONNREFUSED:
+      code = PR_CONNECT_REFUSED_ERROR;
+      break;
+    case ENETUNREACH:
+      code = PR_NETWORK_UNREACHABLE_ERROR;
+      break;
+    case EHOSTUNREACH:
+      code = PR_HOST_UNREACHABLE_ERROR;
+      break;
+    case ENOBUFS:
+    case ENOMEM:
+      code = PR_INSUFFICIENT_RESOURCES_ERROR;
+      break;
+    default:
+      code = PR_UNKNOWN_ERROR;
+      break;
+  }
+  return ErrorAccordingToNSPR(code);
+}
+
+void nsUDPSocket::InitBatchIO() {
+#  ifdef FUZZING
+  // The fuzzing layer has to see every read and write.
+  if (StaticPrefs::fuzzing_necko_enabled()) {
+    return;
+  }
+#  endif
+  if (PR_GetEnv("MOZ_UDP_DISABLE_BATCH_IO")) {
+    return;
+  }
+
+  int fd = PR_FileDesc2NativeHandle(mFD);
+  if (fd < 0) {
+    return;
+  }
+  mBatchIO = true;
+
+  // GSO is supported if the kernel knows the socket option at all. GRO is
+  // only switched on by the first recvBatchWithAddr call, since the other
+  // receive paths cannot split coalesced datagrams.
+  int segment = 0;
+  socklen_t length = sizeof(segment);
+  mGSO = getsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment, &length) == 0;
+
+  UDPSOCKET_LOG(("nsUDPSocket::InitBatchIO gso=%d [this=%p]\n", mGSO, this));
+}
+
+nsresult nsUDPSocket::RecvBatchNative(uint32_t aMaxDatagrams,
+                                      nsTArray<UDPDatagram>& aDatagrams) {
+  int fd = PR_FileDesc2NativeHandle(mFD);
+
+  if (!mRecvBatchBufferUser) {
+    {
+      StaticMutexAutoLock lock(sRecvBatchBufferLock);
+      if (!sRecvBatchBufferUsers++) {
+        sRecvBatchBuffer = new uint8_t[UDP_RECV_BATCH_BUFFER_SIZE];
+      }
+    }
+    mRecvBatchBufferUser = true;
+
+    int enable = 1;
+    mGRO = setsockopt(fd, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+    UDPSOCKET_LOG(("nsUDPSocket::RecvBatchNative gro=%d [this=%p]\n", mGRO,
+                   this));
+  }
+
+  uint32_t bufferSize = mGRO ? UDP_GRO_BUFFER_SIZE : UDP_MAX_DATAGRAM_SIZE;
+  uint32_t count = std::min(aMaxDatagrams,
+                            mGRO ? UDP_GRO_BATCH_SIZE : UDP_BATCH_SIZE);
+  if (!count) {
+    return NS_OK;
+  }
+
+  mmsghdr msgs[UDP_BATCH_SIZE];
+  iovec iovs[UDP_BATCH_SIZE];
+  sockaddr_storage addrs[UDP_BATCH_SIZE];
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    cmsghdr align;
+  } controls[UDP_BATCH_SIZE];
+
+  memset(msgs, 0, sizeof(mmsghdr) * count);
+  for (uint32_t i = 0; i < count; i++) {
+    iovs[i].iov_base = sRecvBatchBuffer + i * bufferSize;
+    iovs[i].iov_len = bufferSize;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+    if (mGRO) {
+      msgs[i].msg_hdr.msg_control = controls[i].buf;
+      msgs[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+    }
+  }
+
+  int received;
+  do {
+    received = recvmmsg(fd, msgs, count, MSG_DONTWAIT, nullptr);
+  } while (received < 0 && errno == EINTR);
+
+  if (received < 0) {
+    if (errno == ENOSYS || errno == EOPNOTSUPP) {
+      UDPSOCKET_LOG(
+          ("nsUDPSocket::RecvBatchNative: recvmmsg unsupported [this=%p]\n",
+           this));
+      mBatchIO = false;
+      mGRO = false;
+      return NS_ERROR_NOT_AVAILABLE;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      UDPSOCKET_LOG(
+          ("nsUDPSocket::RecvBatchNative: recvmmsg failed errno=%d "
+           "[this=%p]\n",
+           errno, this));
+    }
+    return NS_OK;
+  }
+  mRecvSyscallCount++;
+
+  for (int i = 0; i < received; i++) {
+    const msghdr& hdr = msgs[i].msg_hdr;
+    uint32_t length = msgs[i].msg_len;
+    const uint8_t* data = static_cast<const uint8_t*>(iovs[i].iov_base);
+
+    // A GRO buffer holds datagrams of the same size, except for the last one
+    // which may be shorter.
+    uint32_t segmentSize = length;
+    if (mGRO) {
+      for (cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg;
+           cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&hdr), cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+          int size;
+          memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+          if (size > 0) {
+            segmentSize = size;
+          }
+        }
+      }
+    }
+
+    NetAddr addr;
+    SockaddrToNetAddr(addrs[i], &addr);
+    mByteReadCount += length;
+
+    for (uint32_t offset = 0; offset < length; offset += segmentSize) {
+      uint32_t size = std::min(segmentSize, length - offset);
+      UDPDatagram* datagram = aDatagrams.AppendElement(fallible);
+      if (!datagram ||
+          !datagram->mData.AppendElements(data + offset, size, fallible)) {
+        UDPSOCKET_LOG(
+            ("nsUDPSocket::RecvBatchNative: AppendElements FAILED "
+             "[this=%p]\n",
+             this));
+        mCondition = NS_ERROR_UNEXPECTED;
+        return NS_OK;
+      }
+      datagram->mAddr = addr;
+      mRecvDatagramCount++;
+    }
+  }
+  return NS_OK;
+}
+
+void nsUDPSocket::ReleaseRecvBatchBuffer() {
+  if (!mRecvBatchBufferUser) {
+    return;
+  }
+  mRecvBatchBufferUser = false;
+
+  StaticMutexAutoLock lock(sRecvBatchBufferLock);
+  if (!--sRecvBatchBufferUsers) {
+    delete[] sRecvBatchBuffer;
+    sRecvBatchBuffer = nullptr;
+  }
+}
+
+nsresult nsUDPSocket::SendBatchNative(const nsTArray<UDPDatagram>& aDatagrams,
+                                      uint32_t* aSent) {
+  int fd = PR_FileDesc2NativeHandle(mFD);
+
+  mmsghdr msgs[UDP_BATCH_SIZE];
+  sockaddr_storage addrs[UDP_BATCH_SIZE];
+  iovec iovs[UDP_SEND_BATCH_DATAGRAMS];
+  uint32_t segments[UDP_BATCH_SIZE];
+  union {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
+    cmsghdr align;
+  } controls[UDP_BATCH_SIZE];
+
+  while (*aSent < aDatagrams.Length()) {
+    // Fill up to UDP_BATCH_SIZE messages. With GSO, consecutive datagrams to
+    // the same address are merged into one message as long as all but the
+    // last one have the same size.
+    uint32_t count = 0;
+    uint32_t next = *aSent;
+    uint32_t iovCount = 0;
+    memset(msgs, 0, sizeof(msgs));
+    while (count < UDP_BATCH_SIZE && iovCount < UDP_SEND_BATCH_DATAGRAMS &&
+           next < aDatagrams.Length()) {
+      const UDPDatagram& first = aDatagrams[next];
+      socklen_t addrLength = NetAddrToSockaddr(first.mAddr, &addrs[count]);
+      if (!addrLength) {
+        return NS_ERROR_INVALID_ARG;
+      }
+
+      msghdr& hdr = msgs[count].msg_hdr;
+      hdr.msg_name = &addrs[count];
+      hdr.msg_namelen = addrLength;
+      hdr.msg_iov = &iovs[iovCount];
+
+      uint32_t segmentSize = first.mData.Length();
+      uint32_t bytes = 0;
+      uint32_t n = 0;
+      do {
+        const UDPDatagram& datagram = aDatagrams[next];
+        iovs[iovCount].iov_base =
+            const_cast<uint8_t*>(datagram.mData.Elements());
+        iovs[iovCount].iov_len = datagram.mData.Length();
+        iovCount++;
+        bytes += datagram.mData.Length();
+        next++;
+        n++;
+      } while (mGSO && n < UDP_GSO_MAX_SEGMENTS &&
+               iovCount < UDP_SEND_BATCH_DATAGRAMS &&
+               next < aDatagrams.Length() &&
+               aDatagrams[next - 1].mData.Length() == segmentSize &&
+               aDatagrams[next].mData.Length() <= segmentSize &&
+               bytes + aDatagrams[next].mData.Length() <= UDP_GSO_MAX_BYTES &&
+               aDatagrams[next].mAddr == first.mAddr);
+      hdr.msg_iovlen = n;
+
+      if (n > 1) {
+        hdr.msg_control = controls[count].buf;
+        hdr.msg_controllen = sizeof(controls[count].buf);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t gsoSize = segmentSize;
+        memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(gsoSize));
+      }
+      segments[count] = n;
+      count++;
+    }
+
+    int sent;
+    do {
+      sent = sendmmsg(fd, msgs, count, MSG_DONTWAIT);
+    } while (sent < 0 && errno == EINTR);
+
+    if (sent < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return NS_OK;
+      }
+      if (mGSO && (errno == EIO || errno == EINVAL)) {
+        // The device cannot offload segmentation (e.g. checksum offload is
+        // off). Retry the same datagrams without GSO.
+        UDPSOCKET_LOG(
+            ("nsUDPSocket::SendBatchNative: disabling GSO errno=%d "
+             "[this=%p]\n",
+             errno, this));
+        mGSO = false;
+        continue;
+      }
+      if (errno == ENOSYS || errno == EOPNOTSUPP) {
+        UDPSOCKET_LOG(
+            ("nsUDPSocket::SendBatchNative: sendmmsg unsupported [this=%p]\n",
+             this));
+        mBatchIO = false;
+        mGSO = false;
+        return NS_ERROR_NOT_AVAILABLE;
+      }
+      return ErrorAccordingToErrno(errno);
+    }
+    mSendSyscallCount++;
+
+    for (int i = 0; i < sent; i++) {
+      for (uint32_t j = 0; j < segments[i]; j++) {
+        AddOutputBytes(aDatagrams[*aSent].mData.Length());
+        (*aSent)++;
+        mSendDatagramCount++;
+      }
+    }
+
+    if (static_cast<uint32_t>(sent) < count) {
+      // The send buffer is full.
+      return NS_OK;
+    }
+  }
+
+  return NS_OK;
+}
+
+#else
+
+void nsUDPSocket::InitBatchIO() {}
+
+void nsUDPSocket::ReleaseRecvBatchBuffer() {}
+
+nsresult nsUDPSocket::RecvBatchNative(uint32_t aMaxDatagrams,
+                                      nsTArray<UDPDatagram>& aDatagrams) {
+  return NS_ERROR_NOT_AVAILABLE;
+}
+
+nsresult nsUDPSocket::SendBatchNative(const nsTArray<UDPDatagram>& aDatagrams,
+                                      uint32_t* aSent) {
+  return NS_ERROR_NOT_AVAILABLE;
+}
+
+#endif  // XP_LINUX
+
 nsresult nsUDPSocket::SetSocketOption(const PRSocketOptionData& aOpt) {
   bool onSTSThread = false;
   mSts->IsOnCurrentThread(&onSTSThread);
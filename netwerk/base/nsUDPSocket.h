@@ -57,6 +57,17 @@ class nsUDPSocket final : public nsASocketHandler, public nsIUDPSocket {
 
   void CloseSocket();
 
+  // Batched I/O with recvmmsg/sendmmsg. These return NS_ERROR_NOT_AVAILABLE
+  // if the kernel turns out not to support them; the caller then falls back
+  // to moving one datagram per system call.
+  void InitBatchIO();
+  nsresult RecvBatchNative(uint32_t aMaxDatagrams,
+                           nsTArray<UDPDatagram>& aDatagrams);
+  nsresult SendBatchNative(const nsTArray<UDPDatagram>& aDatagrams,
+                           uint32_t* aSent);
+  nsresult SendOne(const UDPDatagram& aDatagram);
+  void ReleaseRecvBatchBuffer();
+
   // lock protects access to mListener;
   // so mListener is not cleared while being used/locked.
   Mutex mLock MOZ_UNANNOTATED{"nsUDPSocket.mLock"};
@@ -71,6 +82,22 @@ class nsUDPSocket final : public nsASocketHandler, public nsIUDPSocket {
 
   uint64_t mByteReadCount{0};
   uint64_t mByteWriteCount{0};
+
+  // Whether recvmmsg/sendmmsg, UDP GRO and UDP GSO may be used. They are
+  // probed when the socket is created (GRO when the first batch is received)
+  // and switched off again if the kernel rejects them. Only used on the
+  // socket thread.
+  bool mBatchIO{false};
+  bool mGRO{false};
+  bool mGSO{false};
+  // Whether this socket holds a reference to the receive buffers shared by
+  // all sockets which receive batches.
+  bool mRecvBatchBufferUser{false};
+
+  uint64_t mRecvSyscallCount{0};
+  uint64_t mRecvDatagramCount{0};
+  uint64_t mSendSyscallCount{0};
+  uint64_t mSendDatagramCount{0};
 };
 
 //-----------------------------------------------------------------------------
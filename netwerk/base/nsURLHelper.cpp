@@ -910,30 +910,198 @@ bool net_IsValidIPv6Addr(const nsACString& aAddr) {
 }
 
 namespace mozilla {
-static auto MakeNameMatcher(const nsAString& aName) {
-  return [&aName](const auto& param) { return param.mKey.Equals(aName); };
+
+namespace {
+
+// Taintfox: the part of a converted string which a unit of the original string
+// ended up in.
+struct ConvertedSpan {
+  uint32_t mBegin;
+  uint32_t mEnd;
+};
+
+// Taintfox: moves the taint ranges of a string to the indices of a conversion
+// of it aLength units long, where aSpans[i] is what unit i was converted to.
+SafeStringTaint MapTaint(const StringTaint& aTaint,
+                         const nsTArray<ConvertedSpan>& aSpans,
+                         uint32_t aLength) {
+  SafeStringTaint result;
+  if (!aTaint.hasTaint()) {
+    return result;
+  }
+
+  uint32_t last = 0;
+  for (const TaintRange& range : aTaint) {
+    if (range.begin() >= aSpans.Length() || range.end() <= range.begin()) {
+      continue;
+    }
+    uint32_t end = std::min<uint32_t>(range.end(), aSpans.Length());
+    // Ranges which end in the middle of a character taint all of it, so they
+    // may overlap the next range.
+    uint32_t newBegin = std::max(aSpans[range.begin()].mBegin, last);
+    uint32_t newEnd = std::min(aSpans[end - 1].mEnd, aLength);
+    if (newBegin < newEnd) {
+      result.append(TaintRange(newBegin, newEnd, range.flow()));
+      last = newEnd;
+    }
+  }
+  return result;
+}
+
+// Taintfox: the taint of a UTF-8 string moved to the indices of its UTF-16
+// conversion, which is aLength units long.
+//
+// This follows the UTF-8 decoder of the Encoding Standard, which ConvertString
+// uses, so that malformed input maps to the U+FFFD characters it was replaced
+// by: a byte which can't start a sequence, or which doesn't continue the
+// sequence so far, ends that sequence as one U+FFFD and is then looked at
+// again as the start of the next.
+SafeStringTaint UTF16Taint(const nsACString& aInput, uint32_t aLength) {
+  if (IsAscii(aInput)) {
+    return aInput.Taint().safeCopy();
+  }
+
+  nsTArray<ConvertedSpan> spans(aInput.Length());
+  uint32_t end = 0;
+  // The bytes of the current sequence start at spans.Length().
+  uint32_t needed = 0;
+  uint32_t seen = 0;
+  uint8_t lower = 0x80;
+  uint8_t upper = 0xBF;
+  auto finishSequence = [&](uint32_t aBytes, uint32_t aUnits) {
+    ConvertedSpan span{end, end + aUnits};
+    for (uint32_t i = 0; i < aBytes; i++) {
+      spans.AppendElement(span);
+    }
+    end += aUnits;
+    needed = 0;
+    seen = 0;
+    lower = 0x80;
+    upper = 0xBF;
+  };
+
+  for (char c : aInput) {
+    uint8_t byte = uint8_t(c);
+    if (needed) {
+      if (byte >= lower && byte <= upper) {
+        lower = 0x80;
+        upper = 0xBF;
+        if (++seen == needed) {
+          // Four byte sequences become a surrogate pair.
+          finishSequence(needed + 1, needed == 3 ? 2 : 1);
+        }
+        continue;
+      }
+      // The sequence so far is replaced by U+FFFD.
+      finishSequence(seen + 1, 1);
+    }
+
+    if (byte < 0x80) {
+      finishSequence(1, 1);
+    } else if (byte >= 0xC2 && byte <= 0xDF) {
+      needed = 1;
+    } else if (byte >= 0xE0 && byte <= 0xEF) {
+      needed = 2;
+      lower = byte == 0xE0 ? 0xA0 : 0x80;
+      upper = byte == 0xED ? 0x9F : 0xBF;
+    } else if (byte >= 0xF0 && byte <= 0xF4) {
+      needed = 3;
+      lower = byte == 0xF0 ? 0x90 : 0x80;
+      upper = byte == 0xF4 ? 0x8F : 0xBF;
+    } else {
+      // Continuation bytes without a lead, overlong leads C0 and C1, and
+      // leads of F5 and above are each replaced by U+FFFD.
+      finishSequence(1, 1);
+    }
+  }
+  if (needed) {
+    // A truncated sequence at the end.
+    finishSequence(seen + 1, 1);
+  }
+
+  MOZ_ASSERT(end == aLength);
+  return MapTaint(aInput.Taint(), spans, aLength);
+}
+
+}  // namespace
+
+/* static */
+SafeStringTaint URLParams::UTF8Taint(const nsAString& aInput) {
+  if (!aInput.IsTainted()) {
+    return SafeStringTaint();
+  }
+  if (IsAscii(aInput)) {
+    return aInput.Taint().safeCopy();
+  }
+
+  nsTArray<ConvertedSpan> spans(aInput.Length());
+  uint32_t end = 0;
+  for (uint32_t i = 0, len = aInput.Length(); i < len; ++i) {
+    char16_t c = aInput[i];
+    uint32_t begin = end;
+    if (NS_IS_HIGH_SURROGATE(c) && i + 1 < len &&
+        NS_IS_LOW_SURROGATE(aInput[i + 1])) {
+      end += 4;
+      spans.AppendElement(ConvertedSpan{begin, end});
+      ++i;
+    } else {
+      // Lone surrogates become U+FFFD.
+      end += c < 0x80 ? 1 : c < 0x800 ? 2 : 3;
+    }
+    spans.AppendElement(ConvertedSpan{begin, end});
+  }
+  return MapTaint(aInput.Taint(), spans, end);
+}
+
+const nsString& URLParams::Key(const Param& aParam) const {
+  if (aParam.mKeyPending) {
+    DecodeString(Substring(mSource, aParam.mKeyStart, aParam.mKeyLength),
+                 aParam.mKey);
+    aParam.mKeyPending = false;
+  }
+  return aParam.mKey;
+}
+
+const nsString& URLParams::Value(const Param& aParam) const {
+  if (aParam.mValuePending) {
+    DecodeString(Substring(mSource, aParam.mValueStart, aParam.mValueLength),
+                 aParam.mValue);
+    aParam.mValuePending = false;
+  }
+  return aParam.mValue;
+}
+
+bool URLParams::KeyEquals(const Param& aParam, const nsAString& aName) const {
+  if (aParam.mKeyPending && aParam.mKeyIsPlain) {
+    return aName.EqualsASCII(mSource.BeginReading() + aParam.mKeyStart,
+                             aParam.mKeyLength);
+  }
+  return Key(aParam).Equals(aName);
 }
 
 bool URLParams::Has(const nsAString& aName) {
-  return std::any_of(mParams.cbegin(), mParams.cend(), MakeNameMatcher(aName));
+  return std::any_of(
+      mParams.cbegin(), mParams.cend(),
+      [&](const Param& aParam) { return KeyEquals(aParam, aName); });
 }
 
 void URLParams::Get(const nsAString& aName, nsString& aRetval) {
   SetDOMStringToNull(aRetval);
 
-  const auto end = mParams.cend();
-  const auto it = std::find_if(mParams.cbegin(), end, MakeNameMatcher(aName));
-  if (it != end) {
-    aRetval.Assign(it->mValue);
+  for (const Param& param : mParams) {
+    if (KeyEquals(param, aName)) {
+      aRetval.Assign(Value(param));
+      return;
+    }
   }
 }
 
 void URLParams::GetAll(const nsAString& aName, nsTArray<nsString>& aRetval) {
   aRetval.Clear();
 
-  for (uint32_t i = 0, len = mParams.Length(); i < len; ++i) {
-    if (mParams[i].mKey.Equals(aName)) {
-      aRetval.AppendElement(mParams[i].mValue);
+  for (const Param& param : mParams) {
+    if (KeyEquals(param, aName)) {
+      aRetval.AppendElement(Value(param));
     }
   }
 }
@@ -954,7 +1122,7 @@ void URLParams::Append(const nsAString& aName, const nsAString& aValue) {
 void URLParams::Set(const nsAString& aName, const nsAString& aValue) {
   Param* param = nullptr;
   for (uint32_t i = 0, len = mParams.Length(); i < len;) {
-    if (!mParams[i].mKey.Equals(aName)) {
+    if (!KeyEquals(mParams[i], aName)) {
       ++i;
       continue;
     }
@@ -974,11 +1142,12 @@ void URLParams::Set(const nsAString& aName, const nsAString& aValue) {
   }
 
   param->mValue = aValue;
+  param->mValuePending = false;
 }
 
 void URLParams::Delete(const nsAString& aName) {
   mParams.RemoveElementsBy(
-      [&aName](const auto& param) { return param.mKey.Equals(aName); });
+      [&](const Param& aParam) { return KeyEquals(aParam, aName); });
 }
 
 /* static */
@@ -1043,7 +1212,9 @@ void URLParams::DecodeString(const nsACString& aInput, nsAString& aOutput) {
   // then convert the whole string to UTF-16, at least if we exceed the inline
   // storage size.
   ConvertString(unescaped, aOutput);
-  aOutput.AssignTaint(unescaped.Taint());
+  if (unescaped.IsTainted()) {
+    aOutput.AssignTaint(UTF16Taint(unescaped, aOutput.Length()));
+  }
 }
 
 /* static */
@@ -1117,10 +1288,30 @@ void URLParams::ParseInput(const nsACString& aInput) {
   // Remove all the existing data before parsing a new input.
   DeleteAll();
 
-  URLParams::Parse(aInput, [this](nsString&& name, nsString&& value) {
-    mParams.AppendElement(Param{std::move(name), std::move(value)});
-    return true;
-  });
+  // Split the input as Parse() does, but leave the decoding to Key() and
+  // Value().  mSource keeps the taint of the input for them.
+  mSource = aInput;
+  const char* const base = mSource.BeginReading();
+  const char* const end = mSource.EndReading();
+  for (const char* start = base; start != end;) {
+    const char* const amp = std::find(start, end, '&');
+    if (amp != start) {
+      const char* const eq = std::find(start, amp, '=');
+      Param* param = mParams.AppendElement();
+      param->mKeyStart = start - base;
+      param->mKeyLength = eq - start;
+      param->mKeyPending = true;
+      param->mKeyIsPlain = std::all_of(start, eq, [](char c) {
+        return IsAscii(c) && c != '%' && c != '+';
+      });
+      if (eq != amp) {
+        param->mValueStart = eq + 1 - base;
+        param->mValueLength = amp - (eq + 1);
+        param->mValuePending = true;
+      }
+    }
+    start = amp == end ? end : amp + 1;
+  }
 }
 
 namespace {
@@ -1162,18 +1353,21 @@ void URLParams::Serialize(nsAString& aValue, bool aEncode) const {
     // XXX Actually, it's not necessary to build a new string object. Generally,
     // such cases could just convert each codepoint one-by-one.
     if (aEncode) {
-      SerializeString(NS_ConvertUTF16toUTF8(mParams[i].mKey), aValue);
+      SerializeString(NS_ConvertUTF16toUTF8(Key(mParams[i])), aValue);
       aValue.Append('=');
-      SerializeString(NS_ConvertUTF16toUTF8(mParams[i].mValue), aValue);
+      SerializeString(NS_ConvertUTF16toUTF8(Value(mParams[i])), aValue);
     } else {
-      aValue.Append(mParams[i].mKey);
+      aValue.Append(Key(mParams[i]));
       aValue.Append('=');
-      aValue.Append(mParams[i].mValue);
+      aValue.Append(Value(mParams[i]));
     }
   }
 }
 
 void URLParams::Sort() {
+  for (const Param& param : mParams) {
+    Key(param);
+  }
   mParams.StableSort([](const Param& lhs, const Param& rhs) {
     return Compare(lhs.mKey, rhs.mKey);
   });
@@ -233,6 +233,11 @@ namespace mozilla {
  * Manages an ordered list of name-value pairs, and allows conversion from and
  * to the string representation.
  *
+ * Parsed query strings are kept as they are, and each name and value is only
+ * percent-decoded when it is first read, so that pages which parse a long
+ * query string to read a single parameter don't pay for decoding the others.
+ * Names without escapes are compared against without decoding them at all.
+ *
  * In addition, there are static functions for handling one-shot use cases.
  */
 class URLParams final {
@@ -288,6 +293,12 @@ class URLParams final {
   static bool Extract(const nsACString& aInput, const nsAString& aName,
                       nsAString& aValue);
 
+  /**
+   * \brief Taintfox: returns the taint of aInput with its ranges moved to the
+   * corresponding indices of the UTF-8 encoding of aInput.
+   */
+  static SafeStringTaint UTF8Taint(const nsAString& aInput);
+
   /**
    * \brief Resets the state of this instance and parses a new query string.
    *
@@ -325,18 +336,21 @@ class URLParams final {
    */
   void Delete(const nsAString& aName);
 
-  void DeleteAll() { mParams.Clear(); }
+  void DeleteAll() {
+    mParams.Clear();
+    mSource.Truncate();
+  }
 
   uint32_t Length() const { return mParams.Length(); }
 
   const nsAString& GetKeyAtIndex(uint32_t aIndex) const {
     MOZ_ASSERT(aIndex < mParams.Length());
-    return mParams[aIndex].mKey;
+    return Key(mParams[aIndex]);
   }
 
   const nsAString& GetValueAtIndex(uint32_t aIndex) const {
     MOZ_ASSERT(aIndex < mParams.Length());
-    return mParams[aIndex].mValue;
+    return Value(mParams[aIndex]);
   }
 
   /**
@@ -354,11 +368,28 @@ class URLParams final {
                                 nsAString* aOutDecodedValue);
 
   struct Param {
-    nsString mKey;
-    nsString mValue;
+    // Empty until decoded if the parameter was parsed from mSource.
+    mutable nsString mKey;
+    mutable nsString mValue;
+    // The undecoded name and value in mSource.
+    uint32_t mKeyStart = 0;
+    uint32_t mKeyLength = 0;
+    uint32_t mValueStart = 0;
+    uint32_t mValueLength = 0;
+    mutable bool mKeyPending = false;
+    mutable bool mValuePending = false;
+    // The undecoded name is ASCII without escapes, so it can be compared as
+    // it is.
+    bool mKeyIsPlain = false;
   };
 
+  const nsString& Key(const Param& aParam) const;
+  const nsString& Value(const Param& aParam) const;
+  bool KeyEquals(const Param& aParam, const nsAString& aName) const;
+
   nsTArray<Param> mParams;
+  // The query string the pending parameters were parsed from, with its taint.
+  nsCString mSource;
 };
 }  // namespace mozilla
 
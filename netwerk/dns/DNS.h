@@ -157,6 +157,13 @@ union NetAddr {
   nsCString ToString() const;
 };
 
+// A datagram and the address it was received from or is sent to, see
+// nsIUDPSocket::recvBatchWithAddr.
+struct UDPDatagram {
+  NetAddr mAddr;
+  nsTArray<uint8_t> mData;
+};
+
 #define ODOH_VERSION 0x0001
 static const char kODoHQuery[] = "odoh query";
 static const char hODoHConfigID[] = "odoh key id";
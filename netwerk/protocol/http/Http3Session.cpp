@@ -323,22 +323,25 @@ void Http3Session::ProcessInput(nsIUDPSocket* socket) {
        mUdpConn.get(), this, mState));
 
   while (true) {
-    nsTArray<uint8_t> data;
-    NetAddr addr{};
-    // RecvWithAddr actually does not return an error.
-    nsresult rv = socket->RecvWithAddr(&addr, data);
+    nsTArray<UDPDatagram> datagrams;
+    // RecvBatchWithAddr actually does not return an error.
+    nsresult rv = socket->RecvBatchWithAddr(kMaxDatagramBatch, datagrams);
     MOZ_ALWAYS_SUCCEEDS(rv);
-    if (NS_FAILED(rv) || data.IsEmpty()) {
-      break;
-    }
-    rv = mHttp3Connection->ProcessInput(addr, data);
-    MOZ_ALWAYS_SUCCEEDS(rv);
-    if (NS_FAILED(rv)) {
+    if (NS_FAILED(rv) || datagrams.IsEmpty()) {
       break;
     }
 
-    LOG(("Http3Session::ProcessInput received=%zu", data.Length()));
-    mTotalBytesRead += data.Length();
+    for (const auto& datagram : datagrams) {
+      rv = mHttp3Connection->ProcessInput(datagram.mAddr, datagram.mData);
+      MOZ_ALWAYS_SUCCEEDS(rv);
+      if (NS_FAILED(rv)) {
+        return;
+      }
+
+      LOG(("Http3Session::ProcessInput received=%zu",
+           datagram.mData.Length()));
+      mTotalBytesRead += datagram.mData.Length();
+    }
   }
 }
 
@@ -797,7 +800,9 @@ nsresult Http3Session::ProcessOutput(nsIUDPSocket* socket) {
        this));
 
   // Check if we have a packet that could not have been sent in a previous
-  // iteration or maybe get new packets to send.
+  // iteration or maybe get new packets to send. Packets are collected into
+  // batches so that the socket can send several of them per system call.
+  nsTArray<UDPDatagram> datagrams;
   while (true) {
     nsTArray<uint8_t> packetToSend;
     nsAutoCString remoteAddrStr;
@@ -815,25 +820,46 @@ nsresult Http3Session::ProcessOutput(nsIUDPSocket* socket) {
          (uint32_t)packetToSend.Length(),
          PromiseFlatCString(remoteAddrStr).get(), port, this));
 
-    uint32_t written = 0;
     NetAddr addr;
     if (NS_FAILED(StringAndPortToNetAddr(remoteAddrStr, port, &addr))) {
       continue;
     }
-    nsresult rv = socket->SendWithAddress(&addr, packetToSend, &written);
-    LOG(("Http3Session::ProcessOutput sending packet rv=%d",
-         static_cast<int32_t>(rv)));
-    if (NS_FAILED(rv) && (rv != NS_BASE_STREAM_WOULD_BLOCK)) {
-      mSocketError = rv;
-      // If there was an error that is not NS_BASE_STREAM_WOULD_BLOCK
-      // return from here. We do not need to set a timer, because we
-      // will close the connection.
-      return rv;
+    datagrams.AppendElement(UDPDatagram{addr, std::move(packetToSend)});
+
+    if (datagrams.Length() == kMaxDatagramBatch) {
+      nsresult rv = SendDatagrams(socket, datagrams);
+      if (NS_FAILED(rv)) {
+        return rv;
+      }
     }
-    mTotalBytesWritten += packetToSend.Length();
-    mLastWriteTime = PR_IntervalNow();
   }
 
+  return SendDatagrams(socket, datagrams);
+}
+
+nsresult Http3Session::SendDatagrams(nsIUDPSocket* socket,
+                                     nsTArray<UDPDatagram>& datagrams) {
+  if (datagrams.IsEmpty()) {
+    return NS_OK;
+  }
+
+  uint32_t sent = 0;
+  nsresult rv = socket->SendBatchWithAddress(datagrams, &sent);
+  LOG(("Http3Session::SendDatagrams sent %u of %zu packets rv=%d [this=%p]",
+       sent, datagrams.Length(), static_cast<int32_t>(rv), this));
+  if (NS_FAILED(rv)) {
+    mSocketError = rv;
+    // We do not need to set a timer, because we will close the connection.
+    return rv;
+  }
+
+  // Like a single send which would block, packets which did not fit into the
+  // socket buffer are dropped and later retransmitted by neqo.
+  for (const auto& datagram : datagrams) {
+    mTotalBytesWritten += datagram.mData.Length();
+  }
+  mLastWriteTime = PR_IntervalNow();
+  datagrams.Clear();
   return NS_OK;
 }
 
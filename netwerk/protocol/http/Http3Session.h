@@ -222,6 +222,11 @@ class Http3Session final : public nsAHttpTransaction, public nsAHttpConnection {
 
   nsresult ProcessOutput(nsIUDPSocket* socket);
   void ProcessInput(nsIUDPSocket* socket);
+
+  // Maximum number of datagrams moved by one batched socket call.
+  static const uint32_t kMaxDatagramBatch = 32;
+  nsresult SendDatagrams(nsIUDPSocket* socket,
+                         nsTArray<UDPDatagram>& datagrams);
   nsresult ProcessEvents();
 
   nsresult ProcessTransactionRead(uint64_t stream_id);
@@ -245,6 +245,18 @@ void HttpConnectionUDP::Close(nsresult reason, bool aIsShutdown) {
     }
   }
   if (mSocket) {
+    if (LOG_ENABLED()) {
+      uint64_t recvSyscalls = 0, recvDatagrams = 0;
+      uint64_t sendSyscalls = 0, sendDatagrams = 0;
+      Unused << mSocket->GetRecvSyscallCount(&recvSyscalls);
+      Unused << mSocket->GetRecvDatagramCount(&recvDatagrams);
+      Unused << mSocket->GetSendSyscallCount(&sendSyscalls);
+      Unused << mSocket->GetSendDatagramCount(&sendDatagrams);
+      LOG(("HttpConnectionUDP::Close received %" PRIu64
+           " datagrams in %" PRIu64 " syscalls, sent %" PRIu64
+           " datagrams in %" PRIu64 " syscalls [this=%p]\n",
+           recvDatagrams, recvSyscalls, sendDatagrams, sendSyscalls, this));
+    }
     mSocket->Close();
     mSocket = nullptr;
   }
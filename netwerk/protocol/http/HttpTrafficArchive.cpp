@@ -0,0 +1,485 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim:set ts=4 sw=2 sts=2 et cin: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// HttpLog.h should generally be included first
+#include "HttpLog.h"
+
+#include "HttpTrafficArchive.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mozilla/ClearOnShutdown.h"
+#include "mozilla/EndianUtils.h"
+#include "mozilla/ScopeExit.h"
+#include "mozilla/StaticPtr.h"
+#include "nsIAsyncInputStream.h"
+#include "nsIAsyncOutputStream.h"
+#include "nsINamed.h"
+#include "nsIPipe.h"
+#include "nsITimer.h"
+#include "nsIURI.h"
+#include "nsHttpResponseHead.h"
+#include "nsNetUtil.h"
+#include "nsStringStream.h"
+#include "nsThreadUtils.h"
+#include "prenv.h"
+
+namespace mozilla {
+namespace net {
+
+// The archive is this magic string followed by the entries, each stored as
+// its key, head, time to first byte, duration and body. Strings are stored
+// as their length followed by their bytes, and integers as little endian
+// uint32_t.
+static const char kArchiveMagic[] = "MOZHTTPARCHIVE1\n";
+
+static StaticAutoPtr<HttpTrafficArchive> sArchive;
+static bool sArchiveInitialized = false;
+
+static uint32_t MillisecondsSince(const TimeStamp& aStart) {
+  double ms = (TimeStamp::Now() - aStart).ToMilliseconds();
+  return uint32_t(std::min(ms, double(UINT32_MAX)));
+}
+
+static uint32_t EnvToUint32(const char* aValue) {
+  unsigned long value = strtoul(aValue, nullptr, 10);
+  return uint32_t(std::min<unsigned long>(value, UINT32_MAX));
+}
+
+HttpTrafficArchive::Recording::Recording(const nsACString& aKey)
+    : mStart(TimeStamp::Now()) {
+  mEntry.mKey = aKey;
+}
+
+void HttpTrafficArchive::Recording::SetResponseHead(
+    nsHttpResponseHead* aHead) {
+  mEntry.mHead.Truncate();
+  aHead->Flatten(mEntry.mHead, false);
+  mEntry.mTimeToFirstByte = MillisecondsSince(mStart);
+}
+
+nsresult HttpTrafficArchive::Recording::ReadBody(nsIInputStream* aInput,
+                                                 uint32_t aCount,
+                                                 nsIInputStream** aResult) {
+  nsCString data;
+  nsresult rv = NS_ReadInputStreamToString(aInput, data, aCount);
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+
+  mEntry.mBody.Append(data);
+  return NS_NewCStringInputStream(aResult, std::move(data));
+}
+
+HttpTrafficArchive::Entry& HttpTrafficArchive::Recording::Finish() {
+  mEntry.mDuration = MillisecondsSince(mStart);
+  return mEntry;
+}
+
+// static
+HttpTrafficArchive* HttpTrafficArchive::Get() {
+  MOZ_ASSERT(NS_IsMainThread());
+  if (sArchiveInitialized) {
+    return sArchive;
+  }
+  sArchiveInitialized = true;
+
+  const char* recordPath = PR_GetEnv("MOZ_HTTP_ARCHIVE_RECORD");
+  const char* replayPath = PR_GetEnv("MOZ_HTTP_ARCHIVE_REPLAY");
+  bool record = recordPath && *recordPath;
+  bool replay = replayPath && *replayPath;
+  if (!record && !replay) {
+    return nullptr;
+  }
+
+  Options options;
+  if (const char* latency = PR_GetEnv("MOZ_HTTP_ARCHIVE_LATENCY")) {
+    if (!strcmp(latency, "recorded")) {
+      options.mRecordedTimings = true;
+    } else {
+      options.mLatency = EnvToUint32(latency);
+    }
+  }
+  if (const char* bandwidth = PR_GetEnv("MOZ_HTTP_ARCHIVE_BANDWIDTH")) {
+    options.mBandwidth = EnvToUint32(bandwidth);
+  }
+
+  if (replay) {
+    // Keep replaying when the archive can't be read, so that loads fail
+    // instead of reaching the network.
+    auto archive = MakeUnique<HttpTrafficArchive>(Mode::Replay, options);
+    if (NS_FAILED(archive->Open(replayPath))) {
+      NS_WARNING("Failed to read the HTTP archive to replay");
+    }
+    sArchive = archive.release();
+  } else {
+    auto archive = MakeUnique<HttpTrafficArchive>(Mode::Record, options);
+    if (NS_FAILED(archive->Create(recordPath))) {
+      NS_WARNING("Failed to create the HTTP archive to record");
+      return nullptr;
+    }
+    sArchive = archive.release();
+  }
+
+  ClearOnShutdown(&sArchive);
+  return sArchive;
+}
+
+// static
+void HttpTrafficArchive::SetForTesting(UniquePtr<HttpTrafficArchive> aArchive) {
+  MOZ_ASSERT(NS_IsMainThread());
+  sArchiveInitialized = true;
+  sArchive = aArchive.release();
+  if (sArchive) {
+    ClearOnShutdown(&sArchive);
+  }
+}
+
+HttpTrafficArchive::HttpTrafficArchive(Mode aMode, const Options& aOptions)
+    : mMode(aMode), mOptions(aOptions) {}
+
+HttpTrafficArchive::~HttpTrafficArchive() {
+  if (mFile) {
+    PR_Close(mFile);
+  }
+}
+
+// static
+void HttpTrafficArchive::KeyFor(const nsACString& aMethod, nsIURI* aURI,
+                                nsACString& aKey) {
+  nsAutoCString spec;
+  if (NS_FAILED(aURI->GetSpecIgnoringRef(spec))) {
+    spec.Truncate();
+  }
+  aKey.Assign(aMethod);
+  aKey.Append(' ');
+  aKey.Append(spec);
+}
+
+nsresult HttpTrafficArchive::Create(const char* aPath) {
+  MOZ_ASSERT(IsRecording() && !mFile);
+
+  mFile = PR_Open(aPath, PR_WRONLY | PR_CREATE_FILE | PR_TRUNCATE, 0644);
+  if (!mFile) {
+    return NS_ERROR_FILE_ACCESS_DENIED;
+  }
+
+  int32_t length = sizeof(kArchiveMagic) - 1;
+  if (PR_Write(mFile, kArchiveMagic, length) != length) {
+    return NS_ERROR_FILE_ACCESS_DENIED;
+  }
+  return NS_OK;
+}
+
+nsresult HttpTrafficArchive::Open(const char* aPath) {
+  MOZ_ASSERT(IsReplaying());
+
+  PRFileDesc* fd = PR_Open(aPath, PR_RDONLY, 0);
+  if (!fd) {
+    return NS_ERROR_FILE_NOT_FOUND;
+  }
+  auto closeFile = MakeScopeExit([&] { PR_Close(fd); });
+
+  PRFileInfo64 info;
+  if (PR_GetOpenFileInfo64(fd, &info) != PR_SUCCESS || info.size < 0 ||
+      info.size > UINT32_MAX) {
+    return NS_ERROR_FILE_CORRUPTED;
+  }
+
+  nsCString data;
+  if (!data.SetLength(uint32_t(info.size), fallible)) {
+    return NS_ERROR_OUT_OF_MEMORY;
+  }
+  uint32_t offset = 0;
+  while (offset < data.Length()) {
+    int32_t read =
+        PR_Read(fd, data.BeginWriting() + offset, data.Length() - offset);
+    if (read <= 0) {
+      return NS_ERROR_FILE_CORRUPTED;
+    }
+    offset += read;
+  }
+
+  return Load(data);
+}
+
+namespace {
+
+// Reads the strings and integers of an archive.
+class ArchiveReader {
+ public:
+  explicit ArchiveReader(const nsACString& aData)
+      : mCursor(aData.BeginReading()), mEnd(aData.EndReading()) {}
+
+  bool AtEnd() const { return mCursor == mEnd; }
+
+  bool Skip(size_t aLength) {
+    if (size_t(mEnd - mCursor) < aLength) {
+      return false;
+    }
+    mCursor += aLength;
+    return true;
+  }
+
+  bool ReadUint32(uint32_t* aValue) {
+    if (size_t(mEnd - mCursor) < sizeof(uint32_t)) {
+      return false;
+    }
+    *aValue = LittleEndian::readUint32(mCursor);
+    mCursor += sizeof(uint32_t);
+    return true;
+  }
+
+  bool ReadString(nsACString& aValue) {
+    uint32_t length;
+    if (!ReadUint32(&length) || size_t(mEnd - mCursor) < length) {
+      return false;
+    }
+    aValue.Assign(mCursor, length);
+    mCursor += length;
+    return true;
+  }
+
+ private:
+  const char* mCursor;
+  const char* mEnd;
+};
+
+}  // namespace
+
+static void AppendUint32(nsACString& aOut, uint32_t aValue) {
+  char bytes[sizeof(uint32_t)];
+  LittleEndian::writeUint32(bytes, aValue);
+  aOut.Append(bytes, sizeof(bytes));
+}
+
+static void AppendString(nsACString& aOut, const nsACString& aValue) {
+  AppendUint32(aOut, aValue.Length());
+  aOut.Append(aValue);
+}
+
+nsresult HttpTrafficArchive::Load(const nsACString& aData) {
+  MOZ_ASSERT(IsReplaying());
+
+  nsDependentCString magic(kArchiveMagic, sizeof(kArchiveMagic) - 1);
+  if (!StringBeginsWith(aData, magic)) {
+    return NS_ERROR_FILE_CORRUPTED;
+  }
+
+  ArchiveReader reader(aData);
+  MOZ_ALWAYS_TRUE(reader.Skip(magic.Length()));
+  while (!reader.AtEnd()) {
+    // An archive cut short, e.g. because the recording browser crashed,
+    // still serves the entries before the cut.
+    auto entry = MakeUnique<Entry>();
+    if (!reader.ReadString(entry->mKey) || !reader.ReadString(entry->mHead) ||
+        !reader.ReadUint32(&entry->mTimeToFirstByte) ||
+        !reader.ReadUint32(&entry->mDuration) ||
+        !reader.ReadString(entry->mBody)) {
+      return NS_ERROR_FILE_CORRUPTED;
+    }
+
+    UniquePtr<Responses>& responses = mResponses.LookupOrInsertWith(
+        entry->mKey, [] { return MakeUnique<Responses>(); });
+    responses->mEntries.AppendElement(std::move(entry));
+  }
+
+  LOG(("HttpTrafficArchive::Load [this=%p] %u keys", this,
+       mResponses.Count()));
+  return NS_OK;
+}
+
+// static
+void HttpTrafficArchive::Serialize(const Entry& aEntry, nsACString& aOut) {
+  AppendString(aOut, aEntry.mKey);
+  AppendString(aOut, aEntry.mHead);
+  AppendUint32(aOut, aEntry.mTimeToFirstByte);
+  AppendUint32(aOut, aEntry.mDuration);
+  AppendString(aOut, aEntry.mBody);
+}
+
+nsresult HttpTrafficArchive::Append(Recording& aRecording) {
+  MOZ_ASSERT(NS_IsMainThread());
+  MOZ_ASSERT(IsRecording());
+
+  if (!mFile || !aRecording.HasResponseHead()) {
+    return NS_ERROR_NOT_AVAILABLE;
+  }
+
+  const Entry& entry = aRecording.Finish();
+  nsCString data;
+  Serialize(entry, data);
+
+  LOG(("HttpTrafficArchive::Append [this=%p] %s, %u bytes", this,
+       entry.mKey.get(), entry.mBody.Length()));
+
+  // Entries are written one at a time, so that a recording which is cut
+  // short can still be replayed.
+  if (PR_Write(mFile, data.get(), int32_t(data.Length())) !=
+      int32_t(data.Length())) {
+    NS_WARNING("Failed to write to the HTTP archive");
+    PR_Close(mFile);
+    mFile = nullptr;
+    return NS_ERROR_FAILURE;
+  }
+  return NS_OK;
+}
+
+const HttpTrafficArchive::Entry* HttpTrafficArchive::Lookup(
+    const nsACString& aKey) {
+  MOZ_ASSERT(IsReplaying());
+
+  Responses* responses = mResponses.Get(aKey);
+  if (!responses) {
+    return nullptr;
+  }
+
+  const Entry* entry = responses->mEntries[responses->mNext].get();
+  if (responses->mNext + 1 < responses->mEntries.Length()) {
+    responses->mNext++;
+  }
+  return entry;
+}
+
+HttpTrafficArchive::Pacing HttpTrafficArchive::PacingFor(
+    const Entry& aEntry) const {
+  Pacing pacing;
+  uint32_t bodyTime = 0;
+  if (mOptions.mRecordedTimings) {
+    pacing.mFirstByteDelay = aEntry.mTimeToFirstByte;
+    if (aEntry.mDuration > aEntry.mTimeToFirstByte) {
+      bodyTime = aEntry.mDuration - aEntry.mTimeToFirstByte;
+    }
+  } else {
+    pacing.mFirstByteDelay = mOptions.mLatency;
+  }
+
+  if (mOptions.mBandwidth) {
+    // 1 kbit/s is 1/8 byte per ms.
+    uint64_t bytes = uint64_t(mOptions.mBandwidth) * kReplayTick / 8;
+    pacing.mBytesPerTick =
+        uint32_t(std::clamp<uint64_t>(bytes, 1, UINT32_MAX));
+  } else if (bodyTime >= kReplayTick) {
+    // Spread the body over the time it took to record.
+    uint32_t ticks = bodyTime / kReplayTick;
+    pacing.mBytesPerTick = (aEntry.mBody.Length() + ticks - 1) / ticks;
+  }
+  return pacing;
+}
+
+namespace {
+
+// Writes a replayed body into a pipe at the pace of the archive, and closes
+// the pipe at the end of the body. Stops early when the reader closes the
+// pipe, e.g. because the channel was canceled.
+class BodyReplayer final : public nsITimerCallback, public nsINamed {
+ public:
+  NS_DECL_ISUPPORTS
+  NS_DECL_NSITIMERCALLBACK
+  NS_DECL_NSINAMED
+
+  BodyReplayer(nsIAsyncOutputStream* aOutput, const nsCString& aBody,
+               const HttpTrafficArchive::Pacing& aPacing)
+      : mOutput(aOutput), mBody(aBody), mPacing(aPacing) {}
+
+  nsresult Start() {
+    if (!mPacing.mFirstByteDelay) {
+      Write();
+      return NS_OK;
+    }
+    return NS_NewTimerWithCallback(getter_AddRefs(mTimer), this,
+                                   mPacing.mFirstByteDelay,
+                                   nsITimer::TYPE_ONE_SHOT);
+  }
+
+ private:
+  ~BodyReplayer() = default;
+
+  void Write();
+
+  nsCOMPtr<nsIAsyncOutputStream> mOutput;
+  nsCOMPtr<nsITimer> mTimer;
+  nsCString mBody;
+  uint32_t mOffset = 0;
+  HttpTrafficArchive::Pacing mPacing;
+};
+
+NS_IMPL_ISUPPORTS(BodyReplayer, nsITimerCallback, nsINamed)
+
+void BodyReplayer::Write() {
+  uint32_t count = mBody.Length() - mOffset;
+  if (mPacing.mBytesPerTick) {
+    count = std::min(count, mPacing.mBytesPerTick);
+  }
+
+  while (count) {
+    uint32_t written;
+    nsresult rv = mOutput->Write(mBody.get() + mOffset, count, &written);
+    if (rv == NS_BASE_STREAM_WOULD_BLOCK) {
+      break;
+    }
+    if (NS_FAILED(rv)) {
+      mOutput->CloseWithStatus(rv);
+      mTimer = nullptr;
+      return;
+    }
+    mOffset += written;
+    count -= written;
+  }
+
+  if (mOffset == mBody.Length()) {
+    mOutput->Close();
+    mTimer = nullptr;
+    return;
+  }
+
+  nsresult rv = NS_NewTimerWithCallback(getter_AddRefs(mTimer), this,
+                                        HttpTrafficArchive::kReplayTick,
+                                        nsITimer::TYPE_ONE_SHOT);
+  if (NS_FAILED(rv)) {
+    mOutput->CloseWithStatus(rv);
+    mTimer = nullptr;
+  }
+}
+
+NS_IMETHODIMP
+BodyReplayer::Notify(nsITimer* aTimer) {
+  Write();
+  return NS_OK;
+}
+
+NS_IMETHODIMP
+BodyReplayer::GetName(nsACString& aName) {
+  aName.AssignLiteral("HttpTrafficArchive::BodyReplayer");
+  return NS_OK;
+}
+
+}  // namespace
+
+nsresult HttpTrafficArchive::OpenBodyStream(const Entry& aEntry,
+                                            nsIInputStream** aResult) {
+  MOZ_ASSERT(NS_IsMainThread());
+
+  nsCOMPtr<nsIAsyncInputStream> input;
+  nsCOMPtr<nsIAsyncOutputStream> output;
+  NS_NewPipe2(getter_AddRefs(input), getter_AddRefs(output), true, true, 0,
+              UINT32_MAX);
+
+  RefPtr<BodyReplayer> replayer =
+      new BodyReplayer(output, aEntry.mBody, PacingFor(aEntry));
+  nsresult rv = replayer->Start();
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+
+  input.forget(aResult);
+  return NS_OK;
+}
+
+}  // namespace net
+}  // namespace mozilla
@@ -0,0 +1,151 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim:set ts=4 sw=2 sts=2 et cin: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef mozilla_net_HttpTrafficArchive_h
+#define mozilla_net_HttpTrafficArchive_h
+
+#include <stdint.h>
+
+#include "mozilla/TimeStamp.h"
+#include "mozilla/UniquePtr.h"
+#include "nsHashKeys.h"
+#include "nsString.h"
+#include "nsTArray.h"
+#include "nsTHashMap.h"
+#include "prio.h"
+
+class nsIInputStream;
+class nsIURI;
+
+namespace mozilla {
+namespace net {
+
+class nsHttpResponseHead;
+
+// HttpTrafficArchive records the responses nsHttpChannel reads from the
+// network into a file, and serves them back from that file instead of the
+// network, so that page loads can be benchmarked repeatably on machines
+// without network access. The mode is picked from the environment when the
+// first channel connects:
+//
+//   MOZ_HTTP_ARCHIVE_RECORD=<file>     record the responses into <file>
+//   MOZ_HTTP_ARCHIVE_REPLAY=<file>     serve the responses from <file>
+//   MOZ_HTTP_ARCHIVE_LATENCY=<ms>      delay replayed responses by <ms>, or
+//                                      by the recorded timings if "recorded"
+//   MOZ_HTTP_ARCHIVE_BANDWIDTH=<kbps>  replay bodies at <kbps> kbit/s
+//
+// Responses are keyed by the request method and the URI without its ref.
+// Several responses with the same key, e.g. a 401 followed by a 200, are
+// served in the recorded order, and the last one is served again afterwards.
+// Bodies are archived as they came off the wire, before content decoding.
+//
+// The HTTP cache is bypassed in both modes, so that every load reaches the
+// network or the archive. Everything runs on the main thread, except for
+// Recording::ReadBody which may run on the thread data is retargeted to.
+class HttpTrafficArchive final {
+ public:
+  enum class Mode : uint8_t { Record, Replay };
+
+  struct Options {
+    // Delay before the first byte of a replayed response, in ms.
+    uint32_t mLatency = 0;
+    // Use the recorded time to first byte and duration instead of mLatency.
+    bool mRecordedTimings = false;
+    // Rate of replayed bodies in kbit/s, or 0 to deliver them at once.
+    uint32_t mBandwidth = 0;
+  };
+
+  // A response as it is stored in the archive.
+  struct Entry {
+    nsCString mKey;
+    // The response head, as flattened by nsHttpResponseHead::Flatten.
+    nsCString mHead;
+    // Time to the response head and to the end of the body, in ms from the
+    // moment the channel connected.
+    uint32_t mTimeToFirstByte = 0;
+    uint32_t mDuration = 0;
+    nsCString mBody;
+  };
+
+  // Collects a response while nsHttpChannel reads it from the network.
+  class Recording {
+   public:
+    explicit Recording(const nsACString& aKey);
+
+    void SetResponseHead(nsHttpResponseHead* aHead);
+    bool HasResponseHead() const { return !mEntry.mHead.IsEmpty(); }
+
+    // Reads |aCount| bytes of the body from |aInput|, and returns a stream
+    // of the same bytes for the listener.
+    nsresult ReadBody(nsIInputStream* aInput, uint32_t aCount,
+                      nsIInputStream** aResult);
+
+    Entry& Finish();
+
+   private:
+    TimeStamp mStart;
+    Entry mEntry;
+  };
+
+  // Pace of a replayed response.
+  struct Pacing {
+    uint32_t mFirstByteDelay = 0;
+    // Bytes of the body written per kReplayTick ms, or 0 for all at once.
+    uint32_t mBytesPerTick = 0;
+  };
+
+  static constexpr uint32_t kReplayTick = 10;
+
+  // Returns the archive configured in the environment, or null.
+  static HttpTrafficArchive* Get();
+  // Replaces the archive configured in the environment, e.g. with one a test
+  // loaded. Null turns recording and replaying off.
+  static void SetForTesting(UniquePtr<HttpTrafficArchive> aArchive);
+
+  HttpTrafficArchive(Mode aMode, const Options& aOptions);
+  ~HttpTrafficArchive();
+
+  bool IsRecording() const { return mMode == Mode::Record; }
+  bool IsReplaying() const { return mMode == Mode::Replay; }
+
+  static void KeyFor(const nsACString& aMethod, nsIURI* aURI,
+                     nsACString& aKey);
+
+  // Creates the archive file at |aPath|, replacing any previous one.
+  nsresult Create(const char* aPath);
+  // Loads the responses archived in |aPath|, or in |aData|.
+  nsresult Open(const char* aPath);
+  nsresult Load(const nsACString& aData);
+
+  // Writes the response collected by |aRecording| to the archive.
+  nsresult Append(Recording& aRecording);
+  static void Serialize(const Entry& aEntry, nsACString& aOut);
+
+  // Returns the next response archived for |aKey|, or null.
+  const Entry* Lookup(const nsACString& aKey);
+
+  Pacing PacingFor(const Entry& aEntry) const;
+
+  // Returns a stream which yields the body of |aEntry| at the pace of the
+  // archive. The stream is closed at the end of the body.
+  nsresult OpenBodyStream(const Entry& aEntry, nsIInputStream** aResult);
+
+ private:
+  struct Responses {
+    nsTArray<UniquePtr<Entry>> mEntries;
+    size_t mNext = 0;
+  };
+
+  Mode mMode;
+  Options mOptions;
+  PRFileDesc* mFile = nullptr;
+  nsTHashMap<nsCStringHashKey, UniquePtr<Responses>> mResponses;
+};
+
+}  // namespace net
+}  // namespace mozilla
+
+#endif  // mozilla_net_HttpTrafficArchive_h
@@ -130,6 +130,7 @@
 #include "mozilla/net/OpaqueResponseUtils.h"
 #include "mozilla/net/UrlClassifierFeatureFactory.h"
 #include "HttpTrafficAnalyzer.h"
+#include "HttpTrafficArchive.h"
 #include "mozilla/net/SocketProcessParent.h"
 #include "js/Conversions.h"
 #include "mozilla/dom/SecFetch.h"
@@ -886,6 +887,17 @@ nsresult nsHttpChannel::ContinueConnect() {
 nsresult nsHttpChannel::DoConnect(HttpTransactionShell* aTransWithStickyConn) {
   LOG(("nsHttpChannel::DoConnect [this=%p]\n", this));
 
+  if (HttpTrafficArchive* archive = HttpTrafficArchive::Get()) {
+    if (archive->IsReplaying()) {
+      return ReplayResponse(archive);
+    }
+
+    nsAutoCString method, key;
+    mRequestHead.Method(method);
+    HttpTrafficArchive::KeyFor(method, mURI, key);
+    mArchiveRecording = MakeUnique<HttpTrafficArchive::Recording>(key);
+  }
+
   if (!mDNSBlockingPromise.IsEmpty()) {
     LOG(("  waiting for DNS prefetch"));
 
@@ -945,6 +957,51 @@ nsresult nsHttpChannel::DoConnectActual(
     return rv;
   }
 
+  SuspendTransactionPump();
+  return NS_OK;
+}
+
+nsresult nsHttpChannel::ReplayResponse(HttpTrafficArchive* aArchive) {
+  nsAutoCString method, key;
+  mRequestHead.Method(method);
+  HttpTrafficArchive::KeyFor(method, mURI, key);
+  LOG(("nsHttpChannel::ReplayResponse [this=%p key=%s]\n", this, key.get()));
+
+  const HttpTrafficArchive::Entry* entry = aArchive->Lookup(key);
+  if (!entry) {
+    LOG(("  not in the archive"));
+    return NS_ERROR_OFFLINE;
+  }
+
+  auto head = MakeUnique<nsHttpResponseHead>();
+  nsresult rv = head->ParseCachedHead(entry->mHead.get());
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+
+  nsCOMPtr<nsIInputStream> body;
+  rv = aArchive->OpenBodyStream(*entry, getter_AddRefs(body));
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+
+  RefPtr<nsInputStreamPump> pump;
+  rv = nsInputStreamPump::Create(getter_AddRefs(pump), body, 0, 0, true);
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+  rv = pump->AsyncRead(this);
+  if (NS_FAILED(rv)) {
+    return rv;
+  }
+
+  mReplayedResponseHead = std::move(head);
+  mTransactionPump = pump;
+  SuspendTransactionPump();
+  return NS_OK;
+}
+
+void nsHttpChannel::SuspendTransactionPump() {
   uint32_t suspendCount = mSuspendCount;
   if (LoadAsyncResumePending()) {
     LOG(
@@ -956,8 +1013,6 @@ nsresult nsHttpChannel::DoConnectActual(
   while (suspendCount--) {
     mTransactionPump->Suspend();
   }
-
-  return NS_OK;
 }
 
 void nsHttpChannel::SpeculativeConnect() {
@@ -972,6 +1027,12 @@ void nsHttpChannel::SpeculativeConnect() {
     return;
   }
 
+  // Replayed responses don't touch the network.
+  HttpTrafficArchive* archive = HttpTrafficArchive::Get();
+  if (archive && archive->IsReplaying()) {
+    return;
+  }
+
   // LOAD_ONLY_FROM_CACHE and LOAD_NO_NETWORK_IO must not hit network.
   // LOAD_FROM_CACHE is unlikely to hit network, so skip preconnects for it.
   if (mLoadFlags &
@@ -2270,7 +2331,8 @@ nsresult nsHttpChannel::ContinueProcessResponse3(nsresult rv) {
   rv = NS_OK;
 
   uint32_t httpStatus = mResponseHead->Status();
-  bool transactionRestarted = mTransaction->TakeRestartedState();
+  bool transactionRestarted =
+      mTransaction && mTransaction->TakeRestartedState();
 
   // handle different server response categories.  Note that we handle
   // caching or not caching of error pages in
@@ -3461,6 +3523,11 @@ nsresult nsHttpChannel::OpenCacheEntry(bool isHttps) {
     return NS_OK;
   }
 
+  // Every response is recorded into or replayed from the HTTP archive.
+  if (HttpTrafficArchive::Get()) {
+    return NS_OK;
+  }
+
   return OpenCacheEntryInternal(isHttps);
 }
 
@@ -5418,8 +5485,15 @@ NS_IMETHODIMP nsHttpChannel::CloseStickyConnection() {
     return NS_ERROR_UNEXPECTED;
   }
 
-  MOZ_ASSERT(mTransaction);
   if (!mTransaction) {
+    // A response replayed from the HTTP archive, e.g. a 401 the auth provider
+    // retries, came through no connection, so there is none to close.
+    HttpTrafficArchive* archive = HttpTrafficArchive::Get();
+    if (archive && archive->IsReplaying()) {
+      LOG(("  replayed from the archive"));
+      return NS_OK;
+    }
+    MOZ_ASSERT_UNREACHABLE("CloseStickyConnection without a transaction");
     return NS_ERROR_UNEXPECTED;
   }
 
@@ -7100,11 +7174,22 @@ nsHttpChannel::OnStartRequest(nsIRequest* request) {
     mSupportsHTTP3 = mTransaction->GetSupportsHTTP3();
     // the response head may be null if the transaction was cancelled.  in
     // which case we just need to call OnStartRequest/OnStopRequest.
-    if (mResponseHead) return ProcessResponse();
+    if (mResponseHead) {
+      if (mArchiveRecording) {
+        mArchiveRecording->SetResponseHead(mResponseHead.get());
+      }
+      return ProcessResponse();
+    }
 
     NS_WARNING("No response head in OnStartRequest");
   }
 
+  // the head of a response replayed from the HTTP archive.
+  if (NS_SUCCEEDED(mStatus) && !mCachePump && mReplayedResponseHead) {
+    mResponseHead = std::move(mReplayedResponseHead);
+    return ProcessResponse();
+  }
+
   // cache file could be deleted on our behalf, it could contain errors or
   // it failed to allocate memory, reload from network here.
   if (mCacheEntry && mCachePump && RECOVER_FROM_CACHE_FILE_ERROR(mStatus)) {
@@ -7413,6 +7498,14 @@ nsHttpChannel::OnStopRequest(nsIRequest* request, nsresult status) {
 
   bool isFromNet = request == mTransactionPump;
 
+  // Archive the response when it was read to the end, or up to a redirect.
+  if (mArchiveRecording && isFromNet) {
+    if (NS_SUCCEEDED(status) || status == NS_BINDING_REDIRECTED) {
+      Unused << HttpTrafficArchive::Get()->Append(*mArchiveRecording);
+    }
+    mArchiveRecording = nullptr;
+  }
+
   if (mTransaction) {
     // determine if we should call DoAuthRetry
     bool authRetry = mAuthRetryPending && NS_SUCCEEDED(status);
@@ -7543,6 +7636,29 @@ nsHttpChannel::OnStopRequest(nsIRequest* request, nsresult status) {
                                                transactionWithStickyConn);
   }
 
+  HttpTrafficArchive* archive = HttpTrafficArchive::Get();
+  if (isFromNet && archive && archive->IsReplaying()) {
+    // A response replayed from the HTTP archive, which has no transaction.
+    bool authRetry = mAuthRetryPending && NS_SUCCEEDED(status);
+    mReplayedResponseHead = nullptr;
+    mTransactionPump = nullptr;
+
+    if (authRetry) {
+      mAuthRetryPending = false;
+      auto continueOSR = [authRetry, isFromNet, contentComplete](
+                             auto* self, nsresult aStatus) {
+        return self->ContinueOnStopRequestAfterAuthRetry(
+            aStatus, authRetry, isFromNet, contentComplete, nullptr);
+      };
+      status = DoAuthRetry(nullptr, continueOSR);
+      if (NS_SUCCEEDED(status)) {
+        return NS_OK;
+      }
+    }
+    return ContinueOnStopRequestAfterAuthRetry(status, authRetry, isFromNet,
+                                               contentComplete, nullptr);
+  }
+
   return ContinueOnStopRequest(status, isFromNet, contentComplete);
 }
 
@@ -7999,6 +8115,14 @@ nsHttpChannel::OnDataAvailable(nsIRequest* request, nsIInputStream* input,
     // already streamed some data from another source (see, for example,
     // OnDoneReadingPartialCacheEntry).
     //
+    nsCOMPtr<nsIInputStream> recordedInput;
+    if (mArchiveRecording && request == mTransactionPump) {
+      rv = mArchiveRecording->ReadBody(input, count,
+                                       getter_AddRefs(recordedInput));
+      NS_ENSURE_SUCCESS(rv, rv);
+      input = recordedInput;
+    }
+
     int64_t offsetBefore = 0;
     nsCOMPtr<nsISeekableStream> seekable = do_QueryInterface(input);
     if (seekable && NS_FAILED(seekable->Tell(&offsetBefore))) {
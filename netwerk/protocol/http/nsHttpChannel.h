@@ -10,6 +10,7 @@
 #include "AlternateServices.h"
 #include "AutoClose.h"
 #include "HttpBaseChannel.h"
+#include "HttpTrafficArchive.h"
 #include "TimingStruct.h"
 #include "mozilla/AtomicBitfields.h"
 #include "mozilla/Atomics.h"
@@ -429,6 +430,9 @@ class nsHttpChannel final : public HttpBaseChannel,
   DoConnect(HttpTransactionShell* aTransWithStickyConn = nullptr);
   [[nodiscard]] nsresult DoConnectActual(
       HttpTransactionShell* aTransWithStickyConn);
+  // Serves the response from the archive instead of the network.
+  [[nodiscard]] nsresult ReplayResponse(HttpTrafficArchive* aArchive);
+  void SuspendTransactionPump();
   [[nodiscard]] nsresult ContinueOnStopRequestAfterAuthRetry(
       nsresult aStatus, bool aAuthRetry, bool aIsFromNet, bool aContentComplete,
       HttpTransactionShell* aTransWithStickyConn);
@@ -570,6 +574,12 @@ class nsHttpChannel final : public HttpBaseChannel,
   nsCOMPtr<nsIRequest> mTransactionPump;
   RefPtr<HttpTransactionShell> mTransaction;
 
+  // The response being recorded into the HTTP archive, and the head of the
+  // response replayed from it until OnStartRequest. A replayed response is
+  // read from mTransactionPump without a transaction.
+  UniquePtr<HttpTrafficArchive::Recording> mArchiveRecording;
+  UniquePtr<nsHttpResponseHead> mReplayedResponseHead;
+
   uint64_t mLogicalOffset{0};
 
   // cache specific data
@@ -20,6 +20,7 @@
 #include "nsIURI.h"
 #include "nsHttpHeaderArray.h"
 #include "mozilla/AutoRestore.h"
+#include "mozilla/SIMD.h"
 #include "mozilla/Tokenizer.h"
 #include "nsComponentManagerUtils.h"
 
@@ -495,6 +496,7 @@ nsMultiMixedConv::OnStartRequest(nsIRequest* request) {
   if (mBoundary.IsEmpty()) {
     return NS_ERROR_CORRUPTED_CONTENT;
   }
+  mScanBodies = mBoundary.FindCharInSet("\r\n") == kNotFound;
 
   mHeaderTokens[HEADER_CONTENT_TYPE] = mTokenizer.AddCustomToken(
       "content-type", mTokenizer.CASE_INSENSITIVE, false);
@@ -545,15 +547,205 @@ nsMultiMixedConv::OnDataAvailable(nsIRequest* request, nsIInputStream* inStr,
   mozilla::AutoRestore<bool> restore(mInOnDataAvailable);
   mInOnDataAvailable = true;
 
-  nsresult rv_feed = mTokenizer.FeedInput(inStr, count);
+  SegmentClosure closure{this, NS_OK};
+  while (count) {
+    uint32_t read;
+    nsresult rv = inStr->ReadSegments(ConsumeSegment, &closure, count, &read);
+    if (rv == NS_ERROR_NOT_IMPLEMENTED) {
+      // The stream has no buffer we can scan in place, read the data out.
+      nsAutoCString buffer;
+      rv = NS_ReadInputStreamToString(inStr, buffer, count);
+      if (NS_FAILED(rv)) {
+        return rv;
+      }
+      return ProcessInput(buffer.BeginReading(), buffer.Length());
+    }
+    if (NS_FAILED(closure.mStatus)) {
+      return closure.mStatus;
+    }
+    if (NS_FAILED(rv)) {
+      return rv;
+    }
+    if (!read) {
+      break;
+    }
+    count -= read;
+  }
+
+  return NS_OK;
+}
+
+nsresult nsMultiMixedConv::ConsumeSegment(nsIInputStream* aInStr,
+                                          void* aClosure,
+                                          const char* aFromSegment,
+                                          uint32_t aToOffset, uint32_t aCount,
+                                          uint32_t* aWriteCount) {
+  auto* closure = static_cast<SegmentClosure*>(aClosure);
+  closure->mStatus = closure->mConv->ProcessInput(aFromSegment, aCount);
+  if (NS_FAILED(closure->mStatus)) {
+    // Stops ReadSegments, the failure is reported from OnDataAvailable.
+    return closure->mStatus;
+  }
+  *aWriteCount = aCount;
+  return NS_OK;
+}
+
+nsresult nsMultiMixedConv::ProcessInput(const char* aData, uint32_t aLength) {
+  while (aLength) {
+    nsresult rv;
+    uint32_t consumed = 0;
+    if (!mScanBodies || !mTokenizerDrained ||
+        (mParserState != BODY_INIT && mParserState != BODY)) {
+      rv = ParseControlData(aData, aLength, &consumed);
+    } else if (mParserState == BODY_INIT) {
+      rv = SendStart();
+      mParserState = BODY;
+      mOddLineBreaks = false;
+    } else if (mBodyTail.IsEmpty()) {
+      rv = ParseBody(aData, aLength, &consumed);
+      if (NS_SUCCEEDED(rv) && mParserState == BODY) {
+        mBodyTail.Assign(aData + consumed, aLength - consumed);
+        consumed = aLength;
+      }
+    } else {
+      // Complete the tail held from the previous input with enough of the new
+      // data to find a delimiter starting in it.  Only this short join is
+      // copied, the rest is scanned in place.
+      uint32_t held = mBodyTail.Length();
+      uint32_t head = std::min(aLength, mDelimiter.Length() + 2);
+      nsAutoCString tail(mBodyTail);
+      tail.Append(aData, head);
+      mBodyTail.Truncate();
+
+      rv = ParseBody(tail.BeginReading(), tail.Length(), &consumed);
+      if (consumed >= held) {
+        consumed -= held;
+      } else {
+        // All of the new data is still held.
+        MOZ_ASSERT(NS_FAILED(rv) || (mParserState == BODY && head == aLength));
+        mBodyTail = Substring(tail, consumed);
+        consumed = aLength;
+      }
+    }
+    if (NS_FAILED(rv)) {
+      return rv;
+    }
+
+    aData += consumed;
+    aLength -= consumed;
+  }
+
+  return NS_OK;
+}
+
+nsresult nsMultiMixedConv::ParseControlData(const char* aData,
+                                            uint32_t aLength,
+                                            uint32_t* aConsumed) {
+  // Feeding line by line makes the tokenizer stop right where a part body
+  // starts, so that we can scan the body ourselves.
+  const char* lineEnd = static_cast<const char*>(memchr(aData, '\n', aLength));
+  *aConsumed = lineEnd ? lineEnd - aData + 1 : aLength;
+
+  nsresult rv_feed = mTokenizer.FeedInput(Substring(aData, *aConsumed));
   // We must do this every time.  Regardless if something has failed during the
   // parsing process.  Otherwise the raw data reference would not be thrown
   // away.
   nsresult rv_send = SendData();
 
+  // The tokenizer consumes all input up to a LF, except in a body, where it
+  // waits for what follows a line break.
+  mTokenizerDrained = lineEnd && mParserState != BODY;
+
   return NS_FAILED(rv_send) ? rv_send : rv_feed;
 }
 
+// Returns the first occurrence of aDelimiter in aData, or nullptr.
+static const char* FindDelimiter(const char* aData, uint32_t aLength,
+                                 const nsACString& aDelimiter) {
+  const char* delimiter = aDelimiter.BeginReading();
+  uint32_t delimiterLength = aDelimiter.Length();
+  MOZ_ASSERT(delimiterLength);
+
+  if (delimiterLength == 1) {
+    return SIMD::memchr8(aData, delimiter[0], aLength);
+  }
+
+  while (aLength >= delimiterLength) {
+    // Look for the first two characters at once, the search length makes sure
+    // the whole delimiter fits after a candidate.
+    const char* candidate = SIMD::memchr2x8(aData, delimiter[0], delimiter[1],
+                                            aLength - delimiterLength + 2);
+    if (!candidate) {
+      return nullptr;
+    }
+    if (!memcmp(candidate + 2, delimiter + 2, delimiterLength - 2)) {
+      return candidate;
+    }
+    aLength -= candidate + 1 - aData;
+    aData = candidate + 1;
+  }
+
+  return nullptr;
+}
+
+// Counts the line breaks, CRLF or LF, at the end of aData.  aWhole is set when
+// there is nothing but line breaks in aData.
+static uint32_t CountTrailingLineBreaks(const char* aData, uint32_t aLength,
+                                        bool* aWhole) {
+  uint32_t count = 0;
+  while (aLength && aData[aLength - 1] == '\n') {
+    --aLength;
+    if (aLength && aData[aLength - 1] == '\r') {
+      --aLength;
+    }
+    ++count;
+  }
+  *aWhole = !aLength;
+  return count;
+}
+
+nsresult nsMultiMixedConv::ParseBody(const char* aData, uint32_t aLength,
+                                     uint32_t* aConsumed) {
+  MOZ_ASSERT(mParserState == BODY);
+
+  const char* delimiter = FindDelimiter(aData, aLength, mDelimiter);
+  uint32_t length;
+  if (delimiter) {
+    length = delimiter - aData;
+    *aConsumed = length + mDelimiter.Length();
+  } else {
+    // Hold back what may be the start of the delimiter, together with the line
+    // break that may precede it.  Never split a CRLF, the count of line breaks
+    // below relies on it.
+    length = aLength > mDelimiter.Length() + 1
+                 ? aLength - mDelimiter.Length() - 1
+                 : 0;
+    if (length && aData[length - 1] == '\r') {
+      --length;
+    }
+    *aConsumed = length;
+  }
+
+  bool whole;
+  uint32_t lineBreaks = CountTrailingLineBreaks(aData, length, &whole);
+  bool odd = (lineBreaks + (whole && mOddLineBreaks)) % 2;
+
+  if (!delimiter) {
+    mOddLineBreaks = odd;
+    return length ? SendBodyData(aData, length) : NS_OK;
+  }
+
+  if (odd && lineBreaks) {
+    // The line break preceding the delimiter is part of it.
+    length -= length > 1 && aData[length - 2] == '\r' ? 2 : 1;
+  }
+
+  nsresult rv = length ? SendBodyData(aData, length) : NS_OK;
+  SwitchToControlParsing();
+  mParserState = TRAIL_DASH1;
+  return rv;
+}
+
 NS_IMETHODIMP
 nsMultiMixedConv::OnStopRequest(nsIRequest* request, nsresult aStatus) {
   nsresult rv;
@@ -564,6 +756,12 @@ nsMultiMixedConv::OnStopRequest(nsIRequest* request, nsresult aStatus) {
     MOZ_DIAGNOSTIC_ASSERT(
         !mRawData, "There are unsent data from the previous tokenizer feed!");
 
+    if (!mBodyTail.IsEmpty()) {
+      // No delimiter has come, the held tail ends the last part.
+      mRawData = mBodyTail.BeginReading();
+      mRawDataLength = mBodyTail.Length();
+    }
+
     rv = mTokenizer.FinishInput();
     if (NS_SUCCEEDED(aStatus)) {
       aStatus = rv;
@@ -572,6 +770,7 @@ nsMultiMixedConv::OnStopRequest(nsIRequest* request, nsresult aStatus) {
     if (NS_SUCCEEDED(aStatus)) {
       aStatus = rv;
     }
+    mBodyTail.Truncate();
 
     (void)SendStop(aStatus);
   } else if (NS_FAILED(aStatus) && !mRequestListenerNotified) {
@@ -601,12 +800,14 @@ nsresult nsMultiMixedConv::ConsumeToken(Token const& token) {
         // The server first used boundary '--boundary'.  Hence, we no longer
         // accept plain 'boundary' token as a delimiter.
         mTokenizer.RemoveCustomToken(mBoundaryToken);
+        mDelimiter = "--"_ns + mBoundary;
         mParserState = BOUNDARY_CRLF;
         break;
       }
       if (token.Equals(mBoundaryToken)) {
         // And here the opposite from the just above block...
         mTokenizer.RemoveCustomToken(mBoundaryTokenWithDashes);
+        mDelimiter = mBoundary;
         mParserState = BOUNDARY_CRLF;
         break;
       }
@@ -891,6 +1092,13 @@ nsresult nsMultiMixedConv::SendStop(nsresult aStatus) {
   return rv;
 }
 
+nsresult nsMultiMixedConv::SendBodyData(const char* aData, uint32_t aLength) {
+  MOZ_ASSERT(!mRawData);
+  mRawData = aData;
+  mRawDataLength = aLength;
+  return SendData();
+}
+
 void nsMultiMixedConv::AccumulateData(Token const& aToken) {
   if (!mRawData) {
     // This is the first read of raw data during this FeedInput loop
@@ -125,6 +125,10 @@ class nsPartChannel final : public nsIChannel,
 // boundary tokens are NOT considered part of the data. BoundaryToken
 // is any opaque string.
 //
+// Headers and the control data around the boundaries are parsed line by line
+// with the incremental tokenizer.  Part bodies are scanned directly in the
+// segments of the incoming stream for the boundary and passed on to the part
+// listener as slices of those segments, without copying them.
 //
 
 class nsMultiMixedConv : public nsIStreamConverter {
@@ -144,6 +148,7 @@ class nsMultiMixedConv : public nsIStreamConverter {
   nsresult SendStart();
   void AccumulateData(Token const& aToken);
   nsresult SendData();
+  nsresult SendBodyData(const char* aData, uint32_t aLength);
   nsresult SendStop(nsresult aStatus);
 
   // member data
@@ -220,7 +225,8 @@ class nsMultiMixedConv : public nsIStreamConverter {
   // mRawData points to the first byte in the tokenizer buffer where part
   // body data begins or continues.  mRawDataLength is a cumulated length
   // of that data during a single tokenizer input feed.  This is always
-  // flushed right after we fed the tokenizer.
+  // flushed right after we fed the tokenizer.  When scanning part bodies
+  // directly, these point to a slice of the input segment.
   nsACString::const_char_iterator mRawData{nullptr};
   nsACString::size_type mRawDataLength{0};
 
@@ -236,6 +242,24 @@ class nsMultiMixedConv : public nsIStreamConverter {
   // Custom tokens for each of the response headers we recognize.
   Token mHeaderTokens[HEADER_UNKNOWN];
 
+  // The delimiter between the parts, mBoundary with or without the leading
+  // dashes, depending on what the server used first.
+  nsCString mDelimiter;
+  // False when the boundary contains a line break, the tokenizer then parses
+  // part bodies too.
+  bool mScanBodies{true};
+  // True when the tokenizer has consumed all the input we have fed it, and so
+  // part bodies can be scanned without it.
+  bool mTokenizerDrained{true};
+  // The end of the part body input which may be the start of the delimiter,
+  // or the line break preceding it, held until more data comes.
+  nsCString mBodyTail;
+  // Whether the part body data sent so far ends with an odd number of line
+  // breaks.  The tokenizer pairs a line break with the token following it, so
+  // a line break preceding the delimiter is part of the delimiter only when
+  // it's not paired with a previous one.
+  bool mOddLineBreaks{false};
+
   // Resets values driven by part headers, like content type, to their defaults,
   // called at the start of every part processing.
   void HeadersToDefault();
@@ -250,6 +274,26 @@ class nsMultiMixedConv : public nsIStreamConverter {
   // Turns on or off recognition of the headers we recognize in part heads.
   void SetHeaderTokensEnabled(bool aEnable);
 
+  struct SegmentClosure {
+    nsMultiMixedConv* mConv;
+    nsresult mStatus;
+  };
+  // The nsWriteSegmentFun passed to ReadSegments of the input stream in
+  // OnDataAvailable, aClosure is a SegmentClosure.
+  static nsresult ConsumeSegment(nsIInputStream* aInStr, void* aClosure,
+                                 const char* aFromSegment, uint32_t aToOffset,
+                                 uint32_t aCount, uint32_t* aWriteCount);
+  // Parses a chunk of the input, either by scanning it for the delimiter when
+  // in a part body, or by feeding it to the tokenizer.
+  nsresult ProcessInput(const char* aData, uint32_t aLength);
+  // Feeds the tokenizer with aData up to and including the first LF.
+  nsresult ParseControlData(const char* aData, uint32_t aLength,
+                            uint32_t* aConsumed);
+  // Sends the part body data in aData up to the delimiter, when found, and
+  // switches to control parsing after it.  When not found, the tail which may
+  // be the start of the delimiter is left unconsumed.
+  nsresult ParseBody(const char* aData, uint32_t aLength, uint32_t* aConsumed);
+
   // The main parser callback called by the IncrementalTokenizer
   // instance from OnDataAvailable or OnStopRequest.
   nsresult ConsumeToken(Token const& token);
@@ -0,0 +1,282 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include <initializer_list>
+#include <utility>
+
+#include "mozilla/ScopeExit.h"
+#include "mozilla/SpinEventLoopUntil.h"
+#include "mozilla/Unused.h"
+#include "mozilla/net/HttpTrafficArchive.h"
+#include "nsCOMPtr.h"
+#include "nsContentUtils.h"
+#include "nsHttpResponseHead.h"
+#include "nsIHttpAuthenticableChannel.h"
+#include "nsIHttpChannel.h"
+#include "nsIInputStream.h"
+#include "nsIStreamListener.h"
+#include "nsNetUtil.h"
+#include "nsString.h"
+#include "nsStringStream.h"
+
+using namespace mozilla;
+using namespace mozilla::net;
+
+// Checks that responses recorded into an HTTP archive are replayed in the
+// recorded order, and at the pace of the replay options, including through an
+// HTTP channel.
+
+namespace {
+
+using Archive = HttpTrafficArchive;
+
+Archive::Entry MakeEntry(const char* aKey, const char* aHead,
+                         const char* aBody, uint32_t aTimeToFirstByte = 0,
+                         uint32_t aDuration = 0) {
+  Archive::Entry entry;
+  entry.mKey.Assign(aKey);
+  entry.mHead.Assign(aHead);
+  entry.mBody.Assign(aBody);
+  entry.mTimeToFirstByte = aTimeToFirstByte;
+  entry.mDuration = aDuration;
+  return entry;
+}
+
+nsCString ArchiveOf(std::initializer_list<Archive::Entry> aEntries) {
+  nsCString data("MOZHTTPARCHIVE1\n");
+  for (const Archive::Entry& entry : aEntries) {
+    Archive::Serialize(entry, data);
+  }
+  return data;
+}
+
+// Loads a channel and keeps what it got.
+class ArchiveListener final : public nsIStreamListener {
+ public:
+  NS_DECL_ISUPPORTS
+
+  NS_IMETHOD OnStartRequest(nsIRequest* aRequest) override {
+    nsCOMPtr<nsIHttpChannel> channel = do_QueryInterface(aRequest);
+    if (channel) {
+      Unused << channel->GetResponseStatus(&mResponseStatus);
+    }
+    // What the auth provider does for connection based schemes, such as NTLM,
+    // while the response is pending.
+    nsCOMPtr<nsIHttpAuthenticableChannel> authChannel =
+        do_QueryInterface(aRequest);
+    if (authChannel) {
+      mCloseStickyConnectionResult = authChannel->CloseStickyConnection();
+    }
+    return NS_OK;
+  }
+
+  NS_IMETHOD OnDataAvailable(nsIRequest* aRequest, nsIInputStream* aStream,
+                             uint64_t aOffset, uint32_t aCount) override {
+    nsAutoCString data;
+    nsresult rv = NS_ReadInputStreamToString(aStream, data, aCount);
+    mBody.Append(data);
+    return rv;
+  }
+
+  NS_IMETHOD OnStopRequest(nsIRequest* aRequest, nsresult aStatus) override {
+    mStatus = aStatus;
+    mDone = true;
+    return NS_OK;
+  }
+
+  uint32_t mResponseStatus = 0;
+  nsresult mCloseStickyConnectionResult = NS_ERROR_NOT_INITIALIZED;
+  nsCString mBody;
+  nsresult mStatus = NS_OK;
+  bool mDone = false;
+
+ private:
+  ~ArchiveListener() = default;
+};
+
+NS_IMPL_ISUPPORTS(ArchiveListener, nsIStreamListener, nsIRequestObserver)
+
+already_AddRefed<ArchiveListener> Load(const char* aURL) {
+  RefPtr<ArchiveListener> listener = new ArchiveListener();
+
+  nsCOMPtr<nsIURI> uri;
+  nsCOMPtr<nsIChannel> channel;
+  if (NS_FAILED(NS_NewURI(getter_AddRefs(uri), aURL)) ||
+      NS_FAILED(NS_NewChannel(
+          getter_AddRefs(channel), uri, nsContentUtils::GetSystemPrincipal(),
+          nsILoadInfo::SEC_ALLOW_CROSS_ORIGIN_SEC_CONTEXT_IS_NULL,
+          nsIContentPolicy::TYPE_OTHER)) ||
+      NS_FAILED(channel->AsyncOpen(listener))) {
+    return nullptr;
+  }
+
+  MOZ_ALWAYS_TRUE(SpinEventLoopUntil("TestHttpTrafficArchive::Load"_ns,
+                                     [&]() { return listener->mDone; }));
+  return listener.forget();
+}
+
+}  // namespace
+
+TEST(TestHttpTrafficArchive, Key)
+{
+  nsCOMPtr<nsIURI> uri;
+  ASSERT_EQ(NS_NewURI(getter_AddRefs(uri), "https://example.com/a?b=c#d"),
+            NS_OK);
+  nsAutoCString key;
+  Archive::KeyFor("GET"_ns, uri, key);
+  ASSERT_TRUE(key.EqualsLiteral("GET https://example.com/a?b=c"));
+}
+
+TEST(TestHttpTrafficArchive, Replay)
+{
+  Archive archive(Archive::Mode::Replay, Archive::Options());
+  ASSERT_EQ(
+      archive.Load(ArchiveOf({
+          MakeEntry("GET https://example.com/", "HTTP/1.1 401 No\r\n\r\n", ""),
+          MakeEntry("GET https://example.com/a", "HTTP/1.1 200 OK\r\n\r\n",
+                    "a"),
+          MakeEntry("GET https://example.com/", "HTTP/1.1 200 OK\r\n\r\n",
+                    "body"),
+      })),
+      NS_OK);
+
+  // The responses of a key are served in order, and the last one repeats.
+  const Archive::Entry* entry = archive.Lookup("GET https://example.com/"_ns);
+  ASSERT_TRUE(entry);
+  ASSERT_TRUE(entry->mHead.EqualsLiteral("HTTP/1.1 401 No\r\n\r\n"));
+  for (int i = 0; i < 2; i++) {
+    entry = archive.Lookup("GET https://example.com/"_ns);
+    ASSERT_TRUE(entry);
+    ASSERT_TRUE(entry->mBody.EqualsLiteral("body"));
+  }
+
+  entry = archive.Lookup("GET https://example.com/a"_ns);
+  ASSERT_TRUE(entry);
+  ASSERT_TRUE(entry->mBody.EqualsLiteral("a"));
+  ASSERT_FALSE(archive.Lookup("POST https://example.com/a"_ns));
+
+  // Bodies are delivered at once without pacing.
+  nsCOMPtr<nsIInputStream> stream;
+  ASSERT_EQ(archive.OpenBodyStream(*entry, getter_AddRefs(stream)), NS_OK);
+  nsAutoCString body;
+  ASSERT_EQ(NS_ReadInputStreamToString(stream, body, -1), NS_OK);
+  ASSERT_TRUE(body.EqualsLiteral("a"));
+}
+
+TEST(TestHttpTrafficArchive, Corrupted)
+{
+  Archive archive(Archive::Mode::Replay, Archive::Options());
+  ASSERT_NE(archive.Load("not an archive"_ns), NS_OK);
+
+  // Entries before the cut are still served.
+  nsCString data = ArchiveOf({
+      MakeEntry("GET http://a/", "HTTP/1.1 200 OK\r\n\r\n", "first"),
+      MakeEntry("GET http://b/", "HTTP/1.1 200 OK\r\n\r\n", "second"),
+  });
+  data.Truncate(data.Length() - 3);
+  ASSERT_NE(archive.Load(data), NS_OK);
+  ASSERT_TRUE(archive.Lookup("GET http://a/"_ns));
+  ASSERT_FALSE(archive.Lookup("GET http://b/"_ns));
+}
+
+TEST(TestHttpTrafficArchive, Recording)
+{
+  nsHttpResponseHead head;
+  ASSERT_EQ(head.ParseCachedHead("HTTP/1.1 200 OK\r\nContent-Length: 6\r\n"),
+            NS_OK);
+
+  Archive::Recording recording("GET http://a/"_ns);
+  ASSERT_FALSE(recording.HasResponseHead());
+  recording.SetResponseHead(&head);
+  ASSERT_TRUE(recording.HasResponseHead());
+
+  // The listener gets the same bytes as the archive.
+  for (const char* chunk : {"abc", "def"}) {
+    nsCOMPtr<nsIInputStream> input, result;
+    ASSERT_EQ(NS_NewCStringInputStream(getter_AddRefs(input),
+                                       nsDependentCString(chunk)),
+              NS_OK);
+    ASSERT_EQ(recording.ReadBody(input, 3, getter_AddRefs(result)), NS_OK);
+    nsAutoCString read;
+    ASSERT_EQ(NS_ReadInputStreamToString(result, read, -1), NS_OK);
+    ASSERT_TRUE(read.Equals(chunk));
+  }
+
+  nsCString data("MOZHTTPARCHIVE1\n");
+  Archive::Serialize(recording.Finish(), data);
+
+  Archive archive(Archive::Mode::Replay, Archive::Options());
+  ASSERT_EQ(archive.Load(data), NS_OK);
+  const Archive::Entry* entry = archive.Lookup("GET http://a/"_ns);
+  ASSERT_TRUE(entry);
+  ASSERT_TRUE(entry->mBody.EqualsLiteral("abcdef"));
+
+  nsHttpResponseHead replayed;
+  ASSERT_EQ(replayed.ParseCachedHead(entry->mHead.get()), NS_OK);
+  ASSERT_EQ(replayed.Status(), 200);
+  ASSERT_EQ(replayed.ContentLength(), 6);
+}
+
+TEST(TestHttpTrafficArchive, Pacing)
+{
+  Archive::Entry entry = MakeEntry("GET http://a/", "", "0123456789", 40, 90);
+
+  Archive::Options options;
+  Archive::Pacing pacing = Archive(Archive::Mode::Replay, options)
+                               .PacingFor(entry);
+  ASSERT_EQ(pacing.mFirstByteDelay, 0u);
+  ASSERT_EQ(pacing.mBytesPerTick, 0u);
+
+  // 800 kbit/s is 100 bytes per ms.
+  options.mLatency = 25;
+  options.mBandwidth = 800;
+  pacing = Archive(Archive::Mode::Replay, options).PacingFor(entry);
+  ASSERT_EQ(pacing.mFirstByteDelay, 25u);
+  ASSERT_EQ(pacing.mBytesPerTick, 100 * Archive::kReplayTick);
+
+  options.mBandwidth = 1;
+  pacing = Archive(Archive::Mode::Replay, options).PacingFor(entry);
+  ASSERT_EQ(pacing.mBytesPerTick, 1u);
+
+  // The recorded timings spread the body over the 50ms it took.
+  options.mRecordedTimings = true;
+  options.mBandwidth = 0;
+  pacing = Archive(Archive::Mode::Replay, options).PacingFor(entry);
+  ASSERT_EQ(pacing.mFirstByteDelay, 40u);
+  ASSERT_EQ(pacing.mBytesPerTick, 2u);
+}
+
+TEST(TestHttpTrafficArchive, ReplayThroughChannel)
+{
+  auto archive = MakeUnique<Archive>(Archive::Mode::Replay, Archive::Options());
+  ASSERT_EQ(archive->Load(ArchiveOf({
+                MakeEntry("GET http://archive.test/page",
+                          "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+                          "Content-Length: 11\r\n",
+                          "from replay"),
+            })),
+            NS_OK);
+  Archive::SetForTesting(std::move(archive));
+  auto resetArchive = MakeScopeExit([] { Archive::SetForTesting(nullptr); });
+
+  // The response comes from the archive, without a transaction. Closing the
+  // sticky connection has nothing to do then, and must not fail.
+  RefPtr<ArchiveListener> listener = Load("http://archive.test/page#ref");
+  ASSERT_TRUE(listener);
+  ASSERT_EQ(listener->mStatus, NS_OK);
+  ASSERT_EQ(listener->mResponseStatus, 200u);
+  ASSERT_EQ(listener->mCloseStickyConnectionResult, NS_OK);
+  ASSERT_TRUE(listener->mBody.EqualsLiteral("from replay"));
+
+  // Loads of responses which weren't recorded fail instead of reaching the
+  // network.
+  listener = Load("http://archive.test/missing");
+  ASSERT_TRUE(listener);
+  ASSERT_EQ(listener->mStatus, NS_ERROR_OFFLINE);
+  ASSERT_TRUE(listener->mBody.IsEmpty());
+}
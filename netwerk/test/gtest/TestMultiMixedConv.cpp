@@ -0,0 +1,264 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "nsBaseChannel.h"
+#include "nsCOMPtr.h"
+#include "nsIStreamConverterService.h"
+#include "nsIStreamListener.h"
+#include "nsNetUtil.h"
+#include "nsStreamUtils.h"
+#include "nsStringStream.h"
+#include "nsTArray.h"
+
+using namespace mozilla;
+
+// Feeds synthetic multipart/x-mixed-replace streams to the converter in
+// segments of various sizes, checks the parts come out the same regardless of
+// where the segments split, and benchmarks the throughput.
+
+namespace {
+
+#define BOUNDARY "gc0p4Jq0M2Yt08jU534c0p"
+
+// nsBaseChannel keeps only the type and charset of the content type, but the
+// converter needs the boundary parameter too.
+class MultipartChannel final : public nsBaseChannel {
+ public:
+  MultipartChannel() {
+    nsCOMPtr<nsIURI> uri;
+    MOZ_ALWAYS_SUCCEEDS(NS_NewURI(getter_AddRefs(uri), "http://example.com/"));
+    SetURI(uri);
+  }
+
+  NS_IMETHOD GetContentType(nsACString& aContentType) override {
+    aContentType.AssignLiteral("multipart/x-mixed-replace;boundary=" BOUNDARY);
+    return NS_OK;
+  }
+
+ private:
+  nsresult OpenContentStream(bool aAsync, nsIInputStream** aStream,
+                             nsIChannel** aChannel) override {
+    return NS_ERROR_NOT_IMPLEMENTED;
+  }
+};
+
+class PartCollector final : public nsIStreamListener {
+ public:
+  NS_DECL_ISUPPORTS
+
+  // Without aKeepData, only the number of bytes of each part is kept.
+  explicit PartCollector(bool aKeepData = true) : mKeepData(aKeepData) {}
+
+  NS_IMETHOD OnStartRequest(nsIRequest* aRequest) override {
+    mParts.AppendElement();
+    return NS_OK;
+  }
+
+  NS_IMETHOD OnDataAvailable(nsIRequest* aRequest, nsIInputStream* aStream,
+                             uint64_t aOffset, uint32_t aCount) override {
+    mBytes += aCount;
+    if (!mKeepData) {
+      uint32_t read;
+      return aStream->ReadSegments(NS_DiscardSegment, nullptr, aCount, &read);
+    }
+    nsAutoCString data;
+    nsresult rv = NS_ReadInputStreamToString(aStream, data, aCount);
+    mParts.LastElement().Append(data);
+    return rv;
+  }
+
+  NS_IMETHOD OnStopRequest(nsIRequest* aRequest, nsresult aStatus) override {
+    mStatus = aStatus;
+    return NS_OK;
+  }
+
+  const bool mKeepData;
+  nsTArray<nsCString> mParts;
+  uint64_t mBytes = 0;
+  nsresult mStatus = NS_OK;
+
+ private:
+  ~PartCollector() = default;
+};
+
+NS_IMPL_ISUPPORTS(PartCollector, nsIStreamListener, nsIRequestObserver)
+
+nsCString MakeMultipart(const nsTArray<nsCString>& aParts,
+                        const char* aNewLine) {
+  nsCString result;
+  result.AppendLiteral("This is the preamble");
+  for (const nsCString& part : aParts) {
+    result.Append(aNewLine);
+    result.AppendLiteral("--" BOUNDARY);
+    result.Append(aNewLine);
+    result.AppendLiteral("Content-Type: text/plain");
+    result.Append(aNewLine);
+    result.Append(aNewLine);
+    result.Append(part);
+  }
+  result.Append(aNewLine);
+  result.AppendLiteral("--" BOUNDARY "--");
+  result.Append(aNewLine);
+  result.AppendLiteral("This is the epilogue");
+  return result;
+}
+
+// Passes aInput to the converter in aSegmentSize chunks.
+nsresult Convert(const nsACString& aInput, uint32_t aSegmentSize,
+                 PartCollector* aCollector) {
+  nsresult rv;
+  nsCOMPtr<nsIStreamConverterService> service =
+      do_GetService(NS_STREAMCONVERTERSERVICE_CONTRACTID, &rv);
+  NS_ENSURE_SUCCESS(rv, rv);
+
+  nsCOMPtr<nsIStreamListener> converter;
+  rv = service->AsyncConvertData("multipart/x-mixed-replace", "*/*",
+                                 aCollector, nullptr,
+                                 getter_AddRefs(converter));
+  NS_ENSURE_SUCCESS(rv, rv);
+
+  RefPtr<MultipartChannel> channel = new MultipartChannel();
+  rv = converter->OnStartRequest(channel);
+  NS_ENSURE_SUCCESS(rv, rv);
+
+  for (uint32_t offset = 0; offset < aInput.Length(); offset += aSegmentSize) {
+    uint32_t count = std::min(aSegmentSize, aInput.Length() - offset);
+    nsCOMPtr<nsIInputStream> stream;
+    rv = NS_NewByteInputStream(
+        getter_AddRefs(stream),
+        Span(aInput.BeginReading() + offset, count), NS_ASSIGNMENT_DEPEND);
+    NS_ENSURE_SUCCESS(rv, rv);
+    rv = converter->OnDataAvailable(channel, stream, offset, count);
+    NS_ENSURE_SUCCESS(rv, rv);
+  }
+
+  return converter->OnStopRequest(channel, NS_OK);
+}
+
+void CheckParts(const nsTArray<nsCString>& aParts, const char* aNewLine) {
+  nsCString input = MakeMultipart(aParts, aNewLine);
+  for (uint32_t segmentSize : {1, 2, 3, 5, 8, 13, 21, 64, 1000, 1 << 20}) {
+    RefPtr<PartCollector> collector = new PartCollector();
+    ASSERT_EQ(Convert(input, segmentSize, collector), NS_OK);
+    ASSERT_EQ(collector->mParts.Length(), aParts.Length())
+        << "segment size " << segmentSize;
+    for (size_t i = 0; i < aParts.Length(); i++) {
+      EXPECT_TRUE(collector->mParts[i] == aParts[i])
+          << "part " << i << ", segment size " << segmentSize;
+    }
+    EXPECT_EQ(collector->mStatus, NS_OK);
+  }
+}
+
+nsTArray<nsCString> TrickyParts() {
+  nsTArray<nsCString> parts;
+  parts.AppendElement("plain text"_ns);
+  parts.AppendElement(""_ns);
+  parts.AppendElement("line one\r\nline two\nline three"_ns);
+  // Prefixes of the delimiter, with and without line breaks before them.
+  parts.AppendElement("--gc0p4Jq0M2Yt08jU534c0 and -gc0p4Jq0M2Yt08jU534c0p"_ns);
+  parts.AppendElement("a\r\n--gc0p4Jq0M2Yt08jU534c0X\n--gc0p4Jq0M2Y"_ns);
+  parts.AppendElement("lone \r carriage \r\r returns"_ns);
+  static const char kBinary[] = "binary \0\xff\x01 data";
+  parts.AppendElement(nsCString(kBinary, sizeof(kBinary) - 1));
+  return parts;
+}
+
+// A 16MB multipart stream for the throughput benchmarks, built once.
+struct BenchStream {
+  explicit BenchStream(nsTArray<nsCString>&& aParts)
+      : mParts(std::move(aParts)), mInput(MakeMultipart(mParts, "\r\n")) {
+    for (const nsCString& part : mParts) {
+      mBytes += part.Length();
+    }
+  }
+
+  const nsTArray<nsCString> mParts;
+  const nsCString mInput;
+  uint64_t mBytes = 0;
+};
+
+// Parts of pseudo-random bytes, like a stream of JPEG frames.
+const BenchStream& BinaryStream() {
+  static const BenchStream sStream([] {
+    nsTArray<nsCString> parts;
+    uint32_t state = 1;
+    for (int i = 0; i < 64; i++) {
+      nsCString& part = *parts.AppendElement();
+      part.SetLength(256 * 1024);
+      char* data = part.BeginWriting();
+      for (uint32_t j = 0; j < part.Length(); j++) {
+        state = state * 1664525u + 1013904223u;
+        data[j] = char(state >> 24);
+      }
+    }
+    return parts;
+  }());
+  return sStream;
+}
+
+// Parts of short text lines, which have many line breaks to check for the
+// delimiter after.
+const BenchStream& TextStream() {
+  static const BenchStream sStream([] {
+    nsTArray<nsCString> parts;
+    for (int i = 0; i < 64; i++) {
+      nsCString& part = *parts.AppendElement();
+      while (part.Length() < 256 * 1024) {
+        part.AppendLiteral("{\"id\": ");
+        part.AppendInt(i);
+        part.AppendLiteral(", \"text\": \"some status update text\"}\r\n");
+      }
+    }
+    return parts;
+  }());
+  return sStream;
+}
+
+// Converts aStream in aSegmentSize chunks, discarding the data of the parts.
+void ConvertThroughput(const BenchStream& aStream, uint32_t aSegmentSize) {
+  RefPtr<PartCollector> collector = new PartCollector(false);
+  ASSERT_EQ(Convert(aStream.mInput, aSegmentSize, collector), NS_OK);
+  ASSERT_EQ(collector->mParts.Length(), aStream.mParts.Length());
+  ASSERT_EQ(collector->mBytes, aStream.mBytes);
+}
+
+}  // namespace
+
+TEST(TestMultiMixedConv, SegmentSplits)
+{
+  CheckParts(TrickyParts(), "\r\n");
+  CheckParts(TrickyParts(), "\n");
+}
+
+TEST(TestMultiMixedConv, LargeParts)
+{
+  nsTArray<nsCString> parts;
+  for (int i = 0; i < 4; i++) {
+    nsCString& part = *parts.AppendElement();
+    while (part.Length() < 100000) {
+      part.AppendLiteral("--gc0p4Jq0M2Yt08jU534c0q is not the boundary\r\n");
+      part.AppendInt(i);
+    }
+  }
+  parts[2].Truncate();
+  CheckParts(parts, "\r\n");
+}
+
+MOZ_GTEST_BENCH(TestMultiMixedConv, BinaryThroughput4K,
+                [] { ConvertThroughput(BinaryStream(), 4096); });
+MOZ_GTEST_BENCH(TestMultiMixedConv, BinaryThroughput32K,
+                [] { ConvertThroughput(BinaryStream(), 32768); });
+MOZ_GTEST_BENCH(TestMultiMixedConv, TextThroughput4K,
+                [] { ConvertThroughput(TextStream(), 4096); });
+MOZ_GTEST_BENCH(TestMultiMixedConv, TextThroughput32K,
+                [] { ConvertThroughput(TextStream(), 32768); });
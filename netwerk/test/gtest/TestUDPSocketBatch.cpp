@@ -0,0 +1,140 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+
+#include "mozilla/SyncRunnable.h"
+#include "mozilla/net/DNS.h"
+#include "nsCOMPtr.h"
+#include "nsComponentManagerUtils.h"
+#include "nsIUDPSocket.h"
+#include "nsNetCID.h"
+#include "nsServiceManagerUtils.h"
+#include "nsThreadUtils.h"
+#include "prenv.h"
+#include "prinrval.h"
+#include "prio.h"
+#include "prnetdb.h"
+
+using namespace mozilla;
+using namespace mozilla::net;
+
+// Sends a batch of datagrams over the loopback interface with
+// sendBatchWithAddress, and checks that recvBatchWithAddr hands back the same
+// payloads, and that the batched paths need fewer system calls than
+// datagrams.
+
+namespace {
+
+const uint32_t kDatagrams = 40;
+
+already_AddRefed<nsIUDPSocket> LoopbackSocket() {
+  nsCOMPtr<nsIUDPSocket> socket =
+      do_CreateInstance("@mozilla.org/network/udp-socket;1");
+  if (!socket) {
+    return nullptr;
+  }
+  NetAddr addr;
+  addr.inet.family = AF_INET;
+  addr.inet.ip = PR_htonl(PR_INADDR_LOOPBACK);
+  addr.inet.port = 0;
+  if (NS_FAILED(socket->InitWithAddress(&addr, nullptr, false, 1))) {
+    return nullptr;
+  }
+  return socket.forget();
+}
+
+// The first half of the datagrams have the same size, so that they can be
+// sent as one GSO message, the other half have different sizes.
+void MakeDatagram(uint32_t aIndex, const NetAddr& aAddr,
+                  UDPDatagram& aDatagram) {
+  uint32_t size = aIndex < kDatagrams / 2 ? 1200 : 100 + aIndex;
+  aDatagram.mAddr = aAddr;
+  aDatagram.mData.SetLength(size);
+  for (uint32_t i = 0; i < size; i++) {
+    aDatagram.mData[i] = uint8_t(aIndex + i);
+  }
+}
+
+void SendAndReceive() {
+  nsCOMPtr<nsIUDPSocket> sender = LoopbackSocket();
+  nsCOMPtr<nsIUDPSocket> receiver = LoopbackSocket();
+  ASSERT_TRUE(sender && receiver);
+
+  NetAddr from, to;
+  ASSERT_EQ(sender->GetAddress(&from), NS_OK);
+  ASSERT_EQ(receiver->GetAddress(&to), NS_OK);
+
+  nsTArray<UDPDatagram> sent;
+  for (uint32_t i = 0; i < kDatagrams; i++) {
+    MakeDatagram(i, to, *sent.AppendElement());
+  }
+  uint32_t count = 0;
+  ASSERT_EQ(sender->SendBatchWithAddress(sent, &count), NS_OK);
+  ASSERT_EQ(count, kDatagrams);
+
+  // Loopback datagrams are queued by the time sendmmsg returns, but give the
+  // kernel a moment in case it is slower.
+  nsTArray<UDPDatagram> received;
+  PRIntervalTime start = PR_IntervalNow();
+  while (received.Length() < kDatagrams &&
+         PR_IntervalToSeconds(PR_IntervalNow() - start) < 10) {
+    size_t length = received.Length();
+    ASSERT_EQ(receiver->RecvBatchWithAddr(kDatagrams, received), NS_OK);
+    if (received.Length() == length) {
+      PR_Sleep(PR_MillisecondsToInterval(1));
+    }
+  }
+
+  ASSERT_EQ(received.Length(), kDatagrams);
+  for (uint32_t i = 0; i < kDatagrams; i++) {
+    EXPECT_EQ(received[i].mData, sent[i].mData) << "datagram " << i;
+    uint16_t port = 0;
+    ASSERT_EQ(received[i].mAddr.GetPort(&port), NS_OK);
+    uint16_t senderPort = 0;
+    ASSERT_EQ(from.GetPort(&senderPort), NS_OK);
+    EXPECT_EQ(port, senderPort);
+  }
+
+  uint64_t sendSyscalls = 0, sendDatagrams = 0;
+  uint64_t recvSyscalls = 0, recvDatagrams = 0;
+  ASSERT_EQ(sender->GetSendSyscallCount(&sendSyscalls), NS_OK);
+  ASSERT_EQ(sender->GetSendDatagramCount(&sendDatagrams), NS_OK);
+  ASSERT_EQ(receiver->GetRecvSyscallCount(&recvSyscalls), NS_OK);
+  ASSERT_EQ(receiver->GetRecvDatagramCount(&recvDatagrams), NS_OK);
+  EXPECT_EQ(sendDatagrams, kDatagrams);
+  EXPECT_EQ(recvDatagrams, kDatagrams);
+  EXPECT_GE(sendSyscalls, 1u);
+  EXPECT_GE(recvSyscalls, 1u);
+
+#if defined(XP_LINUX) && !defined(FUZZING)
+  if (!PR_GetEnv("MOZ_UDP_DISABLE_BATCH_IO")) {
+    EXPECT_LT(sendSyscalls, kDatagrams);
+    EXPECT_LT(recvSyscalls, kDatagrams);
+  } else {
+    EXPECT_EQ(sendSyscalls, kDatagrams);
+  }
+#else
+  EXPECT_EQ(sendSyscalls, kDatagrams);
+#endif
+
+  sender->Close();
+  receiver->Close();
+}
+
+}  // namespace
+
+TEST(TestUDPSocketBatch, Loopback)
+{
+  nsCOMPtr<nsIEventTarget> sts =
+      do_GetService(NS_SOCKETTRANSPORTSERVICE_CONTRACTID);
+  ASSERT_TRUE(sts);
+
+  // The batched calls must be made on the socket thread.
+  nsCOMPtr<nsIRunnable> runnable = NS_NewRunnableFunction(
+      "TestUDPSocketBatch::Loopback", [] { SendAndReceive(); });
+  ASSERT_EQ(SyncRunnable::DispatchToThread(sts, runnable), NS_OK);
+}
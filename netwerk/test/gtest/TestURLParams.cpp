@@ -0,0 +1,229 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include <utility>
+
+#include "Taint.h"
+#include "nsString.h"
+#include "nsTArray.h"
+#include "nsURLHelper.h"
+
+using namespace mozilla;
+
+// Checks that the lazily decoded parameters of URLParams match what an eager
+// parse gives, and that decoding moves the taint of the query string to the
+// right characters of the names and values.
+
+namespace {
+
+using Range = std::pair<uint32_t, uint32_t>;
+
+template <typename String>
+void Taint(String& aString, uint32_t aBegin, uint32_t aEnd) {
+  SafeStringTaint taint;
+  taint.append(
+      TaintRange(aBegin, aEnd, TaintFlow(TaintOperation("location.search"))));
+  aString.AssignTaint(taint);
+}
+
+template <typename String>
+nsTArray<Range> Ranges(const String& aString) {
+  nsTArray<Range> ranges;
+  if (aString.IsTainted()) {
+    for (const TaintRange& range : aString.Taint()) {
+      ranges.AppendElement(Range(range.begin(), range.end()));
+    }
+  }
+  return ranges;
+}
+
+const char* const kQueries[] = {
+    "",
+    "a=1",
+    "a=1&b=2&a=3",
+    "&&a&=&b=&=c&",
+    "q=hello+world&x=%41%42%4a%4A",
+    "bad=%&bad2=%4&bad3=%zz&pct=100%25",
+    "caf%C3%A9=d%C3%A9j%C3%A0&emoji=%F0%9F%98%80",
+    "raw=\xC3\xA9t\xC3\xA9&invalid=%FF%C3",
+    "a+b=c+d&a%20b=e",
+};
+
+}  // namespace
+
+TEST(TestURLParams, MatchesEagerParse)
+{
+  for (const char* query : kQueries) {
+    nsDependentCString input(query);
+    nsTArray<nsString> expected;
+    URLParams::Parse(input, [&](nsString&& aName, nsString&& aValue) {
+      expected.AppendElement(std::move(aName));
+      expected.AppendElement(std::move(aValue));
+      return true;
+    });
+
+    URLParams params;
+    params.ParseInput(input);
+    ASSERT_EQ(params.Length() * 2, expected.Length()) << query;
+
+    // Lookups by name see the same first values as the eager parse.
+    for (uint32_t i = 0; i < expected.Length(); i += 2) {
+      EXPECT_TRUE(params.Has(expected[i])) << query;
+      nsString value;
+      params.Get(expected[i], value);
+      nsString first;
+      URLParams::Extract(input, expected[i], first);
+      EXPECT_TRUE(value.Equals(first)) << query;
+    }
+
+    for (uint32_t i = 0; i < params.Length(); i++) {
+      EXPECT_TRUE(params.GetKeyAtIndex(i).Equals(expected[2 * i])) << query;
+      EXPECT_TRUE(params.GetValueAtIndex(i).Equals(expected[2 * i + 1]))
+          << query;
+    }
+    EXPECT_FALSE(params.Has(u"missing"_ns));
+  }
+}
+
+TEST(TestURLParams, Mutations)
+{
+  URLParams params;
+  params.ParseInput("b=2&a=1&c=%33&a=4"_ns);
+
+  params.Set(u"c"_ns, u"x y"_ns);
+  params.Delete(u"b"_ns);
+  params.Append(u"d"_ns, u"5"_ns);
+  params.Sort();
+
+  nsAutoString serialized;
+  params.Serialize(serialized, true);
+  EXPECT_TRUE(serialized.EqualsLiteral("a=1&a=4&c=x+y&d=5"));
+
+  nsTArray<nsString> all;
+  params.GetAll(u"a"_ns, all);
+  ASSERT_EQ(all.Length(), 2u);
+  EXPECT_TRUE(all[0].EqualsLiteral("1"));
+  EXPECT_TRUE(all[1].EqualsLiteral("4"));
+
+  params.ParseInput("e=6"_ns);
+  EXPECT_EQ(params.Length(), 1u);
+  EXPECT_FALSE(params.Has(u"a"_ns));
+}
+
+TEST(TestURLParams, Taint)
+{
+  // A fully tainted query string, like location.search.
+  nsCString query("q=%41b+c&plain=1&caf%C3%A9=d%C3%A9j%C3%A0&x"_ns);
+  Taint(query, 0, query.Length());
+  URLParams params;
+  params.ParseInput(query);
+
+  nsString value;
+  params.Get(u"q"_ns, value);
+  EXPECT_TRUE(value.EqualsLiteral("Ab c"));
+  EXPECT_EQ(Ranges(value), nsTArray<Range>{Range(0, 4)});
+
+  params.Get(u"café"_ns, value);
+  EXPECT_TRUE(value.Equals(u"déjà"_ns));
+  EXPECT_EQ(Ranges(value), nsTArray<Range>{Range(0, 4)});
+  EXPECT_EQ(Ranges(params.GetKeyAtIndex(2)), nsTArray<Range>{Range(0, 4)});
+  EXPECT_EQ(Ranges(params.GetKeyAtIndex(3)), nsTArray<Range>{Range(0, 1)});
+
+  // Only the second value is tainted.
+  query.AssignLiteral("a=xyz&b=123");
+  Taint(query, 8, 11);
+  params.ParseInput(query);
+  params.Get(u"a"_ns, value);
+  EXPECT_FALSE(value.IsTainted());
+  params.Get(u"b"_ns, value);
+  EXPECT_EQ(Ranges(value), nsTArray<Range>{Range(0, 3)});
+
+  // Taint after a multibyte character lands on the UTF-16 index.
+  query.AssignLiteral("v=%C3%A9x");
+  Taint(query, 8, 9);
+  params.ParseInput(query);
+  params.Get(u"v"_ns, value);
+  EXPECT_TRUE(value.Equals(u"éx"_ns));
+  EXPECT_EQ(Ranges(value), nsTArray<Range>{Range(1, 2)});
+
+  // Taint on part of a multibyte character taints all of it.
+  Taint(query, 2, 5);
+  params.ParseInput(query);
+  params.Get(u"v"_ns, value);
+  EXPECT_EQ(Ranges(value), nsTArray<Range>{Range(0, 1)});
+}
+
+TEST(TestURLParams, MalformedUTF8Taint)
+{
+  // Each query decodes to U+FFFD characters followed by an "x", of which only
+  // the "x" is tainted. The taint stays on the "x" however many replacement
+  // characters the malformed bytes turned into.
+  struct {
+    const char* mQuery;
+    const char16_t* mValue;
+  } kCases[] = {
+      // Overlong encoding of U+0000.
+      {"v=%C0%80x", u"\uFFFD\uFFFDx"},
+      // Leads above U+10FFFF.
+      {"v=%F5%80%80x", u"\uFFFD\uFFFD\uFFFDx"},
+      {"v=%F7%BF%BF%BFx", u"\uFFFD\uFFFD\uFFFD\uFFFDx"},
+      // A surrogate, and a sequence cut short by the "x".
+      {"v=%ED%A0%80x", u"\uFFFD\uFFFD\uFFFDx"},
+      {"v=%F0%9F%98x", u"\uFFFDx"},
+      // A lone continuation byte, then a character after a truncated one.
+      {"v=%80%E2%82%AC%E2x", u"\uFFFD\u20AC\uFFFDx"},
+  };
+
+  for (const auto& testCase : kCases) {
+    nsCString query(testCase.mQuery);
+    Taint(query, query.Length() - 1, query.Length());
+    URLParams params;
+    params.ParseInput(query);
+
+    nsString value;
+    params.Get(u"v"_ns, value);
+    nsDependentString expected(testCase.mValue);
+    EXPECT_TRUE(value.Equals(expected)) << testCase.mQuery;
+    EXPECT_EQ(Ranges(value),
+              nsTArray<Range>{Range(expected.Length() - 1, expected.Length())})
+        << testCase.mQuery;
+  }
+}
+
+TEST(TestURLParams, UTF8Taint)
+{
+  nsString input(u"é=x"_ns);
+  Taint(input, 2, 3);
+  nsCString converted;
+  converted.AssignTaint(URLParams::UTF8Taint(input));
+  EXPECT_EQ(Ranges(converted), nsTArray<Range>{Range(3, 4)});
+
+  input.Assign(u"\U0001F600ab"_ns);
+  Taint(input, 1, 3);
+  converted.AssignTaint(URLParams::UTF8Taint(input));
+  EXPECT_EQ(Ranges(converted), nsTArray<Range>{Range(0, 5)});
+}
+
+// A long query string of which a single parameter is read, e.g. by
+// new URLSearchParams(location.search).get("id").
+MOZ_GTEST_BENCH(TestURLParams, ParseAndGetOne, [] {
+  nsCString query;
+  for (int i = 0; i < 2000; i++) {
+    query.AppendPrintf("%sparam%d=some%%20encoded%%20value%%20%d", i ? "&" : "",
+                       i, i);
+  }
+  query.AppendLiteral("&id=42");
+  for (int i = 0; i < 100; i++) {
+    URLParams params;
+    params.ParseInput(query);
+    nsString value;
+    params.Get(u"id"_ns, value);
+    ASSERT_TRUE(value.EqualsLiteral("42"));
+  }
+});
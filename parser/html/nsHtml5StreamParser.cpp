@@ -84,6 +84,7 @@
 #include "nsTPromiseFlatString.h"
 #include "nsThreadUtils.h"
 #include "nsXULAppAPI.h"
+#include "TaintTrace.h"
 
 extern "C" {
 // Defined in intl/encoding_glue/src/lib.rs
@@ -910,9 +911,7 @@ nsresult nsHtml5StreamParser::WriteStreamBytes(
     // TaintFox: slight hack: propagate taint information after the conversion
     // (should be done during the conversion)
     if (aTaint.hasTaint()) {
-#if (DEBUG_E2E_TAINTING)
-      printf("+++++ Writing taint of length %d, %d/%lu bytes written +++++\n", aTaint.begin()->end(), read, written);
-#endif
+      TaintTrace(TaintTraceEvent::Propagate, mLastBuffer.get(), "nsHtml5StreamParser::WriteStreamBytes", read);
       mLastBuffer->setTaint(aTaint.safeSubTaint(totalRead, totalRead + read));
     }
 
@@ -1621,13 +1620,9 @@ nsresult nsHtml5StreamParser::OnDataAvailable(nsIRequest* aRequest,
 
   // TaintFox: see if there's taint information available.
   nsCOMPtr<nsITaintawareInputStream> taintInputStream(do_QueryInterface(aInStream));
-#if (DEBUG_E2E_TAINTING)
   if (!taintInputStream) {
-    puts("!!!!! NO taint-aware input stream available in StreamParser::OnDataAvailable !!!!!");
-  } else {
-    puts("+++++ Taint-aware input stream available in StreamParser::OnDataAvailable +++++");
+    TaintTrace(TaintTraceEvent::Drop, this, "nsHtml5StreamParser::OnDataAvailable", aLength);
   }
-#endif
 
   MOZ_ASSERT(mRequest == aRequest, "Got data on wrong stream.");
   uint32_t totalRead;
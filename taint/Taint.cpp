@@ -8,6 +8,7 @@
  */
 
 #include "Taint.h"
+#include "TaintTrace.h"
 
 #include <locale>   // wstring_convert
 #include <codecvt>  // codecvt_utf8
@@ -379,7 +380,7 @@ bool TaintRange::operator<(const TaintRange& other) const
 
 bool TaintRange::operator<(uint32_t index) const
 {
-    return this->end() < index;
+    return this->end() <= index;
 }
 
 bool TaintRange::operator>(uint32_t index) const
@@ -522,19 +523,14 @@ void StringTaint::assignFromSubTaint(const StringTaint& other, uint32_t begin, u
 {
     MOZ_COUNT_CTOR(StringTaint);
     auto ranges = new std::vector<TaintRange>();
-    if (other.ranges_) {
-        // Use binary search to get first range
-        auto range = std::lower_bound(other.begin(), other.end(), begin);
-        for (; range != other.end(); range++) {
-            if (range->begin() < end && range->end() > begin && end > begin) {
-                ranges->push_back(TaintRange(std::max(range->begin(), begin) - begin,
-                                             std::min(range->end(), end) - begin,
-                                             range->flow()));
-            }
-            // Break out early if possible
-            if (range->end() > end) {
-                break;
-            }
+    if (other.ranges_ && end > begin) {
+        // Use binary search to get the first range, then only visit the
+        // ranges overlapping [begin, end).
+        for (auto range = other.findRange(begin);
+             range != other.end() && range->begin() < end; range++) {
+            ranges->push_back(TaintRange(std::max(range->begin(), begin) - begin,
+                                         std::min(range->end(), end) - begin,
+                                         range->flow()));
         }
     }
     assign(ranges);
@@ -694,9 +690,14 @@ void StringTaint::insert(uint32_t index, const StringTaint& taint)
     assign(ranges);
 }
 
+std::vector<TaintRange>::const_iterator StringTaint::findRange(uint32_t index) const
+{
+    return std::lower_bound(begin(), end(), index);
+}
+
 const TaintFlow* StringTaint::at(uint32_t index) const
 {
-    auto rangeItr = std::lower_bound(begin(), end(), index);
+    auto rangeItr = findRange(index);
     if (rangeItr != end()) {
         if (rangeItr->contains(index)) {
             return &rangeItr->flow();
@@ -707,12 +708,39 @@ const TaintFlow* StringTaint::at(uint32_t index) const
 
 const TaintFlow& StringTaint::atRef(uint32_t index) const
 {
-    // TODO make this a binary search
-    for (auto& range : *this) {
-        if (range.begin() <= index && range.end() > index)
-            return range.flow();
+    const TaintFlow* flow = at(index);
+    return flow ? *flow : TaintFlow::getEmptyTaintFlow();
+}
+
+StringTaint::Cursor::Cursor(const StringTaint& taint)
+    : taint_(taint), current_(taint.begin()), last_index_(0) {}
+
+const TaintFlow* StringTaint::Cursor::at(uint32_t index)
+{
+    if (!taint_.hasTaint()) {
+        return nullptr;
+    }
+
+    if (index < last_index_) {
+        // Moving backwards, restart with a binary search.
+        current_ = taint_.findRange(index);
+    } else {
+        while (current_ != taint_.end() && current_->end() <= index) {
+            current_++;
+        }
     }
-    return TaintFlow::getEmptyTaintFlow();
+    last_index_ = index;
+
+    if (current_ != taint_.end() && current_->contains(index)) {
+        return &current_->flow();
+    }
+    return nullptr;
+}
+
+const TaintFlow& StringTaint::Cursor::atRef(uint32_t index)
+{
+    const TaintFlow* flow = at(index);
+    return flow ? *flow : TaintFlow::getEmptyTaintFlow();
 }
 
 void StringTaint::set(uint32_t index, const TaintFlow& flow)
@@ -743,17 +771,29 @@ StringTaint& StringTaint::subtaint(uint32_t index)
 
 StringTaint& StringTaint::extend(const TaintOperation& operation)
 {
-    for (auto& range : *this)
+    uint32_t length = 0;
+    for (auto& range : *this) {
         range.flow().extend(operation);
+        length += range.end() - range.begin();
+    }
 
+    if (length) {
+        TaintTrace(TaintTraceEvent::Propagate, this, operation.name(), length);
+    }
     return *this;
 }
 
 StringTaint& StringTaint::extend(TaintOperation&& operation)
 {
-    for (auto& range : *this)
+    uint32_t length = 0;
+    for (auto& range : *this) {
         range.flow().extend(operation);
+        length += range.end() - range.begin();
+    }
 
+    if (length) {
+        TaintTrace(TaintTraceEvent::Propagate, this, operation.name(), length);
+    }
     return *this;
 }
 
@@ -1106,6 +1146,48 @@ TaintRange ParseRange(const std::string& str, size_t& i, size_t length, bool& va
     return TaintRange(begin, end, TaintOperation(source.c_str()));
 }
 
+// Returns the number of UTF-16 code units encoded by the UTF-8 sequence
+// starting with the given byte and advances |byte| past that sequence.
+static uint32_t AdvanceUtf8(const char* utf8, size_t length, size_t& byte)
+{
+    unsigned char lead = static_cast<unsigned char>(utf8[byte]);
+    size_t size = 1;
+    if (lead >= 0xF0) {
+        size = 4;
+    } else if (lead >= 0xE0) {
+        size = 3;
+    } else if (lead >= 0xC0) {
+        size = 2;
+    }
+    byte = std::min(byte + size, length);
+    return size == 4 ? 2 : 1;
+}
+
+SafeStringTaint TaintToUtf8(const StringTaint& taint, const char* utf8, size_t length)
+{
+    SafeStringTaint result;
+
+    uint32_t unit = 0;
+    size_t byte = 0;
+    for (const TaintRange& range : taint) {
+        while (unit < range.begin() && byte < length) {
+            unit += AdvanceUtf8(utf8, length, byte);
+        }
+        size_t begin = byte;
+        while (unit < range.end() && byte < length) {
+            unit += AdvanceUtf8(utf8, length, byte);
+        }
+        if (byte > begin) {
+            result.append(TaintRange(begin, byte, range.flow()));
+        }
+        if (byte >= length) {
+            break;
+        }
+    }
+
+    return result;
+}
+
 StringTaint ParseTaint(const std::string& str)
 {
 #if (DEBUG_E2E_TAINTING)
@@ -386,6 +386,10 @@ class TaintRange {
     TaintRange& operator=(const TaintRange& other);
 
     // Comparison Operators for searches
+    //
+    // A range compares less than an index if it ends at or before that index,
+    // so std::lower_bound(begin, end, index) yields the first range which
+    // could contain the index.
     bool operator<(const TaintRange& other) const;
     bool operator<(uint32_t index) const;
     bool operator>(uint32_t index) const;
@@ -551,6 +555,41 @@ class StringTaint
     }
     const TaintFlow& atRef(uint32_t index) const;
 
+    // Returns an iterator to the first range which ends after the given index,
+    // i.e. the range containing the index if there is one. This is a binary
+    // search over the (sorted) ranges.
+    std::vector<TaintRange>::const_iterator findRange(uint32_t index) const;
+
+    // Forward cursor for repeated per-character taint lookups.
+    //
+    // Loops which query the taint of a string one character at a time should
+    // use a cursor instead of calling at() for every index: lookups at
+    // increasing indices advance the cursor and are amortized O(1), lookups
+    // at a smaller index than the previous one fall back to a binary search.
+    //
+    // The cursor does not own any taint information. The StringTaint instance
+    // must outlive the cursor and must not be modified while it is in use.
+    class Cursor {
+      public:
+        explicit Cursor(const StringTaint& taint);
+
+        // Same as StringTaint::at().
+        const TaintFlow* at(uint32_t index);
+        const TaintFlow* operator[](uint32_t index) {
+            return at(index);
+        }
+
+        // Same as StringTaint::atRef().
+        const TaintFlow& atRef(uint32_t index);
+
+      private:
+        const StringTaint& taint_;
+        std::vector<TaintRange>::const_iterator current_;
+        uint32_t last_index_;
+    };
+
+    Cursor cursor() const { return Cursor(*this); }
+
     // Sets the taint flow for the character at the given index.
     // This will override any previous taint information for that character.
     void set(uint32_t index, const TaintFlow& flow);
@@ -785,6 +824,16 @@ static_assert(sizeof(TaintableString) == sizeof(StringTaint), "Class TaintableSt
  */
 StringTaint ParseTaint(const std::string& str);
 
+/*
+ * Converts taint information of a UTF-16 string to taint information of its
+ * UTF-8 encoding, i.e. translates character indices to byte offsets.
+ *
+ * The given bytes must be the UTF-8 encoding of the string the taint belongs
+ * to. Unpaired surrogates are expected to be replaced by U+FFFD (three bytes),
+ * as done by all Gecko and SpiderMonkey encoders.
+ */
+SafeStringTaint TaintToUtf8(const StringTaint& taint, const char* utf8, size_t length);
+
 /*
  * Print a string representation of the given StringTaint instance to stdout.
  */
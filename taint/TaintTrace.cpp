@@ -0,0 +1,265 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* vim: set ts=8 sts=4 et sw=4 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "TaintTrace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static const uint32_t kTraceVersion = 1;
+
+// Number of records per thread. Each record takes up three 64 bit words.
+static const uint64_t kBufferRecords = 1 << 13;
+static const uint64_t kRecordWords = 3;
+
+// The length is stored in the low 28 bits of the last record word.
+static const uint32_t kMaxLength = (1u << 28) - 1;
+
+// Size of the per-thread cache of operation names already added to the name
+// table.
+static const uint32_t kNameCacheSize = 256;
+
+namespace {
+
+struct TraceBuffer
+{
+    // Records are written with relaxed atomic stores by the owning thread
+    // only, so that a concurrent dump never performs a racy read.
+    std::atomic<uint64_t> words[kBufferRecords * kRecordWords];
+
+    // Total number of records ever written into this buffer.
+    std::atomic<uint64_t> head;
+
+    // Whether a live thread currently records into this buffer.
+    std::atomic<bool> owned;
+
+    std::atomic<uint64_t> threadId;
+
+    // Buffers are never freed, so this is immutable once published.
+    TraceBuffer* next;
+};
+
+// Releases the buffer of a thread on thread exit so it can be reused.
+struct BufferOwner
+{
+    TraceBuffer* buffer = nullptr;
+
+    ~BufferOwner() {
+        if (buffer) {
+            buffer->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+// An operation name already added to the name table.
+struct NameCacheEntry
+{
+    uint32_t hash = 0;
+    uint32_t id = 0;
+    // The interned name, entries of the name table are never removed.
+    const std::string* name = nullptr;
+};
+
+}
+
+std::atomic<bool> taint_trace_detail::gEnabled(true);
+
+static std::atomic<TraceBuffer*> gBuffers(nullptr);
+
+static std::mutex gNamesLock;
+static std::unordered_map<uint32_t, std::string>* gNames = nullptr;
+
+static thread_local BufferOwner tOwner;
+static thread_local NameCacheEntry tNameCache[kNameCacheSize];
+
+static uint32_t HashOperation(const char* operation)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char* c = operation; *c; c++) {
+        hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+    }
+    return hash;
+}
+
+// Returns the id of an operation name, adding the name to the name table
+// if this thread hasn't seen it recently.
+static uint32_t OperationId(const char* operation)
+{
+    uint32_t hash = HashOperation(operation);
+    NameCacheEntry& cached = tNameCache[hash % kNameCacheSize];
+    if (cached.name && cached.hash == hash && *cached.name == operation) {
+        return cached.id;
+    }
+
+    std::lock_guard<std::mutex> lock(gNamesLock);
+    if (!gNames) {
+        gNames = new std::unordered_map<uint32_t, std::string>();
+    }
+
+    // A name whose hash collides with another name gets the next free id.
+    uint32_t id = hash;
+    auto entry = gNames->find(id);
+    while (entry != gNames->end() && entry->second != operation) {
+        entry = gNames->find(++id);
+    }
+    if (entry == gNames->end()) {
+        entry = gNames->emplace(id, operation).first;
+    }
+
+    cached.hash = hash;
+    cached.id = id;
+    cached.name = &entry->second;
+    return id;
+}
+
+static TraceBuffer* AcquireBuffer()
+{
+    uint64_t threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    // Reuse the buffer of an exited thread if possible. Its old records are
+    // kept until they are overwritten.
+    for (TraceBuffer* buffer = gBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+        bool expected = false;
+        if (!buffer->owned.load(std::memory_order_relaxed) &&
+            buffer->owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            buffer->threadId.store(threadId, std::memory_order_relaxed);
+            return buffer;
+        }
+    }
+
+    TraceBuffer* buffer = new TraceBuffer();
+    buffer->head.store(0, std::memory_order_relaxed);
+    buffer->owned.store(true, std::memory_order_relaxed);
+    buffer->threadId.store(threadId, std::memory_order_relaxed);
+
+    TraceBuffer* head = gBuffers.load(std::memory_order_relaxed);
+    do {
+        buffer->next = head;
+    } while (!gBuffers.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+
+    return buffer;
+}
+
+void taint_trace_detail::Record(TaintTraceEvent event, const void* string, const char* operation, uint32_t length)
+{
+    TraceBuffer* buffer = tOwner.buffer;
+    if (!buffer) {
+        buffer = tOwner.buffer = AcquireBuffer();
+    }
+
+    uint32_t id = OperationId(operation ? operation : "");
+
+    uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    std::atomic<uint64_t>* record = &buffer->words[(index % kBufferRecords) * kRecordWords];
+    record[0].store(now, std::memory_order_relaxed);
+    record[1].store(reinterpret_cast<uintptr_t>(string), std::memory_order_relaxed);
+    record[2].store(uint64_t(id) << 32 | uint64_t(event) << 28 | std::min(length, kMaxLength),
+                    std::memory_order_relaxed);
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+void TaintTraceSetEnabled(bool enabled)
+{
+    taint_trace_detail::gEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool TaintTraceIsEnabled()
+{
+    return taint_trace_detail::gEnabled.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+static bool WriteValue(FILE* file, T value)
+{
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static bool DumpNames(FILE* file)
+{
+    std::lock_guard<std::mutex> lock(gNamesLock);
+
+    uint32_t count = gNames ? gNames->size() : 0;
+    if (!WriteValue(file, count)) {
+        return false;
+    }
+    if (!gNames) {
+        return true;
+    }
+
+    for (auto& entry : *gNames) {
+        if (!WriteValue(file, entry.first) ||
+            !WriteValue(file, uint32_t(entry.second.size())) ||
+            fwrite(entry.second.data(), 1, entry.second.size(), file) != entry.second.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool DumpBuffer(FILE* file, TraceBuffer* buffer, std::vector<uint64_t>& records)
+{
+    uint64_t end = buffer->head.load(std::memory_order_acquire);
+    uint64_t begin = end > kBufferRecords ? end - kBufferRecords : 0;
+
+    records.clear();
+    for (uint64_t i = begin; i < end; i++) {
+        std::atomic<uint64_t>* record = &buffer->words[(i % kBufferRecords) * kRecordWords];
+        for (uint64_t w = 0; w < kRecordWords; w++) {
+            records.push_back(record[w].load(std::memory_order_relaxed));
+        }
+    }
+
+    // The owning thread may have wrapped around while we were copying. Skip
+    // every record which could have been overwritten in the meantime.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t newHead = buffer->head.load(std::memory_order_relaxed);
+    uint64_t firstValid = newHead >= kBufferRecords ? newHead - kBufferRecords + 1 : 0;
+    uint64_t skip = firstValid > begin ? std::min(firstValid - begin, end - begin) : 0;
+
+    uint32_t count = uint32_t(end - begin - skip);
+    if (!WriteValue(file, buffer->threadId.load(std::memory_order_relaxed)) || !WriteValue(file, count)) {
+        return false;
+    }
+    size_t words = size_t(count) * kRecordWords;
+    return fwrite(records.data() + skip * kRecordWords, sizeof(uint64_t), words, file) == words;
+}
+
+bool TaintTraceDump(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = fwrite("TTRC", 1, 4, file) == 4 && WriteValue(file, kTraceVersion) && DumpNames(file);
+
+    uint32_t threads = 0;
+    TraceBuffer* first = gBuffers.load(std::memory_order_acquire);
+    for (TraceBuffer* buffer = first; buffer; buffer = buffer->next) {
+        threads++;
+    }
+    ok = ok && WriteValue(file, threads);
+
+    // Only walk the buffers counted above, new threads may have published
+    // buffers in front of |first| in the meantime.
+    std::vector<uint64_t> records;
+    for (TraceBuffer* buffer = first; ok && buffer; buffer = buffer->next) {
+        ok = DumpBuffer(file, buffer, records);
+    }
+
+    return fclose(file) == 0 && ok;
+}
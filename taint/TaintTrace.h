@@ -0,0 +1,88 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/* vim: set ts=8 sts=4 et sw=4 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/* Low overhead binary tracing of taint propagation events. */
+
+#ifndef _TaintTrace_h
+#define _TaintTrace_h
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Taint tracing
+ *
+ * Every thread which records a taint event owns a fixed size ring buffer of
+ * binary trace records. Recording an event only writes to the buffer of the
+ * current thread. Operation names are looked up in a small per-thread cache;
+ * only when a thread sees a name which is not in its cache is a lock taken to
+ * add the name to the shared name table. Once a ring buffer is full the oldest
+ * records are overwritten.
+ *
+ * Each record stores:
+ *
+ *   event      The kind of event, see TaintTraceEvent.
+ *   string     An opaque id of the affected string (usually the address of
+ *              its taint information).
+ *   operation  The id of the operation name, derived from a hash of the name.
+ *              Names whose hashes collide get distinct ids. The names
+ *              themselves are written once into the name table of the trace
+ *              file.
+ *   length     The number of affected characters.
+ *
+ * The buffers of all threads (including threads which already exited) can be
+ * written to a file at any time with TaintTraceDump(). Tracing is enabled by
+ * default and can be switched off at runtime with TaintTraceSetEnabled().
+ *
+ * Trace file format (all integers are little endian, as written by the host):
+ *
+ *   char[4]    magic "TTRC"
+ *   uint32     version
+ *   uint32     number of operation names
+ *   repeated:  uint32 operation id, uint32 name length, name bytes
+ *   uint32     number of threads
+ *   repeated:  uint64 thread id, uint32 number of records,
+ *              records of three uint64 words each:
+ *                  timestamp in nanoseconds
+ *                  string id
+ *                  operation id << 32 | event << 28 | length
+ */
+
+enum class TaintTraceEvent : uint8_t {
+    // Taint was introduced by a taint source.
+    Source = 0,
+    // A tainted string was transformed by an operation.
+    Propagate = 1,
+    // Taint was lost, e.g. because a consumer is not taint aware.
+    Drop = 2,
+    // A tainted string reached a sink.
+    Sink = 3,
+};
+
+namespace taint_trace_detail {
+extern std::atomic<bool> gEnabled;
+void Record(TaintTraceEvent event, const void* string, const char* operation, uint32_t length);
+}
+
+// Records a taint event on the current thread.
+inline void TaintTrace(TaintTraceEvent event, const void* string, const char* operation, uint32_t length)
+{
+    if (taint_trace_detail::gEnabled.load(std::memory_order_relaxed)) {
+        taint_trace_detail::Record(event, string, operation, length);
+    }
+}
+
+// Enables or disables recording of new events.
+void TaintTraceSetEnabled(bool enabled);
+bool TaintTraceIsEnabled();
+
+// Writes the contents of all trace buffers to the file at the given path.
+// Threads keep recording while the buffers are drained; records which are
+// overwritten during the dump are skipped. Returns false if the file could not
+// be written.
+bool TaintTraceDump(const char* path);
+
+#endif
@@ -0,0 +1,119 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include "Taint.h"
+#include "mozilla/dom/TextDecoder.h"
+#include "mozilla/Encoding.h"
+#include "mozilla/ErrorResult.h"
+#include "nsString.h"
+
+using namespace mozilla;
+using namespace mozilla::dom;
+
+static const uint32_t kBenchBytes = 1 << 20;
+
+// Mixed ASCII and multi byte text, roughly the character distribution of a
+// web page in a non latin script.
+static nsCString MakeUtf8(uint32_t aLength) {
+  nsCString utf8;
+  while (utf8.Length() + 4 <= aLength) {
+    utf8.Append("a\xC3\xA4\xE2\x82\xAC");
+    utf8.Append(utf8.Length() % 3 ? "\xF0\x9F\x98\x80" : "bcde");
+  }
+  while (utf8.Length() < aLength) {
+    utf8.Append('x');
+  }
+  return utf8;
+}
+
+static SafeStringTaint MakeByteTaint(uint32_t aLength, uint32_t aRanges) {
+  SafeStringTaint taint;
+  if (!aRanges) {
+    return taint;
+  }
+  TaintFlow flow(TaintOperation("source"));
+  uint32_t step = aLength / aRanges;
+  for (uint32_t i = 0; i < aRanges; i++) {
+    taint.append(TaintRange(i * step, i * step + step / 2, flow));
+  }
+  return taint;
+}
+
+static void Decode(const nsCString& aInput, const StringTaint& aTaint,
+                   nsString& aOutput) {
+  TextDecoder decoder;
+  decoder.InitWithEncoding(WrapNotNull(UTF_8_ENCODING), TextDecoderOptions());
+  ErrorResult rv;
+  decoder.DecodeNative(AsBytes(Span(aInput)), aTaint, false, aOutput, rv);
+  ASSERT_FALSE(rv.Failed());
+}
+
+TEST(TaintEncoding, TaintToUtf8)
+{
+  // "a", "ä" (2 bytes), "€" (3 bytes), U+1F600 (4 bytes, 2 UTF-16 units)
+  const char utf8[] = "a\xC3\xA4\xE2\x82\xAC\xF0\x9F\x98\x80z";
+  TaintFlow flow(TaintOperation("source"));
+
+  SafeStringTaint chars;
+  chars.append(TaintRange(1, 2, flow));
+  chars.append(TaintRange(3, 5, flow));
+  SafeStringTaint bytes = TaintToUtf8(chars, utf8, sizeof(utf8) - 1);
+
+  auto range = bytes.begin();
+  ASSERT_NE(range, bytes.end());
+  ASSERT_EQ(range->begin(), 1u);
+  ASSERT_EQ(range->end(), 3u);
+  ++range;
+  ASSERT_NE(range, bytes.end());
+  ASSERT_EQ(range->begin(), 6u);
+  ASSERT_EQ(range->end(), 10u);
+  ASSERT_EQ(++range, bytes.end());
+}
+
+TEST(TaintEncoding, DecodeTainted)
+{
+  const nsCString input = MakeUtf8(4096);
+  SafeStringTaint taint = MakeByteTaint(input.Length(), 64);
+
+  nsString untainted;
+  Decode(input, EmptyTaint, untainted);
+  ASSERT_FALSE(untainted.isTainted());
+
+  nsString tainted;
+  Decode(input, taint, tainted);
+  ASSERT_TRUE(tainted.Equals(untainted));
+  ASSERT_TRUE(tainted.isTainted());
+
+  // Every character completed by a tainted byte must be tainted. The input
+  // is valid UTF-8, so mapping the output taint back to UTF-8 yields offsets
+  // into the input.
+  SafeStringTaint outputBytes =
+      TaintToUtf8(tainted.Taint(), input.get(), input.Length());
+  for (uint32_t i = 0; i < input.Length(); i++) {
+    bool lastByte = i + 1 == input.Length() ||
+                    (uint8_t(input[i + 1]) & 0xC0) != 0x80;
+    if (lastByte && taint.at(i)) {
+      ASSERT_NE(outputBytes.at(i), nullptr) << "byte " << i;
+    }
+  }
+}
+
+static void DecodeBench(uint32_t aRanges) {
+  const nsCString input = MakeUtf8(kBenchBytes);
+  SafeStringTaint taint = MakeByteTaint(input.Length(), aRanges);
+  for (int i = 0; i < 10; i++) {
+    nsString output;
+    Decode(input, taint, output);
+  }
+}
+
+MOZ_GTEST_BENCH(TextDecoderPerf, Untainted, [] { DecodeBench(0); });
+MOZ_GTEST_BENCH(TextDecoderPerf, Tainted_1, [] { DecodeBench(1); });
+MOZ_GTEST_BENCH(TextDecoderPerf, Tainted_100, [] { DecodeBench(100); });
+MOZ_GTEST_BENCH(TextDecoderPerf, Tainted_10000, [] { DecodeBench(10000); });
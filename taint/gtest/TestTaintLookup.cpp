@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include "Taint.h"
+#include "nsEscape.h"
+#include "nsString.h"
+
+// Builds a string of |aLength| characters which need escaping, tainted with
+// |aRanges| disjoint ranges of alternating flows.
+static SafeStringTaint MakeTaint(uint32_t aLength, uint32_t aRanges) {
+  SafeStringTaint taint;
+  TaintFlow first(TaintOperation("first"));
+  TaintFlow second(TaintOperation("second"));
+  uint32_t step = aLength / aRanges;
+  for (uint32_t i = 0; i < aRanges; i++) {
+    uint32_t begin = i * step;
+    uint32_t end = begin + std::max(step / 2, 1u);
+    taint.append(TaintRange(begin, end, i % 2 ? second : first));
+  }
+  return taint;
+}
+
+TEST(Taint, AtAdjacentRanges)
+{
+  TaintFlow first(TaintOperation("first"));
+  TaintFlow second(TaintOperation("second"));
+  SafeStringTaint taint;
+  taint.append(TaintRange(0, 5, first));
+  taint.append(TaintRange(5, 10, second));
+  taint.append(TaintRange(12, 14, first));
+
+  for (uint32_t i = 0; i < 16; i++) {
+    const TaintFlow* expected =
+        i < 5 ? &first : (i < 10 ? &second : (i >= 12 && i < 14 ? &first : nullptr));
+    const TaintFlow* actual = taint.at(i);
+    if (!expected) {
+      ASSERT_EQ(actual, nullptr);
+    } else {
+      ASSERT_NE(actual, nullptr);
+      ASSERT_EQ(*actual, *expected);
+    }
+  }
+}
+
+TEST(Taint, CursorMatchesAt)
+{
+  SafeStringTaint taint = MakeTaint(4096, 300);
+  StringTaint::Cursor cursor = taint.cursor();
+
+  for (uint32_t i = 0; i < 4200; i++) {
+    ASSERT_EQ(cursor.at(i), taint.at(i));
+  }
+  // Moving backwards falls back to a binary search.
+  for (uint32_t i = 4200; i-- > 0;) {
+    ASSERT_EQ(cursor.at(i), taint.at(i));
+  }
+  for (uint32_t i = 0; i < 4200; i += 37) {
+    ASSERT_EQ(cursor.at(i), taint.at(i));
+  }
+}
+
+TEST(Taint, SubTaint)
+{
+  SafeStringTaint taint = MakeTaint(1000, 100);
+
+  for (uint32_t begin = 0; begin < 1000; begin += 7) {
+    for (uint32_t end = begin; end < 1000; end += 113) {
+      SafeStringTaint sub = taint.safeSubTaint(begin, end);
+      for (uint32_t i = 0; i < end - begin; i++) {
+        const TaintFlow* expected = taint.at(begin + i);
+        const TaintFlow* actual = sub.at(i);
+        ASSERT_EQ(!!actual, !!expected);
+        if (actual) {
+          ASSERT_EQ(*actual, *expected);
+        }
+      }
+      for (auto& range : sub) {
+        ASSERT_LE(range.end(), end - begin);
+      }
+    }
+  }
+}
+
+static const uint32_t kBenchLength = 100000;
+
+static void BenchEscape(uint32_t aRanges) {
+  nsAutoCString input;
+  for (uint32_t i = 0; i < kBenchLength; i++) {
+    input.Append(i % 4 ? ' ' : 'a');
+  }
+  SafeStringTaint taint = MakeTaint(kBenchLength, aRanges);
+
+  for (int i = 0; i < 10; i++) {
+    nsAutoCString result;
+    NS_EscapeURL(input.BeginReading(), input.Length(), taint, esc_Query,
+                 result);
+    ASSERT_TRUE(result.IsTainted());
+  }
+}
+
+static void BenchSlice(uint32_t aRanges) {
+  SafeStringTaint taint = MakeTaint(kBenchLength, aRanges);
+
+  uint32_t tainted = 0;
+  for (uint32_t begin = 0; begin < kBenchLength; begin += 97) {
+    SafeStringTaint sub = taint.safeSubTaint(begin, begin + 64);
+    tainted += sub.hasTaint();
+  }
+  ASSERT_GT(tainted, 0u);
+}
+
+MOZ_GTEST_BENCH(TaintLookupPerf, Escape_1, [] { BenchEscape(1); });
+MOZ_GTEST_BENCH(TaintLookupPerf, Escape_100, [] { BenchEscape(100); });
+MOZ_GTEST_BENCH(TaintLookupPerf, Escape_10000, [] { BenchEscape(10000); });
+MOZ_GTEST_BENCH(TaintLookupPerf, Slice_1, [] { BenchSlice(1); });
+MOZ_GTEST_BENCH(TaintLookupPerf, Slice_100, [] { BenchSlice(100); });
+MOZ_GTEST_BENCH(TaintLookupPerf, Slice_10000, [] { BenchSlice(10000); });
@@ -0,0 +1,64 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <stdio.h>
+
+#include <map>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "TaintTrace.h"
+
+// Reads the name table of a trace file.
+static bool ReadNames(const char* aPath,
+                      std::map<std::string, uint32_t>& aIds) {
+  FILE* file = fopen(aPath, "rb");
+  if (!file) {
+    return false;
+  }
+
+  char magic[4];
+  uint32_t version, count;
+  bool ok = fread(magic, 1, 4, file) == 4 &&
+            fread(&version, sizeof(version), 1, file) == 1 &&
+            fread(&count, sizeof(count), 1, file) == 1;
+  for (uint32_t i = 0; ok && i < count; i++) {
+    uint32_t id, length;
+    ok = fread(&id, sizeof(id), 1, file) == 1 &&
+         fread(&length, sizeof(length), 1, file) == 1;
+    std::string name(ok ? length : 0, '\0');
+    ok = ok && fread(&name[0], 1, length, file) == length;
+    if (ok) {
+      aIds[name] = id;
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+// "op444488" and "op2301642" have the same FNV-1a hash, but must not share
+// an id in the trace.
+TEST(TaintTrace, HashCollision)
+{
+  bool enabled = TaintTraceIsEnabled();
+  TaintTraceSetEnabled(true);
+  TaintTrace(TaintTraceEvent::Propagate, nullptr, "op444488", 1);
+  TaintTrace(TaintTraceEvent::Propagate, nullptr, "op2301642", 2);
+  TaintTrace(TaintTraceEvent::Propagate, nullptr, "op444488", 3);
+  TaintTraceSetEnabled(enabled);
+
+  std::string path = testing::TempDir() + "taint-trace-collision.trace";
+  ASSERT_TRUE(TaintTraceDump(path.c_str()));
+
+  std::map<std::string, uint32_t> ids;
+  ASSERT_TRUE(ReadNames(path.c_str(), ids));
+  remove(path.c_str());
+
+  ASSERT_EQ(ids.count("op444488"), 1u);
+  ASSERT_EQ(ids.count("op2301642"), 1u);
+  ASSERT_NE(ids["op444488"], ids["op2301642"]);
+}
@@ -11,6 +11,7 @@
 
 #include "mozilla/Attributes.h"
 #include "mozilla/MemoryReporting.h"
+#include "mozilla/TimeStamp.h"
 #include "mozilla/dom/AtomList.h"
 #include "mozilla/dom/Promise.h"
 #include "js/GCVector.h"
@@ -54,6 +55,8 @@ struct CycleCollectorResults {
     mFreedRefCounted = 0;
     mFreedGCed = 0;
     mFreedJSZones = 0;
+    mScanRootsTime = TimeDuration();
+    mScanThreads = 0;
     mNumSlices = 1;
     // mNumSlices is initialized to one, because we call Init() after the
     // per-slice increment of mNumSlices has already occurred.
@@ -69,6 +72,9 @@ struct CycleCollectorResults {
   uint32_t mFreedRefCounted;
   uint32_t mFreedGCed;
   uint32_t mFreedJSZones;
+  // Time spent in ScanRoots, and the number of threads which took part in it.
+  TimeDuration mScanRootsTime;
+  uint32_t mScanThreads;
   uint32_t mNumSlices;
 };
 
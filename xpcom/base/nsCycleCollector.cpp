@@ -163,6 +163,8 @@
 #include "mozilla/HashTable.h"
 #include "mozilla/HoldDropJSObjects.h"
 /* This must occur *after* base/process_util.h to avoid typedefs conflicts. */
+#include <algorithm>
+#include <atomic>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -175,6 +177,7 @@
 #include "mozilla/LinkedList.h"
 #include "mozilla/MemoryReporting.h"
 #include "mozilla/MruCache.h"
+#include "mozilla/ParallelFor.h"
 #include "mozilla/PoisonIOInterposer.h"
 #include "mozilla/ProfilerLabels.h"
 #include "mozilla/SegmentedVector.h"
@@ -197,6 +200,7 @@
 #include "nsThreadUtils.h"
 #include "nsXULAppAPI.h"
 #include "prenv.h"
+#include "prsystem.h"
 #include "xpcpublic.h"
 
 using namespace mozilla;
@@ -277,12 +281,18 @@ struct nsCycleCollectorParams {
   bool mAllTracesAll;
   bool mAllTracesShutdown;
   bool mLogThisThread;
+  // Number of helper threads ScanRoots may use in addition to the collecting
+  // thread. Zero scans on the collecting thread only.
+  uint32_t mScanHelperThreads;
+
+  static const uint32_t kMaxDefaultScanHelperThreads = 3;
 
   nsCycleCollectorParams()
       : mLogAll(PR_GetEnv("MOZ_CC_LOG_ALL") != nullptr),
         mLogShutdown(PR_GetEnv("MOZ_CC_LOG_SHUTDOWN") != nullptr),
         mAllTracesAll(false),
-        mAllTracesShutdown(false) {
+        mAllTracesShutdown(false),
+        mScanHelperThreads(0) {
     const char* logThreadEnv = PR_GetEnv("MOZ_CC_LOG_THREAD");
     bool threadLogging = true;
     if (logThreadEnv && !!strcmp(logThreadEnv, "all")) {
@@ -318,6 +328,17 @@ struct nsCycleCollectorParams {
         mAllTracesShutdown = true;
       }
     }
+
+    const char* scanThreadsEnv = PR_GetEnv("MOZ_CC_SCAN_THREADS");
+    if (scanThreadsEnv) {
+      mScanHelperThreads = std::max(atoi(scanThreadsEnv), 0);
+    } else {
+      int32_t processors = PR_GetNumberOfProcessors();
+      if (processors > 1) {
+        mScanHelperThreads = std::min(uint32_t(processors - 1),
+                                      kMaxDefaultScanHelperThreads);
+      }
+    }
   }
 
   bool LogThisCC(bool aIsShutdown) {
@@ -527,8 +548,18 @@ class PtrInfo final {
   // mParticipant knows a more concrete type.
   void* mPointer;
   nsCycleCollectionParticipant* mParticipant;
-  uint32_t mColor : 2;
-  uint32_t mInternalRefs : 30;
+
+ private:
+  // The color in the low two bits and the number of internal references in
+  // the rest. This is atomic so that helper threads can color nodes in
+  // parallel during ScanRoots. Everything else uses relaxed loads and stores,
+  // which compile to plain memory accesses.
+  std::atomic<uint32_t> mColorAndInternalRefs;
+
+  static const uint32_t kColorBits = 2;
+  static const uint32_t kColorMask = (1 << kColorBits) - 1;
+
+ public:
   uint32_t mRefCount;
 
  private:
@@ -540,8 +571,7 @@ class PtrInfo final {
   PtrInfo(void* aPointer, nsCycleCollectionParticipant* aParticipant)
       : mPointer(aPointer),
         mParticipant(aParticipant),
-        mColor(grey),
-        mInternalRefs(0),
+        mColorAndInternalRefs(grey),
         mRefCount(kInitialRefCount),
         mFirstChild() {
     MOZ_ASSERT(aParticipant);
@@ -556,12 +586,47 @@ class PtrInfo final {
   PtrInfo()
       : mPointer{nullptr},
         mParticipant{nullptr},
-        mColor{0},
-        mInternalRefs{0},
+        mColorAndInternalRefs{0},
         mRefCount{0} {
     MOZ_ASSERT_UNREACHABLE("should never be called");
   }
 
+  NodeColor Color() const {
+    return NodeColor(mColorAndInternalRefs.load(std::memory_order_relaxed) &
+                     kColorMask);
+  }
+
+  void SetColor(NodeColor aColor) {
+    uint32_t bits = mColorAndInternalRefs.load(std::memory_order_relaxed);
+    mColorAndInternalRefs.store((bits & ~kColorMask) | aColor,
+                                std::memory_order_relaxed);
+  }
+
+  // Marks this node black. Safe to call from several threads at once. Returns
+  // false if the node was black already, otherwise sets *aOldColor to the
+  // color it had.
+  bool MarkBlackAtomically(NodeColor* aOldColor) {
+    uint32_t bits = mColorAndInternalRefs.load(std::memory_order_relaxed);
+    do {
+      if ((bits & kColorMask) == black) {
+        return false;
+      }
+    } while (!mColorAndInternalRefs.compare_exchange_weak(
+        bits, (bits & ~kColorMask) | black, std::memory_order_relaxed));
+    *aOldColor = NodeColor(bits & kColorMask);
+    return true;
+  }
+
+  uint32_t InternalRefs() const {
+    return mColorAndInternalRefs.load(std::memory_order_relaxed) >> kColorBits;
+  }
+
+  void AddInternalRef() {
+    uint32_t bits = mColorAndInternalRefs.load(std::memory_order_relaxed);
+    mColorAndInternalRefs.store(bits + (1 << kColorBits),
+                                std::memory_order_relaxed);
+  }
+
   bool IsGrayJS() const { return mRefCount == 0; }
 
   bool IsBlackJS() const { return mRefCount == UINT32_MAX; }
@@ -729,6 +794,20 @@ class NodePool {
     PtrInfo*& mLast;
   };
 
+  // The nodes of one block, which can be scanned independently of the other
+  // blocks once the graph is built.
+  struct Range {
+    PtrInfo* mBegin;
+    PtrInfo* mEnd;
+  };
+
+  void GetRanges(nsTArray<Range>& aRanges) const {
+    for (NodeBlock* b = mBlocks; b; b = b->mNext) {
+      PtrInfo* end = b->mNext ? b->mEntries + NodeBlockSize : mLast;
+      aRanges.AppendElement(Range{b->mEntries, end});
+    }
+  }
+
   size_t SizeOfExcludingThis(MallocSizeOf aMallocSizeOf) const {
     // We don't measure the things pointed to by mEntries[] because those
     // pointers are non-owning.
@@ -1150,6 +1229,7 @@ class nsCycleCollector : public nsIMemoryReporter {
                nsCycleCollectingAutoRefCnt* aRefCnt);
   void SuspectNurseryEntries();
   uint32_t SuspectedCount();
+  uint32_t LastScanThreads() const { return mResults.mScanThreads; }
   void ForgetSkippable(js::SliceBudget& aBudget, bool aRemoveChildlessNodes,
                        bool aAsyncSnowWhiteFreeing);
   bool FreeSnowWhite(bool aUntilNoSWInPurpleBuffer);
@@ -1192,8 +1272,11 @@ class nsCycleCollector : public nsIMemoryReporter {
   void MarkRoots(SliceBudget& aBudget);
   void ScanRoots(bool aFullySynchGraphBuild);
   void ScanIncrementalRoots();
-  void ScanWhiteNodes(bool aFullySynchGraphBuild);
-  void ScanBlackNodes();
+  void ScanWhiteNodes(bool aFullySynchGraphBuild,
+                      const nsTArray<NodePool::Range>& aRanges,
+                      uint32_t aHelperThreads);
+  void ScanBlackNodes(const nsTArray<NodePool::Range>& aRanges,
+                      uint32_t aHelperThreads);
   void ScanWeakMaps();
 
   // returns whether anything was collected
@@ -1926,7 +2009,7 @@ class CCGraphBuilder final : public nsCycleCollectionTraversalCallback,
     if (mLogger) {
       mLogger->NoteEdge((uint64_t)aChild, aEdgeName.get());
     }
-    ++childPi->mInternalRefs;
+    childPi->AddInternalRef();
   }
 
   JS::Zone* MergeZone(JS::GCCellPtr aGcthing) {
@@ -2702,13 +2785,13 @@ struct ScanBlackVisitor {
   ScanBlackVisitor(uint32_t& aWhiteNodeCount, bool& aFailed)
       : mWhiteNodeCount(aWhiteNodeCount), mFailed(aFailed) {}
 
-  bool ShouldVisitNode(PtrInfo const* aPi) { return aPi->mColor != black; }
+  bool ShouldVisitNode(PtrInfo const* aPi) { return aPi->Color() != black; }
 
   MOZ_NEVER_INLINE void VisitNode(PtrInfo* aPi) {
-    if (aPi->mColor == white) {
+    if (aPi->Color() == white) {
       --mWhiteNodeCount;
     }
-    aPi->mColor = black;
+    aPi->SetColor(black);
   }
 
   void Failed() { mFailed = true; }
@@ -2722,7 +2805,7 @@ static void FloodBlackNode(uint32_t& aWhiteNodeCount, bool& aFailed,
                            PtrInfo* aPi) {
   GraphWalker<ScanBlackVisitor>(ScanBlackVisitor(aWhiteNodeCount, aFailed))
       .Walk(aPi);
-  MOZ_ASSERT(aPi->mColor == black || !aPi->WasTraversed(),
+  MOZ_ASSERT(aPi->Color() == black || !aPi->WasTraversed(),
              "FloodBlackNode should make aPi black");
 }
 
@@ -2737,10 +2820,10 @@ void nsCycleCollector::ScanWeakMaps() {
       WeakMapping* wm = &mGraph.mWeakMaps[i];
 
       // If any of these are null, the original object was marked black.
-      uint32_t mColor = wm->mMap ? wm->mMap->mColor : black;
-      uint32_t kColor = wm->mKey ? wm->mKey->mColor : black;
-      uint32_t kdColor = wm->mKeyDelegate ? wm->mKeyDelegate->mColor : black;
-      uint32_t vColor = wm->mVal ? wm->mVal->mColor : black;
+      uint32_t mColor = wm->mMap ? wm->mMap->Color() : black;
+      uint32_t kColor = wm->mKey ? wm->mKey->Color() : black;
+      uint32_t kdColor = wm->mKeyDelegate ? wm->mKeyDelegate->Color() : black;
+      uint32_t vColor = wm->mVal ? wm->mVal->Color() : black;
 
       MOZ_ASSERT(mColor != grey, "Uncolored weak map");
       MOZ_ASSERT(kColor != grey, "Uncolored weak map key");
@@ -2794,7 +2877,7 @@ class PurpleScanBlackVisitor {
     if (MOZ_UNLIKELY(mLogger)) {
       mLogger->NoteIncrementalRoot((uint64_t)pi->mPointer);
     }
-    if (pi->mColor == black) {
+    if (pi->Color() == black) {
       return true;
     }
     FloodBlackNode(mCount, mFailed, pi);
@@ -2843,7 +2926,7 @@ void nsCycleCollector::ScanIncrementalRoots() {
     // As an optimization, if an object has already been determined to be live,
     // don't consider it further.  We can't do this if there is a listener,
     // because the listener wants to know the complete set of incremental roots.
-    if (pi->mColor == black && MOZ_LIKELY(!hasLogger)) {
+    if (pi->Color() == black && MOZ_LIKELY(!hasLogger)) {
       continue;
     }
 
@@ -2904,22 +2987,73 @@ void nsCycleCollector::ScanIncrementalRoots() {
   }
 }
 
+////////////////////////////////////////////////////////////////////////
+// Scanning the graph on helper threads.
+//
+// Once the graph is built, ScanWhiteNodes and ScanBlackNodes only read and
+// color PtrInfos, so the node blocks can be split up between threads with
+// ParallelFor. Building the graph stays on the collecting thread, since it
+// calls into participants which are not thread safe.
+////////////////////////////////////////////////////////////////////////
+
+struct GraphScanResult {
+  uint32_t mNewWhiteNodes = 0;
+  uint32_t mWhiteNodesMarkedBlack = 0;
+  bool mSawBlackNodes = false;
+  bool mFailed = false;
+  // The number of threads which took part in the scan.
+  uint32_t mThreads = 0;
+
+  void Add(const GraphScanResult& aOther) {
+    mNewWhiteNodes += aOther.mNewWhiteNodes;
+    mWhiteNodesMarkedBlack += aOther.mWhiteNodesMarkedBlack;
+    mSawBlackNodes |= aOther.mSawBlackNodes;
+    mFailed |= aOther.mFailed;
+  }
+};
+
+// About 16k nodes.
+static const uint32_t kMinBlocksForParallelScan = 4;
+
+using ScanRangeFunc = void (*)(const NodePool::Range& aRange,
+                               GraphScanResult& aResult);
+
+// Calls aScanRange for each of aRanges, on the calling thread and on up to
+// aHelperThreads background threads, and returns the combined results.
+static GraphScanResult ParallelGraphScan(
+    const nsTArray<NodePool::Range>& aRanges, ScanRangeFunc aScanRange,
+    uint32_t aHelperThreads) {
+  nsTArray<GraphScanResult> threadResults;
+  threadResults.SetLength(aHelperThreads + 1);
+  uint32_t threads = ParallelFor(aRanges.Length(), aHelperThreads,
+                                 [&](uint32_t aRange, uint32_t aThread) {
+                                   aScanRange(aRanges[aRange],
+                                              threadResults[aThread]);
+                                   return true;
+                                 });
+
+  GraphScanResult result;
+  for (const GraphScanResult& threadResult : threadResults) {
+    result.Add(threadResult);
+  }
+  result.mThreads = threads;
+  return result;
+}
+
 // Mark nodes white and make sure their refcounts are ok.
 // No nodes are marked black during this pass to ensure that refcount
 // checking is run on all nodes not marked black by ScanIncrementalRoots.
-void nsCycleCollector::ScanWhiteNodes(bool aFullySynchGraphBuild) {
-  NodePool::Enumerator nodeEnum(mGraph.mNodes);
-  while (!nodeEnum.IsDone()) {
-    PtrInfo* pi = nodeEnum.GetNext();
-    if (pi->mColor == black) {
+static void ScanWhiteNodeRange(const NodePool::Range& aRange,
+                               GraphScanResult& aResult) {
+  for (PtrInfo* pi = aRange.mBegin; pi != aRange.mEnd; ++pi) {
+    if (pi->Color() == black) {
       // Incremental roots can be in a nonsensical state, so don't
       // check them. This will miss checking nodes that are merely
       // reachable from incremental roots.
-      MOZ_ASSERT(!aFullySynchGraphBuild,
-                 "In a synch CC, no nodes should be marked black early on.");
+      aResult.mSawBlackNodes = true;
       continue;
     }
-    MOZ_ASSERT(pi->mColor == grey);
+    MOZ_ASSERT(pi->Color() == grey);
 
     if (!pi->WasTraversed()) {
       // This node was deleted before it was traversed, so there's no reason
@@ -2929,31 +3063,87 @@ void nsCycleCollector::ScanWhiteNodes(bool aFullySynchGraphBuild) {
       continue;
     }
 
-    if (pi->mInternalRefs == pi->mRefCount || pi->IsGrayJS()) {
-      pi->mColor = white;
-      ++mWhiteNodeCount;
+    if (pi->InternalRefs() == pi->mRefCount || pi->IsGrayJS()) {
+      pi->SetColor(white);
+      ++aResult.mNewWhiteNodes;
       continue;
     }
 
     pi->AnnotatedReleaseAssert(
-        pi->mInternalRefs <= pi->mRefCount,
+        pi->InternalRefs() <= pi->mRefCount,
         "More references to an object than its refcount");
 
     // This node will get marked black in the next pass.
   }
 }
 
+void nsCycleCollector::ScanWhiteNodes(bool aFullySynchGraphBuild,
+                                      const nsTArray<NodePool::Range>& aRanges,
+                                      uint32_t aHelperThreads) {
+  GraphScanResult result =
+      ParallelGraphScan(aRanges, ScanWhiteNodeRange, aHelperThreads);
+  MOZ_ASSERT(!aFullySynchGraphBuild || !result.mSawBlackNodes,
+             "In a synch CC, no nodes should be marked black early on.");
+  mWhiteNodeCount += result.mNewWhiteNodes;
+  mResults.mScanThreads = std::max(mResults.mScanThreads, result.mThreads);
+}
+
+// Like ScanBlackVisitor, but several threads may flood the same nodes at
+// once. Whichever thread turns a node black visits its children.
+struct ParallelScanBlackVisitor {
+  explicit ParallelScanBlackVisitor(GraphScanResult& aResult)
+      : mResult(aResult) {}
+
+  bool ShouldVisitNode(PtrInfo* aPi) {
+    NodeColor oldColor;
+    if (!aPi->MarkBlackAtomically(&oldColor)) {
+      return false;
+    }
+    if (oldColor == white) {
+      ++mResult.mWhiteNodesMarkedBlack;
+    }
+    return true;
+  }
+
+  void VisitNode(PtrInfo* aPi) {}
+
+  void Failed() { mResult.mFailed = true; }
+
+ private:
+  GraphScanResult& mResult;
+};
+
+static void ScanBlackNodeRange(const NodePool::Range& aRange,
+                               GraphScanResult& aResult) {
+  for (PtrInfo* pi = aRange.mBegin; pi != aRange.mEnd; ++pi) {
+    if (pi->Color() == grey && pi->WasTraversed()) {
+      GraphWalker<ParallelScanBlackVisitor>(ParallelScanBlackVisitor(aResult))
+          .Walk(pi);
+    }
+  }
+}
+
 // Any remaining grey nodes that haven't already been deleted must be alive,
 // so mark them and their children black. Any nodes that are black must have
 // already had their children marked black, so there's no need to look at them
 // again. This pass may turn some white nodes to black.
-void nsCycleCollector::ScanBlackNodes() {
+void nsCycleCollector::ScanBlackNodes(const nsTArray<NodePool::Range>& aRanges,
+                                      uint32_t aHelperThreads) {
   bool failed = false;
-  NodePool::Enumerator nodeEnum(mGraph.mNodes);
-  while (!nodeEnum.IsDone()) {
-    PtrInfo* pi = nodeEnum.GetNext();
-    if (pi->mColor == grey && pi->WasTraversed()) {
-      FloodBlackNode(mWhiteNodeCount, failed, pi);
+  if (aHelperThreads) {
+    GraphScanResult result =
+        ParallelGraphScan(aRanges, ScanBlackNodeRange, aHelperThreads);
+    mWhiteNodeCount -= result.mWhiteNodesMarkedBlack;
+    mResults.mScanThreads = std::max(mResults.mScanThreads, result.mThreads);
+    failed = result.mFailed;
+  } else {
+    // Without helpers, avoid the atomic read-modify-writes.
+    for (const NodePool::Range& range : aRanges) {
+      for (PtrInfo* pi = range.mBegin; pi != range.mEnd; ++pi) {
+        if (pi->Color() == grey && pi->WasTraversed()) {
+          FloodBlackNode(mWhiteNodeCount, failed, pi);
+        }
+      }
     }
   }
 
@@ -2973,20 +3163,33 @@ void nsCycleCollector::ScanRoots(bool aFullySynchGraphBuild) {
 
   JS::AutoEnterCycleCollection autocc(Runtime()->Runtime());
 
+  TimeStamp scanStart = TimeStamp::Now();
   if (!aFullySynchGraphBuild) {
     ScanIncrementalRoots();
   }
 
   TimeLog timeLog;
-  ScanWhiteNodes(aFullySynchGraphBuild);
+
+  // Only split up graphs which are large enough to make up for waking up
+  // the helper threads.
+  nsTArray<NodePool::Range> ranges;
+  mGraph.mNodes.GetRanges(ranges);
+  uint32_t helperThreads = 0;
+  if (ranges.Length() >= kMinBlocksForParallelScan && NS_IsMainThread()) {
+    helperThreads =
+        std::min<uint32_t>(mParams.mScanHelperThreads, ranges.Length() - 1);
+  }
+
+  ScanWhiteNodes(aFullySynchGraphBuild, ranges, helperThreads);
   timeLog.Checkpoint("ScanRoots::ScanWhiteNodes");
 
-  ScanBlackNodes();
+  ScanBlackNodes(ranges, helperThreads);
   timeLog.Checkpoint("ScanRoots::ScanBlackNodes");
 
   // Scanning weak maps must be done last.
   ScanWeakMaps();
   timeLog.Checkpoint("ScanRoots::ScanWeakMaps");
+  mResults.mScanRootsTime = TimeStamp::Now() - scanStart;
 
   if (mLogger) {
     mLogger->BeginResults();
@@ -2997,11 +3200,11 @@ void nsCycleCollector::ScanRoots(bool aFullySynchGraphBuild) {
       if (!pi->WasTraversed()) {
         continue;
       }
-      switch (pi->mColor) {
+      switch (pi->Color()) {
         case black:
           if (!pi->IsGrayJS() && !pi->IsBlackJS() &&
-              pi->mInternalRefs != pi->mRefCount) {
-            mLogger->DescribeRoot((uint64_t)pi->mPointer, pi->mInternalRefs);
+              pi->InternalRefs() != pi->mRefCount) {
+            mLogger->DescribeRoot((uint64_t)pi->mPointer, pi->InternalRefs());
           }
           break;
         case white:
@@ -3059,7 +3262,7 @@ bool nsCycleCollector::CollectWhite() {
     NodePool::Enumerator etor(mGraph.mNodes);
     while (!etor.IsDone()) {
       PtrInfo* pinfo = etor.GetNext();
-      if (pinfo->mColor == white && pinfo->mParticipant) {
+      if (pinfo->Color() == white && pinfo->mParticipant) {
         if (pinfo->IsGrayJS()) {
           MOZ_ASSERT(mCCJSRuntime);
           ++numWhiteGCed;
@@ -3840,6 +4043,17 @@ uint32_t nsCycleCollector_suspectedCount() {
   return data->mCollector->SuspectedCount();
 }
 
+uint32_t nsCycleCollector_lastScanThreads() {
+  CollectorData* data = sCollectorData.get();
+  MOZ_ASSERT(data);
+
+  if (!data->mCollector) {
+    return 0;
+  }
+
+  return data->mCollector->LastScanThreads();
+}
+
 bool nsCycleCollector_init() {
 #ifdef DEBUG
   static bool sInitialized;
@@ -62,6 +62,10 @@ void nsCycleCollector_collectSlice(js::SliceBudget& budget,
 
 uint32_t nsCycleCollector_suspectedCount();
 
+// The number of threads which scanned the graph in the last collection on
+// this thread. Used by tests.
+uint32_t nsCycleCollector_lastScanThreads();
+
 // If aDoCollect is true, then run the GC and CC a few times before
 // shutting down the CC completely.
 MOZ_CAN_RUN_SCRIPT
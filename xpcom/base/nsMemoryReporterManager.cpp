@@ -1330,6 +1330,14 @@ class JemallocHeapReporter final : public nsIMemoryReporter {
     MOZ_COLLECT_REPORT(
       "heap-chunksize", KIND_OTHER, UNITS_BYTES, stats.chunksize,
       "Size of chunks.");
+
+    if (stats.thp_advised > 0) {
+      MOZ_COLLECT_REPORT(
+        "heap-thp-advised", KIND_OTHER, UNITS_BYTES, stats.thp_advised,
+"Bytes of huge allocations which the heap allocator advised the kernel to "
+"back with transparent huge pages (MALLOC_OPTIONS=H). How much of this is "
+"actually backed by huge pages is shown by AnonHugePages in /proc/self/smaps.");
+    }
     // clang-format on
 
     return NS_OK;
@@ -370,6 +370,9 @@ static nsresult T_EscapeURL(const typename T::char_type* aPart, size_t aPartLen,
 
   typename T::char_type tempBuffer[100];
   StringTaint tempTaint;
+  // Taintfox: characters are visited in order, so use a cursor to avoid a
+  // range lookup per escaped character.
+  StringTaint::Cursor taintCursor = aTaint.cursor();
   unsigned int tempBufferPos = 0;
 
   bool previousIsNonASCII = false;
@@ -429,8 +432,8 @@ static nsresult T_EscapeURL(const typename T::char_type* aPart, size_t aPartLen,
       }
       uint32_t len = ::AppendPercentHex(tempBuffer + tempBufferPos, c);
       // Taintfox: propagate taint
-      if (aTaint.at(i)) {
-        tempTaint.append(TaintRange(tempBufferPos, tempBufferPos + len, *aTaint.at(i)));
+      if (const TaintFlow* flow = taintCursor.at(i)) {
+        tempTaint.append(TaintRange(tempBufferPos, tempBufferPos + len, *flow));
       }
       tempBufferPos += len;
       MOZ_ASSERT(len <= ENCODE_MAX_LEN, "potential buffer overflow");
@@ -455,6 +458,7 @@ static nsresult T_EscapeURL(const typename T::char_type* aPart, size_t aPartLen,
   if (writing) {
     // Taintfox: append the taint (before actually appending the string)
     aResult.Taint().concat(tempTaint, aResult.Length());
+    tempTaint.clear();
 
     if (!aResult.Append(tempBuffer, tempBufferPos, mozilla::fallible)) {
       return NS_ERROR_OUT_OF_MEMORY;
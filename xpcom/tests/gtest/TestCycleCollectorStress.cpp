@@ -0,0 +1,136 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include <vector>
+
+#include "nsCycleCollectionParticipant.h"
+#include "nsCycleCollector.h"
+#include "nsTArray.h"
+#include "prenv.h"
+#include "prsystem.h"
+
+using namespace mozilla;
+
+// Collects a graph large enough for ScanRoots to be split up between helper
+// threads, and checks that exactly the unreachable objects are freed.
+
+class StressNode final : public nsISupports {
+ public:
+  NS_DECL_CYCLE_COLLECTING_ISUPPORTS
+  NS_DECL_CYCLE_COLLECTION_CLASS(StressNode)
+
+  StressNode() { ++sLiveNodes; }
+
+  nsTArray<RefPtr<StressNode>> mEdges;
+
+  static uint32_t sLiveNodes;
+
+ private:
+  ~StressNode() { --sLiveNodes; }
+};
+
+uint32_t StressNode::sLiveNodes = 0;
+
+NS_IMPL_CYCLE_COLLECTION(StressNode, mEdges)
+
+NS_IMPL_CYCLE_COLLECTING_ADDREF(StressNode)
+NS_IMPL_CYCLE_COLLECTING_RELEASE(StressNode)
+
+NS_INTERFACE_MAP_BEGIN_CYCLE_COLLECTION(StressNode)
+  NS_INTERFACE_MAP_ENTRY(nsISupports)
+NS_INTERFACE_MAP_END
+
+static void CollectAndFree() {
+  nsCycleCollector_collect(CCReason::API, nullptr);
+  while (nsCycleCollector_doDeferredDeletion()) {
+  }
+}
+
+// Builds aRings rings of aRingLength nodes. Every third ring is held alive
+// from outside, and each ring points into one other ring, so some of the
+// otherwise dead rings are kept alive too.
+static void CollectRings(uint32_t aRings, uint32_t aRingLength) {
+  CollectAndFree();
+  ASSERT_EQ(StressNode::sLiveNodes, 0u);
+
+  auto nextRing = [aRings](uint32_t aRing) {
+    return uint32_t((uint64_t(aRing) * 7919 + 1) % aRings);
+  };
+
+  nsTArray<RefPtr<StressNode>> roots;
+  std::vector<bool> reachable(aRings, false);
+  {
+    nsTArray<RefPtr<StressNode>> heads;
+    nsTArray<StressNode*> tails;
+    for (uint32_t ring = 0; ring < aRings; ring++) {
+      RefPtr<StressNode> head = new StressNode();
+      StressNode* prev = head;
+      for (uint32_t i = 1; i < aRingLength; i++) {
+        RefPtr<StressNode> node = new StressNode();
+        prev->mEdges.AppendElement(node);
+        prev = node;
+      }
+      prev->mEdges.AppendElement(head);
+      heads.AppendElement(head);
+      tails.AppendElement(prev);
+    }
+
+    for (uint32_t ring = 0; ring < aRings; ring++) {
+      tails[ring]->mEdges.AppendElement(heads[nextRing(ring)]);
+      if (ring % 3 == 0) {
+        roots.AppendElement(heads[ring]);
+      }
+    }
+  }
+
+  // What ScanRoots has to come up with.
+  std::vector<uint32_t> stack;
+  for (uint32_t ring = 0; ring < aRings; ring += 3) {
+    stack.push_back(ring);
+  }
+  uint32_t reachableRings = 0;
+  while (!stack.empty()) {
+    uint32_t ring = stack.back();
+    stack.pop_back();
+    if (reachable[ring]) {
+      continue;
+    }
+    reachable[ring] = true;
+    reachableRings++;
+    stack.push_back(nextRing(ring));
+  }
+
+  CollectAndFree();
+  ASSERT_EQ(StressNode::sLiveNodes, reachableRings * aRingLength);
+
+  roots.Clear();
+  CollectAndFree();
+  ASSERT_EQ(StressNode::sLiveNodes, 0u);
+}
+
+TEST(CycleCollectorStress, SmallGraph)
+{ CollectRings(300, 5); }
+
+TEST(CycleCollectorStress, LargeGraph)
+{
+  CollectRings(20000, 10);
+  // The graph is large enough to be split up, so helpers took part unless
+  // there is only one processor. MOZ_CC_SCAN_THREADS=0 also turns them off.
+  if (PR_GetNumberOfProcessors() > 1 && !PR_GetEnv("MOZ_CC_SCAN_THREADS")) {
+    ASSERT_GT(nsCycleCollector_lastScanThreads(), 1u);
+  }
+}
+
+TEST(CycleCollectorStress, LongRings)
+{ CollectRings(50, 4000); }
+
+MOZ_GTEST_BENCH(CycleCollectorStress, Collect200k,
+                [] { CollectRings(20000, 10); });
+MOZ_GTEST_BENCH(CycleCollectorStress, Collect1M,
+                [] { CollectRings(100000, 10); });
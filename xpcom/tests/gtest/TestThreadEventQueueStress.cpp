@@ -0,0 +1,133 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "gtest/gtest.h"
+#include "gtest/MozGTestBench.h"
+
+#include <atomic>
+#include <vector>
+
+#include "mozilla/Monitor.h"
+#include "nsCOMPtr.h"
+#include "nsIThread.h"
+#include "nsTArray.h"
+#include "nsThreadUtils.h"
+
+using namespace mozilla;
+
+// Many threads dispatching small runnables to one worker thread, which is
+// what the DOM worker, media and network threads see under load. The benches
+// measure the time to drain a fixed number of events.
+
+namespace {
+
+struct StressState {
+  explicit StressState(uint32_t aProducers, uint32_t aEventsPerProducer)
+      : mMonitor("StressState::mMonitor"),
+        mRemaining(aProducers * aEventsPerProducer),
+        mNextSequence(aProducers, 0) {}
+
+  Monitor mMonitor;
+  std::atomic<bool> mGo{false};
+  uint32_t mRemaining MOZ_GUARDED_BY(mMonitor);
+
+  // Only touched on the consumer thread.
+  std::vector<uint32_t> mNextSequence;
+  bool mInOrder = true;
+};
+
+}  // namespace
+
+// Returns whether every event ran, and in the order its producer dispatched
+// it.
+static bool RunStress(uint32_t aProducers, uint32_t aEventsPerProducer) {
+  nsCOMPtr<nsIThread> consumer;
+  nsresult rv =
+      NS_NewNamedThread("StressConsumer", getter_AddRefs(consumer));
+  EXPECT_TRUE(NS_SUCCEEDED(rv));
+  if (NS_FAILED(rv)) {
+    return false;
+  }
+
+  StressState state(aProducers, aEventsPerProducer);
+
+  nsTArray<nsCOMPtr<nsIThread>> producers;
+  for (uint32_t p = 0; p < aProducers; p++) {
+    nsCOMPtr<nsIThread> producer;
+    rv = NS_NewNamedThread("StressProducer", getter_AddRefs(producer));
+    EXPECT_TRUE(NS_SUCCEEDED(rv));
+    if (NS_FAILED(rv)) {
+      break;
+    }
+
+    producer->Dispatch(NS_NewRunnableFunction(
+        "StressProducer", [&state, consumer, p, aEventsPerProducer] {
+          while (!state.mGo.load(std::memory_order_acquire)) {
+            // Spin so that all producers start dispatching together.
+          }
+          for (uint32_t seq = 0; seq < aEventsPerProducer; seq++) {
+            consumer->Dispatch(
+                NS_NewRunnableFunction("StressEvent", [&state, p, seq] {
+                  if (state.mNextSequence[p] != seq) {
+                    state.mInOrder = false;
+                  }
+                  state.mNextSequence[p] = seq + 1;
+
+                  MonitorAutoLock lock(state.mMonitor);
+                  if (--state.mRemaining == 0) {
+                    lock.Notify();
+                  }
+                }));
+          }
+        }));
+    producers.AppendElement(producer);
+  }
+
+  if (producers.Length() != aProducers) {
+    // Let the producers which did start run down before bailing out.
+    state.mGo.store(true, std::memory_order_release);
+    for (auto& producer : producers) {
+      producer->Shutdown();
+    }
+    consumer->Shutdown();
+    return false;
+  }
+
+  state.mGo.store(true, std::memory_order_release);
+  {
+    MonitorAutoLock lock(state.mMonitor);
+    while (state.mRemaining) {
+      lock.Wait();
+    }
+  }
+
+  for (auto& producer : producers) {
+    producer->Shutdown();
+  }
+  consumer->Shutdown();
+
+  return state.mInOrder;
+}
+
+static const uint32_t kTotalEvents = 1 << 18;
+
+static void StressProducers(uint32_t aProducers) {
+  ASSERT_TRUE(RunStress(aProducers, kTotalEvents / aProducers));
+}
+
+TEST(ThreadEventQueueStress, KeepsPerProducerOrder)
+{
+  ASSERT_TRUE(RunStress(8, 10000));
+}
+
+MOZ_GTEST_BENCH(ThreadEventQueueStress, Producers1, [] { StressProducers(1); });
+MOZ_GTEST_BENCH(ThreadEventQueueStress, Producers2, [] { StressProducers(2); });
+MOZ_GTEST_BENCH(ThreadEventQueueStress, Producers4, [] { StressProducers(4); });
+MOZ_GTEST_BENCH(ThreadEventQueueStress, Producers8, [] { StressProducers(8); });
+MOZ_GTEST_BENCH(ThreadEventQueueStress, Producers16,
+                [] { StressProducers(16); });
+MOZ_GTEST_BENCH(ThreadEventQueueStress, Producers32,
+                [] { StressProducers(32); });
@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mozilla/LockFreeEventQueue.h"
+
+#include "GeckoProfiler.h"
+#include "mozilla/Unused.h"
+#include "nsIRunnable.h"
+
+using namespace mozilla;
+
+LockFreeEventQueue::LockFreeEventQueue() : mHead(&mStub), mTail(&mStub) {}
+
+LockFreeEventQueue::~LockFreeEventQueue() {
+  // The queue may be destroyed on another thread than its consumer. Leak the
+  // events which were never taken rather than releasing them on a thread
+  // they were not meant for, like ThreadEventQueue does for events it fails
+  // to dispatch.
+  nsCOMPtr<nsIRunnable> event;
+  EventQueuePriority priority;
+  TimeDuration delay;
+  while (GetEvent(event, &priority, &delay)) {
+    Unused << event.forget().take();
+  }
+  MOZ_ASSERT(IsEmpty(), "Producer still active while destroying the queue");
+}
+
+void LockFreeEventQueue::PushNode(Node* aNode) {
+  aNode->mNext.store(nullptr, std::memory_order_relaxed);
+  // The exchange is sequentially consistent so that a consumer which
+  // announced that it is about to sleep either sees this node in IsEmpty, or
+  // the producer sees the announcement. See ThreadEventQueue::GetEvent.
+  Node* prev = mHead.exchange(aNode, std::memory_order_seq_cst);
+  prev->mNext.store(aNode, std::memory_order_release);
+}
+
+void LockFreeEventQueue::PutEvent(already_AddRefed<nsIRunnable>&& aEvent,
+                                  EventQueuePriority aPriority) {
+  Node* node = new Node();
+  node->mEvent = aEvent.take();
+  node->mPriority = aPriority;
+  if (profiler_is_active()) {
+    node->mPutTime = TimeStamp::Now();
+  }
+  PushNode(node);
+}
+
+bool LockFreeEventQueue::GetEvent(nsCOMPtr<nsIRunnable>& aEvent,
+                                  EventQueuePriority* aPriority,
+                                  TimeDuration* aDelay) {
+  Node* tail = mTail;
+  Node* next = tail->mNext.load(std::memory_order_acquire);
+
+  if (tail == &mStub) {
+    if (!next) {
+      return false;
+    }
+    mTail = next;
+    tail = next;
+    next = next->mNext.load(std::memory_order_acquire);
+  }
+
+  if (!next) {
+    // |tail| is the last linked node. Unless a producer is in the middle of
+    // pushing, put the stub behind it so that |tail| can be handed out.
+    if (tail != mHead.load(std::memory_order_acquire)) {
+      return false;
+    }
+    PushNode(&mStub);
+    next = tail->mNext.load(std::memory_order_acquire);
+    if (!next) {
+      return false;
+    }
+  }
+
+  mTail = next;
+  aEvent = dont_AddRef(tail->mEvent);
+  *aPriority = tail->mPriority;
+  *aDelay = tail->mPutTime.IsNull() ? TimeDuration()
+                                    : TimeStamp::Now() - tail->mPutTime;
+  delete tail;
+  return true;
+}
+
+bool LockFreeEventQueue::IsEmpty() const {
+  return mTail == &mStub && mHead.load(std::memory_order_seq_cst) == &mStub;
+}
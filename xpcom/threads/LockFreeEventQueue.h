@@ -0,0 +1,72 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef mozilla_LockFreeEventQueue_h
+#define mozilla_LockFreeEventQueue_h
+
+#include <atomic>
+
+#include "mozilla/AlreadyAddRefed.h"
+#include "mozilla/EventQueue.h"
+#include "mozilla/TimeStamp.h"
+#include "nsCOMPtr.h"
+
+class nsIRunnable;
+
+namespace mozilla {
+
+// LockFreeEventQueue is an unbounded multiple producer, single consumer queue
+// of runnables. Producers never block: PutEvent allocates a node and links it
+// in with a single atomic exchange. The consumer takes the runnables out in
+// the order they were put in and usually moves them into an EventQueue, so
+// that priorities are still handled in one place.
+//
+// This is Dmitry Vyukov's intrusive MPSC queue. A producer which is preempted
+// between the exchange and linking its node makes the queue look non-empty
+// although GetEvent cannot return the node yet. IsEmpty reports such a queue
+// as non-empty, so the consumer will not go to sleep on it.
+class LockFreeEventQueue final {
+ public:
+  LockFreeEventQueue();
+  ~LockFreeEventQueue();
+
+  LockFreeEventQueue(const LockFreeEventQueue&) = delete;
+  LockFreeEventQueue& operator=(const LockFreeEventQueue&) = delete;
+
+  // May be called on any thread.
+  void PutEvent(already_AddRefed<nsIRunnable>&& aEvent,
+                EventQueuePriority aPriority);
+
+  // Must only be called by the consumer. Returns false if no event is linked
+  // in yet. *aDelay is set to the time the event spent in this queue if the
+  // profiler was active when it was put in, and to zero otherwise.
+  bool GetEvent(nsCOMPtr<nsIRunnable>& aEvent, EventQueuePriority* aPriority,
+                TimeDuration* aDelay);
+
+  // Must only be called by the consumer.
+  bool IsEmpty() const;
+
+ private:
+  struct Node {
+    std::atomic<Node*> mNext{nullptr};
+    nsIRunnable* mEvent = nullptr;
+    EventQueuePriority mPriority = EventQueuePriority::Normal;
+    TimeStamp mPutTime;
+  };
+
+  void PushNode(Node* aNode);
+
+  // The most recently pushed node. Written by the producers.
+  std::atomic<Node*> mHead;
+  // The oldest node, which is taken next. Only used by the consumer.
+  Node* mTail;
+  // Placeholder which keeps the list non-empty while all events are taken.
+  Node mStub;
+};
+
+}  // namespace mozilla
+
+#endif  // mozilla_LockFreeEventQueue_h
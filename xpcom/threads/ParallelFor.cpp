@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mozilla/ParallelFor.h"
+
+#include <atomic>
+
+#include "mozilla/Monitor.h"
+#include "nsThreadUtils.h"
+
+namespace mozilla {
+
+namespace {
+
+class ParallelForJob final {
+ public:
+  NS_INLINE_DECL_THREADSAFE_REFCOUNTING(ParallelForJob)
+
+  ParallelForJob(uint32_t aCount,
+                 const std::function<bool(uint32_t, uint32_t)>& aBody)
+      : mCount(aCount),
+        mBody(aBody),
+        mMonitor("ParallelForJob::mMonitor") {}
+
+  void RunItems(uint32_t aThread) {
+    for (uint32_t i = mNextIndex++; i < mCount; i = mNextIndex++) {
+      if (!mBody(i, aThread)) {
+        mNextIndex = mCount;
+      }
+    }
+  }
+
+  void RunHelper() {
+    uint32_t thread;
+    {
+      MonitorAutoLock lock(mMonitor);
+      if (mDone) {
+        // mBody may refer to a stack frame which is gone already.
+        return;
+      }
+      mActiveHelpers++;
+      thread = ++mThreads - 1;
+    }
+
+    RunItems(thread);
+
+    MonitorAutoLock lock(mMonitor);
+    if (--mActiveHelpers == 0) {
+      lock.Notify();
+    }
+  }
+
+  // Called on the calling thread once it has run out of items.
+  uint32_t Finish() {
+    MonitorAutoLock lock(mMonitor);
+    mDone = true;
+    while (mActiveHelpers) {
+      lock.Wait();
+    }
+    return mThreads;
+  }
+
+ private:
+  ~ParallelForJob() = default;
+
+  const uint32_t mCount;
+  // Only valid while the calling thread is in ParallelFor.
+  const std::function<bool(uint32_t, uint32_t)>& mBody;
+  std::atomic<uint32_t> mNextIndex{0};
+
+  Monitor mMonitor;
+  bool mDone MOZ_GUARDED_BY(mMonitor) = false;
+  uint32_t mActiveHelpers MOZ_GUARDED_BY(mMonitor) = 0;
+  // The calling thread is thread 0.
+  uint32_t mThreads MOZ_GUARDED_BY(mMonitor) = 1;
+};
+
+}  // namespace
+
+uint32_t ParallelFor(uint32_t aCount, uint32_t aHelperThreads,
+                     const std::function<bool(uint32_t, uint32_t)>& aBody) {
+  RefPtr<ParallelForJob> job = new ParallelForJob(aCount, aBody);
+  for (uint32_t i = 0; i < aHelperThreads; i++) {
+    nsresult rv = NS_DispatchBackgroundTask(NS_NewRunnableFunction(
+        "ParallelFor", [job] { job->RunHelper(); }));
+    if (NS_FAILED(rv)) {
+      break;
+    }
+  }
+
+  job->RunItems(0);
+  return job->Finish();
+}
+
+}  // namespace mozilla
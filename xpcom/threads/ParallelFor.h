@@ -0,0 +1,32 @@
+/* -*- Mode: C++; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/* vim: set ts=8 sts=2 et sw=2 tw=80: */
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef mozilla_ParallelFor_h
+#define mozilla_ParallelFor_h
+
+#include <functional>
+#include <stdint.h>
+
+namespace mozilla {
+
+// Calls aBody(aIndex, aThread) for each aIndex in [0, aCount), on the calling
+// thread and on up to aHelperThreads background task threads. Indices are
+// handed out in increasing order to whichever thread asks next. aThread is in
+// [0, aHelperThreads] and is the same for all calls on one thread, so that
+// the caller can keep per thread state in an array; the calling thread is 0.
+// Once a call returns false, no further indices are handed out.
+//
+// The calling thread takes part, so the loop finishes even if no helper gets
+// to run, and helpers which start after the calling thread is done do
+// nothing. ParallelFor returns once no helper is in aBody any more, so aBody
+// may refer to the caller's stack. Returns the number of threads, including
+// the calling thread, which took part.
+uint32_t ParallelFor(uint32_t aCount, uint32_t aHelperThreads,
+                     const std::function<bool(uint32_t, uint32_t)>& aBody);
+
+}  // namespace mozilla
+
+#endif  // mozilla_ParallelFor_h
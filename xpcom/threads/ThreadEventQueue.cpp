@@ -115,6 +115,32 @@ bool ThreadEventQueue::PutEventInternal(already_AddRefed<nsIRunnable>&& aEvent,
       }
     }
 
+    if (!mIsMainThread && !aSink) {
+      // The event could run and the thread could go away as soon as it is
+      // linked in, so keep ourselves alive until we are done.
+      RefPtr<ThreadEventQueue> kungFuDeathGrip(this);
+
+      // Register as a producer first, so that ShutdownIfNoPendingEvents cannot
+      // doom the queue (and drop retired observers) while we are in here.
+      if (mPutState.fetch_add(1) & kPutEventsDoomed) {
+        mPutState.fetch_sub(1);
+        return false;
+      }
+      mPendingEvents.PutEvent(event.take(), aPriority);
+
+      if (mWaitingForEvents.load()) {
+        MutexAutoLock lock(mLock);
+        mEventsAvailable.Notify();
+      }
+
+      if (nsIThreadObserver* obs = mDispatchObserver.load()) {
+        obs->OnDispatchedEvent();
+      }
+
+      mPutState.fetch_sub(1);
+      return true;
+    }
+
     MutexAutoLock lock(mLock);
 
     if (mEventsAreDoomed) {
@@ -157,6 +183,8 @@ already_AddRefed<nsIRunnable> ThreadEventQueue::GetEvent(
     MutexAutoLock lock(mLock);
 
     for (;;) {
+      TakePendingEvents(lock);
+
       const bool noNestedQueue = mNestedQueues.IsEmpty();
       if (noNestedQueue) {
         event = mBaseQueue->GetEvent(lock, aLastEventDelay);
@@ -177,16 +205,36 @@ already_AddRefed<nsIRunnable> ThreadEventQueue::GetEvent(
         break;
       }
 
+      // Announce that we are going to sleep before checking for lock free
+      // events one last time. A producer either sees the announcement and
+      // notifies us, or we see its event.
+      mWaitingForEvents.store(true);
+      if (!mPendingEvents.IsEmpty()) {
+        mWaitingForEvents.store(false);
+        continue;
+      }
+
       AUTO_PROFILER_LABEL("ThreadEventQueue::GetEvent::Wait", IDLE);
       mEventsAvailable.Wait();
+      mWaitingForEvents.store(false);
     }
   }
 
   return event.forget();
 }
 
+void ThreadEventQueue::TakePendingEvents(const MutexAutoLock& aProofOfLock) {
+  nsCOMPtr<nsIRunnable> event;
+  EventQueuePriority priority;
+  TimeDuration delay;
+  while (mPendingEvents.GetEvent(event, &priority, &delay)) {
+    mBaseQueue->PutEvent(event.forget(), priority, aProofOfLock, &delay);
+  }
+}
+
 bool ThreadEventQueue::HasPendingEvent() {
   MutexAutoLock lock(mLock);
+  TakePendingEvents(lock);
 
   // We always get events from the topmost queue when there are nested queues.
   if (mNestedQueues.IsEmpty()) {
@@ -198,11 +246,26 @@ bool ThreadEventQueue::HasPendingEvent() {
 
 bool ThreadEventQueue::ShutdownIfNoPendingEvents() {
   MutexAutoLock lock(mLock);
-  if (mNestedQueues.IsEmpty() && mBaseQueue->IsEmpty(lock)) {
+  TakePendingEvents(lock);
+  if (!mNestedQueues.IsEmpty() || !mBaseQueue->IsEmpty(lock)) {
+    return false;
+  }
+
+  if (!mEventsAreDoomed) {
+    // This fails while a lock free producer is putting an event.
+    uint32_t noProducers = 0;
+    if (!mPutState.compare_exchange_strong(noProducers, kPutEventsDoomed)) {
+      return false;
+    }
     mEventsAreDoomed = true;
-    return true;
+
+    // No lock free producer can use an observer anymore.
+    mRetiredObservers.Clear();
   }
-  return false;
+
+  // Events which were put in after TakePendingEvents above but before the
+  // queue was doomed have been accepted, so they still have to run.
+  return mPendingEvents.IsEmpty();
 }
 
 already_AddRefed<nsISerialEventTarget> ThreadEventQueue::PushEventQueue() {
@@ -229,6 +292,10 @@ void ThreadEventQueue::PopEventQueue(nsIEventTarget* aTarget) {
   // Disconnect the event target that will be popped.
   item.mEventTarget->Disconnect(lock);
 
+  // Events dispatched to the base queue before this point stay in front of
+  // the ones moved out of the nested queue.
+  TakePendingEvents(lock);
+
   EventQueue* prevQueue =
       mNestedQueues.Length() == 1
           ? mBaseQueue.get()
@@ -280,6 +347,10 @@ void ThreadEventQueue::SetObserver(nsIThreadObserver* aObserver) {
   {
     MutexAutoLock lock(mLock);
     mObserver.swap(observer);
+    mDispatchObserver.store(aObserver);
+    if (observer && !mEventsAreDoomed) {
+      mRetiredObservers.AppendElement(std::move(observer));
+    }
   }
   if (NS_IsMainThread()) {
     TaskController::Get()->SetThreadObserver(aObserver);
@@ -7,8 +7,11 @@
 #ifndef mozilla_ThreadEventQueue_h
 #define mozilla_ThreadEventQueue_h
 
+#include <atomic>
+
 #include "mozilla/EventQueue.h"
 #include "mozilla/CondVar.h"
+#include "mozilla/LockFreeEventQueue.h"
 #include "mozilla/SynchronizedEventQueue.h"
 #include "nsCOMPtr.h"
 #include "nsTArray.h"
@@ -27,6 +30,11 @@ class ThreadEventTarget;
 // (see the documentation below for an explanation of those). All threads use a
 // ThreadEventQueue as their event queue. Although for the main thread this
 // simply forwards events to the TaskController.
+//
+// On threads other than the main thread, events dispatched to the base queue
+// do not take the lock. They are put into a LockFreeEventQueue and moved into
+// the EventQueue by the thread itself, under the lock, whenever it looks for
+// events. Nested queues and the main thread keep using the lock.
 class ThreadEventQueue final : public SynchronizedEventQueue {
  public:
   explicit ThreadEventQueue(UniquePtr<EventQueue> aQueue,
@@ -66,6 +74,9 @@ class ThreadEventQueue final : public SynchronizedEventQueue {
   bool PutEventInternal(already_AddRefed<nsIRunnable>&& aEvent,
                         EventQueuePriority aPriority, NestedSink* aQueue);
 
+  // Moves the events dispatched without the lock into mBaseQueue.
+  void TakePendingEvents(const MutexAutoLock& aProofOfLock);
+
   const UniquePtr<EventQueue> mBaseQueue;
 
   struct NestedQueueItem {
@@ -83,6 +94,24 @@ class ThreadEventQueue final : public SynchronizedEventQueue {
 
   bool mEventsAreDoomed MOZ_GUARDED_BY(mLock) = false;
   nsCOMPtr<nsIThreadObserver> mObserver MOZ_GUARDED_BY(mLock);
+
+  // Events dispatched to the base queue without taking mLock.
+  LockFreeEventQueue mPendingEvents;
+
+  // Number of producers currently putting an event into mPendingEvents, or
+  // kPutEventsDoomed once ShutdownIfNoPendingEvents has doomed the queue.
+  static constexpr uint32_t kPutEventsDoomed = 1u << 31;
+  std::atomic<uint32_t> mPutState{0};
+
+  // Set while the thread waits on mEventsAvailable, so that lock free
+  // producers know they have to notify it.
+  std::atomic<bool> mWaitingForEvents{false};
+
+  // mObserver for lock free producers. Observers which are replaced are kept
+  // alive in mRetiredObservers until the queue is doomed, since a producer may
+  // still call a stale pointer it loaded just before the swap.
+  std::atomic<nsIThreadObserver*> mDispatchObserver{nullptr};
+  nsTArray<nsCOMPtr<nsIThreadObserver>> mRetiredObservers MOZ_GUARDED_BY(mLock);
   nsTArray<nsCOMPtr<nsITargetShutdownTask>> mShutdownTasks
       MOZ_GUARDED_BY(mLock);
   bool mShutdownTasksRun MOZ_GUARDED_BY(mLock) = false;